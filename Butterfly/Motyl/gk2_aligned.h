@@ -0,0 +1,178 @@
+#ifndef __GK2_ALIGNED_H_
+#define __GK2_ALIGNED_H_
+
+#include <cassert>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+//Checks in debug builds that the object at the address may hold XMVECTOR or XMMATRIX members
+#define GK2_ASSERT_ALIGNED(ptr, alignment) assert(gk2::AlignedMemory::IsAligned((ptr), (alignment)))
+
+namespace gk2
+{
+	//XMVECTOR and XMMATRIX have to be stored at addresses aligned to 16 bytes, while the heap aligns only to 8
+	//bytes on x86. Objects with such members are allocated with the helpers below.
+	class AlignedMemory
+	{
+	public:
+		static const size_t DEFAULT_ALIGNMENT = 16;
+
+		//Alignment has to be a power of two. Throws std::bad_alloc.
+		static void* Allocate(size_t size, size_t alignment = DEFAULT_ALIGNMENT);
+		static void Free(void* ptr);
+
+		static bool IsAligned(const void* ptr, size_t alignment = DEFAULT_ALIGNMENT)
+		{
+			return (reinterpret_cast<size_t>(ptr) & (alignment - 1)) == 0;
+		}
+	};
+
+	//STL allocator of aligned memory, so containers can hold objects with XMMATRIX members
+	template<typename T, size_t Alignment = AlignedMemory::DEFAULT_ALIGNMENT>
+	class AlignedAllocator
+	{
+	public:
+		typedef T value_type;
+		typedef T* pointer;
+		typedef const T* const_pointer;
+		typedef T& reference;
+		typedef const T& const_reference;
+		typedef size_t size_type;
+		typedef ptrdiff_t difference_type;
+
+		template<typename U>
+		struct rebind
+		{
+			typedef AlignedAllocator<U, Alignment> other;
+		};
+
+		AlignedAllocator() { }
+		template<typename U>
+		AlignedAllocator(const AlignedAllocator<U, Alignment>&) { }
+
+		T* allocate(size_t count)
+		{
+			if (count > static_cast<size_t>(-1) / sizeof(T))
+				throw std::bad_alloc();
+			T* ptr = static_cast<T*>(AlignedMemory::Allocate(count * sizeof(T), Alignment));
+			GK2_ASSERT_ALIGNED(ptr, Alignment);
+			return ptr;
+		}
+
+		void deallocate(T* ptr, size_t) { AlignedMemory::Free(ptr); }
+	};
+
+	template<typename T, typename U, size_t Alignment>
+	bool operator ==(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) { return true; }
+
+	template<typename T, typename U, size_t Alignment>
+	bool operator !=(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) { return false; }
+
+	template<typename T>
+	using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+	template<typename T>
+	using AlignedList = std::list<T, AlignedAllocator<T>>;
+
+	//Object and the control block in one aligned allocation
+	template<typename T, typename... Args>
+	std::shared_ptr<T> MakeAligned(Args&&... args)
+	{
+		std::shared_ptr<T> ptr = std::allocate_shared<T>(AlignedAllocator<T>(), std::forward<Args>(args)...);
+		GK2_ASSERT_ALIGNED(ptr.get(), AlignedMemory::DEFAULT_ALIGNMENT);
+		return ptr;
+	}
+
+	//Base of the classes with XMVECTOR or XMMATRIX members, makes new return aligned objects
+	class AlignedNew
+	{
+	public:
+		static void* operator new(size_t size) { return AlignedMemory::Allocate(size); }
+		static void* operator new[](size_t size) { return AlignedMemory::Allocate(size); }
+		static void* operator new(size_t, void* ptr) { return ptr; }
+		static void operator delete(void* ptr) { AlignedMemory::Free(ptr); }
+		static void operator delete[](void* ptr) { AlignedMemory::Free(ptr); }
+		static void operator delete(void*, void*) { }
+	};
+
+	//Fixed size blocks carved out of aligned chunks. Freed blocks are kept on a free list and handed out again, so
+	//small objects which come and go don't go to the heap and lie close to each other. Thread safe.
+	class BlockPool
+	{
+	public:
+		BlockPool(size_t blockSize, size_t blocksPerChunk = 64, size_t alignment = AlignedMemory::DEFAULT_ALIGNMENT);
+		~BlockPool();
+
+		void* Allocate();
+		//Block has to come from this pool
+		void Free(void* ptr);
+
+		size_t getBlockSize() const { return m_blockSize; }
+		//Blocks handed out and not freed
+		size_t getUsedBlocks() const;
+		size_t getCapacity() const;
+
+	private:
+		struct FreeBlock
+		{
+			FreeBlock* Next;
+		};
+
+		mutable std::mutex m_mutex;
+		size_t m_blockSize;
+		//Distance between the blocks, the size rounded up to the alignment
+		size_t m_stride;
+		size_t m_blocksPerChunk;
+		size_t m_alignment;
+		std::vector<void*> m_chunks;
+		FreeBlock* m_free;
+		size_t m_used;
+
+		BlockPool(const BlockPool&);
+		BlockPool& operator =(const BlockPool&);
+	};
+
+	//Base of small classes with aligned members which are often allocated, takes their objects from a pool
+	//shared by the class. Objects of derived classes of a different size go to the aligned heap.
+	template<typename T>
+	class PoolNew
+	{
+	public:
+		static void* operator new(size_t size)
+		{
+			return size == sizeof(T) ? SharedPool().Allocate() : AlignedMemory::Allocate(size);
+		}
+
+		static void operator delete(void* ptr, size_t size)
+		{
+			if (size == sizeof(T))
+				SharedPool().Free(ptr);
+			else
+				AlignedMemory::Free(ptr);
+		}
+
+		static void* operator new[](size_t size) { return AlignedMemory::Allocate(size); }
+		static void operator delete[](void* ptr) { AlignedMemory::Free(ptr); }
+		static void* operator new(size_t, void* ptr) { return ptr; }
+		static void operator delete(void*, void*) { }
+
+		static const BlockPool& getPool() { return SharedPool(); }
+
+	private:
+		//Constructed on first use, so objects created while the globals of other files are initialized find it.
+		//Visual Studio 2013 doesn't guard the initialization of local statics against threads, there the first
+		//object has to be created before the loader threads start.
+		static BlockPool& SharedPool()
+		{
+			static BlockPool pool(sizeof(T));
+			return pool;
+		}
+	};
+}
+
+#endif __GK2_ALIGNED_H_
@@ -1,12 +1,16 @@
 #include "gk2_applicationBase.h"
 #include "gk2_window.h"
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <sstream>
 
 using namespace std;
 using namespace gk2;
 
 ApplicationBase::ApplicationBase(HINSTANCE hInstance)
 	: m_hInstance(hInstance), m_mainWindow(0), m_featureLevel(D3D_FEATURE_LEVEL_11_0),
-	  m_driverType(D3D_DRIVER_TYPE_NULL)
+	  m_driverType(D3D_DRIVER_TYPE_NULL), m_traceKeyDown(false)
 {
 
 }
@@ -64,7 +68,10 @@ void ApplicationBase::CreateDeviceAndSwapChain(SIZE windowSize)
 			featureLevelsCout, D3D11_SDK_VERSION, &desc, &swapChain, &device, &m_featureLevel, &context);
 		m_device.m_deviceObject.reset(device, Utils::COMRelease);
 		m_swapChain.reset(swapChain, Utils::COMRelease);
-		m_context.reset(context, Utils::COMRelease);
+		shared_ptr<ID3D11DeviceContext> deviceContext(context, Utils::COMRelease);
+		m_stateFilter.reset(context ? new StateFilteringContext(shared_ptr<RenderContext>(
+			new DeviceContext(deviceContext))) : nullptr);
+		m_context = m_stateFilter;
 		if (SUCCEEDED(result))
 		{
 			m_driverType = driverTypes[driver];
@@ -119,9 +126,13 @@ bool ApplicationBase::Initialize()
 {
 	SIZE windowSize = getMainWindow()->getClientSize();
 	CreateDeviceAndSwapChain(windowSize);
+	m_device.m_shaderCache.reset(new ShaderCache(shared_ptr<AssetCache>(new AssetCache()), &DeviceHelper::CompileShader,
+		DeviceHelper::ShaderCompileFlags()));
 	CreateBackBuffers(windowSize);
 	SetViewPort(windowSize);
 	InitializeDirectInput();
+	srand(m_capture.getMode() == InputCapture::MODE_OFF ? static_cast<unsigned int>(time(0))
+														: m_capture.getInitialSeed());
 	return LoadContent();
 }
 
@@ -145,22 +156,111 @@ int ApplicationBase::MainLoop()
 				dwTimeStart = dwTimeCur;
 			t = ( dwTimeCur - dwTimeStart ) / 1000.0f;
 			dwTimeStart = dwTimeCur;
-			Update(t);
-			Render();
+			if (!CaptureFrame(t))
+			{
+				PostQuitMessage(0);
+				continue;
+			}
+			m_stateFilter->BeginFrame();
+			{
+				PROFILE_ZONE("Frame");
+				{
+					PROFILE_ZONE("Update");
+					Update(t);
+				}
+				PROFILE_ZONE("Render");
+				Render();
+			}
+			Profiler::EndFrame();
+			ExportProfile();
 		}
 	}
+	ReportProfile();
 	Shutdown();
 	return static_cast<int>(msg.wParam);
 }
 
+void ApplicationBase::RecordInput(const string& fileName)
+{
+	m_capture.StartRecording(fileName, static_cast<unsigned int>(time(0)));
+}
+
+void ApplicationBase::ReplayInput(const string& fileName, float fixedDt /* = 0.0f */)
+{
+	m_capture.StartReplay(fileName, fixedDt);
+}
+
+bool ApplicationBase::CaptureFrame(float& dt)
+{
+	InputCapture::Frame frame;
+	switch (m_capture.getMode())
+	{
+	case InputCapture::MODE_RECORD:
+		m_keyboard->Release();
+		m_mouse->Release();
+		frame.Dt = dt;
+		frame.Seed = static_cast<unsigned int>(rand());
+		frame.KeyboardValid = m_keyboard->GetState(frame.Keyboard);
+		frame.MouseValid = m_mouse->GetState(frame.Mouse);
+		m_capture.RecordFrame(frame);
+		break;
+	case InputCapture::MODE_REPLAY:
+		if (!m_capture.ReplayFrame(frame))
+			return false;
+		dt = frame.Dt;
+		break;
+	default:
+		return true;
+	}
+	//Every read of the devices during the frame gets the captured state
+	m_keyboard->Hold(frame.Keyboard, frame.KeyboardValid);
+	m_mouse->Hold(frame.Mouse, frame.MouseValid);
+	srand(frame.Seed);
+	return true;
+}
+
+void ApplicationBase::ExportProfile()
+{
+	KeyboardState state;
+	bool keyDown = m_keyboard->GetState(state) && state.isKeyDown(DIK_F12);
+	if (keyDown && !m_traceKeyDown)
+	{
+		ofstream file("profile.json");
+		Profiler::WriteChromeTrace(file);
+	}
+	m_traceKeyDown = keyDown;
+}
+
+void ApplicationBase::ReportProfile()
+{
+	wstringstream s;
+	Profiler::WriteStatistics(s);
+	OutputDebugStringW(s.str().c_str());
+}
+
+void ApplicationBase::ReportStateStatistics()
+{
+	if (!m_stateFilter)
+		return;
+	const StateFilteringContext::Statistics& total = m_stateFilter->getTotalStatistics();
+	const StateFilteringContext::Statistics& frame = m_stateFilter->getLastFrameStatistics();
+	wstringstream s;
+	s << L"State calls issued: " << total.Issued << L", filtered: " << total.Filtered << L" (last frame: "
+	  << frame.Issued << L" issued, " << frame.Filtered << L" filtered)" << endl;
+	OutputDebugStringW(s.str().c_str());
+}
+
 void ApplicationBase::Shutdown()
 {
+	ReportStateStatistics();
+	m_capture.Stop();
 	UnloadContent();
 	m_depthStencilTexture.reset();
 	m_depthStencilView.reset();
 	m_backBuffer.reset();
 	m_swapChain.reset();
 	m_context.reset();
+	m_stateFilter.reset();
 	m_device.m_deviceObject.reset();
 	m_keyboard.reset();
 	m_mouse.reset();
@@ -175,3 +275,30 @@ int ApplicationBase::Run(Window* w, int cmdShow)
 	m_mainWindow->Show(cmdShow);
 	return MainLoop();
 }
+
+int ApplicationBase::PrecompileShaders(const wstring& manifestFile)
+{
+	//The application has no console, the messages go to the debugger
+	wostringstream log;
+	int result;
+	try
+	{
+		ShaderCache cache(shared_ptr<AssetCache>(new AssetCache()), &DeviceHelper::CompileShader,
+						  DeviceHelper::ShaderCompileFlags());
+		vector<ShaderDesc> failed = cache.Precompile(cache.ReadManifest(manifestFile));
+		for (auto it = failed.begin(); it != failed.end(); ++it)
+			log << it->File << L": " << wstring(it->Entry.begin(), it->Entry.end()) << L" ("
+				<< wstring(it->Model.begin(), it->Model.end()) << L") failed to compile" << endl;
+		log << cache.getMisses() - failed.size() << L" shaders compiled, " << cache.getHits() << L" up to date"
+			<< endl;
+		result = static_cast<int>(failed.size());
+	}
+	catch (exception& e)
+	{
+		string s(e.what());
+		log << manifestFile << L": " << wstring(s.begin(), s.end()) << endl;
+		result = -1;
+	}
+	OutputDebugStringW(log.str().c_str());
+	return result;
+}
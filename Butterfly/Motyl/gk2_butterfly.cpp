@@ -2,6 +2,7 @@
 #include "gk2_utils.h"
 #include "gk2_vertices.h"
 #include "gk2_window.h"
+#include <sstream>
 
 using namespace std;
 using namespace gk2;
@@ -9,10 +10,6 @@ using namespace gk2;
 #define RESOURCES_PATH L"resources/"
 const wstring Butterfly::ShaderFile = RESOURCES_PATH L"shaders/Butterfly.hlsl";
 
-const float Butterfly::DODECAHEDRON_R = sqrtf(0.375f + 0.125f * sqrtf(5.0f));
-const float Butterfly::DODECAHEDRON_H = 1.0f + 2.0f * Butterfly::DODECAHEDRON_R;
-const float Butterfly::DODECAHEDRON_A = XMScalarACos(-0.2f * sqrtf(5.0f));
-
 const float Butterfly::MOEBIUS_R = 1.0f;
 const float Butterfly::MOEBIUS_W = 0.1f;
 const int Butterfly::MOEBIUS_N = 128;
@@ -26,6 +23,8 @@ const float Butterfly::WING_MAX_A = 8.0f * XM_PIDIV2 / 9.0f; //80 degrees
 const unsigned int Butterfly::VB_STRIDE = sizeof(VertexPosNormal);
 const unsigned int Butterfly::VB_OFFSET = 0;
 const unsigned int Butterfly::BS_MASK = 0xffffffff;
+const unsigned int Butterfly::DRAW_CONSTANTS_SIZE = 512 * 1024;
+const unsigned int Butterfly::FRAMES_IN_FLIGHT = 3;
 
 const XMFLOAT4 Butterfly::GREEN_LIGHT_POS = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 const XMFLOAT4 Butterfly::BLUE_LIGHT_POS = XMFLOAT4(-1.0f, -1.0f, -1.0f, 1.0f);
@@ -52,18 +51,21 @@ const XMFLOAT4 Butterfly::LIGHTCOLORS[] =
 	XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f)
 };
 
-void* Butterfly::operator new(size_t size)
-{
-	return Utils::New16Aligned(size);
-}
-
-void Butterfly::operator delete(void* ptr)
+namespace
 {
-	Utils::Delete16Aligned(ptr);
+	//Input layout of the vertex type T followed by the per-draw constants
+	template<typename T>
+	vector<D3D11_INPUT_ELEMENT_DESC> DrawLayout()
+	{
+		vector<D3D11_INPUT_ELEMENT_DESC> layout(T::Layout, T::Layout + T::LayoutElements);
+		layout.insert(layout.end(), DrawConstants::Layout, DrawConstants::Layout + DrawConstants::LayoutElements);
+		return layout;
+	}
 }
 
 Butterfly::Butterfly(HINSTANCE hInstance)
-	: ApplicationBase(hInstance), m_camera(0.01f, 100.0f)
+	: ApplicationBase(hInstance), m_camera(0.01f, 100.0f), m_surfaceColor(1.0f, 1.0f, 1.0f, 1.0f),
+	  m_reflections(ButterflyScene::REFLECTION_SETTINGS), m_reflectingNode(ReflectionTree::NO_NODE)
 {
 
 }
@@ -79,12 +81,14 @@ void Butterfly::InitializeShaders()
 	shared_ptr<ID3DBlob> psByteCode = m_device.CompileD3DShader(ShaderFile, "PS_Main", "ps_4_0");
 	m_vertexShader = m_device.CreateVertexShader(vsByteCode);
 	m_pixelShader = m_device.CreatePixelShader(psByteCode);
-	m_inputLayout = m_device.CreateInputLayout<VertexPosNormal>(vsByteCode);
+	vector<D3D11_INPUT_ELEMENT_DESC> layout = DrawLayout<VertexPosNormal>();
+	m_inputLayout = m_device.CreateInputLayout(layout.data(), static_cast<unsigned int>(layout.size()), vsByteCode);
 	vsByteCode = m_device.CompileD3DShader(ShaderFile, "VS_Bilboard", "vs_4_0");
 	psByteCode = m_device.CompileD3DShader(ShaderFile, "PS_Bilboard", "ps_4_0");
 	m_vsBilboard = m_device.CreateVertexShader(vsByteCode);
 	m_psBilboard = m_device.CreatePixelShader(psByteCode);
-	m_ilBilboard = m_device.CreateInputLayout<VertexPos>(vsByteCode);
+	layout = DrawLayout<VertexPos>();
+	m_ilBilboard = m_device.CreateInputLayout(layout.data(), static_cast<unsigned int>(layout.size()), vsByteCode);
 }
 
 void Butterfly::InitializeConstantBuffers()
@@ -94,7 +98,6 @@ void Butterfly::InitializeConstantBuffers()
 	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
 	desc.ByteWidth = sizeof(XMMATRIX);
 	desc.Usage = D3D11_USAGE_DEFAULT;
-	m_cbWorld = m_device.CreateBuffer(desc);
 	m_cbProj = m_device.CreateBuffer(desc);
 	desc.ByteWidth = sizeof(XMMATRIX) * 2;
 	m_cbView = m_device.CreateBuffer(desc);
@@ -102,8 +105,8 @@ void Butterfly::InitializeConstantBuffers()
 	m_cbLightPos = m_device.CreateBuffer(desc);
 	desc.ByteWidth = sizeof(XMFLOAT4) * 5;
 	m_cbLightColors = m_device.CreateBuffer(desc);
-	desc.ByteWidth = sizeof(XMFLOAT4);
-	m_cbSurfaceColor = m_device.CreateBuffer(desc);
+	m_drawConstants.reset(new UploadBuffer(m_device, DRAW_CONSTANTS_SIZE, D3D11_BIND_VERTEX_BUFFER,
+										   FRAMES_IN_FLIGHT));
 }
 
 void Butterfly::InitializeRenderStates()
@@ -112,16 +115,20 @@ void Butterfly::InitializeRenderStates()
 	D3D11_DEPTH_STENCIL_DESC dssDesc = m_device.DefaultDepthStencilDesc();
 
 	dssDesc.StencilEnable = true;
-	dssDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
 	dssDesc.BackFace.StencilFunc = D3D11_COMPARISON_NEVER;
-	dssDesc.FrontFace.StencilFunc = D3D11_COMPARISON_ALWAYS;
-	dssDesc.FrontFace.StencilPassOp = D3D11_STENCIL_OP_REPLACE;
-	m_dssWrite = m_device.CreateDepthStencilState(dssDesc);
-
-	dssDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
 	dssDesc.FrontFace.StencilFunc = D3D11_COMPARISON_EQUAL;
-	dssDesc.FrontFace.StencilPassOp = D3D11_STENCIL_OP_KEEP;
-	m_dssTest = m_device.CreateDepthStencilState(dssDesc);
+	//Reference values of the reflection tree nodes contain their parents' values in the low bits
+	for (unsigned int i = 0; i <= ReflectionTree::STENCIL_BITS; ++i)
+	{
+		dssDesc.StencilReadMask = static_cast<UINT8>((1 << i) - 1);
+		dssDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+		dssDesc.FrontFace.StencilPassOp = D3D11_STENCIL_OP_REPLACE;
+		m_dssWrite[i] = m_device.CreateDepthStencilState(dssDesc);
+
+		dssDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+		dssDesc.FrontFace.StencilPassOp = D3D11_STENCIL_OP_KEEP;
+		m_dssTest[i] = m_device.CreateDepthStencilState(dssDesc);
+	}
 
 	D3D11_RASTERIZER_DESC rsDesc = m_device.DefaultRasterizerDesc();
 	rsDesc.FrontCounterClockwise = true;
@@ -147,9 +154,9 @@ void Butterfly::InitializeCamera()
 {
 	SIZE s = getMainWindow()->getClientSize();
 	float ar = static_cast<float>(s.cx) / s.cy;
-	m_projMtx = XMMatrixPerspectiveFovLH(XM_PIDIV4, ar, 0.01f, 100.0f);
+	m_projMtx = ButterflyScene::ProjectionMatrix(ar);
 	m_context->UpdateSubresource(m_cbProj.get(), 0, 0, &m_projMtx, 0, 0);
-	m_camera.Zoom(5);
+	ButterflyScene::InitializeCamera(m_camera);
 	UpdateCamera(m_camera.GetViewMatrix());
 }
 
@@ -209,12 +216,9 @@ void Butterfly::InitializeBox()
 void Butterfly::InitializePentagon()
 {
 	VertexPosNormal vertices[5];
-	float a = 0, da = XM_2PI / 5.0f;
-	for (int i = 0; i < 5; ++i, a -= da)
+	for (int i = 0; i < 5; ++i)
 	{
-		float sina, cosa;
-		XMScalarSinCos(&sina, &cosa, a);
-		vertices[i].Pos = XMFLOAT3(cosa, sina, 0.0f);
+		vertices[i].Pos = ButterflyScene::PentagonPos(i);
 		vertices[i].Normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
 	}
 	m_vbPentagon = m_device.CreateVertexBuffer(vertices, 5);
@@ -223,26 +227,11 @@ void Butterfly::InitializePentagon()
 }
 
 void Butterfly::InitializeDodecahedron()
-//Compute dodecahedronMtx and mirrorMtx
+//Compute dodecahedronMtx and the mirrors
 {
-	m_dodecahedronMtx[0] = XMMatrixRotationX(XM_PIDIV2) * XMMatrixTranslation(0, -DODECAHEDRON_H / 2, 0) * XMMatrixScaling(2.0f, 2.0f, 2.0f);
-	float da = XM_2PI / 5.0f, a = da;
-	for (int i = 1; i < 6; ++i, a += da)
-	{
-		m_dodecahedronMtx[i] =
-			XMMatrixRotationZ(XM_PIDIV2) *
-			XMMatrixTranslation(0, DODECAHEDRON_R, 0) *
-			XMMatrixRotationX(DODECAHEDRON_A - XM_PIDIV2) *
-			XMMatrixTranslation(0, -DODECAHEDRON_H / 2, DODECAHEDRON_R) *
-			XMMatrixRotationY(a - XM_PIDIV2) *
-			XMMatrixScaling(2.0f, 2.0f, 2.0f);
-		m_dodecahedronMtx[i + 6] = m_dodecahedronMtx[i] * XMMatrixRotationZ(XM_PI);
-	}
-	m_dodecahedronMtx[6] = m_dodecahedronMtx[0] * XMMatrixRotationZ(XM_PI);
-	XMMATRIX scale = XMMatrixScaling(1, 1, -1);
-	XMVECTOR det;
-	for (int i = 0; i < 12; ++i)
-		m_mirrorMtx[i] = XMMatrixInverse(&det, m_dodecahedronMtx[i]) * scale * m_dodecahedronMtx[i];
+	for (unsigned int i = 0; i < ButterflyScene::FACES; ++i)
+		m_dodecahedronMtx[i] = ButterflyScene::DodecahedronMatrix(i);
+	ButterflyScene::AddMirrors(m_mirrors);
 }
 
 XMFLOAT3 Butterfly::MoebiusStripPos(float t, float s)
@@ -355,10 +344,10 @@ void Butterfly::SetBilboardShaders()
 
 void Butterfly::SetConstantBuffers()
 {
-	ID3D11Buffer* vsb[] = { m_cbWorld.get(), m_cbView.get(), m_cbProj.get(), m_cbLightPos.get() };
-	m_context->VSSetConstantBuffers(0, 4, vsb);
-	ID3D11Buffer* psb[] = { m_cbLightColors.get(), m_cbSurfaceColor.get() };
-	m_context->PSSetConstantBuffers(0, 2, psb);
+	ID3D11Buffer* vsb[] = { m_cbView.get(), m_cbProj.get(), m_cbLightPos.get() };
+	m_context->VSSetConstantBuffers(1, 3, vsb);
+	ID3D11Buffer* psb[] = { m_cbLightColors.get() };
+	m_context->PSSetConstantBuffers(0, 1, psb);
 }
 
 bool Butterfly::LoadContent()
@@ -382,6 +371,9 @@ bool Butterfly::LoadContent()
 
 void Butterfly::UnloadContent()
 {
+	ReportUploadStatistics();
+	ReportMirrorStatistics();
+
 	m_vertexShader.reset();
 	m_pixelShader.reset();
 	m_inputLayout.reset();
@@ -389,8 +381,11 @@ void Butterfly::UnloadContent()
 	m_psBilboard.reset();
 	m_ilBilboard.reset();
 
-	m_dssWrite.reset();
-	m_dssTest.reset();
+	for (unsigned int i = 0; i <= ReflectionTree::STENCIL_BITS; ++i)
+	{
+		m_dssWrite[i].reset();
+		m_dssTest[i].reset();
+	}
 	m_rsCounterClockwise.reset();
 	m_bsAlpha.reset();
 	m_bsAdd.reset();
@@ -406,12 +401,11 @@ void Butterfly::UnloadContent()
 	m_vbBilboard.reset();
 	m_ibBilboard.reset();
 
-	m_cbWorld.reset();
 	m_cbView.reset();
 	m_cbProj.reset();
 	m_cbLightPos.reset();
 	m_cbLightColors.reset();
-	m_cbSurfaceColor.reset();
+	m_drawConstants.reset();
 }
 
 void Butterfly::UpdateCamera(const XMMATRIX& view)
@@ -459,6 +453,7 @@ void Butterfly::UpdateButterfly(float dtime)
 void Butterfly::SetLight0()
 //Setup one positional light at the camera
 {
+	DrawInstances();
 	XMFLOAT4 positions[3];
 	ZeroMemory(positions, sizeof(XMFLOAT4) * 3);
 	positions[0] = m_camera.GetPosition();
@@ -476,6 +471,7 @@ void Butterfly::SetLight1()
 //Setup one white positional light at the camera
 //Setup two additional positional lights, green and blue.
 {
+	DrawInstances();
 	XMFLOAT4 positions[3];
 	ZeroMemory(positions, sizeof(XMFLOAT4) * 3);
 	positions[0] = m_camera.GetPosition(); //white light position
@@ -495,7 +491,136 @@ void Butterfly::SetLight1()
 
 void Butterfly::SetSurfaceColor(const XMFLOAT4& color)
 {
-	m_context->UpdateSubresource(m_cbSurfaceColor.get(), 0, 0, &color, 0, 0);
+	m_surfaceColor = color;
+}
+
+unsigned int Butterfly::SetMesh(Mesh mesh)
+{
+	ID3D11Buffer* vb;
+	ID3D11Buffer* ib;
+	unsigned int stride = VB_STRIDE;
+	unsigned int indexCount;
+	switch (mesh)
+	{
+	case MESH_BOX:
+		vb = m_vbBox.get();
+		ib = m_ibBox.get();
+		indexCount = 36;
+		break;
+	case MESH_PENTAGON:
+		vb = m_vbPentagon.get();
+		ib = m_ibPentagon.get();
+		indexCount = 9;
+		break;
+	case MESH_MOEBIUS:
+		vb = m_vbMoebius.get();
+		ib = m_ibMoebius.get();
+		indexCount = 12 * MOEBIUS_N;
+		break;
+	case MESH_WING:
+		vb = m_vbWing.get();
+		ib = m_ibWing.get();
+		indexCount = 12;
+		break;
+	default:
+		vb = m_vbBilboard.get();
+		ib = m_ibBilboard.get();
+		indexCount = 6;
+		stride = sizeof(VertexPos);
+		break;
+	}
+	m_context->IASetVertexBuffers(0, 1, &vb, &stride, &VB_OFFSET);
+	m_context->IASetIndexBuffer(ib, DXGI_FORMAT_R16_UINT, 0);
+	return indexCount;
+}
+
+float Butterfly::MeshRadius(Mesh mesh)
+{
+	switch (mesh)
+	{
+	case MESH_BOX:
+		return 0.5f * sqrtf(3.0f);
+	case MESH_PENTAGON:
+		return 1.0f;
+	case MESH_MOEBIUS:
+		return MOEBIUS_R + MOEBIUS_W;
+	default:
+		//Wing and bilboard are 2x2 squares
+		return sqrtf(2.0f);
+	}
+}
+
+void Butterfly::AddInstance(Mesh mesh, Effect effect, const XMMATRIX& world, const XMFLOAT4& color)
+{
+	if (m_reflectingNode != ReflectionTree::NO_NODE &&
+		!m_reflections.IsReflectionVisible(m_reflectingNode, MirrorVisibility::Transform(world, MeshRadius(mesh))))
+		return;
+	DrawConstants constants;
+	XMStoreFloat4x4(&constants.World, world);
+	constants.SurfaceColor = color;
+	m_batch.Add(mesh, effect, constants);
+}
+
+void Butterfly::DrawInstances()
+//Instances of all the groups are uploaded with one map and bound once, groups select theirs by the start instance
+{
+	if (m_batch.isEmpty())
+		return;
+	m_batch.Build();
+	const vector<DrawConstants>& instances = m_batch.getInstances();
+	unsigned int offset = m_drawConstants->Upload(m_context, instances.data(),
+												  static_cast<unsigned int>(instances.size() * sizeof(DrawConstants)));
+	ID3D11Buffer* b = m_drawConstants->getBuffer();
+	unsigned int stride = sizeof(DrawConstants);
+	m_context->IASetVertexBuffers(DrawConstants::InputSlot, 1, &b, &stride, &offset);
+	Effect effect = EFFECT_LIGHTING;
+	const vector<InstanceBatch::Group>& groups = m_batch.getGroups();
+	for (auto it = groups.begin(); it != groups.end(); ++it)
+	{
+		if (it->Effect != effect)
+		{
+			effect = static_cast<Effect>(it->Effect);
+			if (effect == EFFECT_BILBOARD)
+				SetBilboardShaders();
+			else
+				SetShaders();
+		}
+		unsigned int indexCount = SetMesh(static_cast<Mesh>(it->Mesh));
+		m_context->DrawIndexedInstanced(indexCount, it->InstanceCount, 0, 0, it->FirstInstance);
+	}
+	if (effect != EFFECT_LIGHTING)
+		SetShaders();
+	m_batch.Clear();
+}
+
+void Butterfly::ReportUploadStatistics()
+{
+	if (!m_drawConstants)
+		return;
+	const UploadRing::Statistics& total = m_drawConstants->getRing().getTotalStatistics();
+	const UploadRing::Statistics& frame = m_drawConstants->getRing().getLastFrameStatistics();
+	wstringstream s;
+	s << L"Draw constants uploaded: " << total.BytesUploaded << L" bytes in " << total.Maps << L" maps, "
+	  << total.Discards << L" discards (last frame: " << frame.BytesUploaded << L" bytes in " << frame.Maps
+	  << L" maps)" << endl;
+	const InstanceBatch::Statistics& batches = m_batch.getStatistics();
+	s << L"Instanced draws: " << batches.Draws << L" in " << batches.Groups << L" calls, " << batches.Batches
+	  << L" batches" << endl;
+	OutputDebugStringW(s.str().c_str());
+}
+
+void Butterfly::ReportMirrorStatistics()
+{
+	const ReflectionTree::Statistics& stats = m_reflections.getStatistics();
+	if (stats.Frames == 0)
+		return;
+	double frames = stats.Frames;
+	wstringstream s;
+	s << L"Reflections per frame: " << stats.Nodes / frames << L" (" << stats.SmallNodes / frames
+	  << L" too small, " << stats.OverBudgetNodes / frames << L" over budget), deepest: " << stats.MaxDepth
+	  << L", reflected draws per frame: " << (stats.ReflectedDraws - stats.CulledDraws) / frames << L" ("
+	  << stats.CulledDraws / frames << L" culled)" << endl;
+	OutputDebugStringW(s.str().c_str());
 }
 
 void Butterfly::UpdateBilboards()
@@ -535,101 +660,84 @@ void Butterfly::Update(float dt)
 
 void Butterfly::DrawBox()
 {
-	const XMMATRIX worldMtx = XMMatrixIdentity();
-	m_context->UpdateSubresource(m_cbWorld.get(), 0, 0, &worldMtx, 0, 0);
-
-	ID3D11Buffer* b = m_vbBox.get();
-	m_context->IASetVertexBuffers(0, 1, &b, &VB_STRIDE, &VB_OFFSET);
-	m_context->IASetIndexBuffer(m_ibBox.get(), DXGI_FORMAT_R16_UINT, 0);
-	m_context->DrawIndexed(36, 0, 0);
+	AddInstance(MESH_BOX, EFFECT_LIGHTING, XMMatrixIdentity(), m_surfaceColor);
 }
 
 void Butterfly::DrawDodecahedron(bool colors)
 //Draw dodecahedron. If color is true, use render faces with coresponding colors. Otherwise render using white color
 {
-	ID3D11Buffer* b = m_vbPentagon.get();
-	m_context->IASetVertexBuffers(0, 1, &b, &VB_STRIDE, &VB_OFFSET);
-	m_context->IASetIndexBuffer(m_ibPentagon.get(), DXGI_FORMAT_R16_UINT, 0);
-	for (int i = 0; i < 12; ++i)
+	for (unsigned int i = 0; i < ButterflyScene::FACES; ++i)
 	{
-		if (colors)
-			SetSurfaceColor(COLORS[i]);
-		m_context->UpdateSubresource(m_cbWorld.get(), 0, 0, &m_dodecahedronMtx[i], 0, 0);
-		m_context->DrawIndexed(9, 0, 0);
+		//Faces showing deeper reflections would cover them
+		if (m_reflectingNode != ReflectionTree::NO_NODE && m_reflections.hasChild(m_reflectingNode, i))
+			continue;
+		AddInstance(MESH_PENTAGON, EFFECT_LIGHTING, m_dodecahedronMtx[i],
+					colors ? COLORS[i] : m_surfaceColor);
 	}
-	if (colors)
-		SetSurfaceColor(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f));
 }
 
 void Butterfly::DrawMoebiusStrip()
 //Draw the Moebius strip
 {
-	const XMMATRIX worldMtx = XMMatrixIdentity();
-	m_context->UpdateSubresource(m_cbWorld.get(), 0, 0, &worldMtx, 0, 0);
-
-	ID3D11Buffer* b = m_vbMoebius.get();
-	m_context->IASetVertexBuffers(0, 1, &b, &VB_STRIDE, &VB_OFFSET);
-	m_context->IASetIndexBuffer(m_ibMoebius.get(), DXGI_FORMAT_R16_UINT, 0);
-	m_context->DrawIndexed(12 * MOEBIUS_N, 0, 0);
+	AddInstance(MESH_MOEBIUS, EFFECT_LIGHTING, XMMatrixIdentity(), m_surfaceColor);
 }
 
 void Butterfly::DrawButterfly()
 //Draw the butterfly
 {
-	ID3D11Buffer* b = m_vbWing.get();
-	m_context->IASetVertexBuffers(0, 1, &b, &VB_STRIDE, &VB_OFFSET);
-	m_context->IASetIndexBuffer(m_ibWing.get(), DXGI_FORMAT_R16_UINT, 0);
-
 	for (int i = 0; i < 2; ++i)
-	{
-		m_context->UpdateSubresource(m_cbWorld.get(), 0, 0, &m_wingMtx[i], 0, 0);
-		m_context->DrawIndexed(12, 0, 0);
-	}
+		AddInstance(MESH_WING, EFFECT_LIGHTING, m_wingMtx[i], m_surfaceColor);
 }
 
 void Butterfly::DrawBilboards()
 //Setup bilboards rendering and draw them
 {
-	SetBilboardShaders();
-	unsigned int stride = sizeof(VertexPos);
+	DrawInstances();
 	m_context->OMSetBlendState(m_bsAdd.get(), 0, BS_MASK);
-
-	for (size_t i = 0; i < 3; i++)
-	{
-		const XMMATRIX worldMtx = XMMatrixIdentity() * m_bilboardMtx[i];
-		m_context->UpdateSubresource(m_cbWorld.get(), 0, 0, &worldMtx, 0, 0);
-		SetSurfaceColor(LIGHTCOLORS[i]);
-		ID3D11Buffer* b = m_vbBilboard.get();
-		m_context->IASetVertexBuffers(0, 1, &b, &stride, &VB_OFFSET);
-		m_context->IASetIndexBuffer(m_ibBilboard.get(), DXGI_FORMAT_R16_UINT, 0);
-		m_context->DrawIndexed(6, 0, 0);
-	}
-
+	for (int i = 0; i < 3; ++i)
+		AddInstance(MESH_BILBOARD, EFFECT_BILBOARD, m_bilboardMtx[i], LIGHTCOLORS[i]);
+	DrawInstances();
 	m_context->OMSetBlendState(0, 0, BS_MASK);
-	SetShaders();
 }
 
-void Butterfly::DrawMirroredWorld(int i)
-//Draw the mirrored scene reflected in the i-th dodecahedron face
+void Butterfly::SetReflection(unsigned int depth, const XMMATRIX& reflection)
+{
+	DrawInstances();
+	UpdateCamera(reflection * m_camera.GetViewMatrix());
+	//Each reflection changes the orientation of the faces
+	m_context->RSSetState(depth % 2 ? m_rsCounterClockwise.get() : NULL);
+}
+
+void Butterfly::DrawMirror(unsigned int node)
+//Draw the node's face as seen through its ancestors, inside their region
 {
+	const ReflectionTree::Node& n = m_reflections.getNodes()[node];
 	//Setup render state for writing to the stencil buffer
-	m_context->OMSetDepthStencilState(m_dssWrite.get(), i + 1);
-	//Draw the i-th face
-	m_context->UpdateSubresource(m_cbWorld.get(), 0, 0, &m_dodecahedronMtx[i], 0, 0);
-	ID3D11Buffer* b = m_vbPentagon.get();
-	m_context->IASetVertexBuffers(0, 1, &b, &VB_STRIDE, &VB_OFFSET);
-	m_context->IASetIndexBuffer(m_ibPentagon.get(), DXGI_FORMAT_R16_UINT, 0);
-	m_context->DrawIndexed(9, 0, 0);
+	DrawInstances();
+	m_context->OMSetDepthStencilState(m_dssWrite[n.ParentBits].get(), n.StencilRef);
+	if (n.Parent != ReflectionTree::NO_NODE)
+		SetReflection(n.Depth - 1, XMLoadFloat4x4(&m_reflections.getNodes()[n.Parent].Reflection));
+	AddInstance(MESH_PENTAGON, EFFECT_LIGHTING, m_dodecahedronMtx[n.Mirror], m_surfaceColor);
 
+	//Restore rendering state to it's original values
+	DrawInstances();
+	if (n.Parent != ReflectionTree::NO_NODE)
+		SetReflection(0, XMMatrixIdentity());
+	m_context->OMSetDepthStencilState(NULL, 0);
+}
+
+void Butterfly::DrawMirroredWorld(unsigned int node)
+//Draw the scene reflected in the node's face and the faces of its ancestors
+{
+	PROFILE_ZONE("DrawMirroredWorld");
+	const ReflectionTree::Node& n = m_reflections.getNodes()[node];
 	//Setup render state and view matrix for rendering the mirrored world
-	m_context->OMSetDepthStencilState(m_dssTest.get(), i + 1);
-	XMMATRIX viewMtx;
-	m_camera.GetViewMatrix(viewMtx);
-	XMMATRIX mirrorViewMtx = XMMatrixMultiply(m_mirrorMtx[i], viewMtx);
-	UpdateCamera(mirrorViewMtx);
-	m_context->RSSetState(m_rsCounterClockwise.get());
-
-	//Draw objects
+	DrawInstances();
+	m_context->OMSetDepthStencilState(m_dssTest[n.Bits].get(), n.StencilRef);
+	SetReflection(n.Depth, XMLoadFloat4x4(&n.Reflection));
+
+	//Draw objects, the ones outside of the node's portal are skipped. The strip and the wings go in one batch.
+	m_reflectingNode = node;
 	DrawMoebiusStrip();
 	DrawButterfly();
 	SetLight0();
@@ -637,9 +745,10 @@ void Butterfly::DrawMirroredWorld(int i)
 	SetLight1();
 	m_context->RSSetState(NULL);
 	DrawBilboards();
+	m_reflectingNode = ReflectionTree::NO_NODE;
 
 	//Restore rendering state to it's original values
-	UpdateCamera(viewMtx);
+	SetReflection(0, XMMatrixIdentity());
 	m_context->OMSetDepthStencilState(NULL, 0);
 }
 
@@ -647,6 +756,7 @@ void Butterfly::Render()
 {
 	if (m_context == nullptr)
 		return;
+	m_drawConstants->BeginFrame();
 	//Clear buffers
 	float clearColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
 	m_context->ClearRenderTargetView(m_backBuffer.get(), clearColor);
@@ -657,14 +767,23 @@ void Butterfly::Render()
 	SetSurfaceColor(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f));
 	//DrawBox();
 
-	//render mirrored worlds
-	for (int i = 0; i < 12; ++i)
-		DrawMirroredWorld(i);
+	//render mirrored worlds of the mirrors which can be seen, also in other mirrors
+	SIZE size = getMainWindow()->getClientSize();
+	m_reflections.Build(m_mirrors, m_camera.GetViewMatrix(), m_projMtx, static_cast<float>(size.cx),
+						static_cast<float>(size.cy));
+	const vector<ReflectionTree::Pass>& passes = m_reflections.getPasses();
+	for (auto it = passes.begin(); it != passes.end(); ++it)
+		if (it->Type == ReflectionTree::PASS_STENCIL)
+			DrawMirror(it->Node);
+		else
+			DrawMirroredWorld(it->Node);
 
 	//render dodecahedron with one light and alpha blending
+	DrawInstances();
 	m_context->OMSetBlendState(m_bsAlpha.get(), 0, BS_MASK);
 	SetLight0();
 	DrawDodecahedron(true);
+	DrawInstances();
 	m_context->OMSetBlendState(0, 0, BS_MASK);
 
 	//render the rest of the scene with all lights
@@ -672,6 +791,7 @@ void Butterfly::Render()
 	DrawMoebiusStrip();
 	DrawButterfly();
 	DrawBilboards();
+	DrawInstances();
 
 	m_swapChain->Present(0, 0);
 }
\ No newline at end of file
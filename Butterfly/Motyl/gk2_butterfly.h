@@ -3,23 +3,24 @@
 
 #include "gk2_applicationBase.h"
 #include "gk2_camera.h"
+#include "gk2_uploadBuffer.h"
+#include "gk2_instanceBatch.h"
+#include "gk2_reflectionTree.h"
+#include "gk2_butterflyScene.h"
 #include <xnamath.h>
+#include "gk2_aligned.h"
 
 namespace gk2
 {
-	class Butterfly : public gk2::ApplicationBase
+	//Niektre struktury xnamath.h (np. XMMATRIX czy XMVECTOR) wymagaj, aby adresy zmiennych tych typw byy
+	//wyrwnane do 16 bajtw, a operator new zapewnia tylko wyrwnanie do 8 bajtw. Dlatego klasy zawierajce pola
+	//jednego z tych typw dziedzicz po gk2::AlignedNew.
+	class Butterfly : public gk2::ApplicationBase, public gk2::AlignedNew
 	{
 	public:
 		Butterfly(HINSTANCE hInstance);
 		virtual ~Butterfly();
 
-		//Niektre struktury xnamath.h wymagaj (np. XMMATRIX czy XMVECTOR) wymagaj, aby adresy zmiennych
-		//tych typw byy wyrwnane do 16 bajtw. W przypadku dynamicznej alokacji operator new zapewnia tylko
-		//wyrwnanie do 8 bajtw. Dlatego naley przeciy operator new dla klas, ktre zawieraj
-		//pola jednego z tych typw, aby zapewni odpowiednie wyrwanie pooenia obiektu w pamici.
-		static void* operator new(size_t size);
-		static void operator delete(void* ptr);
-
 	protected:
 		virtual bool LoadContent();
 		virtual void UnloadContent();
@@ -27,12 +28,21 @@ namespace gk2
 		virtual void Update(float dt);
 		virtual void Render();
 	private:
-		//radius of a circle inscribed i dodecahedron face
-		static const float DODECAHEDRON_R;
-		//distance between parallel faces
-		static const float DODECAHEDRON_H;
-		//diheral angle between to neighbouring faces
-		static const float DODECAHEDRON_A;
+		//Ids of the meshes and effects drawn through the instance batch
+		enum Mesh
+		{
+			MESH_BOX,
+			MESH_PENTAGON,
+			MESH_MOEBIUS,
+			MESH_WING,
+			MESH_BILBOARD
+		};
+
+		enum Effect
+		{
+			EFFECT_LIGHTING,
+			EFFECT_BILBOARD
+		};
 
 		//radius of thw Moebius strip
 		static const float MOEBIUS_R;
@@ -56,6 +66,9 @@ namespace gk2
 		static const unsigned int VB_STRIDE;
 		static const unsigned int VB_OFFSET;
 		static const unsigned int BS_MASK;
+		//Size of the buffer the per-draw constants are uploaded to and number of frames the GPU may lag behind
+		static const unsigned int DRAW_CONSTANTS_SIZE;
+		static const unsigned int FRAMES_IN_FLIGHT;
 
 		//Table of colors for dodecahedron's faces
 		static const XMFLOAT4 COLORS[12];
@@ -68,9 +81,7 @@ namespace gk2
 		//Projection matrix
 		XMMATRIX m_projMtx;
 		//Pentagon -> Dodecahedron's i-th face
-		XMMATRIX m_dodecahedronMtx[12];
-		//i-th Mirror -> World
-		XMMATRIX m_mirrorMtx[12];
+		XMMATRIX m_dodecahedronMtx[ButterflyScene::FACES];
 		//Butterfly's wings -> World
 		XMMATRIX m_wingMtx[2];
 		XMMATRIX m_bilboardMtx[3];
@@ -108,19 +119,18 @@ namespace gk2
 		//Bilboard's indexBuffer
 		std::shared_ptr<ID3D11Buffer> m_ibBilboard;
 
-		//Depth stencil state used to fill the stencil buffer
-		std::shared_ptr<ID3D11DepthStencilState> m_dssWrite;
-		//Depth stencil state used to perform stencil test when drawing mirrored scene
-		std::shared_ptr<ID3D11DepthStencilState> m_dssTest;
-		//Rasterizer state used to define front faces as counter-clockwise, used when drawing mirrored scene
+		//Depth stencil states used to fill the stencil buffer inside the region marked with the first i bits
+		std::shared_ptr<ID3D11DepthStencilState> m_dssWrite[ReflectionTree::STENCIL_BITS + 1];
+		//Depth stencil states used to perform stencil test on the first i bits when drawing mirrored scene
+		std::shared_ptr<ID3D11DepthStencilState> m_dssTest[ReflectionTree::STENCIL_BITS + 1];
+		//Rasterizer state used to define front faces as counter-clockwise, used when drawing scenes mirrored odd
+		//number of times
 		std::shared_ptr<ID3D11RasterizerState> m_rsCounterClockwise;
 		//Blend state used to draw dodecahedron faced with alpha blending.
 		std::shared_ptr<ID3D11BlendState> m_bsAlpha;
 		//Blend state used to draw bilboards.
 		std::shared_ptr<ID3D11BlendState> m_bsAdd;
 
-		//Shader's constant buffer containing Local -> World matrix
-		std::shared_ptr<ID3D11Buffer> m_cbWorld;
 		//Shader's constant buffer containing World -> Camera matrix
 		std::shared_ptr<ID3D11Buffer> m_cbView;
 		//Shader's constant buffer containing projection matrix
@@ -129,8 +139,19 @@ namespace gk2
 		std::shared_ptr<ID3D11Buffer> m_cbLightPos;
 		//Shader's constant buffer containting lighting description
 		std::shared_ptr<ID3D11Buffer> m_cbLightColors;
-		//Shader's constant buffer containting surface color
-		std::shared_ptr<ID3D11Buffer> m_cbSurfaceColor;
+		//Local -> World matrices and surface colors of all the draws of a frame
+		std::shared_ptr<gk2::UploadBuffer> m_drawConstants;
+		//Surface color used by the following draws
+		XMFLOAT4 m_surfaceColor;
+		//Draws waiting to be submitted by DrawInstances, which is called before every change of the state they share
+		gk2::InstanceBatch m_batch;
+		//Dodecahedron's faces as mirrors
+		gk2::MirrorVisibility m_mirrors;
+		//Mirrors seen in the current frame, also in other mirrors
+		gk2::ReflectionTree m_reflections;
+		//Node of the reflection tree whose scene is being drawn, AddInstance skips the instances which can't be
+		//seen in it
+		unsigned int m_reflectingNode;
 
 		//Path to the shaders' file
 		static const std::wstring ShaderFile;
@@ -141,6 +162,8 @@ namespace gk2
 		static XMVECTOR MoebiusStripDt(float t, float s);
 		// Return the s-derivative of point on the Moebius strip for parameters t and s
 		static XMVECTOR MoebiusStripDs(float t, float s);
+		// Return the radius of a sphere centered at the mesh's origin which encloses it
+		static float MeshRadius(Mesh mesh);
 
 		//Initializes shaders
 		void InitializeShaders();
@@ -154,7 +177,7 @@ namespace gk2
 		void InitializeBox();
 		//Initializes vertex and index buffer for the pentagon
 		void InitializePentagon();
-		//Initializes matrixes for dodecahedron faces and mirrored scenes
+		//Initializes matrixes for dodecahedron faces and the mirrors
 		void InitializeDodecahedron();
 		//Initializes vertex and index buffers for the Moebius strip
 		void InitializeMoebiusStrip();
@@ -179,8 +202,19 @@ namespace gk2
 		void SetLight0();
 		//Sets up one white positional light at the camera position and two additional lights, green and blue
 		void SetLight1();
-		//Sets the value of the surface color constant buffer
+		//Sets the surface color of the following draws
 		void SetSurfaceColor(const XMFLOAT4& color);
+		//Binds vertex and index buffers of the mesh and returns its index count
+		unsigned int SetMesh(Mesh mesh);
+		//Adds a draw of the mesh to the instance batch
+		void AddInstance(Mesh mesh, Effect effect, const XMMATRIX& world, const XMFLOAT4& color);
+		//Uploads the instances of the batch at once and draws each of its groups with one call. Draw* only add
+		//their instances, the batch is submitted before the lights, view, reflection or output states change.
+		void DrawInstances();
+		//Writes the upload statistics of the last frame to the debugger output
+		void ReportUploadStatistics();
+		//Writes the average numbers of reflection tree nodes and reflected draws per frame to the debugger output
+		void ReportMirrorStatistics();
 
 		//Renders a box
 		void DrawBox();
@@ -192,8 +226,12 @@ namespace gk2
 		void DrawButterfly();
 		//Renders two bilboards 
 		void DrawBilboards();
-		//Renders a mirrored scene
-		void DrawMirroredWorld(int i);
+		//Sets rasterizer state for a scene reflected depth times and view matrix for reflection * view
+		void SetReflection(unsigned int depth, const XMMATRIX& reflection);
+		//Marks the region of a reflection tree node in the stencil buffer
+		void DrawMirror(unsigned int node);
+		//Renders the mirrored scene of a reflection tree node
+		void DrawMirroredWorld(unsigned int node);
 	};
 }
 
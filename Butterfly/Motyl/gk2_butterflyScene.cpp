@@ -0,0 +1,63 @@
+#include "gk2_butterflyScene.h"
+#include <cmath>
+
+using namespace std;
+using namespace gk2;
+
+const float ButterflyScene::DODECAHEDRON_R = sqrtf(0.375f + 0.125f * sqrtf(5.0f));
+const float ButterflyScene::DODECAHEDRON_H = 1.0f + 2.0f * ButterflyScene::DODECAHEDRON_R;
+const float ButterflyScene::DODECAHEDRON_A = XMScalarACos(-0.2f * sqrtf(5.0f));
+const ReflectionTree::Settings ButterflyScene::REFLECTION_SETTINGS = { 3, 256.0f, 32 };
+
+void ButterflyScene::InitializeCamera(Camera& camera)
+{
+	camera.Zoom(5);
+}
+
+XMMATRIX ButterflyScene::ProjectionMatrix(float aspectRatio)
+{
+	return XMMatrixPerspectiveFovLH(XM_PIDIV4, aspectRatio, 0.01f, 100.0f);
+}
+
+XMFLOAT3 ButterflyScene::PentagonPos(int i)
+{
+	float sina, cosa;
+	XMScalarSinCos(&sina, &cosa, -i * XM_2PI / 5.0f);
+	return XMFLOAT3(cosa, sina, 0.0f);
+}
+
+XMMATRIX ButterflyScene::DodecahedronMatrix(unsigned int face)
+{
+	XMMATRIX bottom = XMMatrixRotationX(XM_PIDIV2) * XMMatrixTranslation(0, -DODECAHEDRON_H / 2, 0) *
+					  XMMatrixScaling(2.0f, 2.0f, 2.0f);
+	if (face % 6 == 0)
+		return face == 0 ? bottom : bottom * XMMatrixRotationZ(XM_PI);
+	//Faces 1-5 surround the bottom one, 7-11 are their opposites
+	float a = (face % 6) * XM_2PI / 5.0f;
+	XMMATRIX side =
+		XMMatrixRotationZ(XM_PIDIV2) *
+		XMMatrixTranslation(0, DODECAHEDRON_R, 0) *
+		XMMatrixRotationX(DODECAHEDRON_A - XM_PIDIV2) *
+		XMMatrixTranslation(0, -DODECAHEDRON_H / 2, DODECAHEDRON_R) *
+		XMMatrixRotationY(a - XM_PIDIV2) *
+		XMMatrixScaling(2.0f, 2.0f, 2.0f);
+	return face < 6 ? side : side * XMMatrixRotationZ(XM_PI);
+}
+
+void ButterflyScene::AddMirrors(MirrorVisibility& mirrors)
+{
+	//Mirrored scene is visible through the front faces of the pentagons, where the stencil is written
+	for (unsigned int i = 0; i < FACES; ++i)
+	{
+		XMMATRIX mtx = DodecahedronMatrix(i);
+		XMFLOAT3 vertices[5];
+		for (int j = 0; j < 5; ++j)
+		{
+			vertices[j] = PentagonPos(j);
+			XMStoreFloat3(&vertices[j], XMVector3TransformCoord(XMLoadFloat3(&vertices[j]), mtx));
+		}
+		XMFLOAT3 normal;
+		XMStoreFloat3(&normal, XMVector3TransformNormal(XMVectorSet(0.0f, 0.0f, -1.0f, 0.0f), mtx));
+		mirrors.AddMirror(vertices, 5, normal);
+	}
+}
@@ -0,0 +1,37 @@
+#ifndef __GK2_BUTTERFLY_SCENE_H_
+#define __GK2_BUTTERFLY_SCENE_H_
+
+#include "gk2_camera.h"
+#include "gk2_reflectionTree.h"
+#include <xnamath.h>
+
+namespace gk2
+{
+	//Layout of the mirrored dodecahedron, without the device. Butterfly draws it with Direct3D and the headless
+	//build checks the reflection trees of its faces.
+	class ButterflyScene
+	{
+	public:
+		static const unsigned int FACES = 12;
+		//radius of a circle inscribed i dodecahedron face
+		static const float DODECAHEDRON_R;
+		//distance between parallel faces
+		static const float DODECAHEDRON_H;
+		//diheral angle between to neighbouring faces
+		static const float DODECAHEDRON_A;
+		//Depth, smallest portal in pixels and number of the mirrors seen in other mirrors
+		static const gk2::ReflectionTree::Settings REFLECTION_SETTINGS;
+
+		static void InitializeCamera(gk2::Camera& camera);
+		static XMMATRIX ProjectionMatrix(float aspectRatio);
+
+		//Vertices go clockwise when seen from the front side, i.e. from -z
+		static XMFLOAT3 PentagonPos(int i);
+		//World matrix of the face's pentagon
+		static XMMATRIX DodecahedronMatrix(unsigned int face);
+		//Adds the faces as mirrors, the face's index is the mirror's index
+		static void AddMirrors(gk2::MirrorVisibility& mirrors);
+	};
+}
+
+#endif __GK2_BUTTERFLY_SCENE_H_
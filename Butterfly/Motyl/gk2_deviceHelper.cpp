@@ -1,20 +1,123 @@
 #include "gk2_deviceHelper.h"
 #include "gk2_utils.h"
 #include "gk2_exceptions.h"
+#include <cstring>
+#include <list>
+#include <map>
 
 using namespace std;
 using namespace gk2;
 
+namespace
+{
+	wstring Directory(const wstring& file)
+	{
+		size_t separator = file.find_last_of(L"/\\");
+		return separator == wstring::npos ? wstring() : file.substr(0, separator + 1);
+	}
+
+	//Opens included files relative to the including file and records their paths
+	class ShaderIncludeHandler : public ID3DInclude
+	{
+	public:
+		ShaderIncludeHandler(const wstring& file) : m_directory(Directory(file)) { }
+
+		STDMETHOD(Open)(D3D_INCLUDE_TYPE includeType, LPCSTR fileName, LPCVOID parentData, LPCVOID* data, UINT* bytes)
+		{
+			UNREFERENCED_PARAMETER(includeType);
+			auto parent = m_paths.find(parentData);
+			wstring path = (parent != m_paths.end() ? Directory(parent->second) : m_directory) +
+						   wstring(fileName, fileName + strlen(fileName));
+			m_contents.push_back(vector<BYTE>());
+			vector<BYTE>& contents = m_contents.back();
+			if (!AssetCache::ReadFile(path, contents))
+			{
+				m_contents.pop_back();
+				return E_FAIL;
+			}
+			//Terminating zero keeps buffers of empty files distinct from the null pointer of the main file
+			contents.push_back(0);
+			m_paths[contents.data()] = path;
+			m_includes.push_back(path);
+			*data = contents.data();
+			*bytes = static_cast<UINT>(contents.size() - 1);
+			return S_OK;
+		}
+
+		//Buffers are released together with the handler
+		STDMETHOD(Close)(LPCVOID data) { UNREFERENCED_PARAMETER(data); return S_OK; }
+
+		const vector<wstring>& getIncludes() const { return m_includes; }
+
+	private:
+		wstring m_directory;
+		list<vector<BYTE>> m_contents;
+		map<LPCVOID, wstring> m_paths;
+		vector<wstring> m_includes;
+	};
+}
+
 
 shared_ptr<ID3DBlob> DeviceHelper::CompileD3DShader(const wstring& filePath, const string& entry, const string& shaderModel)
+{
+	if (m_shaderCache)
+	{
+		ShaderDesc desc;
+		desc.File = filePath;
+		desc.Entry = entry;
+		desc.Model = shaderModel;
+		vector<BYTE> byteCode = m_shaderCache->Get(desc);
+		ID3DBlob* b;
+		HRESULT result = D3DCreateBlob(byteCode.size(), &b);
+		shared_ptr<ID3DBlob> buffer(b, Utils::COMRelease);
+		if (FAILED(result))
+			THROW_DX11(result);
+		memcpy(buffer->GetBufferPointer(), byteCode.data(), byteCode.size());
+		return buffer;
+	}
+	DWORD shaderFlags = ShaderCompileFlags();
+	ID3DBlob* eb = nullptr, *b = nullptr;
+	HRESULT result = D3DX11CompileFromFileW(filePath.c_str(), 0, 0, entry.c_str(), shaderModel.c_str(), shaderFlags,
+		0, 0, &b, &eb, 0);
+	shared_ptr<ID3DBlob> errorBuffer(eb, Utils::COMRelease);
+	shared_ptr<ID3DBlob> buffer(b, Utils::COMRelease);
+	if (FAILED(result))
+	{
+		if (errorBuffer)
+		{
+			char* msg = reinterpret_cast<char*>(errorBuffer->GetBufferPointer());
+			OutputDebugStringA(msg);
+		}
+		THROW_DX11(result);
+	}
+	return buffer;
+}
+
+unsigned int DeviceHelper::ShaderCompileFlags()
 {
 	DWORD shaderFlags = D3DCOMPILE_ENABLE_STRICTNESS;
 #if defined( DEBUG ) || defined( _DEBUG )
 	shaderFlags |= D3DCOMPILE_DEBUG;
 #endif
+	return shaderFlags;
+}
+
+void DeviceHelper::CompileShader(const ShaderDesc& desc, const vector<BYTE>& source, vector<BYTE>& byteCode,
+								 vector<wstring>& includes)
+{
+	vector<D3D_SHADER_MACRO> defines;
+	for (auto it = desc.Defines.begin(); it != desc.Defines.end(); ++it)
+	{
+		D3D_SHADER_MACRO define = { it->first.c_str(), it->second.c_str() };
+		defines.push_back(define);
+	}
+	D3D_SHADER_MACRO end = { nullptr, nullptr };
+	defines.push_back(end);
+	ShaderIncludeHandler includeHandler(desc.File);
+	string sourceName(desc.File.begin(), desc.File.end());
 	ID3DBlob* eb = nullptr, *b = nullptr;
-	HRESULT result = D3DX11CompileFromFileW(filePath.c_str(), 0, 0, entry.c_str(), shaderModel.c_str(), shaderFlags,
-		0, 0, &b, &eb, 0);
+	HRESULT result = D3DCompile(source.data(), source.size(), sourceName.c_str(), defines.data(), &includeHandler,
+								desc.Entry.c_str(), desc.Model.c_str(), ShaderCompileFlags(), 0, &b, &eb);
 	shared_ptr<ID3DBlob> errorBuffer(eb, Utils::COMRelease);
 	shared_ptr<ID3DBlob> buffer(b, Utils::COMRelease);
 	if (FAILED(result))
@@ -26,7 +129,9 @@ shared_ptr<ID3DBlob> DeviceHelper::CompileD3DShader(const wstring& filePath, con
 		}
 		THROW_DX11(result);
 	}
-	return buffer;
+	const BYTE* data = reinterpret_cast<const BYTE*>(buffer->GetBufferPointer());
+	byteCode.assign(data, data + buffer->GetBufferSize());
+	includes = includeHandler.getIncludes();
 }
 
 shared_ptr<ID3D11VertexShader> DeviceHelper::CreateVertexShader(shared_ptr<ID3DBlob> byteCode)
@@ -7,6 +7,7 @@
 #include <string>
 #include <vector>
 #include <D3Dcompiler.h>
+#include "gk2_shaderCache.h"
 
 namespace gk2
 {
@@ -14,9 +15,16 @@ namespace gk2
 	{
 	public:
 		std::shared_ptr<ID3D11Device> m_deviceObject;
+		//When set, compiled shaders are looked up in and stored to the cache
+		std::shared_ptr<gk2::ShaderCache> m_shaderCache;
 
 		std::shared_ptr<ID3DBlob> CompileD3DShader(const std::wstring& filePath, const std::string&  entry,
 												   const std::string&  shaderModel);
+		//Flags used to compile shaders in the current configuration
+		static unsigned int ShaderCompileFlags();
+		//gk2::ShaderCompiler based on D3DCompile, doesn't need a device
+		static void CompileShader(const gk2::ShaderDesc& desc, const std::vector<BYTE>& source,
+								  std::vector<BYTE>& byteCode, std::vector<std::wstring>& includes);
 		std::shared_ptr<ID3D11VertexShader> CreateVertexShader(std::shared_ptr<ID3DBlob> byteCode);
 		std::shared_ptr<ID3D11PixelShader> CreatePixelShader(std::shared_ptr<ID3DBlob> byteCode);
 		std::shared_ptr<ID3D11InputLayout> CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC* layout,
@@ -0,0 +1,151 @@
+#include "gk2_fileSystem.h"
+#include <fstream>
+#include <sstream>
+#ifndef _WIN32
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace gk2;
+
+namespace
+{
+#ifdef _WIN32
+	typedef wstring NativePath;
+
+	const NativePath& ToNative(const wstring& path)
+	{
+		return path;
+	}
+
+	wstring TempFileName(const wstring& path)
+	{
+		wostringstream tmpPath;
+		tmpPath << path << L'.' << GetCurrentProcessId() << L'.' << GetCurrentThreadId() << L".tmp";
+		return tmpPath.str();
+	}
+#else
+	typedef string NativePath;
+
+	//UTF-8, wchar_t holds whole code points
+	string ToNative(const wstring& path)
+	{
+		string s;
+		for (auto it = path.begin(); it != path.end(); ++it)
+		{
+			unsigned long c = static_cast<unsigned long>(*it);
+			if (c < 0x80)
+				s += static_cast<char>(c);
+			else if (c < 0x800)
+			{
+				s += static_cast<char>(0xC0 | (c >> 6));
+				s += static_cast<char>(0x80 | (c & 0x3F));
+			}
+			else if (c < 0x10000)
+			{
+				s += static_cast<char>(0xE0 | (c >> 12));
+				s += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+				s += static_cast<char>(0x80 | (c & 0x3F));
+			}
+			else
+			{
+				s += static_cast<char>(0xF0 | (c >> 18));
+				s += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+				s += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+				s += static_cast<char>(0x80 | (c & 0x3F));
+			}
+		}
+		return s;
+	}
+
+	string TempFileName(const wstring& path)
+	{
+		ostringstream tmpPath;
+		tmpPath << ToNative(path) << '.' << getpid() << '.' << hash<thread::id>()(this_thread::get_id()) << ".tmp";
+		return tmpPath.str();
+	}
+#endif
+}
+
+bool NativeFileSystem::ReadFile(const wstring& fileName, vector<BYTE>& data) const
+{
+	ifstream input(ToNative(fileName), ios::binary);
+	if (!input)
+		return false;
+	input.seekg(0, ios::end);
+	data.resize(static_cast<size_t>(input.tellg()));
+	input.seekg(0, ios::beg);
+	if (!data.empty())
+		input.read(reinterpret_cast<char*>(data.data()), data.size());
+	return !input.fail();
+}
+
+bool NativeFileSystem::WriteFile(const wstring& fileName, const vector<BYTE>& data) const
+{
+	//Data is written to a temporary file and moved in place, so other processes never see a partially written file
+	NativePath tmpPath = TempFileName(fileName);
+	{
+		ofstream output(tmpPath, ios::binary | ios::trunc);
+		if (!output)
+			return false;
+		if (!data.empty())
+			output.write(reinterpret_cast<const char*>(data.data()), data.size());
+		if (!output)
+		{
+			output.close();
+#ifdef _WIN32
+			DeleteFileW(tmpPath.c_str());
+#else
+			remove(tmpPath.c_str());
+#endif
+			return false;
+		}
+	}
+#ifdef _WIN32
+	if (!MoveFileExW(tmpPath.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		DeleteFileW(tmpPath.c_str());
+		return false;
+	}
+#else
+	if (rename(tmpPath.c_str(), ToNative(fileName).c_str()) != 0)
+	{
+		remove(tmpPath.c_str());
+		return false;
+	}
+#endif
+	return true;
+}
+
+bool NativeFileSystem::MakeDirectory(const wstring& directory) const
+{
+#ifdef _WIN32
+	return CreateDirectoryW(directory.c_str(), nullptr) || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+	return mkdir(ToNative(directory).c_str(), 0777) == 0 || errno == EEXIST;
+#endif
+}
+
+wstring NativeFileSystem::TempDirectory() const
+{
+#ifdef _WIN32
+	wchar_t tempPath[MAX_PATH];
+	DWORD length = GetTempPathW(MAX_PATH, tempPath);
+	if (length == 0 || length > MAX_PATH)
+		return wstring();
+	return wstring(tempPath, length);
+#else
+	const char* tempPath = getenv("TMPDIR");
+	string path = tempPath && *tempPath ? tempPath : "/tmp";
+	if (*path.rbegin() != '/')
+		path += '/';
+	//Only the ASCII paths are expected here
+	return wstring(path.begin(), path.end());
+#endif
+}
@@ -2,8 +2,8 @@
 #define __GK2_INPUT_H_
 
 #include <dinput.h>
-#include <cassert>
 #include <memory>
+#include "gk2_inputState.h"
 #include "gk2_utils.h"
 #include "gk2_exceptions.h"
 
@@ -11,109 +11,6 @@ namespace gk2
 {
 	class ApplicationBase;
 
-	struct KeyboardState
-	{
-	public:
-		static const unsigned int STATE_TAB_LENGTH = 256;
-		static const BYTE KEY_MASK = 0x80;
-
-		BYTE m_keys[STATE_TAB_LENGTH];
-
-		KeyboardState()
-		{
-			ZeroMemory(m_keys, STATE_TAB_LENGTH*sizeof(char));
-		}
-
-		KeyboardState(const KeyboardState& other)
-		{
-			memcpy(m_keys, other.m_keys, STATE_TAB_LENGTH*sizeof(char));
-		}
-
-		KeyboardState& operator=(const KeyboardState& other)
-		{
-			memcpy(m_keys, other.m_keys, STATE_TAB_LENGTH*sizeof(char));
-			return *this;
-		}
-
-		inline bool isKeyDown(BYTE keyCode) const
-		{
-			return 0 != (m_keys[keyCode] & KEY_MASK);
-		}
-
-		inline bool isKeyUp(BYTE keyCode) const
-		{
-			return 0 == (m_keys[keyCode] & KEY_MASK);
-		}
-
-		bool operator[](BYTE keyCode) const
-		{
-			return 0 != (m_keys[keyCode] & KEY_MASK);
-		}
-	};
-
-	struct MouseState
-	{
-	public:
-
-		enum Buttons
-		{
-			Left = 0,
-			Right = 1,
-			Middle = 2
-		};
-
-		static const BYTE BUTTON_MASK = 0x80;
-
-		DIMOUSESTATE m_state;
-
-		MouseState()
-		{
-			ZeroMemory(&m_state, sizeof(DIMOUSESTATE));
-		}
-
-		MouseState(const MouseState& other)
-		{
-			memcpy(&m_state, &other.m_state, sizeof(DIMOUSESTATE));
-		}
-
-		MouseState& operator=(const MouseState& other)
-		{
-			memcpy(&m_state, &other.m_state, sizeof(DIMOUSESTATE));
-			return *this;
-		}
-
-		POINT getMousePositionChange() const
-		{
-			POINT r;
-			r.x = m_state.lX;
-			r.y = m_state.lY;
-			return r;
-		}
-
-		inline LONG getWheelPositionChange() const
-		{
-			return m_state.lZ;
-		}
-
-		inline bool isButtonDown(BYTE button) const
-		{
-			assert(button < 4);
-			return 0 != (m_state.rgbButtons[button] & BUTTON_MASK);
-		}
-
-		inline bool isButtonUp(BYTE button) const
-		{
-			assert(button < 4);
-			return 0 == (m_state.rgbButtons[button] & BUTTON_MASK);
-		}
-
-		bool operator[](BYTE button)
-		{
-			assert(button < 4);
-			return 0 != (m_state.rgbButtons[button] & BUTTON_MASK);
-		}
-	};
-
 	template<typename TState>
 	class DeviceBase
 	{
@@ -121,9 +18,20 @@ namespace gk2
 		static const unsigned int GET_STATE_RETRIES = 2;
 		static const unsigned int AQUIRE_RETRIES = 2;
 
+		//Until Release, GetState returns the given state instead of reading the device. Used to replay captured
+		//input and to give every read during a recorded frame the state which was recorded.
+		void Hold(const TState& state, bool valid)
+		{
+			m_held = true;
+			m_heldState = state;
+			m_heldValid = valid;
+		}
+
+		void Release() { m_held = false; }
+
 	protected:
 		DeviceBase(std::shared_ptr<IDirectInputDevice8W> device)
-			: m_device(device)
+			: m_device(device), m_held(false), m_heldValid(false)
 		{ }
 
 		bool GetState(unsigned int size, void* ptr)
@@ -150,6 +58,9 @@ namespace gk2
 		}
 
 		std::shared_ptr<IDirectInputDevice8W> m_device;
+		bool m_held;
+		TState m_heldState;
+		bool m_heldValid;
 	};
 
 	class Keyboard : public gk2::DeviceBase<gk2::KeyboardState>
@@ -0,0 +1,56 @@
+#include "gk2_instanceBatch.h"
+
+using namespace std;
+using namespace gk2;
+
+InstanceBatch::InstanceBatch()
+{
+	m_statistics.Draws = m_statistics.Groups = m_statistics.Batches = 0;
+}
+
+void InstanceBatch::Clear()
+{
+	m_draws.clear();
+	m_instances.clear();
+	m_groups.clear();
+}
+
+void InstanceBatch::Add(unsigned int mesh, unsigned int effect, const DrawConstants& constants)
+{
+	Draw d;
+	d.Mesh = mesh;
+	d.Effect = effect;
+	d.Constants = constants;
+	//Batches are small, a linear search of the groups is cheaper than a map
+	unsigned int g = 0;
+	for (; g < m_groups.size(); ++g)
+		if (m_groups[g].Mesh == mesh && m_groups[g].Effect == effect)
+			break;
+	if (g == m_groups.size())
+	{
+		Group group = { mesh, effect, 0, 0 };
+		m_groups.push_back(group);
+	}
+	++m_groups[g].InstanceCount;
+	d.Group = g;
+	m_draws.push_back(d);
+}
+
+void InstanceBatch::Build()
+{
+	unsigned int first = 0;
+	for (auto it = m_groups.begin(); it != m_groups.end(); ++it)
+	{
+		it->FirstInstance = first;
+		first += it->InstanceCount;
+	}
+	m_instances.resize(m_draws.size());
+	vector<unsigned int> next(m_groups.size());
+	for (unsigned int g = 0; g < m_groups.size(); ++g)
+		next[g] = m_groups[g].FirstInstance;
+	for (auto it = m_draws.begin(); it != m_draws.end(); ++it)
+		m_instances[next[it->Group]++] = it->Constants;
+	m_statistics.Draws += m_draws.size();
+	m_statistics.Groups += m_groups.size();
+	++m_statistics.Batches;
+}
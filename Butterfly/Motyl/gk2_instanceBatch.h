@@ -0,0 +1,62 @@
+#ifndef __GK2_INSTANCE_BATCH_H_
+#define __GK2_INSTANCE_BATCH_H_
+
+#include <vector>
+#include "gk2_vertices.h"
+
+namespace gk2
+{
+	//Collects draws of meshes which differ only in their gk2::DrawConstants and groups the ones using the same
+	//mesh and effect, so that each group can be drawn with one instanced call. Meshes and effects are identified
+	//by the caller's ids.
+	class InstanceBatch
+	{
+	public:
+		struct Group
+		{
+			unsigned int Mesh;
+			unsigned int Effect;
+			//Range of the group's instances in getInstances()
+			unsigned int FirstInstance;
+			unsigned int InstanceCount;
+		};
+
+		//Totals of all the built batches
+		struct Statistics
+		{
+			unsigned long long Draws;
+			unsigned long long Groups;
+			unsigned long long Batches;
+		};
+
+		InstanceBatch();
+
+		bool isEmpty() const { return m_draws.empty(); }
+		//Valid after Build
+		const std::vector<gk2::DrawConstants>& getInstances() const { return m_instances; }
+		const std::vector<Group>& getGroups() const { return m_groups; }
+		const Statistics& getStatistics() const { return m_statistics; }
+
+		void Clear();
+		void Add(unsigned int mesh, unsigned int effect, const gk2::DrawConstants& constants);
+		//Packs the instances of each group next to each other. Groups are ordered by their first draw and
+		//instances within a group keep the order they were added in, so blended draws stay in order.
+		void Build();
+
+	private:
+		struct Draw
+		{
+			unsigned int Mesh;
+			unsigned int Effect;
+			unsigned int Group;
+			gk2::DrawConstants Constants;
+		};
+
+		std::vector<Draw> m_draws;
+		std::vector<gk2::DrawConstants> m_instances;
+		std::vector<Group> m_groups;
+		Statistics m_statistics;
+	};
+}
+
+#endif __GK2_INSTANCE_BATCH_H_
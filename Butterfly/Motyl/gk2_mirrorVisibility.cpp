@@ -0,0 +1,135 @@
+#include "gk2_mirrorVisibility.h"
+#include <algorithm>
+#include <cfloat>
+
+using namespace std;
+using namespace gk2;
+
+namespace
+{
+	//Vertices closer to the eye plane than this are treated as crossing it
+	const float MIN_W = 1e-4f;
+
+	XMFLOAT4 NormalizePlane(XMVECTOR p)
+	{
+		XMFLOAT4 plane;
+		XMStoreFloat4(&plane, p / XMVectorGetX(XMVector3Length(p)));
+		return plane;
+	}
+
+	float Distance(const XMFLOAT4& plane, const XMFLOAT3& p)
+	{
+		return plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w;
+	}
+
+	//Planes of the part of the view frustum seen through the screen rectangle, near plane included
+	void RectanglePlanes(const XMMATRIX& viewProj, float l, float r, float b, float t, XMFLOAT4* planes)
+	{
+		//Columns of viewProj give x, y, z and w of a point in clip space
+		XMMATRIX columns = XMMatrixTranspose(viewProj);
+		planes[0] = NormalizePlane(columns.r[0] - l * columns.r[3]);
+		planes[1] = NormalizePlane(r * columns.r[3] - columns.r[0]);
+		planes[2] = NormalizePlane(columns.r[1] - b * columns.r[3]);
+		planes[3] = NormalizePlane(t * columns.r[3] - columns.r[1]);
+		planes[4] = NormalizePlane(columns.r[2]);
+	}
+}
+
+unsigned int MirrorVisibility::AddMirror(const XMFLOAT3* vertices, unsigned int count, const XMFLOAT3& normal)
+{
+	Mirror m;
+	m.Vertices.assign(vertices, vertices + count);
+	XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&normal));
+	XMStoreFloat3(&m.Normal, n);
+	//p' = p - 2 (n.p + d) n
+	float d = -XMVectorGetX(XMVector3Dot(n, XMLoadFloat3(&vertices[0])));
+	float c[3] = { m.Normal.x, m.Normal.y, m.Normal.z };
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+			m.Reflection.m[i][j] = (i == j ? 1.0f : 0.0f) - 2.0f * c[i] * c[j];
+		m.Reflection.m[i][3] = 0.0f;
+		m.Reflection.m[3][i] = -2.0f * d * c[i];
+	}
+	m.Reflection.m[3][3] = 1.0f;
+	m_mirrors.push_back(m);
+	return static_cast<unsigned int>(m_mirrors.size() - 1);
+}
+
+MirrorVisibility::Sphere MirrorVisibility::Transform(const XMMATRIX& mtx, float localRadius)
+{
+	Sphere s;
+	XMStoreFloat3(&s.Center, mtx.r[3]);
+	float scale = max(XMVectorGetX(XMVector3Length(mtx.r[0])), max(XMVectorGetX(XMVector3Length(mtx.r[1])),
+																	 XMVectorGetX(XMVector3Length(mtx.r[2]))));
+	s.Radius = localRadius * scale;
+	return s;
+}
+
+MirrorVisibility::Portal MirrorVisibility::ViewPortal(const XMMATRIX& viewProj)
+{
+	Portal p;
+	p.Left = p.Bottom = -1.0f;
+	p.Right = p.Top = 1.0f;
+	RectanglePlanes(viewProj, p.Left, p.Right, p.Bottom, p.Top, p.Planes);
+	XMMATRIX columns = XMMatrixTranspose(viewProj);
+	p.Planes[5] = NormalizePlane(columns.r[3] - columns.r[2]);
+	return p;
+}
+
+bool MirrorVisibility::FindPortal(unsigned int mirror, const XMMATRIX& reflection, const XMFLOAT3& eye,
+								  const XMMATRIX& viewProj, const Portal& parent, Portal& portal) const
+{
+	const Mirror& m = m_mirrors[mirror];
+	vector<XMFLOAT3> vertices(m.Vertices.size());
+	for (unsigned int i = 0; i < vertices.size(); ++i)
+		XMStoreFloat3(&vertices[i], XMVector3TransformCoord(XMLoadFloat3(&m.Vertices[i]), reflection));
+	XMFLOAT3 normal;
+	XMStoreFloat3(&normal, XMVector3TransformNormal(XMLoadFloat3(&m.Normal), reflection));
+	XMFLOAT4 plane(normal.x, normal.y, normal.z,
+				   -(normal.x * vertices[0].x + normal.y * vertices[0].y + normal.z * vertices[0].z));
+	if (Distance(plane, eye) <= 0.0f)
+		return false;
+	//Polygon is outside if all of its vertices are outside of one of the parent's planes
+	for (unsigned int i = 0; i < PORTAL_PLANES; ++i)
+	{
+		bool outside = true;
+		for (auto it = vertices.begin(); it != vertices.end() && outside; ++it)
+			outside = Distance(parent.Planes[i], *it) < 0.0f;
+		if (outside)
+			return false;
+	}
+	bool crossesEye = false;
+	XMFLOAT2 rectMin(FLT_MAX, FLT_MAX), rectMax(-FLT_MAX, -FLT_MAX);
+	for (auto it = vertices.begin(); it != vertices.end(); ++it)
+	{
+		XMFLOAT4 c;
+		XMStoreFloat4(&c, XMVector4Transform(XMVectorSet(it->x, it->y, it->z, 1.0f), viewProj));
+		if (c.w < MIN_W)
+		{
+			crossesEye = true;
+			break;
+		}
+		rectMin = XMFLOAT2(min(rectMin.x, c.x / c.w), min(rectMin.y, c.y / c.w));
+		rectMax = XMFLOAT2(max(rectMax.x, c.x / c.w), max(rectMax.y, c.y / c.w));
+	}
+	//Projection of a polygon crossing the eye plane isn't bounded, the parent's rectangle is used then
+	portal.Left = crossesEye ? parent.Left : max(rectMin.x, parent.Left);
+	portal.Right = crossesEye ? parent.Right : min(rectMax.x, parent.Right);
+	portal.Bottom = crossesEye ? parent.Bottom : max(rectMin.y, parent.Bottom);
+	portal.Top = crossesEye ? parent.Top : min(rectMax.y, parent.Top);
+	if (portal.Left >= portal.Right || portal.Bottom >= portal.Top)
+		return false;
+	RectanglePlanes(viewProj, portal.Left, portal.Right, portal.Bottom, portal.Top, portal.Planes);
+	//Reflections are seen behind the mirror
+	portal.Planes[5] = NormalizePlane(-XMLoadFloat4(&plane));
+	return true;
+}
+
+bool MirrorVisibility::Intersects(const Portal& portal, const Sphere& sphere)
+{
+	for (unsigned int i = 0; i < PORTAL_PLANES; ++i)
+		if (Distance(portal.Planes[i], sphere.Center) < -sphere.Radius)
+			return false;
+	return true;
+}
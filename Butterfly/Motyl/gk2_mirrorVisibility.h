@@ -0,0 +1,65 @@
+#ifndef __GK2_MIRROR_VISIBILITY_H_
+#define __GK2_MIRROR_VISIBILITY_H_
+
+#include <d3d11.h>
+#include <xnamath.h>
+#include <vector>
+
+namespace gk2
+{
+	//Planar mirrors and their portals. A mirror, possibly seen through other mirrors, is visible if the camera is on
+	//its reflecting side and its polygon isn't outside of the parent portal. Its portal frustum is bounded by the
+	//screen rectangle of its polygon, the near plane and the mirror plane. Reflections of the objects outside of it
+	//can't pass the stencil test and aren't drawn.
+	class MirrorVisibility
+	{
+	public:
+		//Left, right, bottom, top, near and the mirror plane (the far plane for the view frustum)
+		static const unsigned int PORTAL_PLANES = 6;
+
+		struct Sphere
+		{
+			XMFLOAT3 Center;
+			float Radius;
+		};
+
+		struct Portal
+		{
+			//Screen rectangle in normalized device coordinates
+			float Left;
+			float Right;
+			float Bottom;
+			float Top;
+			//Normalized planes in world space, positive inside
+			XMFLOAT4 Planes[PORTAL_PLANES];
+		};
+
+		//Vertices of a convex polygon in world space, normal points to the reflecting side
+		unsigned int AddMirror(const XMFLOAT3* vertices, unsigned int count, const XMFLOAT3& normal);
+		unsigned int getMirrorsCount() const { return static_cast<unsigned int>(m_mirrors.size()); }
+		//Reflection through the mirror's plane in the row vector convention
+		const XMFLOAT4X4& getReflection(unsigned int mirror) const { return m_mirrors[mirror].Reflection; }
+
+		//Portal of the whole view frustum
+		static Portal ViewPortal(const XMMATRIX& viewProj);
+		//Finds the portal of the mirror transformed by reflection, i.e. the mirror seen in another mirror, inside
+		//the parent portal. Returns false if the mirror can't be seen through the parent portal.
+		bool FindPortal(unsigned int mirror, const XMMATRIX& reflection, const XMFLOAT3& eye, const XMMATRIX& viewProj,
+						const Portal& parent, Portal& portal) const;
+		static bool Intersects(const Portal& portal, const Sphere& sphere);
+		//Sphere enclosing the local sphere transformed by mtx
+		static Sphere Transform(const XMMATRIX& mtx, float localRadius);
+
+	private:
+		struct Mirror
+		{
+			std::vector<XMFLOAT3> Vertices;
+			XMFLOAT3 Normal;
+			XMFLOAT4X4 Reflection;
+		};
+
+		std::vector<Mirror> m_mirrors;
+	};
+}
+
+#endif __GK2_MIRROR_VISIBILITY_H_
@@ -0,0 +1,147 @@
+#include "gk2_reflectionTree.h"
+#include <algorithm>
+
+using namespace std;
+using namespace gk2;
+
+ReflectionTree::ReflectionTree(const Settings& settings)
+	: m_settings(settings)
+{
+	Statistics zero = { };
+	m_statistics = zero;
+}
+
+void ReflectionTree::Build(const MirrorVisibility& mirrors, const XMMATRIX& view, const XMMATRIX& proj, float width,
+						   float height)
+{
+	m_nodes.clear();
+	m_roots.clear();
+	m_passes.clear();
+	XMVECTOR det;
+	XMFLOAT3 eye;
+	XMStoreFloat3(&eye, XMMatrixInverse(&det, view).r[3]);
+	XMMATRIX viewProj = view * proj;
+	MirrorVisibility::Portal frustum = MirrorVisibility::ViewPortal(viewProj);
+	//Parents of the current level, NO_NODE stands for the camera
+	vector<unsigned int> parents(1, static_cast<unsigned int>(NO_NODE));
+	unsigned int shift = 0;
+	for (unsigned int depth = 1; depth <= m_settings.MaxDepth && !parents.empty() && shift < STENCIL_BITS; ++depth)
+	{
+		m_candidates.clear();
+		for (auto p = parents.begin(); p != parents.end(); ++p)
+		{
+			XMMATRIX reflection = *p == NO_NODE ? XMMatrixIdentity() : XMLoadFloat4x4(&m_nodes[*p].Reflection);
+			const MirrorVisibility::Portal& portal = *p == NO_NODE ? frustum : m_nodes[*p].Frustum;
+			for (unsigned int m = 0; m < mirrors.getMirrorsCount(); ++m)
+			{
+				//A plane mirror can't see itself
+				if (*p != NO_NODE && m_nodes[*p].Mirror == m)
+					continue;
+				Candidate c;
+				c.Parent = *p;
+				c.Mirror = m;
+				if (!mirrors.FindPortal(m, reflection, eye, viewProj, portal, c.Frustum))
+					continue;
+				c.Area = (c.Frustum.Right - c.Frustum.Left) * (c.Frustum.Top - c.Frustum.Bottom) * 0.25f *
+						 width * height;
+				if (c.Area < m_settings.MinArea)
+				{
+					++m_statistics.SmallNodes;
+					continue;
+				}
+				m_candidates.push_back(c);
+			}
+		}
+		stable_sort(m_candidates.begin(), m_candidates.end(),
+					[](const Candidate& a, const Candidate& b) { return a.Area > b.Area; });
+		//Every deeper level keeps at least one stencil bit and its share of the nodes which are left, otherwise
+		//the larger portals of this level would take all of them
+		unsigned int levelsLeft = m_settings.MaxDepth - depth;
+		unsigned int levelBits = STENCIL_BITS - shift > levelsLeft ? STENCIL_BITS - shift - levelsLeft : 1;
+		unsigned int first = static_cast<unsigned int>(m_nodes.size());
+		unsigned int nodesLeft = m_settings.MaxNodes > first ? m_settings.MaxNodes - first : 0;
+		unsigned int maxNodes = first + (nodesLeft + levelsLeft) / (levelsLeft + 1);
+		//Children are numbered from 1, 0 is left for the parent's region
+		unsigned int maxChildren = (1 << levelBits) - 1;
+		unsigned int mostChildren = 0;
+		for (auto c = m_candidates.begin(); c != m_candidates.end(); ++c)
+		{
+			vector<unsigned int>& siblings = c->Parent == NO_NODE ? m_roots : m_nodes[c->Parent].Children;
+			if (m_nodes.size() >= maxNodes || siblings.size() >= maxChildren)
+			{
+				++m_statistics.OverBudgetNodes;
+				continue;
+			}
+			siblings.push_back(static_cast<unsigned int>(m_nodes.size()));
+			mostChildren = max(mostChildren, static_cast<unsigned int>(siblings.size()));
+			Node n;
+			n.Mirror = c->Mirror;
+			n.Depth = depth;
+			n.Parent = c->Parent;
+			n.StencilRef = (c->Parent == NO_NODE ? 0 : m_nodes[c->Parent].StencilRef) |
+						   static_cast<unsigned int>(siblings.size()) << shift;
+			n.ParentBits = shift;
+			//Known when the whole level is built
+			n.Bits = shift;
+			//Image of the world reflected in the mirror is seen through the parent's mirrors
+			XMMATRIX reflection = XMLoadFloat4x4(&mirrors.getReflection(c->Mirror));
+			if (c->Parent != NO_NODE)
+				reflection *= XMLoadFloat4x4(&m_nodes[c->Parent].Reflection);
+			XMStoreFloat4x4(&n.Reflection, reflection);
+			n.Frustum = c->Frustum;
+			n.Area = c->Area;
+			m_nodes.push_back(n);
+		}
+		unsigned int bits = 0;
+		while ((1u << bits) <= mostChildren)
+			++bits;
+		shift += bits;
+		parents.clear();
+		for (unsigned int i = first; i < m_nodes.size(); ++i)
+		{
+			m_nodes[i].Bits = shift;
+			parents.push_back(i);
+		}
+		if (!parents.empty())
+			m_statistics.MaxDepth = max(m_statistics.MaxDepth, depth);
+	}
+	for (auto it = m_roots.begin(); it != m_roots.end(); ++it)
+		AddPasses(*it);
+	++m_statistics.Frames;
+	m_statistics.Nodes += m_nodes.size();
+}
+
+void ReflectionTree::AddPasses(unsigned int node)
+{
+	Pass p = { PASS_STENCIL, node };
+	m_passes.push_back(p);
+	const vector<unsigned int>& children = m_nodes[node].Children;
+	for (auto it = children.begin(); it != children.end(); ++it)
+		AddPasses(*it);
+	//Scene of the node is tested against the node's bits only, so it's drawn over its children's regions as
+	//well and occludes their scenes where it's closer
+	p.Type = PASS_SCENE;
+	m_passes.push_back(p);
+}
+
+bool ReflectionTree::hasChild(unsigned int node, unsigned int mirror) const
+{
+	const vector<unsigned int>& children = m_nodes[node].Children;
+	for (auto it = children.begin(); it != children.end(); ++it)
+		if (m_nodes[*it].Mirror == mirror)
+			return true;
+	return false;
+}
+
+bool ReflectionTree::IsReflectionVisible(unsigned int node, const MirrorVisibility::Sphere& sphere)
+{
+	const Node& n = m_nodes[node];
+	MirrorVisibility::Sphere reflected = sphere;
+	XMStoreFloat3(&reflected.Center, XMVector3TransformCoord(XMLoadFloat3(&sphere.Center),
+															  XMLoadFloat4x4(&n.Reflection)));
+	++m_statistics.ReflectedDraws;
+	if (MirrorVisibility::Intersects(n.Frustum, reflected))
+		return true;
+	++m_statistics.CulledDraws;
+	return false;
+}
@@ -0,0 +1,112 @@
+#ifndef __GK2_REFLECTION_TREE_H_
+#define __GK2_REFLECTION_TREE_H_
+
+#include <d3d11.h>
+#include <xnamath.h>
+#include <vector>
+#include "gk2_mirrorVisibility.h"
+
+namespace gk2
+{
+	//Finds the mirrors visible in other mirrors up to a given depth. Each node of the tree is a mirror seen
+	//through the mirrors of its ancestors and gets their composite reflection. Nodes whose portals cover less
+	//than MinArea pixels are culled with their subtrees. Stencil references are assigned level by level:
+	//level d takes as many bits as needed for the most children of one node, so a node's region can be tested
+	//with the bits of its ancestors. Every level leaves at least one bit for each deeper level and can take its
+	//share of the nodes left in MaxNodes, e.g. a third of them at depth 1 of 3. Nodes which don't fit are culled,
+	//the smallest first.
+	class ReflectionTree
+	{
+	public:
+		static const unsigned int NO_NODE = 0xffffffff;
+		static const unsigned int STENCIL_BITS = 8;
+
+		struct Settings
+		{
+			unsigned int MaxDepth;
+			//In pixels
+			float MinArea;
+			unsigned int MaxNodes;
+		};
+
+		struct Node
+		{
+			unsigned int Mirror;
+			//1 for the mirrors seen directly
+			unsigned int Depth;
+			unsigned int Parent;
+			std::vector<unsigned int> Children;
+			unsigned int StencilRef;
+			//Number of the low stencil bits identifying the parent's region and the node's region
+			unsigned int ParentBits;
+			unsigned int Bits;
+			//World -> reflected world, the node's scene is drawn with Reflection * View and its mirror with
+			//the parent's reflection
+			XMFLOAT4X4 Reflection;
+			MirrorVisibility::Portal Frustum;
+			float Area;
+		};
+
+		enum PassType
+		{
+			//Mirror's polygon is drawn to the stencil inside the parent's region
+			PASS_STENCIL,
+			//Reflected scene is drawn inside the node's region, after the scenes of its children
+			PASS_SCENE
+		};
+
+		struct Pass
+		{
+			PassType Type;
+			unsigned int Node;
+		};
+
+		struct Statistics
+		{
+			unsigned int Frames;
+			unsigned long long Nodes;
+			//Nodes culled because of MinArea and because of the stencil bits or MaxNodes
+			unsigned long long SmallNodes;
+			unsigned long long OverBudgetNodes;
+			unsigned int MaxDepth;
+			//Reflections tested and the ones found to be outside of the node's portal
+			unsigned long long ReflectedDraws;
+			unsigned long long CulledDraws;
+		};
+
+		ReflectionTree(const Settings& settings);
+
+		void Build(const gk2::MirrorVisibility& mirrors, const XMMATRIX& view, const XMMATRIX& proj, float width,
+				   float height);
+
+		const std::vector<Node>& getNodes() const { return m_nodes; }
+		//Stencil and scene passes in the order they have to be drawn
+		const std::vector<Pass>& getPasses() const { return m_passes; }
+		//Mirror reflecting one of the node's children, i.e. its surface has to be left out of the node's scene
+		bool hasChild(unsigned int node, unsigned int mirror) const;
+		//Tests the image of a sphere given in world space against the node's portal
+		bool IsReflectionVisible(unsigned int node, const gk2::MirrorVisibility::Sphere& sphere);
+
+		const Statistics& getStatistics() const { return m_statistics; }
+
+	private:
+		struct Candidate
+		{
+			unsigned int Parent;
+			unsigned int Mirror;
+			float Area;
+			MirrorVisibility::Portal Frustum;
+		};
+
+		Settings m_settings;
+		std::vector<Node> m_nodes;
+		std::vector<unsigned int> m_roots;
+		std::vector<Pass> m_passes;
+		std::vector<Candidate> m_candidates;
+		Statistics m_statistics;
+
+		void AddPasses(unsigned int node);
+	};
+}
+
+#endif __GK2_REFLECTION_TREE_H_
@@ -0,0 +1,410 @@
+#include "gk2_stateFilteringContext.h"
+#include <algorithm>
+
+using namespace std;
+using namespace gk2;
+
+namespace
+{
+	const FLOAT DEFAULT_BLEND_FACTOR[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	const UINT MAX_VIEWPORTS = D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE;
+	const UINT MAX_RENDER_TARGETS = D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT;
+	const UINT MAX_VERTEX_BUFFERS = D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT;
+}
+
+bool StateFilteringContext::BlendBinding::operator ==(const BlendBinding& other) const
+{
+	return State == other.State && SampleMask == other.SampleMask && Factor[0] == other.Factor[0] &&
+		   Factor[1] == other.Factor[1] && Factor[2] == other.Factor[2] && Factor[3] == other.Factor[3];
+}
+
+bool StateFilteringContext::ViewportsBinding::operator ==(const ViewportsBinding& other) const
+{
+	if (Count != other.Count)
+		return false;
+	for (UINT i = 0; i < Count; ++i)
+	{
+		const D3D11_VIEWPORT& a = Viewports[i];
+		const D3D11_VIEWPORT& b = other.Viewports[i];
+		if (a.TopLeftX != b.TopLeftX || a.TopLeftY != b.TopLeftY || a.Width != b.Width || a.Height != b.Height ||
+			a.MinDepth != b.MinDepth || a.MaxDepth != b.MaxDepth)
+			return false;
+	}
+	return true;
+}
+
+bool StateFilteringContext::RenderTargetsBinding::operator ==(const RenderTargetsBinding& other) const
+{
+	if (Count != other.Count || DepthStencilView != other.DepthStencilView)
+		return false;
+	for (UINT i = 0; i < Count; ++i)
+		if (Views[i] != other.Views[i])
+			return false;
+	return true;
+}
+
+StateFilteringContext::StateFilteringContext(const shared_ptr<RenderContext>& context)
+	: m_context(context), m_targetsCount(0), m_targetsKnown(false)
+{
+	m_frame.Issued = m_frame.Filtered = 0;
+	m_lastFrame = m_total = m_frame;
+}
+
+void StateFilteringContext::BeginFrame()
+{
+	m_lastFrame = m_frame;
+	m_frame.Issued = m_frame.Filtered = 0;
+}
+
+void StateFilteringContext::Invalidate()
+{
+	m_vs.Known = m_gs.Known = m_ps.Known = m_hs.Known = m_ds.Known = false;
+	m_vsConstantBuffers.Invalidate();
+	m_gsConstantBuffers.Invalidate();
+	m_psConstantBuffers.Invalidate();
+	m_hsConstantBuffers.Invalidate();
+	m_dsConstantBuffers.Invalidate();
+	m_psShaderResources.Invalidate();
+	m_dsShaderResources.Invalidate();
+	m_psSamplers.Invalidate();
+	m_dsSamplers.Invalidate();
+	m_inputLayout.Known = m_topology.Known = m_indexBuffer.Known = false;
+	m_vertexBuffers.Invalidate();
+	m_rasterizerState.Known = m_viewports.Known = false;
+	m_blendState.Known = m_depthStencilState.Known = m_renderTargets.Known = false;
+	m_targetsKnown = false;
+}
+
+bool StateFilteringContext::Count(bool changed)
+{
+	if (changed)
+	{
+		++m_frame.Issued;
+		++m_total.Issued;
+	}
+	else
+	{
+		++m_frame.Filtered;
+		++m_total.Filtered;
+	}
+	return changed;
+}
+
+template<typename T>
+void StateFilteringContext::SetShader(Cached<T*>& cache,
+									  void (RenderContext::*set)(T*, ID3D11ClassInstance* const*, UINT), T* shader,
+									  ID3D11ClassInstance* const* classInstances, UINT classInstancesCount)
+{
+	//Class instances are not tracked, shaders using them are always bound
+	if (classInstancesCount)
+	{
+		cache.Known = false;
+		Count(true);
+		((*m_context).*set)(shader, classInstances, classInstancesCount);
+	}
+	else if (Count(cache.Set(shader)))
+		((*m_context).*set)(shader, nullptr, 0);
+}
+
+template<typename T, UINT N>
+void StateFilteringContext::SetSlots(SlotCache<T, N>& cache, void (RenderContext::*set)(UINT, UINT, T const*),
+									 UINT startSlot, UINT count, T const* values)
+{
+	//Invalid ranges are passed on, so that the runtime reports them
+	if (!cache.Fits(startSlot, count))
+	{
+		Count(true);
+		((*m_context).*set)(startSlot, count, values);
+		return;
+	}
+	UINT first, changed;
+	if (Count(cache.Set(startSlot, count, values, first, changed)))
+		((*m_context).*set)(first, changed, values + (first - startSlot));
+}
+
+void StateFilteringContext::VSSetShader(ID3D11VertexShader* shader, ID3D11ClassInstance* const* classInstances,
+										UINT classInstancesCount)
+{
+	SetShader(m_vs, &RenderContext::VSSetShader, shader, classInstances, classInstancesCount);
+}
+
+void StateFilteringContext::GSSetShader(ID3D11GeometryShader* shader, ID3D11ClassInstance* const* classInstances,
+										UINT classInstancesCount)
+{
+	SetShader(m_gs, &RenderContext::GSSetShader, shader, classInstances, classInstancesCount);
+}
+
+void StateFilteringContext::PSSetShader(ID3D11PixelShader* shader, ID3D11ClassInstance* const* classInstances,
+										UINT classInstancesCount)
+{
+	SetShader(m_ps, &RenderContext::PSSetShader, shader, classInstances, classInstancesCount);
+}
+
+void StateFilteringContext::HSSetShader(ID3D11HullShader* shader, ID3D11ClassInstance* const* classInstances,
+										UINT classInstancesCount)
+{
+	SetShader(m_hs, &RenderContext::HSSetShader, shader, classInstances, classInstancesCount);
+}
+
+void StateFilteringContext::DSSetShader(ID3D11DomainShader* shader, ID3D11ClassInstance* const* classInstances,
+										UINT classInstancesCount)
+{
+	SetShader(m_ds, &RenderContext::DSSetShader, shader, classInstances, classInstancesCount);
+}
+
+void StateFilteringContext::VSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers)
+{
+	SetSlots(m_vsConstantBuffers, &RenderContext::VSSetConstantBuffers, startSlot, count, buffers);
+}
+
+void StateFilteringContext::GSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers)
+{
+	SetSlots(m_gsConstantBuffers, &RenderContext::GSSetConstantBuffers, startSlot, count, buffers);
+}
+
+void StateFilteringContext::PSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers)
+{
+	SetSlots(m_psConstantBuffers, &RenderContext::PSSetConstantBuffers, startSlot, count, buffers);
+}
+
+void StateFilteringContext::PSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView* const* views)
+{
+	SetSlots(m_psShaderResources, &RenderContext::PSSetShaderResources, startSlot, count, views);
+}
+
+void StateFilteringContext::PSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState* const* samplers)
+{
+	SetSlots(m_psSamplers, &RenderContext::PSSetSamplers, startSlot, count, samplers);
+}
+
+void StateFilteringContext::HSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers)
+{
+	SetSlots(m_hsConstantBuffers, &RenderContext::HSSetConstantBuffers, startSlot, count, buffers);
+}
+
+void StateFilteringContext::DSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers)
+{
+	SetSlots(m_dsConstantBuffers, &RenderContext::DSSetConstantBuffers, startSlot, count, buffers);
+}
+
+void StateFilteringContext::DSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView* const* views)
+{
+	SetSlots(m_dsShaderResources, &RenderContext::DSSetShaderResources, startSlot, count, views);
+}
+
+void StateFilteringContext::DSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState* const* samplers)
+{
+	SetSlots(m_dsSamplers, &RenderContext::DSSetSamplers, startSlot, count, samplers);
+}
+
+void StateFilteringContext::IASetInputLayout(ID3D11InputLayout* layout)
+{
+	if (Count(m_inputLayout.Set(layout)))
+		m_context->IASetInputLayout(layout);
+}
+
+void StateFilteringContext::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+	if (Count(m_topology.Set(topology)))
+		m_context->IASetPrimitiveTopology(topology);
+}
+
+void StateFilteringContext::IASetVertexBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers,
+											   const UINT* strides, const UINT* offsets)
+{
+	if (!m_vertexBuffers.Fits(startSlot, count) || !buffers || !strides || !offsets)
+	{
+		Count(true);
+		m_context->IASetVertexBuffers(startSlot, count, buffers, strides, offsets);
+		m_vertexBuffers.Invalidate();
+		return;
+	}
+	VertexBufferBinding bindings[MAX_VERTEX_BUFFERS];
+	for (UINT i = 0; i < count; ++i)
+	{
+		bindings[i].Buffer = buffers[i];
+		bindings[i].Stride = strides[i];
+		bindings[i].Offset = offsets[i];
+	}
+	UINT first, changed;
+	if (Count(m_vertexBuffers.Set(startSlot, count, bindings, first, changed)))
+	{
+		UINT skip = first - startSlot;
+		m_context->IASetVertexBuffers(first, changed, buffers + skip, strides + skip, offsets + skip);
+	}
+}
+
+void StateFilteringContext::IASetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset)
+{
+	IndexBufferBinding binding = { buffer, format, offset };
+	if (Count(m_indexBuffer.Set(binding)))
+		m_context->IASetIndexBuffer(buffer, format, offset);
+}
+
+void StateFilteringContext::RSSetState(ID3D11RasterizerState* state)
+{
+	if (Count(m_rasterizerState.Set(state)))
+		m_context->RSSetState(state);
+}
+
+void StateFilteringContext::RSSetViewports(UINT count, const D3D11_VIEWPORT* viewports)
+{
+	if (count > MAX_VIEWPORTS || (count && !viewports))
+	{
+		Count(true);
+		m_context->RSSetViewports(count, viewports);
+		m_viewports.Known = false;
+		return;
+	}
+	ViewportsBinding binding;
+	binding.Count = count;
+	for (UINT i = 0; i < count; ++i)
+		binding.Viewports[i] = viewports[i];
+	if (Count(m_viewports.Set(binding)))
+		m_context->RSSetViewports(count, viewports);
+}
+
+void StateFilteringContext::OMSetBlendState(ID3D11BlendState* state, const FLOAT blendFactor[4], UINT sampleMask)
+{
+	BlendBinding binding;
+	binding.State = state;
+	binding.SampleMask = sampleMask;
+	//Null blend factor is the same as all ones
+	const FLOAT* factor = blendFactor ? blendFactor : DEFAULT_BLEND_FACTOR;
+	for (int i = 0; i < 4; ++i)
+		binding.Factor[i] = factor[i];
+	if (Count(m_blendState.Set(binding)))
+		m_context->OMSetBlendState(state, blendFactor, sampleMask);
+}
+
+void StateFilteringContext::OMSetDepthStencilState(ID3D11DepthStencilState* state, UINT stencilRef)
+{
+	DepthStencilBinding binding = { state, stencilRef };
+	if (Count(m_depthStencilState.Set(binding)))
+		m_context->OMSetDepthStencilState(state, stencilRef);
+}
+
+void StateFilteringContext::OMSetRenderTargets(UINT count, ID3D11RenderTargetView* const* views,
+											   ID3D11DepthStencilView* depthStencilView)
+{
+	if (count > MAX_RENDER_TARGETS || (count && !views))
+	{
+		//Rejected by the runtime, so the targets stay as they were
+		Count(true);
+		m_context->OMSetRenderTargets(count, views, depthStencilView);
+		m_renderTargets.Known = false;
+		return;
+	}
+	RenderTargetsBinding binding;
+	binding.Count = count;
+	binding.DepthStencilView = depthStencilView;
+	for (UINT i = 0; i < count; ++i)
+		binding.Views[i] = views[i];
+	if (Count(m_renderTargets.Set(binding)))
+	{
+		m_context->OMSetRenderTargets(count, views, depthStencilView);
+		ChangeTargets(binding);
+	}
+}
+
+void StateFilteringContext::ChangeTargets(const RenderTargetsBinding& binding)
+{
+	ID3D11Resource* targets[2 * (MAX_RENDER_TARGETS + 1)];
+	UINT count = m_targetsCount;
+	copy(m_targets, m_targets + m_targetsCount, targets);
+	m_targetsCount = 0;
+	for (UINT i = 0; i <= binding.Count; ++i)
+	{
+		ID3D11View* view = i < binding.Count ? static_cast<ID3D11View*>(binding.Views[i]) :
+							binding.DepthStencilView;
+		if (!view)
+			continue;
+		//Bound view keeps its texture alive, only the address is kept
+		ID3D11Resource* resource;
+		view->GetResource(&resource);
+		resource->Release();
+		m_targets[m_targetsCount++] = resource;
+		targets[count++] = resource;
+	}
+	if (m_targetsKnown)
+	{
+		ForgetTargets(m_psShaderResources, targets, count);
+		ForgetTargets(m_dsShaderResources, targets, count);
+	}
+	else
+	{
+		//Views bound while the unknown targets were bound may have been ignored
+		m_psShaderResources.Invalidate();
+		m_dsShaderResources.Invalidate();
+		m_targetsKnown = true;
+	}
+}
+
+void StateFilteringContext::ForgetTargets(ShaderResourceSlots& cache, ID3D11Resource* const* targets, UINT count)
+{
+	if (count == 0)
+		return;
+	for (UINT i = 0; i < D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT; ++i)
+	{
+		Cached<ID3D11ShaderResourceView*>& slot = cache.Slots[i];
+		if (!slot.Known || !slot.Value)
+			continue;
+		ID3D11Resource* resource;
+		slot.Value->GetResource(&resource);
+		resource->Release();
+		if (find(targets, targets + count, resource) != targets + count)
+			slot.Known = false;
+	}
+}
+
+void StateFilteringContext::ClearRenderTargetView(ID3D11RenderTargetView* view, const FLOAT color[4])
+{
+	m_context->ClearRenderTargetView(view, color);
+}
+
+void StateFilteringContext::ClearDepthStencilView(ID3D11DepthStencilView* view, UINT flags, FLOAT depth,
+												  UINT8 stencil)
+{
+	m_context->ClearDepthStencilView(view, flags, depth, stencil);
+}
+
+void StateFilteringContext::Draw(UINT vertexCount, UINT startVertex)
+{
+	m_context->Draw(vertexCount, startVertex);
+}
+
+void StateFilteringContext::DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex)
+{
+	m_context->DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+void StateFilteringContext::DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndex,
+												 INT baseVertex, UINT startInstance)
+{
+	m_context->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+HRESULT StateFilteringContext::Map(ID3D11Resource* resource, UINT subresource, D3D11_MAP mapType, UINT mapFlags,
+								   D3D11_MAPPED_SUBRESOURCE* mappedResource)
+{
+	return m_context->Map(resource, subresource, mapType, mapFlags, mappedResource);
+}
+
+void StateFilteringContext::Unmap(ID3D11Resource* resource, UINT subresource)
+{
+	m_context->Unmap(resource, subresource);
+}
+
+void StateFilteringContext::UpdateSubresource(ID3D11Resource* resource, UINT subresource, const D3D11_BOX* box,
+											  const void* data, UINT rowPitch, UINT depthPitch)
+{
+	m_context->UpdateSubresource(resource, subresource, box, data, rowPitch, depthPitch);
+}
+
+void StateFilteringContext::CopySubresourceRegion(ID3D11Resource* destination, UINT destinationSubresource, UINT x,
+												  UINT y, UINT z, ID3D11Resource* source, UINT sourceSubresource,
+												  const D3D11_BOX* sourceBox)
+{
+	m_context->CopySubresourceRegion(destination, destinationSubresource, x, y, z, source, sourceSubresource,
+									 sourceBox);
+}
@@ -0,0 +1,34 @@
+#include "gk2_uploadBuffer.h"
+#include "gk2_exceptions.h"
+#include <cstring>
+
+using namespace std;
+using namespace gk2;
+
+UploadBuffer::UploadBuffer(DeviceHelper& device, unsigned int size, D3D11_BIND_FLAG bindFlags,
+						   unsigned int framesInFlight, unsigned int alignment /* = UploadRing::DEFAULT_ALIGNMENT */)
+	: m_ring(size, framesInFlight, alignment)
+{
+	D3D11_BUFFER_DESC desc;
+	ZeroMemory(&desc, sizeof(D3D11_BUFFER_DESC));
+	desc.BindFlags = bindFlags;
+	desc.ByteWidth = size;
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	m_buffer = device.CreateBuffer(desc);
+}
+
+unsigned int UploadBuffer::Upload(const shared_ptr<RenderContext>& context, const void* data,
+								  unsigned int size)
+{
+	UploadRing::Allocation a = m_ring.Allocate(size);
+	D3D11_MAPPED_SUBRESOURCE res;
+	HRESULT result = context->Map(m_buffer.get(), 0,
+								  a.Mode == UploadRing::MAP_DISCARD ? D3D11_MAP_WRITE_DISCARD
+																	: D3D11_MAP_WRITE_NO_OVERWRITE, 0, &res);
+	if (FAILED(result))
+		THROW_DX11(result);
+	memcpy(static_cast<BYTE*>(res.pData) + a.Offset, data, size);
+	context->Unmap(m_buffer.get(), 0);
+	return a.Offset;
+}
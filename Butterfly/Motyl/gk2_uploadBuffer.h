@@ -0,0 +1,40 @@
+#ifndef __GK2_UPLOAD_BUFFER_H_
+#define __GK2_UPLOAD_BUFFER_H_
+
+#include <d3d11.h>
+#include <memory>
+#include "gk2_deviceHelper.h"
+#include "gk2_renderContext.h"
+#include "gk2_uploadRing.h"
+
+namespace gk2
+{
+	//Dynamic buffer written through a gk2::UploadRing. Every upload maps only its own range without
+	//overwriting the data of draws in flight, so small per-draw data doesn't need a buffer of its own.
+	class UploadBuffer
+	{
+	public:
+		UploadBuffer(gk2::DeviceHelper& device, unsigned int size, D3D11_BIND_FLAG bindFlags,
+					 unsigned int framesInFlight, unsigned int alignment = gk2::UploadRing::DEFAULT_ALIGNMENT);
+
+		ID3D11Buffer* getBuffer() const { return m_buffer.get(); }
+		const gk2::UploadRing& getRing() const { return m_ring; }
+
+		//Has to be called once per frame before any upload
+		void BeginFrame() { m_ring.BeginFrame(); }
+		//Copies the data to the buffer and returns its offset
+		unsigned int Upload(const std::shared_ptr<gk2::RenderContext>& context, const void* data, unsigned int size);
+
+		template<typename T>
+		unsigned int Upload(const std::shared_ptr<gk2::RenderContext>& context, const T& data)
+		{
+			return Upload(context, &data, sizeof(T));
+		}
+
+	private:
+		std::shared_ptr<ID3D11Buffer> m_buffer;
+		gk2::UploadRing m_ring;
+	};
+}
+
+#endif __GK2_UPLOAD_BUFFER_H_
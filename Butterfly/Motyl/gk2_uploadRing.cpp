@@ -0,0 +1,74 @@
+#include "gk2_uploadRing.h"
+#include <stdexcept>
+
+using namespace std;
+using namespace gk2;
+
+UploadRing::UploadRing(unsigned int size, unsigned int framesInFlight,
+					   unsigned int alignment /* = DEFAULT_ALIGNMENT */)
+	: m_size(size), m_framesInFlight(framesInFlight), m_alignment(alignment), m_head(0), m_used(0), m_frameUsed(0),
+	  m_discarded(false)
+{
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+		throw invalid_argument("Upload ring alignment has to be a power of two");
+	Statistics zero = { };
+	m_frame = m_lastFrame = m_total = zero;
+}
+
+void UploadRing::BeginFrame()
+{
+	m_inFlight.push_back(m_frameUsed);
+	m_frameUsed = 0;
+	while (m_inFlight.size() > m_framesInFlight)
+	{
+		m_used -= m_inFlight.front();
+		m_inFlight.pop_front();
+	}
+	m_lastFrame = m_frame;
+	Statistics zero = { };
+	m_frame = zero;
+}
+
+UploadRing::Allocation UploadRing::Allocate(unsigned int size)
+{
+	if (size > m_size)
+		throw length_error("Upload is larger than the ring buffer");
+	Allocation a;
+	a.Offset = (m_head + m_alignment - 1) & ~(m_alignment - 1);
+	a.Mode = MAP_NO_OVERWRITE;
+	//Space between the head and the end of the buffer is skipped if the data doesn't fit there
+	unsigned int skipped = a.Offset - m_head;
+	bool wrapped = a.Offset > m_size || size > m_size - a.Offset;
+	if (wrapped)
+	{
+		skipped = m_size - m_head;
+		a.Offset = 0;
+	}
+	if (!m_discarded || skipped + size > m_size - m_used)
+	{
+		//Memory of the frames in flight is left to the GPU, the buffer starts empty
+		a.Mode = MAP_DISCARD;
+		a.Offset = 0;
+		skipped = 0;
+		m_head = 0;
+		m_used = 0;
+		m_frameUsed = 0;
+		m_inFlight.assign(m_inFlight.size(), 0);
+		m_discarded = true;
+		++m_frame.Discards;
+		++m_total.Discards;
+	}
+	else if (wrapped)
+	{
+		++m_frame.Wraps;
+		++m_total.Wraps;
+	}
+	m_head = a.Offset + size;
+	m_used += skipped + size;
+	m_frameUsed += skipped + size;
+	m_frame.BytesUploaded += size;
+	m_total.BytesUploaded += size;
+	++m_frame.Maps;
+	++m_total.Maps;
+	return a;
+}
@@ -0,0 +1,78 @@
+#ifndef __GK2_UPLOAD_RING_H_
+#define __GK2_UPLOAD_RING_H_
+
+#include <deque>
+
+namespace gk2
+{
+	//Sub-allocates the space of one large dynamic buffer to the data uploaded during a frame. Only the offsets
+	//are managed, so the logic doesn't need a device. Space used by a frame is reclaimed after framesInFlight
+	//following frames have started, i.e. when the GPU can no longer be reading it. When the ring runs out of
+	//free space the buffer has to be discarded, the driver then gives it new memory and all of it is free.
+	class UploadRing
+	{
+	public:
+		//Offsets of constant buffers bound with VSSetConstantBuffers1 have to be multiples of 16 constants
+		static const unsigned int DEFAULT_ALIGNMENT = 256;
+
+		enum MapMode
+		{
+			//Allocated range isn't used by any draw in flight
+			MAP_NO_OVERWRITE,
+			//Whole buffer has to be discarded before writing to the allocated range
+			MAP_DISCARD
+		};
+
+		struct Allocation
+		{
+			unsigned int Offset;
+			MapMode Mode;
+		};
+
+		struct Statistics
+		{
+			//Bytes written to the buffer, without the alignment padding
+			unsigned long long BytesUploaded;
+			//Every allocation is written with one map
+			unsigned int Maps;
+			unsigned int Discards;
+			//Allocations which didn't fit at the end of the buffer and were placed at its beginning
+			unsigned int Wraps;
+		};
+
+		//alignment has to be a power of two
+		UploadRing(unsigned int size, unsigned int framesInFlight, unsigned int alignment = DEFAULT_ALIGNMENT);
+
+		unsigned int getSize() const { return m_size; }
+		unsigned int getAlignment() const { return m_alignment; }
+		//Bytes used by the current frame and the ones still in flight, including the padding
+		unsigned int getUsed() const { return m_used; }
+		const Statistics& getFrameStatistics() const { return m_frame; }
+		const Statistics& getLastFrameStatistics() const { return m_lastFrame; }
+		const Statistics& getTotalStatistics() const { return m_total; }
+
+		//Fences the space used by the previous frame and starts counting the next one
+		void BeginFrame();
+		//Returns an aligned range of size bytes. Throws std::length_error if it is larger than the buffer.
+		Allocation Allocate(unsigned int size);
+
+	private:
+		unsigned int m_size;
+		unsigned int m_framesInFlight;
+		unsigned int m_alignment;
+		//Offset of the first free byte
+		unsigned int m_head;
+		unsigned int m_used;
+		//Bytes used by the current frame
+		unsigned int m_frameUsed;
+		//Bytes used by each of the previous frames which may still be in flight, the oldest first
+		std::deque<unsigned int> m_inFlight;
+		//The buffer has to be discarded before it is written to for the first time
+		bool m_discarded;
+		Statistics m_frame;
+		Statistics m_lastFrame;
+		Statistics m_total;
+	};
+}
+
+#endif __GK2_UPLOAD_RING_H_
@@ -1,4 +1,5 @@
 #include "gk2_utils.h"
+#include "gk2_aligned.h"
 
 using namespace gk2;
 
@@ -19,19 +20,10 @@ void Utils::DI8DeviceRelease(IDirectInputDevice8W* device)
 
 void* Utils::New16Aligned(size_t size)
 {
-	BYTE* ptr = new BYTE[size + 16];
-	BYTE* shifted = ptr + 16;
-	BYTE missalignment = (BYTE)((ULONG)shifted & 0xf);
-	shifted = (BYTE*)((ULONG)shifted &~(ULONG)0xf);
-	shifted[-1] = missalignment;
-	return (void*)shifted;
+	return AlignedMemory::Allocate(size, 16);
 }
 
 void Utils::Delete16Aligned(void* ptr)
 {
-	BYTE* shifted = (BYTE*)ptr;
-	BYTE missalignment = shifted[-1];
-	shifted = (BYTE*)((ULONG)shifted | (ULONG)missalignment);
-	BYTE* original = shifted - 16;
-	delete [] original;
+	AlignedMemory::Free(ptr);
 }
\ No newline at end of file
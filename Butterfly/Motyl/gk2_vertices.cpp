@@ -13,3 +13,12 @@ const D3D11_INPUT_ELEMENT_DESC VertexPosNormal::Layout[] =
 		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 }
 	};
+
+const D3D11_INPUT_ELEMENT_DESC DrawConstants::Layout[] =
+	{
+		{ "WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, InputSlot, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, InputSlot, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, InputSlot, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, InputSlot, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, InputSlot, 64, D3D11_INPUT_PER_INSTANCE_DATA, 1 }
+	};
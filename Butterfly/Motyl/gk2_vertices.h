@@ -20,6 +20,17 @@ namespace gk2
 		static const unsigned int LayoutElements = 2;
 		static const D3D11_INPUT_ELEMENT_DESC Layout[LayoutElements];
 	};
+
+	//Per-draw data bound at an offset of a gk2::UploadBuffer to input slot 1. Non-instanced draws read it as
+	//their only instance.
+	struct DrawConstants
+	{
+		XMFLOAT4X4 World;
+		XMFLOAT4 SurfaceColor;
+		static const unsigned int InputSlot = 1;
+		static const unsigned int LayoutElements = 5;
+		static const D3D11_INPUT_ELEMENT_DESC Layout[LayoutElements];
+	};
 }
 
 #endif __GK2_VERTICES_H_
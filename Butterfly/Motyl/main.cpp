@@ -1,6 +1,7 @@
 #include "gk2_butterfly.h"
 #include "gk2_window.h"
 #include "gk2_exceptions.h"
+#include <sstream>
 
 using namespace std;
 using namespace gk2;
@@ -8,13 +9,23 @@ using namespace gk2;
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE prevInstance, LPWSTR cmdLine, int cmdShow)
 {
 	UNREFERENCED_PARAMETER(prevInstance);
-	UNREFERENCED_PARAMETER(cmdLine);
+	if (wstring(cmdLine) == L"/compileshaders")
+		return ApplicationBase::PrecompileShaders(L"resources/shaders/shaders.manifest");
 	shared_ptr<ApplicationBase> app;
 	shared_ptr<Window> w;
 	int exitCode = 0;
 	try
 	{
 		app.reset(new Butterfly(hInstance));
+		//Benchmark runs: /record file or /replay file [fixed time step]
+		wistringstream options(cmdLine);
+		wstring option, file;
+		float fixedDt = 0.0f;
+		options >> option >> file >> fixedDt;
+		if (option == L"/record")
+			app->RecordInput(string(file.begin(), file.end()));
+		else if (option == L"/replay")
+			app->ReplayInput(string(file.begin(), file.end()), fixedDt);
 		w.reset(new Window(hInstance, 800, 800, L"Triangle Demo"));
 		exitCode = app->Run(w.get(), cmdShow);
 	}
@@ -1,11 +1,6 @@
 /*Texture2D colorMap : register(t0);
 SamplerState colorSampler : register(s0);*/
 
-cbuffer cbWorld : register(b0) //Vertex Shader constant buffer slot 0
-{
-	matrix worldMatrix;
-};
-
 cbuffer cbView : register(b1) //Vertex Shader constant buffer slot 1
 {
 	matrix viewMatrix;
@@ -29,15 +24,16 @@ cbuffer cbLightColors : register(b0) //Pixel Shader constant buffer slot 0
 	float4 lightColors[3];
 }
 
-cbuffer cbSurfaceColor : register(b1) //Pixel Shader constant buffer slot 0
-{
-	float4 surfaceColor;
-}
-
 struct VSInput
 {
 	float3 pos : POSITION;
 	float3 norm : NORMAL0;
+	//Per-draw constants, rows of the world matrix and the surface color
+	float4 world0 : WORLD0;
+	float4 world1 : WORLD1;
+	float4 world2 : WORLD2;
+	float4 world3 : WORLD3;
+	float4 surfaceColor : COLOR;
 };
 
 struct PSInput
@@ -48,11 +44,19 @@ struct PSInput
 	float3 lightVec0 : TEXCOORD1;
 	float3 lightVec1 : TEXCOORD2;
 	float3 lightVec2 : TEXCOORD3;
+	nointerpolation float4 surfaceColor : COLOR;
 };
 
+//World matrix laid out the same way as if it was read from a constant buffer
+matrix WorldMatrix(float4 world0, float4 world1, float4 world2, float4 world3)
+{
+	return transpose(float4x4(world0, world1, world2, world3));
+}
+
 PSInput VS_Main(VSInput i)
 {
 	PSInput o = (PSInput)0;
+	matrix worldMatrix = WorldMatrix(i.world0, i.world1, i.world2, i.world3);
 	matrix worldView = mul(viewMatrix, worldMatrix);
 	float4 viewPos = float4(i.pos, 1.0f);
 	viewPos = mul(worldView, viewPos);
@@ -66,6 +70,7 @@ PSInput VS_Main(VSInput i)
 	o.lightVec0 = normalize((mul(viewMatrix, lightPos[0]) - viewPos).xyz);
 	o.lightVec1 = normalize((mul(viewMatrix, lightPos[1]) - viewPos).xyz);
 	o.lightVec2 = normalize((mul(viewMatrix, lightPos[2]) - viewPos).xyz);
+	o.surfaceColor = i.surfaceColor;
 	return o;
 }
 
@@ -84,7 +89,7 @@ float4 PS_Main(PSInput i) : SV_TARGET
 	{
 		lightVec = normalize(i.lightVec0);
 		halfVec = normalize(viewVec + lightVec);
-		color += lightColors[0].xyz * surfaceColor.xyz * surface.y * clamp(dot(normal, lightVec), 0.0f, 1.0f); //diffuse Color
+		color += lightColors[0].xyz * i.surfaceColor.xyz * surface.y * clamp(dot(normal, lightVec), 0.0f, 1.0f); //diffuse Color
 		nh = dot(normal, halfVec);
 		nh = clamp(nh, 0.0f, 1.0f);
 		nh = pow(nh, surface.w);
@@ -97,7 +102,7 @@ float4 PS_Main(PSInput i) : SV_TARGET
 	{
 		lightVec = normalize(i.lightVec1);
 		halfVec = normalize(viewVec + lightVec);
-		color += lightColors[1].xyz * surfaceColor.xyz * surface.y * clamp(dot(normal, lightVec), 0.0f, 1.0f); //diffuse Color
+		color += lightColors[1].xyz * i.surfaceColor.xyz * surface.y * clamp(dot(normal, lightVec), 0.0f, 1.0f); //diffuse Color
 		nh = dot(normal, halfVec);
 		nh = clamp(nh, 0.0f, 1.0f);
 		nh = pow(nh, surface.w);
@@ -110,7 +115,7 @@ float4 PS_Main(PSInput i) : SV_TARGET
 	{
 		lightVec = normalize(i.lightVec2);
 		halfVec = normalize(viewVec + lightVec);
-		color += lightColors[2].xyz * surfaceColor.xyz * surface.y * clamp(dot(normal, lightVec), 0.0f, 1.0f); //diffuse Color
+		color += lightColors[2].xyz * i.surfaceColor.xyz * surface.y * clamp(dot(normal, lightVec), 0.0f, 1.0f); //diffuse Color
 		nh = dot(normal, halfVec);
 		nh = clamp(nh, 0.0f, 1.0f);
 		nh = pow(nh, surface.w);
@@ -118,18 +123,24 @@ float4 PS_Main(PSInput i) : SV_TARGET
 		specAlpha += nh;
 		color += lightColors[2].xyz * nh; //specular Color
 	}
-	return float4(color, surfaceColor.w+specAlpha);
+	return float4(color, i.surfaceColor.w+specAlpha);
 }
 
 struct VSBilboardInput
 {
 	float3 pos : POSITION;
+	float4 world0 : WORLD0;
+	float4 world1 : WORLD1;
+	float4 world2 : WORLD2;
+	float4 world3 : WORLD3;
+	float4 surfaceColor : COLOR;
 };
 
 struct PSBilboardInput
 {
 	float4 pos : SV_POSITION;
 	float2 tex : TEXCOORD0;
+	nointerpolation float4 surfaceColor : COLOR;
 };
 
 
@@ -142,10 +153,11 @@ PSBilboardInput VS_Bilboard(VSBilboardInput i)
 	o.pos = mul(invViewMatrix, o.pos);
 	o.pos += zero;
 	o.pos.w = 1.0f;
-	o.pos = mul(worldMatrix, o.pos);
+	o.pos = mul(WorldMatrix(i.world0, i.world1, i.world2, i.world3), o.pos);
 	o.pos = mul(viewMatrix, o.pos);
 	o.pos = mul(projMatrix, o.pos);
 	o.tex = i.pos.xy;
+	o.surfaceColor = i.surfaceColor;
 	return o;
 }
 
@@ -153,5 +165,5 @@ float4 PS_Bilboard(PSBilboardInput i) : SV_TARGET
 {
 	float d = sqrt(i.tex.x*i.tex.x + i.tex.y*i.tex.y);
 	d = clamp(1 - d, 0.0f, 1.0f);
-	return surfaceColor*d;
+	return i.surfaceColor*d;
 }
\ No newline at end of file
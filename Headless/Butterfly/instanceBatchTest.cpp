@@ -0,0 +1,138 @@
+#include "gk2_butterflyScene.h"
+#include "gk2_instanceBatch.h"
+#include "gk2_testCheck.h"
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+using namespace gk2;
+
+//Groups and packing of the instances Butterfly uploads to input slot 1
+
+namespace
+{
+	//Ids of Butterfly::Mesh and Butterfly::Effect
+	const unsigned int MESH_PENTAGON = 1;
+	const unsigned int MESH_MOEBIUS = 2;
+	const unsigned int MESH_WING = 3;
+	const unsigned int MESH_BILBOARD = 4;
+	const unsigned int EFFECT_LIGHTING = 0;
+	const unsigned int EFFECT_BILBOARD = 1;
+
+	DrawConstants Constants(const XMMATRIX& world, float tag)
+	{
+		DrawConstants c;
+		XMStoreFloat4x4(&c.World, world);
+		c.SurfaceColor = XMFLOAT4(tag, 0.0f, 0.0f, 1.0f);
+		return c;
+	}
+
+	bool Equal(const DrawConstants& a, const DrawConstants& b)
+	{
+		return memcmp(&a, &b, sizeof(DrawConstants)) == 0;
+	}
+
+	void TestLayout()
+	{
+		//The shader reads the rows of the world matrix and the color at these offsets of one tightly packed instance
+		Check(sizeof(DrawConstants) == 80, "instances are 80 bytes");
+		const D3D11_INPUT_ELEMENT_DESC* layout = DrawConstants::Layout;
+		Check(DrawConstants::LayoutElements == 5, "five instance elements");
+		for (unsigned int i = 0; i < 4; ++i)
+		{
+			Check(strcmp(layout[i].SemanticName, "WORLD") == 0 && layout[i].SemanticIndex == i,
+				  "WORLD0-3 are the first elements");
+			Check(layout[i].AlignedByteOffset == offsetof(DrawConstants, World) + i * sizeof(XMFLOAT4),
+				  "row of the world matrix at its offset");
+		}
+		Check(strcmp(layout[4].SemanticName, "COLOR") == 0 &&
+			  layout[4].AlignedByteOffset == offsetof(DrawConstants, SurfaceColor), "color at its offset");
+		for (unsigned int i = 0; i < DrawConstants::LayoutElements; ++i)
+			Check(layout[i].InputSlot == DrawConstants::InputSlot &&
+				  layout[i].InputSlotClass == D3D11_INPUT_PER_INSTANCE_DATA && layout[i].InstanceDataStepRate == 1,
+				  "elements step once per instance in the instance slot");
+	}
+
+	void TestGroups()
+	{
+		InstanceBatch batch;
+		Check(batch.isEmpty(), "new batch is empty");
+		//Strip, wings and the faces interleaved with the bilboards
+		vector<DrawConstants> strip, wings, faces, bilboards;
+		strip.push_back(Constants(XMMatrixIdentity(), 0.0f));
+		batch.Add(MESH_MOEBIUS, EFFECT_LIGHTING, strip[0]);
+		for (int i = 0; i < 2; ++i)
+		{
+			wings.push_back(Constants(XMMatrixRotationY(i * XM_PI), 1.0f + i));
+			batch.Add(MESH_WING, EFFECT_LIGHTING, wings.back());
+		}
+		for (unsigned int i = 0; i < ButterflyScene::FACES; ++i)
+		{
+			faces.push_back(Constants(ButterflyScene::DodecahedronMatrix(i), 10.0f + i));
+			batch.Add(MESH_PENTAGON, EFFECT_LIGHTING, faces.back());
+			if (i % 4 == 0)
+			{
+				bilboards.push_back(Constants(XMMatrixTranslation(0.0f, 0.0f, i * 1.0f), 30.0f + i));
+				batch.Add(MESH_BILBOARD, EFFECT_BILBOARD, bilboards.back());
+			}
+		}
+		batch.Build();
+
+		const vector<InstanceBatch::Group>& groups = batch.getGroups();
+		const vector<DrawConstants>& instances = batch.getInstances();
+		Check(groups.size() == 4, "one group per mesh and effect");
+		Check(instances.size() == 18, "every draw is an instance");
+		if (groups.size() != 4 || instances.size() != 18)
+			return;
+		const vector<DrawConstants>* expected[4] = { &strip, &wings, &faces, &bilboards };
+		unsigned int meshes[4] = { MESH_MOEBIUS, MESH_WING, MESH_PENTAGON, MESH_BILBOARD };
+		unsigned int first = 0;
+		for (unsigned int g = 0; g < 4; ++g)
+		{
+			Check(groups[g].Mesh == meshes[g], "groups in the order of their first draws");
+			Check(groups[g].Effect == (g == 3 ? EFFECT_BILBOARD : EFFECT_LIGHTING), "group keeps its effect");
+			Check(groups[g].FirstInstance == first && groups[g].InstanceCount == expected[g]->size(),
+				  "groups packed one after another");
+			for (unsigned int i = 0; i < groups[g].InstanceCount && i < expected[g]->size(); ++i)
+				Check(Equal(instances[first + i], (*expected[g])[i]), "instances keep the order of the draws");
+			first += groups[g].InstanceCount;
+		}
+
+		vector<DrawConstants> packed = instances;
+		size_t calls = groups.size();
+		batch.Build();
+		bool same = packed.size() == batch.getInstances().size();
+		for (size_t i = 0; same && i < packed.size(); ++i)
+			same = Equal(packed[i], batch.getInstances()[i]);
+		Check(same, "building again packs the same instances");
+
+		//Same mesh with another effect is another group
+		batch.Clear();
+		Check(batch.isEmpty() && batch.getGroups().empty() && batch.getInstances().empty(),
+			  "clear empties the batch");
+		batch.Add(MESH_PENTAGON, EFFECT_LIGHTING, faces[0]);
+		batch.Add(MESH_PENTAGON, EFFECT_BILBOARD, faces[1]);
+		batch.Add(MESH_PENTAGON, EFFECT_LIGHTING, faces[2]);
+		batch.Build();
+		Check(batch.getGroups().size() == 2 && batch.getGroups()[0].InstanceCount == 2 &&
+			  Equal(batch.getInstances()[1], faces[2]) && Equal(batch.getInstances()[2], faces[1]),
+			  "effect is part of the group");
+
+		const InstanceBatch::Statistics& stats = batch.getStatistics();
+		Check(stats.Batches == 3 && stats.Draws == 18 + 18 + 3 && stats.Groups == 4 + 4 + 2,
+			  "statistics of the builds");
+		printf("%zu draws in %zu instanced calls, %zu bytes of instances uploaded at once\n",
+			   packed.size(), calls, packed.size() * sizeof(DrawConstants));
+	}
+}
+
+int main()
+{
+	TestLayout();
+	TestGroups();
+	if (TestFailures() == 0)
+		printf("All instance batch checks passed\n");
+	return TestResult();
+}
@@ -0,0 +1,140 @@
+#include "gk2_butterflyScene.h"
+#include "gk2_testCheck.h"
+#include <cmath>
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+using namespace std;
+using namespace gk2;
+
+//Builds the reflection trees of Butterfly's dodecahedron with the shipped settings while the camera orbits it, checks
+//the stencil references and the order of the passes and reports the nodes per frame.
+
+namespace
+{
+	//Client size of the application's window
+	const float WIDTH = 800.0f;
+	const float HEIGHT = 800.0f;
+	const unsigned int FRAMES = 360;
+
+	void Check(bool condition, const char* what, unsigned int frame)
+	{
+		if (!gk2::Check(condition, what) && TestFailures() <= MAX_PRINTED_FAILURES)
+			printf("  in frame %u\n", frame);
+	}
+
+	bool Near(const XMMATRIX& a, const XMMATRIX& b)
+	{
+		XMFLOAT4X4 fa, fb;
+		XMStoreFloat4x4(&fa, a);
+		XMStoreFloat4x4(&fb, b);
+		for (int i = 0; i < 4; ++i)
+			for (int j = 0; j < 4; ++j)
+				if (fabsf(fa.m[i][j] - fb.m[i][j]) > 1e-4f)
+					return false;
+		return true;
+	}
+
+	//Reflection in the plane of the face, the way the mirror matrices were computed before the tree
+	XMMATRIX FaceReflection(unsigned int face)
+	{
+		XMMATRIX mtx = ButterflyScene::DodecahedronMatrix(face);
+		XMVECTOR det;
+		return XMMatrixInverse(&det, mtx) * XMMatrixScaling(1, 1, -1) * mtx;
+	}
+
+	void CheckTree(const ReflectionTree& tree, const MirrorVisibility& mirrors, unsigned int frame)
+	{
+		const ReflectionTree::Settings& settings = ButterflyScene::REFLECTION_SETTINGS;
+		const vector<ReflectionTree::Node>& nodes = tree.getNodes();
+		Check(nodes.size() <= settings.MaxNodes, "no more nodes than MaxNodes", frame);
+		vector<unsigned int> references;
+		for (unsigned int i = 0; i < nodes.size(); ++i)
+		{
+			const ReflectionTree::Node& n = nodes[i];
+			Check(n.Depth >= 1 && n.Depth <= settings.MaxDepth, "depth within MaxDepth", frame);
+			Check(n.Area >= settings.MinArea, "portals not smaller than MinArea", frame);
+			Check(n.StencilRef > 0 && n.StencilRef < (1u << ReflectionTree::STENCIL_BITS) &&
+				  n.Bits <= ReflectionTree::STENCIL_BITS && n.ParentBits < n.Bits, "references fit in 8 bits", frame);
+			Check(n.StencilRef < (1u << n.Bits) && n.StencilRef >> n.ParentBits != 0,
+				  "reference uses the node's own bits", frame);
+			for (auto it = references.begin(); it != references.end(); ++it)
+				Check(*it != n.StencilRef, "references are unique", frame);
+			references.push_back(n.StencilRef);
+			XMMATRIX reflection = XMLoadFloat4x4(&mirrors.getReflection(n.Mirror));
+			if (n.Parent == ReflectionTree::NO_NODE)
+				Check(n.Depth == 1 && n.ParentBits == 0, "roots are seen directly", frame);
+			else
+			{
+				const ReflectionTree::Node& p = nodes[n.Parent];
+				Check(n.Depth == p.Depth + 1 && n.ParentBits == p.Bits, "child is one level below its parent", frame);
+				Check((n.StencilRef & ((1u << n.ParentBits) - 1)) == p.StencilRef,
+					  "child's reference contains its parent's", frame);
+				Check(n.Mirror != p.Mirror, "a mirror doesn't see itself", frame);
+				reflection *= XMLoadFloat4x4(&p.Reflection);
+			}
+			Check(Near(XMLoadFloat4x4(&n.Reflection), reflection), "reflections compose along the path", frame);
+		}
+
+		//Every node has one stencil pass before the passes of its children and one scene pass after them
+		vector<int> stencilPass(nodes.size(), -1), scenePass(nodes.size(), -1);
+		const vector<ReflectionTree::Pass>& passes = tree.getPasses();
+		for (unsigned int i = 0; i < passes.size(); ++i)
+		{
+			vector<int>& pass = passes[i].Type == ReflectionTree::PASS_STENCIL ? stencilPass : scenePass;
+			Check(pass[passes[i].Node] == -1, "one pass of each type per node", frame);
+			pass[passes[i].Node] = static_cast<int>(i);
+		}
+		for (unsigned int i = 0; i < nodes.size(); ++i)
+		{
+			Check(stencilPass[i] != -1 && stencilPass[i] < scenePass[i], "stencil pass before the scene pass", frame);
+			if (nodes[i].Parent != ReflectionTree::NO_NODE)
+				Check(stencilPass[nodes[i].Parent] < stencilPass[i] && scenePass[i] < scenePass[nodes[i].Parent],
+					  "child's passes inside its parent's", frame);
+		}
+	}
+}
+
+int main()
+{
+	MirrorVisibility mirrors;
+	ButterflyScene::AddMirrors(mirrors);
+	for (unsigned int i = 0; i < ButterflyScene::FACES; ++i)
+		Check(Near(XMLoadFloat4x4(&mirrors.getReflection(i)), FaceReflection(i)),
+			  "mirror reflections are the reflections in the faces", 0);
+
+	Camera camera(0.01f, 100.0f);
+	ButterflyScene::InitializeCamera(camera);
+	XMMATRIX proj = ButterflyScene::ProjectionMatrix(WIDTH / HEIGHT);
+	ReflectionTree tree(ButterflyScene::REFLECTION_SETTINGS);
+	unsigned int depthNodes[ReflectionTree::STENCIL_BITS + 1] = { };
+	size_t passes = 0, maxNodes = 0;
+	//A full orbit around the vertical axis, tilted a little so that the top and bottom faces are seen at an angle
+	camera.Rotate(0.3f, 0.0f);
+	for (unsigned int frame = 0; frame < FRAMES; ++frame)
+	{
+		camera.Rotate(0.0f, XM_2PI / FRAMES);
+		tree.Build(mirrors, camera.GetViewMatrix(), proj, WIDTH, HEIGHT);
+		CheckTree(tree, mirrors, frame);
+		const vector<ReflectionTree::Node>& nodes = tree.getNodes();
+		for (auto it = nodes.begin(); it != nodes.end(); ++it)
+			++depthNodes[it->Depth];
+		passes += tree.getPasses().size();
+		maxNodes = max(maxNodes, nodes.size());
+	}
+
+	const ReflectionTree::Settings& settings = ButterflyScene::REFLECTION_SETTINGS;
+	//Portals of the first bounces are larger, they mustn't take all the stencil bits and nodes
+	Check(depthNodes[settings.MaxDepth] > 0, "reflections reach MaxDepth", FRAMES);
+	const ReflectionTree::Statistics& stats = tree.getStatistics();
+	double frames = stats.Frames;
+	printf("MaxDepth %u, MinArea %.0f px, MaxNodes %u, %.0fx%.0f, %u frames\n", settings.MaxDepth, settings.MinArea,
+		   settings.MaxNodes, WIDTH, HEIGHT, FRAMES);
+	printf("Nodes per frame: %.1f (most %zu), %.1f passes\n", stats.Nodes / frames, maxNodes, passes / frames);
+	for (unsigned int depth = 1; depth <= settings.MaxDepth; ++depth)
+		printf("  bounce %u: %.1f\n", depth, depthNodes[depth] / frames);
+	printf("Culled per frame: %.1f too small, %.1f over budget\n", stats.SmallNodes / frames,
+		   stats.OverBudgetNodes / frames);
+	return TestResult();
+}
@@ -0,0 +1,154 @@
+#include "gk2_testCheck.h"
+#include "gk2_uploadRing.h"
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+using namespace gk2;
+
+//Offsets UploadRing gives to the constant data of Butterfly's draws: alignment, wrapping to the beginning of the
+//buffer, reuse of the space of a frame only after the frames in flight have passed and uploads which don't fit.
+//Random frames are checked against a model of the ranges the GPU may still be reading.
+
+namespace
+{
+	const unsigned int SIZE = 4096;
+	const unsigned int FRAMES_IN_FLIGHT = 2;
+	const unsigned int ALIGNMENT = 256;
+	const unsigned int RANDOM_FRAMES = 20000;
+	//Up to 12 uploads of at most 768 aligned bytes, three such frames fit in the buffer of the random frames with
+	//the tail skipped by a wrap. Every eighth frame uploads much more and has to discard.
+	const unsigned int RANDOM_SIZE = 32768;
+	const unsigned int LARGE_FRAME_PERIOD = 8;
+
+	struct Range
+	{
+		unsigned int Offset;
+		unsigned int Size;
+		//Value of BeginFrame calls when it was allocated
+		unsigned int Frame;
+	};
+
+	void TestAlignment()
+	{
+		bool thrown = false;
+		try
+		{
+			UploadRing ring(SIZE, FRAMES_IN_FLIGHT, 48);
+		}
+		catch (const invalid_argument&)
+		{
+			thrown = true;
+		}
+		Check(thrown, "alignment which isn't a power of two is rejected");
+
+		UploadRing ring(SIZE, FRAMES_IN_FLIGHT, ALIGNMENT);
+		UploadRing::Allocation a = ring.Allocate(80);
+		Check(a.Offset == 0 && a.Mode == UploadRing::MAP_DISCARD, "first upload discards the buffer");
+		a = ring.Allocate(80);
+		Check(a.Offset == ALIGNMENT && a.Mode == UploadRing::MAP_NO_OVERWRITE, "next upload starts aligned");
+		Check(ring.getUsed() == ALIGNMENT + 80, "padding counts as used");
+		const UploadRing::Statistics& s = ring.getFrameStatistics();
+		Check(s.BytesUploaded == 160 && s.Maps == 2 && s.Discards == 1 && s.Wraps == 0, "frame statistics");
+	}
+
+	void TestWrap()
+	{
+		UploadRing ring(SIZE, FRAMES_IN_FLIGHT, ALIGNMENT);
+		//Frames of 1280 bytes: the third one ends at 3840, the fourth doesn't fit there
+		const unsigned int FRAME = 5 * ALIGNMENT;
+		vector<unsigned int> offsets;
+		for (unsigned int f = 0; f < 4; ++f)
+		{
+			ring.BeginFrame();
+			offsets.push_back(ring.Allocate(FRAME).Offset);
+		}
+		Check(offsets[0] == 0 && offsets[1] == FRAME && offsets[2] == 2 * FRAME, "frames follow each other");
+		Check(offsets[3] == 0, "upload which doesn't fit at the end wraps to the beginning");
+		const UploadRing::Statistics& total = ring.getTotalStatistics();
+		Check(total.Wraps == 1 && total.Discards == 1, "wrap reuses the first frame without a discard");
+		//Skipped tail is used until the frame which wrapped retires
+		Check(ring.getUsed() == 2 * FRAME + (SIZE - 3 * FRAME) + FRAME, "skipped tail counts as used");
+	}
+
+	void TestOversize()
+	{
+		UploadRing ring(SIZE, FRAMES_IN_FLIGHT, ALIGNMENT);
+		bool thrown = false;
+		try
+		{
+			ring.Allocate(SIZE + 1);
+		}
+		catch (const length_error&)
+		{
+			thrown = true;
+		}
+		Check(thrown, "upload larger than the buffer is rejected");
+		Check(ring.getFrameStatistics().Maps == 0 && ring.getUsed() == 0, "rejected upload changes nothing");
+		ring.Allocate(ALIGNMENT);
+		UploadRing::Allocation a = ring.Allocate(SIZE);
+		Check(a.Offset == 0 && a.Mode == UploadRing::MAP_DISCARD, "upload of the whole buffer discards it");
+		Check(ring.getUsed() == SIZE, "whole buffer is used");
+	}
+
+	//Space of a frame is given out again only after FRAMES_IN_FLIGHT more frames have begun or after a discard,
+	//which gives the buffer new memory
+	void TestReuse()
+	{
+		UploadRing ring(RANDOM_SIZE, FRAMES_IN_FLIGHT, ALIGNMENT);
+		mt19937 random(38);
+		uniform_int_distribution<unsigned int> uploads(0, 12), largeUploads(60, 80), sizes(1, 600);
+		vector<Range> inFlight;
+		unsigned int frame = 0, discards = 0, ordinaryDiscards = 0, overlaps = 0, outside = 0, unaligned = 0;
+		for (unsigned int f = 0; f < RANDOM_FRAMES; ++f)
+		{
+			ring.BeginFrame();
+			++frame;
+			vector<Range> kept;
+			for (auto it = inFlight.begin(); it != inFlight.end(); ++it)
+				if (frame - it->Frame <= FRAMES_IN_FLIGHT)
+					kept.push_back(*it);
+			inFlight.swap(kept);
+			unsigned int phase = f % LARGE_FRAME_PERIOD;
+			unsigned int count = phase == LARGE_FRAME_PERIOD - 1 ? largeUploads(random) : uploads(random);
+			//Neither this frame nor the ones in flight are large
+			bool ordinary = f > 0 && phase >= FRAMES_IN_FLIGHT && phase < LARGE_FRAME_PERIOD - 1;
+			for (unsigned int i = 0; i < count; ++i)
+			{
+				Range r = { 0, sizes(random), frame };
+				UploadRing::Allocation a = ring.Allocate(r.Size);
+				r.Offset = a.Offset;
+				if (a.Mode == UploadRing::MAP_DISCARD)
+				{
+					++discards;
+					ordinaryDiscards += ordinary ? 1 : 0;
+					inFlight.clear();
+				}
+				unaligned += r.Offset % ALIGNMENT != 0 ? 1 : 0;
+				outside += r.Offset + r.Size > RANDOM_SIZE ? 1 : 0;
+				for (auto it = inFlight.begin(); it != inFlight.end(); ++it)
+					if (r.Offset < it->Offset + it->Size && it->Offset < r.Offset + r.Size)
+						++overlaps;
+				inFlight.push_back(r);
+			}
+		}
+		Check(unaligned == 0 && outside == 0, "uploads are aligned and inside the buffer");
+		Check(overlaps == 0, "space isn't reused while the GPU may read it");
+		const UploadRing::Statistics& total = ring.getTotalStatistics();
+		Check(total.Discards == discards, "discards are counted");
+		Check(ordinaryDiscards == 0, "ordinary frames reuse retired space without discarding");
+		Check(discards > RANDOM_FRAMES / LARGE_FRAME_PERIOD / 2, "large frames discard");
+		printf("Random frames: %u uploads, %u discards, %u wraps\n", total.Maps, total.Discards, total.Wraps);
+	}
+}
+
+int main()
+{
+	TestAlignment();
+	TestWrap();
+	TestOversize();
+	TestReuse();
+	return TestResult();
+}
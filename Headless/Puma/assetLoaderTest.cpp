@@ -0,0 +1,188 @@
+#include "gk2_assetLoader.h"
+#include "gk2_meshData.h"
+#include "gk2_pumaScene.h"
+#include "gk2_testCheck.h"
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <string>
+#include <thread>
+
+using namespace std;
+using namespace gk2;
+
+//Loads the textures and meshes of Puma one after another and then through AssetLoader, checks that both give the
+//same results and reports the wall time and the time the calling (render) thread spends on them.
+//Usage: puma_asset_loader <resources directory> [workers]
+
+namespace
+{
+	const char* TEXTURES[] = { "stones.jpg", "sun.jpg", "metal.jpg", "smoke.png", "smokecolors.png",
+							   "light_cookie.png", "spark.png", "lava.jpg" };
+	const unsigned int TEXTURES_COUNT = sizeof(TEXTURES) / sizeof(TEXTURES[0]);
+	const unsigned int MESHES_COUNT = 6;
+
+	typedef pair<MeshData, MeshData> PumaMeshData;
+	typedef chrono::steady_clock Clock;
+
+	struct Assets
+	{
+		vector<BYTE> Textures[TEXTURES_COUNT];
+		PumaMeshData Meshes[MESHES_COUNT];
+	};
+
+	double Milliseconds(Clock::duration d)
+	{
+		return chrono::duration<double, milli>(d).count();
+	}
+
+	//Arguments are UTF-8, the loader takes whole code points
+	wstring Widen(const string& s)
+	{
+		wstring w;
+		for (size_t i = 0; i < s.size(); ++i)
+		{
+			unsigned int c = static_cast<unsigned char>(s[i]);
+			unsigned int continuation = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0;
+			if (continuation)
+				c &= 0x3F >> continuation;
+			for (; continuation && i + 1 < s.size(); --continuation)
+				c = (c << 6) | (static_cast<unsigned char>(s[++i]) & 0x3F);
+			w += static_cast<wchar_t>(c);
+		}
+		return w;
+	}
+
+	wstring TextureFile(const string& resourcesDir, unsigned int i)
+	{
+		return Widen(resourcesDir + "/textures/" + TEXTURES[i]);
+	}
+
+	PumaMeshData ParseMesh(const string& resourcesDir, unsigned int i)
+	{
+		string fileName = resourcesDir + "/meshes/mesh" + to_string(i + 1) + ".txt";
+		ifstream input;
+		input.exceptions(ios::badbit | ios::failbit | ios::eofbit);
+		input.open(fileName);
+		PumaMeshData mesh;
+		MeshData::ParsePuma(input, PumaScene::LIGHT_POS, mesh.first, mesh.second);
+		return mesh;
+	}
+
+	double LoadSequentially(const string& resourcesDir, Assets& assets)
+	{
+		Clock::time_point start = Clock::now();
+		for (unsigned int i = 0; i < TEXTURES_COUNT; ++i)
+			assets.Textures[i] = AssetLoader::CookTexture(TextureFile(resourcesDir, i));
+		for (unsigned int i = 0; i < MESHES_COUNT; ++i)
+			assets.Meshes[i] = ParseMesh(resourcesDir, i);
+		return Milliseconds(Clock::now() - start);
+	}
+
+	//Same jobs and finalizers as Room, the finalizers only keep the results. Time spent in Finalize is returned
+	//through busy, zero workers are replaced by the number the loader started.
+	double LoadConcurrently(const string& resourcesDir, unsigned int& workers, Assets& assets, double& busy)
+	{
+		Clock::time_point start = Clock::now();
+		Clock::duration finalizing(0);
+		{
+			AssetLoader loader(workers);
+			workers = loader.getWorkersCount();
+			for (unsigned int i = 0; i < TEXTURES_COUNT; ++i)
+			{
+				wstring fileName = TextureFile(resourcesDir, i);
+				shared_future<vector<BYTE>> dds = loader.Load<vector<BYTE>>([fileName]()
+				{
+					return AssetLoader::CookTexture(fileName);
+				});
+				vector<BYTE>& texture = assets.Textures[i];
+				loader.WhenReady<vector<BYTE>>(dds, [&texture](const vector<BYTE>& cooked) { texture = cooked; });
+			}
+			for (unsigned int i = 0; i < MESHES_COUNT; ++i)
+			{
+				shared_future<PumaMeshData> data = loader.Load<PumaMeshData>([resourcesDir, i]()
+				{
+					return ParseMesh(resourcesDir, i);
+				});
+				PumaMeshData& mesh = assets.Meshes[i];
+				loader.WhenReady<PumaMeshData>(data, [&mesh](const PumaMeshData& parsed) { mesh = parsed; });
+			}
+			//Render loop calls Finalize once per frame
+			while (true)
+			{
+				Clock::time_point frame = Clock::now();
+				unsigned int remaining = loader.Finalize();
+				finalizing += Clock::now() - frame;
+				if (remaining == 0)
+					break;
+				this_thread::sleep_for(chrono::milliseconds(1));
+			}
+		}
+		busy = Milliseconds(finalizing);
+		return Milliseconds(Clock::now() - start);
+	}
+
+	bool Equal(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+
+	//Normals of the shadow volumes are never written, so they are compared only for the meshes
+	bool Equal(const MeshData& a, const MeshData& b, bool normals)
+	{
+		if (a.Indices != b.Indices || a.Vertices.size() != b.Vertices.size())
+			return false;
+		for (size_t i = 0; i < a.Vertices.size(); ++i)
+			if (!Equal(a.Vertices[i].Pos, b.Vertices[i].Pos) ||
+				(normals && !Equal(a.Vertices[i].Normal, b.Vertices[i].Normal)))
+				return false;
+		return true;
+	}
+
+	void Compare(const Assets& expected, const Assets& loaded)
+	{
+		for (unsigned int i = 0; i < TEXTURES_COUNT; ++i)
+			Check(!loaded.Textures[i].empty() && loaded.Textures[i] == expected.Textures[i],
+				  "textures cooked by the workers are the same");
+		for (unsigned int i = 0; i < MESHES_COUNT; ++i)
+			Check(!loaded.Meshes[i].first.Indices.empty() &&
+				  Equal(loaded.Meshes[i].first, expected.Meshes[i].first, true) &&
+				  Equal(loaded.Meshes[i].second, expected.Meshes[i].second, false),
+				  "meshes parsed by the workers are the same");
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		printf("Usage: %s <resources directory> [workers]\n", argv[0]);
+		return 1;
+	}
+	string resourcesDir = argv[1];
+	unsigned int workers = argc > 2 ? static_cast<unsigned int>(stoul(argv[2])) : 0;
+	try
+	{
+		Assets expected;
+		double sequential = LoadSequentially(resourcesDir, expected);
+		Assets loaded;
+		double busy;
+		double concurrent = LoadConcurrently(resourcesDir, workers, loaded, busy);
+		Compare(expected, loaded);
+		size_t bytes = 0;
+		for (unsigned int i = 0; i < TEXTURES_COUNT; ++i)
+			bytes += expected.Textures[i].size();
+		printf("%u textures (%zu KB cooked) and %u meshes, %u hardware threads, %u workers\n", TEXTURES_COUNT,
+			   bytes / 1024, MESHES_COUNT, thread::hardware_concurrency(), workers);
+		printf("Sequential: %.1f ms, all of it on the render thread\n", sequential);
+		printf("AssetLoader: %.1f ms until the last finalizer, %.2f ms of it on the render thread\n", concurrent,
+			   busy);
+	}
+	catch (const exception& e)
+	{
+		printf("FAILED: %s\n", e.what());
+		return 1;
+	}
+	return TestResult();
+}
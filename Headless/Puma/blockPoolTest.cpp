@@ -0,0 +1,187 @@
+#include "gk2_aligned.h"
+#include "gk2_testCheck.h"
+#include <xnamath.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace gk2;
+
+//Checks the aligned heap, the blocks of BlockPool (alignment, reuse of freed blocks, growth by chunks and threads
+//allocating at once) and the classes deriving from PoolNew, including an object created while the globals are
+//initialized, before the pool could have been constructed as a global itself.
+
+namespace
+{
+	const unsigned int THREADS = 4;
+	const unsigned int THREAD_OPERATIONS = 100000;
+	//Blocks a thread holds at most
+	const unsigned int THREAD_BLOCKS = 100;
+
+	struct Particle : public PoolNew<Particle>
+	{
+		XMVECTOR Position;
+		unsigned int Id;
+	};
+
+	//Different size, goes to the aligned heap
+	struct TrailParticle : public Particle
+	{
+		XMVECTOR Trail[4];
+	};
+
+	//Created before main
+	Particle* const EARLY_PARTICLE = new Particle();
+
+	void TestAlignedMemory()
+	{
+		unsigned int unaligned = 0;
+		for (size_t alignment = 16; alignment <= 4096; alignment *= 2)
+		{
+			void* ptr = AlignedMemory::Allocate(100, alignment);
+			unaligned += AlignedMemory::IsAligned(ptr, alignment) ? 0 : 1;
+			AlignedMemory::Free(ptr);
+		}
+		Check(unaligned == 0, "aligned heap honors alignments up to a page");
+		void* a = AlignedMemory::Allocate(0);
+		void* b = AlignedMemory::Allocate(0);
+		Check(a != nullptr && b != nullptr && a != b, "empty allocations are distinct");
+		AlignedMemory::Free(a);
+		AlignedMemory::Free(b);
+		AlignedVector<XMMATRIX> matrices(33);
+		Check(AlignedMemory::IsAligned(matrices.data()), "aligned vector");
+	}
+
+	void TestBlocks()
+	{
+		const size_t BLOCK_SIZE = 24, BLOCKS_PER_CHUNK = 8, ALIGNMENT = 32;
+		BlockPool pool(BLOCK_SIZE, BLOCKS_PER_CHUNK, ALIGNMENT);
+		Check(pool.getCapacity() == 0 && pool.getUsedBlocks() == 0, "pool starts empty");
+		vector<unsigned char*> blocks;
+		unsigned int unaligned = 0;
+		for (unsigned int i = 0; i < 20; ++i)
+		{
+			blocks.push_back(static_cast<unsigned char*>(pool.Allocate()));
+			unaligned += AlignedMemory::IsAligned(blocks.back(), ALIGNMENT) ? 0 : 1;
+			memset(blocks.back(), i, BLOCK_SIZE);
+		}
+		unsigned int overwritten = 0;
+		for (unsigned int i = 0; i < blocks.size(); ++i)
+		{
+			size_t same = count(blocks[i], blocks[i] + BLOCK_SIZE, static_cast<unsigned char>(i));
+			overwritten += same == BLOCK_SIZE ? 0 : 1;
+		}
+		Check(unaligned == 0, "blocks are aligned");
+		Check(overwritten == 0, "blocks don't overlap");
+		Check(pool.getUsedBlocks() == 20 && pool.getCapacity() == 3 * BLOCKS_PER_CHUNK, "pool grows by chunks");
+		Check(blocks[1] - blocks[0] == ALIGNMENT && blocks[7] - blocks[0] == 7 * ALIGNMENT,
+			  "blocks of a chunk are handed out in the order of addresses");
+
+		pool.Free(blocks[5]);
+		pool.Free(blocks[12]);
+		pool.Free(nullptr);
+		Check(pool.getUsedBlocks() == 18, "freed blocks are counted");
+		Check(pool.Allocate() == blocks[12] && pool.Allocate() == blocks[5], "freed blocks are handed out again");
+		Check(pool.getCapacity() == 3 * BLOCKS_PER_CHUNK, "reuse doesn't grow the pool");
+		for (auto it = blocks.begin(); it != blocks.end(); ++it)
+			pool.Free(*it);
+		Check(pool.getUsedBlocks() == 0, "every block is given back");
+
+		//Blocks smaller than a free list link still hold one
+		BlockPool tiny(1, 4, 8);
+		void* first = tiny.Allocate();
+		void* second = tiny.Allocate();
+		Check(static_cast<char*>(second) - static_cast<char*>(first) >= static_cast<ptrdiff_t>(sizeof(void*)),
+			  "small blocks hold the free list link");
+		tiny.Free(first);
+		tiny.Free(second);
+	}
+
+	//Threads hold a random number of blocks each, filled with their own values
+	void TestThreads()
+	{
+		BlockPool pool(sizeof(XMMATRIX), 32);
+		vector<unsigned int> overwritten(THREADS, 0);
+		vector<thread> threads;
+		for (unsigned int t = 0; t < THREADS; ++t)
+			threads.push_back(thread([&, t]()
+			{
+				mt19937 random(49 + t);
+				uniform_int_distribution<unsigned int> hold(0, THREAD_BLOCKS);
+				vector<XMMATRIX*> held;
+				for (unsigned int i = 0; i < THREAD_OPERATIONS; ++i)
+				{
+					if (held.size() < hold(random))
+					{
+						held.push_back(static_cast<XMMATRIX*>(pool.Allocate()));
+						memset(held.back(), static_cast<int>(t), sizeof(XMMATRIX));
+					}
+					else if (!held.empty())
+					{
+						const unsigned char* bytes = reinterpret_cast<const unsigned char*>(held.back());
+						overwritten[t] += count(bytes, bytes + sizeof(XMMATRIX), static_cast<unsigned char>(t)) ==
+										  sizeof(XMMATRIX) ? 0 : 1;
+						pool.Free(held.back());
+						held.pop_back();
+					}
+				}
+				for (auto it = held.begin(); it != held.end(); ++it)
+					pool.Free(*it);
+			}));
+		for (auto it = threads.begin(); it != threads.end(); ++it)
+			it->join();
+		unsigned int total = 0;
+		for (auto it = overwritten.begin(); it != overwritten.end(); ++it)
+			total += *it;
+		Check(total == 0, "blocks held by one thread aren't handed to another");
+		Check(pool.getUsedBlocks() == 0, "threads give back every block");
+		Check(pool.getCapacity() <= THREADS * THREAD_BLOCKS + 32, "pool holds no more than the threads held at once");
+		printf("%u blocks for %u threads holding up to %u each\n", static_cast<unsigned int>(pool.getCapacity()),
+			   THREADS, THREAD_BLOCKS);
+	}
+
+	void TestPoolNew()
+	{
+		const BlockPool& pool = Particle::getPool();
+		Check(pool.getBlockSize() == sizeof(Particle), "pool of the class has its size");
+		Check(pool.getUsedBlocks() == 1 && pool.getCapacity() > 0, "object created before main is in the pool");
+		delete EARLY_PARTICLE;
+		Check(pool.getUsedBlocks() == 0, "object created before main goes back to the pool");
+
+		vector<Particle*> particles;
+		unsigned int unaligned = 0;
+		for (unsigned int i = 0; i < 1000; ++i)
+		{
+			particles.push_back(new Particle());
+			particles.back()->Id = i;
+			unaligned += AlignedMemory::IsAligned(particles.back()) ? 0 : 1;
+		}
+		Check(unaligned == 0 && pool.getUsedBlocks() == 1000, "objects come from the pool aligned");
+		TrailParticle* trail = new TrailParticle();
+		Check(pool.getUsedBlocks() == 1000 && AlignedMemory::IsAligned(trail), "larger derived objects go to the heap");
+		delete trail;
+		Particle* array = new Particle[10];
+		Check(pool.getUsedBlocks() == 1000 && AlignedMemory::IsAligned(array), "arrays go to the heap");
+		delete[] array;
+		bool ids = true;
+		for (unsigned int i = 0; i < particles.size(); ++i)
+		{
+			ids = ids && particles[i]->Id == i;
+			delete particles[i];
+		}
+		Check(ids && pool.getUsedBlocks() == 0, "objects go back to the pool");
+	}
+}
+
+int main()
+{
+	TestAlignedMemory();
+	TestBlocks();
+	TestThreads();
+	TestPoolNew();
+	return TestResult();
+}
@@ -0,0 +1,254 @@
+#include "gk2_frameArena.h"
+#include "gk2_testCheck.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace gk2;
+
+//Allocates random temporaries from arenas with small blocks over many frames and checks alignment, that live
+//allocations don't overlap, that the blocks are merged so frames which fit don't grow the arena, that scopes give
+//their memory back, the frame and scope peaks, poisoning of freed memory, containers using the arena and the arenas
+//of threads.
+
+namespace
+{
+	const size_t BLOCK_SIZE = 4096;
+	const unsigned int FRAMES = 200;
+	const unsigned int FRAME_ALLOCATIONS = 64;
+
+	struct Allocation
+	{
+		unsigned char* Data;
+		size_t Size;
+		unsigned char Value;
+	};
+
+	bool IsAligned(const void* p, size_t alignment)
+	{
+		return reinterpret_cast<uintptr_t>(p) % alignment == 0;
+	}
+
+	//Allocations are filled with their own values, an overlap overwrites the value of another one
+	unsigned int Overwritten(const vector<Allocation>& allocations)
+	{
+		unsigned int overwritten = 0;
+		for (auto it = allocations.begin(); it != allocations.end(); ++it)
+			for (size_t i = 0; i < it->Size; ++i)
+				if (it->Data[i] != it->Value)
+				{
+					++overwritten;
+					break;
+				}
+		return overwritten;
+	}
+
+	template<typename Action>
+	bool ThrowsBadAlloc(Action action)
+	{
+		try
+		{
+			action();
+		}
+		catch (const bad_alloc&)
+		{
+			return true;
+		}
+		return false;
+	}
+
+	//Random sizes and alignments up to 256 bytes
+	void TestAlignment()
+	{
+		FrameArena arena(BLOCK_SIZE);
+		mt19937 random(48);
+		uniform_int_distribution<size_t> sizes(1, 600), alignments(4, 8);
+		vector<Allocation> allocations;
+		unsigned int unaligned = 0, overwritten = 0, wrongUsed = 0;
+		for (unsigned int f = 0; f < FRAMES; ++f)
+		{
+			allocations.clear();
+			size_t payload = 0;
+			for (unsigned int i = 0; i < FRAME_ALLOCATIONS; ++i)
+			{
+				size_t alignment = size_t(1) << alignments(random);
+				Allocation a = { nullptr, sizes(random), static_cast<unsigned char>(i) };
+				a.Data = static_cast<unsigned char*>(arena.Allocate(a.Size, alignment));
+				unaligned += IsAligned(a.Data, alignment) ? 0 : 1;
+				memset(a.Data, a.Value, a.Size);
+				allocations.push_back(a);
+				payload += a.Size;
+			}
+			overwritten += Overwritten(allocations);
+			wrongUsed += arena.getUsedBytes() >= payload ? 0 : 1;
+			arena.Reset();
+		}
+		Check(unaligned == 0, "allocations are aligned");
+		Check(overwritten == 0, "allocations of a frame don't overlap");
+		Check(wrongUsed == 0, "used bytes cover the allocations");
+		Check(arena.getUsedBytes() == 0 && arena.getLastFramePeak() > 0, "reset frees everything");
+	}
+
+	//Sizes are multiples of the alignment, so a frame takes exactly its payload once it fits into one block
+	void TestGrowth()
+	{
+		FrameArena arena(BLOCK_SIZE);
+		mt19937 random(48);
+		uniform_int_distribution<size_t> sizes(1, 40);
+		uniform_int_distribution<unsigned int> counts(FRAME_ALLOCATIONS / 2, FRAME_ALLOCATIONS * 3 / 2);
+		size_t capacityAfterFirst = 0;
+		unsigned int grownFrames = 0, wrongGrowth = 0;
+		for (unsigned int f = 0; f < FRAMES; ++f)
+		{
+			size_t capacity = arena.getCapacity(), payload = 0;
+			for (unsigned int i = counts(random); i > 0; --i)
+			{
+				size_t size = sizes(random) * FrameArena::ALIGNMENT;
+				arena.Allocate(size);
+				payload += size;
+			}
+			if (f == 0)
+				capacityAfterFirst = arena.getCapacity();
+			else if (arena.getCapacity() > capacity)
+			{
+				++grownFrames;
+				wrongGrowth += payload <= capacity ? 1 : 0;
+			}
+			arena.Reset();
+		}
+		Check(capacityAfterFirst > BLOCK_SIZE, "first frame grows the arena by blocks");
+		Check(wrongGrowth == 0, "frames which fit into the merged block don't grow the arena");
+		Check(grownFrames < FRAMES / 10, "arena stops growing");
+		printf("Capacity %zu bytes after the first frame, %zu after %u frames, %u of which grew it\n",
+			   capacityAfterFirst, arena.getCapacity(), FRAMES, grownFrames);
+	}
+
+	void TestScopes()
+	{
+		FrameArena arena(BLOCK_SIZE);
+		arena.Allocate(100);
+		size_t used = arena.getUsedBytes();
+		void* inner = nullptr;
+		{
+			FrameArena::Scope scope(arena);
+			arena.Allocate(1000);
+			size_t scoped = arena.getUsedBytes();
+			{
+				FrameArena::Scope nested(arena);
+				//Larger than a block, so the scope spans blocks
+				inner = arena.Allocate(3 * BLOCK_SIZE);
+				Check(arena.getUsedBytes() > 3 * BLOCK_SIZE, "allocation larger than a block");
+			}
+			Check(arena.getUsedBytes() == scoped, "nested scope gives back its memory");
+			Check(arena.Allocate(3 * BLOCK_SIZE) == inner, "block left by a scope is reused");
+		}
+		Check(arena.getUsedBytes() == used, "scope gives back its memory");
+		//Thread which never ends a frame keeps its peak through the scopes
+		Check(arena.getPeakBytes() > 3 * BLOCK_SIZE && arena.getLastFramePeak() == 0, "scopes keep the peak");
+		arena.Reset();
+		Check(arena.getLastFramePeak() > 3 * BLOCK_SIZE, "frame peak includes the scopes");
+
+		Check(ThrowsBadAlloc([&]() { arena.AllocateArray<double>(static_cast<size_t>(-1) / 4); }),
+			  "array whose size overflows is rejected");
+		Check(ThrowsBadAlloc([&]() { arena.Allocate(static_cast<size_t>(-1) - 4); }),
+			  "allocation whose padding overflows is rejected");
+		Check(arena.getUsedBytes() == 0, "rejected allocations take nothing");
+	}
+
+	void TestPoisoning()
+	{
+		FrameArena arena(BLOCK_SIZE);
+		arena.setPoisoning(true);
+		unsigned char* kept = static_cast<unsigned char*>(arena.Allocate(64));
+		memset(kept, 1, 64);
+		vector<Allocation> freed;
+		{
+			FrameArena::Scope scope(arena);
+			for (unsigned int i = 0; i < 8; ++i)
+			{
+				Allocation a = { nullptr, BLOCK_SIZE / 3, 2 };
+				a.Data = static_cast<unsigned char*>(arena.Allocate(a.Size));
+				memset(a.Data, a.Value, a.Size);
+				freed.push_back(a);
+			}
+		}
+		unsigned int poisoned = 0;
+		for (auto it = freed.begin(); it != freed.end(); ++it)
+		{
+			it->Value = FrameArena::POISON;
+			poisoned += Overwritten(vector<Allocation>(1, *it)) == 0 ? 1 : 0;
+		}
+		Allocation k = { kept, 64, 1 };
+		Check(poisoned == freed.size(), "memory freed by a scope is poisoned in every block");
+		Check(Overwritten(vector<Allocation>(1, k)) == 0, "memory before the scope is kept");
+		//Merges the blocks, the next frame stays in the merged one
+		arena.Reset();
+		k.Data = static_cast<unsigned char*>(arena.Allocate(64));
+		memset(k.Data, 1, 64);
+		arena.Reset();
+		k.Value = FrameArena::POISON;
+		Check(Overwritten(vector<Allocation>(1, k)) == 0, "reset poisons the frame");
+	}
+
+	void TestContainers()
+	{
+		FrameArena arena(BLOCK_SIZE);
+		FrameAllocator<int> allocator(arena);
+		FrameVector<int> values(allocator);
+		for (int i = 0; i < 10000; ++i)
+			values.push_back(i);
+		bool ordered = true;
+		for (int i = 0; i < 10000; ++i)
+			ordered = ordered && values[i] == i;
+		Check(ordered, "vector grows in the arena");
+		Check(arena.getUsedBytes() >= 10000 * sizeof(int) && IsAligned(values.data(), FrameArena::ALIGNMENT),
+			  "vector takes its memory from the arena");
+		FrameAllocator<double> rebound(allocator);
+		Check(rebound == allocator && FrameAllocator<int>(arena) != FrameAllocator<int>(),
+			  "allocators of the same arena are equal");
+	}
+
+	void TestThreadArenas()
+	{
+		FrameArena& main = FrameArena::getThreadArena();
+		Check(&main == &FrameArena::getThreadArena(), "thread keeps its arena");
+		main.Allocate(100);
+		FrameArena* other = nullptr;
+		size_t otherUsed = 0;
+		thread loader([&]()
+		{
+			other = &FrameArena::getThreadArena();
+			FrameArena::Scope scope;
+			FrameArena::getThreadArena().Allocate(2000);
+			//Ends the frame of this thread only
+			FrameArena::EndFrame();
+			other->Allocate(300);
+			otherUsed = other->getUsedBytes();
+		});
+		loader.join();
+		Check(other != nullptr && other != &main, "threads have their own arenas");
+		Check(otherUsed >= 300 && otherUsed < 2000 && main.getUsedBytes() >= 100, "end of frame resets one thread");
+		FrameArena::EndFrame();
+		Check(main.getUsedBytes() == 0 && main.getLastFramePeak() >= 100, "main loop ends its frame");
+		wostringstream statistics;
+		FrameArena::WriteStatistics(statistics);
+		Check(statistics.str().find(L"Thread 2: ") != wstring::npos, "statistics list every thread");
+	}
+}
+
+int main()
+{
+	TestAlignment();
+	TestGrowth();
+	TestScopes();
+	TestPoisoning();
+	TestContainers();
+	TestThreadArenas();
+	return TestResult();
+}
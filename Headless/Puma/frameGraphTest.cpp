@@ -0,0 +1,315 @@
+#include "gk2_frameGraph.h"
+#include "gk2_testCheck.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+using namespace gk2;
+
+//Compiles small frame graphs and checks the order of the passes, the culled passes, the physical textures and the
+//rejection of cycles, then compiles random graphs and checks them against the dependencies, the culling and the
+//lifetimes of the textures worked out again from the passes as they were added.
+
+namespace
+{
+	const FrameGraph::TextureDesc SCREEN = { 1024, 768, 28, 40 };
+	const FrameGraph::TextureDesc SHADOW = { 512, 512, 41, 72 };
+	const unsigned int RANDOM_GRAPHS = 2000;
+	const unsigned int MAX_PASSES = 12;
+	const unsigned int MAX_RESOURCES = 8;
+
+	unsigned int Position(const vector<unsigned int>& order, unsigned int pass)
+	{
+		return static_cast<unsigned int>(find(order.begin(), order.end(), pass) - order.begin());
+	}
+
+	bool RunsBefore(const FrameGraph& graph, unsigned int first, unsigned int second)
+	{
+		const vector<unsigned int>& order = graph.getOrder();
+		return Position(order, first) < Position(order, second) && Position(order, second) < order.size();
+	}
+
+	//Shadow map, scene drawn with it to a texture and copied to the back buffer, and a blurred copy of the scene
+	//which nothing reads
+	void CheckSmallGraph()
+	{
+		FrameGraph graph;
+		vector<unsigned int> executed;
+		unsigned int backBuffer = graph.Import("BackBuffer");
+		unsigned int shadowMap = graph.Create("ShadowMap", SHADOW);
+		unsigned int scene = graph.Create("Scene", SCREEN);
+		unsigned int blurred = graph.Create("Blurred", SCREEN);
+		graph.MarkOutput(backBuffer);
+		const char* names[] = { "Blur", "Shadow", "Scene", "Present" };
+		unsigned int passes[4];
+		for (unsigned int i = 0; i < 4; ++i)
+			passes[i] = graph.AddPass(names[i], [&executed, i]() { executed.push_back(i); });
+		unsigned int blur = passes[0], shadow = passes[1], draw = passes[2], present = passes[3];
+		//Blur is added first, but reads the scene as it was before it's drawn
+		graph.Read(blur, scene);
+		graph.Write(blur, blurred);
+		graph.Write(shadow, shadowMap);
+		graph.Read(draw, shadowMap);
+		graph.Write(draw, scene);
+		graph.Read(present, scene);
+		graph.Write(present, backBuffer);
+		graph.Compile();
+
+		Check(!graph.isCulled(shadow) && !graph.isCulled(draw) && !graph.isCulled(present), "passes of the output");
+		Check(graph.isCulled(blur), "pass whose results nothing reads is culled");
+		Check(graph.getOrder().size() == 3 && RunsBefore(graph, shadow, draw) && RunsBefore(graph, draw, present),
+			  "passes run after the passes whose results they use");
+		Check(graph.getPassName(draw) == names[2], "pass keeps its name");
+		Check(graph.getPhysical(backBuffer) == FrameGraph::NO_PHYSICAL &&
+			  graph.getPhysical(blurred) == FrameGraph::NO_PHYSICAL, "imported and unused textures aren't allocated");
+		Check(graph.getPhysicalTextures().size() == 2 && graph.getPhysical(shadowMap) != graph.getPhysical(scene),
+			  "textures of different sizes don't share memory");
+
+		graph.Execute();
+		Check(executed.size() == 3 && executed[0] == 1 && executed[1] == 2 && executed[2] == 3,
+			  "passes execute in order, culled passes don't");
+		Check(graph.getTimeline().size() == 3 && graph.getTimeline()[0].Pass == shadow, "timeline of the passes");
+	}
+
+	//Chain of passes each reading the previous texture. Textures whose lifetimes don't overlap share memory.
+	void CheckAliasing()
+	{
+		FrameGraph graph;
+		unsigned int backBuffer = graph.Import("BackBuffer");
+		graph.MarkOutput(backBuffer);
+		unsigned int textures[4];
+		unsigned int previous = 0;
+		for (unsigned int i = 0; i < 4; ++i)
+		{
+			textures[i] = graph.Create("Texture", SCREEN);
+			unsigned int pass = graph.AddPass("Step", nullptr);
+			if (i > 0)
+				graph.Read(pass, textures[i - 1]);
+			graph.Write(pass, textures[i]);
+			previous = pass;
+		}
+		unsigned int present = graph.AddPass("Present", nullptr);
+		graph.Read(present, textures[3]);
+		graph.Write(present, backBuffer);
+		graph.Compile();
+		Check(RunsBefore(graph, previous, present), "chain runs in order");
+		//Texture i is alive from step i to step i + 1
+		Check(graph.getPhysicalTextures().size() == 2, "chain of textures needs two of them");
+		Check(graph.getPhysical(textures[0]) == graph.getPhysical(textures[2]) &&
+			  graph.getPhysical(textures[1]) == graph.getPhysical(textures[3]) &&
+			  graph.getPhysical(textures[0]) != graph.getPhysical(textures[1]), "textures alternate");
+
+		//Transient output keeps its texture to the end of the frame
+		FrameGraph output;
+		unsigned int first = output.Create("First", SCREEN), second = output.Create("Second", SCREEN);
+		output.MarkOutput(first);
+		output.MarkOutput(second);
+		output.Write(output.AddPass("WriteFirst", nullptr), first);
+		output.Write(output.AddPass("WriteSecond", nullptr), second);
+		output.Compile();
+		Check(output.getPhysical(first) != output.getPhysical(second), "outputs don't share memory");
+	}
+
+	void CheckDependencies()
+	{
+		FrameGraph graph;
+		unsigned int backBuffer = graph.Import("BackBuffer");
+		graph.MarkOutput(backBuffer);
+		unsigned int stencil = graph.AddPass("Stencil", nullptr);
+		unsigned int mirror = graph.AddPass("Mirror", nullptr);
+		graph.Write(stencil, backBuffer);
+		graph.Write(mirror, backBuffer);
+		graph.Compile();
+		Check(RunsBefore(graph, stencil, mirror) && !graph.isCulled(stencil),
+			  "earlier writes of an output are kept and run first");
+
+		//Light pass drawing to another texture added after the pass using it through state the graph doesn't see
+		FrameGraph state;
+		backBuffer = state.Import("BackBuffer");
+		unsigned int lights = state.Import("Lights");
+		state.MarkOutput(backBuffer);
+		state.MarkOutput(lights);
+		unsigned int draw = state.AddPass("Draw", nullptr);
+		unsigned int light = state.AddPass("Light", nullptr);
+		state.Write(draw, backBuffer);
+		state.Write(light, lights);
+		state.DependsOn(draw, light);
+		state.Compile();
+		Check(RunsBefore(state, light, draw), "pass runs after the passes it depends on");
+
+		//Pass depending on the pass which reads its results
+		state.DependsOn(light, draw);
+		bool thrown = false;
+		try
+		{
+			state.Compile();
+		}
+		catch (const logic_error&)
+		{
+			thrown = true;
+		}
+		Check(thrown && state.getOrder().empty(), "cycle is rejected");
+
+		//Cycle among culled passes doesn't matter
+		FrameGraph culled;
+		backBuffer = culled.Import("BackBuffer");
+		unsigned int unused = culled.Create("Unused", SCREEN);
+		culled.MarkOutput(backBuffer);
+		unsigned int a = culled.AddPass("A", nullptr), b = culled.AddPass("B", nullptr);
+		unsigned int c = culled.AddPass("C", nullptr);
+		culled.Write(a, unused);
+		culled.Read(b, unused);
+		culled.Write(b, unused);
+		culled.DependsOn(a, b);
+		culled.Write(c, backBuffer);
+		culled.Compile();
+		Check(culled.getOrder().size() == 1 && culled.isCulled(a) && culled.isCulled(b), "culled cycle is ignored");
+	}
+
+	struct RandomPass
+	{
+		vector<unsigned int> Reads;
+		vector<unsigned int> Writes;
+	};
+
+	//Passes reading and writing random textures, some outputs, some of them imported
+	void CheckRandomGraphs()
+	{
+		mt19937 random(40);
+		unsigned int physical = 0, transient = 0, failures = TestFailures();
+		for (unsigned int g = 0; g < RANDOM_GRAPHS && TestFailures() == failures; ++g)
+		{
+			unsigned int passesCount = uniform_int_distribution<unsigned int>(1, MAX_PASSES)(random);
+			unsigned int resourcesCount = uniform_int_distribution<unsigned int>(1, MAX_RESOURCES)(random);
+			uniform_int_distribution<unsigned int> resource(0, resourcesCount - 1), uses(0, 2), coin(0, 3);
+			FrameGraph graph;
+			vector<bool> imported(resourcesCount), output(resourcesCount);
+			vector<FrameGraph::TextureDesc> descs(resourcesCount);
+			for (unsigned int r = 0; r < resourcesCount; ++r)
+			{
+				imported[r] = coin(random) == 0;
+				descs[r] = coin(random) ? SCREEN : SHADOW;
+				unsigned int id = imported[r] ? graph.Import("Imported") : graph.Create("Transient", descs[r]);
+				output[r] = coin(random) == 0;
+				if (output[r])
+					graph.MarkOutput(id);
+			}
+			vector<RandomPass> passes(passesCount);
+			for (unsigned int p = 0; p < passesCount; ++p)
+			{
+				graph.AddPass("Pass", nullptr);
+				for (unsigned int i = uses(random); i > 0; --i)
+				{
+					unsigned int r = resource(random);
+					graph.Read(p, r);
+					passes[p].Reads.push_back(r);
+				}
+				for (unsigned int i = 1 + uses(random); i > 0; --i)
+				{
+					unsigned int r = resource(random);
+					graph.Write(p, r);
+					passes[p].Writes.push_back(r);
+				}
+			}
+			graph.Compile();
+
+			//Passes have to run after the last writers of what they use and after the readers of what they overwrite
+			vector<vector<unsigned int>> after(passesCount), inputs(passesCount);
+			vector<unsigned int> lastWriter(resourcesCount, passesCount);
+			vector<vector<unsigned int>> readers(resourcesCount);
+			for (unsigned int p = 0; p < passesCount; ++p)
+			{
+				for (size_t i = 0; i < passes[p].Reads.size(); ++i)
+				{
+					unsigned int r = passes[p].Reads[i];
+					if (lastWriter[r] < passesCount)
+						inputs[p].push_back(lastWriter[r]);
+					readers[r].push_back(p);
+				}
+				for (size_t i = 0; i < passes[p].Writes.size(); ++i)
+				{
+					unsigned int r = passes[p].Writes[i];
+					//Same texture written twice by the pass
+					if (lastWriter[r] < passesCount && lastWriter[r] != p)
+						inputs[p].push_back(lastWriter[r]);
+					for (size_t j = 0; j < readers[r].size(); ++j)
+						if (readers[r][j] != p)
+							after[p].push_back(readers[r][j]);
+					readers[r].clear();
+					lastWriter[r] = p;
+				}
+				after[p].insert(after[p].end(), inputs[p].begin(), inputs[p].end());
+			}
+			//Passes the outputs' contents come from, through their inputs
+			vector<bool> needed(passesCount, false);
+			vector<unsigned int> stack;
+			for (unsigned int r = 0; r < resourcesCount; ++r)
+				if (output[r] && lastWriter[r] < passesCount)
+					stack.push_back(lastWriter[r]);
+			while (!stack.empty())
+			{
+				unsigned int p = stack.back();
+				stack.pop_back();
+				if (needed[p])
+					continue;
+				needed[p] = true;
+				stack.insert(stack.end(), inputs[p].begin(), inputs[p].end());
+			}
+
+			const vector<unsigned int>& order = graph.getOrder();
+			bool culling = true, ordered = true;
+			unsigned int kept = 0;
+			for (unsigned int p = 0; p < passesCount; ++p)
+			{
+				culling = culling && graph.isCulled(p) == !needed[p];
+				kept += needed[p] ? 1 : 0;
+				if (needed[p])
+					for (size_t i = 0; i < after[p].size(); ++i)
+						ordered = ordered && (!needed[after[p][i]] || RunsBefore(graph, after[p][i], p));
+			}
+			Check(culling, "passes which don't reach an output are culled");
+			Check(ordered && order.size() == kept, "every pass runs after the passes it depends on");
+
+			//Textures sharing memory are alike and never alive at the same time
+			vector<unsigned int> first(resourcesCount, ~0u), last(resourcesCount, 0);
+			for (unsigned int i = 0; i < order.size(); ++i)
+			{
+				vector<unsigned int> used(passes[order[i]].Reads);
+				used.insert(used.end(), passes[order[i]].Writes.begin(), passes[order[i]].Writes.end());
+				for (size_t j = 0; j < used.size(); ++j)
+				{
+					first[used[j]] = min(first[used[j]], i);
+					last[used[j]] = max(last[used[j]], i);
+				}
+			}
+			bool allocated = true, disjoint = true;
+			for (unsigned int r = 0; r < resourcesCount; ++r)
+			{
+				bool used = first[r] != ~0u;
+				if (output[r] && used)
+					last[r] = static_cast<unsigned int>(order.size());
+				allocated = allocated && (graph.getPhysical(r) == FrameGraph::NO_PHYSICAL) == (imported[r] || !used);
+				transient += !imported[r] && used ? 1 : 0;
+				for (unsigned int s = 0; s < r; ++s)
+					if (graph.getPhysical(r) != FrameGraph::NO_PHYSICAL && graph.getPhysical(r) == graph.getPhysical(s))
+						disjoint = disjoint && descs[r] == descs[s] && (last[r] < first[s] || last[s] < first[r]);
+			}
+			physical += static_cast<unsigned int>(graph.getPhysicalTextures().size());
+			Check(allocated, "only transient textures which are used get memory");
+			Check(disjoint, "textures sharing memory are alike and alive at different times");
+		}
+		printf("Random graphs: %u transient textures in %u physical ones\n", transient, physical);
+	}
+}
+
+int main()
+{
+	CheckSmallGraph();
+	CheckAliasing();
+	CheckDependencies();
+	CheckRandomGraphs();
+	return TestResult();
+}
@@ -0,0 +1,301 @@
+#include "gk2_headlessRoom.h"
+#include "gk2_imageDecoder.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+using namespace std;
+using namespace gk2;
+
+typedef SoftwareRasterizer SR;
+
+HeadlessRoom::HeadlessRoom(const string& resourcesDir, const shared_ptr<ThreadPool>& pool)
+	: m_rasterizer(WIDTH, HEIGHT, pool), m_emitter(XMFLOAT3(0.0f, 0.0f, 0.0f)), m_camera(0.01f, 100.0f)
+{
+	m_rasterizer.SetProjMatrix(ToMatrix(PumaScene::ProjectionMatrix(static_cast<float>(WIDTH) / HEIGHT)));
+	PumaScene::InitializeCamera(m_camera);
+	InitializeRenderStates();
+	CreateScene(resourcesDir);
+	InitializeFrameGraph(m_frameGraph);
+}
+
+HeadlessRoom::Matrix HeadlessRoom::ToMatrix(CXMMATRIX m)
+{
+	XMFLOAT4X4 stored;
+	XMStoreFloat4x4(&stored, m);
+	Matrix result;
+	memcpy(result.m, stored.m, sizeof(result.m));
+	return result;
+}
+
+shared_ptr<const SR::Texture> HeadlessRoom::LoadTexture(const string& fileName)
+{
+	ifstream file(fileName, ios::binary);
+	if (!file)
+		throw ios_base::failure("Can't open " + fileName);
+	vector<BYTE> data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+	TextureCooker::Image image = ImageDecoder::Decode(data);
+	shared_ptr<SR::Texture> texture = make_shared<SR::Texture>();
+	texture->Width = image.Width;
+	texture->Height = image.Height;
+	texture->Pixels.swap(image.Pixels);
+	return texture;
+}
+
+void HeadlessRoom::InitializeRenderStates()
+{
+	//Same as the states of Room::InitializeRenderStates, the null states of Room are the defaults
+	m_rsCullNone = SR::RasterizerDesc::Default();
+	m_rsCullNone.Cull = SR::CULL_NONE;
+	m_rsCounterClockwise = m_rsCullNone;
+	m_rsCounterClockwise.FrontCounterClockwise = true;
+	m_rsCullBack = SR::RasterizerDesc::Default();
+	m_rsCullFront = SR::RasterizerDesc::Default();
+	m_rsCullFront.Cull = SR::CULL_FRONT;
+
+	m_bsAlpha.Mode = SR::BLEND_ALPHA;
+	m_bsAlpha.WriteColor = true;
+	m_bsAll = SR::BlendDesc::Default();
+	m_bsNone = SR::BlendDesc::Default();
+	m_bsNone.WriteColor = false;
+
+	m_dssNoWrite = SR::DepthStencilDesc::Default();
+	m_dssNoWrite.DepthWrite = false;
+	m_dssWrite = m_dssNoWrite;
+	m_dssWrite.StencilEnable = true;
+	m_dssWrite.BackFace.Func = SR::COMPARISON_NEVER;
+	m_dssWrite.FrontFace.Func = SR::COMPARISON_ALWAYS;
+	m_dssWrite.FrontFace.PassOp = SR::STENCIL_OP_REPLACE;
+	m_dssTest = m_dssWrite;
+	m_dssTest.DepthWrite = true;
+	m_dssTest.FrontFace.Func = SR::COMPARISON_EQUAL;
+	m_dssTest.FrontFace.PassOp = SR::STENCIL_OP_KEEP;
+
+	m_dssIncr = SR::DepthStencilDesc::Default();
+	m_dssIncr.StencilEnable = true;
+	m_dssIncr.DepthWrite = false;
+	m_dssIncr.FrontFace.PassOp = SR::STENCIL_OP_INCR;
+	m_dssIncr.BackFace.PassOp = SR::STENCIL_OP_INCR;
+	m_dssDecr = m_dssIncr;
+	m_dssDecr.FrontFace.PassOp = SR::STENCIL_OP_DECR;
+	m_dssDecr.BackFace.PassOp = SR::STENCIL_OP_DECR;
+
+	m_dssKeepGreather = SR::DepthStencilDesc::Default();
+	m_dssKeepGreather.StencilEnable = true;
+	m_dssKeepGreather.DepthFunc = SR::COMPARISON_GREATER_EQUAL;
+	m_dssKeepGreather.FrontFace.Func = SR::COMPARISON_GREATER;
+	m_dssKeepGreather.BackFace.Func = SR::COMPARISON_GREATER;
+	m_dssKeepEqual = m_dssKeepGreather;
+	m_dssKeepEqual.FrontFace.Func = SR::COMPARISON_EQUAL;
+	m_dssKeepEqual.BackFace.Func = SR::COMPARISON_EQUAL;
+
+	m_dssNoStencil = SR::DepthStencilDesc::Default();
+
+	//Room sets the pass operation of the front face twice and leaves the one of the back face
+	m_dssStencil = SR::DepthStencilDesc::Default();
+	m_dssStencil.StencilEnable = true;
+	m_dssStencil.DepthWrite = false;
+	m_dssStencil.FrontFace.PassOp = SR::STENCIL_OP_DECR_SAT;
+}
+
+void HeadlessRoom::CreateScene(const string& resourcesDir)
+{
+	m_wallTexture = LoadTexture(resourcesDir + "/textures/stones.jpg");
+	m_sunTexture = LoadTexture(resourcesDir + "/textures/sun.jpg");
+	m_steelSheetTexture = LoadTexture(resourcesDir + "/textures/metal.jpg");
+	m_cloudTexture = LoadTexture(resourcesDir + "/textures/smoke.png");
+	m_opacityTexture = LoadTexture(resourcesDir + "/textures/smokecolors.png");
+
+	//Room draws only the floor of the walls
+	m_wall = MeshData::Quad(10.0f, 10.0f);
+	m_wallMtx = ToMatrix(PumaScene::WallMatrix(4));
+	m_cylinder = MeshData::Cylinder(100, 100, 0.25f, 2.5f);
+	m_cylinderMtx = ToMatrix(PumaScene::CylinderMatrix());
+	m_sun = MeshData::Sphere(100, 100, 0.5f);
+	m_sunMtx = ToMatrix(PumaScene::SunMatrix());
+	m_steelSheet = MeshData::Quad(PumaScene::STEEL_WIDTH, PumaScene::STEEL_WIDTH);
+	m_mirror = MeshData::Quad(PumaScene::STEEL_WIDTH);
+	m_circle = MeshData::Rim(100, PumaScene::STEEL_WIDTH / 2.65f);
+	XMMATRIX steelSheet = PumaScene::SteelSheetMatrix();
+	m_steelSheetMtx = ToMatrix(steelSheet);
+	m_circleMtx = ToMatrix(PumaScene::CircleMatrix() * steelSheet);
+	m_mirrorMtx = ToMatrix(PumaScene::MirrorMatrix(steelSheet));
+	m_textureMtx = ToMatrix(PumaScene::TextureMatrix());
+	const XMFLOAT4& light = PumaScene::LIGHT_POS;
+	SR::Vector4 lightPos = { light.x, light.y, light.z, light.w };
+	m_lightPos = lightPos;
+
+	for (unsigned int i = 0; i <= PumaScene::JOINTS; ++i)
+	{
+		ostringstream fileName;
+		fileName << resourcesDir << "/meshes/mesh" << i + 1 << ".txt";
+		ifstream input(fileName.str());
+		if (!input)
+			throw ios_base::failure("Can't open " + fileName.str());
+		MeshData::ParsePuma(input, PumaScene::LIGHT_POS, m_segments[i], m_shadowVolumes[i]);
+	}
+	unsigned int parent = TransformHierarchy::NONE;
+	for (unsigned int i = 0; i < PumaScene::JOINTS; ++i)
+		parent = m_pumaNodes[i] = m_transforms.AddNode(parent);
+	UpdateTransforms();
+	XMMATRIX view;
+	m_camera.GetViewMatrix(view);
+	m_viewMtx = ToMatrix(view);
+}
+
+void HeadlessRoom::UpdateTransforms()
+{
+	m_transforms.Update();
+	m_segmentMtx[0] = Matrix::Identity();
+	for (unsigned int i = 0; i < PumaScene::JOINTS; ++i)
+		m_segmentMtx[i + 1] = ToMatrix(m_transforms.getWorld(m_pumaNodes[i]));
+}
+
+void HeadlessRoom::Update(float dt)
+{
+	m_scene.Update(dt, PumaScene::SteelSheetMatrix());
+	for (unsigned int i = 0; i < PumaScene::JOINTS; ++i)
+		m_transforms.setLocal(m_pumaNodes[i], m_scene.getJointMatrix(i));
+	UpdateTransforms();
+	m_emitter.Update(dt, m_scene.getElectrodePosition());
+	m_particles.resize(ParticleEmitter::MAX_PARTICLES);
+	unsigned int count = m_emitter.CopyVertices(m_particles.data());
+	m_particles.resize(count);
+	XMFLOAT4 cameraTarget(0.0f, 0.0f, 0.0f, 1.0f);
+	sort(m_particles.begin(), m_particles.end(), ParticleComparer(cameraTarget, m_camera.GetPosition()));
+}
+
+void HeadlessRoom::Render()
+{
+	m_rasterizer.SetViewMatrix(m_viewMtx);
+	m_frameGraph.Execute();
+	m_rasterizer.Flush();
+}
+
+void HeadlessRoom::Draw(const MeshData& mesh, const Matrix& world)
+{
+	if (mesh.Indices.empty())
+		return;
+	m_rasterizer.DrawIndexed(mesh.Vertices.data(), static_cast<unsigned int>(mesh.Vertices.size()),
+							 sizeof(VertexPosNormal), mesh.Indices.data(),
+							 static_cast<unsigned int>(mesh.Indices.size()), world);
+}
+
+void HeadlessRoom::SetPhong(float r, float g, float b, float a)
+{
+	SR::Vector4 color = { r, g, b, a };
+	m_rasterizer.SetEffect(SR::EffectDesc::Phong(color, m_lightPos));
+}
+
+void HeadlessRoom::SetTexture(const shared_ptr<const SR::Texture>& texture)
+{
+	SR::Vector4 white = { 1.0f, 1.0f, 1.0f, 1.0f };
+	SR::EffectDesc effect = SR::EffectDesc::Phong(white, m_lightPos);
+	effect.Type = SR::EFFECT_TEXTURE;
+	effect.ColorMap = texture;
+	effect.TextureMatrix = m_textureMtx;
+	m_rasterizer.SetEffect(effect);
+}
+
+void HeadlessRoom::Clear()
+{
+	SR::Vector4 clearColor = { 0.0f, 0.0f, 0.0f, 0.0f };
+	m_rasterizer.Clear(clearColor, 1.0f, 0);
+}
+
+void HeadlessRoom::SetBlendState(BlendState state)
+{
+	const SR::BlendDesc* states[] = { nullptr, &m_bsAlpha, &m_bsAll, &m_bsNone };
+	m_rasterizer.SetBlendState(states[state] ? *states[state] : SR::BlendDesc::Default());
+}
+
+void HeadlessRoom::SetDepthStencilState(DepthStencilState state, unsigned int stencilRef)
+{
+	const SR::DepthStencilDesc* states[] = { nullptr, &m_dssNoWrite, &m_dssWrite, &m_dssTest, &m_dssIncr, &m_dssDecr,
+											 &m_dssKeepGreather, &m_dssKeepEqual, &m_dssNoStencil, &m_dssStencil };
+	m_rasterizer.SetDepthStencilState(states[state] ? *states[state] : SR::DepthStencilDesc::Default(), stencilRef);
+}
+
+void HeadlessRoom::SetRasterizerState(RasterizerState state)
+{
+	const SR::RasterizerDesc* states[] = { nullptr, &m_rsCounterClockwise, &m_rsCullNone, &m_rsCullBack,
+										   &m_rsCullFront };
+	m_rasterizer.SetRasterizerState(states[state] ? *states[state] : SR::RasterizerDesc::Default());
+}
+
+void HeadlessRoom::SetMirroredView(bool mirrored)
+{
+	m_rasterizer.SetViewMatrix(mirrored ? Matrix::Multiply(m_mirrorMtx, m_viewMtx) : m_viewMtx);
+}
+
+void HeadlessRoom::Draw(Object object)
+{
+	switch (object)
+	{
+	case OBJECT_MIRROR:
+		SetPhong(0.0f, 0.0f, 0.0f, 0.0f);
+		Draw(m_mirror, m_steelSheetMtx);
+		break;
+	case OBJECT_WALLS:
+		SetTexture(m_wallTexture);
+		Draw(m_wall, m_wallMtx);
+		break;
+	case OBJECT_SUN:
+		SetTexture(m_sunTexture);
+		Draw(m_sun, m_sunMtx);
+		break;
+	case OBJECT_CYLINDER:
+		SetPhong(1.0f, 1.0f, 1.0f, 1.0f);
+		Draw(m_cylinder, m_cylinderMtx);
+		break;
+	case OBJECT_PUMA:
+		DrawPuma();
+		break;
+	case OBJECT_STEEL_SHEET:
+		SetTexture(m_steelSheetTexture);
+		Draw(m_steelSheet, m_steelSheetMtx);
+		break;
+	case OBJECT_CIRCLE:
+		SetPhong(1.0f, 0.0f, 0.0f, 0.35f);
+		Draw(m_circle, m_circleMtx);
+		break;
+	case OBJECT_PARTICLES:
+		DrawParticles();
+		break;
+	case OBJECT_SHADOW_VOLUMES:
+		DrawShadowVolumes();
+		break;
+	}
+}
+
+void HeadlessRoom::DrawPuma()
+{
+	SetPhong(0.1f, 0.7f, 0.2f, 1.0f);
+	for (unsigned int i = 0; i <= PumaScene::JOINTS; ++i)
+		Draw(m_segments[i], m_segmentMtx[i]);
+}
+
+void HeadlessRoom::DrawParticles()
+{
+	SR::Vector4 white = { 1.0f, 1.0f, 1.0f, 1.0f };
+	SR::EffectDesc effect = SR::EffectDesc::Phong(white, m_lightPos);
+	effect.Type = SR::EFFECT_PARTICLES;
+	effect.ColorMap = m_cloudTexture;
+	effect.OpacityMap = m_opacityTexture;
+	//TimeToLive of Particles.hlsl
+	effect.TimeToLive = 4.0f;
+	m_rasterizer.SetEffect(effect);
+	//ParticleVertex has the layout of Sprite
+	m_rasterizer.DrawSprites(reinterpret_cast<const SR::Sprite*>(m_particles.data()),
+							 static_cast<unsigned int>(m_particles.size()));
+}
+
+void HeadlessRoom::DrawShadowVolumes()
+{
+	//The volumes are extruded from the rest pose of the segments and drawn without their transforms, like in Room
+	SetPhong(0.0f, 0.0f, 0.0f, 0.0f);
+	for (unsigned int i = 0; i <= PumaScene::JOINTS; ++i)
+		Draw(m_shadowVolumes[i], Matrix::Identity());
+}
@@ -0,0 +1,120 @@
+#ifndef __GK2_HEADLESS_ROOM_H_
+#define __GK2_HEADLESS_ROOM_H_
+
+#include "gk2_softwareRasterizer.h"
+#include "gk2_pumaScene.h"
+#include "gk2_particleEmitter.h"
+#include "gk2_meshData.h"
+#include "gk2_transformHierarchy.h"
+#include "gk2_roomPasses.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace gk2
+{
+	//Room of the Puma project drawn by the software rasterizer, without a window or a device. The passes, the
+	//render states and the draw order come from RoomPasses like in Room, so the images show what the application
+	//renders. The frustum culling of Room is left out, it doesn't change the image.
+	class HeadlessRoom : public gk2::RoomPasses
+	{
+	public:
+		//Client size of the application's window
+		static const unsigned int WIDTH = 800;
+		static const unsigned int HEIGHT = 800;
+
+		//Meshes and textures are read from the resources directory of the project
+		HeadlessRoom(const std::string& resourcesDir, const std::shared_ptr<gk2::ThreadPool>& pool = nullptr);
+
+		//Same as Room::Update without the input
+		void Update(float dt);
+		//Runs the passes of the frame and rasterizes them
+		void Render();
+
+		gk2::SoftwareRasterizer& getRasterizer() { return m_rasterizer; }
+		const gk2::FrameGraph& getFrameGraph() const { return m_frameGraph; }
+
+	protected:
+		virtual void Clear();
+		virtual void SetBlendState(BlendState state);
+		virtual void SetDepthStencilState(DepthStencilState state, unsigned int stencilRef);
+		virtual void SetRasterizerState(RasterizerState state);
+		virtual void SetMirroredView(bool mirrored);
+		virtual void Draw(Object object);
+
+	private:
+		typedef gk2::SoftwareRasterizer::Matrix Matrix;
+
+		gk2::SoftwareRasterizer m_rasterizer;
+		gk2::FrameGraph m_frameGraph;
+		gk2::PumaScene m_scene;
+		gk2::ParticleEmitter m_emitter;
+		gk2::Camera m_camera;
+		//Particles of the last update sorted like ParticleSystem sorts them
+		std::vector<gk2::ParticleVertex> m_particles;
+
+		gk2::MeshData m_wall;
+		gk2::MeshData m_cylinder;
+		gk2::MeshData m_sun;
+		gk2::MeshData m_steelSheet;
+		gk2::MeshData m_mirror;
+		gk2::MeshData m_circle;
+		gk2::MeshData m_segments[gk2::PumaScene::JOINTS + 1];
+		gk2::MeshData m_shadowVolumes[gk2::PumaScene::JOINTS + 1];
+
+		gk2::TransformHierarchy m_transforms;
+		unsigned int m_pumaNodes[gk2::PumaScene::JOINTS];
+		Matrix m_wallMtx;
+		Matrix m_cylinderMtx;
+		Matrix m_sunMtx;
+		Matrix m_steelSheetMtx;
+		Matrix m_circleMtx;
+		Matrix m_mirrorMtx;
+		Matrix m_segmentMtx[gk2::PumaScene::JOINTS + 1];
+		Matrix m_viewMtx;
+		Matrix m_textureMtx;
+		gk2::SoftwareRasterizer::Vector4 m_lightPos;
+
+		std::shared_ptr<const gk2::SoftwareRasterizer::Texture> m_wallTexture;
+		std::shared_ptr<const gk2::SoftwareRasterizer::Texture> m_sunTexture;
+		std::shared_ptr<const gk2::SoftwareRasterizer::Texture> m_steelSheetTexture;
+		std::shared_ptr<const gk2::SoftwareRasterizer::Texture> m_cloudTexture;
+		std::shared_ptr<const gk2::SoftwareRasterizer::Texture> m_opacityTexture;
+
+		gk2::SoftwareRasterizer::BlendDesc m_bsAlpha;
+		gk2::SoftwareRasterizer::BlendDesc m_bsAll;
+		gk2::SoftwareRasterizer::BlendDesc m_bsNone;
+
+		gk2::SoftwareRasterizer::DepthStencilDesc m_dssNoWrite;
+		gk2::SoftwareRasterizer::DepthStencilDesc m_dssWrite;
+		gk2::SoftwareRasterizer::DepthStencilDesc m_dssTest;
+		gk2::SoftwareRasterizer::DepthStencilDesc m_dssIncr;
+		gk2::SoftwareRasterizer::DepthStencilDesc m_dssDecr;
+		gk2::SoftwareRasterizer::DepthStencilDesc m_dssKeepGreather;
+		gk2::SoftwareRasterizer::DepthStencilDesc m_dssKeepEqual;
+		gk2::SoftwareRasterizer::DepthStencilDesc m_dssNoStencil;
+		gk2::SoftwareRasterizer::DepthStencilDesc m_dssStencil;
+
+		gk2::SoftwareRasterizer::RasterizerDesc m_rsCounterClockwise;
+		gk2::SoftwareRasterizer::RasterizerDesc m_rsCullNone;
+		gk2::SoftwareRasterizer::RasterizerDesc m_rsCullBack;
+		gk2::SoftwareRasterizer::RasterizerDesc m_rsCullFront;
+
+		static Matrix ToMatrix(CXMMATRIX m);
+		static std::shared_ptr<const gk2::SoftwareRasterizer::Texture> LoadTexture(const std::string& fileName);
+
+		void InitializeRenderStates();
+		void CreateScene(const std::string& resourcesDir);
+		void UpdateTransforms();
+
+		void Draw(const gk2::MeshData& mesh, const Matrix& world);
+		void SetPhong(float r, float g, float b, float a);
+		void SetTexture(const std::shared_ptr<const gk2::SoftwareRasterizer::Texture>& texture);
+
+		void DrawPuma();
+		void DrawParticles();
+		void DrawShadowVolumes();
+	};
+}
+
+#endif __GK2_HEADLESS_ROOM_H_
@@ -0,0 +1,210 @@
+#include "gk2_fileSystem.h"
+#include "gk2_inputCapture.h"
+#include "gk2_testCheck.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+using namespace gk2;
+
+//Records random frames of keyboard and mouse states, time steps and seeds to a log and replays it. Checks that the
+//frames come back as they were recorded, that an update driven by them ends in the same state, that a fixed time
+//step replaces the recorded ones and that broken logs and calls in the wrong mode are rejected.
+
+namespace
+{
+	const unsigned int FRAMES = 600;
+	const unsigned int INITIAL_SEED = 46;
+
+	string LogFile(const char* name)
+	{
+		wstring directory = NativeFileSystem().TempDirectory();
+		return string(directory.begin(), directory.end()) + name;
+	}
+
+	vector<InputCapture::Frame> RandomFrames()
+	{
+		mt19937 random(INITIAL_SEED);
+		uniform_real_distribution<float> dt(0.005f, 0.05f);
+		uniform_int_distribution<unsigned int> keys(0, 6), key(0, KeyboardState::STATE_TAB_LENGTH - 1),
+			valid(0, 9), byte(0, 255);
+		uniform_int_distribution<int> move(-40, 40);
+		vector<InputCapture::Frame> frames(FRAMES);
+		for (auto it = frames.begin(); it != frames.end(); ++it)
+		{
+			it->Dt = dt(random);
+			it->Seed = random();
+			//Devices which couldn't be read now and then
+			it->KeyboardValid = valid(random) != 0;
+			it->MouseValid = valid(random) != 0;
+			it->Keyboard = KeyboardState();
+			it->Mouse = MouseState();
+			if (it->KeyboardValid)
+				for (unsigned int k = keys(random); k > 0; --k)
+					it->Keyboard.m_keys[key(random)] = KeyboardState::KEY_MASK;
+			if (it->MouseValid)
+			{
+				it->Mouse.m_state.lX = move(random);
+				it->Mouse.m_state.lY = move(random);
+				it->Mouse.m_state.lZ = move(random);
+				for (unsigned int b = 0; b < 4; ++b)
+					it->Mouse.m_state.rgbButtons[b] = static_cast<BYTE>(byte(random) & MouseState::BUTTON_MASK);
+			}
+		}
+		return frames;
+	}
+
+	bool SameFrame(const InputCapture::Frame& a, const InputCapture::Frame& b)
+	{
+		if (a.Dt != b.Dt || a.Seed != b.Seed || a.KeyboardValid != b.KeyboardValid || a.MouseValid != b.MouseValid)
+			return false;
+		for (unsigned int i = 0; i < KeyboardState::STATE_TAB_LENGTH; ++i)
+			if (a.Keyboard.isKeyDown(static_cast<BYTE>(i)) != b.Keyboard.isKeyDown(static_cast<BYTE>(i)))
+				return false;
+		return memcmp(&a.Mouse.m_state, &b.Mouse.m_state, sizeof(DIMOUSESTATE)) == 0;
+	}
+
+	//Stands in for an application's Update: moves by the keys and the mouse and spawns particles with rand()
+	struct Simulation
+	{
+		float Time;
+		float X;
+		long long Particles;
+
+		Simulation() : Time(0.0f), X(0.0f), Particles(0) { }
+
+		void Update(const InputCapture::Frame& frame)
+		{
+			srand(frame.Seed);
+			Time += frame.Dt;
+			if (frame.KeyboardValid && frame.Keyboard.isKeyDown(30))
+				X -= frame.Dt;
+			if (frame.MouseValid && frame.Mouse.isButtonDown(MouseState::Left))
+				X += frame.Mouse.m_state.lX * frame.Dt;
+			for (int i = rand() % 8; i > 0; --i)
+				Particles = Particles * 31 + rand();
+		}
+
+		bool operator==(const Simulation& other) const
+		{
+			return Time == other.Time && X == other.X && Particles == other.Particles;
+		}
+	};
+
+	template<typename Exception, typename Action>
+	bool Throws(Action action)
+	{
+		try
+		{
+			action();
+		}
+		catch (const Exception&)
+		{
+			return true;
+		}
+		return false;
+	}
+
+	void TestRecordAndReplay()
+	{
+		vector<InputCapture::Frame> frames = RandomFrames();
+		string fileName = LogFile("gk2InputCaptureTest.log");
+		InputCapture capture;
+		Simulation recorded;
+		capture.StartRecording(fileName, INITIAL_SEED);
+		Check(capture.getMode() == InputCapture::MODE_RECORD, "capture records");
+		for (auto it = frames.begin(); it != frames.end(); ++it)
+		{
+			capture.RecordFrame(*it);
+			recorded.Update(*it);
+		}
+		Check(capture.getFramesCount() == FRAMES, "recorded frames are counted");
+		capture.Stop();
+		Check(capture.getMode() == InputCapture::MODE_OFF, "stopped capture is off");
+
+		capture.StartReplay(fileName);
+		Check(capture.getMode() == InputCapture::MODE_REPLAY && capture.getInitialSeed() == INITIAL_SEED,
+			  "replay starts with the recorded seed");
+		Simulation replayed;
+		InputCapture::Frame frame;
+		unsigned int replayedCount = 0, different = 0;
+		while (capture.ReplayFrame(frame))
+		{
+			different += replayedCount < FRAMES && SameFrame(frame, frames[replayedCount]) ? 0 : 1;
+			replayed.Update(frame);
+			++replayedCount;
+		}
+		Check(replayedCount == FRAMES && capture.getFramesCount() == FRAMES, "every frame is replayed");
+		Check(different == 0, "replayed frames are the recorded ones");
+		Check(replayed == recorded, "update driven by the replay ends in the recorded state");
+		Check(!capture.ReplayFrame(frame), "replay stays at its end");
+
+		const float FIXED_DT = 1.0f / 60.0f;
+		capture.StartReplay(fileName, FIXED_DT);
+		unsigned int fixed = 0;
+		while (capture.ReplayFrame(frame))
+			fixed += frame.Dt == FIXED_DT ? 1 : 0;
+		Check(fixed == FRAMES, "fixed time step replaces the recorded ones");
+		capture.Stop();
+
+		ifstream log(fileName, ios::binary | ios::ate);
+		printf("%u frames in %lld bytes\n", FRAMES, static_cast<long long>(log.tellg()));
+		log.close();
+		remove(fileName.c_str());
+	}
+
+	void TestRejected()
+	{
+		InputCapture capture;
+		InputCapture::Frame frame = RandomFrames()[0];
+		Check(Throws<logic_error>([&]() { capture.RecordFrame(frame); }), "frame isn't recorded when off");
+		Check(Throws<logic_error>([&]() { capture.ReplayFrame(frame); }), "frame isn't replayed when off");
+		Check(Throws<runtime_error>([&]() { capture.StartReplay(LogFile("gk2InputCaptureMissing.log")); }),
+			  "missing log is rejected");
+
+		string fileName = LogFile("gk2InputCaptureTest.log");
+		ofstream(fileName, ios::binary) << "GK2X";
+		Check(Throws<runtime_error>([&]() { capture.StartReplay(fileName); }), "log with another magic is rejected");
+		Check(capture.getMode() == InputCapture::MODE_OFF, "rejected log leaves the capture off");
+
+		capture.StartRecording(fileName, INITIAL_SEED);
+		capture.RecordFrame(frame);
+		Check(Throws<logic_error>([&]() { capture.ReplayFrame(frame); }), "frame isn't replayed while recording");
+		capture.Stop();
+		//Last frame is cut in half
+		ifstream in(fileName, ios::binary);
+		string bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+		in.close();
+		ofstream(fileName, ios::binary) << bytes.substr(0, bytes.size() - 4);
+		Check(Throws<runtime_error>([&]() { capture.StartReplay(fileName); }), "truncated frame is rejected");
+
+		//Keyboard frame which claims more keys than there are
+		frame.KeyboardValid = true;
+		ostringstream s;
+		InputCapture::WriteFrame(s, frame);
+		string data = s.str();
+		//Count follows the time step, the seed and the flags
+		data[9] = static_cast<char>(0xff);
+		data[10] = static_cast<char>(0xff);
+		istringstream broken(data);
+		Check(Throws<runtime_error>([&]() { InputCapture::ReadFrame(broken, frame); }),
+			  "keys count over the keyboard's size is rejected");
+		istringstream empty("");
+		Check(!InputCapture::ReadFrame(empty, frame), "end of the stream ends the frames");
+		remove(fileName.c_str());
+	}
+}
+
+int main()
+{
+	TestRecordAndReplay();
+	TestRejected();
+	return TestResult();
+}
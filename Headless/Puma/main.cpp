@@ -0,0 +1,157 @@
+#include "gk2_headlessRoom.h"
+#include "gk2_imageDecoder.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using namespace std;
+using namespace gk2;
+
+//Renders the Puma room on the CPU.
+//  render <resources> <frames> <output.png> [threads]
+//  compare <resources> <frames> <reference.png> [threads]
+//  benchmark <resources> <frames> [threads]
+//The scene is advanced by the given number of 60 Hz frames before the image is taken. Threads is the number of
+//threads rasterizing the tiles, 1 rasterizes on the calling thread. The benchmark times updating, drawing and
+//rasterizing every frame.
+
+namespace
+{
+	const float FRAME_TIME = 1.0f / 60.0f;
+	//A pixel differs if any of its channels is further from the reference, rounding of the floats may differ
+	//between compilers
+	const int PIXEL_TOLERANCE = 16;
+	const double MAX_DIFFERENT_PIXELS = 0.002;
+	const double MAX_MEAN_ERROR = 0.5;
+
+	shared_ptr<ThreadPool> CreatePool(int argc, char** argv, int index)
+	{
+		unsigned int threads = argc > index ? static_cast<unsigned int>(atoi(argv[index])) : 1;
+		if (threads <= 1)
+			return nullptr;
+		return make_shared<ThreadPool>(threads - 1);
+	}
+
+	void Advance(HeadlessRoom& room, unsigned int frames)
+	{
+		for (unsigned int i = 0; i < frames; ++i)
+			room.Update(FRAME_TIME);
+	}
+
+	int Compare(HeadlessRoom& room, const string& referenceFile)
+	{
+		vector<unsigned char> pixels;
+		room.getRasterizer().ReadPixels(pixels);
+		ifstream file(referenceFile, ios::binary);
+		if (!file)
+			throw ios_base::failure("Can't open " + referenceFile);
+		vector<BYTE> data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+		TextureCooker::Image reference = ImageDecoder::Decode(data);
+		if (reference.Width != HeadlessRoom::WIDTH || reference.Height != HeadlessRoom::HEIGHT)
+		{
+			printf("Reference is %ux%u, the frame is %ux%u\n", reference.Width, reference.Height,
+				   HeadlessRoom::WIDTH, HeadlessRoom::HEIGHT);
+			return 1;
+		}
+		//Alpha is left out, the window doesn't show it
+		size_t different = 0;
+		double error = 0.0;
+		int maxError = 0;
+		for (size_t i = 0; i < pixels.size(); i += 4)
+		{
+			int pixelError = 0;
+			for (size_t c = 0; c < 3; ++c)
+			{
+				int d = abs(static_cast<int>(pixels[i + c]) - static_cast<int>(reference.Pixels[i + c]));
+				error += d;
+				pixelError = max(pixelError, d);
+			}
+			maxError = max(maxError, pixelError);
+			if (pixelError > PIXEL_TOLERANCE)
+				++different;
+		}
+		size_t count = pixels.size() / 4;
+		double differentShare = static_cast<double>(different) / count;
+		double meanError = error / (3 * count);
+		printf("%s: %zu of %zu pixels differ (%.3f%%), mean error %.3f, max error %d\n", referenceFile.c_str(),
+			   different, count, 100.0 * differentShare, meanError, maxError);
+		return differentShare <= MAX_DIFFERENT_PIXELS && meanError <= MAX_MEAN_ERROR ? 0 : 1;
+	}
+
+	int Benchmark(const string& resources, unsigned int frames, const shared_ptr<ThreadPool>& pool)
+	{
+		typedef chrono::steady_clock Clock;
+		HeadlessRoom room(resources, pool);
+		//The first frame fills the buffers of the rasterizer
+		room.Update(FRAME_TIME);
+		room.Render();
+		vector<double> times;
+		for (unsigned int i = 0; i < frames; ++i)
+		{
+			Clock::time_point start = Clock::now();
+			room.Update(FRAME_TIME);
+			room.Render();
+			times.push_back(chrono::duration<double, milli>(Clock::now() - start).count());
+		}
+		sort(times.begin(), times.end());
+		double sum = 0.0;
+		for (size_t i = 0; i < times.size(); ++i)
+			sum += times[i];
+		const SoftwareRasterizer::Statistics& statistics = room.getRasterizer().getStatistics();
+		printf("%u frames %ux%u, %u threads: mean %.2f ms, median %.2f ms, min %.2f ms, max %.2f ms\n", frames,
+			   HeadlessRoom::WIDTH, HeadlessRoom::HEIGHT, pool ? pool->getThreadsCount() : 1, sum / frames,
+			   times[times.size() / 2], times.front(), times.back());
+		printf("Per frame: %.0f draws, %.0f triangles, %.0f fragments, %.0f written\n",
+			   static_cast<double>(statistics.Draws) / (frames + 1),
+			   static_cast<double>(statistics.Triangles) / (frames + 1),
+			   static_cast<double>(statistics.Fragments) / (frames + 1),
+			   static_cast<double>(statistics.Written) / (frames + 1));
+		return 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 4)
+	{
+		printf("Usage: %s render|compare|benchmark <resources> <frames> [file] [threads]\n", argv[0]);
+		return 2;
+	}
+	//Same sparks in every run, the reference images depend on them
+	srand(1);
+	try
+	{
+		string command = argv[1];
+		string resources = argv[2];
+		unsigned int frames = static_cast<unsigned int>(atoi(argv[3]));
+		if (command == "benchmark")
+			return Benchmark(resources, frames, CreatePool(argc, argv, 4));
+		if (argc < 5)
+		{
+			printf("%s needs a file\n", command.c_str());
+			return 2;
+		}
+		HeadlessRoom room(resources, CreatePool(argc, argv, 5));
+		Advance(room, frames);
+		room.Render();
+		if (command == "render")
+		{
+			room.getRasterizer().WritePng(argv[4]);
+			return 0;
+		}
+		if (command == "compare")
+			return Compare(room, argv[4]);
+		printf("Unknown command %s\n", command.c_str());
+		return 2;
+	}
+	catch (const exception& e)
+	{
+		printf("%s\n", e.what());
+		return 1;
+	}
+}
@@ -0,0 +1,124 @@
+#include "gk2_profiler.h"
+#include "gk2_testCheck.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+using namespace std;
+using namespace gk2;
+
+//Records empty zones in a loop and checks that one costs less than the two steady_clock reads zones used to make,
+//then checks the counts, the lost events, the durations of zones of known length and the exported trace.
+
+namespace
+{
+	//Nanoseconds a zone should cost, printed only since the cost of reading the time stamp counter depends on the host
+	const double BUDGET = 50.0;
+	//Zones of a run fit in the ring, so EndFrame gathers all of them
+	const unsigned int ZONES = Profiler::RING_SIZE / 2;
+	const unsigned int RUNS = 64;
+	const double WAIT = 5.0;
+
+	typedef chrono::steady_clock Clock;
+
+	double Milliseconds(Clock::time_point start)
+	{
+		return chrono::duration<double, milli>(Clock::now() - start).count();
+	}
+
+	//Nanoseconds per zone of the fastest run
+	double MeasureZones(const char* name)
+	{
+		double best = 1e9;
+		for (unsigned int r = 0; r < RUNS; ++r)
+		{
+			Clock::time_point start = Clock::now();
+			for (unsigned int i = 0; i < ZONES; ++i)
+			{
+				PROFILE_ZONE(name);
+			}
+			best = min(best, Milliseconds(start) * 1e6 / ZONES);
+			Profiler::EndFrame();
+		}
+		return best;
+	}
+
+	//Nanoseconds of the fastest run of zones which read steady_clock at the beginning and at the end
+	double MeasureClockZones()
+	{
+		double best = 1e9;
+		volatile Clock::rep sink = 0;
+		for (unsigned int r = 0; r < RUNS; ++r)
+		{
+			Clock::time_point start = Clock::now();
+			for (unsigned int i = 0; i < ZONES; ++i)
+			{
+				Clock::time_point begin = Clock::now();
+				sink = (Clock::now() - begin).count();
+			}
+			best = min(best, Milliseconds(start) * 1e6 / ZONES);
+		}
+		return best;
+	}
+
+	void Wait(double milliseconds)
+	{
+		Clock::time_point start = Clock::now();
+		while (Milliseconds(start) < milliseconds)
+			;
+	}
+}
+
+int main()
+{
+	double enabled = MeasureZones("Empty");
+	Profiler::setEnabled(false);
+	double disabled = MeasureZones("Disabled");
+	Profiler::setEnabled(true);
+	double clock = MeasureClockZones();
+	printf("Zone: %.1f ns, disabled %.1f ns, steady_clock %.1f ns, budget %.0f ns\n", enabled, disabled, clock,
+		   BUDGET);
+	Check(enabled < clock, "zone costs less than reading steady_clock twice");
+
+	Profiler::ZoneStatistics statistics;
+	Check(Profiler::GetStatistics("Empty", statistics) && statistics.Count == ZONES * RUNS,
+		  "every zone is gathered");
+	Check(!Profiler::GetStatistics("Disabled", statistics), "disabled profiler records nothing");
+	Check(Profiler::getLostEvents() == 0, "no events are lost when the ring is gathered in time");
+
+	//Name built at runtime
+	string name = "Wait" + to_string(static_cast<int>(WAIT));
+	const char* interned = Profiler::Intern(name);
+	Check(interned == Profiler::Intern(name) && name == interned, "names are interned once");
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		PROFILE_ZONE("Outer");
+		PROFILE_ZONE(interned);
+		Wait(WAIT);
+	}
+	Profiler::EndFrame();
+	if (Check(Profiler::GetStatistics(name, statistics), "runtime names are recorded"))
+	{
+		printf("%s: %.3f ms min, %.3f ms average\n", name.c_str(), statistics.Min, statistics.Average);
+		//Ticks are converted by the rate measured since the start
+		Check(statistics.Min > WAIT * 0.95 && statistics.Min < WAIT * 1.1, "zones last as long as the code in them");
+	}
+
+	ostringstream trace;
+	Profiler::WriteChromeTrace(trace);
+	Check(trace.str().find("\"name\":\"Outer\"") != string::npos &&
+		  trace.str().find("\"name\":\"Wait5\"") != string::npos, "trace holds the zones");
+
+	//Ring overwritten before EndFrame
+	for (unsigned int i = 0; i < Profiler::RING_SIZE * 2; ++i)
+	{
+		PROFILE_ZONE("Overflow");
+	}
+	Profiler::EndFrame();
+	//Oldest event left in the ring may be in the middle of being overwritten, so it's dropped too
+	unsigned long long lost = Profiler::getLostEvents();
+	Check(lost >= Profiler::RING_SIZE && lost <= Profiler::RING_SIZE + 1, "overwritten events are counted as lost");
+	return TestResult();
+}
@@ -0,0 +1,190 @@
+#include "gk2_resourceTracker.h"
+#include "gk2_testCheck.h"
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace gk2;
+
+//Tracks stand-ins of device resources the way DeviceHelper::Track does and checks the live and peak counts and
+//bytes of the categories, the statistics of the frames, the leak report and that the last reference removes the
+//resource and releases the object once. Checks the memory of textures computed from their descriptions and that
+//threads creating and releasing resources at once leave the tracker consistent.
+
+namespace
+{
+	const unsigned int THREADS = 4;
+	const unsigned int THREAD_RESOURCES = 20000;
+
+	//Counts the releases instead of freeing itself
+	class FakeTexture : public ID3D11Texture2D
+	{
+	public:
+		FakeTexture() : m_references(1) { }
+
+		virtual ULONG AddRef() { return ++m_references; }
+		virtual ULONG Release() { return --m_references; }
+
+		ULONG getReferences() const { return m_references; }
+
+	private:
+		ULONG m_references;
+	};
+
+	//Same as DeviceHelper::Track with a resource scope of the category and name
+	shared_ptr<ID3D11Texture2D> Track(const shared_ptr<ResourceTracker>& tracker, FakeTexture* texture,
+									  const char* category, const char* name, unsigned long long bytes)
+	{
+		unsigned long long id = tracker->Add(category, name, "Texture2D", bytes);
+		return shared_ptr<ID3D11Texture2D>(texture, ResourceTracker::Release(tracker, id));
+	}
+
+	D3D11_TEXTURE2D_DESC TextureDesc(unsigned int width, unsigned int height, unsigned int mipLevels,
+									 DXGI_FORMAT format)
+	{
+		D3D11_TEXTURE2D_DESC desc;
+		memset(&desc, 0, sizeof(desc));
+		desc.Width = width;
+		desc.Height = height;
+		desc.MipLevels = mipLevels;
+		desc.ArraySize = 1;
+		desc.Format = format;
+		desc.SampleDesc.Count = 1;
+		return desc;
+	}
+
+	const ResourceTracker::CategoryStatistics* Find(const vector<ResourceTracker::CategoryStatistics>& statistics,
+													const string& category)
+	{
+		for (auto it = statistics.begin(); it != statistics.end(); ++it)
+			if (it->Category == category)
+				return &*it;
+		return nullptr;
+	}
+
+	void TestTrack()
+	{
+		shared_ptr<ResourceTracker> tracker = make_shared<ResourceTracker>();
+		FakeTexture wall, floor, shadowMap;
+		shared_ptr<ID3D11Texture2D> wallTexture = Track(tracker, &wall, "Textures", "wall", 1000);
+		shared_ptr<ID3D11Texture2D> floorTexture = Track(tracker, &floor, "Textures", "floor", 3000);
+		tracker->EndFrame();
+		shared_ptr<ID3D11Texture2D> shadowTexture = Track(tracker, &shadowMap, "RenderTargets", "shadow", 4000);
+		Check(tracker->getLiveCount() == 3 && tracker->getLiveBytes() == 8000 && tracker->getPeakBytes() == 8000,
+			  "live resources are counted");
+
+		//A copy keeps the resource alive
+		shared_ptr<ID3D11Texture2D> copy = floorTexture;
+		floorTexture.reset();
+		Check(tracker->getLiveCount() == 3 && floor.getReferences() == 1, "copy keeps the resource");
+		copy.reset();
+		Check(tracker->getLiveCount() == 2 && tracker->getLiveBytes() == 5000 && floor.getReferences() == 0,
+			  "last reference removes the resource and releases the object once");
+		Check(tracker->getPeakBytes() == 8000, "peak stays after a release");
+
+		vector<ResourceTracker::CategoryStatistics> statistics = tracker->GetStatistics();
+		const ResourceTracker::CategoryStatistics* textures = Find(statistics, "Textures");
+		const ResourceTracker::CategoryStatistics* targets = Find(statistics, "RenderTargets");
+		Check(statistics.size() == 2 && statistics[0].Category == "RenderTargets", "categories are sorted");
+		Check(textures && textures->Count == 1 && textures->Bytes == 1000 && textures->PeakCount == 2 &&
+			  textures->PeakBytes == 4000 && textures->Created == 2, "category keeps its peaks and creations");
+		Check(targets && targets->Count == 1 && targets->Bytes == 4000, "categories are separate");
+
+		tracker->EndFrame();
+		ResourceTracker::FrameStatistics frame = tracker->getLastFrame();
+		Check(tracker->getFrame() == 2 && frame.Created == 1 && frame.Released == 1 && frame.AllocatedBytes == 4000 &&
+			  frame.ReleasedBytes == 3000 && frame.getDelta() == 1000, "frame statistics");
+		tracker->EndFrame();
+		frame = tracker->getLastFrame();
+		Check(frame.Created == 0 && frame.Released == 0 && frame.getDelta() == 0, "empty frame");
+
+		vector<ResourceTracker::Resource> live = tracker->GetLiveResources();
+		Check(live.size() == 2 && live[0].Name == "wall" && live[0].Frame == 0 && live[1].Name == "shadow" &&
+			  live[1].Frame == 1 && live[1].Kind == "Texture2D", "live resources in the order of creation");
+		wostringstream leaks;
+		Check(tracker->WriteLeaks(leaks) == 2 && leaks.str().find(L"Textures/wall, 1000 bytes") != wstring::npos,
+			  "live resources are reported as leaks");
+		wostringstream report;
+		tracker->WriteReport(report);
+		Check(report.str().find(L"RenderTargets: 1 (1)") != wstring::npos, "report lists the categories");
+
+		wallTexture.reset();
+		shadowTexture.reset();
+		tracker->Remove(12345);
+		wostringstream none;
+		Check(tracker->getLiveCount() == 0 && tracker->getLiveBytes() == 0 && tracker->WriteLeaks(none) == 0 &&
+			  none.str().empty(), "no leaks after everything is released");
+		Check(wall.getReferences() == 0 && shadowMap.getReferences() == 0, "every object is released once");
+	}
+
+	void TestTextureBytes()
+	{
+		//4 * (256^2 + 128^2 + ... + 1)
+		Check(ResourceTracker::Texture2DBytes(TextureDesc(256, 256, 0, DXGI_FORMAT_R8G8B8A8_UNORM)) == 349524,
+			  "full mipmap chain");
+		Check(ResourceTracker::Texture2DBytes(TextureDesc(1024, 512, 0, DXGI_FORMAT_R32_FLOAT)) ==
+			  ResourceTracker::Texture2DBytes(TextureDesc(1024, 512, 11, DXGI_FORMAT_R32_FLOAT)),
+			  "0 mipmaps stands for every level down to 1x1");
+		Check(ResourceTracker::Texture2DBytes(TextureDesc(256, 256, 1, DXGI_FORMAT_BC1_UNORM)) == 32768,
+			  "BC1 takes 8 bytes per block");
+		Check(ResourceTracker::Texture2DBytes(TextureDesc(5, 5, 1, DXGI_FORMAT_BC3_UNORM)) == 64,
+			  "partial blocks are whole");
+		//5x5, 2x2 and 1x1 all take whole blocks
+		Check(ResourceTracker::Texture2DBytes(TextureDesc(5, 5, 0, DXGI_FORMAT_BC7_UNORM)) == 64 + 16 + 16,
+			  "small levels take a block");
+		D3D11_TEXTURE2D_DESC cube = TextureDesc(64, 64, 1, DXGI_FORMAT_R16G16B16A16_FLOAT);
+		cube.ArraySize = 6;
+		Check(ResourceTracker::Texture2DBytes(cube) == 6 * 64 * 64 * 8, "array slices");
+		D3D11_TEXTURE2D_DESC multisampled = TextureDesc(100, 50, 1, DXGI_FORMAT_D24_UNORM_S8_UINT);
+		multisampled.SampleDesc.Count = 4;
+		Check(ResourceTracker::Texture2DBytes(multisampled) == 4 * 100 * 50 * 4, "samples");
+		Check(ResourceTracker::Texture2DBytes(TextureDesc(64, 64, 1, DXGI_FORMAT_UNKNOWN)) == 0,
+			  "unknown format takes nothing");
+	}
+
+	//Threads track and release their own resources while the main thread ends frames
+	void TestThreads()
+	{
+		shared_ptr<ResourceTracker> tracker = make_shared<ResourceTracker>();
+		vector<FakeTexture> textures(THREADS * THREAD_RESOURCES);
+		vector<thread> threads;
+		for (unsigned int t = 0; t < THREADS; ++t)
+			threads.push_back(thread([&, t]()
+			{
+				vector<shared_ptr<ID3D11Texture2D>> kept;
+				for (unsigned int i = 0; i < THREAD_RESOURCES; ++i)
+				{
+					kept.push_back(Track(tracker, &textures[t * THREAD_RESOURCES + i], t % 2 ? "Odd" : "Even",
+										 "texture", i % 7 + 1));
+					if (kept.size() == 16)
+						kept.clear();
+				}
+			}));
+		for (unsigned int f = 0; f < 100; ++f)
+			tracker->EndFrame();
+		for (auto it = threads.begin(); it != threads.end(); ++it)
+			it->join();
+		unsigned int released = 0;
+		for (auto it = textures.begin(); it != textures.end(); ++it)
+			released += it->getReferences() == 0 ? 1 : 0;
+		vector<ResourceTracker::CategoryStatistics> statistics = tracker->GetStatistics();
+		Check(tracker->getLiveCount() == 0 && tracker->getLiveBytes() == 0, "threads leave nothing live");
+		Check(released == THREADS * THREAD_RESOURCES, "every object is released once");
+		Check(statistics.size() == 2 && statistics[0].Created + statistics[1].Created == THREADS * THREAD_RESOURCES &&
+			  statistics[0].Bytes == 0 && statistics[1].Bytes == 0, "creations of the threads are counted");
+		printf("%u resources on %u threads, peak %llu bytes\n", THREADS * THREAD_RESOURCES, THREADS,
+			   tracker->getPeakBytes());
+	}
+}
+
+int main()
+{
+	TestTrack();
+	TestTextureBytes();
+	TestThreads();
+	return TestResult();
+}
@@ -0,0 +1,204 @@
+#include "gk2_shaderCache.h"
+#include "gk2_testCheck.h"
+#include <cstdio>
+#include <exception>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+using namespace gk2;
+
+//ShaderCache driven by a stub compiler over files kept in memory, then the asset cache on the disk
+
+namespace
+{
+	class MemoryFileSystem : public FileSystem
+	{
+	public:
+		virtual bool ReadFile(const wstring& fileName, vector<BYTE>& data) const
+		{
+			auto it = m_files.find(fileName);
+			if (it == m_files.end())
+				return false;
+			data = it->second;
+			return true;
+		}
+
+		virtual bool WriteFile(const wstring& fileName, const vector<BYTE>& data) const
+		{
+			m_files[fileName] = data;
+			return true;
+		}
+
+		virtual bool MakeDirectory(const wstring& directory) const { return true; }
+		virtual wstring TempDirectory() const { return L"tmp/"; }
+
+		void Write(const wstring& fileName, const string& text)
+		{
+			m_files[fileName] = vector<BYTE>(text.begin(), text.end());
+		}
+
+		void Remove(const wstring& fileName) { m_files.erase(fileName); }
+
+	private:
+		mutable map<wstring, vector<BYTE>> m_files;
+	};
+
+	//Byte code is the entry point followed by the source. Sources naming "common.hlsli" include it.
+	class StubCompiler
+	{
+	public:
+		StubCompiler() : m_calls(0) { }
+
+		void operator()(const ShaderDesc& desc, const vector<BYTE>& source, vector<BYTE>& byteCode,
+						vector<wstring>& includes)
+		{
+			++m_calls;
+			string text(source.begin(), source.end());
+			if (text.find("error") != string::npos)
+				throw runtime_error("Syntax error");
+			byteCode.assign(desc.Entry.begin(), desc.Entry.end());
+			byteCode.insert(byteCode.end(), source.begin(), source.end());
+			if (text.find("common.hlsli") != string::npos)
+				includes.push_back(L"shaders/common.hlsli");
+		}
+
+		unsigned int getCalls() const { return m_calls; }
+
+	private:
+		unsigned int m_calls;
+	};
+
+	ShaderDesc Desc(const wstring& file, const string& entry, const string& model)
+	{
+		ShaderDesc desc;
+		desc.File = file;
+		desc.Entry = entry;
+		desc.Model = model;
+		return desc;
+	}
+
+	void TestMemory()
+	{
+		shared_ptr<MemoryFileSystem> files = make_shared<MemoryFileSystem>();
+		files->Write(L"shaders/phong.hlsl", "#include \"common.hlsli\" float4 main() { }");
+		files->Write(L"shaders/common.hlsli", "float4 light;");
+		files->Write(L"shaders/broken.hlsl", "error");
+		shared_ptr<AssetCache> assets = make_shared<AssetCache>(L"cache", files);
+		//The function copies the compiler, the calls are counted through the shared pointer
+		shared_ptr<StubCompiler> compiler = make_shared<StubCompiler>();
+		ShaderCompiler compile = [compiler](const ShaderDesc& desc, const vector<BYTE>& source,
+											vector<BYTE>& byteCode, vector<wstring>& includes)
+		{
+			(*compiler)(desc, source, byteCode, includes);
+		};
+
+		ShaderDesc vs = Desc(L"shaders/phong.hlsl", "VS_Main", "vs_4_0");
+		ShaderCache cache(assets, compile);
+		vector<BYTE> first = cache.Get(vs);
+		string expected = "VS_Main#include \"common.hlsli\" float4 main() { }";
+		Check(string(first.begin(), first.end()) == expected, "byte code comes from the compiler");
+		Check(cache.getMisses() == 1 && cache.getHits() == 0, "first lookup misses");
+		Check(cache.Get(vs) == first && cache.getHits() == 1 && compiler->getCalls() == 1, "second lookup hits");
+
+		ShaderCache restarted(assets, compile);
+		Check(restarted.Get(vs) == first && restarted.getHits() == 1 && compiler->getCalls() == 1,
+			  "entries outlive the cache object");
+
+		ShaderDesc ps = Desc(L"shaders/phong.hlsl", "PS_Main", "ps_4_0");
+		restarted.Get(ps);
+		Check(compiler->getCalls() == 2, "another entry point misses");
+		ShaderDesc model = Desc(L"shaders/phong.hlsl", "VS_Main", "vs_5_0");
+		restarted.Get(model);
+		Check(compiler->getCalls() == 3, "another shader model misses");
+		ShaderDesc defined = vs;
+		defined.Defines.push_back(make_pair(string("SHADOWS"), string("1")));
+		restarted.Get(defined);
+		Check(compiler->getCalls() == 4, "defines are part of the key");
+		defined.Defines[0].second = "0";
+		restarted.Get(defined);
+		Check(compiler->getCalls() == 5, "values of the defines are part of the key");
+		ShaderCache flags(assets, compile, 1);
+		flags.Get(vs);
+		Check(compiler->getCalls() == 6, "compiler flags are part of the key");
+		restarted.Get(vs);
+		Check(compiler->getCalls() == 6, "other keys leave the entry in place");
+
+		files->Write(L"shaders/common.hlsli", "float4 light; float4 ambient;");
+		restarted.Get(vs);
+		Check(compiler->getCalls() == 7, "modified include misses");
+		restarted.Get(vs);
+		Check(compiler->getCalls() == 7, "recompiled entry hits");
+		files->Remove(L"shaders/common.hlsli");
+		restarted.Get(vs);
+		Check(compiler->getCalls() == 8, "deleted include misses");
+		files->Write(L"shaders/phong.hlsl", "float4 main() { return 0; }");
+		vector<BYTE> edited = restarted.Get(vs);
+		Check(compiler->getCalls() == 9 &&
+			  string(edited.begin(), edited.end()) == "VS_Mainfloat4 main() { return 0; }",
+			  "modified source misses");
+
+		files->Write(L"shaders/shaders.manifest",
+					 "# file entry model defines\r\n"
+					 "shaders/phong.hlsl VS_Main vs_4_0\r\n"
+					 "\r\n"
+					 "shaders/phong.hlsl PS_Main ps_4_0 SHADOWS=1 LINEAR\r\n"
+					 "shaders/broken.hlsl VS_Main vs_4_0\r\n");
+		vector<ShaderDesc> manifest = restarted.ReadManifest(L"shaders/shaders.manifest");
+		Check(manifest.size() == 3, "manifest skips comments and empty lines");
+		Check(manifest.size() == 3 && manifest[1].Model == "ps_4_0" && manifest[1].Defines.size() == 2 &&
+			  manifest[1].Defines[0].first == "SHADOWS" && manifest[1].Defines[0].second == "1" &&
+			  manifest[1].Defines[1].first == "LINEAR" && manifest[1].Defines[1].second.empty(),
+			  "manifest lists the defines");
+		unsigned int calls = compiler->getCalls();
+		vector<ShaderDesc> failed = restarted.Precompile(manifest);
+		Check(failed.size() == 1 && failed[0].File == L"shaders/broken.hlsl", "precompile reports failed shaders");
+		Check(compiler->getCalls() == calls + 2, "precompile compiles only the missing shaders");
+		failed = restarted.Precompile(manifest);
+		Check(failed.size() == 1 && compiler->getCalls() == calls + 3, "failed shaders aren't cached");
+
+		bool thrown = false;
+		try
+		{
+			restarted.Get(Desc(L"shaders/missing.hlsl", "VS_Main", "vs_4_0"));
+		}
+		catch (const exception&)
+		{
+			thrown = true;
+		}
+		Check(thrown, "missing source throws");
+	}
+
+	//Artifacts stored by NativeFileSystem are read back by another cache in the same directory
+	void TestDisk()
+	{
+		wstring directory = NativeFileSystem().TempDirectory() + L"gk2ShaderCacheTest";
+		AssetCache cache(directory);
+		vector<BYTE> artifact(1000);
+		for (size_t i = 0; i < artifact.size(); ++i)
+			artifact[i] = static_cast<BYTE>(i * 7);
+		unsigned long long hash = AssetCache::Hash(artifact.data(), artifact.size());
+		Check(cache.Store("test", 1, hash, artifact), "artifact is stored on the disk");
+		vector<BYTE> loaded;
+		Check(AssetCache(directory).Load("test", 1, hash, loaded) && loaded == artifact, "artifact is read back");
+		Check(!cache.Load("test", 2, hash, loaded), "another cooker version misses");
+	}
+}
+
+int main()
+{
+	try
+	{
+		TestMemory();
+		TestDisk();
+	}
+	catch (const exception& e)
+	{
+		printf("FAILED: %s\n", e.what());
+		return 1;
+	}
+	if (TestFailures() == 0)
+		printf("All shader cache checks passed\n");
+	return TestResult();
+}
@@ -0,0 +1,662 @@
+#include "gk2_stateFilteringContext.h"
+#include "gk2_testCheck.h"
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace gk2;
+
+//Passes state calls through StateFilteringContext to a recording stand-in of the device context, which keeps the
+//state of the pipeline the way the runtime does, including unbinding shader resources of render targets. Checks
+//which calls reach it in chosen cases, then replays random calls through the filter and directly and compares the
+//state after every call.
+
+namespace
+{
+	const UINT CB_SLOTS = D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT;
+	const UINT SRV_SLOTS = D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT;
+	const UINT SAMPLER_SLOTS = D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT;
+	const UINT VB_SLOTS = D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT;
+	const UINT RT_SLOTS = D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT;
+	const UINT VIEWPORTS = D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE;
+	const unsigned int RANDOM_CALLS = 200000;
+
+	//Counts references, so that a test can check the filter releases what it gets
+	template<typename I>
+	class Object : public I
+	{
+	public:
+		Object() : m_references(1) { }
+		virtual ULONG AddRef() { return ++m_references; }
+		virtual ULONG Release() { return --m_references; }
+		ULONG getReferences() const { return m_references; }
+
+	private:
+		ULONG m_references;
+	};
+
+	template<typename I>
+	class View : public Object<I>
+	{
+	public:
+		explicit View(ID3D11Resource* resource) : m_resource(resource) { }
+		virtual void GetResource(ID3D11Resource** resource)
+		{
+			m_resource->AddRef();
+			*resource = m_resource;
+		}
+
+	private:
+		ID3D11Resource* m_resource;
+	};
+
+	typedef Object<ID3D11Texture2D> Texture;
+	typedef View<ID3D11ShaderResourceView> ShaderResourceView;
+	typedef View<ID3D11RenderTargetView> RenderTargetView;
+	typedef View<ID3D11DepthStencilView> DepthStencilView;
+
+	ID3D11Resource* ResourceOf(ID3D11View* view)
+	{
+		ID3D11Resource* resource;
+		view->GetResource(&resource);
+		resource->Release();
+		return resource;
+	}
+
+	struct Stage
+	{
+		void* Shader;
+		ID3D11Buffer* ConstantBuffers[CB_SLOTS];
+		ID3D11ShaderResourceView* ShaderResources[SRV_SLOTS];
+		ID3D11SamplerState* Samplers[SAMPLER_SLOTS];
+	};
+
+	//Pipeline state as the runtime keeps it
+	struct PipelineState
+	{
+		Stage Stages[5];
+		ID3D11InputLayout* InputLayout;
+		D3D11_PRIMITIVE_TOPOLOGY Topology;
+		ID3D11Buffer* VertexBuffers[VB_SLOTS];
+		UINT Strides[VB_SLOTS];
+		UINT Offsets[VB_SLOTS];
+		ID3D11Buffer* IndexBuffer;
+		DXGI_FORMAT IndexFormat;
+		UINT IndexOffset;
+		ID3D11RasterizerState* RasterizerState;
+		UINT ViewportsCount;
+		D3D11_VIEWPORT Viewports[VIEWPORTS];
+		ID3D11BlendState* BlendState;
+		FLOAT BlendFactor[4];
+		UINT SampleMask;
+		ID3D11DepthStencilState* DepthStencilState;
+		UINT StencilRef;
+		ID3D11RenderTargetView* RenderTargets[RT_SLOTS];
+		ID3D11DepthStencilView* DepthStencilView;
+	};
+
+	enum StageIndex { VS, HS, DS, GS, PS };
+
+	class RecordingContext : public RenderContext
+	{
+	public:
+		PipelineState State;
+		//Every call which reached the context
+		vector<string> Calls;
+
+		RecordingContext()
+		{
+			memset(&State, 0, sizeof(State));
+			for (int i = 0; i < 4; ++i)
+				State.BlendFactor[i] = 1.0f;
+			State.SampleMask = 0xffffffff;
+		}
+
+		virtual void VSSetShader(ID3D11VertexShader* shader, ID3D11ClassInstance* const*, UINT)
+		{
+			SetShader(VS, "VSSetShader", shader);
+		}
+		virtual void GSSetShader(ID3D11GeometryShader* shader, ID3D11ClassInstance* const*, UINT)
+		{
+			SetShader(GS, "GSSetShader", shader);
+		}
+		virtual void PSSetShader(ID3D11PixelShader* shader, ID3D11ClassInstance* const*, UINT)
+		{
+			SetShader(PS, "PSSetShader", shader);
+		}
+		virtual void HSSetShader(ID3D11HullShader* shader, ID3D11ClassInstance* const*, UINT)
+		{
+			SetShader(HS, "HSSetShader", shader);
+		}
+		virtual void DSSetShader(ID3D11DomainShader* shader, ID3D11ClassInstance* const*, UINT)
+		{
+			SetShader(DS, "DSSetShader", shader);
+		}
+		virtual void VSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers)
+		{
+			SetSlots("VSSetConstantBuffers", State.Stages[VS].ConstantBuffers, CB_SLOTS, startSlot, count, buffers);
+		}
+		virtual void GSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers)
+		{
+			SetSlots("GSSetConstantBuffers", State.Stages[GS].ConstantBuffers, CB_SLOTS, startSlot, count, buffers);
+		}
+		virtual void PSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers)
+		{
+			SetSlots("PSSetConstantBuffers", State.Stages[PS].ConstantBuffers, CB_SLOTS, startSlot, count, buffers);
+		}
+		virtual void HSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers)
+		{
+			SetSlots("HSSetConstantBuffers", State.Stages[HS].ConstantBuffers, CB_SLOTS, startSlot, count, buffers);
+		}
+		virtual void DSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers)
+		{
+			SetSlots("DSSetConstantBuffers", State.Stages[DS].ConstantBuffers, CB_SLOTS, startSlot, count, buffers);
+		}
+		virtual void PSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView* const* views)
+		{
+			SetShaderResources("PSSetShaderResources", PS, startSlot, count, views);
+		}
+		virtual void DSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView* const* views)
+		{
+			SetShaderResources("DSSetShaderResources", DS, startSlot, count, views);
+		}
+		virtual void PSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState* const* samplers)
+		{
+			SetSlots("PSSetSamplers", State.Stages[PS].Samplers, SAMPLER_SLOTS, startSlot, count, samplers);
+		}
+		virtual void DSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState* const* samplers)
+		{
+			SetSlots("DSSetSamplers", State.Stages[DS].Samplers, SAMPLER_SLOTS, startSlot, count, samplers);
+		}
+
+		virtual void IASetInputLayout(ID3D11InputLayout* layout)
+		{
+			Record("IASetInputLayout");
+			State.InputLayout = layout;
+		}
+		virtual void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+		{
+			Record("IASetPrimitiveTopology");
+			State.Topology = topology;
+		}
+		virtual void IASetVertexBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* strides,
+										const UINT* offsets)
+		{
+			Record("IASetVertexBuffers", startSlot, count);
+			if (startSlot > VB_SLOTS || count > VB_SLOTS - startSlot)
+				return;
+			for (UINT i = 0; i < count; ++i)
+			{
+				State.VertexBuffers[startSlot + i] = buffers[i];
+				State.Strides[startSlot + i] = strides[i];
+				State.Offsets[startSlot + i] = offsets[i];
+			}
+		}
+		virtual void IASetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset)
+		{
+			Record("IASetIndexBuffer");
+			State.IndexBuffer = buffer;
+			State.IndexFormat = format;
+			State.IndexOffset = offset;
+		}
+
+		virtual void RSSetState(ID3D11RasterizerState* state)
+		{
+			Record("RSSetState");
+			State.RasterizerState = state;
+		}
+		virtual void RSSetViewports(UINT count, const D3D11_VIEWPORT* viewports)
+		{
+			Record("RSSetViewports", 0, count);
+			State.ViewportsCount = count;
+			for (UINT i = 0; i < count; ++i)
+				State.Viewports[i] = viewports[i];
+		}
+		virtual void OMSetBlendState(ID3D11BlendState* state, const FLOAT blendFactor[4], UINT sampleMask)
+		{
+			Record("OMSetBlendState");
+			State.BlendState = state;
+			for (int i = 0; i < 4; ++i)
+				State.BlendFactor[i] = blendFactor ? blendFactor[i] : 1.0f;
+			State.SampleMask = sampleMask;
+		}
+		virtual void OMSetDepthStencilState(ID3D11DepthStencilState* state, UINT stencilRef)
+		{
+			Record("OMSetDepthStencilState");
+			State.DepthStencilState = state;
+			State.StencilRef = stencilRef;
+		}
+		virtual void OMSetRenderTargets(UINT count, ID3D11RenderTargetView* const* views,
+										ID3D11DepthStencilView* depthStencilView)
+		{
+			Record("OMSetRenderTargets", 0, count);
+			for (UINT i = 0; i < RT_SLOTS; ++i)
+				State.RenderTargets[i] = i < count ? views[i] : nullptr;
+			State.DepthStencilView = depthStencilView;
+			//Shader resources of the textures which became targets are unbound
+			for (int s = 0; s < 5; ++s)
+				for (UINT i = 0; i < SRV_SLOTS; ++i)
+					if (State.Stages[s].ShaderResources[i] && IsTarget(State.Stages[s].ShaderResources[i]))
+						State.Stages[s].ShaderResources[i] = nullptr;
+		}
+
+		virtual void ClearRenderTargetView(ID3D11RenderTargetView*, const FLOAT[4]) { Record("ClearRenderTargetView"); }
+		virtual void ClearDepthStencilView(ID3D11DepthStencilView*, UINT, FLOAT, UINT8)
+		{
+			Record("ClearDepthStencilView");
+		}
+		virtual void Draw(UINT, UINT) { Record("Draw"); }
+		virtual void DrawIndexed(UINT, UINT, INT) { Record("DrawIndexed"); }
+		virtual void DrawIndexedInstanced(UINT, UINT, UINT, INT, UINT) { Record("DrawIndexedInstanced"); }
+		virtual HRESULT Map(ID3D11Resource*, UINT, D3D11_MAP, UINT, D3D11_MAPPED_SUBRESOURCE*)
+		{
+			Record("Map");
+			return S_OK;
+		}
+		virtual void Unmap(ID3D11Resource*, UINT) { Record("Unmap"); }
+		virtual void UpdateSubresource(ID3D11Resource*, UINT, const D3D11_BOX*, const void*, UINT, UINT)
+		{
+			Record("UpdateSubresource");
+		}
+		virtual void CopySubresourceRegion(ID3D11Resource*, UINT, UINT, UINT, UINT, ID3D11Resource*, UINT,
+										   const D3D11_BOX*)
+		{
+			Record("CopySubresourceRegion");
+		}
+
+	private:
+		void Record(const char* name, UINT startSlot = 0, UINT count = 0)
+		{
+			string call = name;
+			if (count)
+				call += " " + to_string(startSlot) + " " + to_string(count);
+			Calls.push_back(call);
+		}
+
+		void SetShader(StageIndex stage, const char* name, void* shader)
+		{
+			Record(name);
+			State.Stages[stage].Shader = shader;
+		}
+
+		//Out of range calls are ignored by the runtime
+		template<typename T>
+		void SetSlots(const char* name, T* slots, UINT slotsCount, UINT startSlot, UINT count, T const* values)
+		{
+			Record(name, startSlot, count);
+			if (startSlot > slotsCount || count > slotsCount - startSlot)
+				return;
+			for (UINT i = 0; i < count; ++i)
+				slots[startSlot + i] = values ? values[i] : nullptr;
+		}
+
+		bool IsTarget(ID3D11View* view)
+		{
+			ID3D11Resource* resource = ResourceOf(view);
+			for (UINT i = 0; i < RT_SLOTS; ++i)
+				if (State.RenderTargets[i] && ResourceOf(State.RenderTargets[i]) == resource)
+					return true;
+			return State.DepthStencilView && ResourceOf(State.DepthStencilView) == resource;
+		}
+
+		//Views of the bound targets' textures are bound as null
+		void SetShaderResources(const char* name, StageIndex stage, UINT startSlot, UINT count,
+								ID3D11ShaderResourceView* const* views)
+		{
+			SetSlots(name, State.Stages[stage].ShaderResources, SRV_SLOTS, startSlot, count, views);
+			if (startSlot > SRV_SLOTS || count > SRV_SLOTS - startSlot)
+				return;
+			for (UINT i = startSlot; i < startSlot + count; ++i)
+			{
+				ID3D11ShaderResourceView*& view = State.Stages[stage].ShaderResources[i];
+				if (view && IsTarget(view))
+					view = nullptr;
+			}
+		}
+	};
+
+	bool SameViewports(const PipelineState& a, const PipelineState& b)
+	{
+		if (a.ViewportsCount != b.ViewportsCount)
+			return false;
+		for (UINT i = 0; i < a.ViewportsCount; ++i)
+			if (memcmp(&a.Viewports[i], &b.Viewports[i], sizeof(D3D11_VIEWPORT)) != 0)
+				return false;
+		return true;
+	}
+
+	//Viewports past the count are not part of the state
+	bool SameState(const PipelineState& a, const PipelineState& b)
+	{
+		return memcmp(a.Stages, b.Stages, sizeof(a.Stages)) == 0 && a.InputLayout == b.InputLayout &&
+			   a.Topology == b.Topology && memcmp(a.VertexBuffers, b.VertexBuffers, sizeof(a.VertexBuffers)) == 0 &&
+			   memcmp(a.Strides, b.Strides, sizeof(a.Strides)) == 0 &&
+			   memcmp(a.Offsets, b.Offsets, sizeof(a.Offsets)) == 0 && a.IndexBuffer == b.IndexBuffer &&
+			   a.IndexFormat == b.IndexFormat && a.IndexOffset == b.IndexOffset &&
+			   a.RasterizerState == b.RasterizerState && SameViewports(a, b) && a.BlendState == b.BlendState &&
+			   memcmp(a.BlendFactor, b.BlendFactor, sizeof(a.BlendFactor)) == 0 && a.SampleMask == b.SampleMask &&
+			   a.DepthStencilState == b.DepthStencilState && a.StencilRef == b.StencilRef &&
+			   memcmp(a.RenderTargets, b.RenderTargets, sizeof(a.RenderTargets)) == 0 &&
+			   a.DepthStencilView == b.DepthStencilView;
+	}
+
+	//Objects the calls bind, a few of each so that the same ones come back often
+	struct Objects
+	{
+		Object<ID3D11VertexShader> VertexShaders[2];
+		Object<ID3D11HullShader> HullShaders[2];
+		Object<ID3D11DomainShader> DomainShaders[2];
+		Object<ID3D11GeometryShader> GeometryShaders[2];
+		Object<ID3D11PixelShader> PixelShaders[2];
+		Object<ID3D11ClassInstance> ClassInstance;
+		Object<ID3D11Buffer> Buffers[4];
+		Object<ID3D11SamplerState> Samplers[3];
+		Object<ID3D11InputLayout> Layouts[2];
+		Object<ID3D11RasterizerState> RasterizerStates[2];
+		Object<ID3D11BlendState> BlendStates[2];
+		Object<ID3D11DepthStencilState> DepthStencilStates[2];
+		//Every texture can be read and be a target
+		Texture Textures[4];
+		Texture DepthTextures[2];
+		vector<unique_ptr<ShaderResourceView>> ShaderResources;
+		vector<unique_ptr<RenderTargetView>> RenderTargets;
+		vector<unique_ptr<DepthStencilView>> DepthStencils;
+		//Render target views to pass to OMSetRenderTargets one at a time
+		ID3D11RenderTargetView* Targets[4];
+
+		Objects()
+		{
+			for (int i = 0; i < 4; ++i)
+			{
+				ShaderResources.push_back(unique_ptr<ShaderResourceView>(new ShaderResourceView(&Textures[i])));
+				RenderTargets.push_back(unique_ptr<RenderTargetView>(new RenderTargetView(&Textures[i])));
+				Targets[i] = RenderTargets[i].get();
+			}
+			for (int i = 0; i < 2; ++i)
+			{
+				ShaderResources.push_back(unique_ptr<ShaderResourceView>(new ShaderResourceView(&DepthTextures[i])));
+				DepthStencils.push_back(unique_ptr<DepthStencilView>(new DepthStencilView(&DepthTextures[i])));
+			}
+		}
+	};
+
+	//Filter in front of a recording context
+	struct Filtered
+	{
+		shared_ptr<RecordingContext> Recording;
+		StateFilteringContext Filter;
+
+		Filtered() : Recording(new RecordingContext()), Filter(Recording) { }
+
+		//Calls which reached the context since the last time
+		vector<string> TakeCalls()
+		{
+			vector<string> calls;
+			calls.swap(Recording->Calls);
+			return calls;
+		}
+	};
+
+	bool Issued(Filtered& f, const char* call)
+	{
+		vector<string> calls = f.TakeCalls();
+		return calls.size() == 1 && calls[0] == call;
+	}
+
+	bool Dropped(Filtered& f)
+	{
+		return f.TakeCalls().empty();
+	}
+
+	void CheckRedundantCalls(Objects& o)
+	{
+		Filtered f;
+		ID3D11VertexShader* vs = &o.VertexShaders[0];
+		f.Filter.VSSetShader(vs, nullptr, 0);
+		Check(Issued(f, "VSSetShader"), "first shader is bound");
+		f.Filter.VSSetShader(vs, nullptr, 0);
+		Check(Dropped(f), "same shader is dropped");
+		ID3D11ClassInstance* instance = &o.ClassInstance;
+		f.Filter.VSSetShader(vs, &instance, 1);
+		f.Filter.VSSetShader(vs, nullptr, 0);
+		Check(f.TakeCalls().size() == 2, "shaders with class instances are always bound");
+		f.Filter.HSSetShader(&o.HullShaders[0], nullptr, 0);
+		f.Filter.DSSetShader(&o.DomainShaders[0], nullptr, 0);
+		f.Filter.HSSetShader(&o.HullShaders[0], nullptr, 0);
+		f.Filter.DSSetShader(&o.DomainShaders[0], nullptr, 0);
+		Check(f.TakeCalls().size() == 2, "tessellation shaders are filtered");
+
+		ID3D11SamplerState* samplers[3] = { &o.Samplers[0], &o.Samplers[1], &o.Samplers[2] };
+		f.Filter.PSSetSamplers(0, 3, samplers);
+		Check(Issued(f, "PSSetSamplers 0 3"), "new samplers are bound");
+		samplers[1] = &o.Samplers[2];
+		f.Filter.PSSetSamplers(0, 3, samplers);
+		Check(Issued(f, "PSSetSamplers 1 1"), "only the changed slot is bound");
+		f.Filter.DSSetSamplers(0, 3, samplers);
+		Check(Issued(f, "DSSetSamplers 0 3"), "stages have their own slots");
+
+		ID3D11Buffer* buffers[2] = { &o.Buffers[0], &o.Buffers[1] };
+		f.Filter.VSSetConstantBuffers(0, 2, buffers);
+		f.Filter.HSSetConstantBuffers(0, 2, buffers);
+		f.Filter.DSSetConstantBuffers(0, 2, buffers);
+		f.TakeCalls();
+		f.Filter.HSSetConstantBuffers(0, 2, buffers);
+		f.Filter.DSSetConstantBuffers(1, 1, buffers + 1);
+		Check(Dropped(f), "bound constant buffers are dropped");
+		f.Filter.PSSetConstantBuffers(CB_SLOTS - 1, 2, buffers);
+		Check(Issued(f, "PSSetConstantBuffers 13 2"), "invalid ranges are passed on");
+
+		UINT strides[2] = { 12, 16 }, offsets[2] = { 0, 0 };
+		f.Filter.IASetVertexBuffers(0, 2, buffers, strides, offsets);
+		f.TakeCalls();
+		offsets[1] = 64;
+		f.Filter.IASetVertexBuffers(0, 2, buffers, strides, offsets);
+		Check(Issued(f, "IASetVertexBuffers 1 1"), "vertex buffer with a new offset is bound");
+
+		FLOAT ones[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		f.Filter.OMSetBlendState(&o.BlendStates[0], nullptr, 0xffffffff);
+		f.Filter.OMSetBlendState(&o.BlendStates[0], ones, 0xffffffff);
+		Check(Issued(f, "OMSetBlendState"), "null blend factor is the same as ones");
+		f.Filter.OMSetDepthStencilState(&o.DepthStencilStates[0], 0);
+		f.Filter.OMSetDepthStencilState(&o.DepthStencilStates[0], 1);
+		Check(f.TakeCalls().size() == 2, "new stencil reference is set");
+
+		f.Filter.Draw(3, 0);
+		f.Filter.DrawIndexed(3, 0, 0);
+		f.Filter.DrawIndexedInstanced(3, 2, 0, 0, 0);
+		f.Filter.UpdateSubresource(&o.Buffers[0], 0, nullptr, ones, 0, 0);
+		f.Filter.CopySubresourceRegion(&o.Textures[0], 0, 0, 0, 0, &o.Textures[1], 0, nullptr);
+		f.Filter.ClearRenderTargetView(o.RenderTargets[0].get(), ones);
+		f.Filter.Draw(3, 0);
+		Check(f.TakeCalls().size() == 7, "draws, updates and clears are always passed on");
+
+		StateFilteringContext::Statistics frame = f.Filter.getFrameStatistics();
+		printf("Chosen calls: %u issued, %u filtered\n", frame.Issued, frame.Filtered);
+		f.Filter.BeginFrame();
+		Check(f.Filter.getFrameStatistics().Issued == 0 && f.Filter.getLastFrameStatistics().Filtered == frame.Filtered,
+			  "frame statistics start again");
+
+		f.Filter.Invalidate();
+		f.Filter.VSSetShader(vs, nullptr, 0);
+		f.Filter.PSSetSamplers(0, 3, samplers);
+		Check(f.TakeCalls().size() == 2, "invalidated state is bound again");
+	}
+
+	void CheckRenderTargets(Objects& o)
+	{
+		Filtered f;
+		ID3D11ShaderResourceView* views[2] = { o.ShaderResources[0].get(), o.ShaderResources[1].get() };
+		ID3D11RenderTargetView* target = o.RenderTargets[0].get();
+		f.Filter.OMSetRenderTargets(1, &o.Targets[2], nullptr);
+		f.Filter.PSSetShaderResources(0, 2, views);
+		f.Filter.DSSetShaderResources(0, 2, views);
+		f.TakeCalls();
+
+		//Texture 0 becomes the target, the runtime unbinds its views
+		f.Filter.OMSetRenderTargets(1, &target, nullptr);
+		f.TakeCalls();
+		f.Filter.PSSetShaderResources(0, 2, views);
+		Check(Issued(f, "PSSetShaderResources 0 1"), "view of the new target is bound again");
+		f.Filter.DSSetShaderResources(0, 2, views);
+		Check(Issued(f, "DSSetShaderResources 0 1"), "view of the new target is bound again to the domain shader");
+		Check(f.Recording->State.Stages[PS].ShaderResources[0] == nullptr &&
+			  f.Recording->State.Stages[PS].ShaderResources[1] == views[1], "runtime ignored the target's view");
+
+		//View bound while its texture was the target was ignored, it's bound again once the target changes
+		f.Filter.OMSetRenderTargets(1, &o.Targets[3], o.DepthStencils[0].get());
+		f.TakeCalls();
+		f.Filter.PSSetShaderResources(0, 2, views);
+		Check(Issued(f, "PSSetShaderResources 0 1"), "view of the previous target is bound again");
+		Check(f.Recording->State.Stages[PS].ShaderResources[0] == views[0], "view of the previous target is bound");
+
+		//Depth stencil view is a target as well
+		ID3D11ShaderResourceView* depth = o.ShaderResources[4].get();
+		f.Filter.PSSetShaderResources(2, 1, &depth);
+		f.Filter.OMSetRenderTargets(1, &o.Targets[3], o.DepthStencils[1].get());
+		f.TakeCalls();
+		f.Filter.PSSetShaderResources(0, 2, views);
+		f.Filter.PSSetShaderResources(2, 1, &depth);
+		Check(Issued(f, "PSSetShaderResources 2 1"), "view of the previous depth stencil is bound again");
+
+		ULONG references = o.Textures[0].getReferences();
+		Check(references == 1 && o.DepthTextures[0].getReferences() == 1, "references to the textures are released");
+	}
+
+	//Random calls with the objects, often the same ones again
+	void RandomCall(RenderContext& c, Objects& o, mt19937& random)
+	{
+		uniform_int_distribution<int> call(0, 15), two(0, 1), three(0, 2), four(0, 3), six(0, 5);
+		ID3D11Buffer* buffers[4];
+		ID3D11ShaderResourceView* views[4];
+		ID3D11SamplerState* samplers[4];
+		UINT strides[4], offsets[4];
+		UINT count = 1 + four(random), start = four(random);
+		for (UINT i = 0; i < count; ++i)
+		{
+			buffers[i] = four(random) ? &o.Buffers[four(random)] : nullptr;
+			views[i] = four(random) ? o.ShaderResources[six(random)].get() : nullptr;
+			samplers[i] = &o.Samplers[three(random)];
+			strides[i] = 16 * (1 + two(random));
+			offsets[i] = 64 * two(random);
+		}
+		switch (call(random))
+		{
+		case 0:
+			c.VSSetShader(&o.VertexShaders[two(random)], nullptr, 0);
+			c.PSSetShader(&o.PixelShaders[two(random)], nullptr, 0);
+			break;
+		case 1:
+			c.HSSetShader(two(random) ? &o.HullShaders[two(random)] : nullptr, nullptr, 0);
+			c.DSSetShader(two(random) ? &o.DomainShaders[two(random)] : nullptr, nullptr, 0);
+			c.GSSetShader(two(random) ? &o.GeometryShaders[two(random)] : nullptr, nullptr, 0);
+			break;
+		case 2:
+		{
+			void (RenderContext::*set[5])(UINT, UINT, ID3D11Buffer* const*) = { &RenderContext::VSSetConstantBuffers,
+				&RenderContext::HSSetConstantBuffers, &RenderContext::DSSetConstantBuffers,
+				&RenderContext::GSSetConstantBuffers, &RenderContext::PSSetConstantBuffers };
+			(c.*set[uniform_int_distribution<int>(0, 4)(random)])(start, count, buffers);
+			break;
+		}
+		case 3:
+		case 4:
+			c.PSSetShaderResources(start, count, views);
+			break;
+		case 5:
+			c.DSSetShaderResources(start, count, views);
+			break;
+		case 6:
+			if (two(random))
+				c.PSSetSamplers(start, count, samplers);
+			else
+				c.DSSetSamplers(start, count, samplers);
+			break;
+		case 7:
+			c.IASetInputLayout(&o.Layouts[two(random)]);
+			c.IASetPrimitiveTopology(two(random) ? D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST :
+								  D3D11_PRIMITIVE_TOPOLOGY_16_CONTROL_POINT_PATCHLIST);
+			break;
+		case 8:
+			for (UINT i = 0; i < count; ++i)
+				buffers[i] = &o.Buffers[four(random)];
+			c.IASetVertexBuffers(start, count, buffers, strides, offsets);
+			break;
+		case 9:
+			c.IASetIndexBuffer(&o.Buffers[four(random)], two(random) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT,
+							   offsets[0]);
+			break;
+		case 10:
+		{
+			c.RSSetState(&o.RasterizerStates[two(random)]);
+			D3D11_VIEWPORT viewports[2] = { { 0.0f, 0.0f, 256.0f, 256.0f, 0.0f, 1.0f },
+											{ 0.0f, 0.0f, 1024.0f, 768.0f, 0.0f, 1.0f } };
+			c.RSSetViewports(1 + two(random), viewports + two(random) * 0);
+			break;
+		}
+		case 11:
+		{
+			FLOAT factor[4] = { 1.0f, 1.0f, 1.0f, two(random) ? 1.0f : 0.5f };
+			c.OMSetBlendState(two(random) ? &o.BlendStates[two(random)] : nullptr, two(random) ? factor : nullptr,
+							  0xffffffff);
+			c.OMSetDepthStencilState(&o.DepthStencilStates[two(random)], two(random));
+			break;
+		}
+		case 12:
+		case 13:
+		{
+			ID3D11RenderTargetView* targets[2] = { o.RenderTargets[four(random)].get(),
+												   o.RenderTargets[four(random)].get() };
+			c.OMSetRenderTargets(1 + two(random) * three(random) / 2, targets,
+								 two(random) ? o.DepthStencils[two(random)].get() : nullptr);
+			break;
+		}
+		case 14:
+			c.DrawIndexed(36, 0, 0);
+			break;
+		default:
+			c.Draw(3, 0);
+			break;
+		}
+	}
+
+	void CheckRandomCalls(Objects& o)
+	{
+		mt19937 random(36), replay(36);
+		Filtered f;
+		RecordingContext direct;
+		unsigned int mismatches = 0;
+		for (unsigned int i = 0; i < RANDOM_CALLS; ++i)
+		{
+			RandomCall(f.Filter, o, random);
+			RandomCall(direct, o, replay);
+			if (!SameState(f.Recording->State, direct.State) && ++mismatches == 1)
+				printf("  state differs after call %u\n", i);
+			//Now and then the wrapped context is used directly
+			if (i % 5000 == 4999)
+			{
+				f.Recording->OMSetRenderTargets(1, &o.Targets[0], nullptr);
+				direct.OMSetRenderTargets(1, &o.Targets[0], nullptr);
+				f.Filter.Invalidate();
+			}
+		}
+		Check(mismatches == 0, "filtered calls leave the state of the unfiltered ones");
+		const StateFilteringContext::Statistics& total = f.Filter.getTotalStatistics();
+		printf("Random calls: %zu reached the context directly, %zu through the filter, %u issued, %u filtered\n",
+			   direct.Calls.size(), f.Recording->Calls.size(), total.Issued, total.Filtered);
+		Check(f.Recording->Calls.size() < direct.Calls.size(), "filter drops calls");
+		Check(o.Textures[0].getReferences() == 1 && o.Textures[3].getReferences() == 1,
+			  "references to the textures are released");
+	}
+}
+
+int main()
+{
+	Objects objects;
+	CheckRedundantCalls(objects);
+	CheckRenderTargets(objects);
+	CheckRandomCalls(objects);
+	return TestResult();
+}
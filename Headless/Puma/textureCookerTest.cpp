@@ -0,0 +1,345 @@
+#include "gk2_imageDecoder.h"
+#include "gk2_testCheck.h"
+#include "gk2_textureCooker.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <string>
+
+using namespace std;
+using namespace gk2;
+
+//Cooks the textures of Puma, checks the layout of the DDS files and decodes the blocks back to measure the PSNR
+//of the encoder against the source image and against bounding box endpoints, the simplest BC1 encoder. Checks
+//that mipmaps of sRGB images keep their brightness and reports the throughput of the encoder and of cooking.
+//Usage: puma_texture_cooker <resources directory>
+
+namespace
+{
+	const char* TEXTURES[] = { "stones.jpg", "metal.jpg", "lava.jpg", "sun.jpg", "smoke.png", "light_cookie.png",
+							   "spark.png", "smokecolors.png" };
+	const unsigned int TEXTURES_COUNT = sizeof(TEXTURES) / sizeof(TEXTURES[0]);
+	//Lowest PSNR in dB of the decoded level 0, BC1 and BC3 over the RGB channels, BC5 over the two it keeps
+	const double MIN_COLOR_PSNR = 30.0;
+	const double MIN_CHANNEL_PSNR = 40.0;
+	//Smooth images have blocks where the bounding box is already the best line, the encoder may lose a little
+	//on them but has to win on average
+	const double MAX_LOSS_TO_BOUNDING_BOX = 0.5;
+	const unsigned int DDS_HEADER_SIZE = 4 + 124;
+	const unsigned int DX10_HEADER_SIZE = 20;
+	const unsigned int RUNS = 3;
+
+	typedef chrono::steady_clock Clock;
+
+	double Milliseconds(Clock::time_point start)
+	{
+		return chrono::duration<double, milli>(Clock::now() - start).count();
+	}
+
+	unsigned int ReadUInt(const BYTE* p)
+	{
+		return p[0] | p[1] << 8 | p[2] << 16 | static_cast<unsigned int>(p[3]) << 24;
+	}
+
+	void Unpack565(unsigned int c, int rgb[3])
+	{
+		rgb[0] = ((c >> 11) & 31) * 255 / 31;
+		rgb[1] = ((c >> 5) & 63) * 255 / 63;
+		rgb[2] = (c & 31) * 255 / 31;
+	}
+
+	//Writes the 16 colors of a BC1 block to RGB channels of out, rows of pitch bytes
+	void DecodeColorBlock(const BYTE* block, BYTE* out, unsigned int pitch)
+	{
+		unsigned int c0 = block[0] | block[1] << 8, c1 = block[2] | block[3] << 8;
+		int palette[4][3];
+		Unpack565(c0, palette[0]);
+		Unpack565(c1, palette[1]);
+		for (int c = 0; c < 3; ++c)
+			if (c0 > c1)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+			else
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+		unsigned int indices = ReadUInt(block + 4);
+		for (int i = 0; i < 16; ++i)
+			for (int c = 0; c < 3; ++c)
+				out[(i / 4) * pitch + (i % 4) * 4 + c] = static_cast<BYTE>(palette[(indices >> (2 * i)) & 3][c]);
+	}
+
+	//Writes the 16 values of a BC3 alpha or BC5 channel block to every fourth byte of out
+	void DecodeChannelBlock(const BYTE* block, BYTE* out, unsigned int pitch)
+	{
+		int palette[8] = { block[0], block[1] };
+		if (block[0] > block[1])
+			for (int i = 1; i < 7; ++i)
+				palette[i + 1] = ((7 - i) * block[0] + i * block[1]) / 7;
+		else
+		{
+			for (int i = 1; i < 5; ++i)
+				palette[i + 1] = ((5 - i) * block[0] + i * block[1]) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+		unsigned long long bits = 0;
+		for (int i = 0; i < 6; ++i)
+			bits |= static_cast<unsigned long long>(block[2 + i]) << (8 * i);
+		for (int i = 0; i < 16; ++i)
+			out[(i / 4) * pitch + (i % 4) * 4] = static_cast<BYTE>(palette[(bits >> (3 * i)) & 7]);
+	}
+
+	//Image of the size of the source with the channels the format keeps, the other ones are zero
+	TextureCooker::Image Decode(const BYTE* data, unsigned int width, unsigned int height,
+								TextureCooker::Format format)
+	{
+		TextureCooker::Image image;
+		image.Width = width;
+		image.Height = height;
+		image.Pixels.assign(width * height * 4, 0);
+		unsigned int blockSize = format == TextureCooker::FORMAT_BC1 ? 8 : 16, pitch = width * 4;
+		for (unsigned int by = 0; by < height / 4; ++by)
+			for (unsigned int bx = 0; bx < width / 4; ++bx)
+			{
+				const BYTE* block = data + (by * (width / 4) + bx) * blockSize;
+				BYTE* out = &image.Pixels[(by * 4 * width + bx * 4) * 4];
+				switch (format)
+				{
+				case TextureCooker::FORMAT_BC1:
+					DecodeColorBlock(block, out, pitch);
+					break;
+				case TextureCooker::FORMAT_BC3:
+					DecodeChannelBlock(block, out + 3, pitch);
+					DecodeColorBlock(block + 8, out, pitch);
+					break;
+				case TextureCooker::FORMAT_BC5:
+					DecodeChannelBlock(block, out, pitch);
+					DecodeChannelBlock(block + 8, out + 1, pitch);
+					break;
+				default:
+					break;
+				}
+			}
+		return image;
+	}
+
+	//Over the channels from first up to last
+	double PSNR(const TextureCooker::Image& a, const TextureCooker::Image& b, unsigned int first, unsigned int last)
+	{
+		double error = 0.0;
+		for (size_t i = 0; i < a.Pixels.size(); i += 4)
+			for (unsigned int c = first; c <= last; ++c)
+			{
+				double d = static_cast<double>(a.Pixels[i + c]) - b.Pixels[i + c];
+				error += d * d;
+			}
+		double mse = error / (a.Pixels.size() / 4 * (last - first + 1));
+		return mse == 0.0 ? 99.0 : 10.0 * log10(255.0 * 255.0 / mse);
+	}
+
+	unsigned int Pack565(const int rgb[3])
+	{
+		return (rgb[0] * 31 + 127) / 255 << 11 | (rgb[1] * 63 + 127) / 255 << 5 | (rgb[2] * 31 + 127) / 255;
+	}
+
+	//BC1 with the corners of the bounding box of the block colors as endpoints
+	vector<BYTE> EncodeBoundingBox(const TextureCooker::Image& image)
+	{
+		unsigned int blocksX = image.Width / 4, blocksY = image.Height / 4;
+		vector<BYTE> data(blocksX * blocksY * 8);
+		for (unsigned int by = 0; by < blocksY; ++by)
+			for (unsigned int bx = 0; bx < blocksX; ++bx)
+			{
+				int lo[3] = { 255, 255, 255 }, hi[3] = { 0, 0, 0 };
+				for (unsigned int i = 0; i < 16; ++i)
+					for (int c = 0; c < 3; ++c)
+					{
+						int v = image.Pixels[((by * 4 + i / 4) * image.Width + bx * 4 + i % 4) * 4 + c];
+						lo[c] = min(lo[c], v);
+						hi[c] = max(hi[c], v);
+					}
+				unsigned int c0 = Pack565(hi), c1 = Pack565(lo);
+				if (c0 < c1)
+					swap(c0, c1);
+				BYTE* out = &data[(by * blocksX + bx) * 8];
+				out[0] = static_cast<BYTE>(c0);
+				out[1] = static_cast<BYTE>(c0 >> 8);
+				out[2] = static_cast<BYTE>(c1);
+				out[3] = static_cast<BYTE>(c1 >> 8);
+				int palette[4][3];
+				Unpack565(c0, palette[0]);
+				Unpack565(c1, palette[1]);
+				for (int c = 0; c < 3; ++c)
+				{
+					palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+					palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+				}
+				unsigned int indices = 0;
+				for (unsigned int i = 0; i < 16; ++i)
+				{
+					const BYTE* p = &image.Pixels[((by * 4 + i / 4) * image.Width + bx * 4 + i % 4) * 4];
+					int best = 0, bestError = 0x7fffffff;
+					//Equal endpoints use the three color mode, where index 3 is black
+					for (int e = 0; e < (c0 > c1 ? 4 : 3); ++e)
+					{
+						int error = 0;
+						for (int c = 0; c < 3; ++c)
+							error += (p[c] - palette[e][c]) * (p[c] - palette[e][c]);
+						if (error < bestError)
+						{
+							best = e;
+							bestError = error;
+						}
+					}
+					indices |= best << (2 * i);
+				}
+				for (int i = 0; i < 4; ++i)
+					out[4 + i] = static_cast<BYTE>(indices >> (8 * i));
+			}
+		return data;
+	}
+
+	size_t LevelSize(unsigned int width, unsigned int height, TextureCooker::Format format)
+	{
+		if (format == TextureCooker::FORMAT_RGBA)
+			return static_cast<size_t>(width) * height * 4;
+		return static_cast<size_t>(max(1u, (width + 3) / 4)) * max(1u, (height + 3) / 4) *
+			   (format == TextureCooker::FORMAT_BC1 ? 8 : 16);
+	}
+
+	void CheckLayout(const vector<BYTE>& dds, const TextureCooker::Image& image, TextureCooker::Format format)
+	{
+		if (!Check(dds.size() >= DDS_HEADER_SIZE && memcmp(dds.data(), "DDS ", 4) == 0, "file starts with the header"))
+			return;
+		Check(ReadUInt(&dds[4]) == 124 && ReadUInt(&dds[12]) == image.Height && ReadUInt(&dds[16]) == image.Width,
+			  "header holds the size of the image");
+		unsigned int levels = ReadUInt(&dds[28]);
+		size_t size = DDS_HEADER_SIZE + (format == TextureCooker::FORMAT_BC5 ? DX10_HEADER_SIZE : 0);
+		unsigned int width = image.Width, height = image.Height;
+		for (unsigned int i = 0; i < levels; ++i)
+		{
+			size += LevelSize(width, height, format);
+			width = max(1u, width / 2);
+			height = max(1u, height / 2);
+		}
+		Check(width == 1 && height == 1 && size == dds.size(), "file holds the full mipmap chain");
+	}
+
+	TextureCooker::Image Load(const string& path)
+	{
+		ifstream file(path, ios::binary);
+		if (!file)
+			throw ios_base::failure("Can't open " + path);
+		vector<BYTE> data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+		return ImageDecoder::Decode(data);
+	}
+
+	void CheckGammaCorrectMips()
+	{
+		//Black and white checkerboard averages to half the light, which is 188 in sRGB
+		TextureCooker::Image image;
+		image.Width = image.Height = 16;
+		image.Pixels.resize(16 * 16 * 4);
+		for (unsigned int i = 0; i < 16 * 16; ++i)
+		{
+			BYTE v = (i / 16 + i % 16) % 2 == 0 ? 255 : 0;
+			image.Pixels[4 * i] = image.Pixels[4 * i + 1] = image.Pixels[4 * i + 2] = v;
+			image.Pixels[4 * i + 3] = 255;
+		}
+		vector<TextureCooker::Image> mips = TextureCooker::GenerateMips(image, true, TextureCooker::FILTER_BOX);
+		Check(mips.size() == 5 && mips.back().Width == 1 && mips.back().Height == 1, "chain goes down to 1x1");
+		int v = mips.back().Pixels[0];
+		Check(abs(v - 188) <= 1 && mips.back().Pixels[3] == 255, "sRGB mipmaps keep their brightness");
+		mips = TextureCooker::GenerateMips(image, false, TextureCooker::FILTER_BOX);
+		v = mips.back().Pixels[0];
+		Check(abs(v - 128) <= 1, "linear mipmaps average the values");
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		printf("Usage: %s <resources directory>\n", argv[0]);
+		return 1;
+	}
+	try
+	{
+		CheckGammaCorrectMips();
+		string directory = string(argv[1]) + "/textures/";
+		double pixels = 0.0, encodeTime = 0.0, cookTime = 0.0, gain = 0.0;
+		unsigned int compressed = 0;
+		for (unsigned int t = 0; t < TEXTURES_COUNT; ++t)
+		{
+			TextureCooker::Image image = Load(directory + TEXTURES[t]);
+			TextureCooker::Format format = TextureCooker::ChooseFormat(image);
+			vector<BYTE> dds;
+			double cook = 1e9;
+			for (unsigned int r = 0; r < RUNS; ++r)
+			{
+				Clock::time_point start = Clock::now();
+				dds = TextureCooker::Cook(image, format);
+				cook = min(cook, Milliseconds(start));
+			}
+			CheckLayout(dds, image, format);
+			if (format == TextureCooker::FORMAT_RGBA)
+			{
+				printf("%-17s %4ux%-4u RGBA, sides not divisible by 4\n", TEXTURES[t], image.Width, image.Height);
+				continue;
+			}
+			double encode = 1e9;
+			vector<BYTE> level;
+			for (unsigned int r = 0; r < RUNS; ++r)
+			{
+				Clock::time_point start = Clock::now();
+				level = TextureCooker::Encode(image, format);
+				encode = min(encode, Milliseconds(start));
+			}
+			Check(memcmp(level.data(), &dds[DDS_HEADER_SIZE], level.size()) == 0, "level 0 follows the header");
+			pixels += static_cast<double>(image.Width) * image.Height;
+			encodeTime += encode;
+			cookTime += cook;
+			double psnr = PSNR(image, Decode(level.data(), image.Width, image.Height, format), 0, 2);
+			Check(psnr >= MIN_COLOR_PSNR, "colors keep the PSNR");
+			double alpha = format == TextureCooker::FORMAT_BC3 ?
+				PSNR(image, Decode(level.data(), image.Width, image.Height, format), 3, 3) : 99.0;
+			Check(alpha >= MIN_CHANNEL_PSNR, "alpha keeps the PSNR");
+			double box = PSNR(image, Decode(EncodeBoundingBox(image).data(), image.Width, image.Height,
+											TextureCooker::FORMAT_BC1), 0, 2);
+			Check(psnr >= box - MAX_LOSS_TO_BOUNDING_BOX, "encoder is about as good as bounding box endpoints");
+			gain += psnr - box;
+			++compressed;
+			//Red and green as the two channels of a normal map
+			vector<BYTE> bc5 = TextureCooker::Encode(image, TextureCooker::FORMAT_BC5);
+			double channels = PSNR(image, Decode(bc5.data(), image.Width, image.Height, TextureCooker::FORMAT_BC5),
+								   0, 1);
+			Check(channels >= MIN_CHANNEL_PSNR, "BC5 keeps the PSNR");
+			printf("%-17s %4ux%-4u %s PSNR %.2f dB (bounding box %.2f dB)", TEXTURES[t], image.Width, image.Height,
+				   format == TextureCooker::FORMAT_BC1 ? "BC1" : "BC3", psnr, box);
+			if (format == TextureCooker::FORMAT_BC3)
+				printf(", alpha %.2f dB", alpha);
+			printf(", BC5 %.2f dB, encode %.2f ms, cook %.2f ms\n", channels, encode, cook);
+		}
+		if (Check(compressed > 0, "some textures are block compressed"))
+		{
+			Check(gain > 0.0, "encoder is better than bounding box endpoints on average");
+			printf("%.2f dB over bounding box endpoints on average\n", gain / compressed);
+			printf("Encoding %.1f Mpixel/s, cooking with mipmaps %.1f Mpixel/s\n", pixels / encodeTime / 1000.0,
+				   pixels / cookTime / 1000.0);
+		}
+	}
+	catch (const exception& e)
+	{
+		printf("%s\n", e.what());
+		return 1;
+	}
+	return TestResult();
+}
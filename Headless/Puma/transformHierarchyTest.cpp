@@ -0,0 +1,187 @@
+#include "gk2_transformHierarchy.h"
+#include "gk2_testCheck.h"
+#include "gk2_threadPool.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace gk2;
+
+//Builds two copies of a wide tree of 100k transforms and updates them whole, after changes of a few leaves and of one
+//subtree, one serially and one level by level on a thread pool. Checks the world matrices and the updated nodes
+//against computing every node and against each other, and reports the times of both updates.
+
+namespace
+{
+	//Roots, children of every root and leaves of every child
+	const unsigned int ROOTS = 100;
+	const unsigned int CHILDREN = 10;
+	const unsigned int LEAVES = 99;
+	const unsigned int REPEATS = 20;
+
+	typedef chrono::steady_clock Clock;
+
+	double Milliseconds(Clock::time_point start)
+	{
+		return chrono::duration<double, milli>(Clock::now() - start).count();
+	}
+
+	XMMATRIX RandomLocal(mt19937& random)
+	{
+		uniform_real_distribution<float> angle(-XM_PI, XM_PI), offset(-1.0f, 1.0f);
+		return XMMatrixRotationX(angle(random)) * XMMatrixRotationY(angle(random)) *
+			   XMMatrixTranslation(offset(random), offset(random), offset(random));
+	}
+
+	//World matrices computed node by node, the same multiplications as Update does
+	bool WorldsMatch(const TransformHierarchy& transforms)
+	{
+		unsigned int count = transforms.getNodesCount();
+		AlignedVector<XMMATRIX> world(count);
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			unsigned int parent = transforms.getParent(i);
+			world[i] = parent == TransformHierarchy::NONE ? transforms.getLocal(i) :
+					   XMMatrixMultiply(transforms.getLocal(i), world[parent]);
+			if (memcmp(&world[i], &transforms.getWorld(i), sizeof(XMMATRIX)) != 0)
+				return false;
+		}
+		return true;
+	}
+
+	unsigned int UpdatedCount(const TransformHierarchy& transforms)
+	{
+		unsigned int updated = 0;
+		for (unsigned int i = 0; i < transforms.getNodesCount(); ++i)
+			updated += transforms.WasUpdated(i);
+		return updated;
+	}
+
+	//Same world matrices and the same nodes updated by the last update
+	bool SameUpdate(const TransformHierarchy& a, const TransformHierarchy& b)
+	{
+		if (a.getNodesCount() != b.getNodesCount())
+			return false;
+		for (unsigned int i = 0; i < a.getNodesCount(); ++i)
+			if (a.WasUpdated(i) != b.WasUpdated(i) || memcmp(&a.getWorld(i), &b.getWorld(i), sizeof(XMMATRIX)) != 0)
+				return false;
+		return true;
+	}
+
+	//Serial and parallel update of two copies of the tree, which always get the same local matrices
+	class Pair
+	{
+	public:
+		TransformHierarchy Serial;
+		TransformHierarchy Parallel;
+		double SerialTime;
+		double ParallelTime;
+
+		explicit Pair(ThreadPool& pool) : SerialTime(0.0), ParallelTime(0.0), m_pool(pool) { }
+
+		unsigned int AddNode(unsigned int parent, const XMMATRIX& local)
+		{
+			Parallel.AddNode(parent, local);
+			return Serial.AddNode(parent, local);
+		}
+
+		void setLocal(unsigned int node, const XMMATRIX& local)
+		{
+			Serial.setLocal(node, local);
+			Parallel.setLocal(node, local);
+		}
+
+		void Update()
+		{
+			Clock::time_point start = Clock::now();
+			Serial.Update();
+			SerialTime += Milliseconds(start);
+			start = Clock::now();
+			Parallel.Update(m_pool);
+			ParallelTime += Milliseconds(start);
+			Check(SameUpdate(Serial, Parallel), "parallel update matches the serial one");
+		}
+
+		void Report(const char* name, unsigned int repeats)
+		{
+			printf("  %-34s serial %8.4f ms, parallel %8.4f ms\n", name, SerialTime / repeats, ParallelTime / repeats);
+			SerialTime = ParallelTime = 0.0;
+		}
+
+	private:
+		ThreadPool& m_pool;
+	};
+}
+
+int main()
+{
+	mt19937 random(50);
+	ThreadPool pool;
+	Pair transforms(pool);
+	transforms.Serial.Reserve(ROOTS * (1 + CHILDREN * (1 + LEAVES)));
+	transforms.Parallel.Reserve(ROOTS * (1 + CHILDREN * (1 + LEAVES)));
+	vector<unsigned int> roots, leaves;
+	for (unsigned int r = 0; r < ROOTS; ++r)
+	{
+		roots.push_back(transforms.AddNode(TransformHierarchy::NONE, RandomLocal(random)));
+		for (unsigned int c = 0; c < CHILDREN; ++c)
+		{
+			unsigned int child = transforms.AddNode(roots.back(), RandomLocal(random));
+			for (unsigned int l = 0; l < LEAVES; ++l)
+				leaves.push_back(transforms.AddNode(child, RandomLocal(random)));
+		}
+	}
+	const TransformHierarchy& serial = transforms.Serial;
+	unsigned int count = serial.getNodesCount();
+	printf("%u nodes, %u levels, %u threads in the pool\n", count, serial.getDepth(count - 1) + 1,
+		   pool.getThreadsCount());
+
+	transforms.Update();
+	Check(WorldsMatch(serial) && UpdatedCount(serial) == count, "first update computes every node");
+	transforms.Report("first update", 1);
+
+	//Every local matrix set again
+	for (unsigned int i = 0; i < REPEATS; ++i)
+	{
+		for (unsigned int n = 0; n < count; ++n)
+			transforms.setLocal(n, serial.getLocal(n));
+		transforms.Update();
+	}
+	Check(UpdatedCount(serial) == count, "setting every node updates every node");
+	transforms.Report("every node set", REPEATS);
+
+	for (unsigned int i = 0; i < REPEATS; ++i)
+		transforms.Update();
+	Check(UpdatedCount(serial) == 0, "clean tree updates nothing");
+	transforms.Report("nothing set", REPEATS);
+
+	//One leaf in a hundred moves
+	unsigned int moved = 0;
+	for (unsigned int i = 0; i < REPEATS; ++i)
+	{
+		moved = 0;
+		for (unsigned int l = i % 100; l < leaves.size(); l += 100, ++moved)
+			transforms.setLocal(leaves[l], RandomLocal(random));
+		transforms.Update();
+	}
+	Check(WorldsMatch(serial) && UpdatedCount(serial) == moved, "only the moved leaves are updated");
+	char name[64];
+	sprintf(name, "%u leaves set", moved);
+	transforms.Report(name, REPEATS);
+
+	//Root in the middle of the tree moves with its subtree
+	unsigned int root = roots[ROOTS / 2];
+	for (unsigned int i = 0; i < REPEATS; ++i)
+	{
+		transforms.setLocal(root, RandomLocal(random));
+		transforms.Update();
+	}
+	Check(WorldsMatch(serial) && UpdatedCount(serial) == 1 + CHILDREN * (1 + LEAVES), "moved root updates its subtree");
+	sprintf(name, "root with %u descendants set", CHILDREN * (1 + LEAVES));
+	transforms.Report(name, REPEATS);
+
+	return TestResult();
+}
@@ -0,0 +1,116 @@
+#include "gk2_frustum.h"
+#include "gk2_testCheck.h"
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace gk2;
+
+//Tests boxes and spheres lying inside, outside and across the planes of a camera's frustum four at a time and checks
+//every bit of the visibility masks and the visible counts against the tests of single volumes. Counts which aren't
+//multiples of four check that the lanes repeating the first volume of the last batch leave no bits set.
+
+namespace
+{
+	const unsigned int RANDOM_VOLUMES = 10001;
+
+	//Camera at the origin looking along z with a 90 degree field of view, so the side planes are x = +-z and y = +-z
+	XMMATRIX ViewProj()
+	{
+		XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 1.0f, 1.0f),
+										 XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		return view * XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, 0.5f, 10.0f);
+	}
+
+	//Bits which don't match the single volume tests, bits past count and the visible count
+	template<typename Volume>
+	bool MatchesSingleTests(const Frustum& frustum, const vector<Volume>& volumes, unsigned int count)
+	{
+		vector<unsigned int> visibility;
+		unsigned int visible = frustum.Test(volumes.data(), count, visibility);
+		unsigned int expected = 0, wrong = 0;
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			bool intersects = frustum.Intersects(volumes[i]);
+			expected += intersects ? 1 : 0;
+			wrong += Frustum::IsVisible(visibility, i) != intersects ? 1 : 0;
+		}
+		for (unsigned int i = count; i < 32 * visibility.size(); ++i)
+			wrong += Frustum::IsVisible(visibility, i) ? 1 : 0;
+		return visibility.size() == (count + 31) / 32 && wrong == 0 && visible == expected;
+	}
+
+	void TestKnownBoxes(const Frustum& frustum)
+	{
+		vector<BoundingBox> boxes;
+		boxes.push_back(BoundingBox(XMFLOAT3(0.0f, 0.0f, 5.0f), XMFLOAT3(0.5f, 0.5f, 0.5f)));
+		boxes.push_back(BoundingBox(XMFLOAT3(0.0f, 0.0f, -5.0f), XMFLOAT3(0.5f, 0.5f, 0.5f)));
+		boxes.push_back(BoundingBox(XMFLOAT3(1.0f, 1.0f, 4.0f), XMFLOAT3(0.3f, 0.3f, 0.3f)));
+		boxes.push_back(BoundingBox(XMFLOAT3(-5.0f, 0.0f, 5.0f), XMFLOAT3(0.5f, 0.5f, 0.5f)));
+		boxes.push_back(BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.5f), XMFLOAT3(0.2f, 0.2f, 0.2f)));
+		boxes.push_back(BoundingBox(XMFLOAT3(-8.0f, 0.0f, 5.0f), XMFLOAT3(0.5f, 0.5f, 0.5f)));
+		boxes.push_back(BoundingBox(XMFLOAT3(0.0f, 0.0f, 10.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)));
+		boxes.push_back(BoundingBox(XMFLOAT3(0.0f, 0.0f, 20.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)));
+		boxes.push_back(BoundingBox(XMFLOAT3(0.0f, 9.0f, 5.0f), XMFLOAT3(0.5f, 0.5f, 0.5f)));
+		const Frustum::Containment CONTAINMENT[] = { Frustum::INSIDE, Frustum::OUTSIDE, Frustum::INSIDE,
+													 Frustum::INTERSECTS, Frustum::INTERSECTS, Frustum::OUTSIDE,
+													 Frustum::INTERSECTS, Frustum::OUTSIDE, Frustum::OUTSIDE };
+		const unsigned int VISIBLE = 1 | 4 | 8 | 16 | 64;
+
+		unsigned int wrong = 0;
+		for (unsigned int i = 0; i < boxes.size(); ++i)
+			wrong += frustum.Classify(boxes[i]) != CONTAINMENT[i] ? 1 : 0;
+		Check(wrong == 0, "boxes inside, outside and across the planes are classified");
+		vector<unsigned int> visibility;
+		unsigned int visible = frustum.Test(boxes.data(), boxes.size(), visibility);
+		//Last batch holds a single box which is outside
+		Check(visibility.size() == 1 && visibility[0] == VISIBLE && visible == 5,
+			  "boxes inside and across the planes are visible");
+		//Lanes of the last batch repeat its first box, which is visible, and mustn't set the bit past the count
+		visible = frustum.Test(boxes.data(), 7, visibility);
+		Check(visibility[0] == VISIBLE && visible == 5, "last batch of three boxes");
+		visible = frustum.Test(boxes.data(), 0, visibility);
+		Check(visibility.empty() && visible == 0, "no boxes");
+	}
+
+	void TestRandomVolumes(const Frustum& frustum)
+	{
+		mt19937 random(26);
+		uniform_real_distribution<float> position(-12.0f, 12.0f), size(0.0f, 2.0f);
+		vector<BoundingBox> boxes;
+		vector<BoundingSphere> spheres;
+		for (unsigned int i = 0; i < RANDOM_VOLUMES; ++i)
+		{
+			XMFLOAT3 center(position(random), position(random), position(random));
+			boxes.push_back(BoundingBox(center, XMFLOAT3(size(random), size(random), size(random))));
+			spheres.push_back(BoundingSphere(center, size(random)));
+		}
+		unsigned int wrongBoxes = 0, wrongSpheres = 0;
+		for (unsigned int count = 1; count <= 70; ++count)
+		{
+			wrongBoxes += MatchesSingleTests(frustum, boxes, count) ? 0 : 1;
+			wrongSpheres += MatchesSingleTests(frustum, spheres, count) ? 0 : 1;
+		}
+		Check(wrongBoxes == 0, "masks of up to 70 random boxes match the single box tests");
+		Check(wrongSpheres == 0, "masks of up to 70 random spheres match the single sphere tests");
+		Check(MatchesSingleTests(frustum, boxes, RANDOM_VOLUMES), "mask of all random boxes matches");
+		Check(MatchesSingleTests(frustum, spheres, RANDOM_VOLUMES), "mask of all random spheres matches");
+
+		vector<unsigned int> visibility;
+		unsigned int visible = frustum.Test(boxes.data(), RANDOM_VOLUMES, visibility);
+		unsigned int straddling = 0;
+		for (unsigned int i = 0; i < RANDOM_VOLUMES; ++i)
+			straddling += frustum.Classify(boxes[i]) == Frustum::INTERSECTS ? 1 : 0;
+		Check(straddling > 0 && visible > straddling, "random boxes lie inside and across the planes");
+		printf("Random boxes: %u of %u visible, %u across the planes\n", visible, RANDOM_VOLUMES, straddling);
+	}
+}
+
+int main()
+{
+	Frustum frustum(ViewProj());
+	TestKnownBoxes(frustum);
+	TestRandomVolumes(frustum);
+	return TestResult();
+}
@@ -0,0 +1,274 @@
+#include "gk2_probeScheduler.h"
+#include "gk2_testCheck.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace gk2;
+
+//Replays the transforms of the lamp swinging over the environment map of RoomAdvanced and of the particles rising
+//next to it through ProbeScheduler. Checks that every face which sees an object before or after it moves is
+//refreshed within the frames the budget allows, that the other faces are left alone and that clean faces and faces
+//seeing animated objects are refreshed at their intervals. Faces seeing a box are found by testing points spread
+//over the box against the frustum of every face.
+
+namespace
+{
+	const unsigned int FACES = ProbeScheduler::FACES_COUNT;
+	const unsigned int ALL_FACES = (1u << FACES) - 1;
+	//Probe of the environment map, same as in Room
+	const XMFLOAT3 PROBE(-1.3f, -0.74f, -0.6f);
+	const float FAR_PLANE = 8.0f;
+	const float DT = 1.0f / 60.0f;
+	//Lamp swings and turns around in 20 seconds
+	const unsigned int FRAMES = 1200;
+	//Points along every edge of a box tested against the faces
+	const unsigned int SAMPLES = 9;
+	const unsigned int RANDOM_BOXES = 20000;
+
+	//Lamp's shade hanging below the origin of its mesh
+	const BoundingBox LAMP(XMFLOAT3(0.0f, -0.15f, 0.0f), XMFLOAT3(0.35f, 0.2f, 0.35f));
+	//Shelf, chair and monitor which don't move
+	const BoundingBox STATIC_OBJECTS[] = {
+		BoundingBox(XMFLOAT3(-1.6f, -0.6f, -1.2f), XMFLOAT3(0.3f, 0.4f, 0.5f)),
+		BoundingBox(XMFLOAT3(-0.1f, -0.8f, -1.3f), XMFLOAT3(0.3f, 0.3f, 0.3f)),
+		BoundingBox(XMFLOAT3(0.5f, -0.5f, 0.5f), XMFLOAT3(0.3f, 0.2f, 0.1f)) };
+
+	//Same transform as Room::UpdateLamp
+	BoundingBox LampBox(float time)
+	{
+		float swing = 0.3f * XMScalarSin(XM_2PI * time / 8);
+		float rot = XM_2PI * time / 20;
+		XMMATRIX lamp = XMMatrixTranslation(0.0f, -0.4f, 0.0f) * XMMatrixRotationX(swing) * XMMatrixRotationY(rot) *
+						XMMatrixTranslation(0.0f, 2.0f, 0.0f);
+		return LAMP.Transform(lamp);
+	}
+
+	//Particles rise above the emitter and their cloud grows and shrinks
+	BoundingBox ParticlesBox(float time)
+	{
+		float size = 0.1f + 0.05f * XMScalarSin(XM_2PI * time);
+		return BoundingBox(XMFLOAT3(-1.3f, -0.4f, -0.14f), XMFLOAT3(size, 0.2f + size, size));
+	}
+
+	//Faces whose frustum holds one of the points spread over the box
+	unsigned int SeenBy(const BoundingBox& box)
+	{
+		unsigned int mask = 0;
+		for (unsigned int i = 0; i < SAMPLES * SAMPLES * SAMPLES && mask != ALL_FACES; ++i)
+		{
+			float t[3] = { static_cast<float>(i % SAMPLES), static_cast<float>(i / SAMPLES % SAMPLES),
+						   static_cast<float>(i / SAMPLES / SAMPLES) };
+			float p[3] = { box.Center.x - PROBE.x + box.Extents.x * (2.0f * t[0] / (SAMPLES - 1) - 1.0f),
+						   box.Center.y - PROBE.y + box.Extents.y * (2.0f * t[1] / (SAMPLES - 1) - 1.0f),
+						   box.Center.z - PROBE.z + box.Extents.z * (2.0f * t[2] / (SAMPLES - 1) - 1.0f) };
+			for (unsigned int f = 0; f < FACES; ++f)
+			{
+				unsigned int a = f / 2;
+				float depth = f % 2 ? -p[a] : p[a];
+				if (depth >= 0.0f && depth <= FAR_PLANE && fabs(p[(a + 1) % 3]) <= depth &&
+					fabs(p[(a + 2) % 3]) <= depth)
+					mask |= 1u << f;
+			}
+		}
+		return mask;
+	}
+
+	unsigned int DirtyMask(const ProbeScheduler& scheduler)
+	{
+		unsigned int mask = 0;
+		for (unsigned int f = 0; f < FACES; ++f)
+			if (scheduler.isDirty(f))
+				mask |= 1u << f;
+		return mask;
+	}
+
+	unsigned int Mask(const vector<unsigned int>& faces)
+	{
+		unsigned int mask = 0;
+		for (size_t i = 0; i < faces.size(); ++i)
+			mask |= 1u << faces[i];
+		return mask;
+	}
+
+	unsigned int Count(unsigned int mask)
+	{
+		unsigned int count = 0;
+		for (; mask; mask &= mask - 1)
+			++count;
+		return count;
+	}
+
+	//The test of the scheduler may see more faces than the points, never fewer
+	void CheckFacesMask()
+	{
+		mt19937 random(41);
+		uniform_real_distribution<float> position(-6.0f, 6.0f), size(0.01f, 1.5f);
+		unsigned int missed = 0, seen = 0, extra = 0;
+		for (unsigned int i = 0; i < RANDOM_BOXES; ++i)
+		{
+			XMFLOAT3 center(PROBE.x + position(random), PROBE.y + position(random), PROBE.z + position(random));
+			BoundingBox box(center, XMFLOAT3(size(random), size(random), size(random)));
+			unsigned int points = SeenBy(box);
+			unsigned int mask = ProbeScheduler::FacesMask(PROBE, FAR_PLANE, box);
+			missed += Count(points & ~mask);
+			seen += Count(points);
+			extra += Count(mask & ~points);
+		}
+		printf("Random boxes: %u faces see them, %u more are marked by the scheduler, %u missed\n", seen, extra,
+			   missed);
+		Check(missed == 0, "faces seeing a box are marked");
+		Check(extra < seen / 4, "few faces not seeing a box are marked");
+	}
+
+	struct Replay
+	{
+		unsigned int Refreshed;
+		unsigned int Needed;
+		//Frames a face waited after it got dirty
+		unsigned int MaxWait;
+		//Frames since a face was refreshed
+		unsigned int MaxAge;
+		bool Missed;
+		bool Unneeded;
+	};
+
+	//Replays the lamp, and the particles if asked to. Without the stale and the animated interval, refreshes of
+	//faces which nothing moved in are unneeded.
+	Replay ReplayRoom(const ProbeScheduler::Settings& settings, bool particles)
+	{
+		ProbeScheduler scheduler(PROBE, FAR_PLANE, settings);
+		for (unsigned int i = 0; i < sizeof(STATIC_OBJECTS) / sizeof(STATIC_OBJECTS[0]); ++i)
+			scheduler.AddObject(STATIC_OBJECTS[i]);
+		BoundingBox lamp = LampBox(0.0f);
+		unsigned int lampObject = scheduler.AddObject(lamp);
+		BoundingBox cloud = ParticlesBox(0.0f);
+		unsigned int particlesObject = particles ? scheduler.AddObject(cloud, true) : 0;
+		Check(scheduler.Schedule().size() == FACES, "first frame renders every face");
+
+		Replay r = { };
+		bool exact = settings.StaleInterval == 0 && settings.AnimatedInterval == 0;
+		unsigned int waiting[FACES] = { };
+		//Faces which have to be refreshed, and the faces the scheduler's test marks for the same moves
+		unsigned int pending = 0, marked = 0;
+		for (unsigned int frame = 1; frame <= FRAMES; ++frame)
+		{
+			float time = frame * DT;
+			BoundingBox next = LampBox(time);
+			unsigned int needed = SeenBy(lamp) | SeenBy(next);
+			marked |= ProbeScheduler::FacesMask(PROBE, FAR_PLANE, lamp) |
+					  ProbeScheduler::FacesMask(PROBE, FAR_PLANE, next);
+			scheduler.UpdateObject(lampObject, next);
+			lamp = next;
+			if (particles)
+			{
+				next = ParticlesBox(time);
+				//Faces which start or stop seeing the animated particles change at once
+				needed |= SeenBy(cloud) ^ SeenBy(next);
+				marked |= ProbeScheduler::FacesMask(PROBE, FAR_PLANE, cloud) ^
+						  ProbeScheduler::FacesMask(PROBE, FAR_PLANE, next);
+				scheduler.UpdateObject(particlesObject, next);
+				cloud = next;
+			}
+			r.Missed = r.Missed || (needed & ~DirtyMask(scheduler)) != 0;
+			r.Needed += Count(needed);
+			pending |= needed;
+			unsigned int scheduled = Mask(scheduler.Schedule());
+			r.Refreshed += Count(scheduled);
+			r.Unneeded = r.Unneeded || (exact && (scheduled & ~(pending | marked)) != 0);
+			for (unsigned int f = 0; f < FACES; ++f)
+			{
+				if (scheduled & (1u << f))
+					waiting[f] = 0;
+				else if (pending & (1u << f))
+					r.MaxWait = max(r.MaxWait, ++waiting[f]);
+				r.MaxAge = max(r.MaxAge, scheduler.getAge(f));
+			}
+			pending &= ~scheduled;
+			marked &= ~scheduled;
+		}
+		Check(scheduler.getTotalStatistics().Refreshed == r.Refreshed + FACES, "statistics count every refresh");
+		return r;
+	}
+
+	void CheckReplays()
+	{
+		//Only the dirty faces, three a frame
+		ProbeScheduler::Settings changes = { 3, 0, 0 };
+		Replay r = ReplayRoom(changes, false);
+		printf("Lamp, budget 3: %u faces refreshed in %u frames (%u without the scheduler), %u needed, waited up to "
+			   "%u frames\n", r.Refreshed, FRAMES, FRAMES * FACES, r.Needed, r.MaxWait);
+		Check(!r.Missed, "faces seeing the lamp move get dirty");
+		Check(!r.Unneeded, "faces nothing moved in aren't refreshed");
+		Check(r.MaxWait <= (FACES - 1) / changes.FaceBudget, "dirty faces wait no longer than the budget makes them");
+		Check(r.Refreshed < FRAMES * FACES / 2, "most faces aren't refreshed");
+
+		//One face a frame, the dirty ones wait their turn
+		ProbeScheduler::Settings single = { 1, 0, 0 };
+		r = ReplayRoom(single, false);
+		printf("Lamp, budget 1: %u faces refreshed, waited up to %u frames\n", r.Refreshed, r.MaxWait);
+		Check(!r.Missed && r.MaxWait <= FACES - 1, "faces are refreshed in turn");
+
+		//Settings of Room
+		ProbeScheduler::Settings room = { 3, 10, 6 };
+		r = ReplayRoom(room, true);
+		printf("Lamp and particles, budget 3, stale 10, animated 6: %u faces refreshed, waited up to %u frames, "
+			   "oldest %u frames\n", r.Refreshed, r.MaxWait, r.MaxAge);
+		Check(!r.Missed, "faces seeing the lamp or the particles reach get dirty");
+		Check(r.MaxWait <= (FACES - 1) / room.FaceBudget + room.AnimatedInterval, "faces wait for the intervals");
+		Check(r.MaxAge <= FACES * room.StaleInterval, "every face is refreshed in the stale interval");
+	}
+
+	//Scheduler of a single box in front of the +Z face, after the first frame
+	void CheckChanges()
+	{
+		ProbeScheduler::Settings settings = { 6, 0, 0 };
+		ProbeScheduler scheduler(PROBE, FAR_PLANE, settings);
+		BoundingBox box(XMFLOAT3(PROBE.x, PROBE.y, PROBE.z + 3.0f), XMFLOAT3(0.2f, 0.2f, 0.2f));
+		unsigned int object = scheduler.AddObject(box);
+		BoundingBox cloud(XMFLOAT3(PROBE.x + 3.0f, PROBE.y, PROBE.z), XMFLOAT3(0.2f, 0.2f, 0.2f));
+		unsigned int animated = scheduler.AddObject(cloud, true);
+		scheduler.Schedule();
+		const unsigned int PLUS_X = 1u << 0, MINUS_X = 1u << 1, PLUS_Z = 1u << 4, MINUS_Z = 1u << 5;
+
+		scheduler.UpdateObject(object, box);
+		Check(Mask(scheduler.Schedule()) == 0, "objects which stay in place leave the faces clean");
+		BoundingBox moved(XMFLOAT3(PROBE.x, PROBE.y, PROBE.z - 3.0f), box.Extents);
+		scheduler.UpdateObject(object, moved);
+		Check(DirtyMask(scheduler) == (PLUS_Z | MINUS_Z), "faces the object leaves and enters get dirty");
+		Check(Mask(scheduler.Schedule()) == (PLUS_Z | MINUS_Z) && DirtyMask(scheduler) == 0,
+			  "dirty faces are refreshed and clean afterwards");
+		scheduler.TouchObject(object);
+		Check(Mask(scheduler.Schedule()) == MINUS_Z, "touched object's faces are refreshed");
+
+		cloud.Extents = XMFLOAT3(0.4f, 0.3f, 0.4f);
+		scheduler.UpdateObject(animated, cloud);
+		Check(Mask(scheduler.Schedule()) == 0, "animated object changing on its faces leaves them clean");
+		cloud.Center.x = PROBE.x - 3.0f;
+		scheduler.UpdateObject(animated, cloud);
+		Check(Mask(scheduler.Schedule()) == (PLUS_X | MINUS_X), "animated object moving to another face");
+
+		scheduler.Invalidate();
+		Check(Mask(scheduler.Schedule()) == ALL_FACES, "invalidated faces are refreshed");
+		Check(scheduler.getLastFrameStatistics().Refreshed == FACES && scheduler.getLastFrameStatistics().Deferred == 0,
+			  "last frame statistics");
+
+		ProbeScheduler::Settings small = { 2, 0, 0 };
+		ProbeScheduler limited(PROBE, FAR_PLANE, small);
+		limited.Schedule();
+		limited.Invalidate();
+		Check(limited.Schedule().size() == 2 && limited.getLastFrameStatistics().Deferred == FACES - 2,
+			  "faces over the budget are deferred");
+	}
+}
+
+int main()
+{
+	CheckFacesMask();
+	CheckChanges();
+	CheckReplays();
+	return TestResult();
+}
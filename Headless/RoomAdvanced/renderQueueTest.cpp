@@ -0,0 +1,197 @@
+#include "gk2_renderKey.h"
+#include "gk2_testCheck.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace gk2;
+
+//Checks the fields of keys at the ends of the depth range, then sorts random draws of growing queues by their render
+//keys with the radix sort of RenderQueue, std::sort and std::stable_sort, checks the order of the draws and reports
+//the times and the material changes left.
+
+namespace
+{
+	const unsigned int QUEUE_SIZES[] = { 100, 1000, 10000, 100000 };
+	//Every size sorts this many draws in total
+	const unsigned int DRAWS_SORTED = 2000000;
+	const unsigned int PASSES = 2;
+	const unsigned int EFFECTS = 12;
+	const unsigned int TEXTURES = 24;
+	const float TRANSPARENT_SHARE = 0.15f;
+
+	typedef chrono::steady_clock Clock;
+
+	double Milliseconds(Clock::time_point start)
+	{
+		return chrono::duration<double, milli>(Clock::now() - start).count();
+	}
+
+	struct Draw
+	{
+		unsigned int Pass;
+		RenderKey::Layer Layer;
+		unsigned int Effect;
+		unsigned int Texture;
+		float Depth;
+	};
+
+	bool KeyLess(const RenderKey::Item& a, const RenderKey::Item& b)
+	{
+		return a.Key < b.Key;
+	}
+
+	//Draws in the order of the queue: passes and layers one after another, opaque draws grouped by effect and
+	//texture front to back, transparent ones back to front
+	bool InOrder(const Draw& a, const Draw& b)
+	{
+		//Depths closer than a step of the key are equal
+		const float step = 1.0f / (1 << RenderKey::DEPTH_BITS);
+		if (a.Pass != b.Pass || a.Layer != b.Layer)
+			return a.Pass < b.Pass || (a.Pass == b.Pass && a.Layer < b.Layer);
+		if (a.Layer == RenderKey::LAYER_TRANSPARENT)
+			return a.Depth >= b.Depth - step;
+		if (a.Effect != b.Effect || a.Texture != b.Texture)
+			return a.Effect < b.Effect || (a.Effect == b.Effect && a.Texture < b.Texture);
+		return a.Depth <= b.Depth + step;
+	}
+
+	//Effect or texture bound again between two consecutive draws
+	unsigned int MaterialChanges(const vector<Draw>& draws, const vector<RenderKey::Item>& items)
+	{
+		unsigned int changes = 0;
+		for (size_t i = 1; i < items.size(); ++i)
+		{
+			const Draw& a = draws[items[i - 1].Index];
+			const Draw& b = draws[items[i].Index];
+			changes += a.Effect != b.Effect || a.Texture != b.Texture;
+		}
+		return changes;
+	}
+
+	//Fields of a key, the depth of transparent keys is turned back
+	struct Fields
+	{
+		unsigned int Pass;
+		RenderKey::Layer Layer;
+		unsigned int Effect;
+		unsigned int Texture;
+		unsigned long long Depth;
+	};
+
+	Fields Split(unsigned long long key)
+	{
+		const unsigned long long depthMask = (1ULL << RenderKey::DEPTH_BITS) - 1;
+		unsigned int shift = 64 - RenderKey::PASS_BITS;
+		Fields f;
+		f.Pass = static_cast<unsigned int>(key >> shift);
+		f.Layer = RenderKey::GetLayer(key);
+		--shift;
+		if (f.Layer == RenderKey::LAYER_OPAQUE)
+		{
+			f.Effect = (key >> (shift -= RenderKey::EFFECT_BITS)) & ((1U << RenderKey::EFFECT_BITS) - 1);
+			f.Texture = (key >> (shift -= RenderKey::TEXTURE_BITS)) & ((1U << RenderKey::TEXTURE_BITS) - 1);
+			f.Depth = (key >> (shift -= RenderKey::DEPTH_BITS)) & depthMask;
+		}
+		else
+		{
+			f.Depth = depthMask - ((key >> (shift -= RenderKey::DEPTH_BITS)) & depthMask);
+			f.Effect = (key >> (shift -= RenderKey::EFFECT_BITS)) & ((1U << RenderKey::EFFECT_BITS) - 1);
+			f.Texture = (key >> (shift -= RenderKey::TEXTURE_BITS)) & ((1U << RenderKey::TEXTURE_BITS) - 1);
+		}
+		//Bits below the fields stay clear
+		if (key & ((1ULL << shift) - 1))
+			f.Pass = ~0U;
+		return f;
+	}
+
+	//Depths at and past the ends of the range keep the other fields of the key intact
+	void CheckDepthRange()
+	{
+		const unsigned long long depthMask = (1ULL << RenderKey::DEPTH_BITS) - 1;
+		const float depths[] = { -0.5f, 0.0f, 0.5f, 1.0f, 1.5f };
+		const unsigned long long expected[] = { 0, 0, (depthMask + 1) / 2, depthMask, depthMask };
+		const RenderKey::Layer layers[] = { RenderKey::LAYER_OPAQUE, RenderKey::LAYER_TRANSPARENT };
+		for (unsigned int l = 0; l < 2; ++l)
+			for (unsigned int i = 0; i < sizeof(depths) / sizeof(depths[0]); ++i)
+			{
+				Fields f = Split(RenderKey::Make(1, layers[l], 3, 4, depths[i]));
+				if (!Check(f.Pass == 1 && f.Layer == layers[l] && f.Effect == 3 && f.Texture == 4 &&
+						   f.Depth == expected[i], "depth stays in its bits"))
+					printf("  layer %u, depth %g: pass %u, layer %u, effect %u, texture %u, depth %llu\n", l,
+						   depths[i], f.Pass, f.Layer, f.Effect, f.Texture, f.Depth);
+			}
+		//Ends of the range still sort around the other keys of their pass and layer
+		const RenderKey::Layer opaque = RenderKey::LAYER_OPAQUE, transparent = RenderKey::LAYER_TRANSPARENT;
+		Check(RenderKey::Make(1, opaque, 3, 4, 1.0f) < RenderKey::Make(1, opaque, 3, 5, 0.0f),
+			  "farthest opaque draw comes before the next texture");
+		Check(RenderKey::Make(1, transparent, 255, 255, 1.0f) > RenderKey::Make(1, opaque, 255, 255, 1.0f),
+			  "farthest transparent draw follows the opaque ones");
+		Check(RenderKey::Make(1, transparent, 0, 0, 0.0f) < RenderKey::Make(2, opaque, 0, 0, 0.0f),
+			  "nearest transparent draw precedes the next pass");
+	}
+
+	void Benchmark(unsigned int count, mt19937& random)
+	{
+		uniform_int_distribution<unsigned int> pass(0, PASSES - 1), effect(0, EFFECTS - 1), texture(0, TEXTURES - 1);
+		uniform_real_distribution<float> unit(0.0f, 1.0f);
+		vector<Draw> draws(count);
+		vector<RenderKey::Item> added(count);
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			Draw& d = draws[i];
+			d.Pass = pass(random);
+			d.Layer = unit(random) < TRANSPARENT_SHARE ? RenderKey::LAYER_TRANSPARENT : RenderKey::LAYER_OPAQUE;
+			d.Effect = effect(random);
+			d.Texture = texture(random);
+			d.Depth = unit(random);
+			added[i].Key = RenderKey::Make(d.Pass, d.Layer, d.Effect, d.Texture, d.Depth);
+			added[i].Index = i;
+		}
+
+		//Queue keeps its buffers between frames, only the copy of the added draws is outside the timings
+		unsigned int repeats = max(1u, DRAWS_SORTED / count);
+		vector<RenderKey::Item> radix, buffer, quick, stable;
+		double radixTime = 0.0, quickTime = 0.0, stableTime = 0.0;
+		for (unsigned int r = 0; r < repeats; ++r)
+		{
+			radix = added;
+			Clock::time_point start = Clock::now();
+			RenderKey::Sort(radix, buffer);
+			radixTime += Milliseconds(start);
+			quick = added;
+			start = Clock::now();
+			sort(quick.begin(), quick.end(), KeyLess);
+			quickTime += Milliseconds(start);
+			stable = added;
+			start = Clock::now();
+			stable_sort(stable.begin(), stable.end(), KeyLess);
+			stableTime += Milliseconds(start);
+		}
+
+		bool same = true;
+		for (unsigned int i = 0; i < count && same; ++i)
+			same = radix[i].Key == stable[i].Key && radix[i].Index == stable[i].Index;
+		Check(same, "radix sort gives the order of std::stable_sort");
+		bool ordered = true;
+		for (unsigned int i = 1; i < count && ordered; ++i)
+			ordered = InOrder(draws[radix[i - 1].Index], draws[radix[i].Index]);
+		Check(ordered, "draws are grouped by material and sorted by depth");
+
+		printf("%6u draws: radix %.3f ms, std::sort %.3f ms, std::stable_sort %.3f ms, %u material changes "
+			   "(%u unsorted)\n", count, radixTime / repeats, quickTime / repeats, stableTime / repeats,
+			   MaterialChanges(draws, radix), MaterialChanges(draws, added));
+	}
+}
+
+int main()
+{
+	CheckDepthRange();
+	mt19937 random(37);
+	for (unsigned int i = 0; i < sizeof(QUEUE_SIZES) / sizeof(QUEUE_SIZES[0]); ++i)
+		Benchmark(QUEUE_SIZES[i], random);
+	return TestResult();
+}
@@ -0,0 +1,172 @@
+#include "gk2_sceneBVH.h"
+#include "gk2_testCheck.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace gk2;
+
+//Builds, refits and queries the scene BVH over random boxes of growing scenes, checks the queries against testing
+//every box and reports the times of both.
+
+namespace
+{
+	const unsigned int SCENE_SIZES[] = { 1000, 10000, 100000 };
+	//Boxes per unit of volume stays the same, so the frustum sees a similar part of every scene
+	const float DENSITY = 0.5f;
+	const unsigned int VIEWS = 32;
+	const unsigned int RAYS = 1000;
+
+	typedef chrono::steady_clock Clock;
+
+	double Milliseconds(Clock::time_point start)
+	{
+		return chrono::duration<double, milli>(Clock::now() - start).count();
+	}
+
+	struct Scene
+	{
+		float Side;
+		vector<BoundingBox> Boxes;
+	};
+
+	Scene RandomScene(unsigned int count, mt19937& random)
+	{
+		Scene scene;
+		scene.Side = powf(count / DENSITY, 1.0f / 3.0f);
+		uniform_real_distribution<float> position(-scene.Side / 2, scene.Side / 2);
+		uniform_real_distribution<float> extent(0.05f, 0.5f);
+		scene.Boxes.resize(count);
+		for (unsigned int i = 0; i < count; ++i)
+			scene.Boxes[i] = BoundingBox(XMFLOAT3(position(random), position(random), position(random)),
+										 XMFLOAT3(extent(random), extent(random), extent(random)));
+		return scene;
+	}
+
+	//Camera in the middle of the scene looking around the vertical axis
+	Frustum View(const Scene& scene, unsigned int i)
+	{
+		float a = i * XM_2PI / VIEWS;
+		XMVECTOR eye = XMVectorZero();
+		XMVECTOR at = XMVectorSet(cosf(a), 0.3f * sinf(3 * a), sinf(a), 1.0f);
+		XMMATRIX proj = XMMatrixPerspectiveFovLH(XM_PIDIV4, 1.0f, 0.01f, scene.Side / 2);
+		return Frustum(XMMatrixLookAtLH(eye, at, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)) * proj);
+	}
+
+	bool RayBox(const BoundingBox& box, const XMFLOAT3& origin, const XMFLOAT3& direction, float& distance)
+	{
+		const float* c = &box.Center.x;
+		const float* e = &box.Extents.x;
+		const float* o = &origin.x;
+		const float* d = &direction.x;
+		float tMin = 0.0f, tMax = FLT_MAX;
+		for (int i = 0; i < 3; ++i)
+		{
+			float inv = 1.0f / d[i];
+			float t0 = (c[i] - e[i] - o[i]) * inv;
+			float t1 = (c[i] + e[i] - o[i]) * inv;
+			tMin = max(tMin, min(t0, t1));
+			tMax = min(tMax, max(t0, t1));
+		}
+		distance = tMin;
+		return tMin <= tMax;
+	}
+
+	void Benchmark(unsigned int count, mt19937& random)
+	{
+		Scene scene = RandomScene(count, random);
+		SceneBVH bvh;
+		Clock::time_point start = Clock::now();
+		bvh.Build(scene.Boxes.data(), count);
+		double build = Milliseconds(start);
+		Check(bvh.getInstanceCount() == count, "every instance is in the tree");
+
+		//Every box moves a little, then one in a hundred moves again and only those are refitted
+		normal_distribution<float> offset(0.0f, 0.05f);
+		for (auto it = scene.Boxes.begin(); it != scene.Boxes.end(); ++it)
+		{
+			it->Center.x += offset(random);
+			it->Center.y += offset(random);
+			it->Center.z += offset(random);
+		}
+		start = Clock::now();
+		bvh.Refit(scene.Boxes.data());
+		double refitAll = Milliseconds(start);
+		vector<unsigned int> moved;
+		for (unsigned int i = 0; i < count; i += 100)
+		{
+			scene.Boxes[i].Center.y += offset(random);
+			moved.push_back(i);
+		}
+		start = Clock::now();
+		bvh.Refit(moved.data(), static_cast<unsigned int>(moved.size()), scene.Boxes.data());
+		double refitSome = Milliseconds(start);
+
+		//The tree accepts whole leaves, so it may report a few more boxes but never misses one
+		vector<unsigned int> treeVisibility, allVisibility;
+		double treeQuery = 0.0, allQuery = 0.0;
+		unsigned int treeVisible = 0, allVisible = 0;
+		for (unsigned int v = 0; v < VIEWS; ++v)
+		{
+			Frustum frustum = View(scene, v);
+			start = Clock::now();
+			treeVisible += bvh.QueryFrustum(frustum, treeVisibility);
+			treeQuery += Milliseconds(start);
+			start = Clock::now();
+			allVisible += frustum.Test(scene.Boxes.data(), count, allVisibility);
+			allQuery += Milliseconds(start);
+			bool missed = false;
+			for (unsigned int i = 0; i < count && !missed; ++i)
+				missed = Frustum::IsVisible(allVisibility, i) && !Frustum::IsVisible(treeVisibility, i);
+			Check(!missed, "frustum query finds every visible box");
+		}
+
+		uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		double treePick = 0.0, allPick = 0.0;
+		unsigned int hits = 0;
+		for (unsigned int r = 0; r < RAYS; ++r)
+		{
+			XMFLOAT3 origin(unit(random) * scene.Side, unit(random) * scene.Side, -scene.Side);
+			XMFLOAT3 direction(unit(random) * 0.5f, unit(random) * 0.5f, 1.0f);
+			start = Clock::now();
+			float treeDistance = FLT_MAX;
+			unsigned int picked = bvh.Pick(XMLoadFloat3(&origin), XMLoadFloat3(&direction), &treeDistance);
+			treePick += Milliseconds(start);
+			start = Clock::now();
+			float nearest = FLT_MAX, distance;
+			for (unsigned int i = 0; i < count; ++i)
+				if (RayBox(scene.Boxes[i], origin, direction, distance) && distance < nearest)
+					nearest = distance;
+			allPick += Milliseconds(start);
+			if (nearest == FLT_MAX)
+				Check(picked == SceneBVH::NO_INSTANCE, "ray missing every box picks nothing");
+			else
+			{
+				++hits;
+				Check(picked != SceneBVH::NO_INSTANCE && fabsf(treeDistance - nearest) <= 1e-3f * nearest + 1e-4f,
+					  "pick finds the nearest box");
+			}
+		}
+
+		printf("%6u instances, %u nodes: build %.2f ms, refit all %.3f ms, refit %zu %.3f ms\n", count,
+			   bvh.getNodeCount(), build, refitAll, moved.size(), refitSome);
+		printf("        frustum: tree %.3f ms, every box %.3f ms, %.0f visible (tree reports %.0f)\n",
+			   treeQuery / VIEWS, allQuery / VIEWS, static_cast<double>(allVisible) / VIEWS,
+			   static_cast<double>(treeVisible) / VIEWS);
+		printf("        pick: tree %.2f us, every box %.2f us, %u of %u rays hit\n", 1000.0 * treePick / RAYS,
+			   1000.0 * allPick / RAYS, hits, RAYS);
+	}
+}
+
+int main()
+{
+	mt19937 random(27);
+	for (unsigned int i = 0; i < sizeof(SCENE_SIZES) / sizeof(SCENE_SIZES[0]); ++i)
+		Benchmark(SCENE_SIZES[i], random);
+	return TestResult();
+}
@@ -0,0 +1,258 @@
+#include "gk2_triangleBVH.h"
+#include "gk2_testCheck.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace gk2;
+
+//Casts camera and random rays at the meshes of RoomAdvanced through their triangle BVHs one ray, one packet and one
+//shadow ray at a time, checks the hits against testing every triangle and reports the rays per second of each.
+//Usage: room_advanced_triangle_bvh <meshes directory>
+
+namespace
+{
+	const char* MESHES[] = { "teapot.mesh", "monitor.mesh" };
+	const unsigned int MESHES_COUNT = sizeof(MESHES) / sizeof(MESHES[0]);
+	//Camera rays of VIEWS images of SIZE x SIZE pixels around the mesh, traced in 2x2 pixel packets
+	const unsigned int SIZE = 256;
+	const unsigned int VIEWS = 4;
+	const unsigned int RANDOM_RAYS = SIZE * SIZE * VIEWS;
+	//Every triangle is tested for one ray in BRUTE_FORCE_STEP
+	const unsigned int BRUTE_FORCE_STEP = 16;
+
+	typedef chrono::steady_clock Clock;
+
+	double Seconds(Clock::time_point start)
+	{
+		return chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	struct MeshData
+	{
+		vector<XMFLOAT3> Positions;
+		vector<unsigned short> Indices;
+		XMFLOAT3 Min, Max;
+	};
+
+	//Same format as MeshLoader reads: counts, then position, normal and texture coordinates of every vertex and the
+	//indices
+	MeshData ParseMesh(const string& fileName)
+	{
+		ifstream input(fileName);
+		if (!input)
+			throw runtime_error("Cannot open " + fileName);
+		unsigned int n, in;
+		input >> n >> in;
+		MeshData mesh;
+		mesh.Positions.resize(n);
+		mesh.Min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+		mesh.Max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		float dummy;
+		for (unsigned int i = 0; i < n; ++i)
+		{
+			XMFLOAT3& p = mesh.Positions[i];
+			input >> p.x >> p.y >> p.z >> dummy >> dummy >> dummy >> dummy >> dummy;
+			mesh.Min = XMFLOAT3(min(mesh.Min.x, p.x), min(mesh.Min.y, p.y), min(mesh.Min.z, p.z));
+			mesh.Max = XMFLOAT3(max(mesh.Max.x, p.x), max(mesh.Max.y, p.y), max(mesh.Max.z, p.z));
+		}
+		mesh.Indices.resize(in);
+		for (unsigned int i = 0; i < in; ++i)
+			input >> mesh.Indices[i];
+		if (!input)
+			throw runtime_error("Cannot parse " + fileName);
+		return mesh;
+	}
+
+	struct Rays
+	{
+		vector<XMFLOAT3> Origins;
+		vector<XMFLOAT3> Directions;
+
+		void Add(const XMFLOAT3& origin, const XMFLOAT3& direction)
+		{
+			Origins.push_back(origin);
+			Directions.push_back(direction);
+		}
+	};
+
+	//Pinhole camera circling the mesh at twice its radius, the rays of every 2x2 pixels are stored one after another
+	Rays CameraRays(const MeshData& mesh)
+	{
+		XMVECTOR center = (XMLoadFloat3(&mesh.Min) + XMLoadFloat3(&mesh.Max)) * 0.5f;
+		float radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&mesh.Max) - XMLoadFloat3(&mesh.Min))) * 0.5f;
+		float tanHalfFov = tanf(XM_PIDIV4 / 2);
+		Rays rays;
+		for (unsigned int v = 0; v < VIEWS; ++v)
+		{
+			float a = v * XM_2PI / VIEWS + 0.3f;
+			XMVECTOR forward = XMVector3Normalize(XMVectorSet(-cosf(a), -0.3f, -sinf(a), 0.0f));
+			XMVECTOR eye = center - forward * (2.0f * radius / tanHalfFov / 2);
+			XMVECTOR right = XMVector3Normalize(XMVector3Cross(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), forward));
+			XMVECTOR up = XMVector3Cross(forward, right);
+			XMFLOAT3 origin;
+			XMStoreFloat3(&origin, eye);
+			for (unsigned int y = 0; y < SIZE; y += 2)
+				for (unsigned int x = 0; x < SIZE; x += 2)
+					for (unsigned int k = 0; k < TriangleBVH::PACKET_SIZE; ++k)
+					{
+						float px = ((x + k % 2 + 0.5f) / SIZE * 2 - 1) * tanHalfFov;
+						float py = (1 - (y + k / 2 + 0.5f) / SIZE * 2) * tanHalfFov;
+						XMFLOAT3 direction;
+						XMStoreFloat3(&direction, XMVector3Normalize(forward + right * px + up * py));
+						rays.Add(origin, direction);
+					}
+		}
+		return rays;
+	}
+
+	//Rays from a sphere around the mesh towards random points of its bounding box
+	Rays RandomRays(const MeshData& mesh, mt19937& random)
+	{
+		XMVECTOR center = (XMLoadFloat3(&mesh.Min) + XMLoadFloat3(&mesh.Max)) * 0.5f;
+		XMVECTOR extents = (XMLoadFloat3(&mesh.Max) - XMLoadFloat3(&mesh.Min)) * 0.5f;
+		float radius = XMVectorGetX(XMVector3Length(extents));
+		uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		Rays rays;
+		while (rays.Origins.size() < RANDOM_RAYS)
+		{
+			XMVECTOR onSphere = XMVectorSet(unit(random), unit(random), unit(random), 0.0f);
+			float length = XMVectorGetX(XMVector3Length(onSphere));
+			if (length > 1.0f || length < 1e-3f)
+				continue;
+			XMVECTOR eye = center + onSphere * (2.0f * radius / length);
+			XMVECTOR target = center + extents * XMVectorSet(unit(random), unit(random), unit(random), 0.0f);
+			XMFLOAT3 origin, direction;
+			XMStoreFloat3(&origin, eye);
+			XMStoreFloat3(&direction, XMVector3Normalize(target - eye));
+			rays.Add(origin, direction);
+		}
+		return rays;
+	}
+
+	//Moller-Trumbore against every triangle of the mesh
+	float BruteForce(const MeshData& mesh, const XMFLOAT3& o, const XMFLOAT3& d)
+	{
+		float nearest = FLT_MAX;
+		for (size_t i = 0; i < mesh.Indices.size(); i += 3)
+		{
+			const XMFLOAT3& p0 = mesh.Positions[mesh.Indices[i]];
+			const XMFLOAT3& p1 = mesh.Positions[mesh.Indices[i + 1]];
+			const XMFLOAT3& p2 = mesh.Positions[mesh.Indices[i + 2]];
+			float e1x = p1.x - p0.x, e1y = p1.y - p0.y, e1z = p1.z - p0.z;
+			float e2x = p2.x - p0.x, e2y = p2.y - p0.y, e2z = p2.z - p0.z;
+			float px = d.y * e2z - d.z * e2y, py = d.z * e2x - d.x * e2z, pz = d.x * e2y - d.y * e2x;
+			float det = e1x * px + e1y * py + e1z * pz;
+			if (fabsf(det) < 1e-12f)
+				continue;
+			float invDet = 1.0f / det;
+			float sx = o.x - p0.x, sy = o.y - p0.y, sz = o.z - p0.z;
+			float u = (sx * px + sy * py + sz * pz) * invDet;
+			if (u < 0.0f || u > 1.0f)
+				continue;
+			float qx = sy * e1z - sz * e1y, qy = sz * e1x - sx * e1z, qz = sx * e1y - sy * e1x;
+			float v = (d.x * qx + d.y * qy + d.z * qz) * invDet;
+			if (v < 0.0f || u + v > 1.0f)
+				continue;
+			float t = (e2x * qx + e2y * qy + e2z * qz) * invDet;
+			if (t > 0.0f && t < nearest)
+				nearest = t;
+		}
+		return nearest;
+	}
+
+	bool SameHit(float a, float b)
+	{
+		if (a == FLT_MAX || b == FLT_MAX)
+			return a == b;
+		return fabsf(a - b) <= 1e-4f * max(a, b);
+	}
+
+	//Rays at shared edges may slip between the triangles in one test and not the other
+	const double MAX_MISMATCHED = 1e-3;
+
+	void Benchmark(const char* kind, const MeshData& mesh, const TriangleBVH& bvh, const Rays& rays)
+	{
+		unsigned int count = static_cast<unsigned int>(rays.Origins.size());
+		vector<TriangleBVH::RayHit> single(count), packets(count);
+		vector<char> occluded(count);
+
+		Clock::time_point start = Clock::now();
+		for (unsigned int i = 0; i < count; ++i)
+			bvh.Intersect(XMLoadFloat3(&rays.Origins[i]), XMLoadFloat3(&rays.Directions[i]), single[i]);
+		double singleTime = Seconds(start);
+		start = Clock::now();
+		for (unsigned int i = 0; i < count; i += TriangleBVH::PACKET_SIZE)
+			bvh.Intersect(&rays.Origins[i], &rays.Directions[i], &packets[i]);
+		double packetTime = Seconds(start);
+		start = Clock::now();
+		for (unsigned int i = 0; i < count; ++i)
+			occluded[i] = bvh.Occluded(XMLoadFloat3(&rays.Origins[i]), XMLoadFloat3(&rays.Directions[i]), FLT_MAX);
+		double occludedTime = Seconds(start);
+		vector<float> expected;
+		start = Clock::now();
+		for (unsigned int i = 0; i < count; i += BRUTE_FORCE_STEP)
+			expected.push_back(BruteForce(mesh, rays.Origins[i], rays.Directions[i]));
+		double bruteForceTime = Seconds(start);
+
+		unsigned int hits = 0, mismatched = 0;
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			bool hit = single[i].Triangle != TriangleBVH::NO_TRIANGLE;
+			hits += hit;
+			Check(SameHit(single[i].Distance, packets[i].Distance), "packets find the hits of single rays");
+			Check(hit == (occluded[i] != 0), "shadow rays are blocked where single rays hit");
+			if (i % BRUTE_FORCE_STEP == 0 && !SameHit(single[i].Distance, expected[i / BRUTE_FORCE_STEP]))
+				++mismatched;
+		}
+		Check(mismatched <= MAX_MISMATCHED * expected.size(), "single rays find the hits of every triangle");
+
+		double mrays = count / 1e6;
+		printf("  %s rays: %u, %.1f%% hit, %u of %zu differ from every triangle\n", kind, count, 100.0 * hits / count,
+			   mismatched, expected.size());
+		printf("    single %.2f Mrays/s, packets %.2f Mrays/s, shadow %.2f Mrays/s, every triangle %.3f Mrays/s\n",
+			   mrays / singleTime, mrays / packetTime, mrays / occludedTime, expected.size() / 1e6 / bruteForceTime);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		printf("Usage: %s <meshes directory>\n", argv[0]);
+		return 1;
+	}
+	try
+	{
+		mt19937 random(28);
+		for (unsigned int i = 0; i < MESHES_COUNT; ++i)
+		{
+			MeshData mesh = ParseMesh(string(argv[1]) + "/" + MESHES[i]);
+			TriangleBVH bvh;
+			Clock::time_point start = Clock::now();
+			bvh.Build(mesh.Positions.data(), static_cast<unsigned int>(mesh.Positions.size()), sizeof(XMFLOAT3),
+					  mesh.Indices.data(), static_cast<unsigned int>(mesh.Indices.size()));
+			double build = Seconds(start) * 1000.0;
+			Check(bvh.getTrianglesCount() == mesh.Indices.size() / 3, "every triangle is in the tree");
+			printf("%s: %u triangles, %u nodes, build %.2f ms\n", MESHES[i], bvh.getTrianglesCount(),
+				   bvh.getNodesCount(), build);
+			Benchmark("camera", mesh, bvh, CameraRays(mesh));
+			Benchmark("random", mesh, bvh, RandomRays(mesh, random));
+		}
+	}
+	catch (const exception& e)
+	{
+		printf("FAILED: %s\n", e.what());
+		return 1;
+	}
+	return TestResult();
+}
@@ -0,0 +1,244 @@
+#include "gk2_displacementBaker.h"
+#include "gk2_testCheck.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace gk2;
+
+//Bakes the 16 patches of Part IV/V with a flat height map and with height.dds, checks every vertex against the
+//patches evaluated in double precision, the serialized mesh and the selection of the levels, and reports the time
+//of a bake.
+//Usage: teselacja_displacement_baker <height map>
+
+namespace
+{
+	const unsigned int RESOLUTIONS[] = { 64, 32, 16, 8 };
+	const unsigned int LODS_COUNT = sizeof(RESOLUTIONS) / sizeof(RESOLUTIONS[0]);
+	//Displacement scale of the domain shader
+	const float SCALE = 0.4f;
+	const double RADIANS_TO_DEGREES = 180.0 / 3.14159265358979323846;
+
+	struct Vector
+	{
+		double X, Y, Z;
+
+		Vector(double x = 0.0, double y = 0.0, double z = 0.0) : X(x), Y(y), Z(z) { }
+		explicit Vector(const XMFLOAT3& v) : X(v.x), Y(v.y), Z(v.z) { }
+		Vector operator +(const Vector& v) const { return Vector(X + v.X, Y + v.Y, Z + v.Z); }
+		Vector operator -(const Vector& v) const { return Vector(X - v.X, Y - v.Y, Z - v.Z); }
+		Vector operator *(double s) const { return Vector(X * s, Y * s, Z * s); }
+		double Dot(const Vector& v) const { return X * v.X + Y * v.Y + Z * v.Z; }
+		Vector Cross(const Vector& v) const { return Vector(Y * v.Z - Z * v.Y, Z * v.X - X * v.Z, X * v.Y - Y * v.X); }
+		double Length() const { return sqrt(Dot(*this)); }
+		Vector Normalized() const { return *this * (1.0 / Length()); }
+	};
+
+	double AngleDegrees(const Vector& a, const Vector& b)
+	{
+		return acos(max(-1.0, min(1.0, a.Normalized().Dot(b.Normalized())))) * RADIANS_TO_DEGREES;
+	}
+
+	//Same control points as Tessellation::InitializeBezierPatches, the drain patch moved on a 4x4 grid with every
+	//other row turned upside down
+	vector<DisplacementBaker::Patch> Patches()
+	{
+		const float L = 2.0f, H = 6.0f;
+		const float offsets[4] = { -H, -L, L, H };
+		const float depths[4] = { 0.0f, 2.0f, 2.0f, 0.0f };
+		const float sides[4] = { -2.0f, -2.0f / 3.0f, 2.0f / 3.0f, 2.0f };
+		vector<DisplacementBaker::Patch> patches(16);
+		for (unsigned int i = 0; i < 16; ++i)
+		{
+			float sign = (i / 4) % 2 ? -1.0f : 1.0f;
+			for (unsigned int j = 0; j < 16; ++j)
+				patches[i].ControlPoints[j] = XMFLOAT3(sides[j % 4] + offsets[i % 4], -sides[j / 4] + offsets[i / 4],
+													   sign * depths[j / 4]);
+			patches[i].TileX = i % DisplacementBaker::TILES;
+			patches[i].TileY = i / DisplacementBaker::TILES;
+		}
+		return patches;
+	}
+
+	void Bernstein(double t, double b[4], double d[4])
+	{
+		double s = 1.0 - t;
+		b[0] = s * s * s;
+		b[1] = 3.0 * s * s * t;
+		b[2] = 3.0 * s * t * t;
+		b[3] = t * t * t;
+		d[0] = -3.0 * s * s;
+		d[1] = 3.0 * s * s - 6.0 * s * t;
+		d[2] = 6.0 * s * t - 3.0 * t * t;
+		d[3] = 3.0 * t * t;
+	}
+
+	void Evaluate(const DisplacementBaker::Patch& patch, double u, double v, Vector& position, Vector& du, Vector& dv)
+	{
+		double bu[4], du4[4], bv[4], dv4[4];
+		Bernstein(u, bu, du4);
+		Bernstein(v, bv, dv4);
+		position = du = dv = Vector();
+		for (int j = 0; j < 4; ++j)
+			for (int i = 0; i < 4; ++i)
+			{
+				Vector p(patch.ControlPoints[j * 4 + i]);
+				position = position + p * (bu[i] * bv[j]);
+				du = du + p * (du4[i] * bv[j]);
+				dv = dv + p * (bu[i] * dv4[j]);
+			}
+	}
+
+	//Level of the height map sampled by a level of detail: the first one with less than two texels per quad
+	unsigned int MipLevel(const vector<DisplacementBaker::HeightMap>& maps, unsigned int resolution)
+	{
+		unsigned int level = 0;
+		while (level + 1 < maps.size() &&
+			   static_cast<float>(maps[level].Width) / DisplacementBaker::TILES / resolution >= 2.0f)
+			++level;
+		return level;
+	}
+
+	struct Errors
+	{
+		double Position;
+		double Derivative;
+		double Normal;
+		double Tex;
+
+		Errors() : Position(0.0), Derivative(0.0), Normal(0.0), Tex(0.0) { }
+	};
+
+	//Normals are compared with the exact ones only for a flat height map, the bilinear filter of a real one has no
+	//continuous derivative, so there they only have to face the same side as the patch
+	Errors Compare(const DisplacementBaker::Mesh& mesh, const vector<DisplacementBaker::Patch>& patches,
+				   const vector<DisplacementBaker::HeightMap>& maps, bool flat)
+	{
+		Errors errors;
+		Check(mesh.PatchCount == patches.size() && mesh.Lods.size() == LODS_COUNT, "mesh has every patch and level");
+		unsigned int vertices = 0, indices = 0;
+		for (unsigned int l = 0; l < mesh.Lods.size() && l < LODS_COUNT; ++l)
+		{
+			const DisplacementBaker::Lod& lod = mesh.Lods[l];
+			unsigned int r = RESOLUTIONS[l];
+			Check(lod.Resolution == r && lod.VerticesPerPatch == (r + 1) * (r + 1) && lod.IndexCount == r * r * 6 &&
+				  lod.VertexOffset == vertices && lod.IndexOffset == indices, "levels follow each other");
+			vertices += lod.VerticesPerPatch * mesh.PatchCount;
+			indices += lod.IndexCount;
+			bool inPatch = true;
+			for (unsigned int i = lod.IndexOffset; i < lod.IndexOffset + lod.IndexCount && i < mesh.Indices.size(); ++i)
+				inPatch = inPatch && mesh.Indices[i] < lod.VerticesPerPatch;
+			Check(inPatch, "indices stay within a patch");
+			if (vertices > mesh.Vertices.size())
+				break;
+			const DisplacementBaker::HeightMap& map = maps[MipLevel(maps, r)];
+			for (unsigned int p = 0; p < mesh.PatchCount; ++p)
+				for (unsigned int y = 0; y <= r; ++y)
+					for (unsigned int x = 0; x <= r; ++x)
+					{
+						const VertexPosNormalTangentTex& vertex =
+							mesh.Vertices[lod.VertexOffset + p * lod.VerticesPerPatch + y * (r + 1) + x];
+						double u = static_cast<double>(x) / r, v = static_cast<double>(y) / r;
+						Vector position, du, dv;
+						Evaluate(patches[p], u, v, position, du, dv);
+						Vector normal = du.Cross(dv).Normalized();
+						double texU = (u + patches[p].TileX) / DisplacementBaker::TILES;
+						double texV = (1.0 - v + patches[p].TileY) / DisplacementBaker::TILES;
+						double height = map.Sample(static_cast<float>(texU), static_cast<float>(texV));
+						Vector expected = position + normal * (SCALE * height);
+						errors.Position = max(errors.Position, (Vector(vertex.Pos) - expected).Length());
+						errors.Derivative = max(errors.Derivative, max((Vector(vertex.Tangent) - du).Length(),
+																	   (Vector(vertex.Binormal) - dv).Length()));
+						errors.Tex = max(errors.Tex, max(fabs(vertex.Tex.x - texU), fabs(vertex.Tex.y - texV)));
+						if (flat)
+							errors.Normal = max(errors.Normal, AngleDegrees(Vector(vertex.Normal), normal));
+						else
+							Check(fabs(Vector(vertex.Normal).Length() - 1.0) < 1e-5 &&
+								  Vector(vertex.Normal).Dot(normal) > 0.0, "normals face out of the patch");
+					}
+		}
+		Check(vertices == mesh.Vertices.size() && indices == mesh.Indices.size(), "mesh holds only the levels");
+		return errors;
+	}
+
+	void Report(const char* name, const Errors& errors, bool flat)
+	{
+		printf("%s: position %.2g, derivatives %.2g, texture coordinates %.2g", name, errors.Position,
+			   errors.Derivative, errors.Tex);
+		if (flat)
+			printf(", normals %.3f degrees", errors.Normal);
+		printf("\n");
+		Check(errors.Position < 1e-5 && errors.Derivative < 1e-4 && errors.Tex < 1e-6, "vertices lie on the patch");
+		if (flat)
+			Check(errors.Normal < 0.1, "normals are the normals of the patch");
+	}
+
+	void CheckSerialization(const DisplacementBaker::Mesh& mesh)
+	{
+		vector<BYTE> data = DisplacementBaker::Serialize(mesh);
+		DisplacementBaker::Mesh loaded;
+		Check(DisplacementBaker::Deserialize(data, loaded) && loaded.PatchCount == mesh.PatchCount &&
+			  loaded.Lods.size() == mesh.Lods.size() && loaded.Indices == mesh.Indices &&
+			  loaded.Vertices.size() == mesh.Vertices.size() &&
+			  memcmp(loaded.Vertices.data(), mesh.Vertices.data(),
+					 mesh.Vertices.size() * sizeof(VertexPosNormalTangentTex)) == 0, "mesh survives serialization");
+		data.pop_back();
+		Check(!DisplacementBaker::Deserialize(data, loaded), "truncated mesh is rejected");
+		data.resize(8);
+		Check(!DisplacementBaker::Deserialize(data, loaded), "truncated header is rejected");
+	}
+
+	void CheckLodSelection(const DisplacementBaker::Mesh& mesh)
+	{
+		Check(DisplacementBaker::SelectLod(mesh.Lods, 100.0f) == 0, "factors above the finest level use it");
+		Check(DisplacementBaker::SelectLod(mesh.Lods, 33.0f) == 0, "level has at least the factor's quads");
+		Check(DisplacementBaker::SelectLod(mesh.Lods, 32.0f) == 1, "level of the same resolution as the factor");
+		Check(DisplacementBaker::SelectLod(mesh.Lods, 1.0f) == LODS_COUNT - 1, "small factors use the coarsest level");
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		printf("Usage: %s <height map>\n", argv[0]);
+		return 1;
+	}
+	try
+	{
+		vector<DisplacementBaker::Patch> patches = Patches();
+		vector<unsigned int> resolutions(RESOLUTIONS, RESOLUTIONS + LODS_COUNT);
+
+		//Constant height moves the whole surface along its normals
+		vector<DisplacementBaker::HeightMap> flat(1);
+		flat[0].Width = flat[0].Height = 4;
+		flat[0].Values.assign(16, 0.5f);
+		Report("Flat height map", Compare(DisplacementBaker::Bake(patches, flat, resolutions, SCALE), patches, flat,
+										  true), true);
+
+		//Only the ASCII paths are expected here
+		string fileName = argv[1];
+		vector<DisplacementBaker::HeightMap> maps =
+			DisplacementBaker::ReadHeightMaps(DdsFile(wstring(fileName.begin(), fileName.end())));
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		DisplacementBaker::Mesh mesh = DisplacementBaker::Bake(patches, maps, resolutions, SCALE);
+		double bake = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		Report("Height map", Compare(mesh, patches, maps, false), false);
+		CheckSerialization(mesh);
+		CheckLodSelection(mesh);
+		printf("%ux%u height map with %zu levels, bake %.1f ms for %zu vertices and %zu indices\n", maps[0].Width,
+			   maps[0].Height, maps.size(), bake, mesh.Vertices.size(), mesh.Indices.size());
+	}
+	catch (const exception& e)
+	{
+		printf("FAILED: %s\n", e.what());
+		return 1;
+	}
+	return TestResult();
+}
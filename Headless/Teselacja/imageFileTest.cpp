@@ -0,0 +1,405 @@
+#include "gk2_imageFile.h"
+#include "gk2_testCheck.h"
+#include <cstdio>
+#include <cstring>
+#include <ios>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace gk2;
+
+//Decodes small TGA and BMP files built in memory, one feature at a time: palettes, grayscale, RLE packets crossing
+//rows, bit field masks, bottom-up and top-down rows and row padding. Checks the spans DdsFile gives to the
+//subresources of plain, array and cube textures and that truncated and malformed files of all three formats are
+//rejected.
+
+namespace
+{
+	typedef vector<BYTE> Bytes;
+
+	void Put(Bytes& b, unsigned int value, unsigned int bytes)
+	{
+		for (unsigned int i = 0; i < bytes; ++i)
+			b.push_back(static_cast<BYTE>(value >> (8 * i)));
+	}
+
+	void Put(Bytes& b, const Bytes& bytes)
+	{
+		b.insert(b.end(), bytes.begin(), bytes.end());
+	}
+
+	shared_ptr<istream> Stream(const Bytes& file)
+	{
+		return shared_ptr<istream>(new istringstream(string(file.begin(), file.end()), ios::binary));
+	}
+
+	//Rows of RGBA pixels from the top, every row is returned once
+	bool Decode(const Bytes& file, unsigned int width, unsigned int height, Bytes& image)
+	{
+		ImageRowReader reader(Stream(file));
+		if (!Check(reader.getWidth() == width && reader.getHeight() == height, "dimensions are read"))
+			return false;
+		image.assign(width * height * 4, 0);
+		vector<bool> seen(height, false);
+		Bytes row(width * 4);
+		unsigned int y, rows = 0;
+		while (reader.ReadRow(row.data(), y))
+		{
+			if (!Check(y < height && !seen[y], "rows are returned once"))
+				return false;
+			seen[y] = true;
+			memcpy(&image[y * width * 4], row.data(), row.size());
+			++rows;
+		}
+		return Check(rows == height, "all the rows are returned");
+	}
+
+	void CheckImage(const Bytes& file, unsigned int width, unsigned int height, const Bytes& expected,
+					const char* what)
+	{
+		Bytes image;
+		if (Decode(file, width, height, image))
+			Check(image == expected, what);
+	}
+
+	//Reading the header or all the rows throws std::ios_base::failure
+	bool Rejected(const Bytes& file)
+	{
+		try
+		{
+			ImageRowReader reader(Stream(file));
+			Bytes row(reader.getWidth() * 4);
+			unsigned int y;
+			while (reader.ReadRow(row.data(), y))
+				;
+		}
+		catch (const ios_base::failure&)
+		{
+			return true;
+		}
+		return false;
+	}
+
+	bool RejectedDds(const Bytes& file)
+	{
+		try
+		{
+			DdsFile dds(file.data(), file.size());
+		}
+		catch (const ios_base::failure&)
+		{
+			return true;
+		}
+		return false;
+	}
+
+	Bytes TgaHeader(unsigned int colorMapType, unsigned int imageType, unsigned int colorMapFirst,
+					unsigned int colorMapLength, unsigned int colorMapEntrySize, unsigned int width,
+					unsigned int height, unsigned int bitsPerPixel, unsigned int descriptor)
+	{
+		//Two bytes of image id are skipped
+		Bytes b;
+		Put(b, 2, 1);
+		Put(b, colorMapType, 1);
+		Put(b, imageType, 1);
+		Put(b, colorMapFirst, 2);
+		Put(b, colorMapLength, 2);
+		Put(b, colorMapEntrySize, 1);
+		Put(b, 0, 4);
+		Put(b, width, 2);
+		Put(b, height, 2);
+		Put(b, bitsPerPixel, 1);
+		Put(b, descriptor, 1);
+		Put(b, 0xeeee, 2);
+		return b;
+	}
+
+	void TestTga()
+	{
+		//Rows are stored from the bottom, BGR
+		Bytes file = TgaHeader(0, 2, 0, 0, 0, 2, 2, 24, 0);
+		Put(file, { 3, 2, 1, 6, 5, 4, 9, 8, 7, 12, 11, 10 });
+		CheckImage(file, 2, 2, { 7, 8, 9, 255, 10, 11, 12, 255, 1, 2, 3, 255, 4, 5, 6, 255 },
+				   "bottom-up true color TGA");
+
+		file = TgaHeader(0, 2, 0, 0, 0, 2, 1, 32, 0x28);
+		Put(file, { 3, 2, 1, 128, 6, 5, 4, 0 });
+		CheckImage(file, 2, 1, { 1, 2, 3, 128, 4, 5, 6, 0 }, "top-down TGA keeps alpha");
+
+		//Palette starts at index 2, entries are BGR
+		file = TgaHeader(1, 1, 2, 2, 24, 3, 1, 8, 0x20);
+		Put(file, { 30, 20, 10, 60, 50, 40, 2, 3, 0 });
+		CheckImage(file, 3, 1, { 10, 20, 30, 255, 40, 50, 60, 255, 0, 0, 0, 0 }, "color mapped TGA");
+
+		file = TgaHeader(1, 1, 0, 1, 32, 1, 1, 8, 0x20);
+		Put(file, { 30, 20, 10, 99, 0 });
+		CheckImage(file, 1, 1, { 10, 20, 30, 99 }, "color map with alpha");
+
+		file = TgaHeader(0, 3, 0, 0, 0, 2, 1, 8, 0x20);
+		Put(file, { 0, 200 });
+		CheckImage(file, 2, 1, { 0, 0, 0, 255, 200, 200, 200, 255 }, "grayscale TGA");
+
+		//Run of 4 pixels crosses into the second row, a raw packet of 2 ends it
+		file = TgaHeader(0, 10, 0, 0, 0, 3, 2, 24, 0x20);
+		Put(file, { 0x83, 3, 2, 1, 0x01, 6, 5, 4, 9, 8, 7 });
+		CheckImage(file, 3, 2, { 1, 2, 3, 255, 1, 2, 3, 255, 1, 2, 3, 255, 1, 2, 3, 255, 4, 5, 6, 255, 7, 8, 9, 255 },
+				   "RLE packets continue in the next row");
+
+		Check(Rejected(Bytes(file.begin(), file.begin() + 10)), "truncated TGA header is rejected");
+		Check(Rejected(Bytes(file.begin(), file.end() - 1)), "truncated RLE data is rejected");
+		file = TgaHeader(0, 2, 0, 0, 0, 2, 2, 24, 0);
+		Put(file, Bytes(11, 0));
+		Check(Rejected(file), "truncated pixels are rejected");
+		Check(Rejected(TgaHeader(0, 4, 0, 0, 0, 2, 2, 24, 0)), "unknown TGA type is rejected");
+		Check(Rejected(TgaHeader(0, 2, 0, 0, 0, 0, 2, 24, 0)), "empty TGA is rejected");
+		Check(Rejected(TgaHeader(0, 2, 0, 0, 0, 2, 20000, 24, 0)), "TGA larger than a texture is rejected");
+		Check(Rejected(TgaHeader(0, 2, 0, 0, 0, 2, 2, 16, 0)), "16 bit TGA is rejected");
+		Check(Rejected(TgaHeader(0, 2, 0, 0, 0, 2, 2, 24, 0x10)), "right to left TGA is rejected");
+		Check(Rejected(TgaHeader(0, 1, 0, 0, 0, 2, 2, 8, 0)), "TGA without its color map is rejected");
+		file = TgaHeader(1, 1, 0, 2, 16, 2, 1, 8, 0);
+		Put(file, { 0, 0, 0, 0, 0, 1 });
+		Check(Rejected(file), "16 bit TGA color map is rejected");
+	}
+
+	//Headers of infoSize bytes, compression 0 (BI_RGB) or 3 (BI_BITFIELDS)
+	Bytes BmpHeader(unsigned int infoSize, int width, int height, unsigned int bitsPerPixel, unsigned int compression,
+					unsigned int colorsUsed, unsigned int dataOffset)
+	{
+		Bytes b;
+		Put(b, { 'B', 'M' });
+		Put(b, 0, 4);
+		Put(b, 0, 4);
+		Put(b, dataOffset, 4);
+		Put(b, infoSize, 4);
+		Put(b, static_cast<unsigned int>(width), 4);
+		Put(b, static_cast<unsigned int>(height), 4);
+		Put(b, 1, 2);
+		Put(b, bitsPerPixel, 2);
+		Put(b, compression, 4);
+		Put(b, 0, 12);
+		Put(b, colorsUsed, 4);
+		Put(b, 0, 4);
+		return b;
+	}
+
+	void TestBmp()
+	{
+		//3 pixels of 24 bits take 9 bytes, rows are padded to 12 and stored from the bottom
+		Bytes file = BmpHeader(40, 3, 2, 24, 0, 0, 54);
+		Put(file, { 3, 2, 1, 6, 5, 4, 9, 8, 7, 0xee, 0xee, 0xee });
+		Put(file, { 30, 20, 10, 60, 50, 40, 90, 80, 70, 0xee, 0xee, 0xee });
+		CheckImage(file, 3, 2, { 10, 20, 30, 255, 40, 50, 60, 255, 70, 80, 90, 255, 1, 2, 3, 255, 4, 5, 6, 255, 7, 8, 9,
+								 255 }, "bottom-up 24 bit BMP with padded rows");
+
+		//Palette of 2 BGRX colors, negative height stores the rows from the top, 5 bytes are padded to 8
+		file = BmpHeader(40, 5, -2, 8, 0, 2, 62);
+		Put(file, { 30, 20, 10, 0, 60, 50, 40, 0 });
+		Put(file, { 0, 1, 1, 0, 1, 0xee, 0xee, 0xee, 1, 1, 1, 1, 0, 0xee, 0xee, 0xee });
+		Bytes a = { 10, 20, 30, 255 }, b = { 40, 50, 60, 255 }, expected;
+		const Bytes* pixels[] = { &a, &b, &b, &a, &b, &b, &b, &b, &b, &a };
+		for (unsigned int i = 0; i < 10; ++i)
+			Put(expected, *pixels[i]);
+		CheckImage(file, 5, 2, expected, "top-down BMP with a palette");
+
+		//Masks of 5, 6 and 5 bits after the basic header, no alpha
+		file = BmpHeader(40, 2, 1, 32, 3, 0, 66);
+		Put(file, 0xf800, 4);
+		Put(file, 0x07e0, 4);
+		Put(file, 0x001f, 4);
+		Put(file, 0xf800, 4);
+		Put(file, 0x07ff, 4);
+		CheckImage(file, 2, 1, { 255, 0, 0, 255, 0, 255, 255, 255 }, "bit field masks are scaled to 8 bits");
+
+		//Version 4 header holds the masks and the alpha mask
+		file = BmpHeader(108, 1, 1, 32, 3, 0, 122);
+		Put(file, 0x000000ff, 4);
+		Put(file, 0x0000ff00, 4);
+		Put(file, 0x00ff0000, 4);
+		Put(file, 0xff000000, 4);
+		Put(file, Bytes(108 - 56, 0));
+		Put(file, { 1, 2, 3, 4 });
+		CheckImage(file, 1, 1, { 1, 2, 3, 4 }, "alpha mask of a version 4 header");
+
+		file = BmpHeader(40, 3, 2, 24, 0, 0, 54);
+		Put(file, Bytes(12 + 9, 0));
+		Check(Rejected(file), "truncated BMP pixels are rejected");
+		Check(Rejected(Bytes(file.begin(), file.begin() + 30)), "truncated BMP header is rejected");
+		Check(Rejected(BmpHeader(40, 3, 2, 24, 1, 0, 54)), "RLE BMP is rejected");
+		Check(Rejected(BmpHeader(40, 3, 2, 16, 0, 0, 54)), "16 bit BMP is rejected");
+		Check(Rejected(BmpHeader(40, 0, 2, 24, 0, 0, 54)), "empty BMP is rejected");
+		Check(Rejected(BmpHeader(40, -3, 2, 24, 0, 0, 54)), "BMP of negative width is rejected");
+		Check(Rejected(BmpHeader(200, 3, 2, 24, 0, 0, 54)), "BMP header of unknown size is rejected");
+		Check(Rejected(BmpHeader(40, 3, 2, 8, 0, 257, 54)), "BMP palette of more than 256 colors is rejected");
+		//Row of 2^27 + 1 pixels of 32 bits would overflow 32 bit sizes and take 4 bytes
+		file = BmpHeader(40, 0x08000001, 1, 32, 0, 0, 54);
+		Put(file, Bytes(4, 0));
+		Check(Rejected(file), "BMP with too long rows is rejected");
+		Check(Rejected(BmpHeader(40, 1, -0x7fffffff - 1, 32, 0, 0, 54)), "BMP with too many rows is rejected");
+	}
+
+	const unsigned int DDSD_MIPMAPCOUNT = 0x20000;
+	const unsigned int DDPF_ALPHAPIXELS = 0x1, DDPF_FOURCC = 0x4, DDPF_RGB = 0x40;
+	const unsigned int DDSCAPS2_CUBEMAP = 0x200, DDSCAPS2_CUBEMAP_ALLFACES = 0xfc00;
+
+	struct DdsDesc
+	{
+		unsigned int Width;
+		unsigned int Height;
+		unsigned int MipMapCount;
+		unsigned int PixelFlags;
+		//FourCC, or RGB bit count with the masks
+		const char* FourCC;
+		unsigned int BitCount;
+		unsigned int Masks[4];
+		unsigned int Caps2;
+	};
+
+	Bytes DdsHeader(const DdsDesc& d)
+	{
+		Bytes b;
+		Put(b, { 'D', 'D', 'S', ' ' });
+		Put(b, 124, 4);
+		Put(b, d.MipMapCount ? DDSD_MIPMAPCOUNT : 0, 4);
+		Put(b, d.Height, 4);
+		Put(b, d.Width, 4);
+		Put(b, 0, 8);
+		Put(b, d.MipMapCount, 4);
+		Put(b, 0, 44);
+		Put(b, 32, 4);
+		Put(b, d.PixelFlags, 4);
+		for (unsigned int i = 0; i < 4; ++i)
+			Put(b, d.FourCC ? static_cast<BYTE>(d.FourCC[i]) : 0, 1);
+		Put(b, d.BitCount, 4);
+		for (unsigned int i = 0; i < 4; ++i)
+			Put(b, d.Masks[i], 4);
+		Put(b, 0x1000, 4);
+		Put(b, d.Caps2, 4);
+		Put(b, 0, 12);
+		return b;
+	}
+
+	Bytes Dx10Header(unsigned int format, unsigned int dimension, unsigned int miscFlag, unsigned int arraySize)
+	{
+		Bytes b;
+		Put(b, format, 4);
+		Put(b, dimension, 4);
+		Put(b, miscFlag, 4);
+		Put(b, arraySize, 4);
+		Put(b, 0, 4);
+		return b;
+	}
+
+	//Checks the spans of the subresources given as width, height, row pitch and size, in the order of the file
+	void CheckSpans(const DdsFile& dds, const Bytes& file, size_t offset, const vector<vector<size_t>>& spans,
+					const char* what)
+	{
+		bool ok = dds.getSubresourcesCount() == spans.size();
+		for (unsigned int i = 0; ok && i < spans.size(); ++i)
+		{
+			const DdsFile::Subresource& s = dds.getSubresource(i);
+			ok = s.Width == spans[i][0] && s.Height == spans[i][1] && s.RowPitch == spans[i][2] &&
+				 s.Size == spans[i][3] && s.Data == file.data() + offset;
+			offset += s.Size;
+		}
+		Check(ok && offset == file.size(), what);
+	}
+
+	void TestDds()
+	{
+		//8x8 BC1 without a mipmap count in the flags has one level
+		DdsDesc bc1 = { 8, 8, 0, DDPF_FOURCC, "DXT1", 0, { }, 0 };
+		Bytes file = DdsHeader(bc1);
+		Put(file, Bytes(32, 0));
+		DdsFile dds(file.data(), file.size());
+		Check(dds.getFormat() == DdsFile::FORMAT_BC1 && dds.getMipLevels() == 1 && dds.getArraySize() == 1,
+			  "legacy BC1 DDS");
+		CheckSpans(dds, file, 128, { { 8, 8, 16, 32 } }, "BC1 level is 2x2 blocks");
+
+		//Levels down to 1x1 still take a whole block, 6x2 rounds up to 2x1 blocks
+		bc1.Width = 6;
+		bc1.Height = 2;
+		bc1.MipMapCount = 3;
+		file = DdsHeader(bc1);
+		Put(file, Bytes(16 + 8 + 8, 0));
+		CheckSpans(DdsFile(file.data(), file.size()), file, 128, { { 6, 2, 16, 16 }, { 3, 1, 8, 8 }, { 1, 1, 8, 8 } },
+				   "BC1 mipmaps round up to whole blocks");
+		Check(RejectedDds(Bytes(file.begin(), file.end() - 1)), "DDS missing the last byte is rejected");
+
+		//Array of 2 RGBA images 5x3 with 2 levels, all the levels of the first image come first
+		DdsDesc dx10 = { 5, 3, 2, DDPF_FOURCC, "DX10", 0, { }, 0 };
+		file = DdsHeader(dx10);
+		Put(file, Dx10Header(29, 3, 0, 2));
+		Put(file, Bytes(2 * (60 + 8), 0));
+		dds = DdsFile(file.data(), file.size());
+		Check(dds.getFormat() == DdsFile::FORMAT_R8G8B8A8 && dds.getArraySize() == 2 && !dds.isCubeMap(),
+			  "sRGB array in the DX10 header");
+		CheckSpans(dds, file, 148, { { 5, 3, 20, 60 }, { 2, 1, 8, 8 }, { 5, 3, 20, 60 }, { 2, 1, 8, 8 } },
+				   "array subresources are ordered like D3D11CalcSubresource");
+		Check(&dds.getSubresource(1, 1) == &dds.getSubresource(3), "subresource of an image and level");
+
+		//Cube of 24 bit BGR faces 3x1, rows of 9 bytes aren't padded
+		DdsDesc cube = { 3, 1, 1, DDPF_RGB, nullptr, 24, { 0xff0000, 0xff00, 0xff, 0 },
+						 DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_ALLFACES };
+		file = DdsHeader(cube);
+		Put(file, Bytes(6 * 9, 0));
+		dds = DdsFile(file.data(), file.size());
+		Check(dds.getFormat() == DdsFile::FORMAT_B8G8R8 && dds.isCubeMap() && dds.getArraySize() == 6, "legacy cube");
+		vector<vector<size_t>> faces(6, vector<size_t>{ 3, 1, 9, 9 });
+		CheckSpans(dds, file, 128, faces, "cube faces follow each other");
+
+		DdsDesc bgra = { 1, 1, 1, DDPF_RGB | DDPF_ALPHAPIXELS, nullptr, 32, { 0xff0000, 0xff00, 0xff, 0xff000000 }, 0 };
+		file = DdsHeader(bgra);
+		Put(file, Bytes(4, 0));
+		Check(DdsFile(file.data(), file.size()).getFormat() == DdsFile::FORMAT_B8G8R8A8, "BGRA masks");
+
+		Check(RejectedDds(Bytes(file.begin(), file.begin() + 100)), "truncated DDS header is rejected");
+		Bytes wrong = file;
+		wrong[0] = 'X';
+		Check(RejectedDds(wrong), "file without the DDS magic is rejected");
+		wrong = file;
+		wrong[4] = 100;
+		Check(RejectedDds(wrong), "DDS header of a wrong size is rejected");
+		cube.Caps2 = DDSCAPS2_CUBEMAP | 0x400;
+		file = DdsHeader(cube);
+		Put(file, Bytes(6 * 9, 0));
+		Check(RejectedDds(file), "partial cube is rejected");
+		DdsDesc unknown = { 4, 4, 1, DDPF_FOURCC, "ABCD", 0, { }, 0 };
+		file = DdsHeader(unknown);
+		Put(file, Bytes(64, 0));
+		Check(RejectedDds(file), "unknown FourCC is rejected");
+		file = DdsHeader(dx10);
+		Put(file, Bytes(10, 0));
+		Check(RejectedDds(file), "truncated DX10 header is rejected");
+		file = DdsHeader(dx10);
+		Put(file, Dx10Header(28, 4, 0, 1));
+		Put(file, Bytes(68, 0));
+		Check(RejectedDds(file), "3D texture is rejected");
+		file = DdsHeader(dx10);
+		Put(file, Dx10Header(1000, 3, 0, 1));
+		Put(file, Bytes(68, 0));
+		Check(RejectedDds(file), "unknown DXGI format is rejected");
+		//Billions of subresources mustn't be allocated before the file is found to be too short
+		dx10.MipMapCount = 0xffffffff;
+		file = DdsHeader(dx10);
+		Put(file, Dx10Header(28, 3, 0, 0xffffffff));
+		Put(file, Bytes(68, 0));
+		Check(RejectedDds(file), "DDS with more subresources than bytes is rejected");
+		dx10.Width = 0;
+		dx10.MipMapCount = 1;
+		file = DdsHeader(dx10);
+		Put(file, Dx10Header(28, 3, 0, 1));
+		Check(RejectedDds(file), "empty DDS is rejected");
+	}
+}
+
+int main()
+{
+	TestTga();
+	TestBmp();
+	TestDds();
+	if (TestFailures() == 0)
+		printf("All image file checks passed\n");
+	return TestResult();
+}
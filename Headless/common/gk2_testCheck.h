@@ -0,0 +1,41 @@
+#ifndef __GK2_TEST_CHECK_H_
+#define __GK2_TEST_CHECK_H_
+
+#include <cstdio>
+
+//Checks shared by the headless tests. A test calls Check for every condition and returns TestResult() from main.
+
+namespace gk2
+{
+	//Only the first failures are printed, a broken loop would flood the log otherwise
+	const unsigned int MAX_PRINTED_FAILURES = 20;
+
+	inline unsigned int& TestFailures()
+	{
+		static unsigned int failures = 0;
+		return failures;
+	}
+
+	//Returns the condition, so that a test can print more about the failure
+	inline bool Check(bool condition, const char* what)
+	{
+		if (!condition)
+		{
+			if (TestFailures() < MAX_PRINTED_FAILURES)
+				printf("FAILED: %s\n", what);
+			++TestFailures();
+		}
+		return condition;
+	}
+
+	//Exit code of the test
+	inline int TestResult()
+	{
+		if (TestFailures() == 0)
+			return 0;
+		printf("%u checks failed\n", TestFailures());
+		return 1;
+	}
+}
+
+#endif __GK2_TEST_CHECK_H_
@@ -0,0 +1,54 @@
+#ifndef __GK2_COMPAT_WINDOWS_H_
+#define __GK2_COMPAT_WINDOWS_H_
+
+//Types and the few calls of the Windows API the device independent modules use. Only on the include path of
+//the headless build on other platforms, the Visual Studio projects use the Windows SDK.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cwchar>
+
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef uint32_t DWORD;
+typedef uint32_t UINT;
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef int64_t LONGLONG;
+typedef uint64_t ULONGLONG;
+typedef uint64_t UINT64;
+typedef int BOOL;
+typedef int INT;
+typedef float FLOAT;
+typedef uint8_t UINT8;
+typedef int32_t HRESULT;
+typedef wchar_t WCHAR;
+typedef const wchar_t* LPCWSTR;
+typedef const char* LPCSTR;
+typedef void* HANDLE;
+
+struct POINT
+{
+	LONG x;
+	LONG y;
+};
+
+#define S_OK ((HRESULT)0)
+#define E_FAIL ((HRESULT)0x80004005)
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+#define ZeroMemory(destination, length) memset((destination), 0, (length))
+
+inline void OutputDebugStringA(const char* text)
+{
+	fputs(text, stderr);
+}
+
+inline void OutputDebugStringW(const wchar_t* text)
+{
+	fprintf(stderr, "%ls", text);
+}
+
+#endif __GK2_COMPAT_WINDOWS_H_
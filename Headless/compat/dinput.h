@@ -0,0 +1,16 @@
+#ifndef __GK2_COMPAT_DINPUT_H_
+#define __GK2_COMPAT_DINPUT_H_
+
+//State of the mouse the captured input stores. The headless build never creates DirectInput devices.
+
+#include "Windows.h"
+
+struct DIMOUSESTATE
+{
+	LONG lX;
+	LONG lY;
+	LONG lZ;
+	BYTE rgbButtons[4];
+};
+
+#endif __GK2_COMPAT_DINPUT_H_
@@ -0,0 +1,441 @@
+#ifndef __GK2_COMPAT_XNAMATH_H_
+#define __GK2_COMPAT_XNAMATH_H_
+
+//Subset of xnamath used by the device independent modules, so that they can be built and tested on compilers
+//without the DirectX SDK. Vectors are SSE registers like in xnamath, the results match the xnamath reference
+//implementation up to rounding. Only included through Headless/compat, never by the Visual Studio projects.
+
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#include <cmath>
+#include <cstdint>
+#include "Windows.h"
+
+#define XM_PI 3.141592654f
+#define XM_2PI 6.283185307f
+#define XM_1DIVPI 0.318309886f
+#define XM_PIDIV2 1.570796327f
+#define XM_PIDIV4 0.785398163f
+
+#define XM_INLINE inline
+
+typedef __m128 XMVECTOR;
+typedef const XMVECTOR FXMVECTOR;
+typedef const XMVECTOR CXMVECTOR;
+
+struct XMFLOAT2
+{
+	float x, y;
+	XMFLOAT2() { }
+	XMFLOAT2(float _x, float _y) : x(_x), y(_y) { }
+};
+
+struct XMFLOAT3
+{
+	float x, y, z;
+	XMFLOAT3() { }
+	XMFLOAT3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) { }
+};
+
+struct XMFLOAT4
+{
+	float x, y, z, w;
+	XMFLOAT4() { }
+	XMFLOAT4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) { }
+};
+
+struct XMFLOAT4X4
+{
+	union
+	{
+		struct
+		{
+			float _11, _12, _13, _14;
+			float _21, _22, _23, _24;
+			float _31, _32, _33, _34;
+			float _41, _42, _43, _44;
+		};
+		float m[4][4];
+	};
+	XMFLOAT4X4() { }
+};
+
+struct XMMATRIX;
+typedef const XMMATRIX& CXMMATRIX;
+XMMATRIX XMMatrixMultiply(CXMMATRIX a, CXMMATRIX b);
+
+struct XMMATRIX
+{
+	XMVECTOR r[4];
+
+	XMMATRIX() { }
+	XMMATRIX(FXMVECTOR r0, FXMVECTOR r1, FXMVECTOR r2, CXMVECTOR r3)
+	{
+		r[0] = r0;
+		r[1] = r1;
+		r[2] = r2;
+		r[3] = r3;
+	}
+	XMMATRIX(float m00, float m01, float m02, float m03, float m10, float m11, float m12, float m13,
+			 float m20, float m21, float m22, float m23, float m30, float m31, float m32, float m33)
+	{
+		r[0] = _mm_setr_ps(m00, m01, m02, m03);
+		r[1] = _mm_setr_ps(m10, m11, m12, m13);
+		r[2] = _mm_setr_ps(m20, m21, m22, m23);
+		r[3] = _mm_setr_ps(m30, m31, m32, m33);
+	}
+
+	XMMATRIX operator*(CXMMATRIX m) const { return XMMatrixMultiply(*this, m); }
+	XMMATRIX& operator*=(CXMMATRIX m) { *this = XMMatrixMultiply(*this, m); return *this; }
+};
+
+//Scalars
+
+XM_INLINE void XMScalarSinCos(float* sin, float* cos, float value)
+{
+	*sin = sinf(value);
+	*cos = cosf(value);
+}
+
+XM_INLINE float XMScalarSin(float value) { return sinf(value); }
+XM_INLINE float XMScalarCos(float value) { return cosf(value); }
+XM_INLINE float XMScalarACos(float value) { return acosf(value); }
+
+XM_INLINE float XMScalarModAngle(float angle)
+{
+	angle += XM_PI;
+	float t = fabsf(angle);
+	t = t - XM_2PI * static_cast<float>(static_cast<int>(t / XM_2PI));
+	t -= XM_PI;
+	return angle < 0.0f ? -t : t;
+}
+
+//Construction and access
+
+XM_INLINE XMVECTOR XMVectorZero() { return _mm_setzero_ps(); }
+XM_INLINE XMVECTOR XMVectorSet(float x, float y, float z, float w) { return _mm_setr_ps(x, y, z, w); }
+XM_INLINE XMVECTOR XMVectorReplicate(float value) { return _mm_set1_ps(value); }
+XM_INLINE XMVECTOR XMVectorSplatOne() { return _mm_set1_ps(1.0f); }
+XM_INLINE XMVECTOR XMVectorFalseInt() { return _mm_setzero_ps(); }
+XM_INLINE XMVECTOR XMVectorTrueInt() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+
+XM_INLINE XMVECTOR XMVectorSetInt(UINT x, UINT y, UINT z, UINT w)
+{
+	return _mm_castsi128_ps(_mm_setr_epi32(static_cast<int>(x), static_cast<int>(y), static_cast<int>(z),
+										   static_cast<int>(w)));
+}
+
+XM_INLINE float XMVectorGetX(FXMVECTOR v) { return _mm_cvtss_f32(v); }
+XM_INLINE float XMVectorGetY(FXMVECTOR v) { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))); }
+XM_INLINE float XMVectorGetZ(FXMVECTOR v) { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))); }
+XM_INLINE float XMVectorGetW(FXMVECTOR v) { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))); }
+
+XM_INLINE XMVECTOR XMVectorSetW(FXMVECTOR v, float w)
+{
+	float f[4];
+	_mm_storeu_ps(f, v);
+	f[3] = w;
+	return _mm_loadu_ps(f);
+}
+
+XM_INLINE XMVECTOR XMVectorSplatX(FXMVECTOR v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)); }
+XM_INLINE XMVECTOR XMVectorSplatY(FXMVECTOR v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)); }
+XM_INLINE XMVECTOR XMVectorSplatZ(FXMVECTOR v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)); }
+XM_INLINE XMVECTOR XMVectorSplatW(FXMVECTOR v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)); }
+
+//Loads and stores
+
+XM_INLINE XMVECTOR XMLoadFloat2(const XMFLOAT2* source) { return _mm_setr_ps(source->x, source->y, 0.0f, 0.0f); }
+XM_INLINE XMVECTOR XMLoadFloat3(const XMFLOAT3* source)
+{
+	return _mm_setr_ps(source->x, source->y, source->z, 0.0f);
+}
+XM_INLINE XMVECTOR XMLoadFloat4(const XMFLOAT4* source) { return _mm_loadu_ps(&source->x); }
+
+XM_INLINE void XMStoreFloat2(XMFLOAT2* destination, FXMVECTOR v)
+{
+	destination->x = XMVectorGetX(v);
+	destination->y = XMVectorGetY(v);
+}
+
+XM_INLINE void XMStoreFloat3(XMFLOAT3* destination, FXMVECTOR v)
+{
+	float f[4];
+	_mm_storeu_ps(f, v);
+	destination->x = f[0];
+	destination->y = f[1];
+	destination->z = f[2];
+}
+
+XM_INLINE void XMStoreFloat4(XMFLOAT4* destination, FXMVECTOR v) { _mm_storeu_ps(&destination->x, v); }
+XM_INLINE void XMStoreInt4(UINT* destination, FXMVECTOR v)
+{
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(destination), _mm_castps_si128(v));
+}
+
+XM_INLINE XMMATRIX XMLoadFloat4x4(const XMFLOAT4X4* source)
+{
+	XMMATRIX m;
+	for (int i = 0; i < 4; ++i)
+		m.r[i] = _mm_loadu_ps(source->m[i]);
+	return m;
+}
+
+XM_INLINE void XMStoreFloat4x4(XMFLOAT4X4* destination, CXMMATRIX m)
+{
+	for (int i = 0; i < 4; ++i)
+		_mm_storeu_ps(destination->m[i], m.r[i]);
+}
+
+//Component-wise operations
+
+XM_INLINE XMVECTOR XMVectorAdd(FXMVECTOR a, FXMVECTOR b) { return _mm_add_ps(a, b); }
+XM_INLINE XMVECTOR XMVectorSubtract(FXMVECTOR a, FXMVECTOR b) { return _mm_sub_ps(a, b); }
+XM_INLINE XMVECTOR XMVectorMultiply(FXMVECTOR a, FXMVECTOR b) { return _mm_mul_ps(a, b); }
+XM_INLINE XMVECTOR XMVectorDivide(FXMVECTOR a, FXMVECTOR b) { return _mm_div_ps(a, b); }
+XM_INLINE XMVECTOR XMVectorScale(FXMVECTOR v, float s) { return _mm_mul_ps(v, _mm_set1_ps(s)); }
+XM_INLINE XMVECTOR XMVectorNegate(FXMVECTOR v) { return _mm_sub_ps(_mm_setzero_ps(), v); }
+XM_INLINE XMVECTOR XMVectorMultiplyAdd(FXMVECTOR a, FXMVECTOR b, FXMVECTOR c)
+{
+	return _mm_add_ps(_mm_mul_ps(a, b), c);
+}
+XM_INLINE XMVECTOR XMVectorReciprocal(FXMVECTOR v) { return _mm_div_ps(_mm_set1_ps(1.0f), v); }
+XM_INLINE XMVECTOR XMVectorSqrt(FXMVECTOR v) { return _mm_sqrt_ps(v); }
+XM_INLINE XMVECTOR XMVectorMin(FXMVECTOR a, FXMVECTOR b) { return _mm_min_ps(a, b); }
+XM_INLINE XMVECTOR XMVectorMax(FXMVECTOR a, FXMVECTOR b) { return _mm_max_ps(a, b); }
+XM_INLINE XMVECTOR XMVectorAbs(FXMVECTOR v) { return _mm_max_ps(v, _mm_sub_ps(_mm_setzero_ps(), v)); }
+XM_INLINE XMVECTOR XMVectorSaturate(FXMVECTOR v)
+{
+	return _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+}
+
+XM_INLINE XMVECTOR XMVectorLess(FXMVECTOR a, FXMVECTOR b) { return _mm_cmplt_ps(a, b); }
+XM_INLINE XMVECTOR XMVectorLessOrEqual(FXMVECTOR a, FXMVECTOR b) { return _mm_cmple_ps(a, b); }
+XM_INLINE XMVECTOR XMVectorGreater(FXMVECTOR a, FXMVECTOR b) { return _mm_cmpgt_ps(a, b); }
+XM_INLINE XMVECTOR XMVectorGreaterOrEqual(FXMVECTOR a, FXMVECTOR b) { return _mm_cmpge_ps(a, b); }
+XM_INLINE XMVECTOR XMVectorEqual(FXMVECTOR a, FXMVECTOR b) { return _mm_cmpeq_ps(a, b); }
+XM_INLINE XMVECTOR XMVectorAndInt(FXMVECTOR a, FXMVECTOR b) { return _mm_and_ps(a, b); }
+XM_INLINE XMVECTOR XMVectorOrInt(FXMVECTOR a, FXMVECTOR b) { return _mm_or_ps(a, b); }
+XM_INLINE XMVECTOR XMVectorSelect(FXMVECTOR a, FXMVECTOR b, FXMVECTOR control)
+{
+	return _mm_or_ps(_mm_andnot_ps(control, a), _mm_and_ps(b, control));
+}
+
+//Arithmetic operators of XMVECTOR are the built-in operators of the vector type
+
+//Geometric operations
+
+XM_INLINE XMVECTOR XMVector3Dot(FXMVECTOR a, FXMVECTOR b)
+{
+	XMVECTOR p = _mm_mul_ps(a, b);
+	return _mm_set1_ps(XMVectorGetX(p) + XMVectorGetY(p) + XMVectorGetZ(p));
+}
+
+XM_INLINE XMVECTOR XMVector4Dot(FXMVECTOR a, FXMVECTOR b)
+{
+	XMVECTOR p = _mm_mul_ps(a, b);
+	return _mm_set1_ps(XMVectorGetX(p) + XMVectorGetY(p) + XMVectorGetZ(p) + XMVectorGetW(p));
+}
+
+XM_INLINE XMVECTOR XMVector3Cross(FXMVECTOR a, FXMVECTOR b)
+{
+	XMVECTOR a1 = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+	XMVECTOR b1 = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2));
+	XMVECTOR a2 = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2));
+	XMVECTOR b2 = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+	XMVECTOR c = _mm_sub_ps(_mm_mul_ps(a1, b1), _mm_mul_ps(a2, b2));
+	return XMVectorSetW(c, 0.0f);
+}
+
+XM_INLINE XMVECTOR XMVector3LengthSq(FXMVECTOR v) { return XMVector3Dot(v, v); }
+XM_INLINE XMVECTOR XMVector3Length(FXMVECTOR v) { return _mm_sqrt_ps(XMVector3Dot(v, v)); }
+XM_INLINE XMVECTOR XMVector4Length(FXMVECTOR v) { return _mm_sqrt_ps(XMVector4Dot(v, v)); }
+
+XM_INLINE XMVECTOR XMVector3Normalize(FXMVECTOR v)
+{
+	float length = XMVectorGetX(XMVector3Length(v));
+	return length > 0.0f ? XMVectorScale(v, 1.0f / length) : v;
+}
+
+XM_INLINE XMVECTOR XMVector3ClampLength(FXMVECTOR v, float lengthMin, float lengthMax)
+{
+	float length = XMVectorGetX(XMVector3Length(v));
+	if (length <= 0.0f)
+		return v;
+	float clamped = length < lengthMin ? lengthMin : (length > lengthMax ? lengthMax : length);
+	return XMVectorScale(v, clamped / length);
+}
+
+XM_INLINE XMVECTOR XMPlaneNormalize(FXMVECTOR p)
+{
+	float length = XMVectorGetX(XMVector3Length(p));
+	return length > 0.0f ? XMVectorScale(p, 1.0f / length) : p;
+}
+
+XM_INLINE XMVECTOR XMVector4Transform(FXMVECTOR v, CXMMATRIX m)
+{
+	XMVECTOR result = _mm_mul_ps(XMVectorSplatX(v), m.r[0]);
+	result = _mm_add_ps(result, _mm_mul_ps(XMVectorSplatY(v), m.r[1]));
+	result = _mm_add_ps(result, _mm_mul_ps(XMVectorSplatZ(v), m.r[2]));
+	return _mm_add_ps(result, _mm_mul_ps(XMVectorSplatW(v), m.r[3]));
+}
+
+XM_INLINE XMVECTOR XMVector3Transform(FXMVECTOR v, CXMMATRIX m)
+{
+	XMVECTOR result = _mm_mul_ps(XMVectorSplatX(v), m.r[0]);
+	result = _mm_add_ps(result, _mm_mul_ps(XMVectorSplatY(v), m.r[1]));
+	result = _mm_add_ps(result, _mm_mul_ps(XMVectorSplatZ(v), m.r[2]));
+	return _mm_add_ps(result, m.r[3]);
+}
+
+XM_INLINE XMVECTOR XMVector3TransformCoord(FXMVECTOR v, CXMMATRIX m)
+{
+	XMVECTOR result = XMVector3Transform(v, m);
+	return _mm_div_ps(result, XMVectorSplatW(result));
+}
+
+XM_INLINE XMVECTOR XMVector3TransformNormal(FXMVECTOR v, CXMMATRIX m)
+{
+	XMVECTOR result = _mm_mul_ps(XMVectorSplatX(v), m.r[0]);
+	result = _mm_add_ps(result, _mm_mul_ps(XMVectorSplatY(v), m.r[1]));
+	return _mm_add_ps(result, _mm_mul_ps(XMVectorSplatZ(v), m.r[2]));
+}
+
+//Matrices
+
+XM_INLINE XMMATRIX XMMatrixIdentity()
+{
+	return XMMATRIX(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+XM_INLINE XMMATRIX XMMatrixMultiply(CXMMATRIX a, CXMMATRIX b)
+{
+	XMMATRIX result;
+	for (int i = 0; i < 4; ++i)
+		result.r[i] = XMVector4Transform(a.r[i], b);
+	return result;
+}
+
+XM_INLINE XMMATRIX XMMatrixTranspose(CXMMATRIX m)
+{
+	XMMATRIX result = m;
+	_MM_TRANSPOSE4_PS(result.r[0], result.r[1], result.r[2], result.r[3]);
+	return result;
+}
+
+XM_INLINE XMMATRIX XMMatrixInverse(XMVECTOR* determinant, CXMMATRIX m)
+{
+	//Gauss-Jordan elimination with partial pivoting, in doubles
+	double a[4][8];
+	for (int i = 0; i < 4; ++i)
+	{
+		float row[4];
+		_mm_storeu_ps(row, m.r[i]);
+		for (int j = 0; j < 4; ++j)
+		{
+			a[i][j] = row[j];
+			a[i][j + 4] = i == j ? 1.0 : 0.0;
+		}
+	}
+	double det = 1.0;
+	for (int c = 0; c < 4; ++c)
+	{
+		int pivot = c;
+		for (int r = c + 1; r < 4; ++r)
+			if (fabs(a[r][c]) > fabs(a[pivot][c]))
+				pivot = r;
+		if (pivot != c)
+		{
+			for (int j = 0; j < 8; ++j)
+			{
+				double t = a[pivot][j];
+				a[pivot][j] = a[c][j];
+				a[c][j] = t;
+			}
+			det = -det;
+		}
+		det *= a[c][c];
+		if (a[c][c] == 0.0)
+			break;
+		double inverse = 1.0 / a[c][c];
+		for (int j = 0; j < 8; ++j)
+			a[c][j] *= inverse;
+		for (int r = 0; r < 4; ++r)
+		{
+			if (r == c)
+				continue;
+			double f = a[r][c];
+			for (int j = 0; j < 8; ++j)
+				a[r][j] -= f * a[c][j];
+		}
+	}
+	if (determinant)
+		*determinant = _mm_set1_ps(static_cast<float>(det));
+	XMMATRIX result;
+	for (int i = 0; i < 4; ++i)
+		result.r[i] = _mm_setr_ps(static_cast<float>(a[i][4]), static_cast<float>(a[i][5]),
+								  static_cast<float>(a[i][6]), static_cast<float>(a[i][7]));
+	return result;
+}
+
+XM_INLINE XMMATRIX XMMatrixTranslation(float x, float y, float z)
+{
+	return XMMATRIX(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, x, y, z, 1.0f);
+}
+
+XM_INLINE XMMATRIX XMMatrixScaling(float x, float y, float z)
+{
+	return XMMATRIX(x, 0.0f, 0.0f, 0.0f, 0.0f, y, 0.0f, 0.0f, 0.0f, 0.0f, z, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+XM_INLINE XMMATRIX XMMatrixRotationX(float angle)
+{
+	float s, c;
+	XMScalarSinCos(&s, &c, angle);
+	return XMMATRIX(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, c, s, 0.0f, 0.0f, -s, c, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+XM_INLINE XMMATRIX XMMatrixRotationY(float angle)
+{
+	float s, c;
+	XMScalarSinCos(&s, &c, angle);
+	return XMMATRIX(c, 0.0f, -s, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, s, 0.0f, c, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+XM_INLINE XMMATRIX XMMatrixRotationZ(float angle)
+{
+	float s, c;
+	XMScalarSinCos(&s, &c, angle);
+	return XMMATRIX(c, s, 0.0f, 0.0f, -s, c, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+XM_INLINE XMMATRIX XMMatrixLookToLH(FXMVECTOR eye, FXMVECTOR direction, FXMVECTOR up)
+{
+	XMVECTOR z = XMVector3Normalize(direction);
+	XMVECTOR x = XMVector3Normalize(XMVector3Cross(up, z));
+	XMVECTOR y = XMVector3Cross(z, x);
+	XMVECTOR negEye = XMVectorNegate(eye);
+	XMMATRIX m(XMVectorSetW(x, XMVectorGetX(XMVector3Dot(x, negEye))),
+			   XMVectorSetW(y, XMVectorGetX(XMVector3Dot(y, negEye))),
+			   XMVectorSetW(z, XMVectorGetX(XMVector3Dot(z, negEye))),
+			   XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f));
+	return XMMatrixTranspose(m);
+}
+
+XM_INLINE XMMATRIX XMMatrixLookAtLH(FXMVECTOR eye, FXMVECTOR focus, FXMVECTOR up)
+{
+	return XMMatrixLookToLH(eye, _mm_sub_ps(focus, eye), up);
+}
+
+XM_INLINE XMMATRIX XMMatrixPerspectiveFovLH(float fovAngleY, float aspectRatio, float nearZ, float farZ)
+{
+	float s, c;
+	XMScalarSinCos(&s, &c, 0.5f * fovAngleY);
+	float height = c / s;
+	float width = height / aspectRatio;
+	float range = farZ / (farZ - nearZ);
+	return XMMATRIX(width, 0.0f, 0.0f, 0.0f, 0.0f, height, 0.0f, 0.0f, 0.0f, 0.0f, range, 1.0f,
+					0.0f, 0.0f, -range * nearZ, 0.0f);
+}
+
+#endif __GK2_COMPAT_XNAMATH_H_
@@ -5,7 +5,11 @@
 #include <D3DX11.h>
 #include <dinput.h>
 #include "gk2_input.h"
+#include "gk2_inputCapture.h"
 #include "gk2_deviceHelper.h"
+#include "gk2_stateFilteringContext.h"
+#include "gk2_frameArena.h"
+#include "gk2_profiler.h"
 
 namespace gk2
 {
@@ -22,6 +26,16 @@ namespace gk2
 		inline HINSTANCE getHandle() const { return m_hInstance; }
 		inline gk2::Window* getMainWindow() const { return m_mainWindow; }
 
+		//Offline shader build stage: compiles all shaders listed in the manifest into the shader cache.
+		//Returns number of shaders which failed to compile.
+		static int PrecompileShaders(const std::wstring& manifestFile);
+
+		//Called before Run. Records the time steps, input and seeds of rand() of every frame to the file.
+		void RecordInput(const std::string& fileName);
+		//Called before Run. Runs the frames of a recorded file instead of reading the devices and the clock, with
+		//a fixed time step if it's positive, and quits after the last one.
+		void ReplayInput(const std::string& fileName, float fixedDt = 0.0f);
+
 	protected:
 		bool Initialize();
 		int MainLoop();
@@ -38,7 +52,9 @@ namespace gk2
 		D3D_FEATURE_LEVEL m_featureLevel;
 
 		gk2::DeviceHelper m_device;
-		std::shared_ptr<ID3D11DeviceContext> m_context;
+		//Immediate context behind the state filter
+		std::shared_ptr<gk2::RenderContext> m_context;
+		std::shared_ptr<gk2::StateFilteringContext> m_stateFilter;
 		std::shared_ptr<IDXGISwapChain> m_swapChain;
 		std::shared_ptr<ID3D11Texture2D> m_backBufferTexture;
 		std::shared_ptr<ID3D11RenderTargetView> m_backBuffer;
@@ -51,12 +67,25 @@ namespace gk2
 	private:
 		HINSTANCE m_hInstance;
 		gk2::Window* m_mainWindow;
+		gk2::InputCapture m_capture;
+		//F12 was held in the last frame
+		bool m_traceKeyDown;
 
 		void FillSwapChainDesc(DXGI_SWAP_CHAIN_DESC& desc, int width, int height);
 		void CreateDeviceAndSwapChain(SIZE windowSize);
 		void CreateBackBuffers(SIZE windowSize);
 		void InitializeDirectInput();
 		void SetViewPort(SIZE windowSize);
+		void ReportStateStatistics();
+		//Writes the trace of the last frames to profile.json when F12 is pressed
+		//Records or replays the frame, returns false when the replay is over
+		bool CaptureFrame(float& dt);
+		void ExportProfile();
+		void ReportProfile();
+		void ReportResources();
+		//Called by the destructor once the members of the application are gone, so that every device resource
+		//still alive is reported as a leak
+		void CheckResourceLeaks();
 	};
 }
 
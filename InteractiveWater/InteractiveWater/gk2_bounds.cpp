@@ -0,0 +1,80 @@
+#include "gk2_bounds.h"
+#include <cfloat>
+
+using namespace std;
+using namespace gk2;
+
+namespace
+{
+	inline const XMFLOAT3& PointAt(const XMFLOAT3* points, unsigned int i, unsigned int stride)
+	{
+		return *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const BYTE*>(points) + i * stride);
+	}
+}
+
+BoundingBox BoundingBox::FromPoints(const XMFLOAT3* points, unsigned int count, unsigned int stride)
+{
+	if (!points || !count)
+		return BoundingBox();
+	XMVECTOR vMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR vMax = XMVectorReplicate(-FLT_MAX);
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		XMVECTOR p = XMLoadFloat3(&PointAt(points, i, stride));
+		vMin = XMVectorMin(vMin, p);
+		vMax = XMVectorMax(vMax, p);
+	}
+	BoundingBox box;
+	XMStoreFloat3(&box.Center, (vMin + vMax) * 0.5f);
+	XMStoreFloat3(&box.Extents, (vMax - vMin) * 0.5f);
+	return box;
+}
+
+BoundingBox BoundingBox::Transform(const XMMATRIX& mtx) const
+{
+	XMVECTOR c = XMVector3TransformCoord(XMLoadFloat3(&Center), mtx);
+	XMVECTOR e = XMLoadFloat3(&Extents);
+	XMVECTOR ex = XMVectorAbs(mtx.r[0]) * XMVectorSplatX(e);
+	XMVECTOR ey = XMVectorAbs(mtx.r[1]) * XMVectorSplatY(e);
+	XMVECTOR ez = XMVectorAbs(mtx.r[2]) * XMVectorSplatZ(e);
+	BoundingBox box;
+	XMStoreFloat3(&box.Center, c);
+	XMStoreFloat3(&box.Extents, ex + ey + ez);
+	return box;
+}
+
+BoundingBox BoundingBox::Merge(const BoundingBox& b1, const BoundingBox& b2)
+{
+	XMVECTOR c1 = XMLoadFloat3(&b1.Center), e1 = XMLoadFloat3(&b1.Extents);
+	XMVECTOR c2 = XMLoadFloat3(&b2.Center), e2 = XMLoadFloat3(&b2.Extents);
+	XMVECTOR vMin = XMVectorMin(c1 - e1, c2 - e2);
+	XMVECTOR vMax = XMVectorMax(c1 + e1, c2 + e2);
+	BoundingBox box;
+	XMStoreFloat3(&box.Center, (vMin + vMax) * 0.5f);
+	XMStoreFloat3(&box.Extents, (vMax - vMin) * 0.5f);
+	return box;
+}
+
+BoundingSphere BoundingSphere::FromPoints(const XMFLOAT3* points, unsigned int count, unsigned int stride,
+										  const BoundingBox& box)
+{
+	XMVECTOR c = XMLoadFloat3(&box.Center);
+	XMVECTOR maxDistSq = XMVectorZero();
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		XMVECTOR p = XMLoadFloat3(&PointAt(points, i, stride));
+		maxDistSq = XMVectorMax(maxDistSq, XMVector3LengthSq(p - c));
+	}
+	return BoundingSphere(box.Center, sqrtf(XMVectorGetX(maxDistSq)));
+}
+
+BoundingSphere BoundingSphere::Transform(const XMMATRIX& mtx) const
+{
+	XMVECTOR c = XMVector3TransformCoord(XMLoadFloat3(&Center), mtx);
+	XMVECTOR scaleSq = XMVectorMax(XMVector3LengthSq(mtx.r[0]),
+					   XMVectorMax(XMVector3LengthSq(mtx.r[1]), XMVector3LengthSq(mtx.r[2])));
+	BoundingSphere sphere;
+	XMStoreFloat3(&sphere.Center, c);
+	sphere.Radius = Radius * sqrtf(XMVectorGetX(scaleSq));
+	return sphere;
+}
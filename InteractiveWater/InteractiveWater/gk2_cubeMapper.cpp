@@ -7,7 +7,7 @@ const wstring CubeMapper::ShaderFile = L"resources/shaders/CubeMapShader.hlsl";
 const int CubeMapper::TEXTURE_SIZE = 256;
 
 CubeMapper::CubeMapper(DeviceHelper& device, shared_ptr<ID3D11InputLayout>& layout,
-	const shared_ptr<ID3D11DeviceContext>& context, float nearPlane, float farPlane, XMFLOAT3 pos)
+	const shared_ptr<RenderContext>& context, float nearPlane, float farPlane, XMFLOAT3 pos)
 	: EffectBase(context)
 {
 	Initialize(device, layout, ShaderFile);
@@ -48,7 +48,7 @@ void CubeMapper::InitializeTextures(DeviceHelper& device)
 	m_envTextureView = device.CreateShaderResourceView(m_envTexture, srvDesc);
 }
 
-void CubeMapper::SetupFace(const shared_ptr<ID3D11DeviceContext>& context, D3D11_TEXTURECUBE_FACE face)
+void CubeMapper::SetupFace(const shared_ptr<RenderContext>& context, D3D11_TEXTURECUBE_FACE face)
 {
 	if (context != nullptr && context != m_context)
 		m_context = context;
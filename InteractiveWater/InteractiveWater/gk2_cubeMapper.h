@@ -14,14 +14,16 @@ namespace gk2
 	{
 	public:
 		CubeMapper(gk2::DeviceHelper& device, std::shared_ptr<ID3D11InputLayout>& layout,
-						  const std::shared_ptr<ID3D11DeviceContext>& context, float nearP, float farP, XMFLOAT3 pos);
+						  const std::shared_ptr<gk2::RenderContext>& context, float nearP, float farP, XMFLOAT3 pos);
 		
 		void SetSamplerState(const std::shared_ptr<ID3D11SamplerState>& samplerState);
 		void SetCameraPosBuffer(const std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4>>& cameraPos);
 		void SetSurfaceColorBuffer(const std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4>>& surfaceColor);
 
-		void SetupFace(const std::shared_ptr<ID3D11DeviceContext>& context, D3D11_TEXTURECUBE_FACE face);
+		void SetupFace(const std::shared_ptr<gk2::RenderContext>& context, D3D11_TEXTURECUBE_FACE face);
 		void EndFace();
+		const XMFLOAT4& getPosition() const { return m_position; }
+		float getFarPlane() const { return m_farPlane; }
 		
 	protected:
 		virtual void SetVertexShaderData();
@@ -2,9 +2,61 @@
 #include "gk2_utils.h"
 #include "gk2_exceptions.h"
 #include <cassert>
+#include <cstring>
+#include <list>
+#include <map>
 using namespace std;
 using namespace gk2;
 
+namespace
+{
+	wstring Directory(const wstring& file)
+	{
+		size_t separator = file.find_last_of(L"/\\");
+		return separator == wstring::npos ? wstring() : file.substr(0, separator + 1);
+	}
+
+	//Opens included files relative to the including file and records their paths
+	class ShaderIncludeHandler : public ID3DInclude
+	{
+	public:
+		ShaderIncludeHandler(const wstring& file) : m_directory(Directory(file)) { }
+
+		STDMETHOD(Open)(D3D_INCLUDE_TYPE includeType, LPCSTR fileName, LPCVOID parentData, LPCVOID* data, UINT* bytes)
+		{
+			UNREFERENCED_PARAMETER(includeType);
+			auto parent = m_paths.find(parentData);
+			wstring path = (parent != m_paths.end() ? Directory(parent->second) : m_directory) +
+						   wstring(fileName, fileName + strlen(fileName));
+			m_contents.push_back(vector<BYTE>());
+			vector<BYTE>& contents = m_contents.back();
+			if (!AssetCache::ReadFile(path, contents))
+			{
+				m_contents.pop_back();
+				return E_FAIL;
+			}
+			//Terminating zero keeps buffers of empty files distinct from the null pointer of the main file
+			contents.push_back(0);
+			m_paths[contents.data()] = path;
+			m_includes.push_back(path);
+			*data = contents.data();
+			*bytes = static_cast<UINT>(contents.size() - 1);
+			return S_OK;
+		}
+
+		//Buffers are released together with the handler
+		STDMETHOD(Close)(LPCVOID data) { UNREFERENCED_PARAMETER(data); return S_OK; }
+
+		const vector<wstring>& getIncludes() const { return m_includes; }
+
+	private:
+		wstring m_directory;
+		list<vector<BYTE>> m_contents;
+		map<LPCVOID, wstring> m_paths;
+		vector<wstring> m_includes;
+	};
+}
+
 
 DeviceHelper::DeviceHelper(const shared_ptr<ID3D11Device>& deviceObject)
 	: m_deviceObject(deviceObject)
@@ -13,7 +65,8 @@ DeviceHelper::DeviceHelper(const shared_ptr<ID3D11Device>& deviceObject)
 }
 
 DeviceHelper::DeviceHelper(const DeviceHelper& right)
-	: m_deviceObject(right.m_deviceObject)
+	: m_deviceObject(right.m_deviceObject), m_shaderCache(right.m_shaderCache),
+	  m_resourceTracker(right.m_resourceTracker)
 {
 
 }
@@ -21,19 +74,115 @@ DeviceHelper::DeviceHelper(const DeviceHelper& right)
 DeviceHelper& DeviceHelper::operator = (const DeviceHelper& right)
 {
 	m_deviceObject = right.m_deviceObject;
+	m_shaderCache = right.m_shaderCache;
+	m_resourceTracker = right.m_resourceTracker;
 	return *this;
 }
 
+DeviceHelper::ResourceScope::ResourceScope(DeviceHelper& device, const string& category,
+										   const string& name /* = string() */)
+	: m_device(device), m_previousCategory(device.m_category), m_previousName(device.m_name)
+{
+	m_device.m_category = category;
+	m_device.m_name = name;
+}
+
+DeviceHelper::ResourceScope::~ResourceScope()
+{
+	m_device.m_category = m_previousCategory;
+	m_device.m_name = m_previousName;
+}
+
+template<typename T>
+shared_ptr<T> DeviceHelper::Track(T* object, const char* kind, unsigned long long bytes)
+{
+	if (!m_resourceTracker)
+		return shared_ptr<T>(object, Utils::COMRelease);
+	unsigned long long id = m_resourceTracker->Add(m_category.empty() ? kind : m_category, m_name, kind, bytes);
+	return shared_ptr<T>(object, ResourceTracker::Release(m_resourceTracker, id));
+}
+
+unsigned long long DeviceHelper::ViewedBytes(ID3D11View* view)
+{
+	ID3D11Resource* r;
+	view->GetResource(&r);
+	shared_ptr<ID3D11Resource> resource(r, Utils::COMRelease);
+	D3D11_RESOURCE_DIMENSION dimension;
+	resource->GetType(&dimension);
+	if (dimension == D3D11_RESOURCE_DIMENSION_BUFFER)
+	{
+		D3D11_BUFFER_DESC desc;
+		static_cast<ID3D11Buffer*>(r)->GetDesc(&desc);
+		return desc.ByteWidth;
+	}
+	if (dimension != D3D11_RESOURCE_DIMENSION_TEXTURE2D)
+		return 0;
+	D3D11_TEXTURE2D_DESC desc;
+	static_cast<ID3D11Texture2D*>(r)->GetDesc(&desc);
+	return ResourceTracker::Texture2DBytes(desc);
+}
+
 shared_ptr<ID3DBlob> DeviceHelper::CompileD3DShader(const wstring& filePath, const string& entry, const string& shaderModel)
 {
 	assert(m_deviceObject);
+	if (m_shaderCache)
+	{
+		ShaderDesc desc;
+		desc.File = filePath;
+		desc.Entry = entry;
+		desc.Model = shaderModel;
+		vector<BYTE> byteCode = m_shaderCache->Get(desc);
+		ID3DBlob* b;
+		HRESULT result = D3DCreateBlob(byteCode.size(), &b);
+		shared_ptr<ID3DBlob> buffer(b, Utils::COMRelease);
+		if (FAILED(result))
+			THROW_DX11(result);
+		memcpy(buffer->GetBufferPointer(), byteCode.data(), byteCode.size());
+		return buffer;
+	}
+	DWORD shaderFlags = ShaderCompileFlags();
+	ID3DBlob* eb = nullptr, *b = nullptr;
+	HRESULT result = D3DX11CompileFromFileW(filePath.c_str(), 0, 0, entry.c_str(), shaderModel.c_str(), shaderFlags,
+		0, 0, &b, &eb, 0);
+	shared_ptr<ID3DBlob> errorBuffer(eb, Utils::COMRelease);
+	shared_ptr<ID3DBlob> buffer(b, Utils::COMRelease);
+	if (FAILED(result))
+	{
+		if (errorBuffer)
+		{
+			char* msg = reinterpret_cast<char*>(errorBuffer->GetBufferPointer());
+			OutputDebugStringA(msg);
+		}
+		THROW_DX11(result);
+	}
+	return buffer;
+}
+
+unsigned int DeviceHelper::ShaderCompileFlags()
+{
 	DWORD shaderFlags = D3DCOMPILE_ENABLE_STRICTNESS;
 #if defined( DEBUG ) || defined( _DEBUG )
 	shaderFlags |= D3DCOMPILE_DEBUG;
 #endif
+	return shaderFlags;
+}
+
+void DeviceHelper::CompileShader(const ShaderDesc& desc, const vector<BYTE>& source, vector<BYTE>& byteCode,
+								 vector<wstring>& includes)
+{
+	vector<D3D_SHADER_MACRO> defines;
+	for (auto it = desc.Defines.begin(); it != desc.Defines.end(); ++it)
+	{
+		D3D_SHADER_MACRO define = { it->first.c_str(), it->second.c_str() };
+		defines.push_back(define);
+	}
+	D3D_SHADER_MACRO end = { nullptr, nullptr };
+	defines.push_back(end);
+	ShaderIncludeHandler includeHandler(desc.File);
+	string sourceName(desc.File.begin(), desc.File.end());
 	ID3DBlob* eb = nullptr, *b = nullptr;
-	HRESULT result = D3DX11CompileFromFileW(filePath.c_str(), 0, 0, entry.c_str(), shaderModel.c_str(), shaderFlags,
-		0, 0, &b, &eb, 0);
+	HRESULT result = D3DCompile(source.data(), source.size(), sourceName.c_str(), defines.data(), &includeHandler,
+								desc.Entry.c_str(), desc.Model.c_str(), ShaderCompileFlags(), 0, &b, &eb);
 	shared_ptr<ID3DBlob> errorBuffer(eb, Utils::COMRelease);
 	shared_ptr<ID3DBlob> buffer(b, Utils::COMRelease);
 	if (FAILED(result))
@@ -45,7 +194,9 @@ shared_ptr<ID3DBlob> DeviceHelper::CompileD3DShader(const wstring& filePath, con
 		}
 		THROW_DX11(result);
 	}
-	return buffer;
+	const BYTE* data = reinterpret_cast<const BYTE*>(buffer->GetBufferPointer());
+	byteCode.assign(data, data + buffer->GetBufferSize());
+	includes = includeHandler.getIncludes();
 }
 
 shared_ptr<ID3D11VertexShader> DeviceHelper::CreateVertexShader(shared_ptr<ID3DBlob> byteCode)
@@ -106,10 +257,9 @@ shared_ptr<ID3D11Buffer> DeviceHelper::CreateBuffer(const D3D11_BUFFER_DESC& des
 	data.pSysMem = pData;
 	ID3D11Buffer* b;
 	HRESULT result = m_deviceObject->CreateBuffer(&desc, pData?&data:nullptr, &b);
-	shared_ptr<ID3D11Buffer> buffer(b, Utils::COMRelease);
 	if (FAILED(result))
 		THROW_DX11(result);
-	return buffer;
+	return Track(b, "Buffer", desc.ByteWidth);
 }
 
 shared_ptr<ID3D11Buffer> DeviceHelper::_CreateBufferInternal(const void* pData, unsigned int byteWidth,
@@ -148,10 +298,16 @@ shared_ptr<ID3D11Texture2D> DeviceHelper::CreateTexture2D(const D3D11_TEXTURE2D_
 	assert(m_deviceObject);
 	ID3D11Texture2D* t;
 	HRESULT result = m_deviceObject->CreateTexture2D(&desc, nullptr, &t);
-	shared_ptr<ID3D11Texture2D> texture(t, Utils::COMRelease);
 	if (FAILED(result))
 		THROW_DX11(result);
-	return texture;
+	return Track(t, "Texture2D", ResourceTracker::Texture2DBytes(desc));
+}
+
+shared_ptr<ID3D11Texture2D> DeviceHelper::AdoptTexture2D(ID3D11Texture2D* texture)
+{
+	D3D11_TEXTURE2D_DESC desc;
+	texture->GetDesc(&desc);
+	return Track(texture, "Texture2D", ResourceTracker::Texture2DBytes(desc));
 }
 
 D3D11_SHADER_RESOURCE_VIEW_DESC DeviceHelper::DefaultShaderResourceDesc()
@@ -181,20 +337,21 @@ shared_ptr<ID3D11ShaderResourceView> DeviceHelper::CreateShaderResourceView(cons
 	assert(m_deviceObject);
 	ID3D11ShaderResourceView* rv;
 	HRESULT result = m_deviceObject->CreateShaderResourceView(texture.get(), d, &rv);
-	shared_ptr<ID3D11ShaderResourceView> resourceView(rv, Utils::COMRelease);
 	if (FAILED(result))
 		THROW_DX11(result);
-	return resourceView;
+	//Memory belongs to the texture
+	return Track(rv, "ShaderResourceView", 0);
 }
 shared_ptr<ID3D11ShaderResourceView> DeviceHelper::CreateShaderResourceView(const wstring& fileName)
 {
 	assert(m_deviceObject);
+	ResourceScope scope(*this, m_category, m_name.empty() ? string(fileName.begin(), fileName.end()) : m_name);
 	ID3D11ShaderResourceView* rv;
 	HRESULT result = D3DX11CreateShaderResourceViewFromFileW(m_deviceObject.get(), fileName.c_str(), 0, 0, &rv, 0);
-	shared_ptr<ID3D11ShaderResourceView> resourceView(rv, Utils::COMRelease);
 	if (FAILED(result))
 		THROW_DX11(result);
-	return resourceView;
+	//Texture loaded with the view is accounted to it
+	return Track(rv, "ShaderResourceView", ViewedBytes(rv));
 }
 
 D3D11_SAMPLER_DESC DeviceHelper::DefaultSamplerDesc()
@@ -245,10 +402,9 @@ shared_ptr<ID3D11Texture2D> DeviceHelper::CreateDepthStencilTexture(SIZE size)
 	desc.MiscFlags = 0;
 	ID3D11Texture2D* dst;
 	HRESULT result = m_deviceObject->CreateTexture2D(&desc, nullptr, &dst);
-	shared_ptr<ID3D11Texture2D> depthStencilTexture(dst, Utils::COMRelease);
 	if (FAILED(result))
 		THROW_DX11(result);
-	return depthStencilTexture;
+	return Track(dst, "Texture2D", ResourceTracker::Texture2DBytes(desc));
 }
 
 shared_ptr<ID3D11RenderTargetView> DeviceHelper::CreateRenderTargetView(shared_ptr<ID3D11Texture2D> backBufferTexture)
@@ -256,10 +412,9 @@ shared_ptr<ID3D11RenderTargetView> DeviceHelper::CreateRenderTargetView(shared_p
 	assert(m_deviceObject);
 	ID3D11RenderTargetView* bb;
 	HRESULT result = m_deviceObject->CreateRenderTargetView(backBufferTexture.get(), 0, &bb);
-	shared_ptr<ID3D11RenderTargetView> backBuffer(bb, Utils::COMRelease);
 	if (FAILED(result))
 		THROW_DX11(result);
-	return backBuffer;
+	return Track(bb, "RenderTargetView", 0);
 }
 
 D3D11_DEPTH_STENCIL_VIEW_DESC DeviceHelper::DefaultDepthStencilViewDesc()
@@ -290,10 +445,9 @@ shared_ptr<ID3D11DepthStencilView> DeviceHelper::CreateDepthStencilView(shared_p
 	assert(m_deviceObject);
 	ID3D11DepthStencilView* dsv;
 	HRESULT result = m_deviceObject->CreateDepthStencilView(depthStencilTexture.get(), desc, &dsv);
-	shared_ptr<ID3D11DepthStencilView> depthStencilView(dsv, Utils::COMRelease);
 	if (FAILED(result))
 		THROW_DX11(result);
-	return depthStencilView;
+	return Track(dsv, "DepthStencilView", 0);
 }
 
 D3D11_DEPTH_STENCIL_DESC DeviceHelper::DefaultDepthStencilDesc()
@@ -4,7 +4,7 @@
 using namespace std;
 using namespace gk2;
 
-EffectBase::EffectBase(shared_ptr<ID3D11DeviceContext> context /* = nullptr */)
+EffectBase::EffectBase(shared_ptr<RenderContext> context /* = nullptr */)
 	: m_context(context)
 {
 }
@@ -28,7 +28,7 @@ void EffectBase::SetProjMtxBuffer(const shared_ptr<CBMatrix>& proj)
 }
 
 
-void EffectBase::Begin(std::shared_ptr<ID3D11DeviceContext> context /* = nullptr */)
+void EffectBase::Begin(std::shared_ptr<RenderContext> context /* = nullptr */)
 {
 	if (context != nullptr && context != m_context)
 		m_context = context;
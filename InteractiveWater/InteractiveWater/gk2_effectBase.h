@@ -16,11 +16,11 @@ namespace gk2
 		void SetViewMtxBuffer(const std::shared_ptr<gk2::CBMatrix>& view);
 		void SetProjMtxBuffer(const std::shared_ptr<gk2::CBMatrix>& proj);
 
-		void Begin(std::shared_ptr<ID3D11DeviceContext> context = nullptr);
+		void Begin(std::shared_ptr<gk2::RenderContext> context = nullptr);
 		void End();
 
 	protected:
-		EffectBase(std::shared_ptr<ID3D11DeviceContext> context = nullptr);
+		EffectBase(std::shared_ptr<gk2::RenderContext> context = nullptr);
 
 		virtual void SetVertexShaderData() = 0;
 		virtual void SetPixelShaderData() = 0;
@@ -28,7 +28,7 @@ namespace gk2
 		std::shared_ptr<gk2::CBMatrix> m_worldCB;
 		std::shared_ptr<gk2::CBMatrix> m_viewCB;
 		std::shared_ptr<gk2::CBMatrix> m_projCB;
-		std::shared_ptr<ID3D11DeviceContext> m_context;
+		std::shared_ptr<gk2::RenderContext> m_context;
 
 		virtual void Initialize(gk2::DeviceHelper& device, std::shared_ptr<ID3D11InputLayout>& layout,
 						const std::wstring& shaderFile);
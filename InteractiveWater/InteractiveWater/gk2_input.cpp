@@ -5,11 +5,21 @@ using namespace gk2;
 
 bool Keyboard::GetState(KeyboardState& state)
 {
+	if (m_held)
+	{
+		state = m_heldState;
+		return m_heldValid;
+	}
 	return DeviceBase::GetState(KeyboardState::STATE_TAB_LENGTH*sizeof(BYTE), reinterpret_cast<void*>(&state.m_keys));
 }
 
 bool Mouse::GetState(MouseState& state)
 {
+	if (m_held)
+	{
+		state = m_heldState;
+		return m_heldValid;
+	}
 	return DeviceBase::GetState(sizeof(DIMOUSESTATE), reinterpret_cast<void*>(&state.m_state));
 }
 
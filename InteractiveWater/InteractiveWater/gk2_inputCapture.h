@@ -0,0 +1,71 @@
+#ifndef __GK2_INPUT_CAPTURE_H_
+#define __GK2_INPUT_CAPTURE_H_
+
+#include "gk2_inputState.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace gk2
+{
+	//Log of what the frames of a run depend on besides the scene: time steps, keyboard and mouse states and seeds
+	//of rand(). Replaying a recorded log feeds the same frames back, so benchmark runs do the same work.
+	class InputCapture
+	{
+	public:
+		enum Mode
+		{
+			MODE_OFF,
+			MODE_RECORD,
+			MODE_REPLAY
+		};
+
+		struct Frame
+		{
+			//Seconds
+			float Dt;
+			//Passed to srand before the frame is updated
+			unsigned int Seed;
+			bool KeyboardValid;
+			KeyboardState Keyboard;
+			bool MouseValid;
+			MouseState Mouse;
+		};
+
+		InputCapture();
+
+		Mode getMode() const { return m_mode; }
+		//Seed of rand() while the content is loaded
+		unsigned int getInitialSeed() const { return m_initialSeed; }
+		//Frames recorded or replayed so far
+		unsigned int getFramesCount() const { return m_framesCount; }
+
+		//Creates the log, frames are appended to it until Stop
+		void StartRecording(const std::string& fileName, unsigned int initialSeed);
+		//Reads the whole log. If fixedDt is positive it replaces the recorded time steps.
+		void StartReplay(const std::string& fileName, float fixedDt = 0.0f);
+		void Stop();
+
+		void RecordFrame(const Frame& frame);
+		//Returns false after the last frame of the log
+		bool ReplayFrame(Frame& frame);
+
+		//Keyboard is stored as the codes of the pressed keys, the mouse only if its state could be read
+		static void WriteFrame(std::ostream& s, const Frame& frame);
+		//Returns false at the end of the stream
+		static bool ReadFrame(std::istream& s, Frame& frame);
+
+	private:
+		static const char MAGIC[4];
+
+		Mode m_mode;
+		unsigned int m_initialSeed;
+		float m_fixedDt;
+		unsigned int m_framesCount;
+		std::string m_fileName;
+		std::ofstream m_log;
+		std::vector<Frame> m_frames;
+	};
+}
+
+#endif __GK2_INPUT_CAPTURE_H_
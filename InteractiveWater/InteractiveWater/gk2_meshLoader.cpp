@@ -75,8 +75,7 @@ Mesh MeshLoader::GetSphere(int stacks, int slices, float radius /* = 0.5f */)
 	indices[k++] = (i + 1)*slices;
 	indices[k++] = i*slices + 1;
 	indices[k++] = n - 1;
-	return Mesh(m_device.CreateVertexBuffer(vertices), sizeof(VertexPosNormal),
-		m_device.CreateIndexBuffer(indices), in);
+	return CreateMesh(vertices, indices);
 }
 
 Mesh MeshLoader::GetCylinder(int stacks, int slices, float radius /* = 0.5f */, float height /* = 1.0f */)
@@ -134,8 +133,7 @@ Mesh MeshLoader::GetCylinder(int stacks, int slices, float radius /* = 0.5f */,
 		indices[k++] = (i + 1)*slices;
 		indices[k++] = (i + 1)*slices + j;
 	}
-	return Mesh(m_device.CreateVertexBuffer(vertices), sizeof(VertexPosNormal),
-		m_device.CreateIndexBuffer(indices), in);
+	return CreateMesh(vertices, indices);
 }
 
 Mesh MeshLoader::GetBox(float side /* = 1.0f */)
@@ -188,8 +186,7 @@ Mesh MeshLoader::GetBox(float side /* = 1.0f */)
 		16, 17, 18, 16, 18, 19,	//Right face
 		20, 21, 22, 20, 22, 23	//Top face
 	};
-	return Mesh(m_device.CreateVertexBuffer(vertices, 24), sizeof(VertexPosNormal),
-		m_device.CreateIndexBuffer(indices, 36), 36);
+	return CreateMesh(vertices, 24, indices, 36);
 }
 
 Mesh MeshLoader::GetQuad(float side /* = 1.0f */)
@@ -203,8 +200,7 @@ Mesh MeshLoader::GetQuad(float side /* = 1.0f */)
 		{ XMFLOAT3(side, -side, 0.0f), XMFLOAT3(0.0f, 0.0f, -1.0f) }
 	};
 	unsigned short indices[] = { 0, 1, 2, 0, 2, 3 };
-	return Mesh(m_device.CreateVertexBuffer(vertices, 4), sizeof(VertexPosNormal),
-		m_device.CreateIndexBuffer(indices, 6), 6);
+	return CreateMesh(vertices, 4, indices, 6);
 }
 
 Mesh MeshLoader::GetCircle(int resolution, float radius)
@@ -223,8 +219,7 @@ Mesh MeshLoader::GetCircle(int resolution, float radius)
 		indices[i * 2] = i % resolution;
 		indices[i * 2 + 1] = (i + 1) % resolution;
 	}
-	return Mesh(m_device.CreateVertexBuffer(vertices), sizeof(VertexPosNormal),
-		m_device.CreateIndexBuffer(indices), resolution * 2);
+	return CreateMesh(vertices, indices);
 }
 
 Mesh MeshLoader::GetQuad(float width, float height)
@@ -239,8 +234,7 @@ Mesh MeshLoader::GetQuad(float width, float height)
 		{ XMFLOAT3(width, -height, 0.0f), XMFLOAT3(0.0f, 0.0f, -1.0f) }
 	};
 	unsigned short indices[] = { 0, 1, 2, 0, 2, 3, 0, 2, 1, 0, 3, 2 };
-	return Mesh(m_device.CreateVertexBuffer(vertices, 4), sizeof(VertexPosNormal),
-		m_device.CreateIndexBuffer(indices, 12), 12);
+	return CreateMesh(vertices, 4, indices, 12);
 }
 
 Mesh MeshLoader::GetRim(int slices, float radius /* = 0.5f */)
@@ -282,8 +276,7 @@ Mesh MeshLoader::GetRim(int slices, float radius /* = 0.5f */)
 	indices[k++] = 2 * n - 1;
 	indices[k++] = n;
 	indices[k++] = 0;
-	return Mesh(m_device.CreateVertexBuffer(vertices), sizeof(VertexPosNormal),
-		m_device.CreateIndexBuffer(indices), in);
+	return CreateMesh(vertices, indices);
 }
 
 Mesh MeshLoader::GetDisc(int slices, float radius /* = 0.5f */)
@@ -314,8 +307,7 @@ Mesh MeshLoader::GetDisc(int slices, float radius /* = 0.5f */)
 	indices[k++] = 0;
 	indices[k++] = 1;
 	indices[k++] = slices;
-	return Mesh(m_device.CreateVertexBuffer(vertices), sizeof(VertexPosNormal),
-		m_device.CreateIndexBuffer(indices), in);
+	return CreateMesh(vertices, indices);
 }
 
 Mesh MeshLoader::LoadMesh(const wstring& fileName)
@@ -340,8 +332,7 @@ Mesh MeshLoader::LoadMesh(const wstring& fileName)
 	for (int i = 0; i < in; ++i)
 		input >> indices[i];
 	input.close();
-	return Mesh(m_device.CreateVertexBuffer(vertices), sizeof(VertexPosNormal),
-		m_device.CreateIndexBuffer(indices), in);
+	return CreateMesh(vertices, indices);
 }
 
 Mesh MeshLoader::LoadMeshForDuck(const wstring& fileName)
@@ -367,8 +358,7 @@ Mesh MeshLoader::LoadMeshForDuck(const wstring& fileName)
 	for (int i = 0; i < in; i+=3)
 		input >> indices[i] >> indices[i+1] >> indices[i + 2];
 	input.close();
-	return Mesh(m_device.CreateVertexBuffer(vertices), sizeof(VertexPosNormalCoord),
-		m_device.CreateIndexBuffer(indices), in);
+	return CreateMesh(vertices, indices);
 }
 
 
@@ -481,10 +471,9 @@ Mesh MeshLoader::LoadMeshForPuma(const wstring& fileName, Mesh& shadowVolume, XM
 		volumeIndices[iInc++] = 3 * i + 3;
 		volumeIndices[iInc++] = 3 * i + 1;
 	}
-	shadowVolume = Mesh(m_device.CreateVertexBuffer(volumeVertices), sizeof(VertexPosNormal), m_device.CreateIndexBuffer(volumeIndices),
-		volumeIndices.size());
+	shadowVolume = CreateMesh(volumeVertices, volumeIndices);
 
 	input.close();
 
-	return Mesh(m_device.CreateVertexBuffer(diff_vertices), sizeof(VertexPosNormal), m_device.CreateIndexBuffer(indices), trianglesCount * 3);
+	return CreateMesh(diff_vertices, indices);
 }
@@ -4,6 +4,7 @@
 #include "gk2_deviceHelper.h"
 #include "gk2_mesh.h"
 #include <string>
+#include <vector>
 
 namespace gk2
 {
@@ -28,6 +29,25 @@ namespace gk2
 
 	private:
 		gk2::DeviceHelper m_device;
+
+		template<typename T>
+		gk2::Mesh CreateMesh(const T* vertices, unsigned int verticesCount,
+							 const unsigned short* indices, unsigned int indicesCount)
+		{
+			gk2::Mesh mesh(m_device.CreateVertexBuffer(vertices, verticesCount), sizeof(T),
+						   m_device.CreateIndexBuffer(indices, indicesCount), indicesCount);
+			const XMFLOAT3* positions = verticesCount ? &vertices[0].Pos : nullptr;
+			gk2::BoundingBox box = gk2::BoundingBox::FromPoints(positions, verticesCount, sizeof(T));
+			mesh.setLocalBounds(box, gk2::BoundingSphere::FromPoints(positions, verticesCount, sizeof(T), box));
+			return mesh;
+		}
+
+		template<typename T>
+		gk2::Mesh CreateMesh(const std::vector<T>& vertices, const std::vector<unsigned short>& indices)
+		{
+			return CreateMesh(vertices.data(), static_cast<unsigned int>(vertices.size()),
+							  indices.data(), static_cast<unsigned int>(indices.size()));
+		}
 	};
 }
 
@@ -9,7 +9,7 @@ namespace gk2
 	{
 	public:
 		MultiTexEffect(gk2::DeviceHelper& device, std::shared_ptr<ID3D11InputLayout>& layout,
-					  std::shared_ptr<ID3D11DeviceContext> context = nullptr);
+					  std::shared_ptr<gk2::RenderContext> context = nullptr);
 
 		void Set1stTextureMtxBuffer(const std::shared_ptr<gk2::CBMatrix>& textureMtx);
 		void Set2ndTextureMtxBuffer(const std::shared_ptr<gk2::CBMatrix>& textureMtx);
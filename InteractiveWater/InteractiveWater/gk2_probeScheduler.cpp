@@ -0,0 +1,145 @@
+#include "gk2_probeScheduler.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace gk2;
+
+namespace
+{
+	bool Equal(const BoundingBox& a, const BoundingBox& b)
+	{
+		return a.Center.x == b.Center.x && a.Center.y == b.Center.y && a.Center.z == b.Center.z &&
+			   a.Extents.x == b.Extents.x && a.Extents.y == b.Extents.y && a.Extents.z == b.Extents.z;
+	}
+}
+
+ProbeScheduler::ProbeScheduler(const XMFLOAT3& position, float farPlane, const Settings& settings)
+	: m_position(position), m_farPlane(farPlane), m_settings(settings), m_nextStale(0), m_sinceStale(0),
+	  m_sinceAnimated(0)
+{
+	Statistics zero = { };
+	m_lastFrame = m_total = zero;
+	Invalidate();
+	for (unsigned int f = 0; f < FACES_COUNT; ++f)
+	{
+		m_faces[f].Rendered = false;
+		m_faces[f].Age = 0;
+	}
+}
+
+unsigned int ProbeScheduler::FacesMask(const XMFLOAT3& position, float farPlane, const BoundingBox& box)
+{
+	float d[3] = { box.Center.x - position.x, box.Center.y - position.y, box.Center.z - position.z };
+	float e[3] = { box.Extents.x, box.Extents.y, box.Extents.z };
+	unsigned int mask = 0;
+	for (unsigned int f = 0; f < FACES_COUNT; ++f)
+	{
+		unsigned int a = f / 2;
+		unsigned int u = (a + 1) % 3;
+		unsigned int v = (a + 2) % 3;
+		//Box's range along the face's direction
+		float center = f % 2 ? -d[a] : d[a];
+		if (center + e[a] < 0.0f || center - e[a] > farPlane)
+			continue;
+		//Side planes of a 90 degree frustum are |x_u| <= x_a and |x_v| <= x_a
+		if (center + e[a] + e[u] < fabs(d[u]) || center + e[a] + e[v] < fabs(d[v]))
+			continue;
+		mask |= 1u << f;
+	}
+	return mask;
+}
+
+unsigned int ProbeScheduler::AddObject(const BoundingBox& bounds, bool animated /* = false */)
+{
+	Object o;
+	o.Bounds = bounds;
+	o.Animated = animated;
+	m_objects.push_back(o);
+	MarkDirty(FacesMask(m_position, m_farPlane, bounds));
+	return static_cast<unsigned int>(m_objects.size() - 1);
+}
+
+void ProbeScheduler::UpdateObject(unsigned int object, const BoundingBox& bounds)
+{
+	Object& o = m_objects[object];
+	if (Equal(o.Bounds, bounds))
+		return;
+	unsigned int before = FacesMask(m_position, m_farPlane, o.Bounds);
+	unsigned int after = FacesMask(m_position, m_farPlane, bounds);
+	MarkDirty(o.Animated ? before ^ after : before | after);
+	o.Bounds = bounds;
+}
+
+void ProbeScheduler::TouchObject(unsigned int object)
+{
+	MarkDirty(FacesMask(m_position, m_farPlane, m_objects[object].Bounds));
+}
+
+void ProbeScheduler::Invalidate()
+{
+	MarkDirty((1u << FACES_COUNT) - 1);
+}
+
+void ProbeScheduler::MarkDirty(unsigned int mask)
+{
+	for (unsigned int f = 0; f < FACES_COUNT; ++f)
+		if (mask & (1u << f))
+			m_faces[f].Dirty = true;
+}
+
+const vector<unsigned int>& ProbeScheduler::Schedule()
+{
+	if (m_settings.AnimatedInterval > 0 && ++m_sinceAnimated >= m_settings.AnimatedInterval)
+	{
+		for (auto it = m_objects.begin(); it != m_objects.end(); ++it)
+			if (it->Animated)
+				MarkDirty(FacesMask(m_position, m_farPlane, it->Bounds));
+		m_sinceAnimated = 0;
+	}
+	m_scheduled.clear();
+	vector<unsigned int> dirty;
+	for (unsigned int f = 0; f < FACES_COUNT; ++f)
+		if (!m_faces[f].Rendered)
+			m_scheduled.push_back(f);
+		else if (m_faces[f].Dirty)
+			dirty.push_back(f);
+	stable_sort(dirty.begin(), dirty.end(), [this](unsigned int a, unsigned int b)
+		{ return m_faces[a].Age > m_faces[b].Age; });
+	unsigned int deferred = 0;
+	for (auto it = dirty.begin(); it != dirty.end(); ++it)
+		if (m_scheduled.size() < m_settings.FaceBudget)
+			m_scheduled.push_back(*it);
+		else
+			++deferred;
+	m_lastFrame.Deferred = deferred;
+	++m_sinceStale;
+	if (m_settings.StaleInterval > 0 && m_sinceStale >= m_settings.StaleInterval &&
+		m_scheduled.size() < m_settings.FaceBudget)
+	{
+		//The next face in turn which isn't refreshed anyway
+		for (unsigned int i = 0; i < FACES_COUNT; ++i)
+		{
+			unsigned int f = (m_nextStale + i) % FACES_COUNT;
+			if (find(m_scheduled.begin(), m_scheduled.end(), f) == m_scheduled.end())
+			{
+				m_scheduled.push_back(f);
+				m_nextStale = (f + 1) % FACES_COUNT;
+				break;
+			}
+		}
+		m_sinceStale = 0;
+	}
+	for (unsigned int f = 0; f < FACES_COUNT; ++f)
+		++m_faces[f].Age;
+	for (auto it = m_scheduled.begin(); it != m_scheduled.end(); ++it)
+	{
+		m_faces[*it].Dirty = false;
+		m_faces[*it].Rendered = true;
+		m_faces[*it].Age = 0;
+	}
+	m_lastFrame.Refreshed = static_cast<unsigned int>(m_scheduled.size());
+	m_total.Refreshed += m_lastFrame.Refreshed;
+	m_total.Deferred += m_lastFrame.Deferred;
+	return m_scheduled;
+}
@@ -0,0 +1,92 @@
+#ifndef __GK2_PROBE_SCHEDULER_H_
+#define __GK2_PROBE_SCHEDULER_H_
+
+#include <vector>
+#include "gk2_bounds.h"
+
+namespace gk2
+{
+	//Decides which faces of a cube map rendered around a point need to be refreshed in a frame. A face gets
+	//dirty when a dynamic object moves in or out of its frustum. At most FaceBudget faces are refreshed per
+	//frame, the dirty ones which waited longest first. Every StaleInterval frames one more face is refreshed
+	//in turn even if it's clean, so that changes the scheduler doesn't know about show up eventually.
+	//Animated objects, like particles, change every frame without moving. The faces seeing them only get dirty
+	//every AnimatedInterval frames, or at once when the object's bounds reach another face. Faces which were
+	//never rendered have undefined contents, so the first Schedule returns all of them whatever the budget.
+	class ProbeScheduler
+	{
+	public:
+		static const unsigned int FACES_COUNT = 6;
+
+		struct Settings
+		{
+			unsigned int FaceBudget;
+			//0 disables refreshing clean faces
+			unsigned int StaleInterval;
+			//0 leaves the faces seeing animated objects as they are until the objects move to other faces
+			unsigned int AnimatedInterval;
+		};
+
+		struct Statistics
+		{
+			unsigned int Refreshed;
+			//Dirty faces left for the next frames because of the budget
+			unsigned int Deferred;
+		};
+
+		//Faces are in D3D11_TEXTURECUBE_FACE order, all of them start dirty
+		ProbeScheduler(const XMFLOAT3& position, float farPlane, const Settings& settings);
+
+		//Returns the object's id
+		unsigned int AddObject(const gk2::BoundingBox& bounds, bool animated = false);
+		//Faces seeing the object before or after the move get dirty, nothing changes if the bounds are the same.
+		//For animated objects only the faces which start or stop seeing the object get dirty.
+		void UpdateObject(unsigned int object, const gk2::BoundingBox& bounds);
+		//Faces seeing the object get dirty even though its bounds didn't change, e.g. when its color changed
+		void TouchObject(unsigned int object);
+		void Invalidate();
+
+		//Chooses the faces to refresh in this frame, they are considered clean afterwards
+		const std::vector<unsigned int>& Schedule();
+		const std::vector<unsigned int>& getScheduled() const { return m_scheduled; }
+
+		bool isDirty(unsigned int face) const { return m_faces[face].Dirty; }
+		//Frames since the face was refreshed
+		unsigned int getAge(unsigned int face) const { return m_faces[face].Age; }
+		const Statistics& getLastFrameStatistics() const { return m_lastFrame; }
+		const Statistics& getTotalStatistics() const { return m_total; }
+
+		//Bit i is set if the box may be seen by the i-th face. The test is conservative.
+		static unsigned int FacesMask(const XMFLOAT3& position, float farPlane, const gk2::BoundingBox& box);
+
+	private:
+		struct Face
+		{
+			bool Dirty;
+			bool Rendered;
+			unsigned int Age;
+		};
+
+		struct Object
+		{
+			gk2::BoundingBox Bounds;
+			bool Animated;
+		};
+
+		XMFLOAT3 m_position;
+		float m_farPlane;
+		Settings m_settings;
+		Face m_faces[FACES_COUNT];
+		std::vector<Object> m_objects;
+		std::vector<unsigned int> m_scheduled;
+		unsigned int m_nextStale;
+		unsigned int m_sinceStale;
+		unsigned int m_sinceAnimated;
+		Statistics m_lastFrame;
+		Statistics m_total;
+
+		void MarkDirty(unsigned int mask);
+	};
+}
+
+#endif __GK2_PROBE_SCHEDULER_H_
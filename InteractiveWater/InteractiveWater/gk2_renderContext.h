@@ -0,0 +1,126 @@
+#ifndef __GK2_RENDER_CONTEXT_H_
+#define __GK2_RENDER_CONTEXT_H_
+
+#include <d3d11.h>
+#include <memory>
+
+namespace gk2
+{
+	//Part of the ID3D11DeviceContext interface used for rendering. Effects, meshes and constant buffers work
+	//with this interface, so calls can be filtered or recorded before they reach the device.
+	class RenderContext
+	{
+	public:
+		virtual ~RenderContext() { }
+
+		virtual void VSSetShader(ID3D11VertexShader* shader, ID3D11ClassInstance* const* classInstances,
+								 UINT classInstancesCount) = 0;
+		virtual void GSSetShader(ID3D11GeometryShader* shader, ID3D11ClassInstance* const* classInstances,
+								 UINT classInstancesCount) = 0;
+		virtual void PSSetShader(ID3D11PixelShader* shader, ID3D11ClassInstance* const* classInstances,
+								 UINT classInstancesCount) = 0;
+		virtual void HSSetShader(ID3D11HullShader* shader, ID3D11ClassInstance* const* classInstances,
+								 UINT classInstancesCount) = 0;
+		virtual void DSSetShader(ID3D11DomainShader* shader, ID3D11ClassInstance* const* classInstances,
+								 UINT classInstancesCount) = 0;
+		virtual void VSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers) = 0;
+		virtual void GSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers) = 0;
+		virtual void PSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers) = 0;
+		virtual void PSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView* const* views) = 0;
+		virtual void PSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState* const* samplers) = 0;
+		virtual void HSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers) = 0;
+		virtual void DSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers) = 0;
+		virtual void DSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView* const* views) = 0;
+		virtual void DSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState* const* samplers) = 0;
+
+		virtual void IASetInputLayout(ID3D11InputLayout* layout) = 0;
+		virtual void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) = 0;
+		virtual void IASetVertexBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* strides,
+										const UINT* offsets) = 0;
+		virtual void IASetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset) = 0;
+
+		virtual void RSSetState(ID3D11RasterizerState* state) = 0;
+		virtual void RSSetViewports(UINT count, const D3D11_VIEWPORT* viewports) = 0;
+		virtual void OMSetBlendState(ID3D11BlendState* state, const FLOAT blendFactor[4], UINT sampleMask) = 0;
+		virtual void OMSetDepthStencilState(ID3D11DepthStencilState* state, UINT stencilRef) = 0;
+		virtual void OMSetRenderTargets(UINT count, ID3D11RenderTargetView* const* views,
+										ID3D11DepthStencilView* depthStencilView) = 0;
+
+		virtual void ClearRenderTargetView(ID3D11RenderTargetView* view, const FLOAT color[4]) = 0;
+		virtual void ClearDepthStencilView(ID3D11DepthStencilView* view, UINT flags, FLOAT depth, UINT8 stencil) = 0;
+		virtual void Draw(UINT vertexCount, UINT startVertex) = 0;
+		virtual void DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex) = 0;
+		virtual void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndex,
+										  INT baseVertex, UINT startInstance) = 0;
+		virtual HRESULT Map(ID3D11Resource* resource, UINT subresource, D3D11_MAP mapType, UINT mapFlags,
+							D3D11_MAPPED_SUBRESOURCE* mappedResource) = 0;
+		virtual void Unmap(ID3D11Resource* resource, UINT subresource) = 0;
+		virtual void UpdateSubresource(ID3D11Resource* resource, UINT subresource, const D3D11_BOX* box,
+									   const void* data, UINT rowPitch, UINT depthPitch) = 0;
+		virtual void CopySubresourceRegion(ID3D11Resource* destination, UINT destinationSubresource, UINT x, UINT y,
+										   UINT z, ID3D11Resource* source, UINT sourceSubresource,
+										   const D3D11_BOX* sourceBox) = 0;
+	};
+
+	//Passes all the calls to the device context
+	class DeviceContext : public gk2::RenderContext
+	{
+	public:
+		explicit DeviceContext(const std::shared_ptr<gk2::RenderContext>& context);
+
+		const std::shared_ptr<gk2::RenderContext>& getContextObject() const { return m_contextObject; }
+
+		virtual void VSSetShader(ID3D11VertexShader* shader, ID3D11ClassInstance* const* classInstances,
+								 UINT classInstancesCount);
+		virtual void GSSetShader(ID3D11GeometryShader* shader, ID3D11ClassInstance* const* classInstances,
+								 UINT classInstancesCount);
+		virtual void PSSetShader(ID3D11PixelShader* shader, ID3D11ClassInstance* const* classInstances,
+								 UINT classInstancesCount);
+		virtual void HSSetShader(ID3D11HullShader* shader, ID3D11ClassInstance* const* classInstances,
+								 UINT classInstancesCount);
+		virtual void DSSetShader(ID3D11DomainShader* shader, ID3D11ClassInstance* const* classInstances,
+								 UINT classInstancesCount);
+		virtual void VSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers);
+		virtual void GSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers);
+		virtual void PSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers);
+		virtual void PSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView* const* views);
+		virtual void PSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState* const* samplers);
+		virtual void HSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers);
+		virtual void DSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers);
+		virtual void DSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView* const* views);
+		virtual void DSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState* const* samplers);
+
+		virtual void IASetInputLayout(ID3D11InputLayout* layout);
+		virtual void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+		virtual void IASetVertexBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* strides,
+										const UINT* offsets);
+		virtual void IASetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset);
+
+		virtual void RSSetState(ID3D11RasterizerState* state);
+		virtual void RSSetViewports(UINT count, const D3D11_VIEWPORT* viewports);
+		virtual void OMSetBlendState(ID3D11BlendState* state, const FLOAT blendFactor[4], UINT sampleMask);
+		virtual void OMSetDepthStencilState(ID3D11DepthStencilState* state, UINT stencilRef);
+		virtual void OMSetRenderTargets(UINT count, ID3D11RenderTargetView* const* views,
+										ID3D11DepthStencilView* depthStencilView);
+
+		virtual void ClearRenderTargetView(ID3D11RenderTargetView* view, const FLOAT color[4]);
+		virtual void ClearDepthStencilView(ID3D11DepthStencilView* view, UINT flags, FLOAT depth, UINT8 stencil);
+		virtual void Draw(UINT vertexCount, UINT startVertex);
+		virtual void DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex);
+		virtual void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndex,
+										  INT baseVertex, UINT startInstance);
+		virtual HRESULT Map(ID3D11Resource* resource, UINT subresource, D3D11_MAP mapType, UINT mapFlags,
+							D3D11_MAPPED_SUBRESOURCE* mappedResource);
+		virtual void Unmap(ID3D11Resource* resource, UINT subresource);
+		virtual void UpdateSubresource(ID3D11Resource* resource, UINT subresource, const D3D11_BOX* box,
+									   const void* data, UINT rowPitch, UINT depthPitch);
+		virtual void CopySubresourceRegion(ID3D11Resource* destination, UINT destinationSubresource, UINT x, UINT y,
+										   UINT z, ID3D11Resource* source, UINT sourceSubresource,
+										   const D3D11_BOX* sourceBox);
+
+	private:
+		std::shared_ptr<gk2::RenderContext> m_contextObject;
+	};
+}
+
+#endif __GK2_RENDER_CONTEXT_H_
@@ -0,0 +1,117 @@
+#ifndef __GK2_RESOURCE_TRACKER_H_
+#define __GK2_RESOURCE_TRACKER_H_
+
+#include <d3d11.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace gk2
+{
+	//Accounts the memory of the device resources created by DeviceHelper. Every resource is attributed to
+	//a category and a debug name, the tracker keeps the live counts and bytes of the categories, their high-water
+	//marks and what was created and released during the last frame. Resources remove themselves when their last
+	//reference is released. Thread safe.
+	class ResourceTracker
+	{
+	public:
+		struct Resource
+		{
+			std::string Category;
+			std::string Name;
+			//Type of the object, e.g. Buffer or Texture2D
+			std::string Kind;
+			unsigned long long Bytes;
+			//Frame in which it was created
+			unsigned int Frame;
+		};
+
+		struct CategoryStatistics
+		{
+			std::string Category;
+			unsigned int Count;
+			unsigned long long Bytes;
+			unsigned int PeakCount;
+			unsigned long long PeakBytes;
+			//Resources created since the start
+			unsigned int Created;
+		};
+
+		struct FrameStatistics
+		{
+			unsigned int Created;
+			unsigned int Released;
+			unsigned long long AllocatedBytes;
+			unsigned long long ReleasedBytes;
+
+			long long getDelta() const
+			{
+				return static_cast<long long>(AllocatedBytes) - static_cast<long long>(ReleasedBytes);
+			}
+		};
+
+		//Deleter of the shared pointers to tracked COM objects
+		class Release
+		{
+		public:
+			Release(const std::shared_ptr<ResourceTracker>& tracker, unsigned long long id)
+				: m_tracker(tracker), m_id(id)
+			{ }
+
+			void operator()(IUnknown* object) const;
+
+		private:
+			std::shared_ptr<ResourceTracker> m_tracker;
+			unsigned long long m_id;
+		};
+
+		ResourceTracker();
+
+		//Returns the id which removes the resource
+		unsigned long long Add(const std::string& category, const std::string& name, const std::string& kind,
+							   unsigned long long bytes);
+		void Remove(unsigned long long id);
+		//Starts a new frame, the statistics of the finished one are returned by getLastFrame
+		void EndFrame();
+
+		unsigned int getFrame() const;
+		FrameStatistics getLastFrame() const;
+		unsigned int getLiveCount() const;
+		unsigned long long getLiveBytes() const;
+		unsigned long long getPeakBytes() const;
+		//Sorted by category
+		std::vector<CategoryStatistics> GetStatistics() const;
+		//In the order of creation
+		std::vector<Resource> GetLiveResources() const;
+
+		//Table of the category statistics
+		void WriteReport(std::wostream& s) const;
+		//Lists the live resources, which are leaks once everything should have been released. Returns their count.
+		unsigned int WriteLeaks(std::wostream& s) const;
+
+		//Memory of the texture with all its mipmaps, array slices and samples
+		static unsigned long long Texture2DBytes(const D3D11_TEXTURE2D_DESC& desc);
+		//Bits per pixel, 0 for unknown formats
+		static unsigned int FormatBits(DXGI_FORMAT format);
+
+	private:
+		mutable std::mutex m_mutex;
+		unsigned long long m_nextId;
+		unsigned int m_frame;
+		std::unordered_map<unsigned long long, Resource> m_live;
+		std::map<std::string, CategoryStatistics> m_categories;
+		unsigned long long m_liveBytes;
+		unsigned long long m_peakBytes;
+		FrameStatistics m_currentFrame;
+		FrameStatistics m_lastFrame;
+
+		ResourceTracker(const ResourceTracker&);
+		ResourceTracker& operator =(const ResourceTracker&);
+	};
+}
+
+#endif __GK2_RESOURCE_TRACKER_H_
@@ -1,11 +1,13 @@
 #include "gk2_room.h"
 #include "gk2_window.h"
+#include <sstream>
 
 using namespace std;
 using namespace gk2;
 
 const unsigned int Room::BS_MASK = 0xffffffff;
 const XMFLOAT4 Room::LIGHT_POS = XMFLOAT4(-5.0f, 5.0f, -5.0f, 1.0f);
+const ProbeScheduler::Settings Room::PROBE_SETTINGS = { 3, 10, 6 };
 
 Room::Room(HINSTANCE hInstance)
 	: ApplicationBase(hInstance), m_camera(0.01f, 100.0f), angle(0.0f)
@@ -18,16 +20,6 @@ Room::~Room()
 
 }
 
-void* Room::operator new(size_t size)
-{
-	return Utils::New16Aligned(size);
-}
-
-void Room::operator delete(void* ptr)
-{
-	Utils::Delete16Aligned(ptr);
-}
-
 void Room::InitializeConstantBuffers()
 {
 	m_projCB.reset(new CBMatrix(m_device));
@@ -153,7 +145,7 @@ XMFLOAT3 Room::GetDuckPosition(float t)
 {
 	int knotsDivider = 5;
 	float knotsDivision = 1.0 / knotsDivider;
-	vector<double> knots(8);
+	FrameVector<double> knots(8);
 	knots[0] = 0;
 	for (int i = 1; i < 7; i++)
 		knots[i] = (i - 1) * knotsDivision;
@@ -178,7 +170,7 @@ XMFLOAT3 Room::Cross(XMFLOAT3 a, XMFLOAT3 b)
 	return XMFLOAT3(cross.x / length, cross.y / length, cross.z / length);
 }
 
-double Room::CalculateZeroSplineValue(vector<double> knots, int i, double t)
+double Room::CalculateZeroSplineValue(const FrameVector<double>& knots, int i, double t)
 {
 	double result = 0.0;
 	if (i <= 0 || i >= knots.size()) return result;
@@ -187,7 +179,7 @@ double Room::CalculateZeroSplineValue(vector<double> knots, int i, double t)
 	return result;
 }
 
-double Room::CalculateNSplineValue(vector<double> knots, int i, int n, double t)
+double Room::CalculateNSplineValue(const FrameVector<double>& knots, int i, int n, double t)
 {
 	if (n == 0)
 		return CalculateZeroSplineValue(knots, i, t);
@@ -294,12 +286,24 @@ bool Room::LoadContent()
 	m_cubeMapper->SetCameraPosBuffer(m_cameraPosCB);
 	m_cubeMapper->SetSurfaceColorBuffer(m_surfaceColorCB);
 
+	const XMFLOAT4& probe = m_cubeMapper->getPosition();
+	m_probeScheduler.reset(new ProbeScheduler(XMFLOAT3(probe.x, probe.y, probe.z), m_cubeMapper->getFarPlane(),
+											  PROBE_SETTINGS));
+	m_duckProbeObject = m_probeScheduler->AddObject(m_duck.getWorldBox());
+	//Waves change the water every frame without moving it, it's refreshed at the scheduler's lower rate
+	m_probeScheduler->AddObject(m_water.getWorldBox(), true);
+
 	return true;
 }
 
 void Room::UnloadContent()
 {
-
+	if (m_probeScheduler == nullptr)
+		return;
+	const ProbeScheduler::Statistics& probe = m_probeScheduler->getTotalStatistics();
+	wostringstream report;
+	report << L"Cube map faces refreshed: " << probe.Refreshed << L", deferred: " << probe.Deferred << endl;
+	OutputDebugStringW(report.str().c_str());
 }
 
 void Room::UpdateCamera()
@@ -375,13 +379,20 @@ void Room::Update(float dt)
 
 	UpdateDuck(dt);
 	UpdateWater(dt);
+	UpdateProbeScheduler();
+}
+
+void Room::UpdateProbeScheduler()
+{
+	m_probeScheduler->UpdateObject(m_duckProbeObject, m_duck.getWorldBox());
 }
 
 void Room::UpdateWater(float dt)
 {
+	PROFILE_ZONE("UpdateWater");
 	if (rand() % 10 != 0) return;
-	shared_ptr<FLOAT> tempData(new FLOAT[N * N], Utils::DeleteArray<FLOAT>);
-	FLOAT *tD = tempData.get();
+	FrameArena& arena = FrameArena::getThreadArena();
+	FLOAT *tD = arena.AllocateArray<FLOAT>(N * N);
 	FLOAT *cHA = currentHeightsArray.get();
 	FLOAT *pHA = previousHeightsArray.get();
 	FLOAT *sA = suppressionsArray.get();
@@ -418,8 +429,7 @@ void Room::UpdateWater(float dt)
 		}
 	}
 
-	shared_ptr<BYTE> normals(new BYTE[N * N * 4], Utils::DeleteArray<BYTE>);
-	BYTE *n = normals.get();
+	BYTE *n = arena.AllocateArray<BYTE>(N * N * 4);
 
 	for (int i = 0; i < N; ++i)
 	{
@@ -434,7 +444,8 @@ void Room::UpdateWater(float dt)
 		}
 	}
 
-	m_context->UpdateSubresource(m_renderTexture.get(), 0, 0, normals.get(), N * 4, N * N * 4);
+	m_context->UpdateSubresource(m_renderTexture.get(), 0, 0, n, N * 4, N * N * 4);
+	DeviceHelper::ResourceScope scope(m_device, "Water", "Normal map view");
 	m_waterTexture = m_device.CreateShaderResourceView(m_renderTexture);
 }
 
@@ -500,15 +511,15 @@ void Room::Render()
 	if (m_context == nullptr)
 		return;
 
-	//auto mapper = m_cubeMapper.get();
-
-	//for (size_t i = 0; i < 6; i++)
-	//{
-	//	mapper->SetupFace(m_context, (D3D11_TEXTURECUBE_FACE)i);
-
-	//	DrawScene();
-	//	mapper->EndFace();
-	//}
+	auto mapper = m_cubeMapper.get();
+	//Only the faces whose contents changed are rendered, the others keep the previous frames' image
+	const vector<unsigned int>& faces = m_probeScheduler->Schedule();
+	for (auto it = faces.begin(); it != faces.end(); ++it)
+	{
+		mapper->SetupFace(m_context, (D3D11_TEXTURECUBE_FACE)*it);
+		DrawScene();
+		mapper->EndFace();
+	}
 
 	ResetRenderTarget();
 	m_projCB->Update(m_context, m_projMtx);
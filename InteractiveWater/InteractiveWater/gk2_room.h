@@ -10,18 +10,17 @@
 #include "gk2_colorTexEffect.h"
 #include "gk2_multiTexEffect.h"
 #include "gk2_cubeMapper.h"
+#include "gk2_probeScheduler.h"
+#include "gk2_aligned.h"
 
 namespace gk2
 {
-	class Room : public gk2::ApplicationBase
+	class Room : public gk2::ApplicationBase, public gk2::AlignedNew
 	{
 	public:
 		Room(HINSTANCE hInstance);
 		virtual ~Room();
 
-		static void* operator new(size_t size);
-		static void operator delete(void* ptr);
-
 	protected:
 		virtual bool LoadContent();
 		virtual void UnloadContent();
@@ -32,6 +31,7 @@ namespace gk2
 	private:
 		static const unsigned int BS_MASK;
 		static const XMFLOAT4 LIGHT_POS;
+		static const gk2::ProbeScheduler::Settings PROBE_SETTINGS;
 		std::vector<XMFLOAT3> deBoorsPoints;
 		XMMATRIX baseDuckMatrix;
 		float duckPositionParameter = 2.0f / 5.0f;
@@ -70,6 +70,8 @@ namespace gk2
 		std::shared_ptr<gk2::ColorTexEffect> m_colorTextureEffect;
 		std::shared_ptr<gk2::MultiTexEffect> m_multiTextureEffect;
 		std::shared_ptr<gk2::CubeMapper> m_cubeMapper;
+		std::shared_ptr<gk2::ProbeScheduler> m_probeScheduler;
+		unsigned int m_duckProbeObject;
 
 		std::shared_ptr<ID3D11InputLayout> m_layout;
 		std::shared_ptr<ID3D11ShaderResourceView> m_cubicMapTexture;
@@ -103,6 +105,7 @@ namespace gk2
 		void UpdateCamera();
 		void UpdateDuck(float dt);
 		void UpdateWater(float dt);
+		void UpdateProbeScheduler();
 
 		void DrawScene();
 		void DrawWalls();
@@ -111,8 +114,8 @@ namespace gk2
 
 		XMFLOAT3 Cross(XMFLOAT3 a, XMFLOAT3 b);
 
-		double CalculateZeroSplineValue(std::vector<double> knots, int i, double t);
-		double CalculateNSplineValue(std::vector<double> knots, int i, int n, double t);
+		double CalculateZeroSplineValue(const FrameVector<double>& knots, int i, double t);
+		double CalculateNSplineValue(const FrameVector<double>& knots, int i, int n, double t);
 		XMFLOAT3 GetDuckPosition(float t);
 	};
 }
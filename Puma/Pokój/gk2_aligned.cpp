@@ -0,0 +1,94 @@
+#include "gk2_aligned.h"
+#include <algorithm>
+#include <cstdlib>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+using namespace std;
+using namespace gk2;
+
+void* AlignedMemory::Allocate(size_t size, size_t alignment /* = DEFAULT_ALIGNMENT */)
+{
+	//Zero sized allocations still return distinct pointers
+	size = max(size, static_cast<size_t>(1));
+#ifdef _WIN32
+	void* ptr = _aligned_malloc(size, alignment);
+#else
+	void* ptr = nullptr;
+	if (posix_memalign(&ptr, max(alignment, sizeof(void*)), size) != 0)
+		ptr = nullptr;
+#endif
+	if (ptr == nullptr)
+		throw bad_alloc();
+	return ptr;
+}
+
+void AlignedMemory::Free(void* ptr)
+{
+#ifdef _WIN32
+	_aligned_free(ptr);
+#else
+	free(ptr);
+#endif
+}
+
+BlockPool::BlockPool(size_t blockSize, size_t blocksPerChunk /* = 64 */,
+					 size_t alignment /* = AlignedMemory::DEFAULT_ALIGNMENT */)
+	: m_blockSize(blockSize), m_blocksPerChunk(max(blocksPerChunk, static_cast<size_t>(1))),
+	  m_alignment(alignment), m_free(nullptr), m_used(0)
+{
+	size_t size = max(blockSize, sizeof(FreeBlock));
+	m_stride = (size + alignment - 1) & ~(alignment - 1);
+}
+
+BlockPool::~BlockPool()
+{
+	for (auto it = m_chunks.begin(); it != m_chunks.end(); ++it)
+		AlignedMemory::Free(*it);
+}
+
+void* BlockPool::Allocate()
+{
+	unique_lock<mutex> lock(m_mutex);
+	if (m_free == nullptr)
+	{
+		char* chunk = static_cast<char*>(AlignedMemory::Allocate(m_stride * m_blocksPerChunk, m_alignment));
+		m_chunks.push_back(chunk);
+		//Linked so that the blocks are handed out in the order of addresses
+		for (size_t i = m_blocksPerChunk; i > 0; --i)
+		{
+			FreeBlock* block = reinterpret_cast<FreeBlock*>(chunk + (i - 1) * m_stride);
+			block->Next = m_free;
+			m_free = block;
+		}
+	}
+	FreeBlock* block = m_free;
+	m_free = block->Next;
+	++m_used;
+	GK2_ASSERT_ALIGNED(block, m_alignment);
+	return block;
+}
+
+void BlockPool::Free(void* ptr)
+{
+	if (ptr == nullptr)
+		return;
+	unique_lock<mutex> lock(m_mutex);
+	FreeBlock* block = static_cast<FreeBlock*>(ptr);
+	block->Next = m_free;
+	m_free = block;
+	--m_used;
+}
+
+size_t BlockPool::getUsedBlocks() const
+{
+	unique_lock<mutex> lock(m_mutex);
+	return m_used;
+}
+
+size_t BlockPool::getCapacity() const
+{
+	unique_lock<mutex> lock(m_mutex);
+	return m_chunks.size() * m_blocksPerChunk;
+}
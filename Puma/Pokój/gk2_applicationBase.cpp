@@ -1,12 +1,16 @@
 #include "gk2_applicationBase.h"
 #include "gk2_window.h"
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <sstream>
 
 using namespace std;
 using namespace gk2;
 
 ApplicationBase::ApplicationBase(HINSTANCE hInstance)
 	: m_hInstance(hInstance), m_mainWindow(0), m_featureLevel(D3D_FEATURE_LEVEL_11_0),
-	  m_driverType(D3D_DRIVER_TYPE_NULL)
+	  m_driverType(D3D_DRIVER_TYPE_NULL), m_traceKeyDown(false)
 {
 
 }
@@ -14,6 +18,7 @@ ApplicationBase::ApplicationBase(HINSTANCE hInstance)
 ApplicationBase::~ApplicationBase()
 {
 	Shutdown();
+	CheckResourceLeaks();
 }
 
 bool ApplicationBase::LoadContent()
@@ -64,7 +69,10 @@ void ApplicationBase::CreateDeviceAndSwapChain(SIZE windowSize)
 			featureLevelsCout, D3D11_SDK_VERSION, &desc, &swapChain, &device, &m_featureLevel, &context);
 		m_device.setDeviceObject(shared_ptr<ID3D11Device>(device, Utils::COMRelease));
 		m_swapChain.reset(swapChain, Utils::COMRelease);
-		m_context.reset(context, Utils::COMRelease);
+		shared_ptr<ID3D11DeviceContext> deviceContext(context, Utils::COMRelease);
+		m_stateFilter.reset(context ? new StateFilteringContext(shared_ptr<RenderContext>(
+			new DeviceContext(deviceContext))) : nullptr);
+		m_context = m_stateFilter;
 		if (SUCCEEDED(result))
 		{
 			m_driverType = driverTypes[driver];
@@ -78,9 +86,10 @@ void ApplicationBase::CreateBackBuffers(SIZE windowSize)
 {
 	ID3D11Texture2D* bbt;
 	HRESULT result = m_swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), (LPVOID*)&bbt);
-	m_backBufferTexture.reset(bbt, Utils::COMRelease);
 	if (FAILED(result))
 		THROW_DX11(result);
+	DeviceHelper::ResourceScope scope(m_device, "Back buffers");
+	m_backBufferTexture = m_device.AdoptTexture2D(bbt);
 	m_backBuffer = m_device.CreateRenderTargetView(m_backBufferTexture);
 	D3D11_TEXTURE2D_DESC desc;
 	m_backBufferTexture->GetDesc(&desc);
@@ -120,9 +129,15 @@ bool ApplicationBase::Initialize()
 {
 	SIZE windowSize = getMainWindow()->getClientSize();
 	CreateDeviceAndSwapChain(windowSize);
+	m_device.setAssetCache(shared_ptr<AssetCache>(new AssetCache()));
+	m_device.setShaderCache(shared_ptr<ShaderCache>(new ShaderCache(m_device.getAssetCache(),
+		&DeviceHelper::CompileShader, DeviceHelper::ShaderCompileFlags())));
+	m_device.setResourceTracker(shared_ptr<ResourceTracker>(new ResourceTracker()));
 	CreateBackBuffers(windowSize);
 	SetViewPort(windowSize);
 	InitializeDirectInput();
+	srand(m_capture.getMode() == InputCapture::MODE_OFF ? static_cast<unsigned int>(time(0))
+														: m_capture.getInitialSeed());
 	return LoadContent();
 }
 
@@ -153,16 +168,124 @@ int ApplicationBase::MainLoop()
 				dwTimeStart = dwTimeCur;
 			t = ( dwTimeCur - dwTimeStart ) / 1000.0f;
 			dwTimeStart = dwTimeCur;
-			Update(t);
-			Render();
+			if (!CaptureFrame(t))
+			{
+				PostQuitMessage(0);
+				continue;
+			}
+			m_stateFilter->BeginFrame();
+			{
+				PROFILE_ZONE("Frame");
+				{
+					PROFILE_ZONE("Update");
+					Update(t);
+				}
+				PROFILE_ZONE("Render");
+				Render();
+			}
+			Profiler::EndFrame();
+			FrameArena::EndFrame();
+			m_device.getResourceTracker()->EndFrame();
+			ExportProfile();
 		}
 	}
+	ReportProfile();
+	ReportResources();
 	Shutdown();
 	return static_cast<int>(msg.wParam);
 }
 
+void ApplicationBase::ReportStateStatistics()
+{
+	if (!m_stateFilter)
+		return;
+	const StateFilteringContext::Statistics& total = m_stateFilter->getTotalStatistics();
+	const StateFilteringContext::Statistics& frame = m_stateFilter->getLastFrameStatistics();
+	wstringstream s;
+	s << L"State calls issued: " << total.Issued << L", filtered: " << total.Filtered << L" (last frame: "
+	  << frame.Issued << L" issued, " << frame.Filtered << L" filtered)" << endl;
+	OutputDebugStringW(s.str().c_str());
+}
+
+void ApplicationBase::RecordInput(const string& fileName)
+{
+	m_capture.StartRecording(fileName, static_cast<unsigned int>(time(0)));
+}
+
+void ApplicationBase::ReplayInput(const string& fileName, float fixedDt /* = 0.0f */)
+{
+	m_capture.StartReplay(fileName, fixedDt);
+}
+
+bool ApplicationBase::CaptureFrame(float& dt)
+{
+	InputCapture::Frame frame;
+	switch (m_capture.getMode())
+	{
+	case InputCapture::MODE_RECORD:
+		m_keyboard->Release();
+		m_mouse->Release();
+		frame.Dt = dt;
+		frame.Seed = static_cast<unsigned int>(rand());
+		frame.KeyboardValid = m_keyboard->GetState(frame.Keyboard);
+		frame.MouseValid = m_mouse->GetState(frame.Mouse);
+		m_capture.RecordFrame(frame);
+		break;
+	case InputCapture::MODE_REPLAY:
+		if (!m_capture.ReplayFrame(frame))
+			return false;
+		dt = frame.Dt;
+		break;
+	default:
+		return true;
+	}
+	//Every read of the devices during the frame gets the captured state
+	m_keyboard->Hold(frame.Keyboard, frame.KeyboardValid);
+	m_mouse->Hold(frame.Mouse, frame.MouseValid);
+	srand(frame.Seed);
+	return true;
+}
+
+void ApplicationBase::ExportProfile()
+{
+	KeyboardState state;
+	bool keyDown = m_keyboard->GetState(state) && state.isKeyDown(DIK_F12);
+	if (keyDown && !m_traceKeyDown)
+	{
+		ofstream file("profile.json");
+		Profiler::WriteChromeTrace(file);
+	}
+	m_traceKeyDown = keyDown;
+}
+
+void ApplicationBase::ReportProfile()
+{
+	wstringstream s;
+	Profiler::WriteStatistics(s);
+	FrameArena::WriteStatistics(s);
+	OutputDebugStringW(s.str().c_str());
+}
+
+void ApplicationBase::ReportResources()
+{
+	wstringstream s;
+	m_device.getResourceTracker()->WriteReport(s);
+	OutputDebugStringW(s.str().c_str());
+}
+
+void ApplicationBase::CheckResourceLeaks()
+{
+	if (!m_device.getResourceTracker())
+		return;
+	wstringstream s;
+	if (m_device.getResourceTracker()->WriteLeaks(s) > 0)
+		OutputDebugStringW(s.str().c_str());
+}
+
 void ApplicationBase::Shutdown()
 {
+	m_capture.Stop();
+	ReportStateStatistics();
 	UnloadContent();
 	m_depthStencilTexture.reset();
 	m_depthStencilView.reset();
@@ -170,6 +293,7 @@ void ApplicationBase::Shutdown()
 	m_backBufferTexture.reset();
 	m_swapChain.reset();
 	m_context.reset();
+	m_stateFilter.reset();
 	m_keyboard.reset();
 	m_mouse.reset();
 	m_input.m_inputObject.reset();
@@ -183,3 +307,30 @@ int ApplicationBase::Run(Window* w, int cmdShow)
 	m_mainWindow->Show(cmdShow);
 	return MainLoop();
 }
+
+int ApplicationBase::PrecompileShaders(const wstring& manifestFile)
+{
+	//The application has no console, the messages go to the debugger
+	wostringstream log;
+	int result;
+	try
+	{
+		ShaderCache cache(shared_ptr<AssetCache>(new AssetCache()), &DeviceHelper::CompileShader,
+						  DeviceHelper::ShaderCompileFlags());
+		vector<ShaderDesc> failed = cache.Precompile(cache.ReadManifest(manifestFile));
+		for (auto it = failed.begin(); it != failed.end(); ++it)
+			log << it->File << L": " << wstring(it->Entry.begin(), it->Entry.end()) << L" ("
+				<< wstring(it->Model.begin(), it->Model.end()) << L") failed to compile" << endl;
+		log << cache.getMisses() - failed.size() << L" shaders compiled, " << cache.getHits() << L" up to date"
+			<< endl;
+		result = static_cast<int>(failed.size());
+	}
+	catch (exception& e)
+	{
+		string s(e.what());
+		log << manifestFile << L": " << wstring(s.begin(), s.end()) << endl;
+		result = -1;
+	}
+	OutputDebugStringW(log.str().c_str());
+	return result;
+}
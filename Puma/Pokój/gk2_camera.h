@@ -18,8 +18,8 @@ namespace gk2
 		void GetViewMatrix(XMMATRIX& viewMatrix);
 		XMFLOAT4 GetPosition();
 		
-		void Camera::MoveCamera(float dx, float dy, float dz);
-		void Camera::CalculateVectors(XMVECTOR& UP, XMVECTOR& DIR, XMVECTOR& CROSS);
+		void MoveCamera(float dx, float dy, float dz);
+		void CalculateVectors(XMVECTOR& UP, XMVECTOR& DIR, XMVECTOR& CROSS);
 		int k;
 		
 	private:
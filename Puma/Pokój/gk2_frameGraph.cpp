@@ -0,0 +1,322 @@
+#include "gk2_frameGraph.h"
+#include "gk2_profiler.h"
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+
+using namespace std;
+using namespace gk2;
+
+namespace
+{
+	const unsigned int NO_PASS = 0xffffffff;
+
+	void AddUnique(vector<unsigned int>& v, unsigned int value)
+	{
+		if (find(v.begin(), v.end(), value) == v.end())
+			v.push_back(value);
+	}
+
+	wstring Widen(const string& s)
+	{
+		return wstring(s.begin(), s.end());
+	}
+}
+
+FrameGraph::FrameGraph()
+{
+}
+
+unsigned int FrameGraph::Import(const string& name)
+{
+	Resource r;
+	r.Name = name;
+	r.Imported = true;
+	r.Output = false;
+	TextureDesc desc = { };
+	r.Desc = desc;
+	r.Physical = NO_PHYSICAL;
+	r.FirstUse = r.LastUse = 0;
+	m_resources.push_back(r);
+	return static_cast<unsigned int>(m_resources.size() - 1);
+}
+
+unsigned int FrameGraph::Create(const string& name, const TextureDesc& desc)
+{
+	unsigned int id = Import(name);
+	m_resources[id].Imported = false;
+	m_resources[id].Desc = desc;
+	return id;
+}
+
+unsigned int FrameGraph::AddPass(const char* name, const function<void()>& execute)
+{
+	Pass p;
+	p.Name = name;
+	p.Execute = execute;
+	p.Culled = false;
+	m_passes.push_back(p);
+	return static_cast<unsigned int>(m_passes.size() - 1);
+}
+
+void FrameGraph::Read(unsigned int pass, unsigned int resource)
+{
+	AddUnique(m_passes[pass].Reads, resource);
+}
+
+void FrameGraph::Write(unsigned int pass, unsigned int resource)
+{
+	AddUnique(m_passes[pass].Writes, resource);
+}
+
+void FrameGraph::DependsOn(unsigned int pass, unsigned int other)
+{
+	AddUnique(m_passes[pass].Dependencies, other);
+}
+
+void FrameGraph::MarkOutput(unsigned int resource)
+{
+	m_resources[resource].Output = true;
+}
+
+void FrameGraph::Clear()
+{
+	m_resources.clear();
+	m_passes.clear();
+	m_order.clear();
+	m_physical.clear();
+	m_timeline.clear();
+}
+
+void FrameGraph::FindDependencies(vector<unsigned int>& lastWriters)
+{
+	lastWriters.assign(m_resources.size(), NO_PASS);
+	vector<vector<unsigned int>> readers(m_resources.size());
+	for (unsigned int p = 0; p < m_passes.size(); ++p)
+	{
+		Pass& pass = m_passes[p];
+		pass.Inputs.clear();
+		pass.After.clear();
+		for (auto it = pass.Reads.begin(); it != pass.Reads.end(); ++it)
+		{
+			if (lastWriters[*it] != NO_PASS)
+				AddUnique(pass.Inputs, lastWriters[*it]);
+			readers[*it].push_back(p);
+		}
+		for (auto it = pass.Writes.begin(); it != pass.Writes.end(); ++it)
+		{
+			if (lastWriters[*it] != NO_PASS)
+				AddUnique(pass.Inputs, lastWriters[*it]);
+			//Readers of the previous contents have to finish before they are overwritten
+			for (auto r = readers[*it].begin(); r != readers[*it].end(); ++r)
+				if (*r != p)
+					AddUnique(pass.After, *r);
+			readers[*it].clear();
+			lastWriters[*it] = p;
+		}
+		for (auto it = pass.Inputs.begin(); it != pass.Inputs.end(); ++it)
+			AddUnique(pass.After, *it);
+		for (auto it = pass.Dependencies.begin(); it != pass.Dependencies.end(); ++it)
+			AddUnique(pass.After, *it);
+	}
+}
+
+void FrameGraph::Cull(const vector<unsigned int>& lastWriters)
+{
+	vector<unsigned int> stack;
+	for (auto it = m_passes.begin(); it != m_passes.end(); ++it)
+		it->Culled = true;
+	for (unsigned int r = 0; r < m_resources.size(); ++r)
+		if (m_resources[r].Output && lastWriters[r] != NO_PASS && m_passes[lastWriters[r]].Culled)
+		{
+			m_passes[lastWriters[r]].Culled = false;
+			stack.push_back(lastWriters[r]);
+		}
+	while (!stack.empty())
+	{
+		unsigned int p = stack.back();
+		stack.pop_back();
+		const vector<unsigned int>& inputs = m_passes[p].Inputs;
+		for (auto it = inputs.begin(); it != inputs.end(); ++it)
+			if (m_passes[*it].Culled)
+			{
+				m_passes[*it].Culled = false;
+				stack.push_back(*it);
+			}
+	}
+}
+
+void FrameGraph::Sort()
+{
+	unsigned int passes = static_cast<unsigned int>(m_passes.size());
+	vector<unsigned int> waiting(passes, 0);
+	vector<vector<unsigned int>> followers(passes);
+	//Uses of each resource by the passes which weren't culled and haven't run yet
+	vector<unsigned int> uses(m_resources.size(), 0);
+	vector<bool> alive(m_resources.size(), false);
+	vector<unsigned int> ready;
+	for (unsigned int p = 0; p < passes; ++p)
+	{
+		const Pass& pass = m_passes[p];
+		if (pass.Culled)
+			continue;
+		for (auto it = pass.After.begin(); it != pass.After.end(); ++it)
+			if (!m_passes[*it].Culled)
+			{
+				++waiting[p];
+				followers[*it].push_back(p);
+			}
+		for (auto it = pass.Reads.begin(); it != pass.Reads.end(); ++it)
+			++uses[*it];
+		for (auto it = pass.Writes.begin(); it != pass.Writes.end(); ++it)
+			if (find(pass.Reads.begin(), pass.Reads.end(), *it) == pass.Reads.end())
+				++uses[*it];
+		if (waiting[p] == 0)
+			ready.push_back(p);
+	}
+	m_order.clear();
+	while (!ready.empty())
+	{
+		//Pass using the most alive transient textures, the earliest added one among equal
+		auto best = ready.end();
+		unsigned int bestScore = 0;
+		for (auto it = ready.begin(); it != ready.end(); ++it)
+		{
+			const Pass& pass = m_passes[*it];
+			unsigned int score = 0;
+			for (auto r = pass.Reads.begin(); r != pass.Reads.end(); ++r)
+				score += alive[*r] ? 1 : 0;
+			for (auto r = pass.Writes.begin(); r != pass.Writes.end(); ++r)
+				score += alive[*r] ? 1 : 0;
+			if (best == ready.end() || score > bestScore || (score == bestScore && *it < *best))
+			{
+				best = it;
+				bestScore = score;
+			}
+		}
+		unsigned int p = *best;
+		ready.erase(best);
+		m_order.push_back(p);
+		const Pass& pass = m_passes[p];
+		vector<unsigned int> used(pass.Reads);
+		for (auto it = pass.Writes.begin(); it != pass.Writes.end(); ++it)
+			AddUnique(used, *it);
+		for (auto it = used.begin(); it != used.end(); ++it)
+			alive[*it] = !m_resources[*it].Imported && --uses[*it] > 0;
+		for (auto it = followers[p].begin(); it != followers[p].end(); ++it)
+			if (--waiting[*it] == 0)
+				ready.push_back(*it);
+	}
+	//Passes left waiting for each other
+	unsigned int culled = static_cast<unsigned int>(count_if(m_passes.begin(), m_passes.end(),
+		[](const Pass& pass) { return pass.Culled; }));
+	if (m_order.size() + culled != passes)
+	{
+		m_order.clear();
+		throw logic_error("Passes of the frame graph depend on each other");
+	}
+}
+
+void FrameGraph::AssignPhysical()
+{
+	const unsigned int UNUSED = 0xffffffff;
+	for (auto it = m_resources.begin(); it != m_resources.end(); ++it)
+	{
+		it->Physical = NO_PHYSICAL;
+		it->FirstUse = UNUSED;
+		it->LastUse = 0;
+	}
+	for (unsigned int i = 0; i < m_order.size(); ++i)
+	{
+		const Pass& pass = m_passes[m_order[i]];
+		vector<unsigned int> used(pass.Reads);
+		used.insert(used.end(), pass.Writes.begin(), pass.Writes.end());
+		for (auto it = used.begin(); it != used.end(); ++it)
+		{
+			Resource& r = m_resources[*it];
+			r.FirstUse = min(r.FirstUse, i);
+			r.LastUse = max(r.LastUse, i);
+		}
+	}
+	vector<unsigned int> transient;
+	for (unsigned int r = 0; r < m_resources.size(); ++r)
+		if (!m_resources[r].Imported && m_resources[r].FirstUse != UNUSED)
+		{
+			//Contents of an output are used after the last pass, so its texture can't be shared in the frame
+			if (m_resources[r].Output)
+				m_resources[r].LastUse = static_cast<unsigned int>(m_order.size());
+			transient.push_back(r);
+		}
+	stable_sort(transient.begin(), transient.end(), [this](unsigned int a, unsigned int b)
+		{ return m_resources[a].FirstUse < m_resources[b].FirstUse; });
+	m_physical.clear();
+	//Position in m_order of the last use of each physical texture
+	vector<unsigned int> busyUntil;
+	for (auto it = transient.begin(); it != transient.end(); ++it)
+	{
+		Resource& r = m_resources[*it];
+		unsigned int p = 0;
+		for (; p < m_physical.size(); ++p)
+			if (m_physical[p] == r.Desc && busyUntil[p] < r.FirstUse)
+				break;
+		if (p == m_physical.size())
+		{
+			m_physical.push_back(r.Desc);
+			busyUntil.push_back(0);
+		}
+		r.Physical = p;
+		busyUntil[p] = r.LastUse;
+	}
+}
+
+void FrameGraph::Compile()
+{
+	vector<unsigned int> lastWriters;
+	FindDependencies(lastWriters);
+	Cull(lastWriters);
+	Sort();
+	AssignPhysical();
+}
+
+void FrameGraph::Execute(const Clock& clock /* = Clock() */)
+{
+	m_timeline.clear();
+	double start = clock ? clock() : 0.0;
+	for (auto it = m_order.begin(); it != m_order.end(); ++it)
+	{
+		TimelineEntry e;
+		e.Pass = *it;
+		e.Start = clock ? clock() - start : 0.0;
+		if (m_passes[*it].Execute)
+		{
+			PROFILE_ZONE(m_passes[*it].Name);
+			m_passes[*it].Execute();
+		}
+		e.Duration = clock ? clock() - start - e.Start : 0.0;
+		m_timeline.push_back(e);
+	}
+}
+
+void FrameGraph::WriteTimeline(wostream& s) const
+{
+	unsigned int culled = 0;
+	for (auto it = m_passes.begin(); it != m_passes.end(); ++it)
+		culled += it->Culled ? 1 : 0;
+	s << L"Frame graph: " << m_passes.size() - culled << L" passes, " << culled << L" culled, "
+	  << m_physical.size() << L" physical textures" << endl;
+	s << fixed << setprecision(3);
+	for (auto it = m_timeline.begin(); it != m_timeline.end(); ++it)
+		s << L"  " << setw(9) << it->Start << L" ms " << setw(9) << it->Duration << L" ms  "
+		  << Widen(m_passes[it->Pass].Name) << endl;
+	for (auto it = m_passes.begin(); it != m_passes.end(); ++it)
+		if (it->Culled)
+			s << L"  culled: " << Widen(it->Name) << endl;
+	for (unsigned int p = 0; p < m_physical.size(); ++p)
+	{
+		s << L"  texture " << p << L" (" << m_physical[p].Width << L"x" << m_physical[p].Height << L"):";
+		for (auto it = m_resources.begin(); it != m_resources.end(); ++it)
+			if (it->Physical == p)
+				s << L" " << Widen(it->Name);
+		s << endl;
+	}
+}
@@ -0,0 +1,155 @@
+#include "gk2_frustum.h"
+
+using namespace std;
+using namespace gk2;
+
+Frustum::Frustum()
+{
+	Update(XMMatrixIdentity());
+}
+
+Frustum::Frustum(const XMMATRIX& viewProj)
+{
+	Update(viewProj);
+}
+
+void Frustum::Update(const XMMATRIX& viewProj)
+{
+	//Points are transformed as row vectors (p * viewProj), so planes are built from matrix columns.
+	XMMATRIX m = XMMatrixTranspose(viewProj);
+	XMVECTOR planes[PLANES_COUNT] =
+	{
+		m.r[3] + m.r[0],	//left
+		m.r[3] - m.r[0],	//right
+		m.r[3] + m.r[1],	//bottom
+		m.r[3] - m.r[1],	//top
+		m.r[2],				//near (D3D clip space z >= 0)
+		m.r[3] - m.r[2]		//far
+	};
+	for (unsigned int i = 0; i < PLANES_COUNT; ++i)
+	{
+		XMVECTOR p = XMPlaneNormalize(planes[i]);
+		XMStoreFloat4(&m_planes[i], p);
+		XMStoreFloat4(&m_absPlanes[i], XMVectorAbs(p));
+	}
+}
+
+bool Frustum::Intersects(const BoundingBox& box) const
+{
+	XMVECTOR c = XMVectorSetW(XMLoadFloat3(&box.Center), 1.0f);
+	XMVECTOR e = XMLoadFloat3(&box.Extents);
+	for (unsigned int i = 0; i < PLANES_COUNT; ++i)
+	{
+		float d = XMVectorGetX(XMVector4Dot(XMLoadFloat4(&m_planes[i]), c));
+		float r = XMVectorGetX(XMVector3Dot(XMLoadFloat4(&m_absPlanes[i]), e));
+		if (d + r < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+Frustum::Containment Frustum::Classify(const BoundingBox& box) const
+{
+	XMVECTOR c = XMVectorSetW(XMLoadFloat3(&box.Center), 1.0f);
+	XMVECTOR e = XMLoadFloat3(&box.Extents);
+	Containment result = INSIDE;
+	for (unsigned int i = 0; i < PLANES_COUNT; ++i)
+	{
+		float d = XMVectorGetX(XMVector4Dot(XMLoadFloat4(&m_planes[i]), c));
+		float r = XMVectorGetX(XMVector3Dot(XMLoadFloat4(&m_absPlanes[i]), e));
+		if (d + r < 0.0f)
+			return OUTSIDE;
+		if (d - r < 0.0f)
+			result = INTERSECTS;
+	}
+	return result;
+}
+
+bool Frustum::Intersects(const BoundingSphere& sphere) const
+{
+	XMVECTOR c = XMVectorSetW(XMLoadFloat3(&sphere.Center), 1.0f);
+	for (unsigned int i = 0; i < PLANES_COUNT; ++i)
+		if (XMVectorGetX(XMVector4Dot(XMLoadFloat4(&m_planes[i]), c)) < -sphere.Radius)
+			return false;
+	return true;
+}
+
+unsigned int Frustum::TestBatch(FXMVECTOR cx, FXMVECTOR cy, FXMVECTOR cz,
+								CXMVECTOR ex, CXMVECTOR ey, CXMVECTOR ez) const
+{
+	//Each lane holds a different volume, so one pass over the planes tests four of them at once.
+	XMVECTOR outside = XMVectorFalseInt();
+	for (unsigned int i = 0; i < PLANES_COUNT; ++i)
+	{
+		XMVECTOR p = XMLoadFloat4(&m_planes[i]);
+		XMVECTOR a = XMLoadFloat4(&m_absPlanes[i]);
+		XMVECTOR d = XMVectorMultiplyAdd(cx, XMVectorSplatX(p),
+					 XMVectorMultiplyAdd(cy, XMVectorSplatY(p),
+					 XMVectorMultiplyAdd(cz, XMVectorSplatZ(p), XMVectorSplatW(p))));
+		XMVECTOR r = XMVectorMultiplyAdd(ex, XMVectorSplatX(a),
+					 XMVectorMultiplyAdd(ey, XMVectorSplatY(a), ez * XMVectorSplatZ(a)));
+		outside = XMVectorOrInt(outside, XMVectorLess(d + r, XMVectorZero()));
+	}
+	UINT mask[4];
+	XMStoreInt4(mask, outside);
+	return (mask[0] ? 0 : 1) | (mask[1] ? 0 : 2) | (mask[2] ? 0 : 4) | (mask[3] ? 0 : 8);
+}
+
+unsigned int Frustum::Test(const BoundingBox* boxes, unsigned int count, vector<unsigned int>& visibility) const
+{
+	visibility.assign((count + 31) / 32, 0);
+	unsigned int visible = 0;
+	for (unsigned int i = 0; i < count; i += 4)
+	{
+		const BoundingBox& b0 = boxes[i];
+		const BoundingBox& b1 = boxes[i + 1 < count ? i + 1 : i];
+		const BoundingBox& b2 = boxes[i + 2 < count ? i + 2 : i];
+		const BoundingBox& b3 = boxes[i + 3 < count ? i + 3 : i];
+		unsigned int bits = TestBatch(
+			XMVectorSet(b0.Center.x, b1.Center.x, b2.Center.x, b3.Center.x),
+			XMVectorSet(b0.Center.y, b1.Center.y, b2.Center.y, b3.Center.y),
+			XMVectorSet(b0.Center.z, b1.Center.z, b2.Center.z, b3.Center.z),
+			XMVectorSet(b0.Extents.x, b1.Extents.x, b2.Extents.x, b3.Extents.x),
+			XMVectorSet(b0.Extents.y, b1.Extents.y, b2.Extents.y, b3.Extents.y),
+			XMVectorSet(b0.Extents.z, b1.Extents.z, b2.Extents.z, b3.Extents.z));
+		if (count - i < 4)
+			bits &= (1u << (count - i)) - 1;
+		visibility[i >> 5] |= bits << (i & 31);
+		visible += ((bits >> 0) & 1) + ((bits >> 1) & 1) + ((bits >> 2) & 1) + ((bits >> 3) & 1);
+	}
+	return visible;
+}
+
+unsigned int Frustum::Test(const BoundingSphere* spheres, unsigned int count, vector<unsigned int>& visibility) const
+{
+	visibility.assign((count + 31) / 32, 0);
+	unsigned int visible = 0;
+	for (unsigned int i = 0; i < count; i += 4)
+	{
+		const BoundingSphere& s0 = spheres[i];
+		const BoundingSphere& s1 = spheres[i + 1 < count ? i + 1 : i];
+		const BoundingSphere& s2 = spheres[i + 2 < count ? i + 2 : i];
+		const BoundingSphere& s3 = spheres[i + 3 < count ? i + 3 : i];
+		XMVECTOR cx = XMVectorSet(s0.Center.x, s1.Center.x, s2.Center.x, s3.Center.x);
+		XMVECTOR cy = XMVectorSet(s0.Center.y, s1.Center.y, s2.Center.y, s3.Center.y);
+		XMVECTOR cz = XMVectorSet(s0.Center.z, s1.Center.z, s2.Center.z, s3.Center.z);
+		XMVECTOR r = XMVectorSet(-s0.Radius, -s1.Radius, -s2.Radius, -s3.Radius);
+		XMVECTOR outside = XMVectorFalseInt();
+		for (unsigned int j = 0; j < PLANES_COUNT; ++j)
+		{
+			XMVECTOR p = XMLoadFloat4(&m_planes[j]);
+			XMVECTOR d = XMVectorMultiplyAdd(cx, XMVectorSplatX(p),
+						 XMVectorMultiplyAdd(cy, XMVectorSplatY(p),
+						 XMVectorMultiplyAdd(cz, XMVectorSplatZ(p), XMVectorSplatW(p))));
+			outside = XMVectorOrInt(outside, XMVectorLess(d, r));
+		}
+		UINT mask[4];
+		XMStoreInt4(mask, outside);
+		unsigned int bits = (mask[0] ? 0 : 1) | (mask[1] ? 0 : 2) | (mask[2] ? 0 : 4) | (mask[3] ? 0 : 8);
+		if (count - i < 4)
+			bits &= (1u << (count - i)) - 1;
+		visibility[i >> 5] |= bits << (i & 31);
+		visible += ((bits >> 0) & 1) + ((bits >> 1) & 1) + ((bits >> 2) & 1) + ((bits >> 3) & 1);
+	}
+	return visible;
+}
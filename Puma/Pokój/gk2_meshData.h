@@ -0,0 +1,35 @@
+#ifndef __GK2_MESH_DATA_H_
+#define __GK2_MESH_DATA_H_
+
+#include "gk2_vertices.h"
+#include <istream>
+#include <vector>
+
+namespace gk2
+{
+	//Mesh geometry kept in system memory, before vertex and index buffers are created. The generators and
+	//parsers don't touch the device, so they run on loader threads and in the headless build.
+	struct MeshData
+	{
+		std::vector<gk2::VertexPosNormal> Vertices;
+		std::vector<unsigned short> Indices;
+
+		static MeshData Sphere(int stacks, int slices, float radius = 0.5f);
+		static MeshData Cylinder(int stacks, int slices, float radius = 0.5f, float height = 1.0f);
+		static MeshData Disc(int slices, float radius = 0.5f);
+		static MeshData Rim(int slices, float radius = 0.5f);
+		static MeshData Box(float side = 1.0f);
+		static MeshData Quad(float side = 1.0f);
+		//Two sided
+		static MeshData Quad(float width, float height);
+		//Line list
+		static MeshData Circle(int resolution, float radius);
+
+		//Mesh file with positions, normals and unused texture coordinates of the vertices
+		static void Parse(std::istream& input, MeshData& mesh);
+		//Puma mesh file, the shadow volume is extruded from the silhouette edges seen from the light
+		static void ParsePuma(std::istream& input, XMFLOAT4 lightPosition, MeshData& mesh, MeshData& shadowVolume);
+	};
+}
+
+#endif __GK2_MESH_DATA_H_
@@ -3,7 +3,10 @@
 
 #include "gk2_deviceHelper.h"
 #include "gk2_mesh.h"
+#include "gk2_vertices.h"
+#include "gk2_meshData.h"
 #include <string>
+#include <vector>
 
 namespace gk2
 {
@@ -24,9 +27,34 @@ namespace gk2
 		gk2::Mesh GetCircle(int resolution, float radius);
 		gk2::Mesh LoadMesh(const std::wstring& fileName);
 		gk2::Mesh LoadMeshForPuma(const std::wstring& fileName, Mesh& shadowVolumes, XMFLOAT4 lightPosition);
+		//Reads Puma mesh file and computes its shadow volume without touching the device,
+		//so it can be called from a loader thread. Result is looked up in and stored to the cache if given.
+		static void ParseMeshForPuma(const std::wstring& fileName, XMFLOAT4 lightPosition,
+									 gk2::MeshData& mesh, gk2::MeshData& shadowVolume,
+									 const gk2::AssetCache* cache = nullptr);
+		gk2::Mesh CreateMesh(const gk2::MeshData& data) { return CreateMesh(data.Vertices, data.Indices); }
 
 	private:
 		gk2::DeviceHelper m_device;
+
+		template<typename T>
+		gk2::Mesh CreateMesh(const T* vertices, unsigned int verticesCount,
+							 const unsigned short* indices, unsigned int indicesCount)
+		{
+			gk2::Mesh mesh(m_device.CreateVertexBuffer(vertices, verticesCount), sizeof(T),
+						   m_device.CreateIndexBuffer(indices, indicesCount), indicesCount);
+			const XMFLOAT3* positions = verticesCount ? &vertices[0].Pos : nullptr;
+			gk2::BoundingBox box = gk2::BoundingBox::FromPoints(positions, verticesCount, sizeof(T));
+			mesh.setLocalBounds(box, gk2::BoundingSphere::FromPoints(positions, verticesCount, sizeof(T), box));
+			return mesh;
+		}
+
+		template<typename T>
+		gk2::Mesh CreateMesh(const std::vector<T>& vertices, const std::vector<unsigned short>& indices)
+		{
+			return CreateMesh(vertices.data(), static_cast<unsigned int>(vertices.size()),
+							  indices.data(), static_cast<unsigned int>(indices.size()));
+		}
 	};
 }
 
@@ -0,0 +1,119 @@
+#include "gk2_particleEmitter.h"
+#include <cmath>
+#include <cstdlib>
+
+using namespace std;
+using namespace gk2;
+
+namespace
+{
+	XMFLOAT3 operator *(const XMFLOAT3& v1, float d)
+	{
+		return XMFLOAT3(v1.x * d , v1.y * d, v1.z * d);
+	}
+
+	XMFLOAT3 operator +(const XMFLOAT3& v1, const XMFLOAT3& v2)
+	{
+		return XMFLOAT3(v1.x + v2.x, v1.y + v2.y, v1.z + v2.z);
+	}
+}
+
+bool ParticleComparer::operator()(const ParticleVertex& p1, const ParticleVertex& p2)
+{
+	XMVECTOR p1Pos = XMVectorSetW(XMLoadFloat3(&(p1.Pos)), 1.0f);
+	XMVECTOR p2Pos = XMVectorSetW(XMLoadFloat3(&(p2.Pos)), 1.0f);
+	XMVECTOR camDir = XMLoadFloat4(&m_camDir);
+	XMVECTOR camPos = XMLoadFloat4(&m_camPos);
+	float d1 = XMVectorGetX(XMVector3Dot(XMVectorSubtract(p1Pos, camPos), camDir));
+	float d2 = XMVectorGetX(XMVector3Dot(XMVectorSubtract(p2Pos, camPos), camDir));
+	return d1 > d2;
+}
+
+const XMFLOAT3 ParticleEmitter::EMITTER_DIR = XMFLOAT3(sqrtf(3)/2, 0.5f, 0.0f);
+const float ParticleEmitter::TIME_TO_LIVE = 1.1f;
+const float ParticleEmitter::EMISSION_RATE = 200.0f;
+const float ParticleEmitter::MAX_ANGLE = XM_PIDIV2/2;
+const float ParticleEmitter::MIN_VELOCITY = 0.4f;
+const float ParticleEmitter::MAX_VELOCITY = 1.1f;
+const float ParticleEmitter::PARTICLE_SIZE = 0.03f;
+const float ParticleEmitter::PARTICLE_SCALE = 1.0f;
+const float ParticleEmitter::MIN_ANGLE_VEL = -XM_PI;
+const float ParticleEmitter::MAX_ANGLE_VEL = XM_PI;
+const int ParticleEmitter::MAX_PARTICLES = 600;
+
+ParticleEmitter::ParticleEmitter(XMFLOAT3 emitterPos)
+	: m_emitterPos(emitterPos), m_particlesToCreate(0.0f), m_particlesCount(0)
+{ }
+
+XMFLOAT3 ParticleEmitter::RandomVelocity()
+{
+
+	float x, y, z;
+	do 
+	{
+		x = 2.0f * static_cast<float>(rand())/RAND_MAX - 1.0f;
+		y = 2.0f * static_cast<float>(rand())/RAND_MAX - 1.0f;
+		z = 2.0f * static_cast<float>(rand())/RAND_MAX - 1.0f;
+	} while (x*x + y*y + z*z > 1.0f);
+	float a = tan(MAX_ANGLE);
+	XMFLOAT3 v(x * a + EMITTER_DIR.x, y * a + EMITTER_DIR.y, z *a + EMITTER_DIR.z);
+
+	XMVECTOR velocity = XMLoadFloat3(&v);
+	float  len = MIN_VELOCITY + (MAX_VELOCITY - MIN_VELOCITY) *
+				 static_cast<float>(rand())/static_cast<float>(RAND_MAX);
+	velocity = XMVectorScale(XMVector3Normalize(velocity), len);
+	XMStoreFloat3(&v, velocity);
+	return v;
+}
+
+void ParticleEmitter::AddNewParticle()
+{
+	Particle p;
+	p.Vertex.Pos = m_emitterPos;
+	p.Vertex.Age = 0.0f;
+	p.Vertex.Angle = 0.0f;
+	p.Vertex.Size = PARTICLE_SIZE;
+	p.Velocities.Velocity = RandomVelocity();
+	p.Velocities.AngleVelocity = 0.0f;
+	m_particles.push_back(p);
+}
+
+void ParticleEmitter::UpdateParticle(Particle& p, float dt)
+{
+	p.Vertex.Age += dt;
+	p.Velocities.Velocity = p.Velocities.Velocity + (XMFLOAT3(0.f,-.5f,0.f) * dt);
+	p.Vertex.Pos = p.Vertex.Pos + (p.Velocities.Velocity * dt);
+}
+
+void ParticleEmitter::Update(float dt, XMFLOAT3 emiterPos)
+{
+	m_emitterPos = emiterPos;
+	for (std::list<Particle>::iterator iterator = m_particles.begin(); iterator != m_particles.end(); ){
+		UpdateParticle(*iterator, dt);
+		if ((*iterator).Vertex.Age > TIME_TO_LIVE)
+		{
+			iterator = m_particles.erase(iterator);
+			m_particlesCount--;
+		}
+		else iterator++;
+	}
+
+	m_particlesToCreate += EMISSION_RATE * dt;
+
+	while ((m_particlesToCreate > 1.0f) && (m_particlesCount < MAX_PARTICLES)){
+		AddNewParticle();
+		m_particlesToCreate = m_particlesToCreate - 1;
+		m_particlesCount++;
+	}
+}
+
+unsigned int ParticleEmitter::CopyVertices(ParticleVertex* vertices) const
+{
+	unsigned int i = 0;
+	for (std::list<Particle>::const_iterator itr = m_particles.begin(); itr != m_particles.end(); itr++)
+	{ 
+		vertices[i] = (*itr).Vertex;
+		i++; 
+	} 
+	return i;
+}
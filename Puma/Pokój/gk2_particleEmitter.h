@@ -0,0 +1,85 @@
+#ifndef __GK2_PARTICLE_EMITTER_H_
+#define __GK2_PARTICLE_EMITTER_H_
+
+#include <d3d11.h>
+#include <xnamath.h>
+#include <list>
+
+namespace gk2
+{
+	struct ParticleVertex
+	{
+		XMFLOAT3 Pos;
+		float Age;
+		float Angle;
+		float Size;
+		static const unsigned int LayoutElements = 4;
+		static const D3D11_INPUT_ELEMENT_DESC Layout[LayoutElements];
+
+		ParticleVertex() : Pos(0.0f, 0.0f, 0.0f), Age(0.0f), Angle(0.0f), Size(0.0f) { }
+	};
+	
+	struct ParticleVelocities
+	{
+		XMFLOAT3 Velocity;
+		float AngleVelocity;
+
+		ParticleVelocities() : Velocity(0.0f, 0.0f, 0.0f), AngleVelocity(0.0f) { }
+	};
+
+	struct Particle
+	{
+		ParticleVertex Vertex;
+		ParticleVelocities Velocities;
+	};
+
+	class ParticleComparer
+	{
+	public:
+		ParticleComparer(XMFLOAT4 camDir, XMFLOAT4 camPos) : m_camDir(camDir), m_camPos(camPos) { }
+
+		bool operator()(const gk2::ParticleVertex& p1, const gk2::ParticleVertex& p2);
+
+	private:
+		XMFLOAT4 m_camDir, m_camPos;
+	};
+
+	//Simulation of the sparks, without the device. ParticleSystem uploads and draws them with Direct3D, the
+	//headless build draws them with the software rasterizer.
+	class ParticleEmitter
+	{
+	public:
+		static const float TIME_TO_LIVE;	//time of particle's life in seconds
+		static const int MAX_PARTICLES;		//maximal number of particles in the system
+
+		ParticleEmitter(XMFLOAT3 emitterPos);
+
+		void Update(float dt, XMFLOAT3 emiterPos);
+		unsigned int getCount() const { return m_particlesCount; }
+		//Copies the vertices of the live particles, returns their number
+		unsigned int CopyVertices(gk2::ParticleVertex* vertices) const;
+
+	private:
+		static const XMFLOAT3 EMITTER_DIR;	//mean direction of particles' velocity
+		static const float EMISSION_RATE;	//number of particles to be born per second
+		static const float MAX_ANGLE;		//maximal angle declination from mean direction
+		static const float MIN_VELOCITY;	//minimal value of particle's velocity
+		static const float MAX_VELOCITY;	//maximal value of particle's velocity
+		static const float PARTICLE_SIZE;	//initial size of a particle
+		static const float PARTICLE_SCALE;	//size += size*scale*dtime
+		static const float MIN_ANGLE_VEL;	//minimal rotation speed
+		static const float MAX_ANGLE_VEL;	//maximal rotation speed
+
+		XMFLOAT3 m_emitterPos;
+		float m_particlesToCreate;
+		unsigned int m_particlesCount;
+		
+		std::list<Particle> m_particles;
+
+		static XMFLOAT3 RandomVelocity();
+		void AddNewParticle();
+		void UpdateParticle(gk2::Particle& p, float dt);
+	};
+}
+
+#endif __GK2_PARTICLE_EMITTER_H_
@@ -7,7 +7,7 @@ using namespace gk2;
 const wstring PhongEffect::ShaderFile = L"resources/shaders/PhongShader.hlsl";
 
 PhongEffect::PhongEffect(DeviceHelper& device, shared_ptr<ID3D11InputLayout>& layout,
-						 shared_ptr<ID3D11DeviceContext> context /* = nullptr */)
+						 shared_ptr<RenderContext> context /* = nullptr */)
 	: EffectBase(context)
 {
 	Initialize(device, layout, ShaderFile);
@@ -0,0 +1,125 @@
+#include "gk2_pumaScene.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace gk2;
+
+const XMFLOAT4 PumaScene::LIGHT_POS = XMFLOAT4(-5.0f, 5.0f, -5.0f, 1.0f);
+const float PumaScene::STEEL_WIDTH = 2.0f;
+const float PumaScene::ELECTRODE_RADIUS = 0.75f;
+const float PumaScene::ELECTRODE_SPEED = 3.0f;
+
+void PumaScene::InitializeCamera(Camera& camera)
+{
+	camera.MoveCamera(25.f, 12.5f, 5.0f);
+	camera.Rotate(0.25f, 2.45f);
+	camera.Zoom(50);
+}
+
+XMMATRIX PumaScene::ProjectionMatrix(float aspectRatio)
+{
+	return XMMatrixPerspectiveFovLH(XM_PIDIV4, aspectRatio, 0.01f, 100.0f);
+}
+
+XMMATRIX PumaScene::WallMatrix(unsigned int wall)
+{
+	XMMATRIX translation = XMMatrixTranslation(0.0f, 0.0f, 5.0f);
+	XMMATRIX lift = XMMatrixTranslation(0.0f, 3.99f, 0.0f);
+	if (wall < 4)
+		return translation * XMMatrixRotationY(wall * XM_PIDIV2) * lift;
+	return translation * XMMatrixRotationX(wall == 4 ? XM_PIDIV2 : -XM_PIDIV2) * lift;
+}
+
+XMMATRIX PumaScene::CylinderMatrix()
+{
+	return XMMatrixRotationZ(XM_PIDIV2) * XMMatrixTranslation(0.0f, -0.75f, 1.5f);
+}
+
+XMMATRIX PumaScene::SunMatrix()
+{
+	return XMMatrixTranslation(LIGHT_POS.x, LIGHT_POS.y, LIGHT_POS.z);
+}
+
+XMMATRIX PumaScene::SteelSheetMatrix()
+{
+	return XMMatrixRotationY(-XM_PIDIV2) * XMMatrixRotationZ(XM_PI / 6) * XMMatrixTranslation(-1.7f, 0.0f, 0.0f);
+}
+
+XMMATRIX PumaScene::CircleMatrix()
+{
+	return XMMatrixTranslation(0.0f, 0.01f, 0.0f) * XMMatrixRotationX(-XM_PIDIV2);
+}
+
+XMMATRIX PumaScene::TextureMatrix()
+{
+	return XMMatrixScaling(0.25f, 0.25f, 1.0f) * XMMatrixTranslation(0.5f, 0.5f, 0.0f);
+}
+
+XMMATRIX PumaScene::MirrorMatrix(CXMMATRIX steelSheet)
+{
+	XMVECTOR det;
+	return XMMatrixInverse(&det, steelSheet) * XMMatrixScaling(1, 1, -1) * steelSheet;
+}
+
+void PumaScene::InverseKinematic(FXMVECTOR position, FXMVECTOR normal, float angles[JOINTS])
+{
+	float l1 = .91f, l2 = .81f, l3 = .33f, dy = .27f, dz = .26f;
+	XMVECTOR norm1 = XMVector3Normalize(normal);
+	XMVECTOR pos1 = XMVectorAdd(position, XMVectorScale(norm1, l3));
+	XMFLOAT3 pos1f;
+	XMStoreFloat3(&pos1f, pos1);
+	float e = sqrtf(pos1f.z*pos1f.z + pos1f.x*pos1f.x - dz*dz);
+	angles[0] = atan2(pos1f.z, -pos1f.x) + atan2(dz, e);
+	XMFLOAT3 pos2f = XMFLOAT3(e, pos1f.y - dy, .0f);
+	angles[2] = -acosf(min(1.0f, (pos2f.x*pos2f.x + pos2f.y*pos2f.y - l1*l1 - l2*l2) / (2.0f*l1*l2)));
+	float k = l1 + l2 * cosf(angles[2]), l = l2 * sinf(angles[2]);
+	angles[1] = -atan2(pos2f.y, sqrtf(pos2f.x*pos2f.x + pos2f.z*pos2f.z)) - atan2(l, k);
+	XMVECTOR normal1 = XMVector3Transform(norm1, XMMatrixRotationY(-angles[0]));
+	normal1 = XMVector3Transform(normal1, XMMatrixRotationZ(-(angles[1] + angles[2])));
+	XMFLOAT3 normal1f;
+	XMStoreFloat3(&normal1f, normal1);
+	angles[4] = acosf(normal1f.x);
+	angles[3] = atan2(normal1f.z, normal1f.y);
+}
+
+XMMATRIX PumaScene::JointMatrix(unsigned int joint, float angle)
+{
+	switch (joint)
+	{
+	case 0:
+		return XMMatrixRotationY(angle);
+	case 1:
+		return XMMatrixTranslation(0.0f, -0.27f, 0.0f) * XMMatrixRotationZ(angle) *
+			   XMMatrixTranslation(0.0f, 0.27f, 0.0f);
+	case 2:
+		return XMMatrixTranslation(0.91f, -0.27f, 0.0f) * XMMatrixRotationZ(angle) *
+			   XMMatrixTranslation(-0.91f, 0.27f, 0.0f);
+	case 3:
+		return XMMatrixTranslation(0.0f, -0.27f, 0.26f) * XMMatrixRotationX(angle) *
+			   XMMatrixTranslation(0.0f, 0.27f, -0.26f);
+	default:
+		return XMMatrixTranslation(1.72f, -0.27f, 0.0f) * XMMatrixRotationZ(angle) *
+			   XMMatrixTranslation(-1.72f, 0.27f, 0.0f);
+	}
+}
+
+PumaScene::PumaScene()
+	: m_electrodeAngle(0.0f), m_electrodePosition(0.0f, 0.0f, 0.0f)
+{
+	for (unsigned int i = 0; i < JOINTS; ++i)
+		m_jointAngles[i] = 0.0f;
+}
+
+void PumaScene::Update(float dt, CXMMATRIX steelSheet)
+{
+	m_electrodeAngle += ELECTRODE_SPEED * dt;
+	if (m_electrodeAngle > XM_2PI)
+		m_electrodeAngle -= XM_2PI;
+	XMVECTOR position = XMVectorSet(ELECTRODE_RADIUS * cosf(m_electrodeAngle),
+									ELECTRODE_RADIUS * sinf(m_electrodeAngle), 0.0f, 1.0f);
+	position = XMVector3Transform(position, steelSheet);
+	XMStoreFloat3(&m_electrodePosition, position);
+	XMVECTOR normal = XMVector4Transform(XMVectorSet(0.0f, 0.0f, -1.0f, 0.0f), steelSheet);
+	InverseKinematic(position, normal, m_jointAngles);
+}
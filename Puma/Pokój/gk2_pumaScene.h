@@ -0,0 +1,59 @@
+#ifndef __GK2_PUMA_SCENE_H_
+#define __GK2_PUMA_SCENE_H_
+
+#include "gk2_camera.h"
+#include <xnamath.h>
+
+namespace gk2
+{
+	//Layout of the room and the motion of the Puma arm, without the device. Room renders it with Direct3D and the
+	//headless build with the software rasterizer, both place the objects with these matrices.
+	class PumaScene
+	{
+	public:
+		static const unsigned int WALLS = 6;
+		//The first segment stands on the floor, each of the others turns around a joint
+		static const unsigned int JOINTS = 5;
+		static const XMFLOAT4 LIGHT_POS;
+		static const float STEEL_WIDTH;
+		//Radius of the electrode's path on the steel sheet
+		static const float ELECTRODE_RADIUS;
+		//Radians per second
+		static const float ELECTRODE_SPEED;
+
+		static void InitializeCamera(gk2::Camera& camera);
+		static XMMATRIX ProjectionMatrix(float aspectRatio);
+
+		static XMMATRIX WallMatrix(unsigned int wall);
+		static XMMATRIX CylinderMatrix();
+		static XMMATRIX SunMatrix();
+		static XMMATRIX SteelSheetMatrix();
+		//Relative to the steel sheet
+		static XMMATRIX CircleMatrix();
+		static XMMATRIX TextureMatrix();
+		//Reflection in the plane of the steel sheet
+		static XMMATRIX MirrorMatrix(CXMMATRIX steelSheet);
+
+		//Angles of the joints which put the electrode at the position, pointing along the normal
+		static void InverseKinematic(FXMVECTOR position, FXMVECTOR normal, float angles[JOINTS]);
+		//Local matrix of the joint's segment in the frame of the previous one
+		static XMMATRIX JointMatrix(unsigned int joint, float angle);
+
+		PumaScene();
+
+		//Moves the electrode along its circle on the steel sheet and solves the angles of the joints
+		void Update(float dt, CXMMATRIX steelSheet);
+
+		float getElectrodeAngle() const { return m_electrodeAngle; }
+		const XMFLOAT3& getElectrodePosition() const { return m_electrodePosition; }
+		float getJointAngle(unsigned int joint) const { return m_jointAngles[joint]; }
+		XMMATRIX getJointMatrix(unsigned int joint) const { return JointMatrix(joint, m_jointAngles[joint]); }
+
+	private:
+		float m_electrodeAngle;
+		XMFLOAT3 m_electrodePosition;
+		float m_jointAngles[JOINTS];
+	};
+}
+
+#endif __GK2_PUMA_SCENE_H_
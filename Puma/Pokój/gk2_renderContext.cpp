@@ -0,0 +1,182 @@
+#include "gk2_renderContext.h"
+
+using namespace std;
+using namespace gk2;
+
+DeviceContext::DeviceContext(const shared_ptr<ID3D11DeviceContext>& context)
+	: m_contextObject(context)
+{
+}
+
+void DeviceContext::VSSetShader(ID3D11VertexShader* shader, ID3D11ClassInstance* const* classInstances,
+								UINT classInstancesCount)
+{
+	m_contextObject->VSSetShader(shader, classInstances, classInstancesCount);
+}
+
+void DeviceContext::GSSetShader(ID3D11GeometryShader* shader, ID3D11ClassInstance* const* classInstances,
+								UINT classInstancesCount)
+{
+	m_contextObject->GSSetShader(shader, classInstances, classInstancesCount);
+}
+
+void DeviceContext::PSSetShader(ID3D11PixelShader* shader, ID3D11ClassInstance* const* classInstances,
+								UINT classInstancesCount)
+{
+	m_contextObject->PSSetShader(shader, classInstances, classInstancesCount);
+}
+
+void DeviceContext::HSSetShader(ID3D11HullShader* shader, ID3D11ClassInstance* const* classInstances,
+								UINT classInstancesCount)
+{
+	m_contextObject->HSSetShader(shader, classInstances, classInstancesCount);
+}
+
+void DeviceContext::DSSetShader(ID3D11DomainShader* shader, ID3D11ClassInstance* const* classInstances,
+								UINT classInstancesCount)
+{
+	m_contextObject->DSSetShader(shader, classInstances, classInstancesCount);
+}
+
+void DeviceContext::VSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers)
+{
+	m_contextObject->VSSetConstantBuffers(startSlot, count, buffers);
+}
+
+void DeviceContext::GSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers)
+{
+	m_contextObject->GSSetConstantBuffers(startSlot, count, buffers);
+}
+
+void DeviceContext::PSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers)
+{
+	m_contextObject->PSSetConstantBuffers(startSlot, count, buffers);
+}
+
+void DeviceContext::PSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView* const* views)
+{
+	m_contextObject->PSSetShaderResources(startSlot, count, views);
+}
+
+void DeviceContext::PSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState* const* samplers)
+{
+	m_contextObject->PSSetSamplers(startSlot, count, samplers);
+}
+
+void DeviceContext::HSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers)
+{
+	m_contextObject->HSSetConstantBuffers(startSlot, count, buffers);
+}
+
+void DeviceContext::DSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers)
+{
+	m_contextObject->DSSetConstantBuffers(startSlot, count, buffers);
+}
+
+void DeviceContext::DSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView* const* views)
+{
+	m_contextObject->DSSetShaderResources(startSlot, count, views);
+}
+
+void DeviceContext::DSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState* const* samplers)
+{
+	m_contextObject->DSSetSamplers(startSlot, count, samplers);
+}
+
+void DeviceContext::IASetInputLayout(ID3D11InputLayout* layout)
+{
+	m_contextObject->IASetInputLayout(layout);
+}
+
+void DeviceContext::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+	m_contextObject->IASetPrimitiveTopology(topology);
+}
+
+void DeviceContext::IASetVertexBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* strides,
+									   const UINT* offsets)
+{
+	m_contextObject->IASetVertexBuffers(startSlot, count, buffers, strides, offsets);
+}
+
+void DeviceContext::IASetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset)
+{
+	m_contextObject->IASetIndexBuffer(buffer, format, offset);
+}
+
+void DeviceContext::RSSetState(ID3D11RasterizerState* state)
+{
+	m_contextObject->RSSetState(state);
+}
+
+void DeviceContext::RSSetViewports(UINT count, const D3D11_VIEWPORT* viewports)
+{
+	m_contextObject->RSSetViewports(count, viewports);
+}
+
+void DeviceContext::OMSetBlendState(ID3D11BlendState* state, const FLOAT blendFactor[4], UINT sampleMask)
+{
+	m_contextObject->OMSetBlendState(state, blendFactor, sampleMask);
+}
+
+void DeviceContext::OMSetDepthStencilState(ID3D11DepthStencilState* state, UINT stencilRef)
+{
+	m_contextObject->OMSetDepthStencilState(state, stencilRef);
+}
+
+void DeviceContext::OMSetRenderTargets(UINT count, ID3D11RenderTargetView* const* views,
+									   ID3D11DepthStencilView* depthStencilView)
+{
+	m_contextObject->OMSetRenderTargets(count, views, depthStencilView);
+}
+
+void DeviceContext::ClearRenderTargetView(ID3D11RenderTargetView* view, const FLOAT color[4])
+{
+	m_contextObject->ClearRenderTargetView(view, color);
+}
+
+void DeviceContext::ClearDepthStencilView(ID3D11DepthStencilView* view, UINT flags, FLOAT depth, UINT8 stencil)
+{
+	m_contextObject->ClearDepthStencilView(view, flags, depth, stencil);
+}
+
+void DeviceContext::Draw(UINT vertexCount, UINT startVertex)
+{
+	m_contextObject->Draw(vertexCount, startVertex);
+}
+
+void DeviceContext::DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex)
+{
+	m_contextObject->DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+void DeviceContext::DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndex,
+										 INT baseVertex, UINT startInstance)
+{
+	m_contextObject->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+HRESULT DeviceContext::Map(ID3D11Resource* resource, UINT subresource, D3D11_MAP mapType, UINT mapFlags,
+						   D3D11_MAPPED_SUBRESOURCE* mappedResource)
+{
+	return m_contextObject->Map(resource, subresource, mapType, mapFlags, mappedResource);
+}
+
+void DeviceContext::Unmap(ID3D11Resource* resource, UINT subresource)
+{
+	m_contextObject->Unmap(resource, subresource);
+}
+
+void DeviceContext::UpdateSubresource(ID3D11Resource* resource, UINT subresource, const D3D11_BOX* box,
+									  const void* data, UINT rowPitch, UINT depthPitch)
+{
+	m_contextObject->UpdateSubresource(resource, subresource, box, data, rowPitch, depthPitch);
+}
+
+void DeviceContext::CopySubresourceRegion(ID3D11Resource* destination, UINT destinationSubresource, UINT x, UINT y,
+										  UINT z, ID3D11Resource* source, UINT sourceSubresource,
+										  const D3D11_BOX* sourceBox)
+{
+	m_contextObject->CopySubresourceRegion(destination, destinationSubresource, x, y, z, source, sourceSubresource,
+										   sourceBox);
+}
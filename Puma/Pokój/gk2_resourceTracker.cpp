@@ -0,0 +1,269 @@
+#include "gk2_resourceTracker.h"
+#include <algorithm>
+
+using namespace std;
+using namespace gk2;
+
+namespace
+{
+	bool IsBlockCompressed(DXGI_FORMAT format)
+	{
+		return (format >= DXGI_FORMAT_BC1_TYPELESS && format <= DXGI_FORMAT_BC5_SNORM) ||
+			   (format >= DXGI_FORMAT_BC6H_TYPELESS && format <= DXGI_FORMAT_BC7_UNORM_SRGB);
+	}
+}
+
+void ResourceTracker::Release::operator()(IUnknown* object) const
+{
+	m_tracker->Remove(m_id);
+	if (object != nullptr)
+		object->Release();
+}
+
+ResourceTracker::ResourceTracker()
+	: m_nextId(1), m_frame(0), m_liveBytes(0), m_peakBytes(0)
+{
+	m_currentFrame.Created = m_currentFrame.Released = 0;
+	m_currentFrame.AllocatedBytes = m_currentFrame.ReleasedBytes = 0;
+	m_lastFrame = m_currentFrame;
+}
+
+unsigned long long ResourceTracker::Add(const string& category, const string& name, const string& kind,
+										unsigned long long bytes)
+{
+	unique_lock<mutex> lock(m_mutex);
+	Resource resource;
+	resource.Category = category;
+	resource.Name = name;
+	resource.Kind = kind;
+	resource.Bytes = bytes;
+	resource.Frame = m_frame;
+	unsigned long long id = m_nextId++;
+	m_live[id] = resource;
+	auto it = m_categories.find(category);
+	if (it == m_categories.end())
+	{
+		CategoryStatistics empty = { category, 0, 0, 0, 0, 0 };
+		it = m_categories.insert(make_pair(category, empty)).first;
+	}
+	CategoryStatistics& statistics = it->second;
+	++statistics.Count;
+	++statistics.Created;
+	statistics.Bytes += bytes;
+	statistics.PeakCount = max(statistics.PeakCount, statistics.Count);
+	statistics.PeakBytes = max(statistics.PeakBytes, statistics.Bytes);
+	m_liveBytes += bytes;
+	m_peakBytes = max(m_peakBytes, m_liveBytes);
+	++m_currentFrame.Created;
+	m_currentFrame.AllocatedBytes += bytes;
+	return id;
+}
+
+void ResourceTracker::Remove(unsigned long long id)
+{
+	unique_lock<mutex> lock(m_mutex);
+	auto it = m_live.find(id);
+	if (it == m_live.end())
+		return;
+	CategoryStatistics& statistics = m_categories[it->second.Category];
+	--statistics.Count;
+	statistics.Bytes -= it->second.Bytes;
+	m_liveBytes -= it->second.Bytes;
+	++m_currentFrame.Released;
+	m_currentFrame.ReleasedBytes += it->second.Bytes;
+	m_live.erase(it);
+}
+
+void ResourceTracker::EndFrame()
+{
+	unique_lock<mutex> lock(m_mutex);
+	m_lastFrame = m_currentFrame;
+	m_currentFrame.Created = m_currentFrame.Released = 0;
+	m_currentFrame.AllocatedBytes = m_currentFrame.ReleasedBytes = 0;
+	++m_frame;
+}
+
+unsigned int ResourceTracker::getFrame() const
+{
+	unique_lock<mutex> lock(m_mutex);
+	return m_frame;
+}
+
+ResourceTracker::FrameStatistics ResourceTracker::getLastFrame() const
+{
+	unique_lock<mutex> lock(m_mutex);
+	return m_lastFrame;
+}
+
+unsigned int ResourceTracker::getLiveCount() const
+{
+	unique_lock<mutex> lock(m_mutex);
+	return static_cast<unsigned int>(m_live.size());
+}
+
+unsigned long long ResourceTracker::getLiveBytes() const
+{
+	unique_lock<mutex> lock(m_mutex);
+	return m_liveBytes;
+}
+
+unsigned long long ResourceTracker::getPeakBytes() const
+{
+	unique_lock<mutex> lock(m_mutex);
+	return m_peakBytes;
+}
+
+vector<ResourceTracker::CategoryStatistics> ResourceTracker::GetStatistics() const
+{
+	unique_lock<mutex> lock(m_mutex);
+	vector<CategoryStatistics> result;
+	for (auto it = m_categories.begin(); it != m_categories.end(); ++it)
+		result.push_back(it->second);
+	return result;
+}
+
+vector<ResourceTracker::Resource> ResourceTracker::GetLiveResources() const
+{
+	unique_lock<mutex> lock(m_mutex);
+	vector<pair<unsigned long long, Resource>> sorted(m_live.begin(), m_live.end());
+	sort(sorted.begin(), sorted.end(), [](const pair<unsigned long long, Resource>& a,
+										  const pair<unsigned long long, Resource>& b) { return a.first < b.first; });
+	vector<Resource> result;
+	for (auto it = sorted.begin(); it != sorted.end(); ++it)
+		result.push_back(it->second);
+	return result;
+}
+
+void ResourceTracker::WriteReport(wostream& s) const
+{
+	vector<CategoryStatistics> categories = GetStatistics();
+	s << L"Device resources: " << getLiveCount() << L" live, " << getLiveBytes() / 1024 << L" KB (peak "
+	  << getPeakBytes() / 1024 << L" KB)" << endl;
+	s << L"Category: count (peak), KB (peak), created" << endl;
+	for (auto it = categories.begin(); it != categories.end(); ++it)
+		s << wstring(it->Category.begin(), it->Category.end()) << L": " << it->Count << L" (" << it->PeakCount
+		  << L"), " << it->Bytes / 1024 << L" (" << it->PeakBytes / 1024 << L"), " << it->Created << endl;
+}
+
+unsigned int ResourceTracker::WriteLeaks(wostream& s) const
+{
+	vector<Resource> live = GetLiveResources();
+	for (auto it = live.begin(); it != live.end(); ++it)
+		s << L"Leaked " << wstring(it->Kind.begin(), it->Kind.end()) << L" "
+		  << wstring(it->Category.begin(), it->Category.end()) << L"/" << wstring(it->Name.begin(), it->Name.end())
+		  << L", " << it->Bytes << L" bytes, created in frame " << it->Frame << endl;
+	return static_cast<unsigned int>(live.size());
+}
+
+unsigned long long ResourceTracker::Texture2DBytes(const D3D11_TEXTURE2D_DESC& desc)
+{
+	unsigned int bits = FormatBits(desc.Format);
+	bool blocks = IsBlockCompressed(desc.Format);
+	unsigned int levels = desc.MipLevels;
+	//0 stands for the full chain
+	if (levels == 0)
+		for (unsigned int size = max(desc.Width, desc.Height); size > 0; size >>= 1)
+			++levels;
+	unsigned long long bytes = 0;
+	unsigned int width = desc.Width, height = desc.Height;
+	for (unsigned int i = 0; i < levels; ++i)
+	{
+		unsigned long long pixels = blocks ? 16ULL * max(1u, (width + 3) / 4) * max(1u, (height + 3) / 4)
+										   : static_cast<unsigned long long>(width) * height;
+		bytes += pixels * bits / 8;
+		width = max(1u, width / 2);
+		height = max(1u, height / 2);
+	}
+	return bytes * desc.ArraySize * max(1u, desc.SampleDesc.Count);
+}
+
+unsigned int ResourceTracker::FormatBits(DXGI_FORMAT format)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+	case DXGI_FORMAT_R32G32B32A32_UINT:
+	case DXGI_FORMAT_R32G32B32A32_SINT:
+		return 128;
+	case DXGI_FORMAT_R32G32B32_TYPELESS:
+	case DXGI_FORMAT_R32G32B32_FLOAT:
+	case DXGI_FORMAT_R32G32B32_UINT:
+	case DXGI_FORMAT_R32G32B32_SINT:
+		return 96;
+	case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+	case DXGI_FORMAT_R16G16B16A16_UNORM:
+	case DXGI_FORMAT_R16G16B16A16_UINT:
+	case DXGI_FORMAT_R16G16B16A16_SNORM:
+	case DXGI_FORMAT_R16G16B16A16_SINT:
+	case DXGI_FORMAT_R32G32_TYPELESS:
+	case DXGI_FORMAT_R32G32_FLOAT:
+	case DXGI_FORMAT_R32G32_UINT:
+	case DXGI_FORMAT_R32G32_SINT:
+	case DXGI_FORMAT_R32G8X24_TYPELESS:
+	case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+		return 64;
+	case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DXGI_FORMAT_R8G8B8A8_UINT:
+	case DXGI_FORMAT_R8G8B8A8_SNORM:
+	case DXGI_FORMAT_R8G8B8A8_SINT:
+	case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8X8_UNORM:
+	case DXGI_FORMAT_R10G10B10A2_UNORM:
+	case DXGI_FORMAT_R11G11B10_FLOAT:
+	case DXGI_FORMAT_R16G16_FLOAT:
+	case DXGI_FORMAT_R16G16_UNORM:
+	case DXGI_FORMAT_R32_TYPELESS:
+	case DXGI_FORMAT_R32_FLOAT:
+	case DXGI_FORMAT_R32_UINT:
+	case DXGI_FORMAT_R32_SINT:
+	case DXGI_FORMAT_D32_FLOAT:
+	case DXGI_FORMAT_R24G8_TYPELESS:
+	case DXGI_FORMAT_D24_UNORM_S8_UINT:
+	case DXGI_FORMAT_R24_UNORM_X8_TYPELESS:
+		return 32;
+	case DXGI_FORMAT_R8G8_UNORM:
+	case DXGI_FORMAT_R16_TYPELESS:
+	case DXGI_FORMAT_R16_FLOAT:
+	case DXGI_FORMAT_R16_UNORM:
+	case DXGI_FORMAT_D16_UNORM:
+	case DXGI_FORMAT_B5G6R5_UNORM:
+		return 16;
+	case DXGI_FORMAT_R8_TYPELESS:
+	case DXGI_FORMAT_R8_UNORM:
+	case DXGI_FORMAT_R8_UINT:
+	case DXGI_FORMAT_A8_UNORM:
+		return 8;
+	//Block compressed, 8 or 16 bytes per 4x4 pixels
+	case DXGI_FORMAT_BC1_TYPELESS:
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_TYPELESS:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC4_SNORM:
+		return 4;
+	case DXGI_FORMAT_BC2_TYPELESS:
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_TYPELESS:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_TYPELESS:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_TYPELESS:
+	case DXGI_FORMAT_BC6H_UF16:
+	case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_TYPELESS:
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		return 8;
+	default:
+		return 0;
+	}
+}
@@ -1,31 +1,32 @@
 #include "gk2_room.h"
 #include "gk2_window.h"
+#include <sstream>
 
 using namespace std;
 using namespace gk2;
 
 const unsigned int Room::BS_MASK = 0xffffffff;
-const XMFLOAT4 Room::LIGHT_POS = XMFLOAT4(-5.0f, 5.0f, -5.0f, 1.0f);
 
-Room::Room(HINSTANCE hInstance)
-	: ApplicationBase(hInstance), m_camera(0.01f, 100.0f), angle(0.0f)
+namespace
 {
-
+	double Milliseconds()
+	{
+		LARGE_INTEGER counter, frequency;
+		QueryPerformanceCounter(&counter);
+		QueryPerformanceFrequency(&frequency);
+		return 1000.0 * counter.QuadPart / frequency.QuadPart;
+	}
 }
 
-Room::~Room()
+Room::Room(HINSTANCE hInstance)
+	: ApplicationBase(hInstance), m_camera(0.01f, 100.0f)
 {
 
 }
 
-void* Room::operator new(size_t size)
+Room::~Room()
 {
-	return Utils::New16Aligned(size);
-}
 
-void Room::operator delete(void* ptr)
-{
-	Utils::Delete16Aligned(ptr);
 }
 
 void Room::InitializeConstantBuffers()
@@ -41,8 +42,8 @@ void Room::InitializeConstantBuffers()
 
 void Room::InitializeTextures()
 {
-	m_wallTexture = m_device.CreateShaderResourceView(L"resources/textures/stones.jpg");
-	m_sunTexture = m_device.CreateShaderResourceView(L"resources/textures/sun.jpg");
+	LoadTextureAsync(L"resources/textures/stones.jpg", m_wallTexture);
+	LoadTextureAsync(L"resources/textures/sun.jpg", m_sunTexture);
 	D3D11_SAMPLER_DESC sd = m_device.DefaultSamplerDesc();
 	sd.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
 	sd.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
@@ -50,18 +51,51 @@ void Room::InitializeTextures()
 	sd.AddressU = D3D11_TEXTURE_ADDRESS_BORDER;
 	sd.AddressV = D3D11_TEXTURE_ADDRESS_BORDER;
 	m_samplerBorder = m_device.CreateSamplerState(sd);
-	m_steelSheetTexture = m_device.CreateShaderResourceView(L"resources/textures/metal.jpg");
+	LoadTextureAsync(L"resources/textures/metal.jpg", m_steelSheetTexture);
+}
+
+void Room::LoadTextureAsync(const wstring& fileName, shared_ptr<ID3D11ShaderResourceView>& texture)
+{
+	//File is read, decoded and cooked on a loader thread, only the texture is created in Update
+	shared_ptr<AssetCache> cache = m_device.getAssetCache();
+	shared_future<vector<BYTE>> dds = m_assetLoader.Load<vector<BYTE>>([fileName, cache]()
+	{
+		return AssetLoader::CookTexture(fileName, cache.get());
+	});
+	m_assetLoader.WhenReady<vector<BYTE>>(dds, [this, &texture](const vector<BYTE>& cooked)
+	{
+		texture = m_device.CreateCookedShaderResourceView(cooked);
+	});
+}
+
+void Room::LoadPumaMeshAsync(const wstring& fileName, Mesh& mesh, Mesh& shadowVolume)
+{
+	typedef pair<MeshData, MeshData> PumaMeshData;
+	XMFLOAT4 lightPos = PumaScene::LIGHT_POS;
+	shared_ptr<AssetCache> cache = m_device.getAssetCache();
+	shared_future<PumaMeshData> data = m_assetLoader.Load<PumaMeshData>([fileName, lightPos, cache]()
+	{
+		PumaMeshData result;
+		MeshLoader::ParseMeshForPuma(fileName, lightPos, result.first, result.second, cache.get());
+		return result;
+	});
+	m_assetLoader.WhenReady<PumaMeshData>(data, [this, &mesh, &shadowVolume](const PumaMeshData& meshData)
+	{
+		XMMATRIX world = mesh.getWorldMatrix();
+		mesh = m_meshLoader.CreateMesh(meshData.first);
+		mesh.setWorldMatrix(world);
+		shadowVolume = m_meshLoader.CreateMesh(meshData.second);
+		UpdatePumaBounds(true);
+	});
 }
 
 void Room::InitializeCamera()
 {
 	SIZE s = getMainWindow()->getClientSize();
 	float ar = static_cast<float>(s.cx) / s.cy;
-	m_projMtx = XMMatrixPerspectiveFovLH(XM_PIDIV4, ar, 0.01f, 100.0f);
+	m_projMtx = PumaScene::ProjectionMatrix(ar);
 	m_projCB->Update(m_context, m_projMtx);
-	m_camera.MoveCamera(25.f, 12.5f, 5.0f);
-	m_camera.Rotate(0.25f, 2.45f);
-	m_camera.Zoom(50);
+	PumaScene::InitializeCamera(m_camera);
 	UpdateCamera();
 }
 
@@ -69,123 +103,99 @@ void Room::CreateScene()
 {
 	// walls
 	m_walls[0] = m_meshLoader.GetQuad(10.0f, 10.0f);
-	for (int i = 1; i < 6; ++i)
+	for (unsigned int i = 1; i < PumaScene::WALLS; ++i)
 		m_walls[i] = m_walls[0];
-	XMMATRIX wall = XMMatrixTranslation(0.0f, 0.0f, 5.0f);
-	XMMATRIX mWall = XMMatrixTranslation(0.0f, 3.99f, 0.0f);
-	float a = 0;
-	for (int i = 0; i < 4; ++i, a += XM_PIDIV2)
-		m_walls[i].setWorldMatrix(wall * XMMatrixRotationY(a) * mWall);
-	m_walls[4].setWorldMatrix(wall * XMMatrixRotationX(XM_PIDIV2)* mWall);
-	m_walls[5].setWorldMatrix(wall * XMMatrixRotationX(-XM_PIDIV2)* mWall);
+	for (unsigned int i = 0; i < PumaScene::WALLS; ++i)
+		m_walls[i].setWorldMatrix(PumaScene::WallMatrix(i));
 
 	// cyllinder
 	m_cylinder = m_meshLoader.GetCylinder(100, 100, 0.25f, 2.5f);
-	m_cylinder.setWorldMatrix(XMMatrixRotationZ(XM_PIDIV2) * XMMatrixTranslation(0.0f, -0.75f, 1.5f));
+	m_cylinder.setWorldMatrix(PumaScene::CylinderMatrix());
 
 	// sun
 	m_sun = m_meshLoader.GetSphere(100, 100, 0.5);
-	m_sun.setWorldMatrix(XMMatrixTranslation(LIGHT_POS.x, LIGHT_POS.y, LIGHT_POS.z));
+	m_sunNode = m_transforms.AddNode(TransformHierarchy::NONE, PumaScene::SunMatrix());
 
 	// steel sheet
-	steelWidth = 2.0f;
-	XMMATRIX steelSheetMatrix = XMMatrixRotationY(-XM_PIDIV2) * XMMatrixRotationZ(XM_PI / 6)
-		* XMMatrixTranslation(-1.7f, 0.0f, 0.0f);
-
-	m_steelSheet = m_meshLoader.GetQuad(steelWidth, steelWidth);
-	m_steelSheet.setWorldMatrix(steelSheetMatrix);
+	m_steelSheet = m_meshLoader.GetQuad(PumaScene::STEEL_WIDTH, PumaScene::STEEL_WIDTH);
+	m_steelSheetNode = m_transforms.AddNode(TransformHierarchy::NONE, PumaScene::SteelSheetMatrix());
 
-	//mirror
-	m_mirror = m_meshLoader.GetQuad(steelWidth);
-	m_mirror.setWorldMatrix(steelSheetMatrix);
-	m_mirrorMtx = XMMatrixInverse(&XMVECTOR(), steelSheetMatrix) * XMMatrixScaling(1, 1, -1) * steelSheetMatrix;
+	//mirror, placed by the steel sheet node
+	m_mirror = m_meshLoader.GetQuad(PumaScene::STEEL_WIDTH);
 
 	// Circle
-	m_circle = m_meshLoader.GetRim(100, steelWidth / 2.65);
-	m_circle.setWorldMatrix(XMMatrixTranslation(0.0f, 0.01f, 0.0f) * XMMatrixRotationX(-XM_PIDIV2) * steelSheetMatrix);
+	m_circle = m_meshLoader.GetRim(100, PumaScene::STEEL_WIDTH / 2.65f);
+	m_circleNode = m_transforms.AddNode(m_steelSheetNode, PumaScene::CircleMatrix());
 
 
 	// puma
-	m_mesh1 = m_meshLoader.LoadMeshForPuma(L"resources/meshes/mesh1.txt", m_shadowVolumes[0], LIGHT_POS);
-	m_mesh2 = m_meshLoader.LoadMeshForPuma(L"resources/meshes/mesh2.txt", m_shadowVolumes[1], LIGHT_POS);
-	m_mesh3 = m_meshLoader.LoadMeshForPuma(L"resources/meshes/mesh3.txt", m_shadowVolumes[2], LIGHT_POS);
-	m_mesh4 = m_meshLoader.LoadMeshForPuma(L"resources/meshes/mesh4.txt", m_shadowVolumes[3], LIGHT_POS);
-	m_mesh5 = m_meshLoader.LoadMeshForPuma(L"resources/meshes/mesh5.txt", m_shadowVolumes[4], LIGHT_POS);
-	m_mesh6 = m_meshLoader.LoadMeshForPuma(L"resources/meshes/mesh6.txt", m_shadowVolumes[5], LIGHT_POS);
-
-
-	m_lightPosCB->Update(m_context, LIGHT_POS);
-	m_textureCB->Update(m_context, XMMatrixScaling(0.25f, 0.25f, 1.0f) * XMMatrixTranslation(0.5f, 0.5f, 0.0f));
+	//Segments are parsed in the background, until then they are empty and the scene renders without them
+	LoadPumaMeshAsync(L"resources/meshes/mesh1.txt", m_mesh1, m_shadowVolumes[0]);
+	LoadPumaMeshAsync(L"resources/meshes/mesh2.txt", m_mesh2, m_shadowVolumes[1]);
+	LoadPumaMeshAsync(L"resources/meshes/mesh3.txt", m_mesh3, m_shadowVolumes[2]);
+	LoadPumaMeshAsync(L"resources/meshes/mesh4.txt", m_mesh4, m_shadowVolumes[3]);
+	LoadPumaMeshAsync(L"resources/meshes/mesh5.txt", m_mesh5, m_shadowVolumes[4]);
+	LoadPumaMeshAsync(L"resources/meshes/mesh6.txt", m_mesh6, m_shadowVolumes[5]);
+	//Each segment turns around its joint in the frame of the previous one, the angles are set by UpdatePuma
+	unsigned int parent = TransformHierarchy::NONE;
+	for (unsigned int i = 0; i < PumaScene::JOINTS; ++i)
+		parent = m_pumaNodes[i] = m_transforms.AddNode(parent);
+	m_transforms.Update();
+	ApplyTransforms();
+	UpdatePumaBounds(true);
+
+
+	m_lightPosCB->Update(m_context, PumaScene::LIGHT_POS);
+	m_textureCB->Update(m_context, PumaScene::TextureMatrix());
 }
 
 
 
 void Room::UpdatePuma(float dt)
 {
-	angle = angle + 3 * dt;
-
-	if (angle > XM_2PI){
-		angle -= XM_2PI;
-	}
-
-	XMFLOAT3 electrodePosition = XMFLOAT3(0.75f * cosf(angle), 0.75f * sinf(angle), 0.0f);
-
-	XMVECTOR electrodePositionVector = XMLoadFloat3(&electrodePosition);
-
-	XMVECTOR position = XMVector3Transform(electrodePositionVector, m_steelSheet.getWorldMatrix());
-	XMStoreFloat3(&electrodePosition, position);
-
-	XMFLOAT4 basicElectrodeNormal = XMFLOAT4(0.0f, 0.0f, -1.0f, 0.0f);
-	XMVECTOR transformedElectrodeNormal = XMVector4Transform(XMLoadFloat4(&basicElectrodeNormal), m_steelSheet.getWorldMatrix());
-	float a1, a2, a3, a4, a5;
+	PROFILE_ZONE("UpdatePuma");
+	m_pumaScene.Update(dt, m_steelSheet.getWorldMatrix());
+	//Local matrices of the joints, the world matrices of the segments are accumulated along the chain
+	for (unsigned int i = 0; i < PumaScene::JOINTS; ++i)
+		m_transforms.setLocal(m_pumaNodes[i], m_pumaScene.getJointMatrix(i));
+	m_transforms.Update();
+	ApplyTransforms();
 
-	InversedKinematic(position, transformedElectrodeNormal, a1, a2, a3, a4, a5);
-	
-	XMMATRIX result;
+	UpdatePumaBounds(false);
 
-	XMMATRIX m_mesh2_matrix2 = XMMatrixRotationY(a1);
-	m_mesh2.setWorldMatrix(m_mesh2_matrix2);
+	m_particles->Update(m_context, dt, m_camera.GetPosition(), m_pumaScene.getElectrodePosition());
 
-	XMMATRIX m_mesh3_matrix3 = XMMatrixTranslation(0.0f, -0.27f, 0.0f) * XMMatrixRotationZ(a2) * XMMatrixTranslation(0.0f, 0.27f, 0.0f);
-	result = m_mesh3_matrix3 * m_mesh2_matrix2;
-	m_mesh3.setWorldMatrix(result);
-
-	XMMATRIX m_mesh4_matrix4 = XMMatrixTranslation(0.91f, -0.27f, 0.0f) * XMMatrixRotationZ(a3) * XMMatrixTranslation(-0.91f, 0.27f, 0.0f);
-	result = m_mesh4_matrix4 * m_mesh3_matrix3 * m_mesh2_matrix2;
-	m_mesh4.setWorldMatrix(result);
-
-	XMMATRIX m_mesh_matrix5 = XMMatrixTranslation(0.0f, -0.27f, 0.26f) * XMMatrixRotationX(a4) * XMMatrixTranslation(0.0f, 0.27f, -0.26f);
-	result = m_mesh_matrix5 * m_mesh4_matrix4 * m_mesh3_matrix3 * m_mesh2_matrix2;
-	m_mesh5.setWorldMatrix(result);
-
-	XMMATRIX m_mesh_matrix6 = XMMatrixTranslation(1.72f, -0.27f, 0.0f) * XMMatrixRotationZ(a5) * XMMatrixTranslation(-1.72f, 0.27f, 0.0f);
-	result = m_mesh_matrix6 * m_mesh_matrix5 * m_mesh4_matrix4 * m_mesh3_matrix3 * m_mesh2_matrix2;
-	m_mesh6.setWorldMatrix(result);
-
-	m_particles->Update(m_context, dt, m_camera.GetPosition(), electrodePosition);
+}
 
+void Room::ApplyTransforms()
+{
+	Mesh* segments[PumaScene::JOINTS] = { &m_mesh2, &m_mesh3, &m_mesh4, &m_mesh5, &m_mesh6 };
+	for (unsigned int i = 0; i < PumaScene::JOINTS; ++i)
+		if (m_transforms.WasUpdated(m_pumaNodes[i]))
+			segments[i]->setWorldMatrix(m_transforms.getWorld(m_pumaNodes[i]));
+	if (m_transforms.WasUpdated(m_sunNode))
+		m_sun.setWorldMatrix(m_transforms.getWorld(m_sunNode));
+	if (m_transforms.WasUpdated(m_steelSheetNode))
+	{
+		const XMMATRIX& sheet = m_transforms.getWorld(m_steelSheetNode);
+		m_steelSheet.setWorldMatrix(sheet);
+		m_mirror.setWorldMatrix(sheet);
+		m_mirrorMtx = PumaScene::MirrorMatrix(sheet);
+	}
+	if (m_transforms.WasUpdated(m_circleNode))
+		m_circle.setWorldMatrix(m_transforms.getWorld(m_circleNode));
 }
 
-void Room::InversedKinematic(XMVECTOR pos, XMVECTOR normal, float &a1, float &a2, float &a3, float &a4, float &a5)
+void Room::UpdatePumaBounds(bool rebuild)
 {
-	float l1 = .91f, l2 = .81f, l3 = .33f, dy = .27f, dz = .26f;
-	XMVECTOR norm1 = XMVector3Normalize(normal);
-	XMVECTOR pos1 = pos + norm1 * l3;
-	XMFLOAT3 pos1f;
-	XMStoreFloat3(&pos1f, pos1);
-	float e = sqrtf(pos1f.z*pos1f.z + pos1f.x*pos1f.x - dz*dz);
-	a1 = atan2(pos1f.z, -pos1f.x) + atan2(dz, e);
-	XMFLOAT3 pos2f = XMFLOAT3(e, pos1f.y - dy, .0f);
-	XMVECTOR pos2 = XMLoadFloat3(&pos2f);
-	a3 = -acosf(min(1.0f, (pos2f.x*pos2f.x + pos2f.y*pos2f.y - l1*l1 - l2*l2) / (2.0f*l1*l2)));
-	float k = l1 + l2 * cosf(a3), l = l2 * sinf(a3);
-	a2 = -atan2(pos2f.y, sqrtf(pos2f.x*pos2f.x + pos2f.z*pos2f.z)) - atan2(l, k);
-	XMVECTOR normal1 = XMVector3Transform(norm1, XMMatrixRotationY(-a1));
-	normal1 = XMVector3Transform(normal1, XMMatrixRotationZ(-(a2 + a3)));
-	XMFLOAT3 normal1f;
-	XMStoreFloat3(&normal1f, normal1);
-	a5 = acosf(normal1f.x);
-	a4 = atan2(normal1f.z, normal1f.y);
+	const Mesh* segments[6] = { &m_mesh1, &m_mesh2, &m_mesh3, &m_mesh4, &m_mesh5, &m_mesh6 };
+	BoundingBox boxes[6];
+	for (int i = 0; i < 6; ++i)
+		boxes[i] = segments[i]->getWorldBox();
+	if (rebuild)
+		m_pumaBVH.Build(boxes, 6);
+	else
+		m_pumaBVH.Refit(boxes);
 }
 
 void Room::InitializeRenderStates()
@@ -235,9 +245,6 @@ void Room::InitializeRenderStates()
 	rsDesc.CullMode = D3D11_CULL_FRONT;
 	m_rsCullFront = m_device.CreateRasterizerState(rsDesc);
 
-	rsDesc = m_device.DefaultRasterizerDesc();
-	m_rsDefault = m_device.CreateRasterizerState(rsDesc);
-
 	dssDesc = m_device.DefaultDepthStencilDesc();
 	dssDesc.StencilEnable = true;
 	dssDesc.DepthEnable = true;
@@ -340,12 +347,91 @@ bool Room::LoadContent()
 	m_particles->SetProjMtxBuffer(m_projCB);
 	m_particles->SetSamplerState(m_samplerWrap);
 
+	InitializeFrameGraph(m_frameGraph);
+
 	return true;
 }
 
 void Room::UnloadContent()
 {
+	ReportFrameTimeline();
+}
+
+void Room::Clear()
+{
+	float clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	m_context->ClearRenderTargetView(m_backBuffer.get(), clearColor);
+	m_context->ClearDepthStencilView(m_depthStencilView.get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+}
+
+void Room::SetBlendState(BlendState state)
+{
+	ID3D11BlendState* states[] = { nullptr, m_bsAlpha.get(), m_bsAll.get(), m_bsNone.get() };
+	m_context->OMSetBlendState(states[state], nullptr, BS_MASK);
+}
+
+void Room::SetDepthStencilState(DepthStencilState state, unsigned int stencilRef)
+{
+	ID3D11DepthStencilState* states[] = { nullptr, m_dssNoWrite.get(), m_dssWrite.get(), m_dssTest.get(),
+										  m_dssIncr.get(), m_dssDecr.get(), m_dssKeepGreather.get(),
+										  m_dssKeepEqual.get(), m_dssNoStencil.get(), m_dssStencil.get() };
+	m_context->OMSetDepthStencilState(states[state], stencilRef);
+}
+
+void Room::SetRasterizerState(RasterizerState state)
+{
+	ID3D11RasterizerState* states[] = { nullptr, m_rsCounterClockwise.get(), m_rsCullNone.get(), m_rsCullBack.get(),
+										m_rsCullFront.get() };
+	m_context->RSSetState(states[state]);
+}
+
+void Room::SetMirroredView(bool mirrored)
+{
+	XMMATRIX viewMtx;
+	m_camera.GetViewMatrix(viewMtx);
+	UpdateCamera(mirrored ? XMMatrixMultiply(m_mirrorMtx, viewMtx) : viewMtx);
+}
+
+void Room::Draw(Object object)
+{
+	switch (object)
+	{
+	case OBJECT_MIRROR:
+		DrawMirror();
+		break;
+	case OBJECT_WALLS:
+		DrawWalls();
+		break;
+	case OBJECT_SUN:
+		DrawSun();
+		break;
+	case OBJECT_CYLINDER:
+		DrawCylinder();
+		break;
+	case OBJECT_PUMA:
+		DrawPuma();
+		break;
+	case OBJECT_STEEL_SHEET:
+		DrawSteelSheet();
+		break;
+	case OBJECT_CIRCLE:
+		DrawCircle();
+		break;
+	case OBJECT_PARTICLES:
+		m_particles->SetViewMtxBuffer(m_viewCB);
+		m_particles->Render(m_context);
+		break;
+	case OBJECT_SHADOW_VOLUMES:
+		DrawShadowVolumes();
+		break;
+	}
+}
 
+void Room::ReportFrameTimeline()
+{
+	wstringstream s;
+	m_frameGraph.WriteTimeline(s);
+	OutputDebugStringW(s.str().c_str());
 }
 
 void Room::UpdateCamera()
@@ -357,6 +443,7 @@ void Room::UpdateCamera()
 	m_camera.GetViewMatrix(view);
 	m_viewCB->Update(m_context, view);
 	m_cameraPosCB->Update(m_context, m_camera.GetPosition());
+	m_frustum.Update(view * m_projMtx);
 
 }
 
@@ -402,11 +489,18 @@ void Room::UpdateCamera(const XMMATRIX& view)
 	XMVECTOR det;
 	viewMtx[1] = XMMatrixInverse(&det, viewMtx[0]);
 	m_viewCB->Update(m_context, viewMtx);
+	m_frustum.Update(view * m_projMtx);
+}
+
+bool Room::IsVisible(const Mesh& mesh) const
+{
+	return m_frustum.Intersects(mesh.getWorldBox());
 }
 
 
 void Room::Update(float dt)
 {
+	m_assetLoader.Finalize();
 	static MouseState prevState;
 	MouseState currentState;
 	if (m_mouse->GetState(currentState))
@@ -437,65 +531,40 @@ void Room::Update(float dt)
 
 }
 
-void Room::DrawMirroredWorld()
-{
-	m_context->OMSetDepthStencilState(m_dssWrite.get(), 1);
-	DrawMirror();
-	m_context->OMSetDepthStencilState(m_dssTest.get(), 1);
-	XMMATRIX viewMtx;
-	m_camera.GetViewMatrix(viewMtx);
-	XMMATRIX mirrorViewMtx = XMMatrixMultiply(m_mirrorMtx, viewMtx);
-	UpdateCamera(mirrorViewMtx);
-	m_context->RSSetState(m_rsCounterClockwise.get());
-
-	DrawSun();
-	DrawCylinder();
-	DrawPuma();
-	m_context->RSSetState(NULL);
-
-	UpdateCamera(viewMtx);
-	m_context->OMSetDepthStencilState(NULL, 0);
-}
-
 void Room::DrawMirror()
 {
 	m_surfaceColorCB->Update(m_context, XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f));
 	m_phongEffect->Begin(m_context);
-	m_worldCB->Update(m_context, m_mirror.getWorldMatrix());
-	m_mirror.Render(m_context);
+	if (IsVisible(m_mirror))
+	{
+		m_worldCB->Update(m_context, m_mirror.getWorldMatrix());
+		m_mirror.Render(m_context);
+	}
 	m_phongEffect->End();
 }
 
 void Room::DrawSteelSheet()
 {
-	m_context->OMSetBlendState(m_bsAlpha.get(), nullptr, BS_MASK);
-	m_context->OMSetDepthStencilState(m_dssNoWrite.get(), 0);
 	m_textureEffect->SetTexture(m_steelSheetTexture);
 	m_textureEffect->Begin(m_context);
-	m_worldCB->Update(m_context, m_steelSheet.getWorldMatrix());
-	m_steelSheet.Render(m_context);
+	if (IsVisible(m_steelSheet))
+	{
+		m_worldCB->Update(m_context, m_steelSheet.getWorldMatrix());
+		m_steelSheet.Render(m_context);
+	}
 	m_textureEffect->End();
-	m_context->OMSetDepthStencilState(nullptr, 0);
-
-	m_particles->SetViewMtxBuffer(m_viewCB);
-
-	m_context->OMSetBlendState(nullptr, nullptr, BS_MASK);
-
-	m_particles->Render(m_context);
-
 }
 
 void Room::DrawCircle()
 {
-	m_context->OMSetBlendState(m_bsAlpha.get(), nullptr, BS_MASK);
-	m_context->OMSetDepthStencilState(m_dssNoWrite.get(), 0);
 	m_surfaceColorCB->Update(m_context, XMFLOAT4(1.0f, 0.0f, 0.0f, 0.35f));
 	m_phongEffect->Begin(m_context);
-	m_worldCB->Update(m_context, m_circle.getWorldMatrix());
-	m_circle.Render(m_context);
+	if (IsVisible(m_circle))
+	{
+		m_worldCB->Update(m_context, m_circle.getWorldMatrix());
+		m_circle.Render(m_context);
+	}
 	m_phongEffect->End();
-	m_context->OMSetDepthStencilState(nullptr, 0);
-	m_context->OMSetBlendState(nullptr, nullptr, BS_MASK);
 }
 
 void Room::DrawPuma()
@@ -510,23 +579,16 @@ void Room::DrawPuma()
 	m_phongEffect->Begin(m_context);
 	m_surfaceColorCB->Update(m_context, XMFLOAT4(0.1f, 0.7f, 0.2f, 1.0f));
 
-	m_worldCB->Update(m_context, m_mesh1.getWorldMatrix());
-	m_mesh1.Render(m_context);
-
-	m_worldCB->Update(m_context, m_mesh2.getWorldMatrix());
-	m_mesh2.Render(m_context);
-
-	m_worldCB->Update(m_context, m_mesh3.getWorldMatrix());
-	m_mesh3.Render(m_context);
-
-	m_worldCB->Update(m_context, m_mesh4.getWorldMatrix());
-	m_mesh4.Render(m_context);
-
-	m_worldCB->Update(m_context, m_mesh5.getWorldMatrix());
-	m_mesh5.Render(m_context);
-
-	m_worldCB->Update(m_context, m_mesh6.getWorldMatrix());
-	m_mesh6.Render(m_context);
+	Mesh* segments[6] = { &m_mesh1, &m_mesh2, &m_mesh3, &m_mesh4, &m_mesh5, &m_mesh6 };
+	vector<unsigned int> visibility;
+	m_pumaBVH.QueryFrustum(m_frustum, visibility);
+	for (int i = 0; i < 6; ++i)
+	{
+		if (!Frustum::IsVisible(visibility, i))
+			continue;
+		m_worldCB->Update(m_context, segments[i]->getWorldMatrix());
+		segments[i]->Render(m_context);
+	}
 
 	m_surfaceColorCB->Update(m_context, XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f));
 
@@ -538,8 +600,11 @@ void Room::DrawCylinder()
 {
 	m_surfaceColorCB->Update(m_context, XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f));
 	m_phongEffect->Begin(m_context);
-	m_worldCB->Update(m_context, m_cylinder.getWorldMatrix());
-	m_cylinder.Render(m_context);
+	if (IsVisible(m_cylinder))
+	{
+		m_worldCB->Update(m_context, m_cylinder.getWorldMatrix());
+		m_cylinder.Render(m_context);
+	}
 	m_phongEffect->End();
 }
 
@@ -547,15 +612,16 @@ void Room::DrawSun()
 {
 	m_textureEffect->SetTexture(m_sunTexture);
 	m_textureEffect->Begin(m_context);
-	m_worldCB->Update(m_context, m_sun.getWorldMatrix());
-	m_sun.Render(m_context);
+	if (IsVisible(m_sun))
+	{
+		m_worldCB->Update(m_context, m_sun.getWorldMatrix());
+		m_sun.Render(m_context);
+	}
 	m_textureEffect->End();
 }
 
 void Room::DrawWalls()
 {
-	m_context->OMSetBlendState(m_bsAlpha.get(), nullptr, BS_MASK);
-	m_context->OMSetDepthStencilState(m_dssNoWrite.get(), 0);
 	m_textureEffect->SetTexture(m_wallTexture);
 	m_textureEffect->Begin(m_context);
 	//for (size_t i = 0; i < 6; i++)
@@ -566,25 +632,6 @@ void Room::DrawWalls()
 	m_worldCB->Update(m_context, m_walls[4].getWorldMatrix());
 	m_walls[4].Render(m_context);
 	m_textureEffect->End();
-	m_context->OMSetDepthStencilState(nullptr, 0);
-	m_context->OMSetBlendState(nullptr, nullptr, BS_MASK);
-}
-
-void Room::DrawScene()
-{
-	DrawMirroredWorld();
-	DrawWalls();
-	DrawSun();
-	DrawCylinder();
-	DrawPuma();
-	DrawSteelSheet();
-	DrawCircle();
-
-	//UpdateCamera();
-
-	m_particles->Render(m_context);
-
-	m_context->RSSetState(nullptr);
 }
 
 void Room::DrawShadowVolumes()
@@ -599,34 +646,6 @@ void Room::DrawShadowVolumes()
 	}
 }
 
-void Room::DrawShadowScene()
-{
-	//m_context->OMSetRenderTargets(0, NULL, m_depthStencilView.get());
-	m_context->OMSetBlendState(m_bsNone.get(), nullptr, BS_MASK);
-	DrawScene();
-	m_context->RSSetState(m_rsCullBack.get());
-	m_context->OMSetDepthStencilState(m_dssIncr.get(), 0);
-	DrawShadowVolumes();
-	m_context->RSSetState(m_rsCullFront.get());
-	m_context->OMSetDepthStencilState(m_dssDecr.get(), 0);
-	DrawShadowVolumes();
-	//ResetRenderTarget();
-	m_context->OMSetBlendState(m_bsAll.get(), nullptr, BS_MASK);
-	m_context->RSSetState(m_rsCullBack.get());
-	m_context->OMSetDepthStencilState(m_dssKeepGreather.get(), 0);
-	//disable lights
-	DrawScene();
-	m_context->OMSetDepthStencilState(m_dssKeepEqual.get(), 0);
-	//enable lights
-	DrawScene();
-	m_context->OMSetDepthStencilState(m_dssNoStencil.get(), 0);
-	m_context->OMSetBlendState(m_bsNone.get(), nullptr, BS_MASK);
-	m_context->RSSetState(m_rsCullNone.get());
-	m_context->OMSetDepthStencilState(m_dssStencil.get(), 0);
-	DrawShadowVolumes();
-	m_context->OMSetBlendState(m_bsAll.get(), nullptr, BS_MASK);
-}
-
 void Room::Render()
 {
 	if (m_context == nullptr)
@@ -636,13 +655,7 @@ void Room::Render()
 	m_projCB->Update(m_context, m_projMtx);
 	UpdateCamera();
 
-	//Clear buffers
-	float clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
-	m_context->ClearRenderTargetView(m_backBuffer.get(), clearColor);
-	m_context->ClearDepthStencilView(m_depthStencilView.get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
-
-	DrawShadowScene();
-	DrawScene();
+	m_frameGraph.Execute(&Milliseconds);
 
 	m_swapChain->Present(0, 0);
 }
@@ -9,18 +9,23 @@
 #include "gk2_constantBuffer.h"
 #include "gk2_particles.h"
 #include "gk2_textureEffect.h"
+#include "gk2_frustum.h"
+#include "gk2_sceneBVH.h"
+#include "gk2_assetLoader.h"
+#include "gk2_frameGraph.h"
+#include "gk2_transformHierarchy.h"
+#include "gk2_aligned.h"
+#include "gk2_pumaScene.h"
+#include "gk2_roomPasses.h"
 
 namespace gk2
 {
-	class Room : public gk2::ApplicationBase
+	class Room : public gk2::ApplicationBase, public gk2::AlignedNew, public gk2::RoomPasses
 	{
 	public:
 		Room(HINSTANCE hInstance);
 		virtual ~Room();
 
-		static void* operator new(size_t size);
-		static void operator delete(void* ptr);
-
 	protected:
 		virtual bool LoadContent();
 		virtual void UnloadContent();
@@ -28,11 +33,17 @@ namespace gk2
 		virtual void Update(float dt);
 		virtual void Render();
 
+		virtual void Clear();
+		virtual void SetBlendState(BlendState state);
+		virtual void SetDepthStencilState(DepthStencilState state, unsigned int stencilRef);
+		virtual void SetRasterizerState(RasterizerState state);
+		virtual void SetMirroredView(bool mirrored);
+		virtual void Draw(Object object);
+
 	private:
 		static const unsigned int BS_MASK;
-		static const XMFLOAT4 LIGHT_POS;
 
-		gk2::Mesh m_walls[6];
+		gk2::Mesh m_walls[gk2::PumaScene::WALLS];
 		gk2::Mesh m_cylinder;
 		gk2::Mesh m_sun;
 		gk2::Mesh m_steelSheet;
@@ -48,14 +59,24 @@ namespace gk2
 		gk2::Mesh m_mesh4;
 		gk2::Mesh m_mesh5;
 		gk2::Mesh m_mesh6;
-		
-
 
+		//The steel sheet carries the mirror and the circle, the puma segments 2-6 form a chain
+		gk2::TransformHierarchy m_transforms;
+		unsigned int m_sunNode;
+		unsigned int m_steelSheetNode;
+		unsigned int m_circleNode;
+		unsigned int m_pumaNodes[gk2::PumaScene::JOINTS];
+		gk2::PumaScene m_pumaScene;
 
 		XMMATRIX m_projMtx;
+		gk2::Frustum m_frustum;
+		gk2::SceneBVH m_pumaBVH;
 
 		gk2::Camera m_camera;
 		gk2::MeshLoader m_meshLoader;
+		gk2::AssetLoader m_assetLoader;
+		//Passes of the shadow volume rendering
+		gk2::FrameGraph m_frameGraph;
 
 		std::shared_ptr<gk2::CBMatrix> m_worldCB;
 		std::shared_ptr<gk2::CBMatrix> m_viewCB;
@@ -95,28 +116,29 @@ namespace gk2
 		std::shared_ptr<ID3D11RasterizerState> m_rsCullNone;
 		std::shared_ptr<ID3D11RasterizerState> m_rsCullBack;
 		std::shared_ptr<ID3D11RasterizerState> m_rsCullFront;
-		std::shared_ptr<ID3D11RasterizerState> m_rsDefault;
 
 		void InitializeConstantBuffers();
 		void InitializeCamera();
 		void InitializeTextures();
 		void InitializeRenderStates();
 		void CreateScene();
+		void LoadTextureAsync(const std::wstring& fileName, std::shared_ptr<ID3D11ShaderResourceView>& texture);
+		void LoadPumaMeshAsync(const std::wstring& fileName, gk2::Mesh& mesh, gk2::Mesh& shadowVolume);
 		void UpdateCamera();
 		void UpdateCamera(const XMMATRIX& view);
+		bool IsVisible(const gk2::Mesh& mesh) const;
+		void UpdatePumaBounds(bool rebuild);
+		//Copies the world matrices recomputed by the last update of the transforms to the meshes
+		void ApplyTransforms();
+		//Writes the pass timeline of the last frame to the debugger output
+		void ReportFrameTimeline();
 
 		
-		void Room::CheckKeys(Camera& m_camera);
-		void Room::UpdatePuma(float dt);
-		void Room::InversedKinematic(XMVECTOR pos, XMVECTOR normal, float &a1, float &a2, float &a3, float &a4, float &a5);
-		float angle;
-		float steelWidth;
+		void CheckKeys(Camera& m_camera);
+		void UpdatePuma(float dt);
 		
 
-		void DrawScene();
-		void DrawShadowScene();
 		void DrawShadowVolumes();
-		void DrawMirroredWorld();
 		void DrawSteelSheet();
 		void DrawPuma();
 		void DrawWalls();
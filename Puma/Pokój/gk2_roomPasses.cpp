@@ -0,0 +1,140 @@
+#include "gk2_roomPasses.h"
+#include "gk2_profiler.h"
+
+using namespace std;
+using namespace gk2;
+
+void RoomPasses::InitializeFrameGraph(FrameGraph& frameGraph)
+{
+	frameGraph.Clear();
+	unsigned int backBuffer = frameGraph.Import("BackBuffer");
+	unsigned int depthStencil = frameGraph.Import("DepthStencil");
+	frameGraph.MarkOutput(backBuffer);
+
+	unsigned int pass = frameGraph.AddPass("Clear", [this]() { Clear(); });
+	frameGraph.Write(pass, backBuffer);
+	frameGraph.Write(pass, depthStencil);
+
+	//Scene depth without writing colors
+	pass = frameGraph.AddPass("Depth", [this]()
+	{
+		SetBlendState(BS_NONE);
+		DrawScene();
+	});
+	frameGraph.Write(pass, depthStencil);
+
+	pass = frameGraph.AddPass("ShadowVolumes", [this]()
+	{
+		SetRasterizerState(RS_CULL_BACK);
+		SetDepthStencilState(DSS_INCR, 0);
+		DrawShadowVolumes();
+		SetRasterizerState(RS_CULL_FRONT);
+		SetDepthStencilState(DSS_DECR, 0);
+		DrawShadowVolumes();
+	});
+	frameGraph.Read(pass, depthStencil);
+	frameGraph.Write(pass, depthStencil);
+
+	pass = frameGraph.AddPass("Shadowed", [this]()
+	{
+		SetBlendState(BS_ALL);
+		SetRasterizerState(RS_CULL_BACK);
+		SetDepthStencilState(DSS_KEEP_GREATER, 0);
+		DrawScene();
+	});
+	frameGraph.Read(pass, depthStencil);
+	frameGraph.Write(pass, backBuffer);
+	frameGraph.Write(pass, depthStencil);
+
+	pass = frameGraph.AddPass("Lit", [this]()
+	{
+		SetDepthStencilState(DSS_KEEP_EQUAL, 0);
+		DrawScene();
+	});
+	frameGraph.Read(pass, depthStencil);
+	frameGraph.Write(pass, backBuffer);
+	frameGraph.Write(pass, depthStencil);
+
+	pass = frameGraph.AddPass("ShadowStencil", [this]()
+	{
+		SetDepthStencilState(DSS_NO_STENCIL, 0);
+		SetBlendState(BS_NONE);
+		SetRasterizerState(RS_CULL_NONE);
+		SetDepthStencilState(DSS_STENCIL, 0);
+		DrawShadowVolumes();
+		SetBlendState(BS_ALL);
+	});
+	frameGraph.Read(pass, depthStencil);
+	frameGraph.Write(pass, depthStencil);
+
+	pass = frameGraph.AddPass("Scene", [this]() { DrawScene(); });
+	frameGraph.Read(pass, depthStencil);
+	frameGraph.Write(pass, backBuffer);
+
+	frameGraph.Compile();
+}
+
+void RoomPasses::DrawMirroredWorld()
+{
+	PROFILE_ZONE("DrawMirroredWorld");
+	SetDepthStencilState(DSS_WRITE, 1);
+	Draw(OBJECT_MIRROR);
+	SetDepthStencilState(DSS_TEST, 1);
+	SetMirroredView(true);
+	SetRasterizerState(RS_COUNTER_CLOCKWISE);
+
+	Draw(OBJECT_SUN);
+	Draw(OBJECT_CYLINDER);
+	Draw(OBJECT_PUMA);
+	SetRasterizerState(RS_DEFAULT);
+
+	SetMirroredView(false);
+	SetDepthStencilState(DSS_DEFAULT, 0);
+}
+
+void RoomPasses::DrawSteelSheet()
+{
+	SetBlendState(BS_ALPHA);
+	SetDepthStencilState(DSS_NO_WRITE, 0);
+	Draw(OBJECT_STEEL_SHEET);
+	SetDepthStencilState(DSS_DEFAULT, 0);
+	SetBlendState(BS_DEFAULT);
+	Draw(OBJECT_PARTICLES);
+}
+
+void RoomPasses::DrawCircle()
+{
+	SetBlendState(BS_ALPHA);
+	SetDepthStencilState(DSS_NO_WRITE, 0);
+	Draw(OBJECT_CIRCLE);
+	SetDepthStencilState(DSS_DEFAULT, 0);
+	SetBlendState(BS_DEFAULT);
+}
+
+void RoomPasses::DrawWalls()
+{
+	SetBlendState(BS_ALPHA);
+	SetDepthStencilState(DSS_NO_WRITE, 0);
+	Draw(OBJECT_WALLS);
+	SetDepthStencilState(DSS_DEFAULT, 0);
+	SetBlendState(BS_DEFAULT);
+}
+
+void RoomPasses::DrawScene()
+{
+	DrawMirroredWorld();
+	DrawWalls();
+	Draw(OBJECT_SUN);
+	Draw(OBJECT_CYLINDER);
+	Draw(OBJECT_PUMA);
+	DrawSteelSheet();
+	DrawCircle();
+	Draw(OBJECT_PARTICLES);
+	SetRasterizerState(RS_DEFAULT);
+}
+
+void RoomPasses::DrawShadowVolumes()
+{
+	PROFILE_ZONE("DrawShadowVolumes");
+	Draw(OBJECT_SHADOW_VOLUMES);
+}
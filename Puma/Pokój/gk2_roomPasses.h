@@ -0,0 +1,89 @@
+#ifndef __GK2_ROOM_PASSES_H_
+#define __GK2_ROOM_PASSES_H_
+
+#include "gk2_frameGraph.h"
+
+namespace gk2
+{
+	//Passes of the shadow volume rendering of Puma's room and the order in which they draw the objects with their
+	//render states. Room draws them with Direct3D and HeadlessRoom with the software rasterizer, both only
+	//translate the states and draw single objects, so the two can't drift apart.
+	class RoomPasses
+	{
+	public:
+		virtual ~RoomPasses() { }
+
+	protected:
+		//Default states are the ones set by passing null to the device context
+		enum BlendState
+		{
+			BS_DEFAULT,
+			BS_ALPHA,
+			//Writes all the channels without blending
+			BS_ALL,
+			//Writes no colors
+			BS_NONE
+		};
+
+		enum DepthStencilState
+		{
+			DSS_DEFAULT,
+			DSS_NO_WRITE,
+			//Stencil reference is written where the front faces pass the depth test
+			DSS_WRITE,
+			//Draws where the stencil equals the reference
+			DSS_TEST,
+			DSS_INCR,
+			DSS_DECR,
+			DSS_KEEP_GREATER,
+			DSS_KEEP_EQUAL,
+			DSS_NO_STENCIL,
+			DSS_STENCIL
+		};
+
+		enum RasterizerState
+		{
+			RS_DEFAULT,
+			RS_COUNTER_CLOCKWISE,
+			RS_CULL_NONE,
+			RS_CULL_BACK,
+			RS_CULL_FRONT
+		};
+
+		enum Object
+		{
+			OBJECT_MIRROR,
+			//Only the floor is drawn
+			OBJECT_WALLS,
+			OBJECT_SUN,
+			OBJECT_CYLINDER,
+			OBJECT_PUMA,
+			OBJECT_STEEL_SHEET,
+			OBJECT_CIRCLE,
+			OBJECT_PARTICLES,
+			OBJECT_SHADOW_VOLUMES
+		};
+
+		//Clears the graph and adds the passes drawing to the imported back buffer and depth stencil
+		void InitializeFrameGraph(gk2::FrameGraph& frameGraph);
+
+		virtual void Clear() = 0;
+		virtual void SetBlendState(BlendState state) = 0;
+		virtual void SetDepthStencilState(DepthStencilState state, unsigned int stencilRef) = 0;
+		virtual void SetRasterizerState(RasterizerState state) = 0;
+		//View of the world reflected in the mirror or of the camera
+		virtual void SetMirroredView(bool mirrored) = 0;
+		//Sets the effect of the object and draws it, the render states are left as they are
+		virtual void Draw(Object object) = 0;
+
+	private:
+		void DrawScene();
+		void DrawShadowVolumes();
+		void DrawMirroredWorld();
+		void DrawSteelSheet();
+		void DrawWalls();
+		void DrawCircle();
+	};
+}
+
+#endif __GK2_ROOM_PASSES_H_
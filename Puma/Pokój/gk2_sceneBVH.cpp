@@ -0,0 +1,372 @@
+#include "gk2_sceneBVH.h"
+#include <algorithm>
+#include <cfloat>
+
+using namespace std;
+using namespace gk2;
+
+namespace
+{
+	inline float HalfArea(const XMFLOAT3& min, const XMFLOAT3& max)
+	{
+		float dx = max.x - min.x, dy = max.y - min.y, dz = max.z - min.z;
+		return dx * dy + dy * dz + dz * dx;
+	}
+
+	inline void Grow(XMFLOAT3& min, XMFLOAT3& max, const XMFLOAT3& pMin, const XMFLOAT3& pMax)
+	{
+		min.x = std::min(min.x, pMin.x); min.y = std::min(min.y, pMin.y); min.z = std::min(min.z, pMin.z);
+		max.x = std::max(max.x, pMax.x); max.y = std::max(max.y, pMax.y); max.z = std::max(max.z, pMax.z);
+	}
+
+	inline float Component(const XMFLOAT3& v, unsigned int axis)
+	{
+		return (&v.x)[axis];
+	}
+
+	inline bool RayBox(const XMFLOAT3& min, const XMFLOAT3& max, FXMVECTOR origin, FXMVECTOR invDir,
+					   float maxDistance, float& distance)
+	{
+		XMVECTOR t1 = (XMLoadFloat3(&min) - origin) * invDir;
+		XMVECTOR t2 = (XMLoadFloat3(&max) - origin) * invDir;
+		XMVECTOR tMin = XMVectorMin(t1, t2);
+		XMVECTOR tMax = XMVectorMax(t1, t2);
+		float tNear = std::max(std::max(XMVectorGetX(tMin), XMVectorGetY(tMin)), std::max(XMVectorGetZ(tMin), 0.0f));
+		float tFar = std::min(std::min(XMVectorGetX(tMax), XMVectorGetY(tMax)), std::min(XMVectorGetZ(tMax), maxDistance));
+		distance = tNear;
+		return tNear <= tFar;
+	}
+
+	inline BoundingBox ToBox(const XMFLOAT3& min, const XMFLOAT3& max)
+	{
+		return BoundingBox(XMFLOAT3((min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f),
+						   XMFLOAT3((max.x - min.x) * 0.5f, (max.y - min.y) * 0.5f, (max.z - min.z) * 0.5f));
+	}
+
+	const XMFLOAT3 EMPTY_MIN(FLT_MAX, FLT_MAX, FLT_MAX);
+	const XMFLOAT3 EMPTY_MAX(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+}
+
+SceneBVH::SceneBVH()
+{ }
+
+void SceneBVH::Build(const BoundingBox* bounds, unsigned int count)
+{
+	m_nodes.clear();
+	m_instances.resize(count);
+	m_instanceLeaf.resize(count);
+	m_min.resize(count);
+	m_max.resize(count);
+	if (!count)
+		return;
+	vector<XMFLOAT3> centroids(count);
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		m_instances[i] = i;
+		centroids[i] = bounds[i].Center;
+		SetInstanceBounds(i, bounds[i]);
+	}
+	m_nodes.reserve(2 * count);
+	Node root;
+	root.First = 0;
+	root.Count = count;
+	root.Left = 0;
+	root.Parent = 0;
+	m_nodes.push_back(root);
+	UpdateLeaf(m_nodes[0]);
+	//Children are always appended after their parent, so the nodes can be refitted in reverse order.
+	vector<unsigned int> stack(1, 0);
+	while (!stack.empty())
+	{
+		unsigned int nodeIdx = stack.back();
+		stack.pop_back();
+		Split(nodeIdx, centroids);
+		if (m_nodes[nodeIdx].Left)
+		{
+			stack.push_back(m_nodes[nodeIdx].Left);
+			stack.push_back(m_nodes[nodeIdx].Left + 1);
+		}
+	}
+	for (unsigned int i = 0; i < m_nodes.size(); ++i)
+	{
+		const Node& n = m_nodes[i];
+		if (!n.Left)
+			for (unsigned int j = n.First; j < n.First + n.Count; ++j)
+				m_instanceLeaf[m_instances[j]] = i;
+	}
+}
+
+void SceneBVH::Split(unsigned int nodeIdx, vector<XMFLOAT3>& centroids)
+{
+	Node node = m_nodes[nodeIdx];
+	if (node.Count <= MAX_LEAF_SIZE)
+		return;
+	XMFLOAT3 cMin = EMPTY_MIN, cMax = EMPTY_MAX;
+	for (unsigned int i = node.First; i < node.First + node.Count; ++i)
+		Grow(cMin, cMax, centroids[m_instances[i]], centroids[m_instances[i]]);
+	unsigned int axis = 0;
+	float extent = cMax.x - cMin.x;
+	if (cMax.y - cMin.y > extent) { axis = 1; extent = cMax.y - cMin.y; }
+	if (cMax.z - cMin.z > extent) { axis = 2; extent = cMax.z - cMin.z; }
+
+	unsigned int* first = &m_instances[node.First];
+	unsigned int* last = first + node.Count;
+	unsigned int* mid = first + node.Count / 2;
+	if (extent > 0.0f)
+	{
+		//Binned surface area heuristic along the axis of the largest centroid spread
+		float axisMin = Component(cMin, axis);
+		float scale = SAH_BINS / extent;
+		XMFLOAT3 binMin[SAH_BINS], binMax[SAH_BINS];
+		unsigned int binCount[SAH_BINS] = { 0 };
+		for (unsigned int b = 0; b < SAH_BINS; ++b)
+		{
+			binMin[b] = EMPTY_MIN;
+			binMax[b] = EMPTY_MAX;
+		}
+		for (unsigned int* i = first; i != last; ++i)
+		{
+			unsigned int b = min(static_cast<unsigned int>((Component(centroids[*i], axis) - axisMin) * scale),
+								 SAH_BINS - 1);
+			binCount[b]++;
+			Grow(binMin[b], binMax[b], m_min[*i], m_max[*i]);
+		}
+		float rightCost[SAH_BINS];
+		XMFLOAT3 accMin = EMPTY_MIN, accMax = EMPTY_MAX;
+		unsigned int accCount = 0;
+		for (unsigned int b = SAH_BINS - 1; b > 0; --b)
+		{
+			Grow(accMin, accMax, binMin[b], binMax[b]);
+			accCount += binCount[b];
+			rightCost[b] = accCount ? HalfArea(accMin, accMax) * accCount : 0.0f;
+		}
+		accMin = EMPTY_MIN;
+		accMax = EMPTY_MAX;
+		accCount = 0;
+		float bestCost = FLT_MAX;
+		unsigned int bestBin = 0;
+		for (unsigned int b = 0; b < SAH_BINS - 1; ++b)
+		{
+			Grow(accMin, accMax, binMin[b], binMax[b]);
+			accCount += binCount[b];
+			if (!accCount || accCount == node.Count)
+				continue;
+			float cost = HalfArea(accMin, accMax) * accCount + rightCost[b + 1];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestBin = b;
+			}
+		}
+		if (bestCost < FLT_MAX)
+		{
+			mid = partition(first, last, [&](unsigned int i) {
+				unsigned int b = min(static_cast<unsigned int>((Component(centroids[i], axis) - axisMin) * scale),
+									 SAH_BINS - 1);
+				return b <= bestBin;
+			});
+		}
+	}
+	if (mid == first || mid == last)
+	{
+		//All centroids fall into one bin, split in the middle of the list
+		mid = first + node.Count / 2;
+		nth_element(first, mid, last, [&](unsigned int a, unsigned int b) {
+			return Component(centroids[a], axis) < Component(centroids[b], axis);
+		});
+	}
+
+	unsigned int leftIdx = static_cast<unsigned int>(m_nodes.size());
+	Node left, right;
+	left.First = node.First;
+	left.Count = static_cast<unsigned int>(mid - first);
+	right.First = left.First + left.Count;
+	right.Count = node.Count - left.Count;
+	left.Left = right.Left = 0;
+	left.Parent = right.Parent = nodeIdx;
+	m_nodes.push_back(left);
+	m_nodes.push_back(right);
+	UpdateLeaf(m_nodes[leftIdx]);
+	UpdateLeaf(m_nodes[leftIdx + 1]);
+	m_nodes[nodeIdx].Left = leftIdx;
+}
+
+void SceneBVH::SetInstanceBounds(unsigned int i, const BoundingBox& b)
+{
+	m_min[i] = XMFLOAT3(b.Center.x - b.Extents.x, b.Center.y - b.Extents.y, b.Center.z - b.Extents.z);
+	m_max[i] = XMFLOAT3(b.Center.x + b.Extents.x, b.Center.y + b.Extents.y, b.Center.z + b.Extents.z);
+}
+
+void SceneBVH::UpdateLeaf(Node& node)
+{
+	node.Min = EMPTY_MIN;
+	node.Max = EMPTY_MAX;
+	for (unsigned int i = node.First; i < node.First + node.Count; ++i)
+		Grow(node.Min, node.Max, m_min[m_instances[i]], m_max[m_instances[i]]);
+}
+
+void SceneBVH::UpdateInternal(Node& node)
+{
+	const Node& l = m_nodes[node.Left];
+	const Node& r = m_nodes[node.Left + 1];
+	node.Min = l.Min;
+	node.Max = l.Max;
+	Grow(node.Min, node.Max, r.Min, r.Max);
+}
+
+void SceneBVH::Refit(const unsigned int* instances, unsigned int instancesCount, const BoundingBox* bounds)
+{
+	if (m_nodes.empty())
+		return;
+	if (instancesCount * 4 > getInstanceCount())
+	{
+		Refit(bounds);
+		return;
+	}
+	for (unsigned int k = 0; k < instancesCount; ++k)
+	{
+		unsigned int i = instances[k];
+		SetInstanceBounds(i, bounds[i]);
+		unsigned int nodeIdx = m_instanceLeaf[i];
+		UpdateLeaf(m_nodes[nodeIdx]);
+		while (nodeIdx)
+		{
+			nodeIdx = m_nodes[nodeIdx].Parent;
+			UpdateInternal(m_nodes[nodeIdx]);
+		}
+	}
+}
+
+void SceneBVH::Refit(const BoundingBox* bounds)
+{
+	for (unsigned int i = 0; i < getInstanceCount(); ++i)
+		SetInstanceBounds(i, bounds[i]);
+	for (unsigned int i = getNodeCount(); i-- > 0; )
+	{
+		if (m_nodes[i].Left)
+			UpdateInternal(m_nodes[i]);
+		else
+			UpdateLeaf(m_nodes[i]);
+	}
+}
+
+BoundingBox SceneBVH::getBounds() const
+{
+	if (m_nodes.empty())
+		return BoundingBox();
+	return ToBox(m_nodes[0].Min, m_nodes[0].Max);
+}
+
+unsigned int SceneBVH::QueryFrustum(const Frustum& frustum, vector<unsigned int>& visibility) const
+{
+	visibility.assign((getInstanceCount() + 31) / 32, 0);
+	if (m_nodes.empty())
+		return 0;
+	unsigned int visible = 0;
+	vector<unsigned int> stack(1, 0);
+	while (!stack.empty())
+	{
+		const Node& node = m_nodes[stack.back()];
+		stack.pop_back();
+		Frustum::Containment c = frustum.Classify(ToBox(node.Min, node.Max));
+		if (c == Frustum::OUTSIDE)
+			continue;
+		if (c == Frustum::INSIDE || !node.Left)
+		{
+			//Whole subtree (or leaf) accepted without testing boxes of its instances
+			for (unsigned int i = node.First; i < node.First + node.Count; ++i)
+				visibility[m_instances[i] >> 5] |= 1u << (m_instances[i] & 31);
+			visible += node.Count;
+			continue;
+		}
+		stack.push_back(node.Left);
+		stack.push_back(node.Left + 1);
+	}
+	return visible;
+}
+
+void SceneBVH::QueryRay(FXMVECTOR origin, FXMVECTOR direction, vector<RayHit>& hits) const
+{
+	hits.clear();
+	if (m_nodes.empty())
+		return;
+	XMVECTOR invDir = XMVectorReciprocal(direction);
+	vector<unsigned int> stack(1, 0);
+	float distance;
+	while (!stack.empty())
+	{
+		const Node& node = m_nodes[stack.back()];
+		stack.pop_back();
+		if (!RayBox(node.Min, node.Max, origin, invDir, FLT_MAX, distance))
+			continue;
+		if (node.Left)
+		{
+			stack.push_back(node.Left);
+			stack.push_back(node.Left + 1);
+			continue;
+		}
+		for (unsigned int i = node.First; i < node.First + node.Count; ++i)
+		{
+			unsigned int instance = m_instances[i];
+			if (RayBox(m_min[instance], m_max[instance], origin, invDir, FLT_MAX, distance))
+			{
+				RayHit hit = { instance, distance };
+				hits.push_back(hit);
+			}
+		}
+	}
+	sort(hits.begin(), hits.end());
+}
+
+unsigned int SceneBVH::Pick(FXMVECTOR origin, FXMVECTOR direction, float* distance) const
+{
+	unsigned int result = NO_INSTANCE;
+	float best = FLT_MAX;
+	if (!m_nodes.empty())
+	{
+		XMVECTOR invDir = XMVectorReciprocal(direction);
+		vector<unsigned int> stack(1, 0);
+		float d;
+		while (!stack.empty())
+		{
+			const Node& node = m_nodes[stack.back()];
+			stack.pop_back();
+			if (!RayBox(node.Min, node.Max, origin, invDir, best, d))
+				continue;
+			if (node.Left)
+			{
+				//Nearer child is visited first, so the farther one can be rejected against the best hit
+				const Node& l = m_nodes[node.Left];
+				const Node& r = m_nodes[node.Left + 1];
+				float dl = FLT_MAX, dr = FLT_MAX;
+				bool hl = RayBox(l.Min, l.Max, origin, invDir, best, dl);
+				bool hr = RayBox(r.Min, r.Max, origin, invDir, best, dr);
+				if (hl && hr && dr < dl)
+				{
+					stack.push_back(node.Left);
+					stack.push_back(node.Left + 1);
+				}
+				else
+				{
+					if (hr)
+						stack.push_back(node.Left + 1);
+					if (hl)
+						stack.push_back(node.Left);
+				}
+				continue;
+			}
+			for (unsigned int i = node.First; i < node.First + node.Count; ++i)
+			{
+				unsigned int instance = m_instances[i];
+				if (RayBox(m_min[instance], m_max[instance], origin, invDir, best, d) && d < best)
+				{
+					best = d;
+					result = instance;
+				}
+			}
+		}
+	}
+	if (distance)
+		*distance = best;
+	return result;
+}
@@ -0,0 +1,799 @@
+#include "gk2_softwareRasterizer.h"
+#include "gk2_pngWriter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+#include <stdexcept>
+
+using namespace std;
+using namespace gk2;
+
+const float SoftwareRasterizer::AMBIENT = 0.3f;
+const float SoftwareRasterizer::DIFFUSE = 0.7f;
+const float SoftwareRasterizer::SPECULAR = 1.0f;
+const float SoftwareRasterizer::SHININESS = 100.0f;
+const float SoftwareRasterizer::TEXTURE_TRANSPARENCY = 0.35f;
+const float SoftwareRasterizer::PARTICLE_OPACITY = 0.3f;
+//Same precision as D3D11 hardware
+const float SoftwareRasterizer::SUBPIXEL_STEPS = 256.0f;
+
+namespace
+{
+	const unsigned int CLIP_PLANES = 6;
+	//Every plane can add one vertex to the polygon
+	const unsigned int MAX_CLIPPED_VERTICES = 3 + CLIP_PLANES;
+	const unsigned int TRANSFORM_BATCH = 4096;
+
+	float Saturate(float x)
+	{
+		return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+	}
+
+	float Dot(const float* a, const float* b)
+	{
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	void Normalize(float* v)
+	{
+		float length = sqrt(Dot(v, v));
+		if (length > 0.0f)
+		{
+			v[0] /= length;
+			v[1] /= length;
+			v[2] /= length;
+		}
+	}
+
+	//Row vector v (with the given w) times the matrix
+	void Transform(const float* v, float w, const SoftwareRasterizer::Matrix& m, float* result, unsigned int size)
+	{
+		for (unsigned int j = 0; j < size; ++j)
+			result[j] = v[0] * m.m[0][j] + v[1] * m.m[1][j] + v[2] * m.m[2][j] + w * m.m[3][j];
+	}
+
+	//Signed distance of the vertex to a clipping plane of the view volume, non-negative inside
+	float PlaneDistance(const float* p, unsigned int plane)
+	{
+		switch (plane)
+		{
+		case 0: return p[3] + p[0];
+		case 1: return p[3] - p[0];
+		case 2: return p[3] + p[1];
+		case 3: return p[3] - p[1];
+		case 4: return p[2];
+		default: return p[3] - p[2];
+		}
+	}
+
+	__m128 CompareVector(SoftwareRasterizer::Comparison func, __m128 a, __m128 b)
+	{
+		switch (func)
+		{
+		case SoftwareRasterizer::COMPARISON_NEVER: return _mm_setzero_ps();
+		case SoftwareRasterizer::COMPARISON_LESS: return _mm_cmplt_ps(a, b);
+		case SoftwareRasterizer::COMPARISON_EQUAL: return _mm_cmpeq_ps(a, b);
+		case SoftwareRasterizer::COMPARISON_LESS_EQUAL: return _mm_cmple_ps(a, b);
+		case SoftwareRasterizer::COMPARISON_GREATER: return _mm_cmpgt_ps(a, b);
+		case SoftwareRasterizer::COMPARISON_NOT_EQUAL: return _mm_cmpneq_ps(a, b);
+		case SoftwareRasterizer::COMPARISON_GREATER_EQUAL: return _mm_cmpge_ps(a, b);
+		default: return _mm_cmpeq_ps(a, a);
+		}
+	}
+}
+
+SoftwareRasterizer::Matrix SoftwareRasterizer::Matrix::Identity()
+{
+	Matrix r = { };
+	for (unsigned int i = 0; i < 4; ++i)
+		r.m[i][i] = 1.0f;
+	return r;
+}
+
+SoftwareRasterizer::Matrix SoftwareRasterizer::Matrix::Multiply(const Matrix& a, const Matrix& b)
+{
+	Matrix r;
+	for (unsigned int i = 0; i < 4; ++i)
+		Transform(a.m[i], a.m[i][3], b, r.m[i], 4);
+	return r;
+}
+
+SoftwareRasterizer::DepthStencilDesc SoftwareRasterizer::DepthStencilDesc::Default()
+{
+	DepthStencilDesc desc;
+	desc.DepthEnable = true;
+	desc.DepthWrite = true;
+	desc.DepthFunc = COMPARISON_LESS;
+	desc.StencilEnable = false;
+	desc.StencilReadMask = 0xff;
+	desc.StencilWriteMask = 0xff;
+	StencilFaceDesc face = { STENCIL_OP_KEEP, STENCIL_OP_KEEP, STENCIL_OP_KEEP, COMPARISON_ALWAYS };
+	desc.FrontFace = desc.BackFace = face;
+	return desc;
+}
+
+SoftwareRasterizer::RasterizerDesc SoftwareRasterizer::RasterizerDesc::Default()
+{
+	RasterizerDesc desc = { CULL_BACK, false };
+	return desc;
+}
+
+SoftwareRasterizer::BlendDesc SoftwareRasterizer::BlendDesc::Default()
+{
+	BlendDesc desc = { BLEND_OPAQUE, true };
+	return desc;
+}
+
+SoftwareRasterizer::EffectDesc SoftwareRasterizer::EffectDesc::Phong(const Vector4& surfaceColor,
+																	 const Vector4& lightPosition)
+{
+	EffectDesc desc;
+	desc.Type = EFFECT_PHONG;
+	desc.SurfaceColor = surfaceColor;
+	desc.LightPosition = lightPosition;
+	desc.TextureMatrix = Matrix::Identity();
+	desc.TimeToLive = 1.0f;
+	return desc;
+}
+
+SoftwareRasterizer::SoftwareRasterizer(unsigned int width, unsigned int height,
+									   const shared_ptr<ThreadPool>& pool /* = nullptr */)
+	: m_width(width), m_height(height), m_stride((width + 3) & ~3U), m_pool(pool), m_stateChanged(true),
+	  m_rasterizer(RasterizerDesc::Default()), m_view(Matrix::Identity()), m_proj(Matrix::Identity())
+{
+	if (width == 0 || height == 0)
+		throw invalid_argument("Render target of the software rasterizer can't be empty");
+	size_t size = static_cast<size_t>(m_stride) * height;
+	m_color.resize(size, 0);
+	m_depth.resize(size, 1.0f);
+	m_stencil.resize(size, 0);
+	m_tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	m_tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+	m_tiles.resize(m_tilesX * m_tilesY);
+	m_state.DepthStencil = DepthStencilDesc::Default();
+	m_state.StencilRef = 0;
+	m_state.Blend = BlendDesc::Default();
+	Vector4 white = { 1.0f, 1.0f, 1.0f, 1.0f }, origin = { 0.0f, 0.0f, 0.0f, 1.0f };
+	SetEffect(EffectDesc::Phong(white, origin));
+	ResetStatistics();
+}
+
+void SoftwareRasterizer::ResetStatistics()
+{
+	Statistics zero = { };
+	m_statistics = zero;
+}
+
+void SoftwareRasterizer::SetViewMatrix(const Matrix& view)
+{
+	m_view = view;
+	m_stateChanged = true;
+}
+
+void SoftwareRasterizer::SetProjMatrix(const Matrix& proj)
+{
+	m_proj = proj;
+}
+
+void SoftwareRasterizer::SetRasterizerState(const RasterizerDesc& desc)
+{
+	//Culling is done during the setup of triangles, so it isn't a part of the draw state
+	m_rasterizer = desc;
+}
+
+void SoftwareRasterizer::SetDepthStencilState(const DepthStencilDesc& desc, unsigned char stencilRef)
+{
+	m_state.DepthStencil = desc;
+	m_state.StencilRef = stencilRef;
+	m_stateChanged = true;
+}
+
+void SoftwareRasterizer::SetBlendState(const BlendDesc& desc)
+{
+	m_state.Blend = desc;
+	m_stateChanged = true;
+}
+
+void SoftwareRasterizer::SetEffect(const EffectDesc& effect)
+{
+	switch (effect.Type)
+	{
+	case EFFECT_PHONG:
+		m_state.AttributesCount = 6;
+		break;
+	case EFFECT_TEXTURE:
+	case EFFECT_COLOR_TEXTURE:
+		if (!effect.ColorMap)
+			throw invalid_argument("Texture effect requires a color map");
+		m_state.AttributesCount = 2;
+		break;
+	case EFFECT_PARTICLES:
+		if (!effect.ColorMap || !effect.OpacityMap)
+			throw invalid_argument("Particles effect requires color and opacity maps");
+		m_state.AttributesCount = 3;
+		break;
+	}
+	m_state.Effect = effect;
+	m_stateChanged = true;
+}
+
+unsigned int SoftwareRasterizer::BeginDraw()
+{
+	++m_statistics.Draws;
+	if (m_stateChanged || m_draws.empty())
+	{
+		const Vector4& light = m_state.Effect.LightPosition;
+		float position[3] = { light.x, light.y, light.z };
+		Transform(position, light.w, m_view, m_state.Light, 3);
+		m_draws.push_back(m_state);
+		m_stateChanged = false;
+	}
+	return static_cast<unsigned int>(m_draws.size() - 1);
+}
+
+void SoftwareRasterizer::Clear(const Vector4& color, float depth /* = 1.0f */, unsigned char stencil /* = 0 */)
+{
+	float c[4] = { color.x, color.y, color.z, color.w };
+	ClearCommand clear = { PackColor(c), depth, stencil };
+	unsigned int entry = CLEAR_ENTRY | static_cast<unsigned int>(m_clears.size());
+	m_clears.push_back(clear);
+	for (auto it = m_tiles.begin(); it != m_tiles.end(); ++it)
+		it->Entries.push_back(entry);
+}
+
+void SoftwareRasterizer::TransformVertices(const void* vertices, unsigned int vertexCount, unsigned int stride,
+										   const Matrix& world, const DrawState& state)
+{
+	const Matrix worldView = Matrix::Multiply(world, m_view);
+	const Matrix worldViewProj = Matrix::Multiply(worldView, m_proj);
+	m_vertices.resize(vertexCount);
+	const unsigned char* data = static_cast<const unsigned char*>(vertices);
+	auto transform = [&](unsigned int batch)
+	{
+		unsigned int end = min(vertexCount, (batch + 1) * TRANSFORM_BATCH);
+		for (unsigned int i = batch * TRANSFORM_BATCH; i < end; ++i)
+		{
+			const float* position = reinterpret_cast<const float*>(data + static_cast<size_t>(i) * stride);
+			ClipVertex& v = m_vertices[i];
+			memset(v.Attributes, 0, sizeof(v.Attributes));
+			Transform(position, 1.0f, worldViewProj, v.Pos, 4);
+			if (state.Effect.Type == EFFECT_PHONG)
+			{
+				Transform(position, 1.0f, worldView, v.Attributes, 3);
+				Transform(position + 3, 0.0f, worldView, v.Attributes + 3, 3);
+				Normalize(v.Attributes + 3);
+			}
+			else
+				Transform(position, 1.0f, state.Effect.TextureMatrix, v.Attributes, 2);
+		}
+	};
+	unsigned int batches = (vertexCount + TRANSFORM_BATCH - 1) / TRANSFORM_BATCH;
+	if (m_pool)
+		m_pool->ParallelFor(batches, transform);
+	else
+		for (unsigned int i = 0; i < batches; ++i)
+			transform(i);
+}
+
+void SoftwareRasterizer::DrawIndexed(const void* vertices, unsigned int vertexCount, unsigned int stride,
+									 const unsigned short* indices, unsigned int indexCount, const Matrix& world)
+{
+	for (unsigned int i = 0; i < indexCount; ++i)
+		if (indices[i] >= vertexCount)
+			throw out_of_range("Vertex index out of range");
+	unsigned int draw = BeginDraw();
+	TransformVertices(vertices, vertexCount, stride, world, m_draws[draw]);
+	m_statistics.Triangles += indexCount / 3;
+	for (unsigned int i = 0; i + 2 < indexCount; i += 3)
+		AddTriangle(m_vertices[indices[i]], m_vertices[indices[i + 1]], m_vertices[indices[i + 2]], draw);
+}
+
+void SoftwareRasterizer::DrawIndexed(const vector<Vertex>& vertices, const vector<unsigned short>& indices,
+									 const Matrix& world)
+{
+	DrawIndexed(vertices.data(), static_cast<unsigned int>(vertices.size()), sizeof(Vertex), indices.data(),
+				static_cast<unsigned int>(indices.size()), world);
+}
+
+void SoftwareRasterizer::DrawSprites(const Sprite* sprites, unsigned int count)
+{
+	if (m_state.Effect.Type != EFFECT_PARTICLES)
+		throw logic_error("Sprites require the particles effect");
+	unsigned int draw = BeginDraw();
+	m_statistics.Triangles += 2 * count;
+	const float ttl = m_state.Effect.TimeToLive;
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		const Sprite& s = sprites[i];
+		float position[3] = { s.Pos.x, s.Pos.y, s.Pos.z }, center[4];
+		Transform(position, 1.0f, m_view, center, 4);
+		float sina = sin(s.Angle), cosa = cos(s.Angle);
+		float dx = (cosa - sina) * 0.5f * s.Size;
+		float dy = (cosa + sina) * 0.5f * s.Size;
+		const float offsets[4][2] = { { -dx, -dy }, { -dy, dx }, { dy, -dx }, { dx, dy } };
+		const float tex[4][2] = { { 0.0f, 1.0f }, { 1.0f, 1.0f }, { 0.0f, 0.0f }, { 1.0f, 0.0f } };
+		ClipVertex quad[4];
+		for (unsigned int j = 0; j < 4; ++j)
+		{
+			float corner[3] = { center[0] + offsets[j][0], center[1] + offsets[j][1], center[2] };
+			Transform(corner, center[3], m_proj, quad[j].Pos, 4);
+			memset(quad[j].Attributes, 0, sizeof(quad[j].Attributes));
+			quad[j].Attributes[0] = tex[j][0];
+			quad[j].Attributes[1] = tex[j][1];
+			quad[j].Attributes[2] = s.Age / ttl;
+		}
+		//Triangle strip
+		AddTriangle(quad[0], quad[1], quad[2], draw);
+		AddTriangle(quad[1], quad[3], quad[2], draw);
+	}
+}
+
+unsigned int SoftwareRasterizer::ClipPolygon(ClipVertex* input, unsigned int count, ClipVertex* output,
+											 unsigned int plane)
+{
+	unsigned int result = 0;
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		const ClipVertex& a = input[i];
+		const ClipVertex& b = input[(i + 1) % count];
+		float da = PlaneDistance(a.Pos, plane), db = PlaneDistance(b.Pos, plane);
+		if (da >= 0.0f)
+			output[result++] = a;
+		if ((da >= 0.0f) != (db >= 0.0f))
+		{
+			float t = da / (da - db);
+			ClipVertex& v = output[result++];
+			for (unsigned int k = 0; k < 4; ++k)
+				v.Pos[k] = a.Pos[k] + (b.Pos[k] - a.Pos[k]) * t;
+			for (unsigned int k = 0; k < MAX_ATTRIBUTES; ++k)
+				v.Attributes[k] = a.Attributes[k] + (b.Attributes[k] - a.Attributes[k]) * t;
+		}
+	}
+	return result;
+}
+
+void SoftwareRasterizer::AddTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2,
+									 unsigned int draw)
+{
+	const ClipVertex* v[3] = { &v0, &v1, &v2 };
+	unsigned int outside = 0, outsideAll = (1 << CLIP_PLANES) - 1;
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		unsigned int mask = 0;
+		for (unsigned int p = 0; p < CLIP_PLANES; ++p)
+			if (PlaneDistance(v[i]->Pos, p) < 0.0f)
+				mask |= 1 << p;
+		outside |= mask;
+		outsideAll &= mask;
+	}
+	if (outside == 0)
+	{
+		SetupTriangle(v0, v1, v2, draw);
+		return;
+	}
+	++m_statistics.ClippedTriangles;
+	if (outsideAll != 0)
+		return;
+	ClipVertex buffers[2][MAX_CLIPPED_VERTICES];
+	buffers[0][0] = v0;
+	buffers[0][1] = v1;
+	buffers[0][2] = v2;
+	unsigned int count = 3, current = 0;
+	for (unsigned int p = 0; p < CLIP_PLANES && count >= 3; ++p)
+		if (outside & (1 << p))
+		{
+			count = ClipPolygon(buffers[current], count, buffers[1 - current], p);
+			current = 1 - current;
+		}
+	for (unsigned int i = 2; i < count; ++i)
+		SetupTriangle(buffers[current][0], buffers[current][i - 1], buffers[current][i], draw);
+}
+
+void SoftwareRasterizer::SetupTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2,
+									   unsigned int draw)
+{
+	const ClipVertex* v[3] = { &v0, &v1, &v2 };
+	float x[3], y[3], invW[3];
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		invW[i] = 1.0f / v[i]->Pos[3];
+		x[i] = floor((v[i]->Pos[0] * invW[i] + 1.0f) * 0.5f * m_width * SUBPIXEL_STEPS + 0.5f) / SUBPIXEL_STEPS;
+		y[i] = floor((1.0f - v[i]->Pos[1] * invW[i]) * 0.5f * m_height * SUBPIXEL_STEPS + 0.5f) / SUBPIXEL_STEPS;
+	}
+	//Positive for triangles which are clockwise on the screen
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	bool front = (area > 0.0f) != m_rasterizer.FrontCounterClockwise;
+	if (area == 0.0f || (m_rasterizer.Cull == CULL_BACK && !front) || (m_rasterizer.Cull == CULL_FRONT && front))
+	{
+		++m_statistics.CulledTriangles;
+		return;
+	}
+	//Counterclockwise triangles are rasterized with two vertices swapped
+	unsigned int order[3] = { 0, 1, 2 };
+	if (area < 0.0f)
+	{
+		swap(order[1], order[2]);
+		area = -area;
+	}
+	Triangle t;
+	t.Draw = draw;
+	t.Front = front;
+	float minX = x[0], maxX = x[0], minY = y[0], maxY = y[0];
+	for (unsigned int i = 1; i < 3; ++i)
+	{
+		minX = min(minX, x[i]);
+		maxX = max(maxX, x[i]);
+		minY = min(minY, y[i]);
+		maxY = max(maxY, y[i]);
+	}
+	//Pixels whose centers lie within the bounds
+	t.MinX = max(0, static_cast<int>(ceil(minX - 0.5f)));
+	t.MinY = max(0, static_cast<int>(ceil(minY - 0.5f)));
+	t.MaxX = min(static_cast<int>(m_width) - 1, static_cast<int>(floor(maxX - 0.5f)));
+	t.MaxY = min(static_cast<int>(m_height) - 1, static_cast<int>(floor(maxY - 0.5f)));
+	if (t.MinX > t.MaxX || t.MinY > t.MaxY)
+		return;
+	t.InvArea = 1.0f / area;
+	unsigned int attributes = m_draws[draw].AttributesCount;
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		unsigned int a = order[(i + 1) % 3], b = order[(i + 2) % 3];
+		t.EdgeA[i] = y[a] - y[b];
+		t.EdgeB[i] = x[b] - x[a];
+		//Top edges are horizontal with the triangle below them, left edges go up
+		t.TopLeft[i] = t.EdgeA[i] > 0.0f || (t.EdgeA[i] == 0.0f && t.EdgeB[i] > 0.0f);
+		unsigned int origin = y[a] < y[b] || (y[a] == y[b] && x[a] < x[b]) ? a : b;
+		t.EdgeX[i] = x[origin];
+		t.EdgeY[i] = y[origin];
+		const ClipVertex& vertex = *v[order[i]];
+		t.Z[i] = vertex.Pos[2] * invW[order[i]];
+		t.InvW[i] = invW[order[i]];
+		for (unsigned int k = 0; k < attributes; ++k)
+			t.Attributes[i][k] = vertex.Attributes[k] * t.InvW[i];
+	}
+	m_triangles.push_back(t);
+	BinTriangle(static_cast<unsigned int>(m_triangles.size() - 1));
+}
+
+void SoftwareRasterizer::BinTriangle(unsigned int index)
+{
+	const Triangle& t = m_triangles[index];
+	unsigned int tx0 = t.MinX / TILE_SIZE, tx1 = t.MaxX / TILE_SIZE;
+	unsigned int ty0 = t.MinY / TILE_SIZE, ty1 = t.MaxY / TILE_SIZE;
+	for (unsigned int ty = ty0; ty <= ty1; ++ty)
+		for (unsigned int tx = tx0; tx <= tx1; ++tx)
+		{
+			//Tile is skipped if its pixel center furthest inside along some edge is outside of it. Edge values
+			//grow monotonically with the coordinates also after rounding, so the test agrees with the pixels.
+			float left = tx * TILE_SIZE + 0.5f, top = ty * TILE_SIZE + 0.5f;
+			float right = min(tx * TILE_SIZE + TILE_SIZE, m_width) - 0.5f;
+			float bottom = min(ty * TILE_SIZE + TILE_SIZE, m_height) - 0.5f;
+			bool outside = false;
+			for (unsigned int i = 0; i < 3 && !outside; ++i)
+			{
+				float px = t.EdgeA[i] > 0.0f ? right : left;
+				float py = t.EdgeB[i] > 0.0f ? bottom : top;
+				outside = t.EdgeA[i] * (px - t.EdgeX[i]) + t.EdgeB[i] * (py - t.EdgeY[i]) < 0.0f;
+			}
+			if (outside)
+				continue;
+			m_tiles[ty * m_tilesX + tx].Entries.push_back(index);
+			++m_statistics.TileEntries;
+		}
+}
+
+void SoftwareRasterizer::Flush()
+{
+	auto rasterize = [this](unsigned int tile) { RasterizeTile(tile); };
+	unsigned int count = static_cast<unsigned int>(m_tiles.size());
+	if (m_pool)
+		m_pool->ParallelFor(count, rasterize);
+	else
+		for (unsigned int i = 0; i < count; ++i)
+			rasterize(i);
+	for (auto it = m_tiles.begin(); it != m_tiles.end(); ++it)
+	{
+		m_statistics.Fragments += it->Fragments;
+		m_statistics.Written += it->Written;
+		it->Entries.clear();
+	}
+	m_triangles.clear();
+	m_clears.clear();
+	m_draws.clear();
+}
+
+void SoftwareRasterizer::RasterizeTile(unsigned int index)
+{
+	Tile& tile = m_tiles[index];
+	tile.Fragments = tile.Written = 0;
+	int minX = (index % m_tilesX) * TILE_SIZE, minY = (index / m_tilesX) * TILE_SIZE;
+	int maxX = min(minX + static_cast<int>(TILE_SIZE), static_cast<int>(m_width)) - 1;
+	int maxY = min(minY + static_cast<int>(TILE_SIZE), static_cast<int>(m_height)) - 1;
+	for (auto it = tile.Entries.begin(); it != tile.Entries.end(); ++it)
+		if (*it & CLEAR_ENTRY)
+			ClearTile(m_clears[*it & ~CLEAR_ENTRY], minX, minY, maxX, maxY);
+		else
+			RasterizeTriangle(m_triangles[*it], tile, minX, minY, maxX, maxY);
+}
+
+void SoftwareRasterizer::ClearTile(const ClearCommand& clear, int minX, int minY, int maxX, int maxY)
+{
+	for (int y = minY; y <= maxY; ++y)
+	{
+		size_t row = static_cast<size_t>(y) * m_stride;
+		fill(m_color.begin() + row + minX, m_color.begin() + row + maxX + 1, clear.Color);
+		fill(m_depth.begin() + row + minX, m_depth.begin() + row + maxX + 1, clear.Depth);
+		fill(m_stencil.begin() + row + minX, m_stencil.begin() + row + maxX + 1, clear.Stencil);
+	}
+}
+
+void SoftwareRasterizer::RasterizeTriangle(const Triangle& t, Tile& tile, int minX, int minY, int maxX, int maxY)
+{
+	const DrawState& state = m_draws[t.Draw];
+	const DepthStencilDesc& ds = state.DepthStencil;
+	const StencilFaceDesc& face = t.Front ? ds.FrontFace : ds.BackFace;
+	const unsigned char ref = state.StencilRef & ds.StencilReadMask;
+	//Particles discard transparent fragments before they affect depth or stencil, other effects are evaluated
+	//only for the fragments which pass the tests
+	const bool discards = state.Effect.Type == EFFECT_PARTICLES;
+	//Fragments failing the depth test can be rejected early if they don't change the stencil
+	const bool depthRejects = !ds.StencilEnable || (face.FailOp == STENCIL_OP_KEEP &&
+													 face.DepthFailOp == STENCIL_OP_KEEP);
+	minX = max(minX, t.MinX);
+	minY = max(minY, t.MinY);
+	maxX = min(maxX, t.MaxX);
+	maxY = min(maxY, t.MaxY);
+	__m128 edgeA[3], edgeX[3], topLeft[3];
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		edgeA[i] = _mm_set1_ps(t.EdgeA[i]);
+		edgeX[i] = _mm_set1_ps(t.EdgeX[i]);
+		topLeft[i] = t.TopLeft[i] ? _mm_castsi128_ps(_mm_set1_epi32(-1)) : _mm_setzero_ps();
+	}
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 centers = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 invArea = _mm_set1_ps(t.InvArea);
+	//Buffer rows are padded, so groups of 4 pixels starting at multiples of 4 never cross them
+	for (int y = minY; y <= maxY; ++y)
+	{
+		float py = y + 0.5f;
+		__m128 rowTerm[3];
+		for (unsigned int i = 0; i < 3; ++i)
+			rowTerm[i] = _mm_set1_ps(t.EdgeB[i] * (py - t.EdgeY[i]));
+		size_t row = static_cast<size_t>(y) * m_stride;
+		for (int x = minX & ~3; x <= maxX; x += 4)
+		{
+			__m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), centers);
+			__m128 e[3], inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (unsigned int i = 0; i < 3; ++i)
+			{
+				e[i] = _mm_add_ps(_mm_mul_ps(edgeA[i], _mm_sub_ps(px, edgeX[i])), rowTerm[i]);
+				__m128 onEdge = _mm_and_ps(_mm_cmpeq_ps(e[i], zero), topLeft[i]);
+				inside = _mm_and_ps(inside, _mm_or_ps(_mm_cmpgt_ps(e[i], zero), onEdge));
+			}
+			int lanes = 0xf;
+			if (x < minX)
+				lanes &= 0xf << (minX - x);
+			if (x + 3 > maxX)
+				lanes &= 0xf >> (x + 3 - maxX);
+			int covered = _mm_movemask_ps(inside) & lanes;
+			if (!covered)
+				continue;
+			for (unsigned int i = 0; i < 3; ++i)
+				e[i] = _mm_mul_ps(e[i], invArea);
+			__m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e[0], _mm_set1_ps(t.Z[0])),
+											 _mm_mul_ps(e[1], _mm_set1_ps(t.Z[1]))),
+								  _mm_mul_ps(e[2], _mm_set1_ps(t.Z[2])));
+			int depthPass = 0xf;
+			if (ds.DepthEnable)
+				depthPass = _mm_movemask_ps(CompareVector(ds.DepthFunc, z, _mm_loadu_ps(&m_depth[row + x])));
+			if (depthRejects && !(covered &= depthPass))
+				continue;
+			float weights[3][4], depths[4];
+			for (unsigned int i = 0; i < 3; ++i)
+				_mm_storeu_ps(weights[i], e[i]);
+			_mm_storeu_ps(depths, z);
+			for (unsigned int lane = 0; lane < 4; ++lane)
+			{
+				if (!(covered & (1 << lane)))
+					continue;
+				++tile.Fragments;
+				size_t p = row + x + lane;
+				float color[4], attributes[MAX_ATTRIBUTES];
+				float l[3] = { weights[0][lane], weights[1][lane], weights[2][lane] };
+				if (discards || state.Blend.WriteColor)
+				{
+					float w = 1.0f / (l[0] * t.InvW[0] + l[1] * t.InvW[1] + l[2] * t.InvW[2]);
+					for (unsigned int k = 0; k < state.AttributesCount; ++k)
+						attributes[k] = (l[0] * t.Attributes[0][k] + l[1] * t.Attributes[1][k] +
+										 l[2] * t.Attributes[2][k]) * w;
+				}
+				if (discards && !ShadeFragment(state, attributes, color))
+					continue;
+				if (ds.StencilEnable)
+				{
+					unsigned char& stencil = m_stencil[p];
+					StencilOp op = face.PassOp;
+					bool passed = Compare(face.Func, ref, stencil & ds.StencilReadMask);
+					if (!passed)
+						op = face.FailOp;
+					else if (!(depthPass & (1 << lane)))
+					{
+						op = face.DepthFailOp;
+						passed = false;
+					}
+					unsigned char value = ApplyStencilOp(op, stencil, state.StencilRef);
+					stencil = (stencil & ~ds.StencilWriteMask) | (value & ds.StencilWriteMask);
+					if (!passed)
+						continue;
+				}
+				if (ds.DepthEnable && ds.DepthWrite)
+					m_depth[p] = depths[lane];
+				if (state.Blend.WriteColor)
+				{
+					if (!discards)
+						ShadeFragment(state, attributes, color);
+					WriteFragment(state, color, m_color[p]);
+				}
+				++tile.Written;
+			}
+		}
+	}
+}
+
+bool SoftwareRasterizer::ShadeFragment(const DrawState& state, const float* attributes, float* color) const
+{
+	const EffectDesc& effect = state.Effect;
+	switch (effect.Type)
+	{
+	case EFFECT_PHONG:
+		{
+			const float* position = attributes;
+			float normal[3] = { attributes[3], attributes[4], attributes[5] };
+			float view[3] = { -position[0], -position[1], -position[2] };
+			float light[3] = { state.Light[0] - position[0], state.Light[1] - position[1],
+							   state.Light[2] - position[2] };
+			Normalize(normal);
+			Normalize(view);
+			Normalize(light);
+			float half[3] = { view[0] + light[0], view[1] + light[1], view[2] + light[2] };
+			Normalize(half);
+			float diffuse = DIFFUSE * Saturate(Dot(normal, light));
+			float specular = SPECULAR * pow(Saturate(Dot(normal, half)), SHININESS);
+			const float surface[3] = { effect.SurfaceColor.x, effect.SurfaceColor.y, effect.SurfaceColor.z };
+			for (unsigned int i = 0; i < 3; ++i)
+				color[i] = Saturate(surface[i] * (AMBIENT + diffuse) + specular);
+			color[3] = effect.SurfaceColor.w;
+			return true;
+		}
+	case EFFECT_TEXTURE:
+		Sample(*effect.ColorMap, attributes[0], attributes[1], color);
+		color[3] = TEXTURE_TRANSPARENCY;
+		return true;
+	case EFFECT_COLOR_TEXTURE:
+		{
+			Sample(*effect.ColorMap, attributes[0], attributes[1], color);
+			const float surface[4] = { effect.SurfaceColor.x, effect.SurfaceColor.y, effect.SurfaceColor.z,
+									   effect.SurfaceColor.w };
+			for (unsigned int i = 0; i < 4; ++i)
+				color[i] = Saturate(color[i] + surface[i]);
+			return true;
+		}
+	default:
+		{
+			float opacity[4];
+			Sample(*effect.ColorMap, attributes[0], attributes[1], color);
+			Sample(*effect.OpacityMap, attributes[2], 0.5f, opacity);
+			color[3] *= opacity[3] * PARTICLE_OPACITY;
+			return color[3] != 0.0f;
+		}
+	}
+}
+
+void SoftwareRasterizer::WriteFragment(const DrawState& state, const float* color, unsigned int& target) const
+{
+	if (state.Blend.Mode == BLEND_OPAQUE)
+	{
+		target = PackColor(color);
+		return;
+	}
+	float result[4];
+	UnpackColor(target, result);
+	float a = color[3];
+	for (unsigned int i = 0; i < 3; ++i)
+		result[i] = state.Blend.Mode == BLEND_ALPHA ? color[i] * a + result[i] * (1.0f - a)
+													: result[i] + color[i] * a;
+	result[3] = state.Blend.Mode == BLEND_ALPHA ? a : result[3] + a;
+	target = PackColor(result);
+}
+
+bool SoftwareRasterizer::Compare(Comparison func, float a, float b)
+{
+	switch (func)
+	{
+	case COMPARISON_NEVER: return false;
+	case COMPARISON_LESS: return a < b;
+	case COMPARISON_EQUAL: return a == b;
+	case COMPARISON_LESS_EQUAL: return a <= b;
+	case COMPARISON_GREATER: return a > b;
+	case COMPARISON_NOT_EQUAL: return a != b;
+	case COMPARISON_GREATER_EQUAL: return a >= b;
+	default: return true;
+	}
+}
+
+unsigned char SoftwareRasterizer::ApplyStencilOp(StencilOp op, unsigned char value, unsigned char ref)
+{
+	switch (op)
+	{
+	case STENCIL_OP_ZERO: return 0;
+	case STENCIL_OP_REPLACE: return ref;
+	case STENCIL_OP_INCR_SAT: return value < 0xff ? value + 1 : value;
+	case STENCIL_OP_DECR_SAT: return value > 0 ? value - 1 : value;
+	case STENCIL_OP_INVERT: return ~value;
+	case STENCIL_OP_INCR: return value + 1;
+	case STENCIL_OP_DECR: return value - 1;
+	default: return value;
+	}
+}
+
+void SoftwareRasterizer::Sample(const Texture& texture, float u, float v, float* color)
+{
+	float x = u * texture.Width - 0.5f, y = v * texture.Height - 0.5f;
+	float fx = floor(x), fy = floor(y);
+	float tx = x - fx, ty = y - fy;
+	int w = static_cast<int>(texture.Width), h = static_cast<int>(texture.Height);
+	int x0 = static_cast<int>(fx) % w, y0 = static_cast<int>(fy) % h;
+	if (x0 < 0)
+		x0 += w;
+	if (y0 < 0)
+		y0 += h;
+	int x1 = (x0 + 1) % w, y1 = (y0 + 1) % h;
+	const unsigned char* p00 = &texture.Pixels[(static_cast<size_t>(y0) * w + x0) * 4];
+	const unsigned char* p10 = &texture.Pixels[(static_cast<size_t>(y0) * w + x1) * 4];
+	const unsigned char* p01 = &texture.Pixels[(static_cast<size_t>(y1) * w + x0) * 4];
+	const unsigned char* p11 = &texture.Pixels[(static_cast<size_t>(y1) * w + x1) * 4];
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		float top = p00[i] + (p10[i] - p00[i]) * tx;
+		float bottom = p01[i] + (p11[i] - p01[i]) * tx;
+		color[i] = (top + (bottom - top) * ty) / 255.0f;
+	}
+}
+
+unsigned int SoftwareRasterizer::PackColor(const float* color)
+{
+	unsigned int packed = 0;
+	for (unsigned int i = 0; i < 4; ++i)
+		packed |= static_cast<unsigned int>(Saturate(color[i]) * 255.0f + 0.5f) << (8 * i);
+	return packed;
+}
+
+void SoftwareRasterizer::UnpackColor(unsigned int packed, float* color)
+{
+	for (unsigned int i = 0; i < 4; ++i)
+		color[i] = ((packed >> (8 * i)) & 0xff) / 255.0f;
+}
+
+void SoftwareRasterizer::ReadPixels(vector<unsigned char>& pixels)
+{
+	Flush();
+	pixels.resize(static_cast<size_t>(m_width) * m_height * 4);
+	//Colors are packed with red in the lowest byte
+	for (unsigned int y = 0; y < m_height; ++y)
+		for (unsigned int x = 0; x < m_width; ++x)
+		{
+			unsigned int c = m_color[static_cast<size_t>(y) * m_stride + x];
+			unsigned char* p = &pixels[(static_cast<size_t>(y) * m_width + x) * 4];
+			for (unsigned int i = 0; i < 4; ++i)
+				p[i] = static_cast<unsigned char>(c >> (8 * i));
+		}
+}
+
+void SoftwareRasterizer::WritePng(const string& fileName)
+{
+	vector<unsigned char> pixels;
+	ReadPixels(pixels);
+	PngWriter::Write(fileName, m_width, m_height, pixels.data());
+}
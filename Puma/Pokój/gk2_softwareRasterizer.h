@@ -0,0 +1,327 @@
+#ifndef __GK2_SOFTWARE_RASTERIZER_H_
+#define __GK2_SOFTWARE_RASTERIZER_H_
+
+#include "gk2_threadPool.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace gk2
+{
+	//Renders on the CPU the part of the Direct3D pipeline the scenes use, so that they can be drawn on machines
+	//without a GPU, e.g. to produce reference images and frame time benchmarks. State is set like on a device
+	//context and follows the D3D11 rules: stencil and depth tests, stencil operations per face, top-left fill
+	//rule and blending in submission order. Draws are transformed, clipped and sorted into screen tiles right
+	//away, Flush rasterizes the tiles on the thread pool. The rasterizer doesn't use Direct3D or xnamath.
+	class SoftwareRasterizer
+	{
+	public:
+		static const unsigned int TILE_SIZE = 64;
+		//Floats interpolated over a triangle
+		static const unsigned int MAX_ATTRIBUTES = 6;
+		//Constants of the shaders in resources/shaders
+		static const float AMBIENT;
+		static const float DIFFUSE;
+		static const float SPECULAR;
+		static const float SHININESS;
+		static const float TEXTURE_TRANSPARENCY;
+		static const float PARTICLE_OPACITY;
+
+		//Memory layouts match XMFLOAT3, XMFLOAT4 and XMFLOAT4X4, vectors are multiplied by matrices from the left
+		struct Vector3 { float x, y, z; };
+		struct Vector4 { float x, y, z, w; };
+		struct Matrix
+		{
+			float m[4][4];
+
+			static Matrix Identity();
+			static Matrix Multiply(const Matrix& a, const Matrix& b);
+		};
+
+		//Same layout as VertexPosNormal
+		struct Vertex
+		{
+			Vector3 Pos;
+			Vector3 Normal;
+		};
+
+		//Same layout as ParticleVertex
+		struct Sprite
+		{
+			Vector3 Pos;
+			float Age;
+			float Angle;
+			float Size;
+		};
+
+		//Rows stored top to bottom without padding, 8 bits per RGBA channel, like TextureCooker::Image.
+		//Sampled bilinearly with wrapping, without mipmaps.
+		struct Texture
+		{
+			unsigned int Width;
+			unsigned int Height;
+			std::vector<unsigned char> Pixels;
+		};
+
+		//Values of the D3D11 enumerations without the offset of one
+		enum Comparison
+		{
+			COMPARISON_NEVER,
+			COMPARISON_LESS,
+			COMPARISON_EQUAL,
+			COMPARISON_LESS_EQUAL,
+			COMPARISON_GREATER,
+			COMPARISON_NOT_EQUAL,
+			COMPARISON_GREATER_EQUAL,
+			COMPARISON_ALWAYS
+		};
+
+		enum StencilOp
+		{
+			STENCIL_OP_KEEP,
+			STENCIL_OP_ZERO,
+			STENCIL_OP_REPLACE,
+			STENCIL_OP_INCR_SAT,
+			STENCIL_OP_DECR_SAT,
+			STENCIL_OP_INVERT,
+			STENCIL_OP_INCR,
+			STENCIL_OP_DECR
+		};
+
+		enum CullMode
+		{
+			CULL_NONE,
+			CULL_FRONT,
+			CULL_BACK
+		};
+
+		enum BlendMode
+		{
+			BLEND_OPAQUE,
+			//Color is mixed by the source alpha, the alpha channel is overwritten
+			BLEND_ALPHA,
+			//Source color multiplied by its alpha is added
+			BLEND_ADDITIVE
+		};
+
+		enum EffectType
+		{
+			//PhongShader.hlsl
+			EFFECT_PHONG,
+			//TextureShader.hlsl, texture coordinates are model space positions transformed by the texture matrix
+			EFFECT_TEXTURE,
+			//ColorTexShader.hlsl, texture color added to the surface color
+			EFFECT_COLOR_TEXTURE,
+			//Particles.hlsl, the color map holds the cloud and the opacity map the opacity by age. Used by DrawSprites.
+			EFFECT_PARTICLES
+		};
+
+		struct StencilFaceDesc
+		{
+			StencilOp FailOp;
+			StencilOp DepthFailOp;
+			StencilOp PassOp;
+			Comparison Func;
+		};
+
+		struct DepthStencilDesc
+		{
+			bool DepthEnable;
+			bool DepthWrite;
+			Comparison DepthFunc;
+			bool StencilEnable;
+			unsigned char StencilReadMask;
+			unsigned char StencilWriteMask;
+			StencilFaceDesc FrontFace;
+			StencilFaceDesc BackFace;
+
+			//Same as DeviceHelper::DefaultDepthStencilDesc
+			static DepthStencilDesc Default();
+		};
+
+		struct RasterizerDesc
+		{
+			CullMode Cull;
+			bool FrontCounterClockwise;
+
+			static RasterizerDesc Default();
+		};
+
+		struct BlendDesc
+		{
+			BlendMode Mode;
+			//Write mask of all the channels or none
+			bool WriteColor;
+
+			static BlendDesc Default();
+		};
+
+		struct EffectDesc
+		{
+			EffectType Type;
+			Vector4 SurfaceColor;
+			//In world space
+			Vector4 LightPosition;
+			Matrix TextureMatrix;
+			std::shared_ptr<const Texture> ColorMap;
+			std::shared_ptr<const Texture> OpacityMap;
+			//Particle age at which the opacity texture ends
+			float TimeToLive;
+
+			static EffectDesc Phong(const Vector4& surfaceColor, const Vector4& lightPosition);
+		};
+
+		struct Statistics
+		{
+			unsigned int Draws;
+			unsigned int Triangles;
+			//Back facing and degenerate ones, the ones outside of the view are counted as clipped
+			unsigned int CulledTriangles;
+			unsigned int ClippedTriangles;
+			//Triangles after clipping, counted once in every tile they were sorted to
+			unsigned long long TileEntries;
+			//Pixels covered by the triangles
+			unsigned long long Fragments;
+			//Fragments which passed the tests and were written
+			unsigned long long Written;
+		};
+
+		//Without a pool the tiles are rasterized on the calling thread
+		SoftwareRasterizer(unsigned int width, unsigned int height,
+						   const std::shared_ptr<ThreadPool>& pool = nullptr);
+
+		unsigned int getWidth() const { return m_width; }
+		unsigned int getHeight() const { return m_height; }
+		const Statistics& getStatistics() const { return m_statistics; }
+		void ResetStatistics();
+
+		void SetViewMatrix(const Matrix& view);
+		void SetProjMatrix(const Matrix& proj);
+		void SetRasterizerState(const RasterizerDesc& desc);
+		void SetDepthStencilState(const DepthStencilDesc& desc, unsigned char stencilRef);
+		void SetBlendState(const BlendDesc& desc);
+		void SetEffect(const EffectDesc& effect);
+
+		//Each component of the color in [0, 1]
+		void Clear(const Vector4& color, float depth = 1.0f, unsigned char stencil = 0);
+		//Triangle list. Vertices have a position at offset 0 and a normal at offset 12, like VertexPosNormal.
+		void DrawIndexed(const void* vertices, unsigned int vertexCount, unsigned int stride,
+						 const unsigned short* indices, unsigned int indexCount, const Matrix& world);
+		void DrawIndexed(const std::vector<Vertex>& vertices, const std::vector<unsigned short>& indices,
+						 const Matrix& world);
+		//Point list expanded to quads in view space, like the geometry shader of Particles.hlsl
+		void DrawSprites(const Sprite* sprites, unsigned int count);
+		//Rasterizes everything drawn since the last flush
+		void Flush();
+
+		//Flushes and copies the color buffer, rows top to bottom without padding
+		void ReadPixels(std::vector<unsigned char>& pixels);
+		void WritePng(const std::string& fileName);
+
+	private:
+		struct ClipVertex
+		{
+			float Pos[4];
+			float Attributes[MAX_ATTRIBUTES];
+		};
+
+		//State of a draw, shared by all its triangles
+		struct DrawState
+		{
+			DepthStencilDesc DepthStencil;
+			unsigned char StencilRef;
+			BlendDesc Blend;
+			EffectDesc Effect;
+			//Light position in view space
+			float Light[3];
+			unsigned int AttributesCount;
+		};
+
+		//Set up for rasterization, screen positions snapped to SUBPIXEL_STEPS. Edge i is opposite to vertex i,
+		//so its value divided by the area is the barycentric coordinate of the vertex.
+		struct Triangle
+		{
+			unsigned int Draw;
+			bool Front;
+			//Inclusive pixel range
+			int MinX, MinY, MaxX, MaxY;
+			//Edge values at p are A * (p.x - X) + B * (p.y - Y), with X, Y the same for both triangles sharing
+			//the edge and A, B negated for one of them, so that the edge is evaluated the same way for both
+			float EdgeA[3], EdgeB[3], EdgeX[3], EdgeY[3];
+			bool TopLeft[3];
+			float InvArea;
+			float Z[3];
+			float InvW[3];
+			//Attributes divided by w, for perspective correct interpolation
+			float Attributes[3][MAX_ATTRIBUTES];
+		};
+
+		struct ClearCommand
+		{
+			unsigned int Color;
+			float Depth;
+			unsigned char Stencil;
+		};
+
+		struct Tile
+		{
+			//Triangle indices, or clear commands marked with CLEAR_ENTRY, in submission order
+			std::vector<unsigned int> Entries;
+			unsigned long long Fragments;
+			unsigned long long Written;
+		};
+
+		static const unsigned int CLEAR_ENTRY = 0x80000000;
+		static const float SUBPIXEL_STEPS;
+
+		unsigned int m_width;
+		unsigned int m_height;
+		//Row length of the buffers, padded to a multiple of 4 pixels
+		unsigned int m_stride;
+		std::shared_ptr<ThreadPool> m_pool;
+		std::vector<unsigned int> m_color;
+		std::vector<float> m_depth;
+		std::vector<unsigned char> m_stencil;
+
+		unsigned int m_tilesX;
+		unsigned int m_tilesY;
+		std::vector<Tile> m_tiles;
+		std::vector<Triangle> m_triangles;
+		std::vector<DrawState> m_draws;
+		std::vector<ClearCommand> m_clears;
+		//State set since the last draw
+		DrawState m_state;
+		bool m_stateChanged;
+		RasterizerDesc m_rasterizer;
+		Matrix m_view;
+		Matrix m_proj;
+		//Scratch buffer of the draws
+		std::vector<ClipVertex> m_vertices;
+		Statistics m_statistics;
+
+		unsigned int BeginDraw();
+		void TransformVertices(const void* vertices, unsigned int vertexCount, unsigned int stride,
+							   const Matrix& world, const DrawState& state);
+		//Clips a triangle of transformed vertices and sets up the resulting ones
+		void AddTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, unsigned int draw);
+		void SetupTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, unsigned int draw);
+		void BinTriangle(unsigned int index);
+
+		void RasterizeTile(unsigned int index);
+		void ClearTile(const ClearCommand& clear, int minX, int minY, int maxX, int maxY);
+		void RasterizeTriangle(const Triangle& triangle, Tile& tile, int minX, int minY, int maxX, int maxY);
+		//Returns false if the fragment is discarded
+		bool ShadeFragment(const DrawState& state, const float* attributes, float* color) const;
+		void WriteFragment(const DrawState& state, const float* color, unsigned int& target) const;
+
+		static unsigned int ClipPolygon(ClipVertex* input, unsigned int count, ClipVertex* output,
+										unsigned int plane);
+		static bool Compare(Comparison func, float a, float b);
+		static unsigned char ApplyStencilOp(StencilOp op, unsigned char value, unsigned char ref);
+		static void Sample(const Texture& texture, float u, float v, float* color);
+		static unsigned int PackColor(const float* color);
+		static void UnpackColor(unsigned int packed, float* color);
+	};
+}
+
+#endif __GK2_SOFTWARE_RASTERIZER_H_
@@ -0,0 +1,243 @@
+#ifndef __GK2_STATE_FILTERING_CONTEXT_H_
+#define __GK2_STATE_FILTERING_CONTEXT_H_
+
+#include "gk2_renderContext.h"
+
+namespace gk2
+{
+	//Remembers the state bound to every slot of the pipeline and drops the calls which would not change it.
+	//Cached pointers stay valid, because the wrapped context holds a reference to every object bound to it,
+	//so an object cannot be released and its address reused while the cache still refers to it. The runtime
+	//unbinds shader resources whose textures become render targets and ignores the ones bound while their textures
+	//are targets, so changing the targets forgets the shader resource slots of the textures of the previous and the
+	//new targets.
+	class StateFilteringContext : public gk2::RenderContext
+	{
+	public:
+		//Only state setting calls are counted, draws, clears and maps are always passed on
+		struct Statistics
+		{
+			unsigned int Issued;
+			unsigned int Filtered;
+		};
+
+		explicit StateFilteringContext(const std::shared_ptr<gk2::RenderContext>& context);
+
+		const std::shared_ptr<gk2::RenderContext>& getContext() const { return m_context; }
+		const Statistics& getFrameStatistics() const { return m_frame; }
+		const Statistics& getLastFrameStatistics() const { return m_lastFrame; }
+		const Statistics& getTotalStatistics() const { return m_total; }
+
+		//Starts counting calls of the next frame
+		void BeginFrame();
+		//Forgets all the cached state. Has to be called whenever the wrapped context is used directly.
+		void Invalidate();
+
+		virtual void VSSetShader(ID3D11VertexShader* shader, ID3D11ClassInstance* const* classInstances,
+								 UINT classInstancesCount);
+		virtual void GSSetShader(ID3D11GeometryShader* shader, ID3D11ClassInstance* const* classInstances,
+								 UINT classInstancesCount);
+		virtual void PSSetShader(ID3D11PixelShader* shader, ID3D11ClassInstance* const* classInstances,
+								 UINT classInstancesCount);
+		virtual void HSSetShader(ID3D11HullShader* shader, ID3D11ClassInstance* const* classInstances,
+								 UINT classInstancesCount);
+		virtual void DSSetShader(ID3D11DomainShader* shader, ID3D11ClassInstance* const* classInstances,
+								 UINT classInstancesCount);
+		virtual void VSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers);
+		virtual void GSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers);
+		virtual void PSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers);
+		virtual void PSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView* const* views);
+		virtual void PSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState* const* samplers);
+		virtual void HSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers);
+		virtual void DSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers);
+		virtual void DSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView* const* views);
+		virtual void DSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState* const* samplers);
+
+		virtual void IASetInputLayout(ID3D11InputLayout* layout);
+		virtual void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+		virtual void IASetVertexBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* strides,
+										const UINT* offsets);
+		virtual void IASetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset);
+
+		virtual void RSSetState(ID3D11RasterizerState* state);
+		virtual void RSSetViewports(UINT count, const D3D11_VIEWPORT* viewports);
+		virtual void OMSetBlendState(ID3D11BlendState* state, const FLOAT blendFactor[4], UINT sampleMask);
+		virtual void OMSetDepthStencilState(ID3D11DepthStencilState* state, UINT stencilRef);
+		virtual void OMSetRenderTargets(UINT count, ID3D11RenderTargetView* const* views,
+										ID3D11DepthStencilView* depthStencilView);
+
+		virtual void ClearRenderTargetView(ID3D11RenderTargetView* view, const FLOAT color[4]);
+		virtual void ClearDepthStencilView(ID3D11DepthStencilView* view, UINT flags, FLOAT depth, UINT8 stencil);
+		virtual void Draw(UINT vertexCount, UINT startVertex);
+		virtual void DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex);
+		virtual void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndex,
+										  INT baseVertex, UINT startInstance);
+		virtual HRESULT Map(ID3D11Resource* resource, UINT subresource, D3D11_MAP mapType, UINT mapFlags,
+							D3D11_MAPPED_SUBRESOURCE* mappedResource);
+		virtual void Unmap(ID3D11Resource* resource, UINT subresource);
+		virtual void UpdateSubresource(ID3D11Resource* resource, UINT subresource, const D3D11_BOX* box,
+									   const void* data, UINT rowPitch, UINT depthPitch);
+		virtual void CopySubresourceRegion(ID3D11Resource* destination, UINT destinationSubresource, UINT x, UINT y,
+										   UINT z, ID3D11Resource* source, UINT sourceSubresource,
+										   const D3D11_BOX* sourceBox);
+
+	private:
+		template<typename T>
+		struct Cached
+		{
+			T Value;
+			bool Known;
+
+			Cached() : Known(false) { }
+			//Returns true if the value changed
+			bool Set(const T& value)
+			{
+				if (Known && Value == value)
+					return false;
+				Value = value;
+				Known = true;
+				return true;
+			}
+		};
+
+		template<typename T, UINT N>
+		struct SlotCache
+		{
+			Cached<T> Slots[N];
+
+			void Invalidate()
+			{
+				for (UINT i = 0; i < N; ++i)
+					Slots[i].Known = false;
+			}
+			bool Fits(UINT startSlot, UINT count) const { return startSlot <= N && count <= N - startSlot; }
+			//Stores the values of slots which fit in the cache and returns the smallest range of slots which
+			//changed. Returns false if none of them did.
+			bool Set(UINT startSlot, UINT count, const T* values, UINT& first, UINT& changed)
+			{
+				changed = 0;
+				for (UINT i = 0; i < count; ++i)
+					if (Slots[startSlot + i].Set(values ? values[i] : T()))
+					{
+						if (changed == 0)
+							first = startSlot + i;
+						changed = startSlot + i - first + 1;
+					}
+				return changed > 0;
+			}
+		};
+
+		struct VertexBufferBinding
+		{
+			ID3D11Buffer* Buffer;
+			UINT Stride;
+			UINT Offset;
+
+			bool operator ==(const VertexBufferBinding& other) const
+			{
+				return Buffer == other.Buffer && Stride == other.Stride && Offset == other.Offset;
+			}
+		};
+
+		struct IndexBufferBinding
+		{
+			ID3D11Buffer* Buffer;
+			DXGI_FORMAT Format;
+			UINT Offset;
+
+			bool operator ==(const IndexBufferBinding& other) const
+			{
+				return Buffer == other.Buffer && Format == other.Format && Offset == other.Offset;
+			}
+		};
+
+		struct BlendBinding
+		{
+			ID3D11BlendState* State;
+			FLOAT Factor[4];
+			UINT SampleMask;
+
+			bool operator ==(const BlendBinding& other) const;
+		};
+
+		struct DepthStencilBinding
+		{
+			ID3D11DepthStencilState* State;
+			UINT StencilRef;
+
+			bool operator ==(const DepthStencilBinding& other) const
+			{
+				return State == other.State && StencilRef == other.StencilRef;
+			}
+		};
+
+		struct ViewportsBinding
+		{
+			UINT Count;
+			D3D11_VIEWPORT Viewports[D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
+
+			bool operator ==(const ViewportsBinding& other) const;
+		};
+
+		struct RenderTargetsBinding
+		{
+			UINT Count;
+			ID3D11RenderTargetView* Views[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
+			ID3D11DepthStencilView* DepthStencilView;
+
+			bool operator ==(const RenderTargetsBinding& other) const;
+		};
+
+		typedef SlotCache<ID3D11Buffer*, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT> ConstantBufferSlots;
+		typedef SlotCache<ID3D11ShaderResourceView*, D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT> ShaderResourceSlots;
+		typedef SlotCache<ID3D11SamplerState*, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT> SamplerSlots;
+
+		//Counts the call and returns whether it has to be issued
+		bool Count(bool changed);
+		template<typename T, UINT N>
+		void SetSlots(SlotCache<T, N>& cache, void (RenderContext::*set)(UINT, UINT, T const*), UINT startSlot,
+					  UINT count, T const* values);
+		template<typename T>
+		void SetShader(Cached<T*>& cache, void (RenderContext::*set)(T*, ID3D11ClassInstance* const*, UINT),
+					   T* shader, ID3D11ClassInstance* const* classInstances, UINT classInstancesCount);
+		//Remembers the textures of the new targets and forgets the shader resources of the previous and new ones
+		void ChangeTargets(const RenderTargetsBinding& binding);
+		void ForgetTargets(ShaderResourceSlots& cache, ID3D11Resource* const* targets, UINT count);
+
+		std::shared_ptr<gk2::RenderContext> m_context;
+		Statistics m_frame;
+		Statistics m_lastFrame;
+		Statistics m_total;
+
+		Cached<ID3D11VertexShader*> m_vs;
+		Cached<ID3D11GeometryShader*> m_gs;
+		Cached<ID3D11PixelShader*> m_ps;
+		Cached<ID3D11HullShader*> m_hs;
+		Cached<ID3D11DomainShader*> m_ds;
+		ConstantBufferSlots m_vsConstantBuffers;
+		ConstantBufferSlots m_gsConstantBuffers;
+		ConstantBufferSlots m_psConstantBuffers;
+		ConstantBufferSlots m_hsConstantBuffers;
+		ConstantBufferSlots m_dsConstantBuffers;
+		ShaderResourceSlots m_psShaderResources;
+		ShaderResourceSlots m_dsShaderResources;
+		SamplerSlots m_psSamplers;
+		SamplerSlots m_dsSamplers;
+		Cached<ID3D11InputLayout*> m_inputLayout;
+		Cached<D3D11_PRIMITIVE_TOPOLOGY> m_topology;
+		SlotCache<VertexBufferBinding, D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT> m_vertexBuffers;
+		Cached<IndexBufferBinding> m_indexBuffer;
+		Cached<ID3D11RasterizerState*> m_rasterizerState;
+		Cached<ViewportsBinding> m_viewports;
+		Cached<BlendBinding> m_blendState;
+		Cached<DepthStencilBinding> m_depthStencilState;
+		Cached<RenderTargetsBinding> m_renderTargets;
+		//Textures of the bound render targets and depth stencil view, only compared with. Unknown after
+		//Invalidate, until the targets are set again.
+		ID3D11Resource* m_targets[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT + 1];
+		UINT m_targetsCount;
+		bool m_targetsKnown;
+	};
+}
+
+#endif __GK2_STATE_FILTERING_CONTEXT_H_
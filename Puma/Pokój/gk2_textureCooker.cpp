@@ -0,0 +1,569 @@
+#include "gk2_textureCooker.h"
+#include "gk2_threadPool.h"
+#include <emmintrin.h>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+using namespace gk2;
+
+namespace
+{
+	const float PI = 3.14159265f;
+	//Kaiser window radius in destination pixels and its shape parameter
+	const float KAISER_RADIUS = 3.0f;
+	const float KAISER_ALPHA = 4.0f;
+
+	//Pool of the cookers, created with the first loop and kept for the following ones
+	mutex s_poolMutex;
+	unique_ptr<ThreadPool> s_pool;
+
+	//Calls func(i) for i in [0, count) on the pool. Its loops can't overlap, so cookers running at the same time
+	//on other threads (e.g. asset loader workers) run their loops serially.
+	template<typename F>
+	void ParallelFor(unsigned int count, const F& func)
+	{
+		unique_lock<mutex> lock(s_poolMutex, try_to_lock);
+		if (!lock.owns_lock())
+		{
+			for (unsigned int i = 0; i < count; ++i)
+				func(i);
+			return;
+		}
+		if (!s_pool)
+			s_pool.reset(new ThreadPool());
+		s_pool->ParallelFor(count, func);
+	}
+
+	float SRGBToLinear(float c)
+	{
+		return c <= 0.04045f ? c / 12.92f : pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float LinearToSRGB(float c)
+	{
+		return c <= 0.0031308f ? c * 12.92f : 1.055f * pow(c, 1.0f / 2.4f) - 0.055f;
+	}
+
+	//Zeroth order modified Bessel function of the first kind
+	float BesselI0(float x)
+	{
+		float sum = 1.0f, term = 1.0f;
+		for (int k = 1; k < 16; ++k)
+		{
+			float f = x / (2.0f * k);
+			term *= f * f;
+			sum += term;
+		}
+		return sum;
+	}
+
+	//Weight of a source pixel at distance t measured in destination pixels
+	float FilterWeight(float t, TextureCooker::MipFilter filter)
+	{
+		float x = fabs(t);
+		if (filter == TextureCooker::FILTER_BOX)
+			return x <= 0.5f ? 1.0f : 0.0f;
+		if (x >= KAISER_RADIUS)
+			return 0.0f;
+		float sinc = x < 1e-5f ? 1.0f : sin(PI * x) / (PI * x);
+		float r = x / KAISER_RADIUS;
+		return sinc * BesselI0(KAISER_ALPHA * sqrt(1.0f - r * r)) / BesselI0(KAISER_ALPHA);
+	}
+
+	struct Tap
+	{
+		unsigned int Index;
+		float Weight;
+	};
+
+	//Source pixels contributing to each destination pixel along one axis, clamped at the edges
+	vector<vector<Tap>> Taps(unsigned int srcSize, unsigned int dstSize, TextureCooker::MipFilter filter)
+	{
+		float scale = static_cast<float>(srcSize) / dstSize;
+		float support = (filter == TextureCooker::FILTER_BOX ? 0.5f : KAISER_RADIUS) * scale;
+		vector<vector<Tap>> taps(dstSize);
+		for (unsigned int d = 0; d < dstSize; ++d)
+		{
+			float center = (d + 0.5f) * scale - 0.5f;
+			int first = static_cast<int>(floor(center - support)), last = static_cast<int>(ceil(center + support));
+			float sum = 0.0f;
+			for (int s = first; s <= last; ++s)
+			{
+				float weight = FilterWeight((s - center) / scale, filter);
+				if (weight == 0.0f)
+					continue;
+				Tap tap = { static_cast<unsigned int>(min(max(s, 0), static_cast<int>(srcSize) - 1)), weight };
+				taps[d].push_back(tap);
+				sum += weight;
+			}
+			for (auto it = taps[d].begin(); it != taps[d].end(); ++it)
+				it->Weight /= sum;
+		}
+		return taps;
+	}
+
+	//Separable resampling of an RGBA float image, rows first
+	void Resample(const vector<float>& src, unsigned int srcWidth, unsigned int srcHeight,
+				  vector<float>& dst, unsigned int dstWidth, unsigned int dstHeight, TextureCooker::MipFilter filter)
+	{
+		vector<vector<Tap>> xTaps = Taps(srcWidth, dstWidth, filter);
+		vector<vector<Tap>> yTaps = Taps(srcHeight, dstHeight, filter);
+		vector<float> rows(dstWidth * srcHeight * 4);
+		ParallelFor(srcHeight, [&](unsigned int y)
+		{
+			const float* srcRow = &src[y * srcWidth * 4];
+			float* row = &rows[y * dstWidth * 4];
+			for (unsigned int x = 0; x < dstWidth; ++x)
+			{
+				float c[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+				for (auto t = xTaps[x].begin(); t != xTaps[x].end(); ++t)
+					for (int i = 0; i < 4; ++i)
+						c[i] += srcRow[t->Index * 4 + i] * t->Weight;
+				memcpy(row + x * 4, c, sizeof(c));
+			}
+		});
+		dst.resize(dstWidth * dstHeight * 4);
+		ParallelFor(dstHeight, [&](unsigned int y)
+		{
+			float* dstRow = &dst[y * dstWidth * 4];
+			for (unsigned int i = 0; i < dstWidth * 4; ++i)
+			{
+				float c = 0.0f;
+				for (auto t = yTaps[y].begin(); t != yTaps[y].end(); ++t)
+					c += rows[t->Index * dstWidth * 4 + i] * t->Weight;
+				//Negative lobes of the Kaiser filter may overshoot
+				dstRow[i] = min(max(c, 0.0f), 1.0f);
+			}
+		});
+	}
+
+	//Pixels of a 4x4 block, one array per channel. Edge pixels are repeated in blocks crossing the image border.
+	struct Block
+	{
+		float Channels[4][16];
+	};
+
+	void LoadBlock(const TextureCooker::Image& image, unsigned int bx, unsigned int by, Block& block)
+	{
+		for (unsigned int i = 0; i < 16; ++i)
+		{
+			unsigned int x = min(bx * 4 + i % 4, image.Width - 1);
+			unsigned int y = min(by * 4 + i / 4, image.Height - 1);
+			const BYTE* pixel = &image.Pixels[(y * image.Width + x) * 4];
+			for (int c = 0; c < 4; ++c)
+				block.Channels[c][i] = pixel[c];
+		}
+	}
+
+	//Finds the nearest palette entry for every pixel of the block, four pixels at a time.
+	//Palette holds paletteSize entries of channelsCount values each. Returns the total squared error.
+	float NearestIndices(const float* const* channels, int channelsCount, const float* palette, int paletteSize,
+						 int indices[16])
+	{
+		__m128 error = _mm_setzero_ps();
+		for (int i = 0; i < 16; i += 4)
+		{
+			__m128 best = _mm_set1_ps(FLT_MAX);
+			__m128i bestIndex = _mm_setzero_si128();
+			for (int p = 0; p < paletteSize; ++p)
+			{
+				__m128 dist = _mm_setzero_ps();
+				for (int c = 0; c < channelsCount; ++c)
+				{
+					__m128 d = _mm_sub_ps(_mm_loadu_ps(channels[c] + i), _mm_set1_ps(palette[p * channelsCount + c]));
+					dist = _mm_add_ps(dist, _mm_mul_ps(d, d));
+				}
+				__m128i closer = _mm_castps_si128(_mm_cmplt_ps(dist, best));
+				best = _mm_min_ps(dist, best);
+				bestIndex = _mm_or_si128(_mm_andnot_si128(closer, bestIndex), _mm_and_si128(closer, _mm_set1_epi32(p)));
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(indices + i), bestIndex);
+			error = _mm_add_ps(error, best);
+		}
+		float e[4];
+		_mm_storeu_ps(e, error);
+		return e[0] + e[1] + e[2] + e[3];
+	}
+
+	unsigned short Pack565(const float color[3])
+	{
+		int r = static_cast<int>(min(max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+		int g = static_cast<int>(min(max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+		int b = static_cast<int>(min(max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+		return static_cast<unsigned short>((r << 11) | (g << 5) | b);
+	}
+
+	void Unpack565(unsigned short packed, float color[3])
+	{
+		int r = packed >> 11, g = (packed >> 5) & 63, b = packed & 31;
+		color[0] = static_cast<float>((r << 3) | (r >> 2));
+		color[1] = static_cast<float>((g << 2) | (g >> 4));
+		color[2] = static_cast<float>((b << 3) | (b >> 2));
+	}
+
+	//Indices of the block colors for endpoints c0 and c1 in four color mode, returns the squared error
+	float FitColorIndices(const float* const* rgb, unsigned short c0, unsigned short c1, int indices[16])
+	{
+		float palette[12];
+		Unpack565(c0, palette);
+		Unpack565(c1, palette + 3);
+		for (int c = 0; c < 3; ++c)
+		{
+			palette[6 + c] = (2.0f * palette[c] + palette[3 + c]) / 3.0f;
+			palette[9 + c] = (palette[c] + 2.0f * palette[3 + c]) / 3.0f;
+		}
+		return NearestIndices(rgb, 3, palette, 4, indices);
+	}
+
+	//Least squares endpoints for the given indices. Returns false if the system is singular.
+	bool RefineEndpoints(const float* const* rgb, const int indices[16], float e0[3], float e1[3])
+	{
+		static const float w0[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f, ap[3] = { 0.0f }, bp[3] = { 0.0f };
+		for (int i = 0; i < 16; ++i)
+		{
+			float a = w0[indices[i]], b = 1.0f - a;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (int c = 0; c < 3; ++c)
+			{
+				ap[c] += a * rgb[c][i];
+				bp[c] += b * rgb[c][i];
+			}
+		}
+		float det = aa * bb - ab * ab;
+		if (fabs(det) < 1e-6f)
+			return false;
+		for (int c = 0; c < 3; ++c)
+		{
+			e0[c] = (ap[c] * bb - bp[c] * ab) / det;
+			e1[c] = (bp[c] * aa - ap[c] * ab) / det;
+		}
+		return true;
+	}
+
+	//Color part of BC1 and BC3 blocks: endpoints on the principal axis of block colors, then refined
+	void EncodeColorBlock(const Block& block, BYTE* out)
+	{
+		const float* rgb[3] = { block.Channels[0], block.Channels[1], block.Channels[2] };
+		float mean[3] = { 0.0f }, minC[3] = { 255.0f, 255.0f, 255.0f }, maxC[3] = { 0.0f };
+		for (int c = 0; c < 3; ++c)
+			for (int i = 0; i < 16; ++i)
+			{
+				mean[c] += rgb[c][i] / 16.0f;
+				minC[c] = min(minC[c], rgb[c][i]);
+				maxC[c] = max(maxC[c], rgb[c][i]);
+			}
+		float cov[3][3] = { { 0.0f } };
+		for (int i = 0; i < 16; ++i)
+			for (int c = 0; c < 3; ++c)
+				for (int d = 0; d < 3; ++d)
+					cov[c][d] += (rgb[c][i] - mean[c]) * (rgb[d][i] - mean[d]);
+		//Power iteration starting from the bounding box diagonal
+		float axis[3] = { maxC[0] - minC[0], maxC[1] - minC[1], maxC[2] - minC[2] };
+		for (int k = 0; k < 4; ++k)
+		{
+			float next[3];
+			for (int c = 0; c < 3; ++c)
+				next[c] = cov[c][0] * axis[0] + cov[c][1] * axis[1] + cov[c][2] * axis[2];
+			float length = max(fabs(next[0]), max(fabs(next[1]), fabs(next[2])));
+			if (length < 1e-6f)
+				break;
+			for (int c = 0; c < 3; ++c)
+				axis[c] = next[c] / length;
+		}
+		float e0[3], e1[3];
+		float axisLength = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+		if (axisLength < 1e-6f)
+		{
+			copy(mean, mean + 3, e0);
+			copy(mean, mean + 3, e1);
+		}
+		else
+		{
+			float minT = FLT_MAX, maxT = -FLT_MAX;
+			for (int i = 0; i < 16; ++i)
+			{
+				float t = ((rgb[0][i] - mean[0]) * axis[0] + (rgb[1][i] - mean[1]) * axis[1] +
+						   (rgb[2][i] - mean[2]) * axis[2]) / axisLength;
+				minT = min(minT, t);
+				maxT = max(maxT, t);
+			}
+			//Endpoints are moved slightly inside, outliers matter less than the bulk of the block
+			float inset = (maxT - minT) / 16.0f;
+			minT += inset;
+			maxT -= inset;
+			for (int c = 0; c < 3; ++c)
+			{
+				e0[c] = mean[c] + axis[c] * maxT;
+				e1[c] = mean[c] + axis[c] * minT;
+			}
+		}
+		unsigned short c0 = Pack565(e0), c1 = Pack565(e1);
+		int indices[16];
+		float error = FitColorIndices(rgb, c0, c1, indices);
+		for (int k = 0; k < 2 && error > 0.0f; ++k)
+		{
+			int refinedIndices[16];
+			if (!RefineEndpoints(rgb, indices, e0, e1))
+				break;
+			unsigned short r0 = Pack565(e0), r1 = Pack565(e1);
+			float refinedError = FitColorIndices(rgb, r0, r1, refinedIndices);
+			if (refinedError >= error)
+				break;
+			c0 = r0;
+			c1 = r1;
+			error = refinedError;
+			copy(refinedIndices, refinedIndices + 16, indices);
+		}
+		//Four color mode requires c0 > c1, swapping endpoints swaps indices 0-1 and 2-3
+		if (c0 < c1)
+		{
+			swap(c0, c1);
+			for (int i = 0; i < 16; ++i)
+				indices[i] ^= 1;
+		}
+		else if (c0 == c1)
+			fill(indices, indices + 16, 0);
+		unsigned int bits = 0;
+		for (int i = 0; i < 16; ++i)
+			bits |= static_cast<unsigned int>(indices[i]) << (2 * i);
+		memcpy(out, &c0, 2);
+		memcpy(out + 2, &c1, 2);
+		memcpy(out + 4, &bits, 4);
+	}
+
+	//Single channel block of BC3 alpha and BC5, eight value mode between the channel extremes
+	void EncodeChannelBlock(const float* values, BYTE* out)
+	{
+		float lo = 255.0f, hi = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			lo = min(lo, values[i]);
+			hi = max(hi, values[i]);
+		}
+		BYTE a0 = static_cast<BYTE>(hi + 0.5f), a1 = static_cast<BYTE>(lo + 0.5f);
+		out[0] = a0;
+		out[1] = a1;
+		memset(out + 2, 0, 6);
+		if (a0 == a1)
+			return;
+		float palette[8] = { static_cast<float>(a0), static_cast<float>(a1) };
+		for (int i = 1; i < 7; ++i)
+			palette[i + 1] = ((7 - i) * a0 + i * a1) / 7.0f;
+		int indices[16];
+		NearestIndices(&values, 1, palette, 8, indices);
+		unsigned long long bits = 0;
+		for (int i = 0; i < 16; ++i)
+			bits |= static_cast<unsigned long long>(indices[i]) << (3 * i);
+		for (int i = 0; i < 6; ++i)
+			out[2 + i] = static_cast<BYTE>(bits >> (8 * i));
+	}
+
+	unsigned int FourCC(char a, char b, char c, char d)
+	{
+		return static_cast<unsigned int>(a) | (static_cast<unsigned int>(b) << 8) |
+			   (static_cast<unsigned int>(c) << 16) | (static_cast<unsigned int>(d) << 24);
+	}
+
+	struct DDSPixelFormat
+	{
+		unsigned int Size;
+		unsigned int Flags;
+		unsigned int FourCC;
+		unsigned int RGBBitCount;
+		unsigned int RBitMask;
+		unsigned int GBitMask;
+		unsigned int BBitMask;
+		unsigned int ABitMask;
+	};
+
+	struct DDSHeader
+	{
+		unsigned int Size;
+		unsigned int Flags;
+		unsigned int Height;
+		unsigned int Width;
+		unsigned int PitchOrLinearSize;
+		unsigned int Depth;
+		unsigned int MipMapCount;
+		unsigned int Reserved1[11];
+		DDSPixelFormat PixelFormat;
+		unsigned int Caps;
+		unsigned int Caps2;
+		unsigned int Caps3;
+		unsigned int Caps4;
+		unsigned int Reserved2;
+	};
+
+	struct DDSHeaderDX10
+	{
+		unsigned int DXGIFormat;
+		unsigned int ResourceDimension;
+		unsigned int MiscFlag;
+		unsigned int ArraySize;
+		unsigned int MiscFlags2;
+	};
+
+	const unsigned int DDSD_CAPS = 0x1, DDSD_HEIGHT = 0x2, DDSD_WIDTH = 0x4, DDSD_PITCH = 0x8,
+		DDSD_PIXELFORMAT = 0x1000, DDSD_MIPMAPCOUNT = 0x20000, DDSD_LINEARSIZE = 0x80000;
+	const unsigned int DDPF_ALPHAPIXELS = 0x1, DDPF_FOURCC = 0x4, DDPF_RGB = 0x40;
+	const unsigned int DDSCAPS_COMPLEX = 0x8, DDSCAPS_TEXTURE = 0x1000, DDSCAPS_MIPMAP = 0x400000;
+	//DXGI_FORMAT_BC5_UNORM and D3D10_RESOURCE_DIMENSION_TEXTURE2D
+	const unsigned int DXGI_BC5_UNORM = 83, DIMENSION_TEXTURE2D = 3;
+
+	//Size of a level encoded by TextureCooker::Encode
+	size_t LevelSize(unsigned int width, unsigned int height, TextureCooker::Format format)
+	{
+		if (format == TextureCooker::FORMAT_RGBA)
+			return static_cast<size_t>(width) * height * 4;
+		return static_cast<size_t>(max(1u, (width + 3) / 4)) * max(1u, (height + 3) / 4) *
+			   (format == TextureCooker::FORMAT_BC1 ? 8 : 16);
+	}
+}
+
+TextureCooker::Format TextureCooker::ChooseFormat(const Image& image)
+{
+	if (image.Width % 4 != 0 || image.Height % 4 != 0)
+		return FORMAT_RGBA;
+	for (size_t i = 3; i < image.Pixels.size(); i += 4)
+		if (image.Pixels[i] != 255)
+			return FORMAT_BC3;
+	return FORMAT_BC1;
+}
+
+vector<TextureCooker::Image> TextureCooker::GenerateMips(const Image& image, bool sRGB /* = true */,
+														 MipFilter filter /* = FILTER_KAISER */)
+{
+	float toLinear[256];
+	for (int i = 0; i < 256; ++i)
+		toLinear[i] = sRGB ? SRGBToLinear(i / 255.0f) : i / 255.0f;
+	//Each level is filtered from the previous one kept in floating point, so that rounding doesn't accumulate
+	vector<float> level(image.Pixels.size());
+	for (size_t i = 0; i < level.size(); ++i)
+		level[i] = i % 4 == 3 ? image.Pixels[i] / 255.0f : toLinear[image.Pixels[i]];
+	vector<Image> mips(1, image);
+	unsigned int width = image.Width, height = image.Height;
+	while (width > 1 || height > 1)
+	{
+		Image mip;
+		mip.Width = max(1u, width / 2);
+		mip.Height = max(1u, height / 2);
+		vector<float> next;
+		Resample(level, width, height, next, mip.Width, mip.Height, filter);
+		mip.Pixels.resize(next.size());
+		for (size_t i = 0; i < next.size(); ++i)
+		{
+			float c = sRGB && i % 4 != 3 ? LinearToSRGB(next[i]) : next[i];
+			mip.Pixels[i] = static_cast<BYTE>(c * 255.0f + 0.5f);
+		}
+		mips.push_back(mip);
+		level.swap(next);
+		width = mip.Width;
+		height = mip.Height;
+	}
+	return mips;
+}
+
+vector<BYTE> TextureCooker::Encode(const Image& image, Format format)
+{
+	if (format == FORMAT_RGBA)
+		return image.Pixels;
+	unsigned int blocksX = max(1u, (image.Width + 3) / 4), blocksY = max(1u, (image.Height + 3) / 4);
+	unsigned int blockSize = format == FORMAT_BC1 ? 8 : 16;
+	vector<BYTE> data(blocksX * blocksY * blockSize);
+	ParallelFor(blocksY, [&](unsigned int by)
+	{
+		Block block;
+		for (unsigned int bx = 0; bx < blocksX; ++bx)
+		{
+			LoadBlock(image, bx, by, block);
+			BYTE* out = &data[(by * blocksX + bx) * blockSize];
+			switch (format)
+			{
+			case FORMAT_BC1:
+				EncodeColorBlock(block, out);
+				break;
+			case FORMAT_BC3:
+				EncodeChannelBlock(block.Channels[3], out);
+				EncodeColorBlock(block, out + 8);
+				break;
+			case FORMAT_BC5:
+				EncodeChannelBlock(block.Channels[0], out);
+				EncodeChannelBlock(block.Channels[1], out + 8);
+				break;
+			default:
+				break;
+			}
+		}
+	});
+	return data;
+}
+
+vector<BYTE> TextureCooker::WriteDDS(const vector<Image>& mips, Format format)
+{
+	DDSHeader header;
+	memset(&header, 0, sizeof(header));
+	header.Size = sizeof(DDSHeader);
+	header.Flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT;
+	header.Width = mips[0].Width;
+	header.Height = mips[0].Height;
+	header.MipMapCount = static_cast<unsigned int>(mips.size());
+	header.Caps = DDSCAPS_TEXTURE | (mips.size() > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+	header.PixelFormat.Size = sizeof(DDSPixelFormat);
+	if (format == FORMAT_RGBA)
+	{
+		header.Flags |= DDSD_PITCH;
+		header.PitchOrLinearSize = header.Width * 4;
+		header.PixelFormat.Flags = DDPF_RGB | DDPF_ALPHAPIXELS;
+		header.PixelFormat.RGBBitCount = 32;
+		header.PixelFormat.RBitMask = 0x000000ff;
+		header.PixelFormat.GBitMask = 0x0000ff00;
+		header.PixelFormat.BBitMask = 0x00ff0000;
+		header.PixelFormat.ABitMask = 0xff000000;
+	}
+	else
+	{
+		header.Flags |= DDSD_LINEARSIZE;
+		header.PitchOrLinearSize = static_cast<unsigned int>(LevelSize(header.Width, header.Height, format));
+		header.PixelFormat.Flags = DDPF_FOURCC;
+		//BC5 has no legacy code understood by all the loaders and uses the extended header
+		header.PixelFormat.FourCC = format == FORMAT_BC1 ? FourCC('D', 'X', 'T', '1') :
+									format == FORMAT_BC3 ? FourCC('D', 'X', 'T', '5') : FourCC('D', 'X', '1', '0');
+	}
+	//File is allocated once with its final size and the parts are copied into it
+	size_t size = 4 + sizeof(header) + (format == FORMAT_BC5 ? sizeof(DDSHeaderDX10) : 0);
+	for (auto it = mips.begin(); it != mips.end(); ++it)
+		size += LevelSize(it->Width, it->Height, format);
+	vector<BYTE> dds(size);
+	BYTE* out = dds.data();
+	memcpy(out, "DDS ", 4);
+	out += 4;
+	memcpy(out, &header, sizeof(header));
+	out += sizeof(header);
+	if (format == FORMAT_BC5)
+	{
+		DDSHeaderDX10 dx10 = { DXGI_BC5_UNORM, DIMENSION_TEXTURE2D, 0, 1, 0 };
+		memcpy(out, &dx10, sizeof(dx10));
+		out += sizeof(dx10);
+	}
+	for (auto it = mips.begin(); it != mips.end(); ++it)
+	{
+		vector<BYTE> level = Encode(*it, format);
+		memcpy(out, level.data(), level.size());
+		out += level.size();
+	}
+	return dds;
+}
+
+vector<BYTE> TextureCooker::Cook(const Image& image, Format format, bool sRGB /* = true */,
+								 MipFilter filter /* = FILTER_KAISER */)
+{
+	return WriteDDS(GenerateMips(image, sRGB && format != FORMAT_BC5, filter), format);
+}
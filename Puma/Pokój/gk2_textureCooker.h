@@ -0,0 +1,54 @@
+#ifndef __GK2_TEXTURE_COOKER_H_
+#define __GK2_TEXTURE_COOKER_H_
+
+#include <Windows.h>
+#include <vector>
+
+namespace gk2
+{
+	//Prepares textures on the CPU: builds the mipmap chain and encodes it in a block compressed format.
+	//Result is a DDS file which the device loads without any further processing.
+	class TextureCooker
+	{
+	public:
+		//Version of the cooked textures kept in the asset cache
+		static const unsigned int VERSION = 2;
+
+		//Decoded image, 8 bits per RGBA channel, rows stored top to bottom without padding
+		struct Image
+		{
+			unsigned int Width;
+			unsigned int Height;
+			std::vector<BYTE> Pixels;
+		};
+
+		enum Format
+		{
+			FORMAT_RGBA,
+			FORMAT_BC1,		//RGB, 8 bytes per 4x4 block
+			FORMAT_BC3,		//RGBA, 16 bytes per 4x4 block
+			FORMAT_BC5		//Two channels (e.g. XY of normal maps), 16 bytes per 4x4 block
+		};
+
+		enum MipFilter
+		{
+			FILTER_BOX,
+			FILTER_KAISER
+		};
+
+		//BC1 for opaque images and BC3 for ones using alpha. Block compressed textures must have dimensions
+		//divisible by 4, other images are left uncompressed.
+		static Format ChooseFormat(const Image& image);
+		//Full chain down to 1x1, starting with the image itself. sRGB colors are filtered in linear space,
+		//so that smaller mipmaps don't get darker.
+		static std::vector<Image> GenerateMips(const Image& image, bool sRGB = true, MipFilter filter = FILTER_KAISER);
+		//Raw contents of the level in the given format, blocks stored row by row
+		static std::vector<BYTE> Encode(const Image& image, Format format);
+		static std::vector<BYTE> WriteDDS(const std::vector<Image>& mips, Format format);
+		//Two channel formats hold non-color data and are never filtered as sRGB
+		static std::vector<BYTE> Cook(const Image& image, Format format, bool sRGB = true,
+									  MipFilter filter = FILTER_KAISER);
+	};
+}
+
+#endif __GK2_TEXTURE_COOKER_H_
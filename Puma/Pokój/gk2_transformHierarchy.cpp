@@ -0,0 +1,102 @@
+#include "gk2_transformHierarchy.h"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+using namespace gk2;
+
+TransformHierarchy::TransformHierarchy()
+	: m_pass(1), m_firstDirty(NONE), m_levelsValid(true)
+{
+
+}
+
+void TransformHierarchy::Reserve(unsigned int count)
+{
+	m_local.reserve(count);
+	m_world.reserve(count);
+	m_parent.reserve(count);
+	m_depth.reserve(count);
+	m_dirty.reserve(count);
+	m_updated.reserve(count);
+}
+
+unsigned int TransformHierarchy::AddNode(unsigned int parent, const XMMATRIX& local /* = XMMatrixIdentity() */)
+{
+	unsigned int node = getNodesCount();
+	if (parent != NONE && parent >= node)
+		throw out_of_range("Parent of a transform has to be added before the node");
+	m_local.push_back(local);
+	m_world.push_back(local);
+	m_parent.push_back(parent);
+	m_depth.push_back(parent == NONE ? 0 : m_depth[parent] + 1);
+	m_dirty.push_back(1);
+	m_updated.push_back(0);
+	m_firstDirty = min(m_firstDirty, node);
+	m_levelsValid = false;
+	return node;
+}
+
+void TransformHierarchy::setLocal(unsigned int node, const XMMATRIX& local)
+{
+	m_local[node] = local;
+	m_dirty[node] = 1;
+	m_firstDirty = min(m_firstDirty, node);
+}
+
+void TransformHierarchy::Update()
+{
+	++m_pass;
+	unsigned int count = getNodesCount();
+	for (unsigned int i = m_firstDirty; i < count; ++i)
+		UpdateNode(i);
+	m_firstDirty = NONE;
+}
+
+void TransformHierarchy::Update(ThreadPool& pool)
+{
+	if (!m_levelsValid)
+		BuildLevels();
+	++m_pass;
+	if (m_firstDirty == NONE)
+		return;
+	for (size_t level = 0; level + 1 < m_levelStarts.size(); ++level)
+	{
+		//Nodes of a level are sorted, so the ones before the first dirty node are skipped at once
+		auto end = m_levelNodes.begin() + m_levelStarts[level + 1];
+		auto begin = lower_bound(m_levelNodes.begin() + m_levelStarts[level], end, m_firstDirty);
+		unsigned int first = static_cast<unsigned int>(begin - m_levelNodes.begin());
+		unsigned int count = static_cast<unsigned int>(end - begin);
+		unsigned int chunks = (count + PARALLEL_CHUNK - 1) / PARALLEL_CHUNK;
+		auto updateChunk = [this, first, count](unsigned int chunk)
+		{
+			unsigned int start = chunk * PARALLEL_CHUNK;
+			unsigned int stop = min(count, start + PARALLEL_CHUNK);
+			for (unsigned int i = start; i < stop; ++i)
+				UpdateNode(m_levelNodes[first + i]);
+		};
+		if (chunks > 1)
+			pool.ParallelFor(chunks, updateChunk);
+		else if (chunks == 1)
+			updateChunk(0);
+	}
+	m_firstDirty = NONE;
+}
+
+void TransformHierarchy::BuildLevels()
+{
+	//Counting sort by depth keeps the nodes of a level in increasing order
+	unsigned int levels = 0;
+	for (auto it = m_depth.begin(); it != m_depth.end(); ++it)
+		levels = max(levels, *it + 1);
+	m_levelStarts.assign(levels + 1, 0);
+	for (auto it = m_depth.begin(); it != m_depth.end(); ++it)
+		++m_levelStarts[*it + 1];
+	for (unsigned int i = 1; i <= levels; ++i)
+		m_levelStarts[i] += m_levelStarts[i - 1];
+	vector<unsigned int> next(m_levelStarts.begin(), m_levelStarts.end() - 1);
+	m_levelNodes.resize(m_depth.size());
+	for (unsigned int i = 0; i < getNodesCount(); ++i)
+		m_levelNodes[next[m_depth[i]]++] = i;
+	m_levelsValid = true;
+}
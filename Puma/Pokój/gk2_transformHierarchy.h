@@ -0,0 +1,87 @@
+#ifndef __GK2_TRANSFORM_HIERARCHY_H_
+#define __GK2_TRANSFORM_HIERARCHY_H_
+
+#include <d3d11.h>
+#include <xnamath.h>
+#include <vector>
+#include "gk2_aligned.h"
+#include "gk2_threadPool.h"
+
+namespace gk2
+{
+	//World matrices of a tree of transforms, each node's world matrix is its local matrix times the world matrix of
+	//its parent. Nodes are stored in structure of arrays, a node always after its parent, so Update computes the
+	//world matrices in one linear pass: a node is recomputed if its local matrix was set or its parent's world
+	//matrix changed in the same pass. Nothing is done for the clean parts of the tree.
+	class TransformHierarchy
+	{
+	public:
+		//Parent of the roots
+		static const unsigned int NONE = 0xffffffff;
+		//Nodes of a level updated by one task of the parallel update
+		static const unsigned int PARALLEL_CHUNK = 1024;
+
+		TransformHierarchy();
+
+		void Reserve(unsigned int count);
+		//Parent has to be added before, returns the index of the node
+		unsigned int AddNode(unsigned int parent, const XMMATRIX& local = XMMatrixIdentity());
+
+		unsigned int getNodesCount() const { return static_cast<unsigned int>(m_parent.size()); }
+		unsigned int getParent(unsigned int node) const { return m_parent[node]; }
+		unsigned int getDepth(unsigned int node) const { return m_depth[node]; }
+		const XMMATRIX& getLocal(unsigned int node) const { return m_local[node]; }
+		//Marks the subtree of the node dirty
+		void setLocal(unsigned int node, const XMMATRIX& local);
+		//Up to date after Update
+		const XMMATRIX& getWorld(unsigned int node) const { return m_world[node]; }
+		//Whether the world matrix of the node was recomputed by the last Update
+		bool WasUpdated(unsigned int node) const { return m_updated[node] == m_pass; }
+
+		void Update();
+		//Updates the levels of the tree one after another, the nodes of a level in parallel. Pays off for wide trees
+		//of many thousands of nodes, a chain like an arm has one node per level and is better updated serially.
+		void Update(ThreadPool& pool);
+
+	private:
+		AlignedVector<XMMATRIX> m_local;
+		AlignedVector<XMMATRIX> m_world;
+		std::vector<unsigned int> m_parent;
+		std::vector<unsigned int> m_depth;
+		std::vector<unsigned char> m_dirty;
+		//Number of the Update which last recomputed the node
+		std::vector<unsigned int> m_updated;
+		unsigned int m_pass;
+		//Nodes before it are clean
+		unsigned int m_firstDirty;
+
+		//Nodes sorted by depth, the nodes of a level in increasing order, built when the parallel update needs it
+		std::vector<unsigned int> m_levelNodes;
+		//Start of each level in m_levelNodes, and the end of the last one
+		std::vector<unsigned int> m_levelStarts;
+		bool m_levelsValid;
+
+		void UpdateNode(unsigned int node)
+		{
+			unsigned int parent = m_parent[node];
+			if (parent == NONE)
+			{
+				if (!m_dirty[node])
+					return;
+				m_world[node] = m_local[node];
+			}
+			else
+			{
+				if (!m_dirty[node] && m_updated[parent] != m_pass)
+					return;
+				m_world[node] = XMMatrixMultiply(m_local[node], m_world[parent]);
+			}
+			m_dirty[node] = 0;
+			m_updated[node] = m_pass;
+		}
+
+		void BuildLevels();
+	};
+}
+
+#endif __GK2_TRANSFORM_HIERARCHY_H_
@@ -0,0 +1,39 @@
+#ifndef __GK2_BOUNDS_H_
+#define __GK2_BOUNDS_H_
+
+#include <d3d11.h>
+#include <xnamath.h>
+
+namespace gk2
+{
+	struct BoundingBox
+	{
+		XMFLOAT3 Center;
+		XMFLOAT3 Extents;
+
+		BoundingBox() : Center(0.0f, 0.0f, 0.0f), Extents(0.0f, 0.0f, 0.0f) { }
+		BoundingBox(const XMFLOAT3& center, const XMFLOAT3& extents) : Center(center), Extents(extents) { }
+
+		//Bounding box of count points laid out every stride bytes (e.g. &vertices[0].Pos, n, sizeof(Vertex))
+		static BoundingBox FromPoints(const XMFLOAT3* points, unsigned int count, unsigned int stride);
+		//Axis aligned box enclosing this box after transformation by mtx
+		BoundingBox Transform(const XMMATRIX& mtx) const;
+		static BoundingBox Merge(const BoundingBox& b1, const BoundingBox& b2);
+	};
+
+	struct BoundingSphere
+	{
+		XMFLOAT3 Center;
+		float Radius;
+
+		BoundingSphere() : Center(0.0f, 0.0f, 0.0f), Radius(0.0f) { }
+		BoundingSphere(const XMFLOAT3& center, float radius) : Center(center), Radius(radius) { }
+
+		//Sphere centered in box's center enclosing all of the points
+		static BoundingSphere FromPoints(const XMFLOAT3* points, unsigned int count, unsigned int stride,
+										 const BoundingBox& box);
+		BoundingSphere Transform(const XMMATRIX& mtx) const;
+	};
+}
+
+#endif __GK2_BOUNDS_H_
@@ -20,7 +20,7 @@ ConstantBufferBase::ConstantBufferBase(DeviceHelper& device, unsigned int dataSi
 	m_bufferObject = device.CreateBuffer(desc);
 }
 
-void ConstantBufferBase::Map(const shared_ptr<ID3D11DeviceContext>& context)
+void ConstantBufferBase::Map(const shared_ptr<RenderContext>& context)
 {
 	if (m_mapped++)
 		return;
@@ -29,14 +29,14 @@ void ConstantBufferBase::Map(const shared_ptr<ID3D11DeviceContext>& context)
 		THROW_DX11(hr);
 }
 
-void ConstantBufferBase::Unmap(const shared_ptr<ID3D11DeviceContext>& context)
+void ConstantBufferBase::Unmap(const shared_ptr<RenderContext>& context)
 {
 	if (!m_mapped || --m_mapped)
 		return;
 	context->Unmap(m_bufferObject.get(), 0);
 }
 
-void ConstantBufferBase::Update(const shared_ptr<ID3D11DeviceContext>& context, const void* dataPtr, unsigned int dataCount)
+void ConstantBufferBase::Update(const shared_ptr<RenderContext>& context, const void* dataPtr, unsigned int dataCount)
 {
 	if (!dataCount)
 		return;
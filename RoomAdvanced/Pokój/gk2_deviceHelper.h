@@ -7,6 +7,9 @@
 #include <string>
 #include <vector>
 #include <D3Dcompiler.h>
+#include "gk2_assetCache.h"
+#include "gk2_shaderCache.h"
+#include "gk2_textureCooker.h"
 
 namespace gk2
 {
@@ -20,9 +23,21 @@ namespace gk2
 
 		const std::shared_ptr<ID3D11Device>& getDeviceObject() const { return m_deviceObject; }
 		void setDeviceObject(const std::shared_ptr<ID3D11Device>& deviceObject) { m_deviceObject = deviceObject; }
+		//When set, textures loaded from files are cooked once (with mipmaps, as DDS) and kept in the cache
+		const std::shared_ptr<gk2::AssetCache>& getAssetCache() const { return m_assetCache; }
+		void setAssetCache(const std::shared_ptr<gk2::AssetCache>& cache) { m_assetCache = cache; }
+		//When set, compiled shaders are looked up in and stored to the cache
+		const std::shared_ptr<gk2::ShaderCache>& getShaderCache() const { return m_shaderCache; }
+		void setShaderCache(const std::shared_ptr<gk2::ShaderCache>& cache) { m_shaderCache = cache; }
 
 		std::shared_ptr<ID3DBlob> CompileD3DShader(const std::wstring& filePath, const std::string&  entry,
-												   const std::string&  shaderModel);
+												   const std::string&  shaderModel,
+												   const D3D10_SHADER_MACRO* defines = nullptr);
+		//Flags used to compile shaders in the current configuration
+		static unsigned int ShaderCompileFlags();
+		//gk2::ShaderCompiler based on D3DCompile, doesn't need a device
+		static void CompileShader(const gk2::ShaderDesc& desc, const std::vector<BYTE>& source,
+								  std::vector<BYTE>& byteCode, std::vector<std::wstring>& includes);
 		std::shared_ptr<ID3D11VertexShader> CreateVertexShader(std::shared_ptr<ID3DBlob> byteCode);
 		std::shared_ptr<ID3D11GeometryShader> CreateGeometryShader(std::shared_ptr<ID3DBlob> byteCode);
 		std::shared_ptr<ID3D11PixelShader> CreatePixelShader(std::shared_ptr<ID3DBlob> byteCode);
@@ -85,6 +100,12 @@ namespace gk2
 																	const std::shared_ptr<ID3D11Texture2D>& texture,
 																	const D3D11_SHADER_RESOURCE_VIEW_DESC& desc);
 		std::shared_ptr<ID3D11ShaderResourceView> CreateShaderResourceView(const std::wstring& fileName);
+		//Creates texture from contents of an image file already read into memory
+		std::shared_ptr<ID3D11ShaderResourceView> CreateShaderResourceView(const std::vector<BYTE>& fileData);
+		//Texture from a DDS file already cooked on a loader thread, e.g. by AssetLoader::CookTexture
+		std::shared_ptr<ID3D11ShaderResourceView> CreateCookedShaderResourceView(const std::vector<BYTE>& dds);
+		//Texture of an image generated at runtime, cooked the same way as image files
+		std::shared_ptr<ID3D11ShaderResourceView> CreateShaderResourceView(const gk2::TextureCooker::Image& image);
 		D3D11_SAMPLER_DESC DefaultSamplerDesc();
 		std::shared_ptr<ID3D11SamplerState> CreateSamplerState(const D3D11_SAMPLER_DESC& desc);
 		std::shared_ptr<ID3D11Texture2D> CreateDepthStencilTexture(SIZE size);
@@ -101,6 +122,12 @@ namespace gk2
 
 	private:
 		std::shared_ptr<ID3D11Device> m_deviceObject;
+		std::shared_ptr<gk2::AssetCache> m_assetCache;
+		std::shared_ptr<gk2::ShaderCache> m_shaderCache;
+
+		std::vector<BYTE> CookTexture(const std::vector<BYTE>& fileData);
+		gk2::TextureCooker::Image DecodeImage(const std::vector<BYTE>& fileData);
+		std::shared_ptr<ID3D11ShaderResourceView> _CreateShaderResourceViewInternal(const std::vector<BYTE>& fileData);
 
 		std::shared_ptr<ID3D11Buffer> _CreateBufferInternal(const void* pData, unsigned int byteWidth,
 			D3D11_BIND_FLAG bindFlags, D3D11_USAGE usage);
@@ -4,8 +4,8 @@
 using namespace std;
 using namespace gk2;
 
-EffectBase::EffectBase(shared_ptr<ID3D11DeviceContext> context /* = nullptr */)
-	: m_context(context)
+EffectBase::EffectBase(shared_ptr<RenderContext> context /* = nullptr */)
+	: m_context(context), m_features(0)
 {
 }
 
@@ -28,14 +28,23 @@ void EffectBase::SetProjMtxBuffer(const shared_ptr<CBMatrix>& proj)
 }
 
 
-void EffectBase::Begin(std::shared_ptr<ID3D11DeviceContext> context /* = nullptr */)
+void EffectBase::Begin(std::shared_ptr<RenderContext> context /* = nullptr */)
 {
 	if (context != nullptr && context != m_context)
 		m_context = context;
 	if (m_context == nullptr)
 		return;
-	m_context->VSSetShader(m_vs.get(), nullptr, 0);
-	m_context->PSSetShader(m_ps.get(), nullptr, 0);
+	if (m_permutations != nullptr)
+	{
+		const ShaderPermutations::Variant& variant = m_permutations->Get(m_features);
+		m_context->VSSetShader(variant.VertexShader.get(), nullptr, 0);
+		m_context->PSSetShader(variant.PixelShader.get(), nullptr, 0);
+	}
+	else
+	{
+		m_context->VSSetShader(m_vs.get(), nullptr, 0);
+		m_context->PSSetShader(m_ps.get(), nullptr, 0);
+	}
 	m_context->IASetInputLayout(m_layout.get());
 	SetVertexShaderData();
 	SetPixelShaderData();
@@ -52,6 +61,21 @@ void EffectBase::Initialize(DeviceHelper& device, shared_ptr<ID3D11InputLayout>&
 	shared_ptr<ID3DBlob> psByteCode = device.CompileD3DShader(shaderFile, "PS_Main", "ps_4_0");
 	m_vs = device.CreateVertexShader(vsByteCode);
 	m_ps = device.CreatePixelShader(psByteCode);
+	InitializeLayout(device, layout, vsByteCode);
+}
+
+void EffectBase::Initialize(DeviceHelper& device, shared_ptr<ID3D11InputLayout>& layout,
+							const shared_ptr<ShaderPermutations>& permutations, unsigned int features)
+{
+	m_permutations = permutations;
+	m_features = features;
+	//All the variants share the vertex input signature
+	InitializeLayout(device, layout, m_permutations->Get(m_features).VSByteCode);
+}
+
+void EffectBase::InitializeLayout(DeviceHelper& device, shared_ptr<ID3D11InputLayout>& layout,
+								  const shared_ptr<ID3DBlob>& vsByteCode)
+{
 	if (layout == nullptr)
 	{
 		m_layout = device.CreateInputLayout<VertexPosNormal>(vsByteCode);
@@ -4,6 +4,7 @@
 #include <d3d11.h>
 #include "gk2_deviceHelper.h"
 #include "gk2_constantBuffer.h"
+#include "gk2_shaderPermutations.h"
 #include <memory>
 #include <string>
 
@@ -16,11 +17,11 @@ namespace gk2
 		void SetViewMtxBuffer(const std::shared_ptr<gk2::CBMatrix>& view);
 		void SetProjMtxBuffer(const std::shared_ptr<gk2::CBMatrix>& proj);
 
-		void Begin(std::shared_ptr<ID3D11DeviceContext> context = nullptr);
+		void Begin(std::shared_ptr<gk2::RenderContext> context = nullptr);
 		void End();
 
 	protected:
-		EffectBase(std::shared_ptr<ID3D11DeviceContext> context = nullptr);
+		EffectBase(std::shared_ptr<gk2::RenderContext> context = nullptr);
 
 		virtual void SetVertexShaderData() = 0;
 		virtual void SetPixelShaderData() = 0;
@@ -28,15 +29,24 @@ namespace gk2
 		std::shared_ptr<gk2::CBMatrix> m_worldCB;
 		std::shared_ptr<gk2::CBMatrix> m_viewCB;
 		std::shared_ptr<gk2::CBMatrix> m_projCB;
-		std::shared_ptr<ID3D11DeviceContext> m_context;
+		std::shared_ptr<gk2::RenderContext> m_context;
 
 		void Initialize(gk2::DeviceHelper& device, std::shared_ptr<ID3D11InputLayout>& layout,
 						const std::wstring& shaderFile);
+		//Shaders are looked up in permutations by m_features on every Begin call
+		void Initialize(gk2::DeviceHelper& device, std::shared_ptr<ID3D11InputLayout>& layout,
+						const std::shared_ptr<gk2::ShaderPermutations>& permutations, unsigned int features);
+
+		unsigned int m_features;
 
 	private:
+		std::shared_ptr<gk2::ShaderPermutations> m_permutations;
 		std::shared_ptr<ID3D11VertexShader> m_vs;
 		std::shared_ptr<ID3D11PixelShader> m_ps;
 		std::shared_ptr<ID3D11InputLayout> m_layout;
+
+		void InitializeLayout(gk2::DeviceHelper& device, std::shared_ptr<ID3D11InputLayout>& layout,
+							  const std::shared_ptr<ID3DBlob>& vsByteCode);
 	};
 }
 
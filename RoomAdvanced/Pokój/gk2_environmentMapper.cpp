@@ -1,20 +1,21 @@
 #include "gk2_environmentMapper.h"
+#include "gk2_materialEffect.h"
 
 using namespace std;
 using namespace gk2;
 
-const wstring EnvironmentMapper::ShaderFile = L"resources/shaders/EnvMapShader.hlsl";
 const int EnvironmentMapper::TEXTURE_SIZE = 256;
 
 EnvironmentMapper::EnvironmentMapper(DeviceHelper& device, shared_ptr<ID3D11InputLayout>& layout,
-	const shared_ptr<ID3D11DeviceContext>& context, float nearPlane, float farPlane, XMFLOAT3 pos)
+	const shared_ptr<ShaderPermutations>& materialShaders, const shared_ptr<RenderContext>& context,
+	float nearPlane, float farPlane, XMFLOAT3 pos)
 	: EffectBase(context)
 {
-	Initialize(device, layout, ShaderFile);
+	Initialize(device, layout, materialShaders, MaterialEffect::ENV_MAP | MaterialEffect::SURFACE_COLOR);
 	m_nearPlane = nearPlane;
 	m_farPlane = farPlane;
 	m_position = XMFLOAT4(pos.x, pos.y, pos.z, 1.0f);
-	m_face = (D3D11_TEXTURECUBE_FACE)-1;
+	XMStoreFloat4x4(&m_faceViewProj, XMMatrixIdentity());
 	InitializeTextures(device);
 }
 
@@ -23,17 +24,7 @@ void EnvironmentMapper::InitializeTextures(DeviceHelper& device)
 	D3D11_TEXTURE2D_DESC texDesc = device.DefaultTexture2DDesc();
 	texDesc.Width = TEXTURE_SIZE;
 	texDesc.Height = TEXTURE_SIZE;
-	texDesc.BindFlags = D3D11_BIND_RENDER_TARGET;
 	texDesc.MipLevels = 1;
-
-
-	m_envFaceRenderTexture = device.CreateTexture2D(texDesc);
-	m_envFaceRenderTarget = device.CreateRenderTargetView(m_envFaceRenderTexture);
-	SIZE s;
-	s.cx = s.cy = TEXTURE_SIZE;
-	m_envFaceDepthTexture = device.CreateDepthStencilTexture(s);
-	m_envFaceDepthView = device.CreateDepthStencilView(m_envFaceDepthTexture);
-
 	texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
 	texDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
 	texDesc.ArraySize = 6;
@@ -48,13 +39,14 @@ void EnvironmentMapper::InitializeTextures(DeviceHelper& device)
 	m_envTextureView = device.CreateShaderResourceView(m_envTexture, srvDesc);
 }
 
-void EnvironmentMapper::SetupFace(const shared_ptr<ID3D11DeviceContext>& context, D3D11_TEXTURECUBE_FACE face)
+void EnvironmentMapper::SetupFace(const shared_ptr<RenderContext>& context, D3D11_TEXTURECUBE_FACE face,
+								  const shared_ptr<ID3D11RenderTargetView>& renderTarget,
+								  const shared_ptr<ID3D11DepthStencilView>& depthStencil)
 {
 	if (context != nullptr && context != m_context)
 		m_context = context;
 	if (m_context == nullptr)
 		return;
-	m_face = face;
 	XMFLOAT3 eyeDirection;
 	XMFLOAT3 upDirection;
 	switch (face)
@@ -87,9 +79,11 @@ void EnvironmentMapper::SetupFace(const shared_ptr<ID3D11DeviceContext>& context
 		break;
 	}
 
-	m_viewCB->Update(m_context, XMMatrixLookToLH(XMLoadFloat4(&m_position), XMLoadFloat3(&eyeDirection), XMLoadFloat3(&upDirection)));
-
-	m_projCB->Update(m_context, XMMatrixPerspectiveFovLH(XM_PIDIV2, 1, m_nearPlane, m_farPlane));
+	XMMATRIX view = XMMatrixLookToLH(XMLoadFloat4(&m_position), XMLoadFloat3(&eyeDirection), XMLoadFloat3(&upDirection));
+	XMMATRIX proj = XMMatrixPerspectiveFovLH(XM_PIDIV2, 1, m_nearPlane, m_farPlane);
+	m_viewCB->Update(m_context, view);
+	m_projCB->Update(m_context, proj);
+	XMStoreFloat4x4(&m_faceViewProj, view * proj);
 
 	D3D11_VIEWPORT viewport;
 
@@ -101,19 +95,19 @@ void EnvironmentMapper::SetupFace(const shared_ptr<ID3D11DeviceContext>& context
 	viewport.MaxDepth = 1;
 
 	m_context->RSSetViewports(1, &viewport);
-	ID3D11RenderTargetView* targets[1] = { m_envFaceRenderTarget.get() };
-	m_context->OMSetRenderTargets(1, targets, m_envFaceDepthView.get());
+	ID3D11RenderTargetView* targets[1] = { renderTarget.get() };
+	m_context->OMSetRenderTargets(1, targets, depthStencil.get());
 	float clearColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
-	m_context->ClearRenderTargetView(m_envFaceRenderTarget.get(), clearColor);
-	m_context->ClearDepthStencilView(m_envFaceDepthView.get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+	m_context->ClearRenderTargetView(renderTarget.get(), clearColor);
+	m_context->ClearDepthStencilView(depthStencil.get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
 }
 
-void EnvironmentMapper::EndFace()
+void EnvironmentMapper::EndFace(D3D11_TEXTURECUBE_FACE face, const shared_ptr<ID3D11Texture2D>& faceTexture)
 {
-	if (m_face < 0 || m_face > 5)
+	if (face < 0 || face > 5)
 		return;
 
-	m_context->CopySubresourceRegion(m_envTexture.get(), m_face, 0, 0, 0, m_envFaceRenderTexture.get(), 0, 0);
+	m_context->CopySubresourceRegion(m_envTexture.get(), face, 0, 0, 0, faceTexture.get(), 0, 0);
 }
 
 void EnvironmentMapper::SetSamplerState(const shared_ptr<ID3D11SamplerState>& samplerState)
@@ -136,9 +130,11 @@ void EnvironmentMapper::SetSurfaceColorBuffer(const shared_ptr<ConstantBuffer<XM
 
 void EnvironmentMapper::SetVertexShaderData()
 {
-	ID3D11Buffer* vsb[4] = { m_worldCB->getBufferObject().get(), m_viewCB->getBufferObject().get(),
-		m_projCB->getBufferObject().get(), m_cameraPosCB->getBufferObject().get() };
-	m_context->VSSetConstantBuffers(0, 4, vsb);
+	ID3D11Buffer* vsb[3] = { m_worldCB->getBufferObject().get(), m_viewCB->getBufferObject().get(),
+		m_projCB->getBufferObject().get() };
+	m_context->VSSetConstantBuffers(0, 3, vsb);
+	ID3D11Buffer* cameraPos = m_cameraPosCB->getBufferObject().get();
+	m_context->VSSetConstantBuffers(6, 1, &cameraPos);
 }
 
 void EnvironmentMapper::SetPixelShaderData()
@@ -148,5 +144,5 @@ void EnvironmentMapper::SetPixelShaderData()
 	ID3D11SamplerState* ss[1] = { m_samplerState.get() };
 	m_context->PSSetSamplers(0, 1, ss);
 	ID3D11ShaderResourceView* srv[1] = { m_envTextureView.get() };
-	m_context->PSSetShaderResources(0, 1, srv);
+	m_context->PSSetShaderResources(2, 1, srv);
 }
\ No newline at end of file
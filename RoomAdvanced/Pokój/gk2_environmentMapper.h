@@ -13,15 +13,26 @@ namespace gk2
 	class EnvironmentMapper : public EffectBase
 	{
 	public:
+		//Uses the ENV_MAP | SURFACE_COLOR variant of the material shaders
 		EnvironmentMapper(gk2::DeviceHelper& device, std::shared_ptr<ID3D11InputLayout>& layout,
-						  const std::shared_ptr<ID3D11DeviceContext>& context, float nearP, float farP, XMFLOAT3 pos);
+						  const std::shared_ptr<gk2::ShaderPermutations>& materialShaders,
+						  const std::shared_ptr<gk2::RenderContext>& context, float nearP, float farP, XMFLOAT3 pos);
 		
 		void SetSamplerState(const std::shared_ptr<ID3D11SamplerState>& samplerState);
 		void SetCameraPosBuffer(const std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4>>& cameraPos);
 		void SetSurfaceColorBuffer(const std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4>>& surfaceColor);
 
-		void SetupFace(const std::shared_ptr<ID3D11DeviceContext>& context, D3D11_TEXTURECUBE_FACE face);
-		void EndFace();
+		//Faces are drawn to a texture of getTextureSize() which EndFace copies into the cube map. Both targets
+		//belong to the caller, so they can be transient textures of a frame graph.
+		void SetupFace(const std::shared_ptr<gk2::RenderContext>& context, D3D11_TEXTURECUBE_FACE face,
+					   const std::shared_ptr<ID3D11RenderTargetView>& renderTarget,
+					   const std::shared_ptr<ID3D11DepthStencilView>& depthStencil);
+		void EndFace(D3D11_TEXTURECUBE_FACE face, const std::shared_ptr<ID3D11Texture2D>& faceTexture);
+		unsigned int getTextureSize() const { return TEXTURE_SIZE; }
+		//View * projection matrix of the face set up by the last SetupFace call
+		const XMFLOAT4X4& getFaceViewProjMtx() const { return m_faceViewProj; }
+		const XMFLOAT4& getPosition() const { return m_position; }
+		float getFarPlane() const { return m_farPlane; }
 		
 	protected:
 		virtual void SetVertexShaderData();
@@ -29,7 +40,6 @@ namespace gk2
 
 	private:
 		static const int TEXTURE_SIZE;
-		static const std::wstring ShaderFile;
 
 		std::shared_ptr<ID3D11SamplerState> m_samplerState;
 		std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4>> m_cameraPosCB;
@@ -37,15 +47,11 @@ namespace gk2
 
 		std::shared_ptr<ID3D11Texture2D> m_envTexture;
 		std::shared_ptr<ID3D11ShaderResourceView> m_envTextureView;
-		std::shared_ptr<ID3D11Texture2D> m_envFaceRenderTexture;
-		std::shared_ptr<ID3D11RenderTargetView> m_envFaceRenderTarget;
-		std::shared_ptr<ID3D11Texture2D> m_envFaceDepthTexture;
-		std::shared_ptr<ID3D11DepthStencilView> m_envFaceDepthView;
 		
 		float m_nearPlane;
 		float m_farPlane;
 		XMFLOAT4 m_position;
-		D3D11_TEXTURECUBE_FACE m_face;
+		XMFLOAT4X4 m_faceViewProj;
 
 		void InitializeTextures(gk2::DeviceHelper& device);
 	};
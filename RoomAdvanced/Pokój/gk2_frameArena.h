@@ -0,0 +1,175 @@
+#ifndef __GK2_FRAME_ARENA_H_
+#define __GK2_FRAME_ARENA_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+
+#ifndef GK2_THREAD_LOCAL
+#ifdef _MSC_VER
+#define GK2_THREAD_LOCAL __declspec(thread)
+#else
+#define GK2_THREAD_LOCAL thread_local
+#endif
+#endif
+
+namespace gk2
+{
+	//Bump allocator for temporaries which live no longer than a frame. Every thread has its own arena, allocating
+	//moves a pointer and freeing does nothing. The main loop resets its thread's arena when a frame ends, other
+	//threads give the memory back with Scope. An arena grows by blocks and merges them into one on reset, so after
+	//the first frames it never calls the heap again. With poisoning on, the freed memory is overwritten with
+	//POISON, so temporaries used after their frame show up.
+	class FrameArena
+	{
+	public:
+		//Alignment of all allocations, enough for XMVECTOR and XMMATRIX
+		static const size_t ALIGNMENT = 16;
+		static const size_t DEFAULT_BLOCK_SIZE = 1 << 20;
+		static const unsigned char POISON = 0xDD;
+
+		struct Marker
+		{
+			size_t Block;
+			size_t Offset;
+			size_t Used;
+		};
+
+		//Rewinds the arena of the thread to where it was when the scope was created
+		class Scope
+		{
+		public:
+			Scope() : m_arena(getThreadArena()), m_marker(m_arena.getMarker()) { }
+			explicit Scope(FrameArena& arena) : m_arena(arena), m_marker(arena.getMarker()) { }
+			~Scope() { m_arena.Rewind(m_marker); }
+
+		private:
+			FrameArena& m_arena;
+			Marker m_marker;
+
+			Scope(const Scope&);
+			Scope& operator =(const Scope&);
+		};
+
+		explicit FrameArena(size_t blockSize = DEFAULT_BLOCK_SIZE);
+
+		//Arena of the calling thread, created on first use
+		static FrameArena& getThreadArena();
+		//Resets the arena of the calling thread, called by the main loop when the frame ends
+		static void EndFrame();
+		//Frame peaks of the arenas of all threads
+		static void WriteStatistics(std::wostream& s);
+
+		//Alignment has to be a power of two. Throws std::bad_alloc if a new block can't be allocated.
+		void* Allocate(size_t bytes, size_t alignment = ALIGNMENT);
+
+		//Uninitialized array, for plain data only
+		template<typename T>
+		T* AllocateArray(size_t count)
+		{
+			if (count > static_cast<size_t>(-1) / sizeof(T))
+				throw std::bad_alloc();
+			size_t alignment = std::alignment_of<T>::value;
+			if (alignment < ALIGNMENT)
+				alignment = ALIGNMENT;
+			return static_cast<T*>(Allocate(count * sizeof(T), alignment));
+		}
+
+		Marker getMarker() const;
+		//Frees everything allocated after the marker was taken
+		void Rewind(const Marker& marker);
+		//Frees everything and starts a new frame
+		void Reset();
+
+		bool getPoisoning() const { return m_poisoning; }
+		//On by default in debug builds
+		void setPoisoning(bool poisoning) { m_poisoning = poisoning; }
+
+		//Bytes in use, including alignment padding
+		size_t getUsedBytes() const { return m_used; }
+		size_t getCapacity() const { return m_capacity.load(std::memory_order_relaxed); }
+		//Most bytes in use at once during the last finished frame
+		size_t getLastFramePeak() const { return m_lastFramePeak.load(std::memory_order_relaxed); }
+		//Most bytes in use at once since the arena was created, also for threads which never end a frame
+		size_t getPeakBytes() const { return m_peak.load(std::memory_order_relaxed); }
+
+	private:
+		struct Block
+		{
+			std::shared_ptr<unsigned char> Memory;
+			size_t Size;
+			//Bytes taken, only up to date for the blocks before the current one
+			size_t Offset;
+		};
+
+		GK2_THREAD_LOCAL static FrameArena* s_threadArena;
+
+		size_t m_blockSize;
+		std::vector<Block> m_blocks;
+		size_t m_current;
+		size_t m_offset;
+		size_t m_used;
+		size_t m_framePeak;
+		std::atomic<size_t> m_capacity;
+		std::atomic<size_t> m_lastFramePeak;
+		std::atomic<size_t> m_peak;
+		bool m_poisoning;
+
+		static FrameArena* CreateThreadArena();
+		void AddBlock(size_t size);
+		//Overwrites the memory between the marker and the current position
+		void Poison(const Marker& marker);
+
+		FrameArena(const FrameArena&);
+		FrameArena& operator =(const FrameArena&);
+	};
+
+	//STL allocator which takes memory from a frame arena. Containers using it must not outlive the frame or scope
+	//of the allocation, deallocation is a no-op.
+	template<typename T>
+	class FrameAllocator
+	{
+	public:
+		typedef T value_type;
+		typedef T* pointer;
+		typedef const T* const_pointer;
+		typedef T& reference;
+		typedef const T& const_reference;
+		typedef size_t size_type;
+		typedef ptrdiff_t difference_type;
+
+		template<typename U>
+		struct rebind
+		{
+			typedef FrameAllocator<U> other;
+		};
+
+		FrameAllocator() : m_arena(&FrameArena::getThreadArena()) { }
+		explicit FrameAllocator(FrameArena& arena) : m_arena(&arena) { }
+		template<typename U>
+		FrameAllocator(const FrameAllocator<U>& other) : m_arena(other.getArena()) { }
+
+		T* allocate(size_t count) { return m_arena->AllocateArray<T>(count); }
+		void deallocate(T*, size_t) { }
+
+		FrameArena* getArena() const { return m_arena; }
+
+	private:
+		FrameArena* m_arena;
+	};
+
+	template<typename T, typename U>
+	bool operator ==(const FrameAllocator<T>& a, const FrameAllocator<U>& b) { return a.getArena() == b.getArena(); }
+
+	template<typename T, typename U>
+	bool operator !=(const FrameAllocator<T>& a, const FrameAllocator<U>& b) { return a.getArena() != b.getArena(); }
+
+	template<typename T>
+	using FrameVector = std::vector<T, FrameAllocator<T>>;
+}
+
+#endif __GK2_FRAME_ARENA_H_
@@ -0,0 +1,131 @@
+#ifndef __GK2_FRAME_GRAPH_H_
+#define __GK2_FRAME_GRAPH_H_
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace gk2
+{
+	//Describes the passes of a frame by the resources they read and write. Compile culls the passes whose
+	//results never reach an output, orders the rest so that every pass runs after the passes it depends on
+	//and assigns transient textures with disjoint lifetimes to the same physical texture. Of the passes which
+	//are ready to run, the ones using transient textures which are already alive go first, so that the
+	//lifetimes are short and more textures can share memory. The graph only deals with ids, so it doesn't
+	//need a device.
+	class FrameGraph
+	{
+	public:
+		static const unsigned int NO_PHYSICAL = 0xffffffff;
+
+		struct TextureDesc
+		{
+			unsigned int Width;
+			unsigned int Height;
+			//DXGI_FORMAT and D3D11_BIND_FLAG values
+			unsigned int Format;
+			unsigned int BindFlags;
+
+			bool operator ==(const TextureDesc& other) const
+			{
+				return Width == other.Width && Height == other.Height && Format == other.Format &&
+					   BindFlags == other.BindFlags;
+			}
+		};
+
+		struct TimelineEntry
+		{
+			unsigned int Pass;
+			//Milliseconds since the start of Execute
+			double Start;
+			double Duration;
+		};
+
+		//Returns time in milliseconds
+		typedef std::function<double()> Clock;
+
+		FrameGraph();
+
+		//Resource owned by the application, e.g. the back buffer
+		unsigned int Import(const std::string& name);
+		//Texture which lives only during the frame. Its contents are undefined before the first write.
+		unsigned int Create(const std::string& name, const TextureDesc& desc);
+		//Name of the pass is also the name of its profiler zone, so it has to live as long as the program: a literal
+		//or a string from Profiler::Intern, interned once and not every frame
+		unsigned int AddPass(const char* name, const std::function<void()>& execute);
+		//A pass sees resources as they were left by the passes added before it. A write also depends on the
+		//previous contents of the resource, like drawing to a render target does.
+		void Read(unsigned int pass, unsigned int resource);
+		void Write(unsigned int pass, unsigned int resource);
+		//Pass has to run after the other one even though they share no resource, e.g. when both use state the
+		//graph doesn't know about. Doesn't keep the other pass from being culled.
+		void DependsOn(unsigned int pass, unsigned int other);
+		//Contents of the resource after the frame are needed, passes which don't contribute to any output
+		//are culled
+		void MarkOutput(unsigned int resource);
+		//Removes all the passes and resources
+		void Clear();
+
+		//Throws std::logic_error if the dependencies of the passes which aren't culled form a cycle
+		void Compile();
+		void Execute(const Clock& clock = Clock());
+
+		unsigned int getPassCount() const { return static_cast<unsigned int>(m_passes.size()); }
+		const char* getPassName(unsigned int pass) const { return m_passes[pass].Name; }
+		const std::string& getResourceName(unsigned int resource) const { return m_resources[resource].Name; }
+		bool isCulled(unsigned int pass) const { return m_passes[pass].Culled; }
+		//Valid after Compile
+		const std::vector<unsigned int>& getOrder() const { return m_order; }
+		//Physical texture of a transient resource, NO_PHYSICAL for imported ones and the ones no pass uses
+		unsigned int getPhysical(unsigned int resource) const { return m_resources[resource].Physical; }
+		const std::vector<TextureDesc>& getPhysicalTextures() const { return m_physical; }
+		//Valid after Execute
+		const std::vector<TimelineEntry>& getTimeline() const { return m_timeline; }
+		//Passes in the order they ran with their times, culled passes and the physical textures
+		void WriteTimeline(std::wostream& s) const;
+
+	private:
+		struct Resource
+		{
+			std::string Name;
+			bool Imported;
+			bool Output;
+			TextureDesc Desc;
+			unsigned int Physical;
+			//Range of m_order during which a transient texture is used, outputs are used until the end of the frame
+			unsigned int FirstUse;
+			unsigned int LastUse;
+		};
+
+		struct Pass
+		{
+			const char* Name;
+			std::function<void()> Execute;
+			std::vector<unsigned int> Reads;
+			std::vector<unsigned int> Writes;
+			//Passes given to DependsOn
+			std::vector<unsigned int> Dependencies;
+			//Passes whose results this one uses
+			std::vector<unsigned int> Inputs;
+			//Passes which have to run before this one: the inputs, the readers of resources it overwrites and the
+			//dependencies
+			std::vector<unsigned int> After;
+			bool Culled;
+		};
+
+		std::vector<Resource> m_resources;
+		std::vector<Pass> m_passes;
+		std::vector<unsigned int> m_order;
+		std::vector<TextureDesc> m_physical;
+		std::vector<TimelineEntry> m_timeline;
+
+		//lastWriters receive the last pass writing each resource
+		void FindDependencies(std::vector<unsigned int>& lastWriters);
+		void Cull(const std::vector<unsigned int>& lastWriters);
+		void Sort();
+		void AssignPhysical();
+	};
+}
+
+#endif __GK2_FRAME_GRAPH_H_
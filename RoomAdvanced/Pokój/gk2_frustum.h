@@ -0,0 +1,51 @@
+#ifndef __GK2_FRUSTUM_H_
+#define __GK2_FRUSTUM_H_
+
+#include <d3d11.h>
+#include <xnamath.h>
+#include <vector>
+#include "gk2_bounds.h"
+
+namespace gk2
+{
+	class Frustum
+	{
+	public:
+		static const unsigned int PLANES_COUNT = 6;
+
+		enum Containment { OUTSIDE = 0, INTERSECTS, INSIDE };
+
+		Frustum();
+		Frustum(const XMMATRIX& viewProj);
+
+		//Extracts normalized clipping planes (normals pointing inside) from view * projection matrix
+		void Update(const XMMATRIX& viewProj);
+
+		bool Intersects(const gk2::BoundingBox& box) const;
+		bool Intersects(const gk2::BoundingSphere& sphere) const;
+		Containment Classify(const gk2::BoundingBox& box) const;
+
+		//Tests count boxes (or spheres) four at a time. Bit i%32 of visibility[i/32] is set if i-th
+		//volume intersects the frustum. Returns the number of visible volumes.
+		unsigned int Test(const gk2::BoundingBox* boxes, unsigned int count,
+						  std::vector<unsigned int>& visibility) const;
+		unsigned int Test(const gk2::BoundingSphere* spheres, unsigned int count,
+						  std::vector<unsigned int>& visibility) const;
+
+		static bool IsVisible(const std::vector<unsigned int>& visibility, unsigned int i)
+		{
+			return (visibility[i >> 5] & (1u << (i & 31))) != 0;
+		}
+
+		const XMFLOAT4& getPlane(unsigned int i) const { return m_planes[i]; }
+
+	private:
+		XMFLOAT4 m_planes[PLANES_COUNT];
+		XMFLOAT4 m_absPlanes[PLANES_COUNT];
+
+		unsigned int TestBatch(FXMVECTOR cx, FXMVECTOR cy, FXMVECTOR cz,
+							   CXMVECTOR ex, CXMVECTOR ey, CXMVECTOR ez) const;
+	};
+}
+
+#endif __GK2_FRUSTUM_H_
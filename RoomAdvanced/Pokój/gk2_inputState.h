@@ -0,0 +1,114 @@
+#ifndef __GK2_INPUT_STATE_H_
+#define __GK2_INPUT_STATE_H_
+
+#include <dinput.h>
+#include <cassert>
+#include <cstring>
+
+namespace gk2
+{
+	struct KeyboardState
+	{
+	public:
+		static const unsigned int STATE_TAB_LENGTH = 256;
+		static const BYTE KEY_MASK = 0x80;
+
+		BYTE m_keys[STATE_TAB_LENGTH];
+
+		KeyboardState()
+		{
+			ZeroMemory(m_keys, STATE_TAB_LENGTH*sizeof(char));
+		}
+
+		KeyboardState(const KeyboardState& other)
+		{
+			memcpy(m_keys, other.m_keys, STATE_TAB_LENGTH*sizeof(char));
+		}
+
+		KeyboardState& operator=(const KeyboardState& other)
+		{
+			memcpy(m_keys, other.m_keys, STATE_TAB_LENGTH*sizeof(char));
+			return *this;
+		}
+
+		inline bool isKeyDown(BYTE keyCode) const
+		{
+			return 0 != (m_keys[keyCode] & KEY_MASK);
+		}
+
+		inline bool isKeyUp(BYTE keyCode) const
+		{
+			return 0 == (m_keys[keyCode] & KEY_MASK);
+		}
+
+		bool operator[](BYTE keyCode) const
+		{
+			return 0 != (m_keys[keyCode] & KEY_MASK);
+		}
+	};
+
+	struct MouseState
+	{
+	public:
+
+		enum Buttons
+		{
+			Left = 0,
+			Right = 1,
+			Middle = 2
+		};
+
+		static const BYTE BUTTON_MASK = 0x80;
+
+		DIMOUSESTATE m_state;
+
+		MouseState()
+		{
+			ZeroMemory(&m_state, sizeof(DIMOUSESTATE));
+		}
+
+		MouseState(const MouseState& other)
+		{
+			memcpy(&m_state, &other.m_state, sizeof(DIMOUSESTATE));
+		}
+
+		MouseState& operator=(const MouseState& other)
+		{
+			memcpy(&m_state, &other.m_state, sizeof(DIMOUSESTATE));
+			return *this;
+		}
+
+		POINT getMousePositionChange() const
+		{
+			POINT r;
+			r.x = m_state.lX;
+			r.y = m_state.lY;
+			return r;
+		}
+
+		inline LONG getWheelPositionChange() const
+		{
+			return m_state.lZ;
+		}
+
+		inline bool isButtonDown(BYTE button) const
+		{
+			assert(button < 4);
+			return 0 != (m_state.rgbButtons[button] & BUTTON_MASK);
+		}
+
+		inline bool isButtonUp(BYTE button) const
+		{
+			assert(button < 4);
+			return 0 == (m_state.rgbButtons[button] & BUTTON_MASK);
+		}
+
+		bool operator[](BYTE button)
+		{
+			assert(button < 4);
+			return 0 != (m_state.rgbButtons[button] & BUTTON_MASK);
+		}
+	};
+}
+
+#endif __GK2_INPUT_STATE_H_
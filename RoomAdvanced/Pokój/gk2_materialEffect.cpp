@@ -0,0 +1,110 @@
+#include "gk2_materialEffect.h"
+
+using namespace std;
+using namespace gk2;
+
+namespace
+{
+	template<typename T>
+	ID3D11Buffer* BufferObject(const shared_ptr<T>& cb, bool used)
+	{
+		return used && cb != nullptr ? cb->getBufferObject().get() : nullptr;
+	}
+}
+
+const wstring MaterialEffect::ShaderFile = L"resources/shaders/MaterialShader.hlsl";
+
+shared_ptr<ShaderPermutations> MaterialEffect::CreateShaders(const DeviceHelper& device)
+{
+	//Order matches the Feature bits
+	const char* features[] = { "TEXTURE", "SECOND_TEXTURE", "ENV_MAP", "SURFACE_COLOR", "LIGHTING" };
+	return make_shared<ShaderPermutations>(device, ShaderFile,
+		vector<string>(features, features + sizeof(features) / sizeof(features[0])));
+}
+
+MaterialEffect::MaterialEffect(DeviceHelper& device, shared_ptr<ID3D11InputLayout>& layout,
+							   const shared_ptr<ShaderPermutations>& shaders, unsigned int features,
+							   shared_ptr<RenderContext> context /* = nullptr */)
+	: EffectBase(context)
+{
+	Initialize(device, layout, shaders, features);
+}
+
+void MaterialEffect::SetTextureMtxBuffer(const shared_ptr<CBMatrix>& textureMtx)
+{
+	if (textureMtx != nullptr)
+		m_textureMtxCB = textureMtx;
+}
+
+void MaterialEffect::SetSecondTextureMtxBuffer(const shared_ptr<CBMatrix>& textureMtx)
+{
+	if (textureMtx != nullptr)
+		m_secondTextureMtxCB = textureMtx;
+}
+
+void MaterialEffect::SetLightPosBuffer(const shared_ptr<ConstantBuffer<XMFLOAT4, 2>>& lightPos)
+{
+	if (lightPos != nullptr)
+		m_lightPosCB = lightPos;
+}
+
+void MaterialEffect::SetCameraPosBuffer(const shared_ptr<ConstantBuffer<XMFLOAT4>>& cameraPos)
+{
+	if (cameraPos != nullptr)
+		m_cameraPosCB = cameraPos;
+}
+
+void MaterialEffect::SetSurfaceColorBuffer(const shared_ptr<ConstantBuffer<XMFLOAT4>>& surfaceColor)
+{
+	if (surfaceColor != nullptr)
+		m_surfaceColorCB = surfaceColor;
+}
+
+void MaterialEffect::SetSamplerState(const shared_ptr<ID3D11SamplerState>& samplerState)
+{
+	if (samplerState != nullptr)
+		m_samplerState = samplerState;
+}
+
+void MaterialEffect::SetTexture(const shared_ptr<ID3D11ShaderResourceView>& texture)
+{
+	if (texture != nullptr)
+		m_texture = texture;
+}
+
+void MaterialEffect::SetSecondTexture(const shared_ptr<ID3D11ShaderResourceView>& texture)
+{
+	if (texture != nullptr)
+		m_secondTexture = texture;
+}
+
+void MaterialEffect::SetEnvironmentMap(const shared_ptr<ID3D11ShaderResourceView>& envMap)
+{
+	if (envMap != nullptr)
+		m_envMap = envMap;
+}
+
+void MaterialEffect::SetVertexShaderData()
+{
+	ID3D11Buffer* vsb[7] = { m_worldCB->getBufferObject().get(), m_viewCB->getBufferObject().get(),
+							 m_projCB->getBufferObject().get(),
+							 BufferObject(m_textureMtxCB, (m_features & TEXTURE) != 0),
+							 BufferObject(m_secondTextureMtxCB, (m_features & SECOND_TEXTURE) != 0),
+							 BufferObject(m_lightPosCB, (m_features & LIGHTING) != 0),
+							 BufferObject(m_cameraPosCB, (m_features & ENV_MAP) != 0) };
+	m_context->VSSetConstantBuffers(0, 7, vsb);
+}
+
+void MaterialEffect::SetPixelShaderData()
+{
+	ID3D11Buffer* psb[1] = { BufferObject(m_surfaceColorCB, (m_features & SURFACE_COLOR) != 0) };
+	m_context->PSSetConstantBuffers(0, 1, psb);
+	if ((m_features & (TEXTURE | ENV_MAP)) == 0)
+		return;
+	ID3D11SamplerState* ss[1] = { m_samplerState.get() };
+	m_context->PSSetSamplers(0, 1, ss);
+	ID3D11ShaderResourceView* srv[3] = { m_features & TEXTURE ? m_texture.get() : nullptr,
+										 m_features & SECOND_TEXTURE ? m_secondTexture.get() : nullptr,
+										 m_features & ENV_MAP ? m_envMap.get() : nullptr };
+	m_context->PSSetShaderResources(0, 3, srv);
+}
@@ -0,0 +1,60 @@
+#ifndef __GK2_MATERIAL_EFFECT_H_
+#define __GK2_MATERIAL_EFFECT_H_
+
+#include "gk2_effectBase.h"
+
+namespace gk2
+{
+	//Effect of all the room materials. Material is a combination of features, each feature enables
+	//a part of MaterialShader.hlsl and uses only the resources it needs.
+	class MaterialEffect : public EffectBase
+	{
+	public:
+		enum Feature
+		{
+			TEXTURE = 1 << 0,
+			SECOND_TEXTURE = 1 << 1,
+			ENV_MAP = 1 << 2,
+			SURFACE_COLOR = 1 << 3,
+			LIGHTING = 1 << 4
+		};
+
+		static std::shared_ptr<gk2::ShaderPermutations> CreateShaders(const gk2::DeviceHelper& device);
+
+		MaterialEffect(gk2::DeviceHelper& device, std::shared_ptr<ID3D11InputLayout>& layout,
+					   const std::shared_ptr<gk2::ShaderPermutations>& shaders, unsigned int features,
+					   std::shared_ptr<gk2::RenderContext> context = nullptr);
+
+		unsigned int getFeatures() const { return m_features; }
+		void setFeatures(unsigned int features) { m_features = features; }
+
+		void SetTextureMtxBuffer(const std::shared_ptr<gk2::CBMatrix>& textureMtx);
+		void SetSecondTextureMtxBuffer(const std::shared_ptr<gk2::CBMatrix>& textureMtx);
+		void SetLightPosBuffer(const std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4, 2>>& lightPos);
+		void SetCameraPosBuffer(const std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4>>& cameraPos);
+		void SetSurfaceColorBuffer(const std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4>>& surfaceColor);
+		void SetSamplerState(const std::shared_ptr<ID3D11SamplerState>& samplerState);
+		void SetTexture(const std::shared_ptr<ID3D11ShaderResourceView>& texture);
+		void SetSecondTexture(const std::shared_ptr<ID3D11ShaderResourceView>& texture);
+		void SetEnvironmentMap(const std::shared_ptr<ID3D11ShaderResourceView>& envMap);
+
+	protected:
+		virtual void SetVertexShaderData();
+		virtual void SetPixelShaderData();
+
+	private:
+		static const std::wstring ShaderFile;
+
+		std::shared_ptr<gk2::CBMatrix> m_textureMtxCB;
+		std::shared_ptr<gk2::CBMatrix> m_secondTextureMtxCB;
+		std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4, 2>> m_lightPosCB;
+		std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4>> m_cameraPosCB;
+		std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4>> m_surfaceColorCB;
+		std::shared_ptr<ID3D11SamplerState> m_samplerState;
+		std::shared_ptr<ID3D11ShaderResourceView> m_texture;
+		std::shared_ptr<ID3D11ShaderResourceView> m_secondTexture;
+		std::shared_ptr<ID3D11ShaderResourceView> m_envMap;
+	};
+}
+
+#endif __GK2_MATERIAL_EFFECT_H_
@@ -8,29 +8,23 @@ Mesh::Mesh(shared_ptr<ID3D11Buffer> vb, unsigned int stride, shared_ptr<ID3D11Bu
 	: m_vertexBuffer(vb), m_stride(stride), m_indexBuffer(ib), m_indicesCount(indicesCount)
 {
 	m_worldMtx = XMMatrixIdentity();
+	GK2_ASSERT_ALIGNED(&m_worldMtx, 16);
 }
 
 Mesh::Mesh()
 	: m_stride(0), m_indicesCount(0)
 {
 	m_worldMtx = XMMatrixIdentity();
+	GK2_ASSERT_ALIGNED(&m_worldMtx, 16);
 }
 
 Mesh::Mesh(const Mesh& right)
 	: m_vertexBuffer(right.m_vertexBuffer), m_stride(right.m_stride),
-	  m_indexBuffer(right.m_indexBuffer), m_indicesCount(right.m_indicesCount)
+	  m_indexBuffer(right.m_indexBuffer), m_indicesCount(right.m_indicesCount),
+	  m_localBox(right.m_localBox), m_localSphere(right.m_localSphere), m_triangles(right.m_triangles)
 {
 	m_worldMtx = XMMatrixIdentity();
-}
-
-void* Mesh::operator new(size_t size)
-{
-	return Utils::New16Aligned(size);
-}
-
-void Mesh::operator delete(void* ptr)
-{
-	Utils::Delete16Aligned(ptr);
+	GK2_ASSERT_ALIGNED(&m_worldMtx, 16);
 }
 
 Mesh& Mesh::operator =(const Mesh& right)
@@ -40,10 +34,35 @@ Mesh& Mesh::operator =(const Mesh& right)
 	m_indexBuffer = right.m_indexBuffer;
 	m_indicesCount = right.m_indicesCount;
 	m_worldMtx = right.m_worldMtx;
+	m_localBox = right.m_localBox;
+	m_localSphere = right.m_localSphere;
+	m_triangles = right.m_triangles;
 	return *this;
 }
 
-void Mesh::Render(const shared_ptr<ID3D11DeviceContext>& context)
+void Mesh::setLocalBounds(const BoundingBox& box, const BoundingSphere& sphere)
+{
+	m_localBox = box;
+	m_localSphere = sphere;
+}
+
+bool Mesh::Raycast(FXMVECTOR origin, FXMVECTOR direction, float& distance) const
+{
+	if (!m_triangles)
+		return false;
+	//Ray is moved to model space, distance stays the same since direction is not normalized
+	XMVECTOR det;
+	XMMATRIX invWorld = XMMatrixInverse(&det, m_worldMtx);
+	TriangleBVH::RayHit hit;
+	hit.Distance = distance;
+	if (!m_triangles->Intersect(XMVector3TransformCoord(origin, invWorld),
+								XMVector3TransformNormal(direction, invWorld), hit))
+		return false;
+	distance = hit.Distance;
+	return true;
+}
+
+void Mesh::Render(const shared_ptr<RenderContext>& context)
 {
 	if (!m_vertexBuffer || !m_indexBuffer || !m_indicesCount)
 		return;
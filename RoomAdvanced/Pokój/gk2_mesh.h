@@ -4,10 +4,14 @@
 #include <d3d11.h>
 #include <xnamath.h>
 #include <memory>
+#include "gk2_bounds.h"
+#include "gk2_renderContext.h"
+#include "gk2_triangleBVH.h"
+#include "gk2_aligned.h"
 
 namespace gk2
 {
-	class Mesh
+	class Mesh : public gk2::PoolNew<Mesh>
 	{
 	public:
 		Mesh(std::shared_ptr<ID3D11Buffer> vb, unsigned int stride,
@@ -17,19 +21,28 @@ namespace gk2
 
 		const XMMATRIX& getWorldMatrix() const { return m_worldMtx; }
 		void setWorldMatrix(const XMMATRIX& mtx) { m_worldMtx = mtx; }
-		void Render(const std::shared_ptr<ID3D11DeviceContext>& context);
+		const gk2::BoundingBox& getLocalBox() const { return m_localBox; }
+		const gk2::BoundingSphere& getLocalSphere() const { return m_localSphere; }
+		void setLocalBounds(const gk2::BoundingBox& box, const gk2::BoundingSphere& sphere);
+		gk2::BoundingBox getWorldBox() const { return m_localBox.Transform(m_worldMtx); }
+		gk2::BoundingSphere getWorldSphere() const { return m_localSphere.Transform(m_worldMtx); }
+		const std::shared_ptr<const gk2::TriangleBVH>& getTriangles() const { return m_triangles; }
+		void setTriangles(const std::shared_ptr<const gk2::TriangleBVH>& triangles) { m_triangles = triangles; }
+		//Intersects world space ray with mesh triangles. On hit distance is updated with the nearest one.
+		bool Raycast(FXMVECTOR origin, FXMVECTOR direction, float& distance) const;
+		void Render(const std::shared_ptr<gk2::RenderContext>& context);
 
 		Mesh& operator =(const Mesh& right);
 
-		static void* operator new(size_t size);
-		static void operator delete(void* ptr);
-
 	private:
 		std::shared_ptr<ID3D11Buffer> m_vertexBuffer;
 		std::shared_ptr<ID3D11Buffer> m_indexBuffer;
 		unsigned int m_stride;
 		unsigned int m_indicesCount;
 		XMMATRIX m_worldMtx;
+		gk2::BoundingBox m_localBox;
+		gk2::BoundingSphere m_localSphere;
+		std::shared_ptr<const gk2::TriangleBVH> m_triangles;
 	};
 }
 
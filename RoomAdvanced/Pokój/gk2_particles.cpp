@@ -1,8 +1,11 @@
 #include "gk2_particles.h"
+#include "gk2_profiler.h"
+#include "gk2_frameArena.h"
 #include <ctime>
 #include "gk2_exceptions.h"
 #include <vector>
 #include <algorithm>
+#include <cfloat>
 
 using namespace std;
 using namespace gk2;
@@ -46,7 +49,6 @@ const unsigned int ParticleSystem::OFFSET = 0;
 ParticleSystem::ParticleSystem(DeviceHelper& device, XMFLOAT3 emitterPos)
 	: m_particlesCount(0), m_particlesToCreate(0.0f), m_emitterPos(emitterPos)
 {
-	srand(time(0));
 	m_vertices = device.CreateVertexBuffer<ParticleVertex>(MAX_PARTICLES, D3D11_USAGE_DYNAMIC);
 	shared_ptr<ID3DBlob> vsByteCode = device.CompileD3DShader(L"resources/shaders/Particles.hlsl", "VS_Main", "vs_4_0");
 	shared_ptr<ID3DBlob> gsByteCode = device.CompileD3DShader(L"resources/shaders/Particles.hlsl", "GS_Main", "gs_4_0");
@@ -136,9 +138,10 @@ void ParticleSystem::UpdateParticle(Particle& p, float dt)
 	p.Vertex.Size += PARTICLE_SCALE * PARTICLE_SIZE * dt;
 }
 
-void ParticleSystem::UpdateVertexBuffer(shared_ptr<ID3D11DeviceContext>& context, XMFLOAT4 cameraPos)
+void ParticleSystem::UpdateVertexBuffer(shared_ptr<RenderContext>& context, XMFLOAT4 cameraPos)
 {
-	vector<ParticleVertex> vertices;
+	FrameVector<ParticleVertex> vertices;
+	vertices.reserve(m_particles.size());
 	XMFLOAT4 cameraTarget(0.0f, 0.0f, 0.0f, 1.0f);
 
 	for (std::list<Particle>::iterator it = m_particles.begin(); it != m_particles.end(); ++it)
@@ -153,8 +156,9 @@ void ParticleSystem::UpdateVertexBuffer(shared_ptr<ID3D11DeviceContext>& context
 	context->Unmap(m_vertices.get(), 0);
 }
 
-void ParticleSystem::Update(shared_ptr<ID3D11DeviceContext>& context, float dt, XMFLOAT4 cameraPos)
+void ParticleSystem::Update(shared_ptr<RenderContext>& context, float dt, XMFLOAT4 cameraPos)
 {
+	PROFILE_ZONE("ParticleSystem::Update");
 	list<Particle> tmpParticles;
 	for (std::list<Particle>::iterator it = m_particles.begin(); it != m_particles.end(); ++it)
 	{
@@ -173,7 +177,26 @@ void ParticleSystem::Update(shared_ptr<ID3D11DeviceContext>& context, float dt,
 	UpdateVertexBuffer(context, cameraPos);
 }
 
-void ParticleSystem::Render(shared_ptr<ID3D11DeviceContext>& context)
+BoundingBox ParticleSystem::getBounds() const
+{
+	if (m_particles.empty())
+		return BoundingBox(m_emitterPos, XMFLOAT3(0.0f, 0.0f, 0.0f));
+	XMVECTOR minPt = XMVectorReplicate(FLT_MAX);
+	XMVECTOR maxPt = XMVectorReplicate(-FLT_MAX);
+	for (auto it = m_particles.begin(); it != m_particles.end(); ++it)
+	{
+		XMVECTOR pos = XMLoadFloat3(&it->Vertex.Pos);
+		XMVECTOR size = XMVectorReplicate(it->Vertex.Size);
+		minPt = XMVectorMin(minPt, pos - size);
+		maxPt = XMVectorMax(maxPt, pos + size);
+	}
+	BoundingBox box;
+	XMStoreFloat3(&box.Center, (minPt + maxPt) * 0.5f);
+	XMStoreFloat3(&box.Extents, (maxPt - minPt) * 0.5f);
+	return box;
+}
+
+void ParticleSystem::Render(shared_ptr<RenderContext>& context)
 {
 	context->VSSetShader(m_vs.get(), nullptr, 0);
 	context->GSSetShader(m_gs.get(), nullptr, 0);
@@ -7,6 +7,7 @@
 #include <memory>
 #include "gk2_deviceHelper.h"
 #include "gk2_constantBuffer.h"
+#include "gk2_bounds.h"
 
 namespace gk2
 {
@@ -55,9 +56,12 @@ namespace gk2
 		void SetViewMtxBuffer(const std::shared_ptr<gk2::CBMatrix>& view);
 		void SetProjMtxBuffer(const std::shared_ptr<gk2::CBMatrix>& proj);
 		void SetSamplerState(const std::shared_ptr<ID3D11SamplerState>& samplerState);
+		const XMFLOAT3& getEmitterPosition() const { return m_emitterPos; }
+		//Box enclosing the billboards of the live particles
+		gk2::BoundingBox getBounds() const;
 
-		void Update(std::shared_ptr<ID3D11DeviceContext>& context, float dt, XMFLOAT4 cameraPos);
-		void Render(std::shared_ptr<ID3D11DeviceContext>& context);
+		void Update(std::shared_ptr<gk2::RenderContext>& context, float dt, XMFLOAT4 cameraPos);
+		void Render(std::shared_ptr<gk2::RenderContext>& context);
 
 	private:
 		static const XMFLOAT3 EMITTER_DIR;	//mean direction of particles' velocity
@@ -98,7 +102,7 @@ namespace gk2
 		static XMFLOAT3 RandomVelocity();
 		void AddNewParticle();
 		void UpdateParticle(gk2::Particle& p, float dt);
-		void UpdateVertexBuffer(std::shared_ptr<ID3D11DeviceContext>& context, XMFLOAT4 cameraPos);
+		void UpdateVertexBuffer(std::shared_ptr<gk2::RenderContext>& context, XMFLOAT4 cameraPos);
 	};
 }
 
@@ -0,0 +1,32 @@
+#ifndef __GK2_PNG_WRITER_H_
+#define __GK2_PNG_WRITER_H_
+
+#include <string>
+#include <vector>
+
+namespace gk2
+{
+	//Encodes 8 bit RGBA images as PNG files without external libraries. Every row gets the filter which makes
+	//it the smallest, the data is compressed with LZ77 and the fixed Huffman codes of deflate.
+	class PngWriter
+	{
+	public:
+		//Rows stored top to bottom without padding, 4 bytes per pixel
+		static std::vector<unsigned char> Encode(unsigned int width, unsigned int height,
+												 const unsigned char* pixels);
+		//Throws std::runtime_error if the file can't be written
+		static void Write(const std::string& fileName, unsigned int width, unsigned int height,
+						  const unsigned char* pixels);
+
+		static unsigned int Crc32(const unsigned char* data, size_t size, unsigned int crc = 0);
+		static unsigned int Adler32(const unsigned char* data, size_t size);
+		//zlib stream of the data
+		static std::vector<unsigned char> Deflate(const std::vector<unsigned char>& data);
+
+	private:
+		static void FilterRows(unsigned int width, unsigned int height, const unsigned char* pixels,
+							   std::vector<unsigned char>& filtered);
+	};
+}
+
+#endif __GK2_PNG_WRITER_H_
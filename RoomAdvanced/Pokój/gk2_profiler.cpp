@@ -0,0 +1,266 @@
+#include "gk2_profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+
+using namespace std;
+using namespace gk2;
+
+namespace
+{
+	struct ZoneHistory
+	{
+		string Name;
+		//Milliseconds, a ring of the last HISTORY_SIZE recordings
+		vector<double> Durations;
+		unsigned int Next;
+		unsigned long long Count;
+	};
+
+	//State shared by the threads, guarded by the mutex
+	struct ProfilerState
+	{
+		mutex Mutex;
+		vector<unique_ptr<Profiler::ThreadBuffer>> Buffers;
+		map<string, ZoneHistory> Zones;
+		//Histories by the addresses of the zone names, names with the same text share one
+		unordered_map<const char*, ZoneHistory*> ZonesByName;
+		//Names returned by Intern
+		set<string> Names;
+		vector<Profiler::Event> Events;
+		unsigned long long LostEvents;
+		//Traces start at the time the program started
+		long long Origin;
+		double OriginMilliseconds;
+		double TicksPerMillisecond;
+
+		ProfilerState() : LostEvents(0), Origin(Profiler::Now()), OriginMilliseconds(SystemMilliseconds())
+		{
+			Calibrate();
+		}
+
+		//Clock the ticks are measured against
+		static double SystemMilliseconds()
+		{
+#ifdef _WIN32
+			LARGE_INTEGER time, frequency;
+			QueryPerformanceCounter(&time);
+			QueryPerformanceFrequency(&frequency);
+			return time.QuadPart * 1000.0 / frequency.QuadPart;
+#else
+			return chrono::duration<double, milli>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+		}
+
+		//Ticks per millisecond since the start, the longer the program runs the more precise. Waits until the
+		//interval is long enough to give a usable rate, which only happens in the first millisecond.
+		void Calibrate()
+		{
+			const double MIN_INTERVAL = 1.0;
+			long long ticks;
+			double elapsed;
+			do
+			{
+				ticks = Profiler::Now();
+				elapsed = SystemMilliseconds() - OriginMilliseconds;
+			} while (elapsed < MIN_INTERVAL);
+			TicksPerMillisecond = (ticks - Origin) / elapsed;
+		}
+	};
+
+	ProfilerState s_state;
+
+	Profiler::ZoneStatistics ComputeStatistics(const ZoneHistory& zone)
+	{
+		Profiler::ZoneStatistics statistics;
+		statistics.Name = zone.Name;
+		statistics.Count = zone.Count;
+		vector<double> sorted(zone.Durations);
+		sort(sorted.begin(), sorted.end());
+		statistics.Min = sorted.front();
+		statistics.Max = sorted.back();
+		double sum = 0.0;
+		for (auto it = sorted.begin(); it != sorted.end(); ++it)
+			sum += *it;
+		statistics.Average = sum / sorted.size();
+		size_t p99 = static_cast<size_t>(ceil(0.99 * sorted.size()));
+		statistics.P99 = sorted[p99 > 0 ? p99 - 1 : 0];
+		return statistics;
+	}
+
+	void WriteJsonString(ostream& s, const string& text)
+	{
+		s << '"';
+		for (auto it = text.begin(); it != text.end(); ++it)
+		{
+			if (*it == '"' || *it == '\\')
+				s << '\\';
+			if (static_cast<unsigned char>(*it) >= 0x20)
+				s << *it;
+		}
+		s << '"';
+	}
+}
+
+atomic<bool> Profiler::s_enabled(true);
+GK2_THREAD_LOCAL Profiler::ThreadBuffer* Profiler::s_threadBuffer = nullptr;
+
+double Profiler::TicksToMilliseconds(long long ticks)
+{
+	return ticks / s_state.TicksPerMillisecond;
+}
+
+Profiler::ThreadBuffer* Profiler::CreateThreadBuffer()
+{
+	unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+	buffer->Head.store(0);
+	buffer->Gathered = 0;
+	unique_lock<mutex> lock(s_state.Mutex);
+	buffer->Id = static_cast<unsigned int>(s_state.Buffers.size()) + 1;
+	s_threadBuffer = buffer.get();
+	s_state.Buffers.push_back(move(buffer));
+	return s_threadBuffer;
+}
+
+const char* Profiler::Intern(const string& name)
+{
+	unique_lock<mutex> lock(s_state.Mutex);
+	return s_state.Names.insert(name).first->c_str();
+}
+
+void Profiler::SetThreadName(const string& name)
+{
+	ThreadBuffer* buffer = getThreadBuffer();
+	unique_lock<mutex> lock(s_state.Mutex);
+	buffer->Name = name;
+}
+
+unsigned long long Profiler::ReadEvents(const ThreadBuffer& buffer, unsigned long long first,
+										vector<Event>& events, unsigned long long& lost)
+{
+	unsigned long long head = buffer.Head.load(memory_order_acquire);
+	unsigned long long begin = max(first, head > RING_SIZE ? head - RING_SIZE : 0ULL);
+	size_t offset = events.size();
+	for (unsigned long long i = begin; i < head; ++i)
+		events.push_back(buffer.Events[i & (RING_SIZE - 1)]);
+	//Slot of an event is reused by the event RING_SIZE later, which may be in the middle of being written
+	unsigned long long after = buffer.Head.load(memory_order_acquire) + 1;
+	unsigned long long overwritten = after > RING_SIZE ? min(after - RING_SIZE, head) : 0;
+	if (overwritten > begin)
+	{
+		events.erase(events.begin() + offset, events.begin() + offset + static_cast<size_t>(overwritten - begin));
+		begin = overwritten;
+	}
+	lost = begin - min(first, begin);
+	return head;
+}
+
+void Profiler::EndFrame()
+{
+	unique_lock<mutex> lock(s_state.Mutex);
+	s_state.Calibrate();
+	for (auto b = s_state.Buffers.begin(); b != s_state.Buffers.end(); ++b)
+	{
+		ThreadBuffer& buffer = **b;
+		unsigned long long lost;
+		s_state.Events.clear();
+		buffer.Gathered = ReadEvents(buffer, buffer.Gathered, s_state.Events, lost);
+		s_state.LostEvents += lost;
+		for (auto e = s_state.Events.begin(); e != s_state.Events.end(); ++e)
+		{
+			ZoneHistory*& zone = s_state.ZonesByName[e->Name];
+			if (!zone)
+			{
+				zone = &s_state.Zones[e->Name];
+				if (zone->Name.empty())
+				{
+					zone->Name = e->Name;
+					zone->Next = 0;
+					zone->Count = 0;
+					zone->Durations.reserve(HISTORY_SIZE);
+				}
+			}
+			double duration = TicksToMilliseconds(e->End - e->Start);
+			if (zone->Durations.size() < HISTORY_SIZE)
+				zone->Durations.push_back(duration);
+			else
+				zone->Durations[zone->Next] = duration;
+			zone->Next = (zone->Next + 1) % HISTORY_SIZE;
+			++zone->Count;
+		}
+	}
+}
+
+unsigned long long Profiler::getLostEvents()
+{
+	unique_lock<mutex> lock(s_state.Mutex);
+	return s_state.LostEvents;
+}
+
+bool Profiler::GetStatistics(const string& name, ZoneStatistics& statistics)
+{
+	unique_lock<mutex> lock(s_state.Mutex);
+	auto it = s_state.Zones.find(name);
+	if (it == s_state.Zones.end())
+		return false;
+	statistics = ComputeStatistics(it->second);
+	return true;
+}
+
+vector<Profiler::ZoneStatistics> Profiler::GetStatistics()
+{
+	unique_lock<mutex> lock(s_state.Mutex);
+	vector<ZoneStatistics> result;
+	for (auto it = s_state.Zones.begin(); it != s_state.Zones.end(); ++it)
+		result.push_back(ComputeStatistics(it->second));
+	return result;
+}
+
+void Profiler::WriteStatistics(wostream& s)
+{
+	vector<ZoneStatistics> zones = GetStatistics();
+	s << L"Zone: count, min / avg / p99 / max ms" << endl;
+	for (auto it = zones.begin(); it != zones.end(); ++it)
+		s << wstring(it->Name.begin(), it->Name.end()) << L": " << it->Count << L", " << it->Min << L" / "
+		  << it->Average << L" / " << it->P99 << L" / " << it->Max << endl;
+}
+
+void Profiler::WriteChromeTrace(ostream& s)
+{
+	unique_lock<mutex> lock(s_state.Mutex);
+	s_state.Calibrate();
+	ios::fmtflags flags = s.flags();
+	streamsize precision = s.precision();
+	s << fixed << setprecision(3) << "{\"traceEvents\":[";
+	bool first = true;
+	vector<Event> events;
+	for (auto b = s_state.Buffers.begin(); b != s_state.Buffers.end(); ++b)
+	{
+		const ThreadBuffer& buffer = **b;
+		s << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer.Id
+		  << ",\"args\":{\"name\":";
+		WriteJsonString(s, buffer.Name.empty() ? "Thread " + to_string(buffer.Id) : buffer.Name);
+		s << "}}";
+		first = false;
+		unsigned long long lost;
+		events.clear();
+		ReadEvents(buffer, 0, events, lost);
+		for (auto e = events.begin(); e != events.end(); ++e)
+		{
+			//Timestamps in microseconds
+			s << ",\n{\"name\":";
+			WriteJsonString(s, e->Name);
+			s << ",\"cat\":\"gk2\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer.Id << ",\"ts\":"
+			  << TicksToMilliseconds(e->Start - s_state.Origin) * 1000.0 << ",\"dur\":"
+			  << TicksToMilliseconds(e->End - e->Start) * 1000.0 << "}";
+		}
+	}
+	s << "\n],\"displayTimeUnit\":\"ms\"}" << endl;
+	s.flags(flags);
+	s.precision(precision);
+}
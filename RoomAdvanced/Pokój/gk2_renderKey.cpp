@@ -0,0 +1,54 @@
+#include "gk2_renderKey.h"
+#include <algorithm>
+
+using namespace std;
+using namespace gk2;
+
+unsigned long long RenderKey::Make(unsigned int pass, Layer layer, unsigned int effect, unsigned int texture,
+								   float depth)
+{
+	const unsigned long long depthMask = (1ULL << DEPTH_BITS) - 1;
+	//Float can't hold depthMask, 1.0f * depthMask would round up to 1 << DEPTH_BITS and overflow the depth bits
+	double scaled = min(max(static_cast<double>(depth), 0.0), 1.0) * depthMask;
+	unsigned long long d = static_cast<unsigned long long>(scaled + 0.5);
+	d = min(d, depthMask);
+	unsigned long long e = effect & ((1U << EFFECT_BITS) - 1);
+	unsigned long long t = texture & ((1U << TEXTURE_BITS) - 1);
+	unsigned int shift = 64 - PASS_BITS;
+	unsigned long long key = static_cast<unsigned long long>(pass & ((1U << PASS_BITS) - 1)) << shift;
+	key |= static_cast<unsigned long long>(layer) << --shift;
+	if (layer == LAYER_OPAQUE)
+		return key | e << (shift - EFFECT_BITS) | t << (shift - EFFECT_BITS - TEXTURE_BITS) |
+			   d << (shift - EFFECT_BITS - TEXTURE_BITS - DEPTH_BITS);
+	return key | (depthMask - d) << (shift - DEPTH_BITS) | e << (shift - DEPTH_BITS - EFFECT_BITS) |
+		   t << (shift - DEPTH_BITS - EFFECT_BITS - TEXTURE_BITS);
+}
+
+void RenderKey::Sort(vector<Item>& items, vector<Item>& buffer)
+{
+	if (items.size() < 2)
+		return;
+	//Histograms of all the bytes are gathered in one pass over the keys
+	unsigned int counts[8][256] = { };
+	for (auto it = items.begin(); it != items.end(); ++it)
+		for (unsigned int b = 0; b < 8; ++b)
+			++counts[b][(it->Key >> (b * 8)) & 0xff];
+	buffer.resize(items.size());
+	for (unsigned int b = 0; b < 8; ++b)
+	{
+		unsigned int* count = counts[b];
+		unsigned int shift = b * 8;
+		if (count[(items[0].Key >> shift) & 0xff] == items.size())
+			continue;
+		unsigned int offset = 0;
+		for (unsigned int i = 0; i < 256; ++i)
+		{
+			unsigned int c = count[i];
+			count[i] = offset;
+			offset += c;
+		}
+		for (auto it = items.begin(); it != items.end(); ++it)
+			buffer[count[(it->Key >> shift) & 0xff]++] = *it;
+		items.swap(buffer);
+	}
+}
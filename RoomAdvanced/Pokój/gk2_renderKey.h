@@ -0,0 +1,45 @@
+#ifndef __GK2_RENDER_KEY_H_
+#define __GK2_RENDER_KEY_H_
+
+#include <vector>
+
+namespace gk2
+{
+	//Sort keys of the draws of RenderQueue. Opaque draws are ordered by effect, texture and then front to back,
+	//transparent ones back to front.
+	class RenderKey
+	{
+	public:
+		enum Layer
+		{
+			LAYER_OPAQUE = 0,
+			LAYER_TRANSPARENT = 1
+		};
+
+		//Key bits from the most significant: pass, layer and then effect, texture, depth for opaque draws or
+		//inverted depth, effect, texture for transparent ones
+		static const unsigned int PASS_BITS = 4;
+		static const unsigned int EFFECT_BITS = 8;
+		static const unsigned int TEXTURE_BITS = 8;
+		static const unsigned int DEPTH_BITS = 24;
+
+		struct Item
+		{
+			unsigned long long Key;
+			//Index of the draw in the order it was added in
+			unsigned int Index;
+		};
+
+		//Depth in [0, 1], values outside are clamped
+		static unsigned long long Make(unsigned int pass, Layer layer, unsigned int effect, unsigned int texture,
+									   float depth);
+		static Layer GetLayer(unsigned long long key)
+		{
+			return static_cast<Layer>((key >> (63 - PASS_BITS)) & 1);
+		}
+		//Stable radix sort by key, 8 bits per pass. Passes over bytes equal in all the keys are skipped.
+		static void Sort(std::vector<Item>& items, std::vector<Item>& buffer);
+	};
+}
+
+#endif __GK2_RENDER_KEY_H_
@@ -0,0 +1,143 @@
+#include "gk2_renderQueue.h"
+
+using namespace std;
+using namespace gk2;
+
+namespace
+{
+	const unsigned int BS_MASK = 0xffffffff;
+
+	bool Equal(const XMFLOAT4& a, const XMFLOAT4& b)
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
+	}
+}
+
+RenderQueue::RenderQueue(const shared_ptr<CBMatrix>& worldCB, const shared_ptr<ConstantBuffer<XMFLOAT4>>& surfaceColorCB,
+						 const shared_ptr<ID3D11BlendState>& transparentBlendState,
+						 const shared_ptr<ID3D11DepthStencilState>& transparentDepthStencilState)
+	: m_worldCB(worldCB), m_surfaceColorCB(surfaceColorCB), m_transparentBlendState(transparentBlendState),
+	  m_transparentDepthStencilState(transparentDepthStencilState), m_eye(0.0f, 0.0f, 0.0f), m_farPlane(1.0f)
+{
+}
+
+unsigned int RenderQueue::AddMaterial(const Material& material)
+{
+	m_materials.push_back(material);
+	return static_cast<unsigned int>(m_materials.size() - 1);
+}
+
+void RenderQueue::Begin(const XMFLOAT4& eye, float farPlane)
+{
+	m_eye = XMFLOAT3(eye.x, eye.y, eye.z);
+	m_farPlane = farPlane;
+	m_draws.clear();
+	m_items.clear();
+}
+
+float RenderQueue::Depth(const XMFLOAT3& position, float bias) const
+{
+	XMVECTOR d = XMVector3Length(XMLoadFloat3(&position) - XMLoadFloat3(&m_eye));
+	return (XMVectorGetX(d) + bias) / m_farPlane;
+}
+
+void RenderQueue::Add(unsigned int material, Mesh& mesh, const XMFLOAT4& surfaceColor,
+					  ID3D11RasterizerState* rasterizerState /* = nullptr */, float depthBias /* = 0.0f */,
+					  unsigned int pass /* = 0 */)
+{
+	const Material& m = m_materials[material];
+	Draw draw;
+	draw.Material = material;
+	draw.Mesh = &mesh;
+	draw.SurfaceColor = surfaceColor;
+	draw.RasterizerState = rasterizerState;
+	RenderKey::Item item;
+	item.Key = RenderKey::Make(pass, m.Transparent ? RenderKey::LAYER_TRANSPARENT : RenderKey::LAYER_OPAQUE,
+							   m.EffectId, m.TextureId, Depth(mesh.getWorldSphere().Center, depthBias));
+	item.Index = static_cast<unsigned int>(m_draws.size());
+	m_draws.push_back(draw);
+	m_items.push_back(item);
+}
+
+void RenderQueue::Add(RenderKey::Layer layer, const XMFLOAT3& position, const function<void()>& draw,
+					  unsigned int pass /* = 0 */)
+{
+	Draw d;
+	d.Material = NO_MATERIAL;
+	d.Mesh = nullptr;
+	d.SurfaceColor = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+	d.RasterizerState = nullptr;
+	d.Custom = draw;
+	//Custom draws come after the materials using the same ids
+	RenderKey::Item item;
+	item.Key = RenderKey::Make(pass, layer, (1 << RenderKey::EFFECT_BITS) - 1, (1 << RenderKey::TEXTURE_BITS) - 1,
+							   Depth(position, 0.0f));
+	item.Index = static_cast<unsigned int>(m_draws.size());
+	m_draws.push_back(d);
+	m_items.push_back(item);
+}
+
+void RenderQueue::Submit(const shared_ptr<RenderContext>& context)
+{
+	RenderKey::Sort(m_items, m_sortBuffer);
+	unsigned int material = NO_MATERIAL;
+	bool transparent = false;
+	ID3D11RasterizerState* rasterizerState = nullptr;
+	const Mesh* worldMesh = nullptr;
+	bool colorSet = false;
+	XMFLOAT4 color;
+	for (auto it = m_items.begin(); it != m_items.end(); ++it)
+	{
+		Draw& draw = m_draws[it->Index];
+		bool drawTransparent = RenderKey::GetLayer(it->Key) == RenderKey::LAYER_TRANSPARENT;
+		if (drawTransparent != transparent)
+		{
+			transparent = drawTransparent;
+			context->OMSetBlendState(transparent ? m_transparentBlendState.get() : nullptr, nullptr, BS_MASK);
+			context->OMSetDepthStencilState(transparent ? m_transparentDepthStencilState.get() : nullptr, 0);
+		}
+		if (draw.Custom)
+		{
+			if (material != NO_MATERIAL)
+				m_materials[material].Effect->End();
+			material = NO_MATERIAL;
+			if (rasterizerState)
+				context->RSSetState(rasterizerState = nullptr);
+			draw.Custom();
+			continue;
+		}
+		if (draw.Material != material)
+		{
+			if (material != NO_MATERIAL)
+				m_materials[material].Effect->End();
+			material = draw.Material;
+			m_materials[material].Effect->Begin(context);
+		}
+		if (draw.RasterizerState != rasterizerState)
+		{
+			rasterizerState = draw.RasterizerState;
+			context->RSSetState(rasterizerState);
+		}
+		if (!colorSet || !Equal(color, draw.SurfaceColor))
+		{
+			color = draw.SurfaceColor;
+			colorSet = true;
+			m_surfaceColorCB->Update(context, color);
+		}
+		if (draw.Mesh != worldMesh)
+		{
+			worldMesh = draw.Mesh;
+			m_worldCB->Update(context, worldMesh->getWorldMatrix());
+		}
+		draw.Mesh->Render(context);
+	}
+	if (material != NO_MATERIAL)
+		m_materials[material].Effect->End();
+	if (rasterizerState)
+		context->RSSetState(nullptr);
+	if (transparent)
+	{
+		context->OMSetBlendState(nullptr, nullptr, BS_MASK);
+		context->OMSetDepthStencilState(nullptr, 0);
+	}
+}
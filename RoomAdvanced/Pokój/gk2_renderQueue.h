@@ -0,0 +1,80 @@
+#ifndef __GK2_RENDER_QUEUE_H_
+#define __GK2_RENDER_QUEUE_H_
+
+#include <d3d11.h>
+#include <xnamath.h>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "gk2_constantBuffer.h"
+#include "gk2_effectBase.h"
+#include "gk2_mesh.h"
+#include "gk2_renderKey.h"
+
+namespace gk2
+{
+	//Collects the draws of a scene and submits them in the order of their sort keys instead of the order they
+	//were added in. Opaque draws are grouped by effect and texture and drawn front to back within a group,
+	//transparent ones are drawn back to front.
+	class RenderQueue
+	{
+	public:
+		//Effect with all its resources set. Opaque draws are grouped by the ids, so materials which share
+		//shaders or textures should share the ids as well.
+		struct Material
+		{
+			std::shared_ptr<gk2::EffectBase> Effect;
+			unsigned int EffectId;
+			unsigned int TextureId;
+			//Transparent materials are blended and do not write depth
+			bool Transparent;
+		};
+
+		RenderQueue(const std::shared_ptr<gk2::CBMatrix>& worldCB,
+					const std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4>>& surfaceColorCB,
+					const std::shared_ptr<ID3D11BlendState>& transparentBlendState,
+					const std::shared_ptr<ID3D11DepthStencilState>& transparentDepthStencilState);
+
+		unsigned int AddMaterial(const Material& material);
+
+		//Removes all the draws. Depth of the following ones is the distance from the eye divided by farPlane.
+		void Begin(const XMFLOAT4& eye, float farPlane);
+		//depthBias is added to the distance of the mesh's bounding sphere, e.g. to draw back faces of
+		//a transparent mesh before its front faces
+		void Add(unsigned int material, gk2::Mesh& mesh, const XMFLOAT4& surfaceColor,
+				 ID3D11RasterizerState* rasterizerState = nullptr, float depthBias = 0.0f, unsigned int pass = 0);
+		//Draw which sets its own effect, e.g. a particle system
+		void Add(gk2::RenderKey::Layer layer, const XMFLOAT3& position, const std::function<void()>& draw,
+				 unsigned int pass = 0);
+		void Submit(const std::shared_ptr<gk2::RenderContext>& context);
+
+		unsigned int getItemsCount() const { return static_cast<unsigned int>(m_items.size()); }
+
+	private:
+		static const unsigned int NO_MATERIAL = 0xffffffff;
+
+		struct Draw
+		{
+			unsigned int Material;
+			gk2::Mesh* Mesh;
+			XMFLOAT4 SurfaceColor;
+			ID3D11RasterizerState* RasterizerState;
+			std::function<void()> Custom;
+		};
+
+		std::shared_ptr<gk2::CBMatrix> m_worldCB;
+		std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4>> m_surfaceColorCB;
+		std::shared_ptr<ID3D11BlendState> m_transparentBlendState;
+		std::shared_ptr<ID3D11DepthStencilState> m_transparentDepthStencilState;
+		std::vector<Material> m_materials;
+		std::vector<Draw> m_draws;
+		std::vector<gk2::RenderKey::Item> m_items;
+		std::vector<gk2::RenderKey::Item> m_sortBuffer;
+		XMFLOAT3 m_eye;
+		float m_farPlane;
+
+		float Depth(const XMFLOAT3& position, float bias) const;
+	};
+}
+
+#endif __GK2_RENDER_QUEUE_H_
@@ -1,21 +1,47 @@
 #include "gk2_room.h"
 #include "gk2_window.h"
 #include "gk2_textureGenerator.h"
+#include <sstream>
 
 using namespace std;
 using namespace gk2;
 
+namespace
+{
+	double Milliseconds()
+	{
+		LARGE_INTEGER counter, frequency;
+		QueryPerformanceCounter(&counter);
+		QueryPerformanceFrequency(&frequency);
+		return 1000.0 * counter.QuadPart / frequency.QuadPart;
+	}
+}
+
 const float Room::TABLE_H = 1.0f;
 const float Room::TABLE_TOP_H = 0.1f;
 const float Room::TABLE_R = 1.5f;
+const float Room::FAR_PLANE = 100.0f;
 const XMFLOAT4 Room::TABLE_POS = XMFLOAT4(0.5f, -0.96f, 0.5f, 1.0f);
 const XMFLOAT4 Room::LIGHT_POS[2] = { XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT4(-1.0f, -1.0f, -1.0f, 1.0f) };
-const unsigned int Room::BS_MASK = 0xffffffff;
+const XMFLOAT4 Room::WHITE = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+const XMFLOAT4 Room::TABLE_COLOR = XMFLOAT4(0.1f, 0.1f, 0.1f, 0.9f);
+const ProbeScheduler::Settings Room::PROBE_SETTINGS = { 3, 10, 6 };
 
 Room::Room(HINSTANCE hInstance)
-	: ApplicationBase(hInstance), m_camera(0.01f, 100.0f)
+	: ApplicationBase(hInstance), m_camera(0.01f, 100.0f), m_pickedObject(SceneBVH::NO_INSTANCE)
 {
-
+	//Shelf, lamp, chair seat, chair frame, monitor and screen
+	m_objects[0] = &m_box;
+	m_objects[1] = &m_lamp;
+	m_objects[2] = &m_chairSeat;
+	m_objects[3] = &m_chairBack;
+	m_objects[4] = &m_monitor;
+	m_objects[5] = &m_screen;
+	for (unsigned int face = 0; face < 6; ++face)
+	{
+		m_facePassNames[face] = Profiler::Intern("EnvironmentFace" + to_string(face));
+		m_copyFacePassNames[face] = Profiler::Intern("CopyFace" + to_string(face));
+	}
 }
 
 Room::~Room()
@@ -23,16 +49,6 @@ Room::~Room()
 
 }
 
-void* Room::operator new(size_t size)
-{
-	return Utils::New16Aligned(size);
-}
-
-void Room::operator delete(void* ptr)
-{
-	Utils::Delete16Aligned(ptr);
-}
-
 void Room::InitializeConstantBuffers()
 {
 	m_projCB.reset(new CBMatrix(m_device));
@@ -40,6 +56,7 @@ void Room::InitializeConstantBuffers()
 	m_worldCB.reset(new CBMatrix(m_device));
 	m_lightPosCB.reset(new ConstantBuffer<XMFLOAT4, 2>(m_device));
 	m_textureCB.reset(new CBMatrix(m_device));
+	m_floorTexCB.reset(new CBMatrix(m_device));
 	m_posterTexCB.reset(new CBMatrix(m_device));
 	m_surfaceColorCB.reset(new ConstantBuffer<XMFLOAT4>(m_device));
 	m_cameraPosCB.reset(new ConstantBuffer<XMFLOAT4>(m_device));
@@ -49,7 +66,7 @@ void Room::InitializeCamera()
 {
 	SIZE s = getMainWindow()->getClientSize();
 	float ar = static_cast<float>(s.cx) / s.cy;
-	m_projMtx = XMMatrixPerspectiveFovLH(XM_PIDIV4, ar, 0.01f, 100.0f);
+	m_projMtx = XMMatrixPerspectiveFovLH(XM_PIDIV4, ar, 0.01f, FAR_PLANE);
 	m_projCB->Update(m_context, m_projMtx);
 	m_camera.Zoom(5);
 	UpdateCamera();
@@ -57,8 +74,8 @@ void Room::InitializeCamera()
 
 void Room::InitializeTextures()
 {
-	m_wallTexture = m_device.CreateShaderResourceView(L"resources/textures/brick_wall.jpg");
-	m_posterTexture = m_device.CreateShaderResourceView(L"resources/textures/lautrec_divan.jpg");
+	LoadTextureAsync(L"resources/textures/brick_wall.jpg", m_wallTexture);
+	LoadTextureAsync(L"resources/textures/lautrec_divan.jpg", m_posterTexture);
 	D3D11_SAMPLER_DESC sd = m_device.DefaultSamplerDesc();
 	sd.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
 	sd.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
@@ -66,23 +83,35 @@ void Room::InitializeTextures()
 	sd.AddressU = D3D11_TEXTURE_ADDRESS_BORDER;
 	sd.AddressV = D3D11_TEXTURE_ADDRESS_BORDER;
 	m_samplerBorder = m_device.CreateSamplerState(sd);
-	m_perlinTexture = m_device.CreateShaderResourceView(L"resources/textures/perlin.jpg");
-
-	D3D11_TEXTURE2D_DESC texDesc = m_device.DefaultTexture2DDesc();
-	texDesc.Width = 64;
-	texDesc.Height = 512;
-	texDesc.BindFlags |= D3D11_BIND_RENDER_TARGET;
-	texDesc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
-	shared_ptr<ID3D11Texture2D> woodTexture = m_device.CreateTexture2D(texDesc);
-	shared_ptr<BYTE> data(new BYTE[64 * 512 * 4], Utils::DeleteArray<BYTE>);
-	BYTE *d = data.get();
-	TextureGenerator txGen(6, 0.35f);
-	for (int i = 0; i < 512; ++i)
+	LoadTextureAsync(L"resources/textures/perlin.jpg", m_perlinTexture);
+
+	m_woodTexture = CreateWoodTexture();
+}
+
+shared_ptr<ID3D11ShaderResourceView> Room::CreateWoodTexture()
+{
+	//Wood depends only on these parameters, so it is cached under their hash and neither generated nor cooked
+	//again. The version has to change with the generator.
+	struct { unsigned int Version, Width, Height, Octaves; float Persistance; } params = { 1, 64, 512, 6, 0.35f };
+	unsigned long long hash = AssetCache::Hash(&params, sizeof(params));
+	const shared_ptr<AssetCache>& cache = m_device.getAssetCache();
+	vector<BYTE> dds;
+	if (cache && cache->Load("wood", TextureCooker::VERSION, hash, dds))
+		return m_device.CreateCookedShaderResourceView(dds);
+
+	//Mipmaps are generated and the texture compressed by the cooker
+	TextureCooker::Image wood;
+	wood.Width = params.Width;
+	wood.Height = params.Height;
+	wood.Pixels.resize(wood.Width * wood.Height * 4);
+	BYTE *d = wood.Pixels.data();
+	TextureGenerator txGen(params.Octaves, params.Persistance);
+	for (unsigned int i = 0; i < wood.Height; ++i)
 	{
-		float x = i / 512.0f;
-		for (int j = 0; j < 64; ++j)
+		float x = static_cast<float>(i) / wood.Height;
+		for (unsigned int j = 0; j < wood.Width; ++j)
 		{
-			float y = j / 64.0f;
+			float y = static_cast<float>(j) / wood.Width;
 			float c = txGen.Wood(x, y);
 			BYTE ic = static_cast<BYTE>(c * 239);
 			*(d++) = ic;
@@ -93,9 +122,55 @@ void Room::InitializeTextures()
 			*(d++) = 255;
 		}
 	}
-	m_context->UpdateSubresource(woodTexture.get(), 0, 0, data.get(), 64*4, 64*512*4);
-	m_woodTexture = m_device.CreateShaderResourceView(woodTexture);
-	m_context->GenerateMips(m_woodTexture.get());
+	dds = TextureCooker::Cook(wood, TextureCooker::ChooseFormat(wood));
+	if (cache)
+		cache->Store("wood", TextureCooker::VERSION, hash, dds);
+	return m_device.CreateCookedShaderResourceView(dds);
+}
+
+void Room::LoadTextureAsync(const wstring& fileName, shared_ptr<ID3D11ShaderResourceView>& texture)
+{
+	//File is read, decoded and cooked on a loader thread, only the texture is created in Update
+	shared_ptr<AssetCache> cache = m_device.getAssetCache();
+	shared_future<vector<BYTE>> dds = m_assetLoader.Load<vector<BYTE>>([fileName, cache]()
+	{
+		return AssetLoader::CookTexture(fileName, cache.get());
+	});
+	m_assetLoader.WhenReady<vector<BYTE>>(dds, [this, &texture](const vector<BYTE>& cooked)
+	{
+		texture = m_device.CreateCookedShaderResourceView(cooked);
+		//Effects keep their own pointers to the textures
+		SetEffectTextures();
+	});
+}
+
+void Room::LoadMeshAsync(const wstring& fileName, Mesh& mesh)
+{
+	//Mesh file is parsed on a loader thread, the buffers are created in Update once it's done
+	typedef pair<vector<VertexPosNormal>, vector<unsigned short>> MeshFileData;
+	shared_ptr<AssetCache> cache = m_device.getAssetCache();
+	shared_future<MeshFileData> data = m_assetLoader.Load<MeshFileData>([fileName, cache]()
+	{
+		MeshFileData result;
+		MeshLoader::ParseMeshFile(fileName, result.first, result.second, cache.get());
+		return result;
+	});
+	m_assetLoader.WhenReady<MeshFileData>(data, [this, &mesh](const MeshFileData& meshData)
+	{
+		XMMATRIX world = mesh.getWorldMatrix();
+		mesh = m_meshLoader.CreateMesh(meshData.first, meshData.second);
+		mesh.setWorldMatrix(world);
+		//Scene BVH gets the bounds of the loaded mesh
+		UpdateObjectsBounds(true);
+	});
+}
+
+void Room::SetEffectTextures()
+{
+	m_textureEffect->SetTexture(m_wallTexture);
+	m_colorTexEffect->SetTexture(m_perlinTexture);
+	m_multiTexEffect->SetTexture(m_wallTexture);
+	m_multiTexEffect->SetSecondTexture(m_posterTexture);
 }
 
 void Room::CreateScene()
@@ -109,7 +184,7 @@ void Room::CreateScene()
 		m_walls[i].setWorldMatrix(wall * XMMatrixRotationY(a));
 	m_walls[4].setWorldMatrix(wall * XMMatrixRotationX(XM_PIDIV2));
 	m_walls[5].setWorldMatrix(wall * XMMatrixRotationX(-XM_PIDIV2));
-	m_teapot = m_meshLoader.LoadMesh(L"resources/meshes/teapot.mesh");
+	LoadMeshAsync(L"resources/meshes/teapot.mesh", m_teapot);
 	XMMATRIX teapotMtx = XMMatrixTranslation(0.0f, -2.3f, 0.f) * XMMatrixScaling(0.1f, 0.1f, 0.1f) *
 						 XMMatrixRotationY(-XM_PIDIV2) * XMMatrixTranslation(-1.3f, -0.74f, -0.6f);
 	m_teapot.setWorldMatrix(teapotMtx);
@@ -118,15 +193,15 @@ void Room::CreateScene()
 						 XMMatrixRotationY(-XM_PIDIV2) * XMMatrixTranslation(-1.3f, -0.74f, -0.6f));
 	m_box = m_meshLoader.GetBox();
 	m_box.setWorldMatrix(XMMatrixTranslation(-1.4f, -1.46f, -0.6f));
-	m_lamp = m_meshLoader.LoadMesh(L"resources/meshes/lamp.mesh");
+	LoadMeshAsync(L"resources/meshes/lamp.mesh", m_lamp);
 	UpdateLamp(0.0f);
-	m_chairSeat = m_meshLoader.LoadMesh(L"resources/meshes/chair_seat.mesh");
-	m_chairBack = m_meshLoader.LoadMesh(L"resources/meshes/chair_back.mesh");
+	LoadMeshAsync(L"resources/meshes/chair_seat.mesh", m_chairSeat);
+	LoadMeshAsync(L"resources/meshes/chair_back.mesh", m_chairBack);
 	XMMATRIX chair = XMMatrixRotationY(XM_PI + XM_PI/9 /*20 deg*/) * XMMatrixTranslation(-0.1f, -1.06f, -1.3f);
 	m_chairSeat.setWorldMatrix(chair);
 	m_chairBack.setWorldMatrix(chair);
-	m_monitor = m_meshLoader.LoadMesh(L"resources/meshes/monitor.mesh");
-	m_screen = m_meshLoader.LoadMesh(L"resources/meshes/screen.mesh");
+	LoadMeshAsync(L"resources/meshes/monitor.mesh", m_monitor);
+	LoadMeshAsync(L"resources/meshes/screen.mesh", m_screen);
 	XMMATRIX monitor = XMMatrixRotationY(XM_PIDIV4) *
 					   XMMatrixTranslation(TABLE_POS.x, TABLE_POS.y + 0.42f, TABLE_POS.z);
 	m_monitor.setWorldMatrix(monitor);
@@ -144,8 +219,10 @@ void Room::CreateScene()
 	m_tableTop = m_meshLoader.GetDisc(16, TABLE_R);
 	m_tableTop.setWorldMatrix(XMMatrixRotationY(XM_PIDIV4/4) *
 							  XMMatrixTranslation(TABLE_POS.x, TABLE_POS.y, TABLE_POS.z));
+	UpdateObjectsBounds(true);
 	m_lightPosCB->Update(m_context, LIGHT_POS);
 	m_textureCB->Update(m_context, XMMatrixScaling(0.25f, 0.25f, 1.0f) * XMMatrixTranslation(0.5f, 0.5f, 0.0f));
+	m_floorTexCB->Update(m_context, XMMatrixScaling(0.25f, 4.0f, 1.0f) * XMMatrixTranslation(0.5f, 0.5f, 0.0f));
 	m_posterTexCB->Update(m_context, XMMatrixScaling(0.25f, -0.25f, 1.0f) * XMMatrixTranslation(0.2f, 0.0f, 0.0f) *
 									 XMMatrixRotationZ(XM_PIDIV2/9) * XMMatrixScaling(4.0f, 3.0f, 1.0f) *
 									 XMMatrixTranslation(0.5f, 0.5f, 0.5f));
@@ -177,42 +254,60 @@ bool Room::LoadContent()
 	InitializeTextures();
 	InitializeRenderStates();
 	m_meshLoader.setDevice(m_device);
+	m_meshLoader.setBuildTriangleBVH(true);
 	CreateScene();
-	m_phongEffect.reset(new PhongEffect(m_device, m_layout));
+	m_materialShaders = MaterialEffect::CreateShaders(m_device);
+	//Compile all the variants used by the room up front, so that none is compiled while drawing
+	vector<unsigned int> materials;
+	materials.push_back(MaterialEffect::SURFACE_COLOR | MaterialEffect::LIGHTING);
+	materials.push_back(MaterialEffect::TEXTURE);
+	materials.push_back(MaterialEffect::TEXTURE | MaterialEffect::SURFACE_COLOR);
+	materials.push_back(MaterialEffect::TEXTURE | MaterialEffect::SECOND_TEXTURE);
+	materials.push_back(MaterialEffect::ENV_MAP | MaterialEffect::SURFACE_COLOR);
+	m_materialShaders->Precompile(materials);
+
+	m_phongEffect.reset(new MaterialEffect(m_device, m_layout, m_materialShaders,
+										   MaterialEffect::SURFACE_COLOR | MaterialEffect::LIGHTING));
 	m_phongEffect->SetProjMtxBuffer(m_projCB);
 	m_phongEffect->SetViewMtxBuffer(m_viewCB);
 	m_phongEffect->SetWorldMtxBuffer(m_worldCB);
 	m_phongEffect->SetLightPosBuffer(m_lightPosCB);
 	m_phongEffect->SetSurfaceColorBuffer(m_surfaceColorCB);
 
-	m_textureEffect.reset(new TextureEffect(m_device, m_layout));
+	m_textureEffect.reset(new MaterialEffect(m_device, m_layout, m_materialShaders, MaterialEffect::TEXTURE));
 	m_textureEffect->SetProjMtxBuffer(m_projCB);
 	m_textureEffect->SetViewMtxBuffer(m_viewCB);
 	m_textureEffect->SetWorldMtxBuffer(m_worldCB);
 	m_textureEffect->SetTextureMtxBuffer(m_textureCB);
 	m_textureEffect->SetSamplerState(m_samplerWrap);
-	m_textureEffect->SetTexture(m_wallTexture);
 
-	m_colorTexEffect.reset(new ColorTexEffect(m_device, m_layout));
+	m_floorEffect.reset(new MaterialEffect(m_device, m_layout, m_materialShaders, MaterialEffect::TEXTURE));
+	m_floorEffect->SetProjMtxBuffer(m_projCB);
+	m_floorEffect->SetViewMtxBuffer(m_viewCB);
+	m_floorEffect->SetWorldMtxBuffer(m_worldCB);
+	m_floorEffect->SetTextureMtxBuffer(m_floorTexCB);
+	m_floorEffect->SetSamplerState(m_samplerWrap);
+	m_floorEffect->SetTexture(m_woodTexture);
+
+	m_colorTexEffect.reset(new MaterialEffect(m_device, m_layout, m_materialShaders,
+											  MaterialEffect::TEXTURE | MaterialEffect::SURFACE_COLOR));
 	m_colorTexEffect->SetProjMtxBuffer(m_projCB);
 	m_colorTexEffect->SetViewMtxBuffer(m_viewCB);
 	m_colorTexEffect->SetWorldMtxBuffer(m_worldCB);
 	m_colorTexEffect->SetTextureMtxBuffer(m_textureCB);
 	m_colorTexEffect->SetSamplerState(m_samplerWrap);
-	m_colorTexEffect->SetTexture(m_perlinTexture);
 	m_colorTexEffect->SetSurfaceColorBuffer(m_surfaceColorCB);
 
-	m_multiTexEffect.reset(new MultiTexEffect(m_device, m_layout));
+	m_multiTexEffect.reset(new MaterialEffect(m_device, m_layout, m_materialShaders,
+											  MaterialEffect::TEXTURE | MaterialEffect::SECOND_TEXTURE));
 	m_multiTexEffect->SetProjMtxBuffer(m_projCB);
 	m_multiTexEffect->SetViewMtxBuffer(m_viewCB);
 	m_multiTexEffect->SetWorldMtxBuffer(m_worldCB);
-	m_multiTexEffect->Set1stTextureMtxBuffer(m_textureCB);
-	m_multiTexEffect->Set2ndTextureMtxBuffer(m_posterTexCB);
+	m_multiTexEffect->SetTextureMtxBuffer(m_textureCB);
+	m_multiTexEffect->SetSecondTextureMtxBuffer(m_posterTexCB);
 	m_multiTexEffect->SetSamplerState(m_samplerBorder);
-	m_multiTexEffect->Set1stTexture(m_wallTexture);
-	m_multiTexEffect->Set2ndTexture(m_posterTexture);
 
-	m_environmentMapper.reset(new EnvironmentMapper(m_device, m_layout, m_context, 0.4f, 8.0f,
+	m_environmentMapper.reset(new EnvironmentMapper(m_device, m_layout, m_materialShaders, m_context, 0.4f, 8.0f,
 													XMFLOAT3(-1.3f, -0.74f, -0.6f)));
 	m_environmentMapper->SetProjMtxBuffer(m_projCB);
 	m_environmentMapper->SetViewMtxBuffer(m_viewCB);
@@ -225,12 +320,71 @@ bool Room::LoadContent()
 	m_particles->SetViewMtxBuffer(m_viewCB);
 	m_particles->SetProjMtxBuffer(m_projCB);
 	m_particles->SetSamplerState(m_samplerWrap);
+
+	const XMFLOAT4& probe = m_environmentMapper->getPosition();
+	m_probeScheduler.reset(new ProbeScheduler(XMFLOAT3(probe.x, probe.y, probe.z), m_environmentMapper->getFarPlane(),
+											  PROBE_SETTINGS));
+	for (unsigned int i = 0; i < OBJECTS_COUNT; ++i)
+		m_probeScheduler->AddObject(m_objects[i]->getWorldBox());
+	//Particles change every frame, their reflection is refreshed at the scheduler's lower rate
+	m_particlesProbeObject = m_probeScheduler->AddObject(m_particles->getBounds(), true);
+	InitializeRenderQueue();
 	return true;
 }
 
-void Room::UnloadContent()
+void Room::InitializeRenderQueue()
 {
+	m_renderQueue.reset(new RenderQueue(m_worldCB, m_surfaceColorCB, m_bsAlpha, m_dssNoWrite));
+	//Effect ids follow the shader variants, texture ids the textures bound
+	enum { PHONG, TEXTURE, COLOR_TEXTURE, MULTI_TEXTURE, ENV_MAP };
+	enum { NO_TEXTURE, WOOD, WALL, PERLIN, POSTER, ENV_TEXTURE };
+	RenderQueue::Material m;
+	m.Transparent = false;
+	m.Effect = m_floorEffect;
+	m.EffectId = TEXTURE;
+	m.TextureId = WOOD;
+	m_floorMaterial = m_renderQueue->AddMaterial(m);
+	m.Effect = m_textureEffect;
+	m.TextureId = WALL;
+	m_wallMaterial = m_renderQueue->AddMaterial(m);
+	m.Effect = m_colorTexEffect;
+	m.EffectId = COLOR_TEXTURE;
+	m.TextureId = PERLIN;
+	m_ceilingMaterial = m_renderQueue->AddMaterial(m);
+	m.Effect = m_multiTexEffect;
+	m.EffectId = MULTI_TEXTURE;
+	m.TextureId = POSTER;
+	m_posterWallMaterial = m_renderQueue->AddMaterial(m);
+	m.Effect = m_environmentMapper;
+	m.EffectId = ENV_MAP;
+	m.TextureId = ENV_TEXTURE;
+	m_teapotMaterial = m_renderQueue->AddMaterial(m);
+	m.Effect = m_phongEffect;
+	m.EffectId = PHONG;
+	m.TextureId = NO_TEXTURE;
+	m_phongMaterial = m_renderQueue->AddMaterial(m);
+	m.Transparent = true;
+	m_tableMaterial = m_renderQueue->AddMaterial(m);
+}
 
+void Room::UnloadContent()
+{
+	if (m_materialShaders == nullptr)
+		return;
+	wostringstream report;
+	report << L"Material shader permutations: " << m_materialShaders->getPermutationsCount() << L", lookups: "
+		   << m_materialShaders->getLookupsCount() << L", hit rate: " << m_materialShaders->getHitRate() * 100.0f
+		   << L"%" << endl;
+	if (m_probeScheduler != nullptr)
+	{
+		const ProbeScheduler::Statistics& probe = m_probeScheduler->getTotalStatistics();
+		report << L"Environment map faces refreshed: " << probe.Refreshed << L", deferred: " << probe.Deferred
+			   << endl;
+	}
+	report << L"Frame graph textures: " << m_transientTextures.getCount() << L", created: "
+		   << m_transientTextures.getCreatedCount() << endl;
+	m_frameGraph.WriteTimeline(report);
+	OutputDebugStringW(report.str().c_str());
 }
 
 void Room::UpdateCamera()
@@ -239,6 +393,12 @@ void Room::UpdateCamera()
 	m_camera.GetViewMatrix(view);
 	m_viewCB->Update(m_context, view);
 	m_cameraPosCB->Update(m_context, m_camera.GetPosition());
+	m_frustum.Update(view * m_projMtx);
+}
+
+bool Room::IsVisible(const Mesh& mesh) const
+{
+	return m_frustum.Intersects(mesh.getWorldBox());
 }
 
 void Room::UpdateLamp(float dt)
@@ -250,10 +410,65 @@ void Room::UpdateLamp(float dt)
 	XMMATRIX lamp = XMMatrixTranslation(0.0f, -0.4f, 0.0f) * XMMatrixRotationX(swing) * XMMatrixRotationY(rot) *
 					XMMatrixTranslation(0.0f, 2.0f, 0.0f);
 	m_lamp.setWorldMatrix(lamp);
+	UpdateObjectsBounds(false);
+}
+
+void Room::UpdateObjectsBounds(bool rebuild)
+{
+	BoundingBox boxes[OBJECTS_COUNT];
+	for (unsigned int i = 0; i < OBJECTS_COUNT; ++i)
+		boxes[i] = m_objects[i]->getWorldBox();
+	if (rebuild)
+		m_sceneBVH.Build(boxes, OBJECTS_COUNT);
+	else
+	{
+		unsigned int lamp = LAMP_OBJECT;
+		m_sceneBVH.Refit(&lamp, 1, boxes);
+	}
+}
+
+void Room::UpdateProbeScheduler()
+{
+	m_probeScheduler->UpdateObject(LAMP_OBJECT, m_lamp.getWorldBox());
+	m_probeScheduler->UpdateObject(m_particlesProbeObject, m_particles->getBounds());
+}
+
+void Room::PickObject()
+{
+	unsigned int previous = m_pickedObject;
+	POINT p;
+	GetCursorPos(&p);
+	ScreenToClient(getMainWindow()->getHandle(), &p);
+	SIZE s = getMainWindow()->getClientSize();
+	float x = 2.0f * p.x / s.cx - 1.0f;
+	float y = 1.0f - 2.0f * p.y / s.cy;
+	XMMATRIX view;
+	m_camera.GetViewMatrix(view);
+	XMVECTOR det;
+	XMMATRIX invViewProj = XMMatrixInverse(&det, view * m_projMtx);
+	XMVECTOR nearPt = XMVector3TransformCoord(XMVectorSet(x, y, 0.0f, 1.0f), invViewProj);
+	XMVECTOR farPt = XMVector3TransformCoord(XMVectorSet(x, y, 1.0f, 1.0f), invViewProj);
+	//Boxes are visited front to back until the nearest triangle hit is closer than the next box
+	vector<SceneBVH::RayHit> hits;
+	m_sceneBVH.QueryRay(nearPt, farPt - nearPt, hits);
+	float distance = FLT_MAX;
+	m_pickedObject = SceneBVH::NO_INSTANCE;
+	for (unsigned int i = 0; i < hits.size() && hits[i].Distance < distance; ++i)
+		if (m_objects[hits[i].Instance]->Raycast(nearPt, farPt - nearPt, distance))
+			m_pickedObject = hits[i].Instance;
+	//Picked object is highlighted in the reflections as well
+	if (m_pickedObject != previous)
+	{
+		if (previous != SceneBVH::NO_INSTANCE)
+			m_probeScheduler->TouchObject(previous);
+		if (m_pickedObject != SceneBVH::NO_INSTANCE)
+			m_probeScheduler->TouchObject(m_pickedObject);
+	}
 }
 
 void Room::Update(float dt)
 {
+	m_assetLoader.Finalize();
 	UpdateLamp(dt);
 	static MouseState prevState;
 	MouseState currentState;
@@ -272,186 +487,119 @@ void Room::Update(float dt)
 		}
 		else
 			change = false;
+		if (currentState.isButtonDown(2) && !prevState.isButtonDown(2))
+			PickObject();
 		prevState = currentState;
 		if (change)
 			UpdateCamera();
 	}
 	m_particles->Update(m_context, dt, m_camera.GetPosition());
+	UpdateProbeScheduler();
 }
 
-void Room::DrawWalls()
+void Room::QueueWalls()
 {
-	//Draw floor
-	m_textureCB->Update(m_context, XMMatrixScaling(0.25f, 4.0f, 1.0f) * XMMatrixTranslation(0.5f, 0.5f, 0.0f));
-	m_textureEffect->SetTexture(m_woodTexture);
-	m_textureEffect->Begin(m_context);
-	m_worldCB->Update(m_context, m_walls[4].getWorldMatrix());
-	m_walls[4].Render(m_context);
-	m_textureEffect->End();
-
-	//Draw ceiling
-	m_surfaceColorCB->Update(m_context, XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f));
-	m_textureCB->Update(m_context, XMMatrixScaling(0.25f, 0.25f, 0.25f) * XMMatrixTranslation(0.5f, 0.5f, 0.0f));
-	m_colorTexEffect->Begin(m_context);
-	m_worldCB->Update(m_context, m_walls[5].getWorldMatrix());
-	m_walls[5].Render(m_context);
-	m_colorTexEffect->End();
-
-	//draw back wall
-	m_multiTexEffect->Begin(m_context);
-	m_worldCB->Update(m_context, m_walls[0].getWorldMatrix());
-	m_walls[0].Render(m_context);
-	m_multiTexEffect->End();
-
-	//draw remaining walls
-	m_textureEffect->SetTexture(m_wallTexture);
-	m_textureEffect->Begin(m_context);
+	if (IsVisible(m_walls[4]))
+		m_renderQueue->Add(m_floorMaterial, m_walls[4], WHITE);
+	if (IsVisible(m_walls[5]))
+		m_renderQueue->Add(m_ceilingMaterial, m_walls[5], XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f));
+	if (IsVisible(m_walls[0]))
+		m_renderQueue->Add(m_posterWallMaterial, m_walls[0], WHITE);
 	for (int i = 1; i < 4; ++i)
-	{
-		m_worldCB->Update(m_context, m_walls[i].getWorldMatrix());
-		m_walls[i].Render(m_context);
-	}
-	m_textureEffect->End();
-
+		if (IsVisible(m_walls[i]))
+			m_renderQueue->Add(m_wallMaterial, m_walls[i], WHITE);
 }
 
-void Room::DrawTeapot()
+void Room::QueueObjects()
 {
-	m_environmentMapper->Begin(m_context);
-	m_surfaceColorCB->Update(m_context, XMFLOAT4(0.8f, 0.7f, 0.65f, 1.0f));
-
-	m_worldCB->Update(m_context, m_teapot.getWorldMatrix());
-	m_teapot.Render(m_context);
-	//m_worldCB->Update(m_context, m_debugSphere.getWorldMatrix());
-	//m_debugSphere.Render(m_context);
-
-	m_surfaceColorCB->Update(m_context, XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f));
-	m_environmentMapper->End();
+	if (IsVisible(m_teapot))
+		m_renderQueue->Add(m_teapotMaterial, m_teapot, XMFLOAT4(0.8f, 0.7f, 0.65f, 1.0f));
+	//Shelf, lamp, chair seat, chairframe, monitor and screen
+	vector<unsigned int> visibility;
+	m_sceneBVH.QueryFrustum(m_frustum, visibility);
+	for (unsigned int i = 0; i < OBJECTS_COUNT; ++i)
+		if (Frustum::IsVisible(visibility, i))
+			m_renderQueue->Add(m_phongMaterial, *m_objects[i],
+							   i == m_pickedObject ? XMFLOAT4(1.0f, 0.8f, 0.3f, 1.0f) : WHITE);
 }
 
-void Room::DrawTableElement(Mesh& element)
+void Room::QueueTableElement(Mesh& element)
 {
-	m_worldCB->Update(m_context, element.getWorldMatrix());
-	m_context->RSSetState(m_rsCullFront.get());
-	element.Render(m_context);
-	m_context->RSSetState(nullptr);
-	element.Render(m_context);
+	if (!IsVisible(element))
+		return;
+	float radius = element.getWorldSphere().Radius;
+	m_renderQueue->Add(m_tableMaterial, element, TABLE_COLOR, m_rsCullFront.get(), radius);
+	m_renderQueue->Add(m_tableMaterial, element, TABLE_COLOR, nullptr, -radius);
 }
 
-void Room::DrawTableLegs(XMVECTOR camVec)
+void Room::QueueTransparentObjects()
 {
-	XMFLOAT4 v(1.0f, 0.0f, 0.0f, 0.0f);
-	XMVECTOR plane1 = XMLoadFloat4(&v);
-	v = XMFLOAT4(0.0f, 0.0f, 1.0f, 0.0f);
-	XMVECTOR plane2 = XMLoadFloat4(&v);
-	bool left = XMVector3Dot(camVec, plane1).m128_f32[0] > 0;
-	bool back = XMVector3Dot(camVec, plane2).m128_f32[0] > 0;
-	if (left)
-	{
-		if (back)
-		{
-			DrawTableElement(m_tableLegs[2]);
-			DrawTableElement(m_tableLegs[3]);
-			DrawTableElement(m_tableLegs[1]);
-			DrawTableElement(m_tableLegs[0]);
-		}
-		else
-		{
-			DrawTableElement(m_tableLegs[3]);
-			DrawTableElement(m_tableLegs[2]);
-			DrawTableElement(m_tableLegs[0]);
-			DrawTableElement(m_tableLegs[1]);
-		}
-	}
-	else
-	{
+	QueueTableElement(m_tableSide);
+	QueueTableElement(m_tableTop);
+	for (int i = 0; i < 4; ++i)
+		QueueTableElement(m_tableLegs[i]);
+	m_renderQueue->Add(RenderKey::LAYER_TRANSPARENT, m_particles->getEmitterPosition(),
+					   [this]() { m_particles->Render(m_context); });
+}
 
-		if (back)
-		{
-			DrawTableElement(m_tableLegs[1]);
-			DrawTableElement(m_tableLegs[0]);
-			DrawTableElement(m_tableLegs[2]);
-			DrawTableElement(m_tableLegs[3]);
-		}
-		else
-		{
-			DrawTableElement(m_tableLegs[0]);
-			DrawTableElement(m_tableLegs[1]);
-			DrawTableElement(m_tableLegs[3]);
-			DrawTableElement(m_tableLegs[2]);
-		}
-	}
+void Room::DrawScene(const XMFLOAT4& eye, float farPlane)
+{
+	m_renderQueue->Begin(eye, farPlane);
+	QueueWalls();
+	QueueObjects();
+	QueueTransparentObjects();
+	m_renderQueue->Submit(m_context);
 }
 
-void Room::DrawTransparentObjects()
+void Room::BuildFrameGraph(const vector<unsigned int>& faces)
 {
-	m_context->OMSetBlendState(m_bsAlpha.get(), nullptr, BS_MASK);
-	m_context->OMSetDepthStencilState(m_dssNoWrite.get(), 0);
-
-	m_surfaceColorCB->Update(m_context, XMFLOAT4(0.1f, 0.1f, 0.1f, 0.9f));
-	XMFLOAT4 v = m_camera.GetPosition();
-	XMVECTOR camVec = XMVector3Normalize(XMLoadFloat4(&v) - XMLoadFloat4(&TABLE_POS));
-	v = XMFLOAT4(0.0f, 1.0f, 0.0f, 0.0f);
-	XMVECTOR plane = XMLoadFloat4(&v);
-	if (XMVector3Dot(camVec, plane).m128_f32[0] > 0)
+	m_frameGraph.Clear();
+	unsigned int backBuffer = m_frameGraph.Import("BackBuffer");
+	unsigned int depthStencil = m_frameGraph.Import("DepthStencil");
+	unsigned int environment = m_frameGraph.Import("EnvironmentMap");
+	m_frameGraph.MarkOutput(backBuffer);
+	unsigned int size = m_environmentMapper->getTextureSize();
+	FrameGraph::TextureDesc colorDesc = { size, size, DXGI_FORMAT_R8G8B8A8_UNORM, D3D11_BIND_RENDER_TARGET };
+	FrameGraph::TextureDesc depthDesc = { size, size, DXGI_FORMAT_D24_UNORM_S8_UINT, D3D11_BIND_DEPTH_STENCIL };
+	//Every face has its own targets, they don't live at the same time, so the graph puts them in one pair of
+	//textures
+	for (auto it = faces.begin(); it != faces.end(); ++it)
 	{
-		m_phongEffect->Begin(m_context);
-		m_context->RSSetState(m_rsCullFront.get());
-		m_worldCB->Update(m_context, m_tableSide.getWorldMatrix());
-		m_tableSide.Render(m_context);
-		m_context->RSSetState(nullptr);
-		DrawTableLegs(camVec);
-		m_worldCB->Update(m_context, m_tableSide.getWorldMatrix());
-		m_tableSide.Render(m_context);
-		DrawTableElement(m_tableTop);
-		m_phongEffect->End();
-		m_particles->Render(m_context);
+		D3D11_TEXTURECUBE_FACE face = static_cast<D3D11_TEXTURECUBE_FACE>(*it);
+		string suffix = to_string(*it);
+		unsigned int color = m_frameGraph.Create("FaceColor" + suffix, colorDesc);
+		unsigned int depth = m_frameGraph.Create("FaceDepth" + suffix, depthDesc);
+		unsigned int pass = m_frameGraph.AddPass(m_facePassNames[*it], [this, face, color, depth]()
+		{
+			auto mapper = m_environmentMapper.get();
+			mapper->SetupFace(m_context, face, m_transientTextures.getRenderTarget(color),
+							  m_transientTextures.getDepthStencil(depth));
+			m_frustum.Update(XMLoadFloat4x4(&mapper->getFaceViewProjMtx()));
+			DrawScene(mapper->getPosition(), mapper->getFarPlane());
+		});
+		m_frameGraph.Write(pass, color);
+		m_frameGraph.Write(pass, depth);
+		pass = m_frameGraph.AddPass(m_copyFacePassNames[*it], [this, face, color]()
+			{ m_environmentMapper->EndFace(face, m_transientTextures.getTexture(color)); });
+		m_frameGraph.Read(pass, color);
+		m_frameGraph.Write(pass, environment);
 	}
-	else
+	unsigned int pass = m_frameGraph.AddPass("Scene", [this]()
 	{
-		m_particles->Render(m_context);
-		m_phongEffect->Begin(m_context);
-		DrawTableElement(m_tableTop);
-		m_context->RSSetState(m_rsCullFront.get());
-		m_worldCB->Update(m_context, m_tableSide.getWorldMatrix());
-		m_tableSide.Render(m_context);
-		m_context->RSSetState(nullptr);
-		DrawTableLegs(camVec);
-		m_worldCB->Update(m_context, m_tableSide.getWorldMatrix());
-		m_tableSide.Render(m_context);
-		m_phongEffect->End();
-	}
-	m_surfaceColorCB->Update(m_context, XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f));
-	m_context->OMSetDepthStencilState(nullptr, 0);
-	m_context->OMSetBlendState(nullptr, nullptr, BS_MASK);
-}
-
-void Room::DrawScene()
-{
-
-	DrawWalls();
-	DrawTeapot();
-	m_phongEffect->Begin(m_context);
-	//Draw shelf
-	m_worldCB->Update(m_context, m_box.getWorldMatrix());
-	m_box.Render(m_context);
-	//Draw lamp
-	m_worldCB->Update(m_context, m_lamp.getWorldMatrix());
-	m_lamp.Render(m_context);
-	//Draw chair seat
-	m_worldCB->Update(m_context, m_chairSeat.getWorldMatrix());
-	m_chairSeat.Render(m_context);
-	//Draw chairframe
-	m_worldCB->Update(m_context, m_chairBack.getWorldMatrix());
-	m_chairBack.Render(m_context);
-	//Draw monitor
-	m_worldCB->Update(m_context, m_monitor.getWorldMatrix());
-	m_monitor.Render(m_context);
-	//Draw screen
-	m_worldCB->Update(m_context, m_screen.getWorldMatrix());
-	m_screen.Render(m_context);
-	m_phongEffect->End();
-	DrawTransparentObjects();
+		ResetRenderTarget();
+		m_projCB->Update(m_context, m_projMtx);
+		UpdateCamera();
+		//Clear buffers
+		float clearColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		m_context->ClearRenderTargetView(m_backBuffer.get(), clearColor);
+		m_context->ClearDepthStencilView(m_depthStencilView.get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL,
+										 1.0f, 0);
+		DrawScene(m_camera.GetPosition(), FAR_PLANE);
+	});
+	m_frameGraph.Read(pass, environment);
+	m_frameGraph.Write(pass, backBuffer);
+	m_frameGraph.Write(pass, depthStencil);
+	m_frameGraph.Compile();
 }
 
 void Room::Render()
@@ -459,25 +607,9 @@ void Room::Render()
 	if (m_context == nullptr)
 		return;
 
-	auto mapper = m_environmentMapper.get();
-
-
-
-	for (size_t i = 0; i < 6; i++)
-	{
-		mapper->SetupFace(m_context, (D3D11_TEXTURECUBE_FACE)i);
-		
-		DrawScene();
-		mapper->EndFace();
-	}
-
-	ResetRenderTarget();
-	m_projCB->Update(m_context, m_projMtx);
-	UpdateCamera();
-	//Clear buffers
-	float clearColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
-	m_context->ClearRenderTargetView(m_backBuffer.get(), clearColor);
-	m_context->ClearDepthStencilView(m_depthStencilView.get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
-	DrawScene();
+	//Only the faces whose contents changed are rendered, the others keep the previous frames' image
+	BuildFrameGraph(m_probeScheduler->Schedule());
+	m_transientTextures.Realize(m_device, m_frameGraph);
+	m_frameGraph.Execute(&Milliseconds);
 	m_swapChain->Present(0, 0);
 }
@@ -4,25 +4,27 @@
 #include "gk2_applicationBase.h"
 #include "gk2_meshLoader.h"
 #include "gk2_camera.h"
-#include "gk2_phongEffect.h"
-#include "gk2_textureEffect.h"
+#include "gk2_materialEffect.h"
 #include "gk2_constantBuffer.h"
-#include "gk2_colorTexEffect.h"
-#include "gk2_multiTexEffect.h"
 #include "gk2_environmentMapper.h"
 #include "gk2_particles.h"
+#include "gk2_frustum.h"
+#include "gk2_sceneBVH.h"
+#include "gk2_renderQueue.h"
+#include "gk2_probeScheduler.h"
+#include "gk2_frameGraph.h"
+#include "gk2_transientTextures.h"
+#include "gk2_assetLoader.h"
+#include "gk2_aligned.h"
 
 namespace gk2
 {
-	class Room : public gk2::ApplicationBase
+	class Room : public gk2::ApplicationBase, public gk2::AlignedNew
 	{
 	public:
 		Room(HINSTANCE hInstance);
 		virtual ~Room();
 
-		static void* operator new(size_t size);
-		static void operator delete(void* ptr);
-
 	protected:
 		virtual bool LoadContent();
 		virtual void UnloadContent();
@@ -34,9 +36,14 @@ namespace gk2
 		static const float TABLE_H;
 		static const float TABLE_TOP_H;
 		static const float TABLE_R;
+		static const float FAR_PLANE;
 		static const XMFLOAT4 TABLE_POS;
 		static const XMFLOAT4 LIGHT_POS[2];
-		static const unsigned int BS_MASK;
+		static const unsigned int OBJECTS_COUNT = 6;
+		static const unsigned int LAMP_OBJECT = 1;
+		static const XMFLOAT4 WHITE;
+		static const XMFLOAT4 TABLE_COLOR;
+		static const gk2::ProbeScheduler::Settings PROBE_SETTINGS;
 
 		gk2::Mesh m_walls[6];
 		gk2::Mesh m_teapot;
@@ -50,17 +57,23 @@ namespace gk2
 		gk2::Mesh m_tableTop;
 		gk2::Mesh m_monitor;
 		gk2::Mesh m_screen;
+		gk2::Mesh* m_objects[OBJECTS_COUNT];
+		unsigned int m_pickedObject;
 
 		XMMATRIX m_projMtx;
+		gk2::Frustum m_frustum;
+		gk2::SceneBVH m_sceneBVH;
 
 		gk2::Camera m_camera;
 		gk2::MeshLoader m_meshLoader;
+		gk2::AssetLoader m_assetLoader;
 
 		std::shared_ptr<gk2::CBMatrix> m_worldCB;
 		std::shared_ptr<gk2::CBMatrix> m_viewCB;
 		std::shared_ptr<gk2::CBMatrix> m_projCB;
 		std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4, 2>> m_lightPosCB;
 		std::shared_ptr<gk2::CBMatrix> m_textureCB;
+		std::shared_ptr<gk2::CBMatrix> m_floorTexCB;
 		std::shared_ptr<gk2::CBMatrix> m_posterTexCB;
 		std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4>> m_surfaceColorCB;
 		std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4>> m_cameraPosCB;
@@ -72,11 +85,16 @@ namespace gk2
 		std::shared_ptr<ID3D11ShaderResourceView> m_perlinTexture;
 		std::shared_ptr<ID3D11ShaderResourceView> m_woodTexture;
 
-		std::shared_ptr<gk2::PhongEffect> m_phongEffect;
-		std::shared_ptr<gk2::TextureEffect> m_textureEffect;
-		std::shared_ptr<gk2::ColorTexEffect> m_colorTexEffect;
-		std::shared_ptr<gk2::MultiTexEffect> m_multiTexEffect;
+		std::shared_ptr<gk2::ShaderPermutations> m_materialShaders;
+		std::shared_ptr<gk2::MaterialEffect> m_phongEffect;
+		std::shared_ptr<gk2::MaterialEffect> m_textureEffect;
+		std::shared_ptr<gk2::MaterialEffect> m_floorEffect;
+		std::shared_ptr<gk2::MaterialEffect> m_colorTexEffect;
+		std::shared_ptr<gk2::MaterialEffect> m_multiTexEffect;
 		std::shared_ptr<gk2::EnvironmentMapper> m_environmentMapper;
+		//Objects are registered in m_objects order, so their ids are the same
+		std::shared_ptr<gk2::ProbeScheduler> m_probeScheduler;
+		unsigned int m_particlesProbeObject;
 		std::shared_ptr<gk2::ParticleSystem> m_particles;
 		std::shared_ptr<ID3D11InputLayout> m_layout;
 
@@ -84,20 +102,46 @@ namespace gk2
 		std::shared_ptr<ID3D11BlendState> m_bsAlpha;
 		std::shared_ptr<ID3D11DepthStencilState> m_dssNoWrite;
 
+		std::shared_ptr<gk2::RenderQueue> m_renderQueue;
+		unsigned int m_floorMaterial;
+		unsigned int m_ceilingMaterial;
+		unsigned int m_posterWallMaterial;
+		unsigned int m_wallMaterial;
+		unsigned int m_teapotMaterial;
+		unsigned int m_phongMaterial;
+		unsigned int m_tableMaterial;
+
+		gk2::FrameGraph m_frameGraph;
+		gk2::TransientTextures m_transientTextures;
+		//Names of the passes of each cube face, interned once as the graph is rebuilt every frame
+		const char* m_facePassNames[6];
+		const char* m_copyFacePassNames[6];
+
 		void InitializeConstantBuffers();
 		void InitializeTextures();
 		void InitializeCamera();
 		void InitializeRenderStates();
+		void InitializeRenderQueue();
 		void CreateScene();
+		void LoadTextureAsync(const std::wstring& fileName, std::shared_ptr<ID3D11ShaderResourceView>& texture);
+		void LoadMeshAsync(const std::wstring& fileName, gk2::Mesh& mesh);
+		void SetEffectTextures();
+		std::shared_ptr<ID3D11ShaderResourceView> CreateWoodTexture();
 		void UpdateCamera();
 		void UpdateLamp(float dt);
-
-		void DrawScene();
-		void DrawWalls();
-		void DrawTeapot();
-		void DrawTableElement(gk2::Mesh& element);
-		void DrawTableLegs(XMVECTOR camVec);
-		void DrawTransparentObjects();
+		void UpdateObjectsBounds(bool rebuild);
+		void UpdateProbeScheduler();
+		void PickObject();
+		bool IsVisible(const gk2::Mesh& mesh) const;
+
+		//Passes of the environment map faces to refresh and of the camera view, rebuilt every frame
+		void BuildFrameGraph(const std::vector<unsigned int>& faces);
+		void DrawScene(const XMFLOAT4& eye, float farPlane);
+		void QueueWalls();
+		void QueueObjects();
+		//Back faces of the element are sorted behind its front faces
+		void QueueTableElement(gk2::Mesh& element);
+		void QueueTransparentObjects();
 	};
 }
 
@@ -0,0 +1,73 @@
+#ifndef __GK2_SCENE_BVH_H_
+#define __GK2_SCENE_BVH_H_
+
+#include <d3d11.h>
+#include <xnamath.h>
+#include <vector>
+#include "gk2_bounds.h"
+#include "gk2_frustum.h"
+
+namespace gk2
+{
+	//Bounding volume hierarchy over scene object instances. Instances are identified by their index in
+	//the bounds array passed to Build. Every node covers a contiguous range of the instance list, so
+	//a node that lies entirely inside a frustum is accepted without visiting its children.
+	class SceneBVH
+	{
+	public:
+		static const unsigned int NO_INSTANCE = 0xffffffff;
+		static const unsigned int MAX_LEAF_SIZE = 4;
+		static const unsigned int SAH_BINS = 16;
+
+		struct RayHit
+		{
+			unsigned int Instance;
+			float Distance;	//distance along the ray to the instance's bounding box
+
+			bool operator <(const RayHit& right) const { return Distance < right.Distance; }
+		};
+
+		SceneBVH();
+
+		void Build(const gk2::BoundingBox* bounds, unsigned int count);
+		//Updates boxes of the listed instances (bounds is indexed by instance, as in Build) and their
+		//ancestors. Topology stays the same, so rebuild if objects move far from their original position.
+		void Refit(const unsigned int* instances, unsigned int instancesCount, const gk2::BoundingBox* bounds);
+		void Refit(const gk2::BoundingBox* bounds);
+
+		//Visibility bitmask in the same format as Frustum::Test. Returns the number of visible instances.
+		unsigned int QueryFrustum(const gk2::Frustum& frustum, std::vector<unsigned int>& visibility) const;
+		//All instances whose bounding boxes are hit by the ray, sorted by distance.
+		void QueryRay(FXMVECTOR origin, FXMVECTOR direction, std::vector<RayHit>& hits) const;
+		//Instance with the nearest bounding box hit by the ray or NO_INSTANCE.
+		unsigned int Pick(FXMVECTOR origin, FXMVECTOR direction, float* distance = nullptr) const;
+
+		unsigned int getInstanceCount() const { return static_cast<unsigned int>(m_instanceLeaf.size()); }
+		unsigned int getNodeCount() const { return static_cast<unsigned int>(m_nodes.size()); }
+		gk2::BoundingBox getBounds() const;
+
+	private:
+		struct Node
+		{
+			XMFLOAT3 Min;
+			XMFLOAT3 Max;
+			unsigned int First;		//first instance in m_instances covered by the node
+			unsigned int Count;		//number of instances covered by the node
+			unsigned int Left;		//index of the left child (right one is Left + 1), 0 for leaves
+			unsigned int Parent;
+		};
+
+		std::vector<Node> m_nodes;
+		std::vector<unsigned int> m_instances;
+		std::vector<unsigned int> m_instanceLeaf;
+		std::vector<XMFLOAT3> m_min;
+		std::vector<XMFLOAT3> m_max;
+
+		void Split(unsigned int nodeIdx, std::vector<XMFLOAT3>& centroids);
+		void SetInstanceBounds(unsigned int i, const gk2::BoundingBox& box);
+		void UpdateLeaf(Node& node);
+		void UpdateInternal(Node& node);
+	};
+}
+
+#endif __GK2_SCENE_BVH_H_
@@ -0,0 +1,68 @@
+#ifndef __GK2_SHADER_CACHE_H_
+#define __GK2_SHADER_CACHE_H_
+
+#include "gk2_assetCache.h"
+#include <memory>
+#include <string>
+#include <vector>
+#include <utility>
+#include <functional>
+
+namespace gk2
+{
+	typedef std::vector<std::pair<std::string, std::string>> ShaderDefines;
+
+	struct ShaderDesc
+	{
+		std::wstring File;
+		std::string Entry;
+		std::string Model;
+		ShaderDefines Defines;
+	};
+
+	//Compiles shader source into byteCode and lists paths of all files it included.
+	//Compilation errors are reported by throwing.
+	typedef std::function<void(const gk2::ShaderDesc& desc, const std::vector<BYTE>& source,
+							   std::vector<BYTE>& byteCode, std::vector<std::wstring>& includes)> ShaderCompiler;
+
+	//Shader byte code kept in the asset cache. Entries are keyed by the hash of the shader source, entry point,
+	//shader model, defines and compiler flags. Included files are recorded together with their hashes and checked
+	//on lookup, so modifying an include triggers recompilation as well.
+	//Sources, includes and the manifest are read through the file system of the asset cache, or from the disk
+	//without one.
+	class ShaderCache
+	{
+	public:
+		static const unsigned int COOKER_VERSION = 1;
+
+		ShaderCache(const std::shared_ptr<gk2::AssetCache>& cache, const gk2::ShaderCompiler& compiler,
+					unsigned int compilerFlags = 0);
+
+		//Returns cached byte code or compiles the shader and stores the result
+		std::vector<BYTE> Get(const gk2::ShaderDesc& desc);
+		//Compiles all the listed shaders not yet present in the cache. Returns shaders which failed to compile.
+		std::vector<gk2::ShaderDesc> Precompile(const std::vector<gk2::ShaderDesc>& shaders);
+
+		//Manifest lists one shader per line: file, entry point, shader model and optional NAME=VALUE defines,
+		//separated by whitespace. Empty lines and lines starting with # are ignored.
+		std::vector<gk2::ShaderDesc> ReadManifest(const std::wstring& fileName) const;
+
+		unsigned int getHits() const { return m_hits; }
+		unsigned int getMisses() const { return m_misses; }
+
+	private:
+		std::shared_ptr<gk2::AssetCache> m_cache;
+		std::shared_ptr<gk2::FileSystem> m_fileSystem;
+		gk2::ShaderCompiler m_compiler;
+		unsigned int m_compilerFlags;
+		unsigned int m_hits;
+		unsigned int m_misses;
+
+		unsigned long long Key(const gk2::ShaderDesc& desc, const std::vector<BYTE>& source) const;
+		bool ReadArtifact(const std::vector<BYTE>& artifact, std::vector<BYTE>& byteCode) const;
+		void WriteArtifact(const std::vector<std::wstring>& includes, const std::vector<BYTE>& byteCode,
+						   std::vector<BYTE>& artifact) const;
+	};
+}
+
+#endif __GK2_SHADER_CACHE_H_
@@ -0,0 +1,63 @@
+#include "gk2_shaderPermutations.h"
+#include <cassert>
+
+using namespace std;
+using namespace gk2;
+
+ShaderPermutations::ShaderPermutations(const DeviceHelper& device, const wstring& shaderFile,
+									   const vector<string>& features)
+	: m_device(device), m_shaderFile(shaderFile), m_features(features), m_permutationsCount(0), m_lookups(0),
+	  m_misses(0)
+{
+	assert(features.size() <= MAX_FEATURES);
+	m_variants.resize(1 << features.size());
+}
+
+const ShaderPermutations::Variant& ShaderPermutations::Get(unsigned int features)
+{
+	assert(features < m_variants.size());
+	++m_lookups;
+	if (!m_variants[features])
+	{
+		++m_misses;
+		Compile(features);
+	}
+	return *m_variants[features];
+}
+
+void ShaderPermutations::Precompile(const vector<unsigned int>& features)
+{
+	for (auto it = features.begin(); it != features.end(); ++it)
+	{
+		assert(*it < m_variants.size());
+		if (!m_variants[*it])
+			Compile(*it);
+	}
+}
+
+float ShaderPermutations::getHitRate() const
+{
+	if (m_lookups == 0)
+		return 0.0f;
+	return static_cast<float>(m_lookups - m_misses) / m_lookups;
+}
+
+void ShaderPermutations::Compile(unsigned int features)
+{
+	vector<D3D10_SHADER_MACRO> defines;
+	for (unsigned int i = 0; i < m_features.size(); ++i)
+		if (features & (1 << i))
+		{
+			D3D10_SHADER_MACRO define = { m_features[i].c_str(), "1" };
+			defines.push_back(define);
+		}
+	D3D10_SHADER_MACRO end = { nullptr, nullptr };
+	defines.push_back(end);
+	unique_ptr<Variant> variant(new Variant());
+	variant->VSByteCode = m_device.CompileD3DShader(m_shaderFile, "VS_Main", "vs_4_0", defines.data());
+	shared_ptr<ID3DBlob> psByteCode = m_device.CompileD3DShader(m_shaderFile, "PS_Main", "ps_4_0", defines.data());
+	variant->VertexShader = m_device.CreateVertexShader(variant->VSByteCode);
+	variant->PixelShader = m_device.CreatePixelShader(psByteCode);
+	m_variants[features] = move(variant);
+	++m_permutationsCount;
+}
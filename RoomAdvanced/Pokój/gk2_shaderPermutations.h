@@ -0,0 +1,54 @@
+#ifndef __GK2_SHADER_PERMUTATIONS_H_
+#define __GK2_SHADER_PERMUTATIONS_H_
+
+#include <d3d11.h>
+#include "gk2_deviceHelper.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace gk2
+{
+	//Variants of a single shader file selected by a bitmask of features. When compiling a variant, the macro
+	//named by the i-th feature is defined for every bit i set in the mask. Variants are compiled on first use
+	//(or up front with Precompile) and kept in a table indexed directly by the mask, so selecting a variant
+	//while drawing is a single array access.
+	class ShaderPermutations
+	{
+	public:
+		static const unsigned int MAX_FEATURES = 8;
+
+		struct Variant
+		{
+			std::shared_ptr<ID3D11VertexShader> VertexShader;
+			std::shared_ptr<ID3D11PixelShader> PixelShader;
+			std::shared_ptr<ID3DBlob> VSByteCode;
+		};
+
+		ShaderPermutations(const gk2::DeviceHelper& device, const std::wstring& shaderFile,
+						   const std::vector<std::string>& features);
+
+		const Variant& Get(unsigned int features);
+		void Precompile(const std::vector<unsigned int>& features);
+
+		const std::wstring& getShaderFile() const { return m_shaderFile; }
+		//Number of variants compiled so far
+		unsigned int getPermutationsCount() const { return m_permutationsCount; }
+		unsigned int getLookupsCount() const { return m_lookups; }
+		//Fraction of Get calls which found the variant already compiled
+		float getHitRate() const;
+
+	private:
+		gk2::DeviceHelper m_device;
+		std::wstring m_shaderFile;
+		std::vector<std::string> m_features;
+		std::vector<std::unique_ptr<Variant>> m_variants;
+		unsigned int m_permutationsCount;
+		unsigned int m_lookups;
+		unsigned int m_misses;
+
+		void Compile(unsigned int features);
+	};
+}
+
+#endif __GK2_SHADER_PERMUTATIONS_H_
@@ -0,0 +1,105 @@
+#include "gk2_threadPool.h"
+
+using namespace std;
+using namespace gk2;
+
+ThreadPool::ThreadPool(unsigned int workersCount)
+	: m_stopping(false), m_generation(0), m_busy(0), m_body(nullptr), m_count(0), m_next(0)
+{
+	if (workersCount == 0)
+	{
+		unsigned int hw = thread::hardware_concurrency();
+		workersCount = hw > 1 ? hw - 1 : 0;
+	}
+	for (unsigned int i = 0; i < workersCount; ++i)
+		m_workers.push_back(thread(&ThreadPool::WorkerLoop, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		unique_lock<mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_workAvailable.notify_all();
+	for (auto it = m_workers.begin(); it != m_workers.end(); ++it)
+		it->join();
+}
+
+void ThreadPool::ParallelFor(unsigned int count, const function<void(unsigned int)>& body)
+{
+	if (count == 0)
+		return;
+	if (m_workers.empty() || count == 1)
+	{
+		for (unsigned int i = 0; i < count; ++i)
+			body(i);
+		return;
+	}
+	{
+		unique_lock<mutex> lock(m_mutex);
+		m_body = &body;
+		m_count = count;
+		m_next = 0;
+		m_error = nullptr;
+		m_busy = static_cast<unsigned int>(m_workers.size());
+		++m_generation;
+	}
+	m_workAvailable.notify_all();
+	RunItems();
+	exception_ptr error;
+	{
+		unique_lock<mutex> lock(m_mutex);
+		while (m_busy > 0)
+			m_workDone.wait(lock);
+		m_body = nullptr;
+		error = m_error;
+		m_error = nullptr;
+	}
+	if (error)
+		rethrow_exception(error);
+}
+
+void ThreadPool::RunItems()
+{
+	while (true)
+	{
+		unsigned int i = m_next++;
+		if (i >= m_count)
+			return;
+		try
+		{
+			(*m_body)(i);
+		}
+		catch (...)
+		{
+			unique_lock<mutex> lock(m_mutex);
+			if (!m_error)
+				m_error = current_exception();
+			//Items which haven't been started are skipped
+			m_next = m_count;
+		}
+	}
+}
+
+void ThreadPool::WorkerLoop()
+{
+	unsigned int generation = 0;
+	while (true)
+	{
+		{
+			unique_lock<mutex> lock(m_mutex);
+			while (!m_stopping && m_generation == generation)
+				m_workAvailable.wait(lock);
+			if (m_stopping)
+				return;
+			generation = m_generation;
+		}
+		RunItems();
+		{
+			unique_lock<mutex> lock(m_mutex);
+			if (--m_busy == 0)
+				m_workDone.notify_all();
+		}
+	}
+}
@@ -0,0 +1,33 @@
+#include "gk2_transientTextures.h"
+
+using namespace std;
+using namespace gk2;
+
+void TransientTextures::Realize(DeviceHelper& device, const FrameGraph& graph)
+{
+	m_graph = &graph;
+	const vector<FrameGraph::TextureDesc>& physical = graph.getPhysicalTextures();
+	if (m_textures.size() < physical.size())
+		m_textures.resize(physical.size());
+	for (unsigned int p = 0; p < physical.size(); ++p)
+	{
+		Texture& t = m_textures[p];
+		if (t.Texture != nullptr && t.Desc == physical[p])
+			continue;
+		t.Desc = physical[p];
+		D3D11_TEXTURE2D_DESC desc = device.DefaultTexture2DDesc();
+		desc.Width = t.Desc.Width;
+		desc.Height = t.Desc.Height;
+		desc.MipLevels = 1;
+		desc.Format = static_cast<DXGI_FORMAT>(t.Desc.Format);
+		desc.BindFlags = t.Desc.BindFlags;
+		t.Texture = device.CreateTexture2D(desc);
+		t.RenderTarget.reset();
+		t.DepthStencil.reset();
+		if (t.Desc.BindFlags & D3D11_BIND_RENDER_TARGET)
+			t.RenderTarget = device.CreateRenderTargetView(t.Texture);
+		if (t.Desc.BindFlags & D3D11_BIND_DEPTH_STENCIL)
+			t.DepthStencil = device.CreateDepthStencilView(t.Texture);
+		++m_created;
+	}
+}
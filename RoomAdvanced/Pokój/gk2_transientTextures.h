@@ -0,0 +1,56 @@
+#ifndef __GK2_TRANSIENT_TEXTURES_H_
+#define __GK2_TRANSIENT_TEXTURES_H_
+
+#include <d3d11.h>
+#include <memory>
+#include <vector>
+#include "gk2_deviceHelper.h"
+#include "gk2_frameGraph.h"
+
+namespace gk2
+{
+	//Device textures behind the physical textures of a compiled frame graph. Transient resources sharing a
+	//physical texture get the same device texture. Textures are kept between frames and only created again
+	//when the graph asks for a different one, so rebuilding the graph every frame costs no allocations.
+	class TransientTextures
+	{
+	public:
+		TransientTextures() : m_graph(nullptr), m_created(0) { }
+
+		//Creates the missing textures, has to be called after the graph is compiled and before it's executed
+		void Realize(gk2::DeviceHelper& device, const gk2::FrameGraph& graph);
+
+		const std::shared_ptr<ID3D11Texture2D>& getTexture(unsigned int resource) const
+		{
+			return m_textures[m_graph->getPhysical(resource)].Texture;
+		}
+		//Valid for textures with D3D11_BIND_RENDER_TARGET
+		const std::shared_ptr<ID3D11RenderTargetView>& getRenderTarget(unsigned int resource) const
+		{
+			return m_textures[m_graph->getPhysical(resource)].RenderTarget;
+		}
+		//Valid for textures with D3D11_BIND_DEPTH_STENCIL
+		const std::shared_ptr<ID3D11DepthStencilView>& getDepthStencil(unsigned int resource) const
+		{
+			return m_textures[m_graph->getPhysical(resource)].DepthStencil;
+		}
+		unsigned int getCount() const { return static_cast<unsigned int>(m_textures.size()); }
+		//Textures created since the start, stays the same once the graph stops changing
+		unsigned int getCreatedCount() const { return m_created; }
+
+	private:
+		struct Texture
+		{
+			gk2::FrameGraph::TextureDesc Desc;
+			std::shared_ptr<ID3D11Texture2D> Texture;
+			std::shared_ptr<ID3D11RenderTargetView> RenderTarget;
+			std::shared_ptr<ID3D11DepthStencilView> DepthStencil;
+		};
+
+		const gk2::FrameGraph* m_graph;
+		std::vector<Texture> m_textures;
+		unsigned int m_created;
+	};
+}
+
+#endif __GK2_TRANSIENT_TEXTURES_H_
@@ -0,0 +1,334 @@
+#include "gk2_triangleBVH.h"
+#include <algorithm>
+
+using namespace std;
+using namespace gk2;
+
+namespace
+{
+	const float DET_EPSILON = 1e-12f;
+
+	inline const XMFLOAT3& PointAt(const XMFLOAT3* points, unsigned int i, unsigned int stride)
+	{
+		return *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const BYTE*>(points) + i * stride);
+	}
+
+	inline float HalfArea(const XMFLOAT3& min, const XMFLOAT3& max)
+	{
+		float dx = max.x - min.x, dy = max.y - min.y, dz = max.z - min.z;
+		return dx * dy + dy * dz + dz * dx;
+	}
+
+	inline void Grow(XMFLOAT3& min, XMFLOAT3& max, const XMFLOAT3& pMin, const XMFLOAT3& pMax)
+	{
+		min.x = std::min(min.x, pMin.x); min.y = std::min(min.y, pMin.y); min.z = std::min(min.z, pMin.z);
+		max.x = std::max(max.x, pMax.x); max.y = std::max(max.y, pMax.y); max.z = std::max(max.z, pMax.z);
+	}
+
+	inline float Component(const XMFLOAT3& v, unsigned int axis)
+	{
+		return (&v.x)[axis];
+	}
+
+	inline bool RayBox(const XMFLOAT3& min, const XMFLOAT3& max, FXMVECTOR origin, FXMVECTOR invDir,
+					   float maxDistance)
+	{
+		XMVECTOR t1 = (XMLoadFloat3(&min) - origin) * invDir;
+		XMVECTOR t2 = (XMLoadFloat3(&max) - origin) * invDir;
+		XMVECTOR tMin = XMVectorMin(t1, t2);
+		XMVECTOR tMax = XMVectorMax(t1, t2);
+		float tNear = std::max(std::max(XMVectorGetX(tMin), XMVectorGetY(tMin)), std::max(XMVectorGetZ(tMin), 0.0f));
+		float tFar = std::min(std::min(XMVectorGetX(tMax), XMVectorGetY(tMax)), std::min(XMVectorGetZ(tMax), maxDistance));
+		return tNear <= tFar;
+	}
+
+	const XMFLOAT3 EMPTY_MIN(FLT_MAX, FLT_MAX, FLT_MAX);
+	const XMFLOAT3 EMPTY_MAX(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+}
+
+TriangleBVH::TriangleBVH()
+{ }
+
+void TriangleBVH::Build(const XMFLOAT3* positions, unsigned int verticesCount, unsigned int stride,
+						const unsigned short* indices, unsigned int indicesCount)
+{
+	m_nodes.clear();
+	m_triangles.clear();
+	m_triangleIds.clear();
+	unsigned int count = indicesCount / 3;
+	if (!positions || !verticesCount || !count)
+		return;
+	vector<Triangle> triangles(count);
+	vector<XMFLOAT3> centroids(count), triMin(count), triMax(count);
+	vector<unsigned int> order(count);
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		const XMFLOAT3& p0 = PointAt(positions, indices[3 * i], stride);
+		const XMFLOAT3& p1 = PointAt(positions, indices[3 * i + 1], stride);
+		const XMFLOAT3& p2 = PointAt(positions, indices[3 * i + 2], stride);
+		triMin[i] = triMax[i] = p0;
+		Grow(triMin[i], triMax[i], p1, p1);
+		Grow(triMin[i], triMax[i], p2, p2);
+		centroids[i] = XMFLOAT3((triMin[i].x + triMax[i].x) * 0.5f, (triMin[i].y + triMax[i].y) * 0.5f,
+								(triMin[i].z + triMax[i].z) * 0.5f);
+		triangles[i].V0 = p0;
+		triangles[i].E1 = XMFLOAT3(p1.x - p0.x, p1.y - p0.y, p1.z - p0.z);
+		triangles[i].E2 = XMFLOAT3(p2.x - p0.x, p2.y - p0.y, p2.z - p0.z);
+		order[i] = i;
+	}
+	m_nodes.reserve(2 * count / MAX_LEAF_SIZE + 1);
+	BuildNode(0, count, order, centroids, triMin, triMax);
+	//Triangles are reordered so that every leaf references a contiguous range
+	m_triangles.resize(count);
+	for (unsigned int i = 0; i < count; ++i)
+		m_triangles[i] = triangles[order[i]];
+	m_triangleIds.swap(order);
+}
+
+void TriangleBVH::BuildNode(unsigned int first, unsigned int count, vector<unsigned int>& order,
+							const vector<XMFLOAT3>& centroids, const vector<XMFLOAT3>& triMin,
+							const vector<XMFLOAT3>& triMax)
+{
+	unsigned int nodeIdx = static_cast<unsigned int>(m_nodes.size());
+	m_nodes.push_back(Node());
+	Node node;
+	node.Min = EMPTY_MIN;
+	node.Max = EMPTY_MAX;
+	XMFLOAT3 cMin = EMPTY_MIN, cMax = EMPTY_MAX;
+	for (unsigned int i = first; i < first + count; ++i)
+	{
+		Grow(node.Min, node.Max, triMin[order[i]], triMax[order[i]]);
+		Grow(cMin, cMax, centroids[order[i]], centroids[order[i]]);
+	}
+	if (count <= MAX_LEAF_SIZE)
+	{
+		node.Offset = first;
+		node.Count = count;
+		m_nodes[nodeIdx] = node;
+		return;
+	}
+	unsigned int axis = 0;
+	float extent = cMax.x - cMin.x;
+	if (cMax.y - cMin.y > extent) { axis = 1; extent = cMax.y - cMin.y; }
+	if (cMax.z - cMin.z > extent) { axis = 2; extent = cMax.z - cMin.z; }
+
+	unsigned int* begin = &order[first];
+	unsigned int* end = begin + count;
+	unsigned int* mid = begin;
+	if (extent > 0.0f)
+	{
+		float axisMin = Component(cMin, axis);
+		float scale = SAH_BINS / extent;
+		XMFLOAT3 binMin[SAH_BINS], binMax[SAH_BINS];
+		unsigned int binCount[SAH_BINS] = { 0 };
+		for (unsigned int b = 0; b < SAH_BINS; ++b)
+		{
+			binMin[b] = EMPTY_MIN;
+			binMax[b] = EMPTY_MAX;
+		}
+		for (unsigned int* i = begin; i != end; ++i)
+		{
+			unsigned int b = min(static_cast<unsigned int>((Component(centroids[*i], axis) - axisMin) * scale),
+								 SAH_BINS - 1);
+			binCount[b]++;
+			Grow(binMin[b], binMax[b], triMin[*i], triMax[*i]);
+		}
+		float rightCost[SAH_BINS];
+		XMFLOAT3 accMin = EMPTY_MIN, accMax = EMPTY_MAX;
+		unsigned int accCount = 0;
+		for (unsigned int b = SAH_BINS - 1; b > 0; --b)
+		{
+			Grow(accMin, accMax, binMin[b], binMax[b]);
+			accCount += binCount[b];
+			rightCost[b] = accCount ? HalfArea(accMin, accMax) * accCount : 0.0f;
+		}
+		accMin = EMPTY_MIN;
+		accMax = EMPTY_MAX;
+		accCount = 0;
+		float bestCost = FLT_MAX;
+		unsigned int bestBin = 0;
+		for (unsigned int b = 0; b < SAH_BINS - 1; ++b)
+		{
+			Grow(accMin, accMax, binMin[b], binMax[b]);
+			accCount += binCount[b];
+			if (!accCount || accCount == count)
+				continue;
+			float cost = HalfArea(accMin, accMax) * accCount + rightCost[b + 1];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestBin = b;
+			}
+		}
+		if (bestCost < FLT_MAX)
+			mid = partition(begin, end, [&](unsigned int i) {
+				return min(static_cast<unsigned int>((Component(centroids[i], axis) - axisMin) * scale),
+						   SAH_BINS - 1) <= bestBin;
+			});
+	}
+	if (mid == begin || mid == end)
+	{
+		mid = begin + count / 2;
+		nth_element(begin, mid, end, [&](unsigned int a, unsigned int b) {
+			return Component(centroids[a], axis) < Component(centroids[b], axis);
+		});
+	}
+	unsigned int leftCount = static_cast<unsigned int>(mid - begin);
+	BuildNode(first, leftCount, order, centroids, triMin, triMax);
+	BuildNode(first + leftCount, count - leftCount, order, centroids, triMin, triMax);
+	node.Offset = static_cast<unsigned int>(m_nodes.size());
+	node.Count = 0;
+	m_nodes[nodeIdx] = node;
+}
+
+bool TriangleBVH::Trace(FXMVECTOR origin, FXMVECTOR direction, RayHit& hit, bool anyHit) const
+{
+	XMVECTOR invDir = XMVectorReciprocal(direction);
+	bool found = false;
+	unsigned int i = 0, nodesCount = getNodesCount();
+	while (i < nodesCount)
+	{
+		const Node& node = m_nodes[i];
+		if (!RayBox(node.Min, node.Max, origin, invDir, hit.Distance))
+		{
+			i = node.Count ? i + 1 : node.Offset;
+			continue;
+		}
+		++i;
+		for (unsigned int j = node.Offset; j < node.Offset + node.Count; ++j)
+		{
+			const Triangle& tri = m_triangles[j];
+			XMVECTOR e1 = XMLoadFloat3(&tri.E1);
+			XMVECTOR e2 = XMLoadFloat3(&tri.E2);
+			XMVECTOR p = XMVector3Cross(direction, e2);
+			float det = XMVectorGetX(XMVector3Dot(e1, p));
+			if (fabs(det) < DET_EPSILON)
+				continue;
+			float invDet = 1.0f / det;
+			XMVECTOR s = origin - XMLoadFloat3(&tri.V0);
+			float u = XMVectorGetX(XMVector3Dot(s, p)) * invDet;
+			if (u < 0.0f || u > 1.0f)
+				continue;
+			XMVECTOR q = XMVector3Cross(s, e1);
+			float v = XMVectorGetX(XMVector3Dot(direction, q)) * invDet;
+			if (v < 0.0f || u + v > 1.0f)
+				continue;
+			float t = XMVectorGetX(XMVector3Dot(e2, q)) * invDet;
+			if (t <= 0.0f || t >= hit.Distance)
+				continue;
+			hit.Distance = t;
+			hit.Triangle = m_triangleIds[j];
+			hit.U = u;
+			hit.V = v;
+			found = true;
+			if (anyHit)
+				return true;
+		}
+	}
+	return found;
+}
+
+bool TriangleBVH::Intersect(FXMVECTOR origin, FXMVECTOR direction, RayHit& hit) const
+{
+	return Trace(origin, direction, hit, false);
+}
+
+bool TriangleBVH::Occluded(FXMVECTOR origin, FXMVECTOR direction, float maxDistance) const
+{
+	RayHit hit;
+	hit.Distance = maxDistance;
+	return Trace(origin, direction, hit, true);
+}
+
+unsigned int TriangleBVH::Intersect(const XMFLOAT3* origins, const XMFLOAT3* directions, RayHit* hits) const
+{
+	//Structure of arrays: lane k of every vector belongs to k-th ray of the packet
+	XMVECTOR ox = XMVectorSet(origins[0].x, origins[1].x, origins[2].x, origins[3].x);
+	XMVECTOR oy = XMVectorSet(origins[0].y, origins[1].y, origins[2].y, origins[3].y);
+	XMVECTOR oz = XMVectorSet(origins[0].z, origins[1].z, origins[2].z, origins[3].z);
+	XMVECTOR dx = XMVectorSet(directions[0].x, directions[1].x, directions[2].x, directions[3].x);
+	XMVECTOR dy = XMVectorSet(directions[0].y, directions[1].y, directions[2].y, directions[3].y);
+	XMVECTOR dz = XMVectorSet(directions[0].z, directions[1].z, directions[2].z, directions[3].z);
+	XMVECTOR idx = XMVectorReciprocal(dx), idy = XMVectorReciprocal(dy), idz = XMVectorReciprocal(dz);
+	XMVECTOR tBest = XMVectorSet(hits[0].Distance, hits[1].Distance, hits[2].Distance, hits[3].Distance);
+	XMVECTOR uBest = XMVectorSet(hits[0].U, hits[1].U, hits[2].U, hits[3].U);
+	XMVECTOR vBest = XMVectorSet(hits[0].V, hits[1].V, hits[2].V, hits[3].V);
+	XMVECTOR zero = XMVectorZero(), one = XMVectorSplatOne(), eps = XMVectorReplicate(DET_EPSILON);
+	unsigned int hitMask = 0;
+	UINT lanes[4];
+
+	unsigned int i = 0, nodesCount = getNodesCount();
+	while (i < nodesCount)
+	{
+		const Node& node = m_nodes[i];
+		XMVECTOR t1 = (XMVectorReplicate(node.Min.x) - ox) * idx, t2 = (XMVectorReplicate(node.Max.x) - ox) * idx;
+		XMVECTOR tNear = XMVectorMax(XMVectorMin(t1, t2), zero), tFar = XMVectorMin(XMVectorMax(t1, t2), tBest);
+		t1 = (XMVectorReplicate(node.Min.y) - oy) * idy;
+		t2 = (XMVectorReplicate(node.Max.y) - oy) * idy;
+		tNear = XMVectorMax(tNear, XMVectorMin(t1, t2));
+		tFar = XMVectorMin(tFar, XMVectorMax(t1, t2));
+		t1 = (XMVectorReplicate(node.Min.z) - oz) * idz;
+		t2 = (XMVectorReplicate(node.Max.z) - oz) * idz;
+		tNear = XMVectorMax(tNear, XMVectorMin(t1, t2));
+		tFar = XMVectorMin(tFar, XMVectorMax(t1, t2));
+		XMStoreInt4(lanes, XMVectorLessOrEqual(tNear, tFar));
+		if (!(lanes[0] | lanes[1] | lanes[2] | lanes[3]))
+		{
+			i = node.Count ? i + 1 : node.Offset;
+			continue;
+		}
+		++i;
+		for (unsigned int j = node.Offset; j < node.Offset + node.Count; ++j)
+		{
+			const Triangle& tri = m_triangles[j];
+			XMVECTOR e1x = XMVectorReplicate(tri.E1.x), e1y = XMVectorReplicate(tri.E1.y), e1z = XMVectorReplicate(tri.E1.z);
+			XMVECTOR e2x = XMVectorReplicate(tri.E2.x), e2y = XMVectorReplicate(tri.E2.y), e2z = XMVectorReplicate(tri.E2.z);
+			XMVECTOR px = dy * e2z - dz * e2y;
+			XMVECTOR py = dz * e2x - dx * e2z;
+			XMVECTOR pz = dx * e2y - dy * e2x;
+			XMVECTOR det = e1x * px + e1y * py + e1z * pz;
+			XMVECTOR invDet = XMVectorReciprocal(det);
+			XMVECTOR sx = ox - XMVectorReplicate(tri.V0.x);
+			XMVECTOR sy = oy - XMVectorReplicate(tri.V0.y);
+			XMVECTOR sz = oz - XMVectorReplicate(tri.V0.z);
+			XMVECTOR u = (sx * px + sy * py + sz * pz) * invDet;
+			XMVECTOR qx = sy * e1z - sz * e1y;
+			XMVECTOR qy = sz * e1x - sx * e1z;
+			XMVECTOR qz = sx * e1y - sy * e1x;
+			XMVECTOR v = (dx * qx + dy * qy + dz * qz) * invDet;
+			XMVECTOR t = (e2x * qx + e2y * qy + e2z * qz) * invDet;
+			XMVECTOR mask = XMVectorGreater(XMVectorAbs(det), eps);
+			mask = XMVectorAndInt(mask, XMVectorGreaterOrEqual(u, zero));
+			mask = XMVectorAndInt(mask, XMVectorGreaterOrEqual(v, zero));
+			mask = XMVectorAndInt(mask, XMVectorLessOrEqual(u + v, one));
+			mask = XMVectorAndInt(mask, XMVectorGreater(t, zero));
+			mask = XMVectorAndInt(mask, XMVectorLess(t, tBest));
+			XMStoreInt4(lanes, mask);
+			if (!(lanes[0] | lanes[1] | lanes[2] | lanes[3]))
+				continue;
+			tBest = XMVectorSelect(tBest, t, mask);
+			uBest = XMVectorSelect(uBest, u, mask);
+			vBest = XMVectorSelect(vBest, v, mask);
+			for (unsigned int k = 0; k < PACKET_SIZE; ++k)
+				if (lanes[k])
+				{
+					hits[k].Triangle = m_triangleIds[j];
+					hitMask |= 1u << k;
+				}
+		}
+	}
+	XMFLOAT4 t, u, v;
+	XMStoreFloat4(&t, tBest);
+	XMStoreFloat4(&u, uBest);
+	XMStoreFloat4(&v, vBest);
+	const float* pt = &t.x;
+	const float* pu = &u.x;
+	const float* pv = &v.x;
+	for (unsigned int k = 0; k < PACKET_SIZE; ++k)
+	{
+		hits[k].Distance = pt[k];
+		hits[k].U = pu[k];
+		hits[k].V = pv[k];
+	}
+	return hitMask;
+}
@@ -0,0 +1,75 @@
+#ifndef __GK2_TRIANGLE_BVH_H_
+#define __GK2_TRIANGLE_BVH_H_
+
+#include <d3d11.h>
+#include <xnamath.h>
+#include <vector>
+#include <cfloat>
+
+namespace gk2
+{
+	//Bounding volume hierarchy over triangles of an indexed triangle list. Nodes are stored in depth first
+	//order, so the left child of an internal node directly follows it and traversal needs no stack: on
+	//a miss (or after a leaf) it jumps to the node's skip index.
+	class TriangleBVH
+	{
+	public:
+		static const unsigned int NO_TRIANGLE = 0xffffffff;
+		static const unsigned int MAX_LEAF_SIZE = 4;
+		static const unsigned int SAH_BINS = 16;
+		static const unsigned int PACKET_SIZE = 4;
+
+		struct RayHit
+		{
+			float Distance;
+			unsigned int Triangle;	//index of the triangle in the original index buffer (first index / 3)
+			float U, V;				//barycentric coordinates of the hit point
+
+			RayHit() : Distance(FLT_MAX), Triangle(NO_TRIANGLE), U(0.0f), V(0.0f) { }
+		};
+
+		TriangleBVH();
+
+		//Positions are laid out every stride bytes, as in BoundingBox::FromPoints
+		void Build(const XMFLOAT3* positions, unsigned int verticesCount, unsigned int stride,
+				   const unsigned short* indices, unsigned int indicesCount);
+
+		//Nearest hit with distance (in units of direction's length) below hit.Distance
+		bool Intersect(FXMVECTOR origin, FXMVECTOR direction, RayHit& hit) const;
+		//Any hit closer than maxDistance, used for shadow and occlusion rays
+		bool Occluded(FXMVECTOR origin, FXMVECTOR direction, float maxDistance) const;
+		//Traces PACKET_SIZE rays at once, one ray per SIMD lane. Returns a bitmask of rays that hit.
+		unsigned int Intersect(const XMFLOAT3* origins, const XMFLOAT3* directions, RayHit* hits) const;
+
+		unsigned int getTrianglesCount() const { return static_cast<unsigned int>(m_triangles.size()); }
+		unsigned int getNodesCount() const { return static_cast<unsigned int>(m_nodes.size()); }
+
+	private:
+		struct Node
+		{
+			XMFLOAT3 Min;
+			unsigned int Offset;	//first triangle for leaves, skip index for internal nodes
+			XMFLOAT3 Max;
+			unsigned int Count;		//number of triangles, 0 for internal nodes
+		};
+
+		//Triangle prepared for Moller-Trumbore test
+		struct Triangle
+		{
+			XMFLOAT3 V0;
+			XMFLOAT3 E1;
+			XMFLOAT3 E2;
+		};
+
+		std::vector<Node> m_nodes;
+		std::vector<Triangle> m_triangles;
+		std::vector<unsigned int> m_triangleIds;
+
+		void BuildNode(unsigned int first, unsigned int count, std::vector<unsigned int>& order,
+					   const std::vector<XMFLOAT3>& centroids, const std::vector<XMFLOAT3>& triMin,
+					   const std::vector<XMFLOAT3>& triMax);
+		bool Trace(FXMVECTOR origin, FXMVECTOR direction, RayHit& hit, bool anyHit) const;
+	};
+}
+
+#endif __GK2_TRIANGLE_BVH_H_
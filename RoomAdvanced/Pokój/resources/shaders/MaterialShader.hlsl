@@ -0,0 +1,144 @@
+//Shader of all the room materials. Variant is selected by defining feature macros:
+//TEXTURE - color sampled from colorMap
+//SECOND_TEXTURE - colorMap2 blended over the first texture using its alpha (requires TEXTURE)
+//ENV_MAP - color sampled from envMap in the reflected view direction (ignored with TEXTURE)
+//SURFACE_COLOR - surface color added to the texture color or modulating the environment map color
+//LIGHTING - Phong lighting with two point lights
+Texture2D colorMap : register(t0);
+Texture2D colorMap2 : register(t1);
+TextureCube envMap : register(t2);
+SamplerState colorSampler : register(s0);
+
+cbuffer cbWorld : register(b0) //Vertex Shader constant buffer slot 0
+{
+	matrix worldMatrix;
+};
+
+cbuffer cbView : register(b1) //Vertex Shader constant buffer slot 1
+{
+	matrix viewMatrix;
+};
+
+cbuffer cbProj : register(b2) //Vertex Shader constant buffer slot 2
+{
+	matrix projMatrix;
+};
+
+cbuffer cbTextureTransform : register(b3)
+{
+	matrix texMatrix;
+};
+
+cbuffer cbTexture2Transform : register(b4)
+{
+	matrix texMatrix2;
+};
+
+cbuffer cbLights : register(b5)
+{
+	float4 lightPos[2];
+};
+
+cbuffer cbCameraPos : register(b6)
+{
+	float4 cameraPos;
+}
+
+cbuffer cbSurfaceColor : register(b0)
+{
+	float4 surfaceColor;
+}
+
+struct VSInput
+{
+	float3 pos : POSITION;
+	float3 norm : NORMAL0;
+};
+
+struct PSInput
+{
+	float4 pos : SV_POSITION;
+#if defined(TEXTURE)
+	float2 tex : TEXCOORD0;
+#endif
+#if defined(SECOND_TEXTURE)
+	float2 tex2 : TEXCOORD1;
+#endif
+#if defined(ENV_MAP)
+	float3 envTex : TEXCOORD2;
+#endif
+#if defined(LIGHTING)
+	float3 norm : NORMAL;
+	float3 viewVec : TEXCOORD3;
+	float3 lightVec0 : TEXCOORD4;
+	float3 lightVec1 : TEXCOORD5;
+#endif
+};
+
+PSInput VS_Main(VSInput i)
+{
+	PSInput o = (PSInput)0;
+	float4 pos = float4(i.pos, 1.0f);
+#if defined(TEXTURE)
+	o.tex = mul(texMatrix, pos).xy;
+#endif
+#if defined(SECOND_TEXTURE)
+	o.tex2 = mul(texMatrix2, pos).xy;
+#endif
+	float4 worldPos = mul(worldMatrix, pos);
+#if defined(ENV_MAP)
+	o.envTex = reflect(normalize(worldPos - cameraPos), normalize(mul(worldMatrix, i.norm)));
+#endif
+	float4 viewPos = mul(viewMatrix, worldPos);
+	o.pos = mul(projMatrix, viewPos);
+#if defined(LIGHTING)
+	o.norm = normalize(mul(viewMatrix, mul(worldMatrix, float4(i.norm, 0.0f))).xyz);
+	o.viewVec = normalize(-viewPos.xyz);
+	o.lightVec0 = normalize((mul(viewMatrix, lightPos[0]) - viewPos).xyz);
+	o.lightVec1 = normalize((mul(viewMatrix, lightPos[1]) - viewPos).xyz);
+#endif
+	return o;
+}
+
+static const float3 ambientColor = float3(0.2f, 0.2f, 0.2f);
+static const float3 lightColor = float3(1.0f, 1.0f, 1.0f);
+static const float3 kd = 0.5, ks = 0.2f, m = 100.0f;
+
+float3 Phong(float3 color, float3 normal, float3 viewVec, float3 lightVec)
+{
+	float3 halfVec = normalize(viewVec + lightVec);
+	return lightColor * color * kd * saturate(dot(normal, lightVec)) +
+		   lightColor * ks * pow(saturate(dot(normal, halfVec)), m);
+}
+
+float4 PS_Main(PSInput i) : SV_TARGET
+{
+#if defined(TEXTURE)
+	float4 color = colorMap.Sample(colorSampler, i.tex);
+#if defined(SECOND_TEXTURE)
+	float4 color2 = colorMap2.Sample(colorSampler, i.tex2);
+	color = color * (1 - color2.a) + color2 * color2.a;
+#endif
+#if defined(SURFACE_COLOR)
+	color = saturate(color + surfaceColor);
+#endif
+#elif defined(ENV_MAP)
+	float4 color = envMap.Sample(colorSampler, normalize(i.envTex));
+#if defined(SURFACE_COLOR)
+	color = surfaceColor * color;
+#endif
+#elif defined(SURFACE_COLOR)
+	float4 color = surfaceColor;
+#else
+	float4 color = float4(1.0f, 1.0f, 1.0f, 1.0f);
+#endif
+#if defined(LIGHTING)
+	float3 viewVec = normalize(i.viewVec);
+	float3 normal = normalize(i.norm);
+	float3 litColor = color.rgb * ambientColor;
+	litColor += Phong(color.rgb, normal, viewVec, normalize(i.lightVec0));
+	litColor += Phong(color.rgb, normal, viewVec, normalize(i.lightVec1));
+	color = float4(saturate(litColor), color.a);
+#endif
+	return color;
+}
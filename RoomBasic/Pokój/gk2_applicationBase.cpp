@@ -1,5 +1,6 @@
 #include "gk2_applicationBase.h"
 #include "gk2_window.h"
+#include <sstream>
 
 using namespace std;
 using namespace gk2;
@@ -64,7 +65,10 @@ void ApplicationBase::CreateDeviceAndSwapChain(SIZE windowSize)
 			featureLevelsCout, D3D11_SDK_VERSION, &desc, &swapChain, &device, &m_featureLevel, &context);
 		m_device.setDeviceObject(shared_ptr<ID3D11Device>(device, Utils::COMRelease));
 		m_swapChain.reset(swapChain, Utils::COMRelease);
-		m_context.reset(context, Utils::COMRelease);
+		shared_ptr<ID3D11DeviceContext> deviceContext(context, Utils::COMRelease);
+		m_stateFilter.reset(context ? new StateFilteringContext(shared_ptr<RenderContext>(
+			new DeviceContext(deviceContext))) : nullptr);
+		m_context = m_stateFilter;
 		if (SUCCEEDED(result))
 		{
 			m_driverType = driverTypes[driver];
@@ -120,6 +124,9 @@ bool ApplicationBase::Initialize()
 {
 	SIZE windowSize = getMainWindow()->getClientSize();
 	CreateDeviceAndSwapChain(windowSize);
+	m_device.setAssetCache(shared_ptr<AssetCache>(new AssetCache()));
+	m_device.setShaderCache(shared_ptr<ShaderCache>(new ShaderCache(m_device.getAssetCache(),
+		&DeviceHelper::CompileShader, DeviceHelper::ShaderCompileFlags())));
 	CreateBackBuffers(windowSize);
 	SetViewPort(windowSize);
 	InitializeDirectInput();
@@ -153,6 +160,7 @@ int ApplicationBase::MainLoop()
 				dwTimeStart = dwTimeCur;
 			t = ( dwTimeCur - dwTimeStart ) / 1000.0f;
 			dwTimeStart = dwTimeCur;
+			m_stateFilter->BeginFrame();
 			Update(t);
 			Render();
 		}
@@ -161,8 +169,21 @@ int ApplicationBase::MainLoop()
 	return static_cast<int>(msg.wParam);
 }
 
+void ApplicationBase::ReportStateStatistics()
+{
+	if (!m_stateFilter)
+		return;
+	const StateFilteringContext::Statistics& total = m_stateFilter->getTotalStatistics();
+	const StateFilteringContext::Statistics& frame = m_stateFilter->getLastFrameStatistics();
+	wstringstream s;
+	s << L"State calls issued: " << total.Issued << L", filtered: " << total.Filtered << L" (last frame: "
+	  << frame.Issued << L" issued, " << frame.Filtered << L" filtered)" << endl;
+	OutputDebugStringW(s.str().c_str());
+}
+
 void ApplicationBase::Shutdown()
 {
+	ReportStateStatistics();
 	UnloadContent();
 	m_depthStencilTexture.reset();
 	m_depthStencilView.reset();
@@ -170,6 +191,7 @@ void ApplicationBase::Shutdown()
 	m_backBufferTexture.reset();
 	m_swapChain.reset();
 	m_context.reset();
+	m_stateFilter.reset();
 	m_keyboard.reset();
 	m_mouse.reset();
 	m_input.m_inputObject.reset();
@@ -183,3 +205,30 @@ int ApplicationBase::Run(Window* w, int cmdShow)
 	m_mainWindow->Show(cmdShow);
 	return MainLoop();
 }
+
+int ApplicationBase::PrecompileShaders(const wstring& manifestFile)
+{
+	//The application has no console, the messages go to the debugger
+	wostringstream log;
+	int result;
+	try
+	{
+		ShaderCache cache(shared_ptr<AssetCache>(new AssetCache()), &DeviceHelper::CompileShader,
+						  DeviceHelper::ShaderCompileFlags());
+		vector<ShaderDesc> failed = cache.Precompile(cache.ReadManifest(manifestFile));
+		for (auto it = failed.begin(); it != failed.end(); ++it)
+			log << it->File << L": " << wstring(it->Entry.begin(), it->Entry.end()) << L" ("
+				<< wstring(it->Model.begin(), it->Model.end()) << L") failed to compile" << endl;
+		log << cache.getMisses() - failed.size() << L" shaders compiled, " << cache.getHits() << L" up to date"
+			<< endl;
+		result = static_cast<int>(failed.size());
+	}
+	catch (exception& e)
+	{
+		string s(e.what());
+		log << manifestFile << L": " << wstring(s.begin(), s.end()) << endl;
+		result = -1;
+	}
+	OutputDebugStringW(log.str().c_str());
+	return result;
+}
@@ -0,0 +1,56 @@
+#include "gk2_assetCache.h"
+#include <sstream>
+#include <iomanip>
+
+using namespace std;
+using namespace gk2;
+
+AssetCache::AssetCache(const wstring& directory, const shared_ptr<FileSystem>& fileSystem)
+	: m_directory(directory), m_fileSystem(fileSystem)
+{
+	if (!m_directory.empty() && *m_directory.rbegin() != L'\\' && *m_directory.rbegin() != L'/')
+		m_directory += L'/';
+	m_fileSystem->MakeDirectory(m_directory);
+}
+
+wstring AssetCache::DefaultDirectory()
+{
+	return NativeFileSystem().TempDirectory() + L"gk2AssetCache/";
+}
+
+unsigned long long AssetCache::Hash(const void* data, size_t size, unsigned long long seed)
+{
+	const BYTE* bytes = reinterpret_cast<const BYTE*>(data);
+	unsigned long long hash = seed;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+bool AssetCache::ReadFile(const wstring& fileName, vector<BYTE>& data)
+{
+	return NativeFileSystem().ReadFile(fileName, data);
+}
+
+wstring AssetCache::ArtifactPath(const string& cooker, unsigned int cookerVersion, unsigned long long sourceHash) const
+{
+	wostringstream name;
+	name << m_directory << wstring(cooker.begin(), cooker.end()) << L'_' << cookerVersion << L'_'
+		 << hex << setw(16) << setfill(L'0') << sourceHash << L".bin";
+	return name.str();
+}
+
+bool AssetCache::Load(const string& cooker, unsigned int cookerVersion, unsigned long long sourceHash,
+					  vector<BYTE>& artifact) const
+{
+	return m_fileSystem->ReadFile(ArtifactPath(cooker, cookerVersion, sourceHash), artifact);
+}
+
+bool AssetCache::Store(const string& cooker, unsigned int cookerVersion, unsigned long long sourceHash,
+					   const vector<BYTE>& artifact) const
+{
+	return m_fileSystem->WriteFile(ArtifactPath(cooker, cookerVersion, sourceHash), artifact);
+}
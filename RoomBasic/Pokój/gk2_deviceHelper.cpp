@@ -2,9 +2,61 @@
 #include "gk2_utils.h"
 #include "gk2_exceptions.h"
 #include <cassert>
+#include <cstring>
+#include <list>
+#include <map>
 using namespace std;
 using namespace gk2;
 
+namespace
+{
+	wstring Directory(const wstring& file)
+	{
+		size_t separator = file.find_last_of(L"/\\");
+		return separator == wstring::npos ? wstring() : file.substr(0, separator + 1);
+	}
+
+	//Opens included files relative to the including file and records their paths
+	class ShaderIncludeHandler : public ID3DInclude
+	{
+	public:
+		ShaderIncludeHandler(const wstring& file) : m_directory(Directory(file)) { }
+
+		STDMETHOD(Open)(D3D_INCLUDE_TYPE includeType, LPCSTR fileName, LPCVOID parentData, LPCVOID* data, UINT* bytes)
+		{
+			UNREFERENCED_PARAMETER(includeType);
+			auto parent = m_paths.find(parentData);
+			wstring path = (parent != m_paths.end() ? Directory(parent->second) : m_directory) +
+						   wstring(fileName, fileName + strlen(fileName));
+			m_contents.push_back(vector<BYTE>());
+			vector<BYTE>& contents = m_contents.back();
+			if (!AssetCache::ReadFile(path, contents))
+			{
+				m_contents.pop_back();
+				return E_FAIL;
+			}
+			//Terminating zero keeps buffers of empty files distinct from the null pointer of the main file
+			contents.push_back(0);
+			m_paths[contents.data()] = path;
+			m_includes.push_back(path);
+			*data = contents.data();
+			*bytes = static_cast<UINT>(contents.size() - 1);
+			return S_OK;
+		}
+
+		//Buffers are released together with the handler
+		STDMETHOD(Close)(LPCVOID data) { UNREFERENCED_PARAMETER(data); return S_OK; }
+
+		const vector<wstring>& getIncludes() const { return m_includes; }
+
+	private:
+		wstring m_directory;
+		list<vector<BYTE>> m_contents;
+		map<LPCVOID, wstring> m_paths;
+		vector<wstring> m_includes;
+	};
+}
+
 
 DeviceHelper::DeviceHelper(const shared_ptr<ID3D11Device>& deviceObject)
 	: m_deviceObject(deviceObject)
@@ -13,7 +65,8 @@ DeviceHelper::DeviceHelper(const shared_ptr<ID3D11Device>& deviceObject)
 }
 
 DeviceHelper::DeviceHelper(const DeviceHelper& right)
-	: m_deviceObject(right.m_deviceObject)
+	: m_deviceObject(right.m_deviceObject), m_assetCache(right.m_assetCache),
+	  m_shaderCache(right.m_shaderCache)
 {
 
 }
@@ -21,19 +74,72 @@ DeviceHelper::DeviceHelper(const DeviceHelper& right)
 DeviceHelper& DeviceHelper::operator = (const DeviceHelper& right)
 {
 	m_deviceObject = right.m_deviceObject;
+	m_assetCache = right.m_assetCache;
+	m_shaderCache = right.m_shaderCache;
 	return *this;
 }
 
 shared_ptr<ID3DBlob> DeviceHelper::CompileD3DShader(const wstring& filePath, const string& entry, const string& shaderModel)
 {
 	assert(m_deviceObject);
+	if (m_shaderCache)
+	{
+		ShaderDesc desc;
+		desc.File = filePath;
+		desc.Entry = entry;
+		desc.Model = shaderModel;
+		vector<BYTE> byteCode = m_shaderCache->Get(desc);
+		ID3DBlob* b;
+		HRESULT result = D3DCreateBlob(byteCode.size(), &b);
+		shared_ptr<ID3DBlob> buffer(b, Utils::COMRelease);
+		if (FAILED(result))
+			THROW_DX11(result);
+		memcpy(buffer->GetBufferPointer(), byteCode.data(), byteCode.size());
+		return buffer;
+	}
+	DWORD shaderFlags = ShaderCompileFlags();
+	ID3DBlob* eb = nullptr, *b = nullptr;
+	HRESULT result = D3DX11CompileFromFileW(filePath.c_str(), 0, 0, entry.c_str(), shaderModel.c_str(), shaderFlags,
+		0, 0, &b, &eb, 0);
+	shared_ptr<ID3DBlob> errorBuffer(eb, Utils::COMRelease);
+	shared_ptr<ID3DBlob> buffer(b, Utils::COMRelease);
+	if (FAILED(result))
+	{
+		if (errorBuffer)
+		{
+			char* msg = reinterpret_cast<char*>(errorBuffer->GetBufferPointer());
+			OutputDebugStringA(msg);
+		}
+		THROW_DX11(result);
+	}
+	return buffer;
+}
+
+unsigned int DeviceHelper::ShaderCompileFlags()
+{
 	DWORD shaderFlags = D3DCOMPILE_ENABLE_STRICTNESS;
 #if defined( DEBUG ) || defined( _DEBUG )
 	shaderFlags |= D3DCOMPILE_DEBUG;
 #endif
+	return shaderFlags;
+}
+
+void DeviceHelper::CompileShader(const ShaderDesc& desc, const vector<BYTE>& source, vector<BYTE>& byteCode,
+								 vector<wstring>& includes)
+{
+	vector<D3D_SHADER_MACRO> defines;
+	for (auto it = desc.Defines.begin(); it != desc.Defines.end(); ++it)
+	{
+		D3D_SHADER_MACRO define = { it->first.c_str(), it->second.c_str() };
+		defines.push_back(define);
+	}
+	D3D_SHADER_MACRO end = { nullptr, nullptr };
+	defines.push_back(end);
+	ShaderIncludeHandler includeHandler(desc.File);
+	string sourceName(desc.File.begin(), desc.File.end());
 	ID3DBlob* eb = nullptr, *b = nullptr;
-	HRESULT result = D3DX11CompileFromFileW(filePath.c_str(), 0, 0, entry.c_str(), shaderModel.c_str(), shaderFlags,
-		0, 0, &b, &eb, 0);
+	HRESULT result = D3DCompile(source.data(), source.size(), sourceName.c_str(), defines.data(), &includeHandler,
+								desc.Entry.c_str(), desc.Model.c_str(), ShaderCompileFlags(), 0, &b, &eb);
 	shared_ptr<ID3DBlob> errorBuffer(eb, Utils::COMRelease);
 	shared_ptr<ID3DBlob> buffer(b, Utils::COMRelease);
 	if (FAILED(result))
@@ -45,7 +151,9 @@ shared_ptr<ID3DBlob> DeviceHelper::CompileD3DShader(const wstring& filePath, con
 		}
 		THROW_DX11(result);
 	}
-	return buffer;
+	const BYTE* data = reinterpret_cast<const BYTE*>(buffer->GetBufferPointer());
+	byteCode.assign(data, data + buffer->GetBufferSize());
+	includes = includeHandler.getIncludes();
 }
 
 shared_ptr<ID3D11VertexShader> DeviceHelper::CreateVertexShader(shared_ptr<ID3DBlob> byteCode)
@@ -173,6 +281,9 @@ shared_ptr<ID3D11ShaderResourceView> DeviceHelper::CreateShaderResourceView(cons
 shared_ptr<ID3D11ShaderResourceView> DeviceHelper::CreateShaderResourceView(const wstring& fileName)
 {
 	assert(m_deviceObject);
+	vector<BYTE> source;
+	if (m_assetCache && AssetCache::ReadFile(fileName, source))
+		return CreateShaderResourceView(source);
 	ID3D11ShaderResourceView* rv;
 	HRESULT result = D3DX11CreateShaderResourceViewFromFileW(m_deviceObject.get(), fileName.c_str(), 0, 0, &rv, 0);
 	shared_ptr<ID3D11ShaderResourceView> resourceView(rv, Utils::COMRelease);
@@ -181,6 +292,44 @@ shared_ptr<ID3D11ShaderResourceView> DeviceHelper::CreateShaderResourceView(cons
 	return resourceView;
 }
 
+shared_ptr<ID3D11ShaderResourceView> DeviceHelper::CreateShaderResourceView(const vector<BYTE>& fileData)
+{
+	assert(m_deviceObject);
+	if (!m_assetCache)
+		return _CreateShaderResourceViewInternal(fileData);
+	unsigned long long hash = AssetCache::Hash(fileData.data(), fileData.size());
+	vector<BYTE> dds;
+	if (!m_assetCache->Load("texture", TextureCooker::VERSION, hash, dds))
+	{
+		dds = CookTexture(fileData);
+		m_assetCache->Store("texture", TextureCooker::VERSION, hash, dds);
+	}
+	return _CreateShaderResourceViewInternal(dds);
+}
+
+shared_ptr<ID3D11ShaderResourceView> DeviceHelper::CreateCookedShaderResourceView(const vector<BYTE>& dds)
+{
+	assert(m_deviceObject);
+	return _CreateShaderResourceViewInternal(dds);
+}
+
+shared_ptr<ID3D11ShaderResourceView> DeviceHelper::CreateShaderResourceView(const TextureCooker::Image& image)
+{
+	assert(m_deviceObject);
+	return _CreateShaderResourceViewInternal(TextureCooker::Cook(image, TextureCooker::ChooseFormat(image)));
+}
+
+shared_ptr<ID3D11ShaderResourceView> DeviceHelper::_CreateShaderResourceViewInternal(const vector<BYTE>& fileData)
+{
+	ID3D11ShaderResourceView* rv;
+	HRESULT result = D3DX11CreateShaderResourceViewFromMemory(m_deviceObject.get(), fileData.data(), fileData.size(),
+															  0, 0, &rv, 0);
+	shared_ptr<ID3D11ShaderResourceView> resourceView(rv, Utils::COMRelease);
+	if (FAILED(result))
+		THROW_DX11(result);
+	return resourceView;
+}
+
 D3D11_SAMPLER_DESC DeviceHelper::DefaultSamplerDesc()
 {
 	D3D11_SAMPLER_DESC desc;
@@ -360,3 +509,55 @@ shared_ptr<ID3D11BlendState> DeviceHelper::CreateBlendState(const D3D11_BLEND_DE
 		THROW_DX11(result);
 	return state;
 }
+
+vector<BYTE> DeviceHelper::CookTexture(const vector<BYTE>& fileData)
+{
+	//DDS files are already cooked
+	if (fileData.size() >= 4 && memcmp(fileData.data(), "DDS ", 4) == 0)
+		return fileData;
+	TextureCooker::Image image = DecodeImage(fileData);
+	return TextureCooker::Cook(image, TextureCooker::ChooseFormat(image));
+}
+
+TextureCooker::Image DeviceHelper::DecodeImage(const vector<BYTE>& fileData)
+{
+	//Image is decoded into a staging texture, so that its pixels can be read back
+	D3DX11_IMAGE_LOAD_INFO loadInfo;
+	loadInfo.MipLevels = 1;
+	loadInfo.Usage = D3D11_USAGE_STAGING;
+	loadInfo.BindFlags = 0;
+	loadInfo.CpuAccessFlags = D3D11_CPU_ACCESS_READ;
+	loadInfo.MiscFlags = 0;
+	loadInfo.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	loadInfo.Filter = D3DX11_FILTER_NONE;
+	loadInfo.MipFilter = D3DX11_FILTER_NONE;
+	ID3D11Resource* res;
+	HRESULT result = D3DX11CreateTextureFromMemory(m_deviceObject.get(), fileData.data(), fileData.size(), &loadInfo,
+												   0, &res, 0);
+	shared_ptr<ID3D11Resource> resource(res, Utils::COMRelease);
+	if (FAILED(result))
+		THROW_DX11(result);
+	ID3D11Texture2D* tex;
+	result = resource->QueryInterface(__uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&tex));
+	shared_ptr<ID3D11Texture2D> texture(tex, Utils::COMRelease);
+	if (FAILED(result))
+		THROW_DX11(result);
+	D3D11_TEXTURE2D_DESC desc;
+	texture->GetDesc(&desc);
+	ID3D11DeviceContext* ctx;
+	m_deviceObject->GetImmediateContext(&ctx);
+	shared_ptr<ID3D11DeviceContext> context(ctx, Utils::COMRelease);
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	result = context->Map(texture.get(), 0, D3D11_MAP_READ, 0, &mapped);
+	if (FAILED(result))
+		THROW_DX11(result);
+	TextureCooker::Image image;
+	image.Width = desc.Width;
+	image.Height = desc.Height;
+	image.Pixels.resize(desc.Width * desc.Height * 4);
+	for (unsigned int y = 0; y < desc.Height; ++y)
+		memcpy(&image.Pixels[y * desc.Width * 4], reinterpret_cast<const BYTE*>(mapped.pData) + y * mapped.RowPitch,
+			   desc.Width * 4);
+	context->Unmap(texture.get(), 0);
+	return image;
+}
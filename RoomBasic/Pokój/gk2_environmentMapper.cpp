@@ -7,7 +7,7 @@ const wstring EnvironmentMapper::ShaderFile = L"resources/shaders/EnvMapShader.h
 const int EnvironmentMapper::TEXTURE_SIZE = 256;
 
 EnvironmentMapper::EnvironmentMapper(DeviceHelper& device, shared_ptr<ID3D11InputLayout>& layout,
-	const shared_ptr<ID3D11DeviceContext>& context, float nearPlane, float farPlane, XMFLOAT3 pos)
+	const shared_ptr<RenderContext>& context, float nearPlane, float farPlane, XMFLOAT3 pos)
 	: EffectBase(context)
 {
 	Initialize(device, layout, ShaderFile);
@@ -43,7 +43,7 @@ void EnvironmentMapper::InitializeTextures(DeviceHelper& device)
 
 }
 
-void EnvironmentMapper::SetupFace(const shared_ptr<ID3D11DeviceContext>& context, D3D11_TEXTURECUBE_FACE face)
+void EnvironmentMapper::SetupFace(const shared_ptr<RenderContext>& context, D3D11_TEXTURECUBE_FACE face)
 {
 	if (context != nullptr && context != m_context)
 		m_context = context;
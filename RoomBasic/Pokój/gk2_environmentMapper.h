@@ -14,13 +14,13 @@ namespace gk2
 	{
 	public:
 		EnvironmentMapper(gk2::DeviceHelper& device, std::shared_ptr<ID3D11InputLayout>& layout,
-						  const std::shared_ptr<ID3D11DeviceContext>& context, float nearP, float farP, XMFLOAT3 pos);
+						  const std::shared_ptr<gk2::RenderContext>& context, float nearP, float farP, XMFLOAT3 pos);
 		
 		void SetSamplerState(const std::shared_ptr<ID3D11SamplerState>& samplerState);
 		void SetCameraPosBuffer(const std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4>>& cameraPos);
 		void SetSurfaceColorBuffer(const std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4>>& surfaceColor);
 
-		void SetupFace(const std::shared_ptr<ID3D11DeviceContext>& context, D3D11_TEXTURECUBE_FACE face);
+		void SetupFace(const std::shared_ptr<gk2::RenderContext>& context, D3D11_TEXTURECUBE_FACE face);
 		void EndFace();
 		
 	protected:
@@ -3,10 +3,74 @@
 #include "gk2_vertices.h"
 #include <xnamath.h>
 #include <fstream>
+#include <sstream>
 
 using namespace std;
 using namespace gk2;
 
+namespace
+{
+	const unsigned int MESH_COOKER_VERSION = 1;
+
+	//Cooked mesh: vertex and index counts followed by raw vertex and index data
+	void WriteMesh(vector<BYTE>& artifact, const vector<VertexPosNormal>& vertices,
+				   const vector<unsigned short>& indices)
+	{
+		unsigned int counts[2] = { static_cast<unsigned int>(vertices.size()),
+								   static_cast<unsigned int>(indices.size()) };
+		size_t offset = artifact.size();
+		artifact.resize(offset + sizeof(counts) + counts[0] * sizeof(VertexPosNormal) +
+						counts[1] * sizeof(unsigned short));
+		memcpy(&artifact[offset], counts, sizeof(counts));
+		offset += sizeof(counts);
+		if (counts[0])
+			memcpy(&artifact[offset], vertices.data(), counts[0] * sizeof(VertexPosNormal));
+		offset += counts[0] * sizeof(VertexPosNormal);
+		if (counts[1])
+			memcpy(&artifact[offset], indices.data(), counts[1] * sizeof(unsigned short));
+	}
+
+	bool ReadMesh(const vector<BYTE>& artifact, size_t& offset, vector<VertexPosNormal>& vertices,
+				  vector<unsigned short>& indices)
+	{
+		unsigned int counts[2];
+		if (artifact.size() < offset + sizeof(counts))
+			return false;
+		memcpy(counts, &artifact[offset], sizeof(counts));
+		size_t size = sizeof(counts) + static_cast<size_t>(counts[0]) * sizeof(VertexPosNormal) +
+					  static_cast<size_t>(counts[1]) * sizeof(unsigned short);
+		if (artifact.size() < offset + size)
+			return false;
+		offset += sizeof(counts);
+		vertices.resize(counts[0]);
+		if (counts[0])
+			memcpy(vertices.data(), &artifact[offset], counts[0] * sizeof(VertexPosNormal));
+		offset += counts[0] * sizeof(VertexPosNormal);
+		indices.resize(counts[1]);
+		if (counts[1])
+			memcpy(indices.data(), &artifact[offset], counts[1] * sizeof(unsigned short));
+		offset += counts[1] * sizeof(unsigned short);
+		return true;
+	}
+
+	void ParseMesh(istream& input, vector<VertexPosNormal>& vertices, vector<unsigned short>& indices)
+	{
+		int n, in;
+		input >> n >> in;
+		vertices.resize(n);
+		XMFLOAT2 texDummy;
+		for (int i = 0; i < n; ++ i)
+		{
+			input >> vertices[i].Pos.x >> vertices[i].Pos.y >> vertices[i].Pos.z;
+			input >> vertices[i].Normal.x >> vertices[i].Normal.y >> vertices[i].Normal.z;
+			input >> texDummy.x >> texDummy.y;
+		}
+		indices.resize(in);
+		for (int i = 0; i < in; ++i)
+			input >> indices[i];
+	}
+}
+
 Mesh MeshLoader::GetSphere(int stacks, int slices, float radius /* = 0.5f */)
 {
 	int n = (stacks - 1) * slices + 2;
@@ -75,8 +139,7 @@ Mesh MeshLoader::GetSphere(int stacks, int slices, float radius /* = 0.5f */)
 	indices[k++] = (i + 1)*slices;
 	indices[k++] = i*slices + 1;
 	indices[k++] = n - 1;
-	return Mesh(m_device.CreateVertexBuffer(vertices), sizeof(VertexPosNormal),
-				m_device.CreateIndexBuffer(indices), in);
+	return CreateMesh(vertices, indices);
 }
 
 Mesh MeshLoader::GetCylinder(int stacks, int slices, float radius /* = 0.5f */, float height /* = 1.0f */)
@@ -120,8 +183,7 @@ Mesh MeshLoader::GetCylinder(int stacks, int slices, float radius /* = 0.5f */,
 		indices[k++] = (i + 1)*slices;
 		indices[k++] = (i + 1)*slices + j;
 	}
-	return Mesh(m_device.CreateVertexBuffer(vertices), sizeof(VertexPosNormal),
-				m_device.CreateIndexBuffer(indices), in);
+	return CreateMesh(vertices, indices);
 }
 
 Mesh MeshLoader::GetBox(float side /* = 1.0f */)
@@ -174,8 +236,7 @@ Mesh MeshLoader::GetBox(float side /* = 1.0f */)
 		16, 17, 18, 16, 18, 19,	//Right face
 		20, 21, 22, 20, 22, 23	//Top face
 	};
-	return Mesh(m_device.CreateVertexBuffer(vertices, 24), sizeof(VertexPosNormal),
-				m_device.CreateIndexBuffer(indices, 36), 36);
+	return CreateMesh(vertices, 24, indices, 36);
 }
 
 Mesh MeshLoader::GetQuad(float side /* = 1.0f */)
@@ -189,8 +250,7 @@ Mesh MeshLoader::GetQuad(float side /* = 1.0f */)
 		{ XMFLOAT3(side, -side, 0.0f), XMFLOAT3(0.0f, 0.0f, -1.0f) }
 	};
 	unsigned short indices[] = { 0, 1, 2, 0, 2, 3 };
-	return Mesh(m_device.CreateVertexBuffer(vertices, 4), sizeof(VertexPosNormal),
-				m_device.CreateIndexBuffer(indices, 6), 6);
+	return CreateMesh(vertices, 4, indices, 6);
 }
 
 Mesh MeshLoader::GetDisc(int slices, float radius /* = 0.5f */)
@@ -221,32 +281,42 @@ Mesh MeshLoader::GetDisc(int slices, float radius /* = 0.5f */)
 	indices[k++] = 0;
 	indices[k++] = 1;
 	indices[k++] = slices;
-	return Mesh(m_device.CreateVertexBuffer(vertices), sizeof(VertexPosNormal),
-				m_device.CreateIndexBuffer(indices), in);
+	return CreateMesh(vertices, indices);
 }
 
 Mesh MeshLoader::LoadMesh(const wstring& fileName)
 {
+	vector<VertexPosNormal> vertices;
+	vector<unsigned short> indices;
+	ParseMeshFile(fileName, vertices, indices, m_device.getAssetCache().get());
+	return CreateMesh(vertices, indices);
+}
+
+void MeshLoader::ParseMeshFile(const wstring& fileName, vector<VertexPosNormal>& vertices,
+							   vector<unsigned short>& indices, const AssetCache* cache /* = nullptr */)
+{
+	vector<BYTE> source;
+	if (cache && AssetCache::ReadFile(fileName, source))
+	{
+		unsigned long long hash = AssetCache::Hash(source.data(), source.size());
+		vector<BYTE> artifact;
+		size_t offset = 0;
+		if (cache->Load("mesh", MESH_COOKER_VERSION, hash, artifact) && ReadMesh(artifact, offset, vertices, indices))
+			return;
+		istringstream sourceInput(string(source.begin(), source.end()));
+		sourceInput.exceptions(ios::badbit | ios::failbit | ios::eofbit);
+		ParseMesh(sourceInput, vertices, indices);
+		artifact.clear();
+		WriteMesh(artifact, vertices, indices);
+		cache->Store("mesh", MESH_COOKER_VERSION, hash, artifact);
+		return;
+	}
 	ifstream input;
 	input.exceptions(ios::badbit | ios::failbit | ios::eofbit); //Most of the time you really shouldn't throw
 																//exceptions in case of eof, but here if end of file was
 																//reached before the whole mesh was loaded, we would
 																//have had to throw an exception anyway.
-	int n, in;
 	input.open(fileName);
-	input >> n >> in;
-	vector<VertexPosNormal> vertices(n);
-	XMFLOAT2 texDummy;
-	for (int i = 0; i < n; ++ i)
-	{
-		input >> vertices[i].Pos.x >> vertices[i].Pos.y >> vertices[i].Pos.z;
-		input >> vertices[i].Normal.x >> vertices[i].Normal.y >> vertices[i].Normal.z;
-		input >> texDummy.x >> texDummy.y;
-	}
-	vector<unsigned short> indices(in);
-	for (int i = 0; i < in; ++i)
-		input >> indices[i];
+	ParseMesh(input, vertices, indices);
 	input.close();
-	return Mesh(m_device.CreateVertexBuffer(vertices), sizeof(VertexPosNormal),
-				m_device.CreateIndexBuffer(indices), in);
 }
@@ -3,7 +3,9 @@
 
 #include "gk2_deviceHelper.h"
 #include "gk2_mesh.h"
+#include "gk2_vertices.h"
 #include <string>
+#include <vector>
 
 namespace gk2
 {
@@ -20,9 +22,32 @@ namespace gk2
 		gk2::Mesh GetBox(float side = 1.0f);
 		gk2::Mesh GetQuad(float side = 1.0f);
 		gk2::Mesh LoadMesh(const std::wstring& fileName);
+		//Part of LoadMesh which doesn't need the device, so that it runs on loader threads. Cooked meshes are kept
+		//in the cache, if one is given.
+		static void ParseMeshFile(const std::wstring& fileName, std::vector<gk2::VertexPosNormal>& vertices,
+								  std::vector<unsigned short>& indices, const gk2::AssetCache* cache = nullptr);
+
+		template<typename T>
+		gk2::Mesh CreateMesh(const std::vector<T>& vertices, const std::vector<unsigned short>& indices)
+		{
+			return CreateMesh(vertices.data(), static_cast<unsigned int>(vertices.size()),
+							  indices.data(), static_cast<unsigned int>(indices.size()));
+		}
 
 	private:
 		gk2::DeviceHelper m_device;
+
+		template<typename T>
+		gk2::Mesh CreateMesh(const T* vertices, unsigned int verticesCount,
+							 const unsigned short* indices, unsigned int indicesCount)
+		{
+			gk2::Mesh mesh(m_device.CreateVertexBuffer(vertices, verticesCount), sizeof(T),
+						   m_device.CreateIndexBuffer(indices, indicesCount), indicesCount);
+			const XMFLOAT3* positions = verticesCount ? &vertices[0].Pos : nullptr;
+			gk2::BoundingBox box = gk2::BoundingBox::FromPoints(positions, verticesCount, sizeof(T));
+			mesh.setLocalBounds(box, gk2::BoundingSphere::FromPoints(positions, verticesCount, sizeof(T), box));
+			return mesh;
+		}
 	};
 }
 
@@ -1,5 +1,6 @@
 #include "gk2_room.h"
 #include "gk2_window.h"
+#include "gk2_vertices.h"
 #include "gk2_textureGenerator.h"
 
 using namespace std;
@@ -22,16 +23,6 @@ Room::~Room()
 
 }
 
-void* Room::operator new(size_t size)
-{
-	return Utils::New16Aligned(size);
-}
-
-void Room::operator delete(void* ptr)
-{
-	Utils::Delete16Aligned(ptr);
-}
-
 void Room::InitializeConstantBuffers()
 {
 	m_projCB.reset(new CBMatrix(m_device));
@@ -56,8 +47,8 @@ void Room::InitializeCamera()
 
 void Room::InitializeTextures()
 {
-	m_wallTexture = m_device.CreateShaderResourceView(L"resources/textures/brick_wall.jpg");
-	m_posterTexture = m_device.CreateShaderResourceView(L"resources/textures/lautrec_divan.jpg");
+	LoadTextureAsync(L"resources/textures/brick_wall.jpg", m_wallTexture);
+	LoadTextureAsync(L"resources/textures/lautrec_divan.jpg", m_posterTexture);
 	D3D11_SAMPLER_DESC sd = m_device.DefaultSamplerDesc();
 	sd.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
 	sd.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
@@ -70,23 +61,35 @@ void Room::InitializeTextures()
 	sd.BorderColor[3] = 0;
 	sd.MipLODBias = 2;
 	m_samplerBorder = m_device.CreateSamplerState(sd);
-	m_perlinTexture = m_device.CreateShaderResourceView(L"resources/textures/perlin.jpg");
-
-	D3D11_TEXTURE2D_DESC texDesc = m_device.DefaultTexture2DDesc();
-	texDesc.Width = 64;
-	texDesc.Height = 512;
-	texDesc.BindFlags |= D3D11_BIND_RENDER_TARGET;
-	texDesc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
-	shared_ptr<ID3D11Texture2D> woodTexture = m_device.CreateTexture2D(texDesc);
-	shared_ptr<BYTE> data(new BYTE[64 * 512 * 4], Utils::DeleteArray<BYTE>);
-	BYTE *d = data.get();
-	TextureGenerator txGen(6, 0.35f);
-	for (int i = 0; i < 512; ++i)
+	LoadTextureAsync(L"resources/textures/perlin.jpg", m_perlinTexture);
+
+	m_woodTexture = CreateWoodTexture();
+}
+
+shared_ptr<ID3D11ShaderResourceView> Room::CreateWoodTexture()
+{
+	//Wood depends only on these parameters, so it is cached under their hash and neither generated nor cooked
+	//again. The version has to change with the generator.
+	struct { unsigned int Version, Width, Height, Octaves; float Persistance; } params = { 1, 64, 512, 6, 0.35f };
+	unsigned long long hash = AssetCache::Hash(&params, sizeof(params));
+	const shared_ptr<AssetCache>& cache = m_device.getAssetCache();
+	vector<BYTE> dds;
+	if (cache && cache->Load("wood", TextureCooker::VERSION, hash, dds))
+		return m_device.CreateCookedShaderResourceView(dds);
+
+	//Mipmaps are generated and the texture compressed by the cooker
+	TextureCooker::Image wood;
+	wood.Width = params.Width;
+	wood.Height = params.Height;
+	wood.Pixels.resize(wood.Width * wood.Height * 4);
+	BYTE *d = wood.Pixels.data();
+	TextureGenerator txGen(params.Octaves, params.Persistance);
+	for (unsigned int i = 0; i < wood.Height; ++i)
 	{
-		float x = i / 512.0f;
-		for (int j = 0; j < 64; ++j)
+		float x = static_cast<float>(i) / wood.Height;
+		for (unsigned int j = 0; j < wood.Width; ++j)
 		{
-			float y = j / 64.0f;
+			float y = static_cast<float>(j) / wood.Width;
 			float c = txGen.Wood(x, y);
 			BYTE ic = static_cast<BYTE>(c * 239);
 			*(d++) = ic;
@@ -97,9 +100,53 @@ void Room::InitializeTextures()
 			*(d++) = 255;
 		}
 	}
-	m_context->UpdateSubresource(woodTexture.get(), 0, 0, data.get(), 64*4, 64*512*4);
-	m_woodTexture = m_device.CreateShaderResourceView(woodTexture);
-	m_context->GenerateMips(m_woodTexture.get());
+	dds = TextureCooker::Cook(wood, TextureCooker::ChooseFormat(wood));
+	if (cache)
+		cache->Store("wood", TextureCooker::VERSION, hash, dds);
+	return m_device.CreateCookedShaderResourceView(dds);
+}
+
+void Room::LoadTextureAsync(const wstring& fileName, shared_ptr<ID3D11ShaderResourceView>& texture)
+{
+	//File is read, decoded and cooked on a loader thread, only the texture is created in Update
+	shared_ptr<AssetCache> cache = m_device.getAssetCache();
+	shared_future<vector<BYTE>> dds = m_assetLoader.Load<vector<BYTE>>([fileName, cache]()
+	{
+		return AssetLoader::CookTexture(fileName, cache.get());
+	});
+	m_assetLoader.WhenReady<vector<BYTE>>(dds, [this, &texture](const vector<BYTE>& cooked)
+	{
+		texture = m_device.CreateCookedShaderResourceView(cooked);
+		//Effects keep their own pointers to the textures
+		SetEffectTextures();
+	});
+}
+
+void Room::LoadMeshAsync(const wstring& fileName, Mesh& mesh)
+{
+	//Mesh file is parsed on a loader thread, the buffers are created in Update once it's done
+	typedef pair<vector<VertexPosNormal>, vector<unsigned short>> MeshFileData;
+	shared_ptr<AssetCache> cache = m_device.getAssetCache();
+	shared_future<MeshFileData> data = m_assetLoader.Load<MeshFileData>([fileName, cache]()
+	{
+		MeshFileData result;
+		MeshLoader::ParseMeshFile(fileName, result.first, result.second, cache.get());
+		return result;
+	});
+	m_assetLoader.WhenReady<MeshFileData>(data, [this, &mesh](const MeshFileData& meshData)
+	{
+		XMMATRIX world = mesh.getWorldMatrix();
+		mesh = m_meshLoader.CreateMesh(meshData.first, meshData.second);
+		mesh.setWorldMatrix(world);
+	});
+}
+
+void Room::SetEffectTextures()
+{
+	m_textureEffect->SetTexture(m_wallTexture);
+	m_multiTextureEffect->SetTexture(m_wallTexture);
+	m_multiTextureEffect->SetTexture2(m_posterTexture);
+	m_colorTexEffect->SetTexture(m_perlinTexture);
 }
 
 void Room::CreateScene()
@@ -113,7 +160,7 @@ void Room::CreateScene()
 		m_walls[i].setWorldMatrix(wall * XMMatrixRotationY(a));
 	m_walls[4].setWorldMatrix(wall * XMMatrixRotationX(XM_PIDIV2));
 	m_walls[5].setWorldMatrix(wall * XMMatrixRotationX(-XM_PIDIV2));
-	m_teapot = m_meshLoader.LoadMesh(L"resources/meshes/teapot.mesh");
+	LoadMeshAsync(L"resources/meshes/teapot.mesh", m_teapot);
 	XMMATRIX teapotMtx = XMMatrixTranslation(0.0f, -2.3f, 0.f) * XMMatrixScaling(0.1f, 0.1f, 0.1f) *
 						 XMMatrixRotationY(-XM_PIDIV2) * XMMatrixTranslation(-1.3f, -0.74f, -0.6f);
 	m_teapot.setWorldMatrix(teapotMtx);
@@ -122,15 +169,15 @@ void Room::CreateScene()
 						 XMMatrixRotationY(-XM_PIDIV2) * XMMatrixTranslation(-1.3f, -0.74f, -0.6f));
 	m_box = m_meshLoader.GetBox();
 	m_box.setWorldMatrix(XMMatrixTranslation(-1.4f, -1.46f, -0.6f));
-	m_lamp = m_meshLoader.LoadMesh(L"resources/meshes/lamp.mesh");
+	LoadMeshAsync(L"resources/meshes/lamp.mesh", m_lamp);
 	UpdateLamp(0.0f);
-	m_chairSeat = m_meshLoader.LoadMesh(L"resources/meshes/chair_seat.mesh");
-	m_chairBack = m_meshLoader.LoadMesh(L"resources/meshes/chair_back.mesh");
+	LoadMeshAsync(L"resources/meshes/chair_seat.mesh", m_chairSeat);
+	LoadMeshAsync(L"resources/meshes/chair_back.mesh", m_chairBack);
 	XMMATRIX chair = XMMatrixRotationY(XM_PI + XM_PI/9 /*20 deg*/) * XMMatrixTranslation(-0.1f, -1.06f, -1.3f);
 	m_chairSeat.setWorldMatrix(chair);
 	m_chairBack.setWorldMatrix(chair);
-	m_monitor = m_meshLoader.LoadMesh(L"resources/meshes/monitor.mesh");
-	m_screen = m_meshLoader.LoadMesh(L"resources/meshes/screen.mesh");
+	LoadMeshAsync(L"resources/meshes/monitor.mesh", m_monitor);
+	LoadMeshAsync(L"resources/meshes/screen.mesh", m_screen);
 	XMMATRIX monitor = XMMatrixRotationY(XM_PIDIV4) *
 					   XMMatrixTranslation(TABLE_POS.x, TABLE_POS.y + TABLE_H + 0.42f, TABLE_POS.z);
 	m_monitor.setWorldMatrix(monitor);
@@ -154,6 +201,16 @@ void Room::CreateScene()
 	posterMatrix = XMMatrixInverse(&XMVECTOR(), posterMatrix);
 
 	m_posterTexCB->Update(m_context, posterMatrix);
+	m_wallInstances = CreateInstanceBuffer(m_walls + 1, 3);
+	m_tableLegInstances = CreateInstanceBuffer(m_tableLegs, 4);
+}
+
+shared_ptr<ID3D11Buffer> Room::CreateInstanceBuffer(const Mesh* meshes, unsigned int count)
+{
+	vector<InstanceWorld> instances(count);
+	for (unsigned int i = 0; i < count; ++i)
+		XMStoreFloat4x4(&instances[i].World, meshes[i].getWorldMatrix());
+	return m_device.CreateVertexBuffer(instances);
 }
 
 bool Room::LoadContent()
@@ -177,7 +234,6 @@ bool Room::LoadContent()
 	m_textureEffect->SetWorldMtxBuffer(m_worldCB);
 	m_textureEffect->SetTextureMtxBuffer(m_textureCB);
 	m_textureEffect->SetSamplerState(m_samplerWrap);
-	m_textureEffect->SetTexture(m_wallTexture);
 
 	m_multiTextureEffect.reset(new MultiTextureEffect(m_device, m_layout));
 	m_multiTextureEffect->SetProjMtxBuffer(m_projCB);
@@ -186,8 +242,6 @@ bool Room::LoadContent()
 	m_multiTextureEffect->SetTextureMtxBuffer(m_textureCB);
 	m_multiTextureEffect->SetTextureMtxBuffer2(m_posterTexCB);
 	m_multiTextureEffect->SetSamplerState(m_samplerBorder);
-	m_multiTextureEffect->SetTexture(m_wallTexture);
-	m_multiTextureEffect->SetTexture2(m_posterTexture);
 
 	m_colorTexEffect.reset(new ColorTexEffect(m_device, m_layout));
 	m_colorTexEffect->SetProjMtxBuffer(m_projCB);
@@ -195,7 +249,6 @@ bool Room::LoadContent()
 	m_colorTexEffect->SetWorldMtxBuffer(m_worldCB);
 	m_colorTexEffect->SetTextureMtxBuffer(m_textureCB);
 	m_colorTexEffect->SetSamplerState(m_samplerWrap);
-	m_colorTexEffect->SetTexture(m_perlinTexture);
 	m_colorTexEffect->SetSurfaceColorBuffer(m_surfaceColorCB);
 
 	m_environmentMapper.reset(new EnvironmentMapper(m_device, m_layout, m_context, 0.4f, 8.0f,
@@ -239,6 +292,7 @@ void Room::UpdateLamp(float dt)
 
 void Room::Update(float dt)
 {
+	m_assetLoader.Finalize();
 	UpdateLamp(dt);
 	static MouseState prevState;
 	MouseState currentState;
@@ -291,11 +345,9 @@ void Room::DrawWalls()
 	//draw remaining walls
 	m_textureEffect->SetTexture(m_wallTexture);
 	m_textureEffect->Begin(m_context);
-	for (int i = 1; i < 4; ++i)
-	{
-		m_worldCB->Update(m_context, m_walls[i].getWorldMatrix());
-		m_walls[i].Render(m_context);
-	}
+	m_textureEffect->SetInstancing(true);
+	m_walls[1].RenderInstanced(m_context, m_wallInstances.get(), 3);
+	m_textureEffect->SetInstancing(false);
 	m_textureEffect->End();
 
 }
@@ -320,11 +372,9 @@ void Room::DrawTable()
 	m_context->RSSetState(m_rsCullNone.get());
 	m_surfaceColorCB->Update(m_context, XMFLOAT4(0.1f, 0.1f, 0.1f, 1.0f));
 	//Draw legs
-	for (int i = 0; i < 4; ++i)
-	{
-		m_worldCB->Update(m_context, m_tableLegs[i].getWorldMatrix());
-		m_tableLegs[i].Render(m_context);
-	}
+	m_phongEffect->SetInstancing(true);
+	m_tableLegs[0].RenderInstanced(m_context, m_tableLegInstances.get(), 4);
+	m_phongEffect->SetInstancing(false);
 	//Draw table surface
 	m_worldCB->Update(m_context, m_tableTop.getWorldMatrix());
 	m_tableTop.Render(m_context);
@@ -10,18 +10,17 @@
 #include "gk2_constantBuffer.h"
 #include "gk2_colorTexEffect.h"
 #include "gk2_environmentMapper.h"
+#include "gk2_assetLoader.h"
+#include "gk2_aligned.h"
 
 namespace gk2
 {
-	class Room : public gk2::ApplicationBase
+	class Room : public gk2::ApplicationBase, public gk2::AlignedNew
 	{
 	public:
 		Room(HINSTANCE hInstance);
 		virtual ~Room();
 
-		static void* operator new(size_t size);
-		static void operator delete(void* ptr);
-
 	protected:
 		virtual bool LoadContent();
 		virtual void UnloadContent();
@@ -48,11 +47,15 @@ namespace gk2
 		gk2::Mesh m_tableTop;
 		gk2::Mesh m_monitor;
 		gk2::Mesh m_screen;
+		//World matrices of the walls sharing the wall texture and of the legs, each drawn with one instanced call
+		std::shared_ptr<ID3D11Buffer> m_wallInstances;
+		std::shared_ptr<ID3D11Buffer> m_tableLegInstances;
 
 		XMMATRIX m_projMtx;
 
 		gk2::Camera m_camera;
 		gk2::MeshLoader m_meshLoader;
+		gk2::AssetLoader m_assetLoader;
 
 		std::shared_ptr<gk2::CBMatrix> m_worldCB;
 		std::shared_ptr<gk2::CBMatrix> m_viewCB;
@@ -84,8 +87,14 @@ namespace gk2
 		void InitializeTextures();
 		void InitializeCamera();
 		void CreateScene();
+		void LoadTextureAsync(const std::wstring& fileName, std::shared_ptr<ID3D11ShaderResourceView>& texture);
+		void LoadMeshAsync(const std::wstring& fileName, gk2::Mesh& mesh);
+		void SetEffectTextures();
+		std::shared_ptr<ID3D11ShaderResourceView> CreateWoodTexture();
 		void UpdateCamera();
 		void UpdateLamp(float dt);
+		//Buffer with the world matrices of the meshes for gk2::Mesh::RenderInstanced
+		std::shared_ptr<ID3D11Buffer> CreateInstanceBuffer(const gk2::Mesh* meshes, unsigned int count);
 
 		void DrawScene();
 		void DrawWalls();
@@ -29,6 +29,17 @@ struct VSInput
 	float3 norm : NORMAL0;
 };
 
+struct VSInstanceInput
+{
+	float3 pos : POSITION;
+	float3 norm : NORMAL0;
+	//Rows of the instance's world matrix
+	float4 world0 : WORLD0;
+	float4 world1 : WORLD1;
+	float4 world2 : WORLD2;
+	float4 world3 : WORLD3;
+};
+
 struct PSInput
 {
 	float4 pos : SV_POSITION;
@@ -38,10 +49,10 @@ struct PSInput
 	float3 lightVec1 : TEXCOORD2;
 };
 
-PSInput VS_Main(VSInput i)
+PSInput Transform(VSInput i, matrix world)
 {
 	PSInput o = (PSInput)0;
-	matrix worldView = mul(viewMatrix, worldMatrix);
+	matrix worldView = mul(viewMatrix, world);
 	float4 viewPos = float4(i.pos, 1.0f);
 	viewPos = mul(worldView, viewPos);
 	o.pos = mul(projMatrix, viewPos);
@@ -55,6 +66,20 @@ PSInput VS_Main(VSInput i)
 	return o;
 }
 
+PSInput VS_Main(VSInput i)
+{
+	return Transform(i, worldMatrix);
+}
+
+//Instances of one mesh drawn with one call, the world matrix is laid out as if it was read from cbWorld
+PSInput VS_Instanced(VSInstanceInput i)
+{
+	VSInput v;
+	v.pos = i.pos;
+	v.norm = i.norm;
+	return Transform(v, transpose(float4x4(i.world0, i.world1, i.world2, i.world3)));
+}
+
 static const float3 ambientColor = float3(0.2f, 0.2f, 0.2f);
 static const float3 lightColor = float3(1.0f, 1.0f, 1.0f);
 static const float3 kd = 0.5, ks = 0.2f, m = 100.0f;
@@ -27,26 +27,51 @@ struct VSInput
 	float3 norm : NORMAL0;
 };
 
+struct VSInstanceInput
+{
+	float3 pos : POSITION;
+	float3 norm : NORMAL0;
+	//Rows of the instance's world matrix
+	float4 world0 : WORLD0;
+	float4 world1 : WORLD1;
+	float4 world2 : WORLD2;
+	float4 world3 : WORLD3;
+};
+
 struct PSInput
 {
 	float4 pos : SV_POSITION;
 	float2 tex: TEXCOORD0;
 };
 
-PSInput VS_Main(VSInput i)
+PSInput Transform(VSInput i, matrix world)
 {
 	PSInput o = (PSInput)0;
 	o.pos = float4(i.pos, 1.0f);
 
 	o.tex = mul(texMatrix, o.pos).xy;
 
-	o.pos = mul(worldMatrix, o.pos);
+	o.pos = mul(world, o.pos);
 	o.pos = mul(viewMatrix, o.pos);
 	o.pos = mul(projMatrix, o.pos);
 	
 	return o;
 }
 
+PSInput VS_Main(VSInput i)
+{
+	return Transform(i, worldMatrix);
+}
+
+//Instances of one mesh drawn with one call, the world matrix is laid out as if it was read from cbWorld
+PSInput VS_Instanced(VSInstanceInput i)
+{
+	VSInput v;
+	v.pos = i.pos;
+	v.norm = i.norm;
+	return Transform(v, transpose(float4x4(i.world0, i.world1, i.world2, i.world3)));
+}
+
 float4 PS_Main(PSInput i) : SV_TARGET
 {
 	return colorMap.Sample(colorSampler, i.tex);
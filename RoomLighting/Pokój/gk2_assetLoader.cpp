@@ -0,0 +1,110 @@
+#include "gk2_assetLoader.h"
+#include "gk2_imageDecoder.h"
+#include "gk2_fileSystem.h"
+#include <cstring>
+#include <ios>
+
+using namespace std;
+using namespace gk2;
+
+AssetLoader::AssetLoader(unsigned int workersCount)
+	: m_stopping(false)
+{
+	if (workersCount == 0)
+	{
+		unsigned int hw = thread::hardware_concurrency();
+		workersCount = hw > 1 ? hw - 1 : 1;
+	}
+	for (unsigned int i = 0; i < workersCount; ++i)
+		m_workers.push_back(thread(&AssetLoader::WorkerLoop, this));
+}
+
+AssetLoader::~AssetLoader()
+{
+	{
+		unique_lock<mutex> lock(m_mutex);
+		m_stopping = true;
+		m_jobs.clear();
+	}
+	m_jobAvailable.notify_all();
+	for (auto it = m_workers.begin(); it != m_workers.end(); ++it)
+		it->join();
+}
+
+void AssetLoader::Enqueue(const function<void()>& job)
+{
+	{
+		unique_lock<mutex> lock(m_mutex);
+		m_jobs.push_back(job);
+	}
+	m_jobAvailable.notify_one();
+}
+
+void AssetLoader::WorkerLoop()
+{
+	while (true)
+	{
+		function<void()> job;
+		{
+			unique_lock<mutex> lock(m_mutex);
+			while (!m_stopping && m_jobs.empty())
+				m_jobAvailable.wait(lock);
+			if (m_stopping)
+				return;
+			job = m_jobs.front();
+			m_jobs.pop_front();
+		}
+		job();
+	}
+}
+
+unsigned int AssetLoader::Finalize()
+{
+	//Finalizers may register new loads, so the list is not iterated directly
+	vector<function<bool()>> pending;
+	pending.swap(m_pending);
+	unsigned int i = 0;
+	try
+	{
+		for (; i < pending.size(); ++i)
+			if (!pending[i]())
+				m_pending.push_back(pending[i]);
+	}
+	catch (...)
+	{
+		//Failed load is dropped, the remaining ones are kept for the next call
+		m_pending.insert(m_pending.end(), pending.begin() + i + 1, pending.end());
+		throw;
+	}
+	return static_cast<unsigned int>(m_pending.size());
+}
+
+void AssetLoader::FinalizeAll()
+{
+	while (Finalize() > 0)
+		this_thread::yield();
+}
+
+vector<BYTE> AssetLoader::ReadFile(const wstring& fileName)
+{
+	vector<BYTE> data;
+	if (!NativeFileSystem().ReadFile(fileName, data))
+		throw ios_base::failure("Cannot read " + string(fileName.begin(), fileName.end()));
+	return data;
+}
+
+vector<BYTE> AssetLoader::CookTexture(const wstring& fileName, const AssetCache* cache)
+{
+	vector<BYTE> fileData = ReadFile(fileName);
+	if (fileData.size() >= 4 && memcmp(fileData.data(), "DDS ", 4) == 0)
+		return fileData;
+	unsigned long long hash = AssetCache::Hash(fileData.data(), fileData.size());
+	vector<BYTE> dds;
+	if (cache && cache->Load("texture", TextureCooker::VERSION, hash, dds))
+		return dds;
+	TextureCooker::Image image = ImageDecoder::Decode(fileData);
+	dds = TextureCooker::Cook(image, TextureCooker::ChooseFormat(image));
+	if (cache)
+		cache->Store("texture", TextureCooker::VERSION, hash, dds);
+	return dds;
+}
@@ -0,0 +1,81 @@
+#ifndef __GK2_ASSET_LOADER_H_
+#define __GK2_ASSET_LOADER_H_
+
+#include "gk2_assetCache.h"
+#include <Windows.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <memory>
+
+namespace gk2
+{
+	//Runs asset loading jobs (file I/O, parsing) on a pool of worker threads. Results are returned as
+	//futures. Objects which need the device context are created by finalizers, which are called by
+	//Finalize on the render thread once the corresponding future is ready.
+	class AssetLoader
+	{
+	public:
+		//Zero workers means one less than the number of hardware threads (at least one)
+		AssetLoader(unsigned int workersCount = 0);
+		~AssetLoader();
+
+		template<typename T>
+		std::shared_future<T> Load(const std::function<T()>& job)
+		{
+			std::shared_ptr<std::packaged_task<T()>> task(new std::packaged_task<T()>(job));
+			std::shared_future<T> result = task->get_future().share();
+			Enqueue([task]() { (*task)(); });
+			return result;
+		}
+
+		template<typename T>
+		void WhenReady(const std::shared_future<T>& future, const std::function<void(const T&)>& finalizer)
+		{
+			m_pending.push_back([future, finalizer]() -> bool
+			{
+				if (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+					return false;
+				//Rethrows exception thrown by the loading job
+				finalizer(future.get());
+				return true;
+			});
+		}
+
+		//Calls finalizers of finished jobs. Returns number of jobs still waiting for finalization.
+		unsigned int Finalize();
+		//Blocks until all jobs are finished and finalized.
+		void FinalizeAll();
+
+		bool isIdle() const { return m_pending.empty(); }
+		unsigned int getWorkersCount() const { return static_cast<unsigned int>(m_workers.size()); }
+
+		static std::vector<BYTE> ReadFile(const std::wstring& fileName);
+		//DDS file of the texture, decoded by ImageDecoder and cooked by TextureCooker, so that only the device
+		//texture is created by the finalizer. DDS files are returned as they are. Cooked textures are kept in the
+		//cache, if one is given.
+		static std::vector<BYTE> CookTexture(const std::wstring& fileName, const gk2::AssetCache* cache = nullptr);
+
+	private:
+		std::vector<std::thread> m_workers;
+		std::deque<std::function<void()>> m_jobs;
+		std::mutex m_mutex;
+		std::condition_variable m_jobAvailable;
+		bool m_stopping;
+		std::vector<std::function<bool()>> m_pending;
+
+		void Enqueue(const std::function<void()>& job);
+		void WorkerLoop();
+
+		AssetLoader(const AssetLoader&);
+		AssetLoader& operator =(const AssetLoader&);
+	};
+}
+
+#endif __GK2_ASSET_LOADER_H_
@@ -5,6 +5,7 @@
 #include <memory>
 #include <xnamath.h>
 #include "gk2_deviceHelper.h"
+#include "gk2_renderContext.h"
 
 namespace gk2
 {
@@ -16,11 +17,11 @@ namespace gk2
 	protected:
 		ConstantBufferBase(gk2::DeviceHelper& device, unsigned int dataSize, unsigned int dataCount);
 
-		void Update(const std::shared_ptr<ID3D11DeviceContext>& context, const void* dataPtr, unsigned int dataCount);
+		void Update(const std::shared_ptr<gk2::RenderContext>& context, const void* dataPtr, unsigned int dataCount);
 		
-		void Map(const std::shared_ptr<ID3D11DeviceContext>& context);
+		void Map(const std::shared_ptr<gk2::RenderContext>& context);
 		void* get();
-		void Unmap(const std::shared_ptr<ID3D11DeviceContext>& context);
+		void Unmap(const std::shared_ptr<gk2::RenderContext>& context);
 
 		int m_mapped;
 		unsigned int m_dataSize;
@@ -41,19 +42,19 @@ namespace gk2
 			: ConstantBufferBase(device, sizeof(T), N)
 		{ }
 
-		void Update(const std::shared_ptr<ID3D11DeviceContext>& context, const T& data)
+		void Update(const std::shared_ptr<gk2::RenderContext>& context, const T& data)
 		{
 			return ConstantBufferBase::Update(context, reinterpret_cast<const void*>(&data), 1);
 		}
 
-		void Update(const std::shared_ptr<ID3D11DeviceContext>& context, const T* data)
+		void Update(const std::shared_ptr<gk2::RenderContext>& context, const T* data)
 		{
 			return ConstantBufferBase::Update(context, reinterpret_cast<const void*>(data), N);
 		}
 
-		void Map(const std::shared_ptr<ID3D11DeviceContext>& context) { ConstantBufferBase::Map(context); }
+		void Map(const std::shared_ptr<gk2::RenderContext>& context) { ConstantBufferBase::Map(context); }
 		T* get() { return reinterpret_cast<T*>(ConstantBufferBase::get()); }
-		void Unmap(const std::shared_ptr<ID3D11DeviceContext>& context) { ConstantBufferBase::Unmap(context); }
+		void Unmap(const std::shared_ptr<gk2::RenderContext>& context) { ConstantBufferBase::Unmap(context); }
 
 	private:
 		ConstantBuffer(const ConstantBuffer<T, N>& right) { }
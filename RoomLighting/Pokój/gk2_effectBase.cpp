@@ -1,10 +1,11 @@
 #include "gk2_effectBase.h"
 #include "gk2_vertices.h"
+#include <cassert>
 
 using namespace std;
 using namespace gk2;
 
-EffectBase::EffectBase(shared_ptr<ID3D11DeviceContext> context /* = nullptr */)
+EffectBase::EffectBase(shared_ptr<RenderContext> context /* = nullptr */)
 	: m_context(context)
 {
 }
@@ -28,7 +29,7 @@ void EffectBase::SetProjMtxBuffer(const shared_ptr<CBMatrix>& proj)
 }
 
 
-void EffectBase::Begin(std::shared_ptr<ID3D11DeviceContext> context /* = nullptr */)
+void EffectBase::Begin(std::shared_ptr<RenderContext> context /* = nullptr */)
 {
 	if (context != nullptr && context != m_context)
 		m_context = context;
@@ -46,6 +47,15 @@ void EffectBase::End()
 
 }
 
+void EffectBase::SetInstancing(bool enabled)
+{
+	assert(m_instancedVS || !enabled);
+	if (m_context == nullptr)
+		return;
+	m_context->VSSetShader(enabled ? m_instancedVS.get() : m_vs.get(), nullptr, 0);
+	m_context->IASetInputLayout(enabled ? m_instancedLayout.get() : m_layout.get());
+}
+
 void EffectBase::Initialize(DeviceHelper& device, shared_ptr<ID3D11InputLayout>& layout, const wstring& shaderFile)
 {
 	shared_ptr<ID3DBlob> vsByteCode = device.CompileD3DShader(shaderFile, "VS_Main", "vs_4_0");
@@ -59,4 +69,14 @@ void EffectBase::Initialize(DeviceHelper& device, shared_ptr<ID3D11InputLayout>&
 	}
 	else
 		m_layout = layout;
+}
+
+void EffectBase::InitializeInstancing(DeviceHelper& device, const wstring& shaderFile)
+{
+	shared_ptr<ID3DBlob> vsByteCode = device.CompileD3DShader(shaderFile, "VS_Instanced", "vs_4_0");
+	m_instancedVS = device.CreateVertexShader(vsByteCode);
+	vector<D3D11_INPUT_ELEMENT_DESC> layout(VertexPosNormal::Layout,
+											VertexPosNormal::Layout + VertexPosNormal::LayoutElements);
+	layout.insert(layout.end(), InstanceWorld::Layout, InstanceWorld::Layout + InstanceWorld::LayoutElements);
+	m_instancedLayout = device.CreateInputLayout(layout.data(), static_cast<unsigned int>(layout.size()), vsByteCode);
 }
\ No newline at end of file
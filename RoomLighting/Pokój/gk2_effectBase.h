@@ -16,11 +16,14 @@ namespace gk2
 		void SetViewMtxBuffer(const std::shared_ptr<gk2::CBMatrix>& view);
 		void SetProjMtxBuffer(const std::shared_ptr<gk2::CBMatrix>& proj);
 
-		void Begin(std::shared_ptr<ID3D11DeviceContext> context = nullptr);
+		void Begin(std::shared_ptr<gk2::RenderContext> context = nullptr);
 		void End();
+		//Between Begin and End switches from VS_Main to VS_Instanced, which reads the world matrices of
+		//gk2::InstanceWorld instead of the world matrix buffer, and back
+		void SetInstancing(bool enabled);
 
 	protected:
-		EffectBase(std::shared_ptr<ID3D11DeviceContext> context = nullptr);
+		EffectBase(std::shared_ptr<gk2::RenderContext> context = nullptr);
 
 		virtual void SetVertexShaderData() = 0;
 		virtual void SetPixelShaderData() = 0;
@@ -28,15 +31,19 @@ namespace gk2
 		std::shared_ptr<gk2::CBMatrix> m_worldCB;
 		std::shared_ptr<gk2::CBMatrix> m_viewCB;
 		std::shared_ptr<gk2::CBMatrix> m_projCB;
-		std::shared_ptr<ID3D11DeviceContext> m_context;
+		std::shared_ptr<gk2::RenderContext> m_context;
 
 		void Initialize(gk2::DeviceHelper& device, std::shared_ptr<ID3D11InputLayout>& layout,
 						const std::wstring& shaderFile);
+		//For the effects whose shader has VS_Instanced
+		void InitializeInstancing(gk2::DeviceHelper& device, const std::wstring& shaderFile);
 
 	private:
 		std::shared_ptr<ID3D11VertexShader> m_vs;
 		std::shared_ptr<ID3D11PixelShader> m_ps;
 		std::shared_ptr<ID3D11InputLayout> m_layout;
+		std::shared_ptr<ID3D11VertexShader> m_instancedVS;
+		std::shared_ptr<ID3D11InputLayout> m_instancedLayout;
 	};
 }
 
@@ -0,0 +1,36 @@
+#ifndef __GK2_FILE_SYSTEM_H_
+#define __GK2_FILE_SYSTEM_H_
+
+#include <Windows.h>
+#include <string>
+#include <vector>
+
+namespace gk2
+{
+	//File operations of the caches. Paths may use / or \ on Windows, elsewhere / only.
+	class FileSystem
+	{
+	public:
+		virtual ~FileSystem() { }
+
+		virtual bool ReadFile(const std::wstring& fileName, std::vector<BYTE>& data) const = 0;
+		//Replaces the file at once, readers see either the old or the new contents, never a part of them
+		virtual bool WriteFile(const std::wstring& fileName, const std::vector<BYTE>& data) const = 0;
+		//Succeeds if the directory already exists
+		virtual bool MakeDirectory(const std::wstring& directory) const = 0;
+		//Directory for temporary files ending with a separator
+		virtual std::wstring TempDirectory() const = 0;
+	};
+
+	//Files on the disk, through the Windows API or the C library on other platforms
+	class NativeFileSystem : public FileSystem
+	{
+	public:
+		virtual bool ReadFile(const std::wstring& fileName, std::vector<BYTE>& data) const;
+		virtual bool WriteFile(const std::wstring& fileName, const std::vector<BYTE>& data) const;
+		virtual bool MakeDirectory(const std::wstring& directory) const;
+		virtual std::wstring TempDirectory() const;
+	};
+}
+
+#endif __GK2_FILE_SYSTEM_H_
@@ -0,0 +1,153 @@
+#include "gk2_frameArena.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+using namespace std;
+using namespace gk2;
+
+namespace
+{
+	//Arenas of all threads, which live as long as the program
+	struct ArenaRegistry
+	{
+		mutex Mutex;
+		vector<unique_ptr<FrameArena>> Arenas;
+	};
+
+	ArenaRegistry s_registry;
+
+	size_t AlignedOffset(const unsigned char* base, size_t offset, size_t alignment)
+	{
+		uintptr_t address = reinterpret_cast<uintptr_t>(base) + offset;
+		uintptr_t aligned = (address + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+		return offset + static_cast<size_t>(aligned - address);
+	}
+}
+
+GK2_THREAD_LOCAL FrameArena* FrameArena::s_threadArena = nullptr;
+
+FrameArena::FrameArena(size_t blockSize /* = DEFAULT_BLOCK_SIZE */)
+	: m_blockSize(blockSize), m_current(0), m_offset(0), m_used(0), m_framePeak(0), m_capacity(0),
+	  m_lastFramePeak(0), m_peak(0)
+{
+#ifdef _DEBUG
+	m_poisoning = true;
+#else
+	m_poisoning = false;
+#endif
+}
+
+FrameArena* FrameArena::CreateThreadArena()
+{
+	unique_ptr<FrameArena> arena(new FrameArena());
+	unique_lock<mutex> lock(s_registry.Mutex);
+	s_threadArena = arena.get();
+	s_registry.Arenas.push_back(move(arena));
+	return s_threadArena;
+}
+
+FrameArena& FrameArena::getThreadArena()
+{
+	return s_threadArena ? *s_threadArena : *CreateThreadArena();
+}
+
+void FrameArena::EndFrame()
+{
+	if (s_threadArena)
+		s_threadArena->Reset();
+}
+
+void FrameArena::WriteStatistics(wostream& s)
+{
+	unique_lock<mutex> lock(s_registry.Mutex);
+	s << L"Frame arena: last frame KB, peak KB, capacity KB" << endl;
+	for (size_t i = 0; i < s_registry.Arenas.size(); ++i)
+	{
+		const FrameArena& arena = *s_registry.Arenas[i];
+		s << L"Thread " << i + 1 << L": " << arena.getLastFramePeak() / 1024 << L", " << arena.getPeakBytes() / 1024
+		  << L", " << arena.getCapacity() / 1024 << endl;
+	}
+}
+
+void* FrameArena::Allocate(size_t bytes, size_t alignment /* = ALIGNMENT */)
+{
+	size_t start = m_blocks.empty() ? 0 : AlignedOffset(m_blocks[m_current].Memory.get(), m_offset, alignment);
+	if (m_blocks.empty() || start > m_blocks[m_current].Size || bytes > m_blocks[m_current].Size - start)
+	{
+		if (bytes > static_cast<size_t>(-1) - alignment)
+			throw bad_alloc();
+		size_t needed = bytes + alignment - 1;
+		if (!m_blocks.empty())
+		{
+			m_blocks[m_current].Offset = m_offset;
+			++m_current;
+		}
+		//Blocks left after a rewind are reused if they are large enough
+		if (m_current == m_blocks.size() || m_blocks[m_current].Size < needed)
+			AddBlock(max(m_blockSize, needed));
+		m_offset = 0;
+		start = AlignedOffset(m_blocks[m_current].Memory.get(), 0, alignment);
+	}
+	m_used += start + bytes - m_offset;
+	m_offset = start + bytes;
+	m_framePeak = max(m_framePeak, m_used);
+	return m_blocks[m_current].Memory.get() + start;
+}
+
+FrameArena::Marker FrameArena::getMarker() const
+{
+	Marker marker = { m_current, m_offset, m_used };
+	return marker;
+}
+
+void FrameArena::Rewind(const Marker& marker)
+{
+	if (m_poisoning)
+		Poison(marker);
+	m_current = marker.Block;
+	m_offset = marker.Offset;
+	m_used = marker.Used;
+	//Loader threads only ever rewind scopes, so their peak is kept here and not in Reset
+	m_peak.store(max(m_peak.load(memory_order_relaxed), m_framePeak), memory_order_relaxed);
+}
+
+void FrameArena::Reset()
+{
+	Marker start = { 0, 0, 0 };
+	Rewind(start);
+	m_lastFramePeak.store(m_framePeak, memory_order_relaxed);
+	m_framePeak = 0;
+	if (m_blocks.size() > 1)
+	{
+		//The frame didn't fit into one block, the next ones will
+		size_t capacity = m_capacity.load(memory_order_relaxed);
+		m_blocks.clear();
+		m_capacity.store(0, memory_order_relaxed);
+		AddBlock(capacity);
+	}
+}
+
+void FrameArena::AddBlock(size_t size)
+{
+	Block block;
+	block.Memory.reset(new unsigned char[size], default_delete<unsigned char[]>());
+	block.Size = size;
+	block.Offset = 0;
+	m_blocks.insert(m_blocks.begin() + min(m_current, m_blocks.size()), block);
+	m_capacity.store(m_capacity.load(memory_order_relaxed) + size, memory_order_relaxed);
+}
+
+void FrameArena::Poison(const Marker& marker)
+{
+	if (m_blocks.empty())
+		return;
+	for (size_t i = marker.Block; i <= m_current; ++i)
+	{
+		size_t begin = i == marker.Block ? marker.Offset : 0;
+		size_t end = i == m_current ? m_offset : m_blocks[i].Offset;
+		if (end > begin)
+			memset(m_blocks[i].Memory.get() + begin, POISON, end - begin);
+	}
+}
@@ -0,0 +1,925 @@
+#include "gk2_imageDecoder.h"
+#include "gk2_pngWriter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ios>
+
+using namespace std;
+using namespace gk2;
+
+namespace
+{
+	const BYTE PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+	//Deflate
+
+	const unsigned int LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59,
+										   67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const unsigned int LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4,
+											5, 5, 5, 5, 0 };
+	const unsigned int DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513,
+											 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const unsigned int DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10,
+											  11, 11, 12, 12, 13, 13 };
+	//Order in which the lengths of the code length alphabet are stored
+	const unsigned int CODE_LENGTH_ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	void Fail(const char* message)
+	{
+		throw ios_base::failure(message);
+	}
+
+	//Deflate packs bits starting from the least significant one
+	class InflateBits
+	{
+	public:
+		InflateBits(const BYTE* data, size_t size) : m_data(data), m_size(size), m_position(0), m_bits(0), m_count(0)
+		{ }
+
+		unsigned int Read(unsigned int count)
+		{
+			while (m_count < count)
+			{
+				if (m_position == m_size)
+					Fail("Deflate stream is truncated");
+				m_bits |= static_cast<unsigned int>(m_data[m_position++]) << m_count;
+				m_count += 8;
+			}
+			unsigned int value = m_bits & ((1u << count) - 1);
+			m_bits = count < 32 ? m_bits >> count : 0;
+			m_count -= count;
+			return value;
+		}
+
+		//Stored blocks start at a byte boundary
+		void AlignToByte()
+		{
+			m_bits = 0;
+			m_count = 0;
+		}
+
+		size_t getPosition() const { return m_position; }
+		void Skip(size_t count) { m_position += count; }
+		const BYTE* getData() const { return m_data; }
+		size_t getSize() const { return m_size; }
+
+	private:
+		const BYTE* m_data;
+		size_t m_size;
+		size_t m_position;
+		unsigned int m_bits;
+		unsigned int m_count;
+	};
+
+	//Canonical Huffman code decoded one bit at a time, symbols sorted by the code length
+	struct InflateCode
+	{
+		unsigned short Counts[16];
+		unsigned short Symbols[288];
+
+		void Build(const unsigned char* lengths, unsigned int count)
+		{
+			memset(Counts, 0, sizeof(Counts));
+			for (unsigned int i = 0; i < count; ++i)
+				++Counts[lengths[i]];
+			Counts[0] = 0;
+			unsigned short offsets[16];
+			offsets[1] = 0;
+			for (unsigned int i = 1; i < 15; ++i)
+				offsets[i + 1] = offsets[i] + Counts[i];
+			for (unsigned int i = 0; i < count; ++i)
+				if (lengths[i])
+					Symbols[offsets[lengths[i]]++] = static_cast<unsigned short>(i);
+		}
+
+		unsigned int Decode(InflateBits& bits) const
+		{
+			int code = 0;
+			int first = 0;
+			int index = 0;
+			for (unsigned int length = 1; length < 16; ++length)
+			{
+				code |= static_cast<int>(bits.Read(1));
+				int count = Counts[length];
+				if (code - count < first)
+					return Symbols[index + code - first];
+				index += count;
+				first = (first + count) << 1;
+				code <<= 1;
+			}
+			Fail("Invalid deflate code");
+			return 0;
+		}
+	};
+
+	void InflateBlock(InflateBits& bits, const InflateCode& literals, const InflateCode& distances,
+					  vector<BYTE>& output)
+	{
+		for (;;)
+		{
+			unsigned int symbol = literals.Decode(bits);
+			if (symbol < 256)
+			{
+				output.push_back(static_cast<BYTE>(symbol));
+				continue;
+			}
+			if (symbol == 256)
+				return;
+			symbol -= 257;
+			if (symbol >= 29)
+				Fail("Invalid deflate length");
+			unsigned int length = LENGTH_BASE[symbol] + bits.Read(LENGTH_EXTRA[symbol]);
+			unsigned int code = distances.Decode(bits);
+			if (code >= 30)
+				Fail("Invalid deflate distance");
+			size_t distance = DISTANCE_BASE[code] + bits.Read(DISTANCE_EXTRA[code]);
+			if (distance > output.size())
+				Fail("Deflate distance is too far back");
+			size_t from = output.size() - distance;
+			for (unsigned int i = 0; i < length; ++i)
+				output.push_back(output[from + i]);
+		}
+	}
+
+	//PNG
+
+	unsigned int ReadBigEndian(const BYTE* data)
+	{
+		return (static_cast<unsigned int>(data[0]) << 24) | (static_cast<unsigned int>(data[1]) << 16) |
+			   (static_cast<unsigned int>(data[2]) << 8) | data[3];
+	}
+
+	BYTE Paeth(BYTE a, BYTE b, BYTE c)
+	{
+		int p = a + b - c;
+		int pa = abs(p - a);
+		int pb = abs(p - b);
+		int pc = abs(p - c);
+		if (pa <= pb && pa <= pc)
+			return a;
+		return pb <= pc ? b : c;
+	}
+
+	//JPEG
+
+	const unsigned int ZIGZAG[64] = { 0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5, 12, 19, 26, 33, 40, 48,
+									  41, 34, 27, 20, 13, 6, 7, 14, 21, 28, 35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15,
+									  23, 30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62,
+									  63 };
+	//Codes up to this length are decoded with a single table lookup
+	const unsigned int JPEG_LOOKUP_BITS = 9;
+
+	struct JpegCode
+	{
+		//Length in the high byte and the symbol in the low one, zero if the code is longer
+		unsigned short Lookup[1 << JPEG_LOOKUP_BITS];
+		//Largest code of each length, -1 if there are none
+		int MaxCode[18];
+		int ValueOffset[17];
+		BYTE Symbols[256];
+		bool Defined;
+
+		JpegCode() : Defined(false) { }
+
+		void Build(const BYTE* counts, const BYTE* symbols, unsigned int symbolsCount)
+		{
+			memcpy(Symbols, symbols, symbolsCount);
+			memset(Lookup, 0, sizeof(Lookup));
+			int code = 0;
+			unsigned int k = 0;
+			for (unsigned int length = 1; length <= 16; ++length)
+			{
+				ValueOffset[length] = static_cast<int>(k) - code;
+				for (unsigned int i = 0; i < counts[length - 1]; ++i, ++k, ++code)
+				{
+					if (length > JPEG_LOOKUP_BITS)
+						continue;
+					unsigned int shift = JPEG_LOOKUP_BITS - length;
+					for (unsigned int j = 0; j < (1u << shift); ++j)
+						Lookup[(code << shift) | j] = static_cast<unsigned short>((length << 8) | symbols[k]);
+				}
+				MaxCode[length] = counts[length - 1] ? code - 1 : -1;
+				code <<= 1;
+			}
+			MaxCode[17] = 0x7fffffff;
+			Defined = true;
+		}
+	};
+
+	struct JpegComponent
+	{
+		unsigned int Id;
+		unsigned int H;
+		unsigned int V;
+		unsigned int QuantTable;
+		unsigned int DcTable;
+		unsigned int AcTable;
+		int DcPrediction;
+		//Blocks covering the component, padded to whole MCUs
+		unsigned int BlocksX;
+		unsigned int BlocksY;
+		unsigned int Stride;
+		vector<BYTE> Pixels;
+	};
+
+	//Entropy coded data reads bits from the most significant one. Stuffed zero bytes after 0xff are dropped, at
+	//a marker the reader returns zeros and stops until it's reset by the restart.
+	class JpegBits
+	{
+	public:
+		JpegBits(const BYTE* data, size_t size, size_t position)
+			: m_data(data), m_size(size), m_position(position), m_bits(0), m_count(0), m_marker(false)
+		{ }
+
+		unsigned int Peek(unsigned int count)
+		{
+			Fill(count);
+			return (m_bits >> (m_count - count)) & ((1u << count) - 1);
+		}
+
+		void Skip(unsigned int count) { m_count -= count; }
+
+		unsigned int Read(unsigned int count)
+		{
+			if (!count)
+				return 0;
+			unsigned int value = Peek(count);
+			Skip(count);
+			return value;
+		}
+
+		//Value of a coefficient with the given number of bits, negative ones have the leading bit cleared
+		int ReadSigned(unsigned int count)
+		{
+			if (!count)
+				return 0;
+			int value = static_cast<int>(Read(count));
+			return value < (1 << (count - 1)) ? value - (1 << count) + 1 : value;
+		}
+
+		unsigned int Decode(const JpegCode& code)
+		{
+			unsigned int entry = code.Lookup[Peek(JPEG_LOOKUP_BITS)];
+			if (entry)
+			{
+				Skip(entry >> 8);
+				return entry & 0xff;
+			}
+			unsigned int length = JPEG_LOOKUP_BITS + 1;
+			int value = static_cast<int>(Peek(length));
+			while (length <= 16 && value > code.MaxCode[length])
+			{
+				++length;
+				value = static_cast<int>(Peek(length));
+			}
+			if (length > 16)
+				Fail("Invalid JPEG Huffman code");
+			Skip(length);
+			return code.Symbols[code.ValueOffset[length] + value];
+		}
+
+		//Skips the RSTn marker ending a restart interval
+		void Restart()
+		{
+			m_bits = 0;
+			m_count = 0;
+			m_marker = false;
+			if (m_position + 1 < m_size && m_data[m_position] == 0xff && m_data[m_position + 1] >= 0xd0 &&
+				m_data[m_position + 1] <= 0xd7)
+				m_position += 2;
+			else
+				Fail("JPEG restart marker is missing");
+		}
+
+		//Position of the first marker after the entropy coded data
+		size_t End()
+		{
+			while (!m_marker && m_position < m_size)
+				Fill(25);
+			return m_position;
+		}
+
+	private:
+		const BYTE* m_data;
+		size_t m_size;
+		size_t m_position;
+		unsigned int m_bits;
+		unsigned int m_count;
+		bool m_marker;
+
+		void Fill(unsigned int count)
+		{
+			while (m_count < count)
+			{
+				unsigned int byte = 0;
+				if (!m_marker && m_position < m_size)
+				{
+					byte = m_data[m_position];
+					if (byte == 0xff)
+					{
+						BYTE next = m_position + 1 < m_size ? m_data[m_position + 1] : 0xd9;
+						if (next == 0)
+							m_position += 2;
+						else
+						{
+							m_marker = true;
+							byte = 0;
+						}
+					}
+					else
+						++m_position;
+				}
+				m_bits = (m_bits << 8) | byte;
+				m_count += 8;
+			}
+		}
+	};
+
+	//cos((2x + 1) * u * pi / 16) scaled by the normalization of u, for the separable inverse DCT
+	struct IdctTable
+	{
+		float Values[8][8];
+
+		IdctTable()
+		{
+			for (unsigned int x = 0; x < 8; ++x)
+				for (unsigned int u = 0; u < 8; ++u)
+					Values[x][u] = (u ? 0.5f : 0.5f / sqrtf(2.0f)) *
+								   cosf((2 * x + 1) * u * 3.14159265f / 16.0f);
+		}
+	};
+
+	const IdctTable IDCT_TABLE;
+
+	void InverseDct(const int* coefficients, BYTE* output, unsigned int stride)
+	{
+		float rows[64];
+		for (unsigned int v = 0; v < 8; ++v)
+			for (unsigned int x = 0; x < 8; ++x)
+			{
+				float sum = 0.0f;
+				for (unsigned int u = 0; u < 8; ++u)
+					sum += IDCT_TABLE.Values[x][u] * coefficients[v * 8 + u];
+				rows[v * 8 + x] = sum;
+			}
+		for (unsigned int y = 0; y < 8; ++y)
+			for (unsigned int x = 0; x < 8; ++x)
+			{
+				float sum = 128.0f;
+				for (unsigned int v = 0; v < 8; ++v)
+					sum += IDCT_TABLE.Values[y][v] * rows[v * 8 + x];
+				int value = static_cast<int>(floorf(sum + 0.5f));
+				output[y * stride + x] = static_cast<BYTE>(value < 0 ? 0 : (value > 255 ? 255 : value));
+			}
+	}
+
+	BYTE ClampByte(float value)
+	{
+		int v = static_cast<int>(floorf(value + 0.5f));
+		return static_cast<BYTE>(v < 0 ? 0 : (v > 255 ? 255 : v));
+	}
+
+	//Bilinear sample of a subsampled component at the center of an image pixel
+	float SampleComponent(const JpegComponent& c, unsigned int x, unsigned int y, unsigned int maxH,
+						  unsigned int maxV, unsigned int width, unsigned int height)
+	{
+		if (c.H == maxH && c.V == maxV)
+			return c.Pixels[y * c.Stride + x];
+		unsigned int w = (width * c.H + maxH - 1) / maxH;
+		unsigned int h = (height * c.V + maxV - 1) / maxV;
+		float fx = (x + 0.5f) * c.H / maxH - 0.5f;
+		float fy = (y + 0.5f) * c.V / maxV - 0.5f;
+		fx = max(0.0f, min(fx, static_cast<float>(w - 1)));
+		fy = max(0.0f, min(fy, static_cast<float>(h - 1)));
+		unsigned int x0 = static_cast<unsigned int>(fx);
+		unsigned int y0 = static_cast<unsigned int>(fy);
+		unsigned int x1 = min(x0 + 1, w - 1);
+		unsigned int y1 = min(y0 + 1, h - 1);
+		float tx = fx - x0;
+		float ty = fy - y0;
+		const BYTE* row0 = &c.Pixels[y0 * c.Stride];
+		const BYTE* row1 = &c.Pixels[y1 * c.Stride];
+		float top = row0[x0] + (row0[x1] - row0[x0]) * tx;
+		float bottom = row1[x0] + (row1[x1] - row1[x0]) * tx;
+		return top + (bottom - top) * ty;
+	}
+}
+
+bool ImageDecoder::IsPng(const BYTE* data, size_t size)
+{
+	return size >= sizeof(PNG_SIGNATURE) && memcmp(data, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) == 0;
+}
+
+bool ImageDecoder::IsJpeg(const BYTE* data, size_t size)
+{
+	return size >= 3 && data[0] == 0xff && data[1] == 0xd8 && data[2] == 0xff;
+}
+
+TextureCooker::Image ImageDecoder::Decode(const vector<BYTE>& fileData)
+{
+	return Decode(fileData.data(), fileData.size());
+}
+
+TextureCooker::Image ImageDecoder::Decode(const BYTE* data, size_t size)
+{
+	if (IsPng(data, size))
+		return DecodePng(data, size);
+	if (IsJpeg(data, size))
+		return DecodeJpeg(data, size);
+	Fail("Unsupported image format");
+	return TextureCooker::Image();
+}
+
+vector<BYTE> ImageDecoder::Inflate(const BYTE* data, size_t size)
+{
+	if (size < 6 || (data[0] & 0x0f) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20))
+		Fail("Invalid zlib header");
+	InflateBits bits(data + 2, size - 2);
+	vector<BYTE> output;
+	bool last;
+	do
+	{
+		last = bits.Read(1) != 0;
+		unsigned int type = bits.Read(2);
+		if (type == 0)
+		{
+			bits.AlignToByte();
+			size_t position = bits.getPosition();
+			if (position + 4 > bits.getSize())
+				Fail("Deflate stream is truncated");
+			const BYTE* header = bits.getData() + position;
+			unsigned int length = header[0] | (header[1] << 8);
+			if ((length ^ 0xffff) != static_cast<unsigned int>(header[2] | (header[3] << 8)))
+				Fail("Invalid stored deflate block");
+			if (position + 4 + length > bits.getSize())
+				Fail("Deflate stream is truncated");
+			output.insert(output.end(), header + 4, header + 4 + length);
+			bits.Skip(4 + length);
+		}
+		else if (type == 1)
+		{
+			unsigned char lengths[288];
+			memset(lengths, 8, 144);
+			memset(lengths + 144, 9, 112);
+			memset(lengths + 256, 7, 24);
+			memset(lengths + 280, 8, 8);
+			InflateCode literals, distances;
+			literals.Build(lengths, 288);
+			memset(lengths, 5, 30);
+			distances.Build(lengths, 30);
+			InflateBlock(bits, literals, distances, output);
+		}
+		else if (type == 2)
+		{
+			unsigned int literalsCount = bits.Read(5) + 257;
+			unsigned int distancesCount = bits.Read(5) + 1;
+			unsigned int codeLengthsCount = bits.Read(4) + 4;
+			unsigned char lengths[320];
+			memset(lengths, 0, 19);
+			for (unsigned int i = 0; i < codeLengthsCount; ++i)
+				lengths[CODE_LENGTH_ORDER[i]] = static_cast<unsigned char>(bits.Read(3));
+			InflateCode codeLengths;
+			codeLengths.Build(lengths, 19);
+			unsigned int count = 0;
+			while (count < literalsCount + distancesCount)
+			{
+				unsigned int symbol = codeLengths.Decode(bits);
+				if (symbol < 16)
+				{
+					lengths[count++] = static_cast<unsigned char>(symbol);
+					continue;
+				}
+				unsigned char value = 0;
+				unsigned int repeat;
+				if (symbol == 16)
+				{
+					if (!count)
+						Fail("Invalid deflate code lengths");
+					value = lengths[count - 1];
+					repeat = 3 + bits.Read(2);
+				}
+				else if (symbol == 17)
+					repeat = 3 + bits.Read(3);
+				else
+					repeat = 11 + bits.Read(7);
+				if (count + repeat > literalsCount + distancesCount)
+					Fail("Invalid deflate code lengths");
+				memset(lengths + count, value, repeat);
+				count += repeat;
+			}
+			InflateCode literals, distances;
+			literals.Build(lengths, literalsCount);
+			distances.Build(lengths + literalsCount, distancesCount);
+			InflateBlock(bits, literals, distances, output);
+		}
+		else
+			Fail("Invalid deflate block type");
+	} while (!last);
+	bits.AlignToByte();
+	size_t position = bits.getPosition();
+	if (position + 4 > bits.getSize())
+		Fail("zlib checksum is missing");
+	if (ReadBigEndian(bits.getData() + position) != PngWriter::Adler32(output.data(), output.size()))
+		Fail("zlib checksum doesn't match");
+	return output;
+}
+
+TextureCooker::Image ImageDecoder::DecodePng(const BYTE* data, size_t size)
+{
+	if (!IsPng(data, size))
+		Fail("Not a PNG file");
+	unsigned int width = 0, height = 0, depth = 0, colorType = 0;
+	vector<BYTE> compressed;
+	BYTE palette[256][4];
+	unsigned int paletteSize = 0;
+	//Color of transparent pixels of gray and RGB images, in the file's bit depth
+	unsigned int transparent[3] = { 0, 0, 0 };
+	bool hasTransparent = false;
+	size_t position = sizeof(PNG_SIGNATURE);
+	for (;;)
+	{
+		if (position + 12 > size)
+			Fail("PNG file is truncated");
+		unsigned int length = ReadBigEndian(data + position);
+		const BYTE* type = data + position + 4;
+		const BYTE* chunk = type + 4;
+		if (length > size - position - 12)
+			Fail("PNG file is truncated");
+		if (ReadBigEndian(chunk + length) != PngWriter::Crc32(type, length + 4))
+			Fail("PNG chunk checksum doesn't match");
+		if (memcmp(type, "IHDR", 4) == 0)
+		{
+			if (length < 13)
+				Fail("Invalid PNG header");
+			width = ReadBigEndian(chunk);
+			height = ReadBigEndian(chunk + 4);
+			depth = chunk[8];
+			colorType = chunk[9];
+			if (chunk[12] != 0)
+				Fail("Interlaced PNG files are not supported");
+			if (!width || !height || (depth != 1 && depth != 2 && depth != 4 && depth != 8 && depth != 16) ||
+				colorType == 1 || colorType == 5 || colorType > 6)
+				Fail("Invalid PNG header");
+		}
+		else if (memcmp(type, "PLTE", 4) == 0)
+		{
+			paletteSize = min(length / 3, 256u);
+			for (unsigned int i = 0; i < paletteSize; ++i)
+			{
+				memcpy(palette[i], chunk + 3 * i, 3);
+				palette[i][3] = 255;
+			}
+		}
+		else if (memcmp(type, "tRNS", 4) == 0)
+		{
+			if (colorType == 3)
+			{
+				for (unsigned int i = 0; i < length && i < 256; ++i)
+					palette[i][3] = chunk[i];
+			}
+			else if (length >= 2)
+			{
+				hasTransparent = true;
+				for (unsigned int i = 0; i < 3 && 2 * i + 1 < length; ++i)
+					transparent[i] = (chunk[2 * i] << 8) | chunk[2 * i + 1];
+			}
+		}
+		else if (memcmp(type, "IDAT", 4) == 0)
+			compressed.insert(compressed.end(), chunk, chunk + length);
+		else if (memcmp(type, "IEND", 4) == 0)
+			break;
+		position += 12 + length;
+	}
+	if (!width)
+		Fail("PNG header is missing");
+	if (colorType == 3 && !paletteSize)
+		Fail("PNG palette is missing");
+
+	static const unsigned int CHANNELS[7] = { 1, 0, 3, 1, 2, 0, 4 };
+	unsigned int channels = CHANNELS[colorType];
+	unsigned int bitsPerPixel = channels * depth;
+	unsigned int pixelBytes = max(1u, bitsPerPixel / 8);
+	size_t rowBytes = (static_cast<size_t>(width) * bitsPerPixel + 7) / 8;
+	vector<BYTE> raw = Inflate(compressed.data(), compressed.size());
+	if (raw.size() < (rowBytes + 1) * height)
+		Fail("PNG image data is truncated");
+
+	//Filters are undone in place, the previous row is already unfiltered
+	vector<BYTE> zero(rowBytes, 0);
+	for (unsigned int y = 0; y < height; ++y)
+	{
+		BYTE* row = &raw[y * (rowBytes + 1)];
+		BYTE filter = row[0];
+		++row;
+		const BYTE* previous = y ? row - rowBytes - 1 : zero.data();
+		for (size_t i = 0; i < rowBytes; ++i)
+		{
+			BYTE left = i >= pixelBytes ? row[i - pixelBytes] : 0;
+			BYTE upLeft = i >= pixelBytes ? previous[i - pixelBytes] : 0;
+			switch (filter)
+			{
+			case 0:
+				break;
+			case 1:
+				row[i] = static_cast<BYTE>(row[i] + left);
+				break;
+			case 2:
+				row[i] = static_cast<BYTE>(row[i] + previous[i]);
+				break;
+			case 3:
+				row[i] = static_cast<BYTE>(row[i] + ((left + previous[i]) >> 1));
+				break;
+			case 4:
+				row[i] = static_cast<BYTE>(row[i] + Paeth(left, previous[i], upLeft));
+				break;
+			default:
+				Fail("Invalid PNG filter");
+			}
+		}
+	}
+
+	TextureCooker::Image image;
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.resize(static_cast<size_t>(width) * height * 4);
+	unsigned int maxValue = (1u << depth) - 1;
+	for (unsigned int y = 0; y < height; ++y)
+	{
+		const BYTE* row = &raw[y * (rowBytes + 1) + 1];
+		BYTE* out = &image.Pixels[static_cast<size_t>(y) * width * 4];
+		for (unsigned int x = 0; x < width; ++x, out += 4)
+		{
+			//Samples of the pixel in the file's bit depth
+			unsigned int samples[4];
+			for (unsigned int c = 0; c < channels; ++c)
+			{
+				if (depth == 16)
+				{
+					const BYTE* s = row + (x * channels + c) * 2;
+					samples[c] = (s[0] << 8) | s[1];
+				}
+				else if (depth == 8)
+					samples[c] = row[x * channels + c];
+				else
+				{
+					size_t bit = static_cast<size_t>(x) * depth;
+					samples[c] = (row[bit / 8] >> (8 - depth - bit % 8)) & maxValue;
+				}
+			}
+			if (colorType == 3)
+			{
+				if (samples[0] >= paletteSize)
+					Fail("PNG palette index is out of range");
+				memcpy(out, palette[samples[0]], 4);
+				continue;
+			}
+			BYTE scaled[4];
+			for (unsigned int c = 0; c < channels; ++c)
+				scaled[c] = static_cast<BYTE>(depth == 16 ? samples[c] >> 8 : samples[c] * 255 / maxValue);
+			bool gray = colorType == 0 || colorType == 4;
+			out[0] = scaled[0];
+			out[1] = gray ? scaled[0] : scaled[1];
+			out[2] = gray ? scaled[0] : scaled[2];
+			out[3] = colorType == 4 ? scaled[1] : (colorType == 6 ? scaled[3] : 255);
+			if (hasTransparent && samples[0] == transparent[0] &&
+				(gray || (samples[1] == transparent[1] && samples[2] == transparent[2])))
+				out[3] = 0;
+		}
+	}
+	return image;
+}
+
+TextureCooker::Image ImageDecoder::DecodeJpeg(const BYTE* data, size_t size)
+{
+	if (!IsJpeg(data, size))
+		Fail("Not a JPEG file");
+	unsigned short quantTables[4][64];
+	JpegCode dcCodes[4], acCodes[4];
+	vector<JpegComponent> components;
+	unsigned int width = 0, height = 0, maxH = 1, maxV = 1, mcusX = 0, mcusY = 0;
+	unsigned int restartInterval = 0;
+	bool done = false;
+	size_t position = 2;
+	while (!done)
+	{
+		while (position < size && data[position] == 0xff && position + 1 < size && data[position + 1] == 0xff)
+			++position;
+		if (position + 4 > size || data[position] != 0xff)
+			Fail("Invalid JPEG marker");
+		BYTE marker = data[position + 1];
+		if (marker == 0xd9)
+			break;
+		unsigned int length = (data[position + 2] << 8) | data[position + 3];
+		const BYTE* segment = data + position + 4;
+		if (length < 2 || position + 2 + length > size)
+			Fail("JPEG file is truncated");
+		size_t segmentEnd = position + 2 + length;
+		switch (marker)
+		{
+		case 0xc0:
+		case 0xc1:
+		{
+			if (segment[0] != 8)
+				Fail("Only 8 bit JPEG files are supported");
+			height = (segment[1] << 8) | segment[2];
+			width = (segment[3] << 8) | segment[4];
+			unsigned int count = segment[5];
+			if (!width || !height || (count != 1 && count != 3) || length < 8 + 3 * count)
+				Fail("Unsupported JPEG frame");
+			components.resize(count);
+			for (unsigned int i = 0; i < count; ++i)
+			{
+				JpegComponent& c = components[i];
+				c.Id = segment[6 + 3 * i];
+				c.H = segment[7 + 3 * i] >> 4;
+				c.V = segment[7 + 3 * i] & 15;
+				c.QuantTable = segment[8 + 3 * i] & 3;
+				if (c.H < 1 || c.H > 4 || c.V < 1 || c.V > 4)
+					Fail("Invalid JPEG sampling factors");
+				maxH = max(maxH, c.H);
+				maxV = max(maxV, c.V);
+			}
+			mcusX = (width + 8 * maxH - 1) / (8 * maxH);
+			mcusY = (height + 8 * maxV - 1) / (8 * maxV);
+			for (unsigned int i = 0; i < count; ++i)
+			{
+				JpegComponent& c = components[i];
+				c.BlocksX = mcusX * c.H;
+				c.BlocksY = mcusY * c.V;
+				c.Stride = c.BlocksX * 8;
+				c.Pixels.assign(static_cast<size_t>(c.Stride) * c.BlocksY * 8, 0);
+			}
+			break;
+		}
+		case 0xc4:
+		{
+			const BYTE* p = segment;
+			const BYTE* end = data + segmentEnd;
+			while (p + 17 <= end)
+			{
+				unsigned int tableClass = p[0] >> 4;
+				unsigned int index = p[0] & 3;
+				unsigned int total = 0;
+				for (unsigned int i = 0; i < 16; ++i)
+					total += p[1 + i];
+				if (total > 256 || p + 17 + total > end)
+					Fail("Invalid JPEG Huffman table");
+				(tableClass ? acCodes : dcCodes)[index].Build(p + 1, p + 17, total);
+				p += 17 + total;
+			}
+			break;
+		}
+		case 0xdb:
+		{
+			const BYTE* p = segment;
+			const BYTE* end = data + segmentEnd;
+			while (p < end)
+			{
+				unsigned int precision = p[0] >> 4;
+				unsigned int index = p[0] & 3;
+				if (p + 1 + 64 * (precision + 1) > end)
+					Fail("Invalid JPEG quantization table");
+				for (unsigned int i = 0; i < 64; ++i)
+					quantTables[index][ZIGZAG[i]] = precision ? (p[1 + 2 * i] << 8) | p[2 + 2 * i] : p[1 + i];
+				p += 1 + 64 * (precision + 1);
+			}
+			break;
+		}
+		case 0xdd:
+			restartInterval = (segment[0] << 8) | segment[1];
+			break;
+		case 0xda:
+		{
+			if (components.empty())
+				Fail("JPEG frame header is missing");
+			unsigned int count = segment[0];
+			vector<JpegComponent*> scan;
+			for (unsigned int i = 0; i < count; ++i)
+			{
+				unsigned int id = segment[1 + 2 * i];
+				JpegComponent* c = nullptr;
+				for (size_t k = 0; k < components.size(); ++k)
+					if (components[k].Id == id)
+						c = &components[k];
+				if (!c)
+					Fail("Invalid JPEG scan component");
+				c->DcTable = segment[2 + 2 * i] >> 4;
+				c->AcTable = segment[2 + 2 * i] & 3;
+				c->DcPrediction = 0;
+				if (!dcCodes[c->DcTable & 3].Defined || !acCodes[c->AcTable].Defined)
+					Fail("JPEG Huffman table is missing");
+				scan.push_back(c);
+			}
+			//A scan of a single component covers only its own blocks, not whole MCUs
+			unsigned int unitsX = mcusX, unitsY = mcusY;
+			if (count == 1)
+			{
+				unitsX = (width * scan[0]->H / maxH + 7) / 8;
+				unitsY = (height * scan[0]->V / maxV + 7) / 8;
+			}
+			JpegBits bits(data, size, segmentEnd);
+			int coefficients[64];
+			unsigned int units = unitsX * unitsY;
+			for (unsigned int unit = 0; unit < units; ++unit)
+			{
+				if (restartInterval && unit && unit % restartInterval == 0)
+				{
+					bits.End();
+					bits.Restart();
+					for (size_t i = 0; i < scan.size(); ++i)
+						scan[i]->DcPrediction = 0;
+				}
+				unsigned int ux = unit % unitsX, uy = unit / unitsX;
+				for (size_t i = 0; i < scan.size(); ++i)
+				{
+					JpegComponent& c = *scan[i];
+					unsigned int blocksH = count == 1 ? 1 : c.H;
+					unsigned int blocksV = count == 1 ? 1 : c.V;
+					const unsigned short* quant = quantTables[c.QuantTable];
+					for (unsigned int by = 0; by < blocksV; ++by)
+						for (unsigned int bx = 0; bx < blocksH; ++bx)
+						{
+							memset(coefficients, 0, sizeof(coefficients));
+							unsigned int category = bits.Decode(dcCodes[c.DcTable & 3]);
+							if (category > 11)
+								Fail("Invalid JPEG DC coefficient");
+							c.DcPrediction += bits.ReadSigned(category);
+							coefficients[0] = c.DcPrediction * quant[0];
+							for (unsigned int k = 1; k < 64;)
+							{
+								unsigned int symbol = bits.Decode(acCodes[c.AcTable]);
+								unsigned int run = symbol >> 4, bitsCount = symbol & 15;
+								if (!bitsCount)
+								{
+									if (run != 15)
+										break;
+									k += 16;
+									continue;
+								}
+								k += run;
+								if (k > 63)
+									Fail("Invalid JPEG AC coefficient");
+								unsigned int index = ZIGZAG[k++];
+								coefficients[index] = bits.ReadSigned(bitsCount) * quant[index];
+							}
+							unsigned int blockX = ux * blocksH + bx, blockY = uy * blocksV + by;
+							InverseDct(coefficients, &c.Pixels[(blockY * 8) * c.Stride + blockX * 8], c.Stride);
+						}
+				}
+			}
+			segmentEnd = bits.End();
+			//Baseline files hold all the components in a single scan or one component per scan
+			done = true;
+			for (size_t i = 0; i < components.size(); ++i)
+				done &= components[i].DcTable != 0xff;
+			break;
+		}
+		case 0xc2:
+		case 0xc3:
+		case 0xc5:
+		case 0xc6:
+		case 0xc7:
+		case 0xc9:
+		case 0xca:
+		case 0xcb:
+		case 0xcd:
+		case 0xce:
+		case 0xcf:
+			Fail("Only baseline JPEG files are supported");
+		default:
+			break;
+		}
+		if (marker == 0xc0 || marker == 0xc1)
+			for (size_t i = 0; i < components.size(); ++i)
+				components[i].DcTable = 0xff;
+		position = segmentEnd;
+	}
+	if (components.empty())
+		Fail("JPEG frame header is missing");
+
+	TextureCooker::Image image;
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.resize(static_cast<size_t>(width) * height * 4);
+	for (unsigned int y = 0; y < height; ++y)
+	{
+		BYTE* out = &image.Pixels[static_cast<size_t>(y) * width * 4];
+		for (unsigned int x = 0; x < width; ++x, out += 4)
+		{
+			float luma = SampleComponent(components[0], x, y, maxH, maxV, width, height);
+			out[3] = 255;
+			if (components.size() == 1)
+			{
+				out[0] = out[1] = out[2] = ClampByte(luma);
+				continue;
+			}
+			float cb = SampleComponent(components[1], x, y, maxH, maxV, width, height) - 128.0f;
+			float cr = SampleComponent(components[2], x, y, maxH, maxV, width, height) - 128.0f;
+			out[0] = ClampByte(luma + 1.402f * cr);
+			out[1] = ClampByte(luma - 0.344136f * cb - 0.714136f * cr);
+			out[2] = ClampByte(luma + 1.772f * cb);
+		}
+	}
+	return image;
+}
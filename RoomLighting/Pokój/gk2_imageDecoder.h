@@ -0,0 +1,29 @@
+#ifndef __GK2_IMAGE_DECODER_H_
+#define __GK2_IMAGE_DECODER_H_
+
+#include "gk2_textureCooker.h"
+#include <vector>
+
+namespace gk2
+{
+	//Decodes PNG and baseline JPEG files into 8 bit RGBA images without external libraries or the device, so that
+	//textures can be decoded on loader threads. PNG files may use any color type and bit depth but no interlacing,
+	//JPEG files must be baseline with one (grayscale) or three (YCbCr) components. Chroma is upsampled bilinearly.
+	//Unsupported and corrupted files throw std::ios_base::failure.
+	class ImageDecoder
+	{
+	public:
+		//Format is recognized by the signature
+		static TextureCooker::Image Decode(const std::vector<BYTE>& fileData);
+		static TextureCooker::Image Decode(const BYTE* data, size_t size);
+		static bool IsPng(const BYTE* data, size_t size);
+		static bool IsJpeg(const BYTE* data, size_t size);
+
+		static TextureCooker::Image DecodePng(const BYTE* data, size_t size);
+		static TextureCooker::Image DecodeJpeg(const BYTE* data, size_t size);
+		//Decompresses a zlib stream, the checksum is verified
+		static std::vector<BYTE> Inflate(const BYTE* data, size_t size);
+	};
+}
+
+#endif __GK2_IMAGE_DECODER_H_
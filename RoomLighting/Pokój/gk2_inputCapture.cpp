@@ -0,0 +1,145 @@
+#include "gk2_inputCapture.h"
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+using namespace gk2;
+
+namespace
+{
+	const unsigned int VERSION = 1;
+	const unsigned char KEYBOARD_VALID = 1;
+	const unsigned char MOUSE_VALID = 2;
+
+	template<typename T>
+	void WriteValue(ostream& s, const T& value)
+	{
+		s.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template<typename T>
+	bool ReadValue(istream& s, T& value)
+	{
+		return static_cast<bool>(s.read(reinterpret_cast<char*>(&value), sizeof(T)));
+	}
+}
+
+const char InputCapture::MAGIC[4] = { 'G', 'K', '2', 'I' };
+
+InputCapture::InputCapture()
+	: m_mode(MODE_OFF), m_initialSeed(0), m_fixedDt(0.0f), m_framesCount(0)
+{
+
+}
+
+void InputCapture::StartRecording(const string& fileName, unsigned int initialSeed)
+{
+	Stop();
+	m_log.open(fileName, ios::binary);
+	if (!m_log)
+		throw runtime_error("Could not create " + fileName);
+	m_log.write(MAGIC, sizeof(MAGIC));
+	WriteValue(m_log, VERSION);
+	WriteValue(m_log, initialSeed);
+	m_mode = MODE_RECORD;
+	m_fileName = fileName;
+	m_initialSeed = initialSeed;
+	m_framesCount = 0;
+}
+
+void InputCapture::StartReplay(const string& fileName, float fixedDt /* = 0.0f */)
+{
+	Stop();
+	ifstream log(fileName, ios::binary);
+	if (!log)
+		throw runtime_error("Could not open " + fileName);
+	char magic[sizeof(MAGIC)];
+	unsigned int version, initialSeed;
+	if (!log.read(magic, sizeof(magic)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+		!ReadValue(log, version) || version != VERSION || !ReadValue(log, initialSeed))
+		throw runtime_error(fileName + " is not an input capture");
+	//Read up front, so that the replay doesn't wait for the disk
+	Frame frame;
+	while (ReadFrame(log, frame))
+		m_frames.push_back(frame);
+	if (!log.eof())
+		throw runtime_error("Could not read " + fileName);
+	m_mode = MODE_REPLAY;
+	m_fileName = fileName;
+	m_initialSeed = initialSeed;
+	m_fixedDt = fixedDt;
+	m_framesCount = 0;
+}
+
+void InputCapture::Stop()
+{
+	if (m_log.is_open())
+		m_log.close();
+	m_frames.clear();
+	m_mode = MODE_OFF;
+}
+
+void InputCapture::RecordFrame(const Frame& frame)
+{
+	if (m_mode != MODE_RECORD)
+		throw logic_error("Input is not being recorded");
+	WriteFrame(m_log, frame);
+	if (!m_log)
+		throw runtime_error("Could not write " + m_fileName);
+	++m_framesCount;
+}
+
+bool InputCapture::ReplayFrame(Frame& frame)
+{
+	if (m_mode != MODE_REPLAY)
+		throw logic_error("Input is not being replayed");
+	if (m_framesCount == m_frames.size())
+		return false;
+	frame = m_frames[m_framesCount++];
+	if (m_fixedDt > 0.0f)
+		frame.Dt = m_fixedDt;
+	return true;
+}
+
+void InputCapture::WriteFrame(ostream& s, const Frame& frame)
+{
+	WriteValue(s, frame.Dt);
+	WriteValue(s, frame.Seed);
+	unsigned char flags = (frame.KeyboardValid ? KEYBOARD_VALID : 0) | (frame.MouseValid ? MOUSE_VALID : 0);
+	WriteValue(s, flags);
+	if (frame.KeyboardValid)
+	{
+		unsigned char keys[KeyboardState::STATE_TAB_LENGTH];
+		unsigned short count = 0;
+		for (unsigned int i = 0; i < KeyboardState::STATE_TAB_LENGTH; ++i)
+			if (frame.Keyboard.isKeyDown(static_cast<BYTE>(i)))
+				keys[count++] = static_cast<unsigned char>(i);
+		WriteValue(s, count);
+		s.write(reinterpret_cast<const char*>(keys), count);
+	}
+	if (frame.MouseValid)
+		WriteValue(s, frame.Mouse.m_state);
+}
+
+bool InputCapture::ReadFrame(istream& s, Frame& frame)
+{
+	unsigned char flags;
+	if (!ReadValue(s, frame.Dt))
+		return false;
+	if (!ReadValue(s, frame.Seed) || !ReadValue(s, flags))
+		throw runtime_error("Input capture frame is truncated");
+	frame.KeyboardValid = (flags & KEYBOARD_VALID) != 0;
+	frame.MouseValid = (flags & MOUSE_VALID) != 0;
+	frame.Keyboard = KeyboardState();
+	frame.Mouse = MouseState();
+	unsigned short count = 0;
+	unsigned char keys[KeyboardState::STATE_TAB_LENGTH];
+	if (frame.KeyboardValid && (!ReadValue(s, count) || count > KeyboardState::STATE_TAB_LENGTH ||
+		!s.read(reinterpret_cast<char*>(keys), count)))
+		throw runtime_error("Input capture frame is truncated");
+	for (unsigned short i = 0; i < count; ++i)
+		frame.Keyboard.m_keys[keys[i]] = KeyboardState::KEY_MASK;
+	if (frame.MouseValid && !ReadValue(s, frame.Mouse.m_state))
+		throw runtime_error("Input capture frame is truncated");
+	return true;
+}
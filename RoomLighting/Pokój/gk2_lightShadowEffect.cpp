@@ -11,21 +11,12 @@ const float LightShadowEffect::LIGHT_NEAR = 0.35f;
 const float LightShadowEffect::LIGHT_FAR = 5.5f;
 const float LightShadowEffect::LIGHT_ANGLE = XM_PI/3.0f;
 
-void* LightShadowEffect::operator new(size_t size)
-{
-	return Utils::New16Aligned(size);
-}
-
-void LightShadowEffect::operator delete(void* ptr)
-{
-	Utils::Delete16Aligned(ptr);
-}
-
 LightShadowEffect::LightShadowEffect(DeviceHelper& device, shared_ptr<ID3D11InputLayout>& layout,
-						 shared_ptr<ID3D11DeviceContext> context /* = nullptr */)
+						 shared_ptr<RenderContext> context /* = nullptr */)
 	: EffectBase(context)
 {
 	Initialize(device, layout, ShaderFile);
+	InitializeInstancing(device, ShaderFile);
 	InitializeTextures(device);
 }
 
@@ -60,7 +51,7 @@ void LightShadowEffect::InitializeTextures(DeviceHelper& device)
 	m_shadowMapView = device.CreateShaderResourceView(m_shadowMap, srvDesc);
 }
 
-XMMATRIX LightShadowEffect::UpdateLight(float dt, shared_ptr<ID3D11DeviceContext> context)
+XMMATRIX LightShadowEffect::UpdateLight(float dt, shared_ptr<RenderContext> context)
 {
 	m_context = context;
 	static float time = 0;
@@ -86,7 +77,7 @@ XMMATRIX LightShadowEffect::UpdateLight(float dt, shared_ptr<ID3D11DeviceContext
 	return lamp;
 }
 
-void LightShadowEffect::SetupShadow(const shared_ptr<ID3D11DeviceContext>& context)
+void LightShadowEffect::SetupShadow(const shared_ptr<RenderContext>& context)
 {
 	if (context != nullptr && context != m_context)
 		m_context = context;
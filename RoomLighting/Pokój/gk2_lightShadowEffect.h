@@ -2,23 +2,21 @@
 #define __GK2_LIGHT_SHADOW_EFFECT_H_
 
 #include "gk2_effectBase.h"
+#include "gk2_aligned.h"
 
 namespace gk2
 {
-	class LightShadowEffect : public EffectBase
+	class LightShadowEffect : public EffectBase, public gk2::AlignedNew
 	{
 	public:
 		LightShadowEffect(gk2::DeviceHelper& device, std::shared_ptr<ID3D11InputLayout>& layout,
-					std::shared_ptr<ID3D11DeviceContext> context = nullptr);
-
-		static void* operator new(size_t size);
-		static void operator delete(void* ptr);
+					std::shared_ptr<gk2::RenderContext> context = nullptr);
 
 		void SetLightPosBuffer(const std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4>>& lightPos);
 		void SetSurfaceColorBuffer(const std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4>>& surfaceColor);
 
-		XMMATRIX UpdateLight(float dt, std::shared_ptr<ID3D11DeviceContext> context);
-		void SetupShadow(const std::shared_ptr<ID3D11DeviceContext>& context);
+		XMMATRIX UpdateLight(float dt, std::shared_ptr<gk2::RenderContext> context);
+		void SetupShadow(const std::shared_ptr<gk2::RenderContext>& context);
 		void EndShadow();
 
 	protected:
@@ -4,10 +4,13 @@
 #include <d3d11.h>
 #include <xnamath.h>
 #include <memory>
+#include "gk2_bounds.h"
+#include "gk2_renderContext.h"
+#include "gk2_aligned.h"
 
 namespace gk2
 {
-	class Mesh
+	class Mesh : public gk2::PoolNew<Mesh>
 	{
 	public:
 		Mesh(std::shared_ptr<ID3D11Buffer> vb, unsigned int stride,
@@ -17,19 +20,26 @@ namespace gk2
 
 		const XMMATRIX& getWorldMatrix() const { return m_worldMtx; }
 		void setWorldMatrix(const XMMATRIX& mtx) { m_worldMtx = mtx; }
-		void Render(const std::shared_ptr<ID3D11DeviceContext>& context);
+		const gk2::BoundingBox& getLocalBox() const { return m_localBox; }
+		const gk2::BoundingSphere& getLocalSphere() const { return m_localSphere; }
+		void setLocalBounds(const gk2::BoundingBox& box, const gk2::BoundingSphere& sphere);
+		gk2::BoundingBox getWorldBox() const { return m_localBox.Transform(m_worldMtx); }
+		gk2::BoundingSphere getWorldSphere() const { return m_localSphere.Transform(m_worldMtx); }
+		void Render(const std::shared_ptr<gk2::RenderContext>& context);
+		//Draws the mesh once for every gk2::InstanceWorld in the buffer, ignoring its own world matrix
+		void RenderInstanced(const std::shared_ptr<gk2::RenderContext>& context, ID3D11Buffer* instances,
+							 unsigned int instanceCount);
 
 		Mesh& operator =(const Mesh& right);
 
-		static void* operator new(size_t size);
-		static void operator delete(void* ptr);
-
 	private:
 		std::shared_ptr<ID3D11Buffer> m_vertexBuffer;
 		std::shared_ptr<ID3D11Buffer> m_indexBuffer;
 		unsigned int m_stride;
 		unsigned int m_indicesCount;
 		XMMATRIX m_worldMtx;
+		gk2::BoundingBox m_localBox;
+		gk2::BoundingSphere m_localSphere;
 	};
 }
 
@@ -1,4 +1,6 @@
 #include "gk2_particles.h"
+#include "gk2_profiler.h"
+#include "gk2_frameArena.h"
 #include <ctime>
 #include "gk2_exceptions.h"
 #include <vector>
@@ -46,7 +48,6 @@ const unsigned int ParticleSystem::OFFSET = 0;
 ParticleSystem::ParticleSystem(DeviceHelper& device, XMFLOAT3 emitterPos)
 	: m_particlesCount(0), m_particlesToCreate(0.0f), m_emitterPos(emitterPos)
 {
-	srand(static_cast<unsigned int>(time(0)));
 	m_vertices = device.CreateVertexBuffer<ParticleVertex>(MAX_PARTICLES, D3D11_USAGE_DYNAMIC);
 	shared_ptr<ID3DBlob> vsByteCode = device.CompileD3DShader(L"resources/shaders/Particles.hlsl", "VS_Main", "vs_4_0");
 	shared_ptr<ID3DBlob> gsByteCode = device.CompileD3DShader(L"resources/shaders/Particles.hlsl", "GS_Main", "gs_4_0");
@@ -134,11 +135,11 @@ void ParticleSystem::UpdateParticle(Particle& p, float dt)
 	p.Vertex.Angle += p.Velocities.AngleVelocity * dt;
 }
 
-void ParticleSystem::UpdateVertexBuffer(shared_ptr<ID3D11DeviceContext>& context, XMFLOAT4 cameraPos)
+void ParticleSystem::UpdateVertexBuffer(shared_ptr<RenderContext>& context, XMFLOAT4 cameraPos)
 {
-	vector<ParticleVertex> vertices(MAX_PARTICLES);
+	FrameVector<ParticleVertex> vertices(MAX_PARTICLES);
 	typedef std::list<Particle>::iterator list_it_t;
-	typedef std::vector<ParticleVertex>::iterator vect_it_t;
+	typedef FrameVector<ParticleVertex>::iterator vect_it_t;
 	vect_it_t vit = vertices.begin();
 	for (list_it_t lit = m_particles.begin(); lit != m_particles.end(); ++vit, ++lit)
 		*vit = lit->Vertex;
@@ -152,8 +153,9 @@ void ParticleSystem::UpdateVertexBuffer(shared_ptr<ID3D11DeviceContext>& context
 	context->Unmap(m_vertices.get(), 0);
 }
 
-void ParticleSystem::Update(shared_ptr<ID3D11DeviceContext>& context, float dt, XMFLOAT4 cameraPos)
+void ParticleSystem::Update(shared_ptr<RenderContext>& context, float dt, XMFLOAT4 cameraPos)
 {
+	PROFILE_ZONE("ParticleSystem::Update");
 	typedef std::list<Particle>::iterator list_it_t;
 	for (list_it_t it = m_particles.begin(); it != m_particles.end(); )
 	{
@@ -178,7 +180,7 @@ void ParticleSystem::Update(shared_ptr<ID3D11DeviceContext>& context, float dt,
 	UpdateVertexBuffer(context, cameraPos);
 }
 
-void ParticleSystem::Render(shared_ptr<ID3D11DeviceContext>& context)
+void ParticleSystem::Render(shared_ptr<RenderContext>& context)
 {
 	context->VSSetShader(m_vs.get(), nullptr, 0);
 	context->GSSetShader(m_gs.get(), nullptr, 0);
@@ -55,8 +55,8 @@ namespace gk2
 		void SetViewMtxBuffer(const std::shared_ptr<gk2::CBMatrix>& view);
 		void SetProjMtxBuffer(const std::shared_ptr<gk2::CBMatrix>& proj);
 
-		void Update(std::shared_ptr<ID3D11DeviceContext>& context, float dt, XMFLOAT4 cameraPos);
-		void Render(std::shared_ptr<ID3D11DeviceContext>& context);
+		void Update(std::shared_ptr<gk2::RenderContext>& context, float dt, XMFLOAT4 cameraPos);
+		void Render(std::shared_ptr<gk2::RenderContext>& context);
 
 	private:
 		static const XMFLOAT3 EMITTER_DIR;	//mean direction of particles' velocity
@@ -97,7 +97,7 @@ namespace gk2
 		static XMFLOAT3 RandomVelocity();
 		void AddNewParticle();
 		void UpdateParticle(gk2::Particle& p, float dt);
-		void UpdateVertexBuffer(std::shared_ptr<ID3D11DeviceContext>& context, XMFLOAT4 cameraPos);
+		void UpdateVertexBuffer(std::shared_ptr<gk2::RenderContext>& context, XMFLOAT4 cameraPos);
 	};
 }
 
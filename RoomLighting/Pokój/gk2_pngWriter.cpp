@@ -0,0 +1,317 @@
+#include "gk2_pngWriter.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+
+using namespace std;
+using namespace gk2;
+
+namespace
+{
+	const unsigned int BYTES_PER_PIXEL = 4;
+	const unsigned int WINDOW_SIZE = 1 << 15;
+	const unsigned int HASH_SIZE = 1 << 15;
+	const unsigned int MIN_MATCH = 3;
+	const unsigned int MAX_MATCH = 258;
+	//Longer chains find slightly longer matches at a much higher cost
+	const unsigned int MAX_CHAIN = 32;
+	const unsigned int NO_POSITION = 0xffffffff;
+
+	const unsigned int LENGTH_CODES = 29;
+	const unsigned int LENGTH_BASE[LENGTH_CODES] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43,
+													 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const unsigned int LENGTH_EXTRA[LENGTH_CODES] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4,
+													  4, 4, 5, 5, 5, 5, 0 };
+	const unsigned int DISTANCE_CODES = 30;
+	const unsigned int DISTANCE_BASE[DISTANCE_CODES] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257,
+														 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193,
+														 12289, 16385, 24577 };
+	const unsigned int DISTANCE_EXTRA[DISTANCE_CODES] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8,
+														  9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	struct CrcTable
+	{
+		unsigned int Values[256];
+
+		CrcTable()
+		{
+			for (unsigned int i = 0; i < 256; ++i)
+			{
+				unsigned int c = i;
+				for (unsigned int k = 0; k < 8; ++k)
+					c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+				Values[i] = c;
+			}
+		}
+	};
+
+	const CrcTable CRC_TABLE;
+
+	//Deflate packs bits starting from the least significant one, Huffman codes from their most significant bit
+	class BitWriter
+	{
+	public:
+		BitWriter(vector<unsigned char>& output) : m_output(output), m_bits(0), m_count(0) { }
+
+		void Write(unsigned int value, unsigned int count)
+		{
+			m_bits |= value << m_count;
+			m_count += count;
+			while (m_count >= 8)
+			{
+				m_output.push_back(static_cast<unsigned char>(m_bits));
+				m_bits >>= 8;
+				m_count -= 8;
+			}
+		}
+
+		void WriteCode(unsigned int code, unsigned int length)
+		{
+			unsigned int reversed = 0;
+			for (unsigned int i = 0; i < length; ++i)
+				reversed |= ((code >> i) & 1) << (length - 1 - i);
+			Write(reversed, length);
+		}
+
+		void Flush()
+		{
+			if (m_count > 0)
+				m_output.push_back(static_cast<unsigned char>(m_bits));
+			m_bits = 0;
+			m_count = 0;
+		}
+
+	private:
+		vector<unsigned char>& m_output;
+		unsigned int m_bits;
+		unsigned int m_count;
+	};
+
+	//Fixed Huffman code of a literal, a length code or the end of block
+	void WriteSymbol(BitWriter& w, unsigned int symbol)
+	{
+		if (symbol < 144)
+			w.WriteCode(0x30 + symbol, 8);
+		else if (symbol < 256)
+			w.WriteCode(0x190 + symbol - 144, 9);
+		else if (symbol < 280)
+			w.WriteCode(symbol - 256, 7);
+		else
+			w.WriteCode(0xc0 + symbol - 280, 8);
+	}
+
+	unsigned int FindCode(const unsigned int* base, unsigned int count, unsigned int value)
+	{
+		unsigned int code = 0;
+		while (code + 1 < count && base[code + 1] <= value)
+			++code;
+		return code;
+	}
+
+	void WriteMatch(BitWriter& w, unsigned int length, unsigned int distance)
+	{
+		unsigned int code = FindCode(LENGTH_BASE, LENGTH_CODES, length);
+		WriteSymbol(w, 257 + code);
+		w.Write(length - LENGTH_BASE[code], LENGTH_EXTRA[code]);
+		code = FindCode(DISTANCE_BASE, DISTANCE_CODES, distance);
+		w.WriteCode(code, 5);
+		w.Write(distance - DISTANCE_BASE[code], DISTANCE_EXTRA[code]);
+	}
+
+	unsigned int Hash(const unsigned char* p)
+	{
+		return ((p[0] << 10) ^ (p[1] << 5) ^ p[2]) & (HASH_SIZE - 1);
+	}
+
+	unsigned char Paeth(int a, int b, int c)
+	{
+		int p = a + b - c;
+		int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+		if (pa <= pb && pa <= pc)
+			return static_cast<unsigned char>(a);
+		return static_cast<unsigned char>(pb <= pc ? b : c);
+	}
+
+	void AppendBigEndian(vector<unsigned char>& output, unsigned int value)
+	{
+		output.push_back(static_cast<unsigned char>(value >> 24));
+		output.push_back(static_cast<unsigned char>(value >> 16));
+		output.push_back(static_cast<unsigned char>(value >> 8));
+		output.push_back(static_cast<unsigned char>(value));
+	}
+
+	void AppendChunk(vector<unsigned char>& output, const char* type, const vector<unsigned char>& data)
+	{
+		AppendBigEndian(output, static_cast<unsigned int>(data.size()));
+		size_t start = output.size();
+		output.insert(output.end(), type, type + 4);
+		output.insert(output.end(), data.begin(), data.end());
+		AppendBigEndian(output, PngWriter::Crc32(&output[start], output.size() - start));
+	}
+}
+
+unsigned int PngWriter::Crc32(const unsigned char* data, size_t size, unsigned int crc /* = 0 */)
+{
+	crc = ~crc;
+	for (size_t i = 0; i < size; ++i)
+		crc = CRC_TABLE.Values[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+unsigned int PngWriter::Adler32(const unsigned char* data, size_t size)
+{
+	const unsigned int modulus = 65521;
+	unsigned int a = 1, b = 0;
+	while (size > 0)
+	{
+		//Sums can't overflow within 5552 bytes
+		size_t n = size < 5552 ? size : 5552;
+		size -= n;
+		for (; n > 0; --n)
+		{
+			a += *data++;
+			b += a;
+		}
+		a %= modulus;
+		b %= modulus;
+	}
+	return b << 16 | a;
+}
+
+vector<unsigned char> PngWriter::Deflate(const vector<unsigned char>& data)
+{
+	vector<unsigned char> output;
+	output.reserve(data.size() / 2 + 64);
+	//Deflate with a 32K window, no preset dictionary
+	output.push_back(0x78);
+	output.push_back(0x01);
+	BitWriter w(output);
+	//Single final block with fixed codes
+	w.Write(1, 1);
+	w.Write(1, 2);
+	vector<unsigned int> head(HASH_SIZE, NO_POSITION);
+	vector<unsigned int> previous(WINDOW_SIZE, NO_POSITION);
+	const unsigned int size = static_cast<unsigned int>(data.size());
+	const unsigned char* bytes = data.data();
+	unsigned int i = 0;
+	while (i < size)
+	{
+		unsigned int bestLength = 0, bestDistance = 0;
+		if (size - i >= MIN_MATCH)
+		{
+			unsigned int h = Hash(bytes + i);
+			unsigned int maxLength = size - i < MAX_MATCH ? size - i : MAX_MATCH;
+			unsigned int candidate = head[h];
+			for (unsigned int chain = 0; chain < MAX_CHAIN && candidate != NO_POSITION &&
+				 i - candidate <= WINDOW_SIZE; ++chain)
+			{
+				unsigned int length = 0;
+				while (length < maxLength && bytes[candidate + length] == bytes[i + length])
+					++length;
+				if (length > bestLength)
+				{
+					bestLength = length;
+					bestDistance = i - candidate;
+					if (length == maxLength)
+						break;
+				}
+				unsigned int next = previous[candidate & (WINDOW_SIZE - 1)];
+				//Older positions in the slot of the window were overwritten
+				if (next == NO_POSITION || next >= candidate)
+					break;
+				candidate = next;
+			}
+		}
+		unsigned int advance = 1;
+		if (bestLength >= MIN_MATCH)
+		{
+			WriteMatch(w, bestLength, bestDistance);
+			advance = bestLength;
+		}
+		else
+			WriteSymbol(w, bytes[i]);
+		for (unsigned int end = i + advance; i < end; ++i)
+			if (size - i >= MIN_MATCH)
+			{
+				unsigned int h = Hash(bytes + i);
+				previous[i & (WINDOW_SIZE - 1)] = head[h];
+				head[h] = i;
+			}
+	}
+	//End of block
+	WriteSymbol(w, 256);
+	w.Flush();
+	AppendBigEndian(output, Adler32(bytes, data.size()));
+	return output;
+}
+
+void PngWriter::FilterRows(unsigned int width, unsigned int height, const unsigned char* pixels,
+						   vector<unsigned char>& filtered)
+{
+	const unsigned int rowSize = width * BYTES_PER_PIXEL;
+	filtered.resize(static_cast<size_t>(rowSize + 1) * height);
+	vector<unsigned char> zeros(rowSize, 0);
+	vector<unsigned char> candidate(rowSize);
+	for (unsigned int y = 0; y < height; ++y)
+	{
+		const unsigned char* row = pixels + static_cast<size_t>(y) * rowSize;
+		const unsigned char* up = y > 0 ? row - rowSize : zeros.data();
+		unsigned char* out = &filtered[static_cast<size_t>(y) * (rowSize + 1)];
+		unsigned long long bestSum = ~0ULL;
+		//None, Sub, Up, Average and Paeth
+		for (unsigned char type = 0; type < 5; ++type)
+		{
+			unsigned long long sum = 0;
+			for (unsigned int x = 0; x < rowSize; ++x)
+			{
+				int a = x >= BYTES_PER_PIXEL ? row[x - BYTES_PER_PIXEL] : 0;
+				int b = up[x];
+				int c = x >= BYTES_PER_PIXEL ? up[x - BYTES_PER_PIXEL] : 0;
+				unsigned char predicted = 0;
+				switch (type)
+				{
+				case 1: predicted = static_cast<unsigned char>(a); break;
+				case 2: predicted = static_cast<unsigned char>(b); break;
+				case 3: predicted = static_cast<unsigned char>((a + b) / 2); break;
+				case 4: predicted = Paeth(a, b, c); break;
+				}
+				candidate[x] = static_cast<unsigned char>(row[x] - predicted);
+				//Small signed differences compress best
+				sum += candidate[x] < 128 ? candidate[x] : 256 - candidate[x];
+			}
+			if (sum < bestSum)
+			{
+				bestSum = sum;
+				out[0] = type;
+				copy(candidate.begin(), candidate.end(), out + 1);
+			}
+		}
+	}
+}
+
+vector<unsigned char> PngWriter::Encode(unsigned int width, unsigned int height, const unsigned char* pixels)
+{
+	static const unsigned char signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	vector<unsigned char> output(signature, signature + sizeof(signature));
+	vector<unsigned char> header;
+	AppendBigEndian(header, width);
+	AppendBigEndian(header, height);
+	//8 bits per channel, RGBA, deflate, adaptive filtering, no interlacing
+	const unsigned char format[] = { 8, 6, 0, 0, 0 };
+	header.insert(header.end(), format, format + sizeof(format));
+	AppendChunk(output, "IHDR", header);
+	vector<unsigned char> filtered;
+	FilterRows(width, height, pixels, filtered);
+	AppendChunk(output, "IDAT", Deflate(filtered));
+	AppendChunk(output, "IEND", vector<unsigned char>());
+	return output;
+}
+
+void PngWriter::Write(const string& fileName, unsigned int width, unsigned int height, const unsigned char* pixels)
+{
+	vector<unsigned char> png = Encode(width, height, pixels);
+	ofstream file(fileName, ios::binary);
+	if (!file.write(reinterpret_cast<const char*>(png.data()), png.size()))
+		throw runtime_error("Could not write " + fileName);
+}
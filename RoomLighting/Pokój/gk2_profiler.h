@@ -0,0 +1,171 @@
+#ifndef __GK2_PROFILER_H_
+#define __GK2_PROFILER_H_
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <chrono>
+#endif
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define GK2_PROFILER_TSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+#include <atomic>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#define GK2_THREAD_LOCAL __declspec(thread)
+#else
+#define GK2_THREAD_LOCAL thread_local
+#endif
+
+namespace gk2
+{
+	//Measures nested zones of code on all threads. Every thread writes the zones it finishes to its own ring
+	//buffer without locking, the oldest events are overwritten. EndFrame gathers the new events into rolling
+	//statistics of each zone, WriteChromeTrace exports the events still held by the buffers in the trace event
+	//format which chrome://tracing and Perfetto open. Zones are named by strings which live as long as the
+	//program, usually literals, so recording one is two timer reads and a store. On x86 the timer is the time stamp
+	//counter, which is read several times faster than the system clocks. Its ticks are converted to time only when
+	//the events are gathered, by a rate measured against the system clock since the program started.
+	class Profiler
+	{
+	public:
+		//Events kept per thread, a power of two
+		static const unsigned int RING_SIZE = 1 << 15;
+		//Latest durations of a zone the statistics are computed from
+		static const unsigned int HISTORY_SIZE = 512;
+
+		struct Event
+		{
+			const char* Name;
+			long long Start;
+			long long End;
+		};
+
+		//Written only by its thread, read by EndFrame and the export
+		struct ThreadBuffer
+		{
+			Event Events[RING_SIZE];
+			//Number of events ever written
+			std::atomic<unsigned long long> Head;
+			unsigned int Id;
+			std::string Name;
+			//Events up to this one were gathered by EndFrame
+			unsigned long long Gathered;
+
+			void Push(const char* name, long long start, long long end)
+			{
+				unsigned long long head = Head.load(std::memory_order_relaxed);
+				Event& e = Events[head & (RING_SIZE - 1)];
+				e.Name = name;
+				e.Start = start;
+				e.End = end;
+				Head.store(head + 1, std::memory_order_release);
+			}
+		};
+
+		struct ZoneStatistics
+		{
+			std::string Name;
+			//Times the zone was recorded since the start
+			unsigned long long Count;
+			//Milliseconds, over the last HISTORY_SIZE recordings
+			double Min;
+			double Average;
+			double P99;
+			double Max;
+		};
+
+		//Timer ticks
+		static long long Now()
+		{
+#if defined(GK2_PROFILER_TSC)
+			return static_cast<long long>(__rdtsc());
+#elif defined(_WIN32)
+			LARGE_INTEGER time;
+			QueryPerformanceCounter(&time);
+			return time.QuadPart;
+#else
+			return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+		}
+		//By the rate measured by the last EndFrame or WriteChromeTrace
+		static double TicksToMilliseconds(long long ticks);
+
+		static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+		static void setEnabled(bool enabled) { s_enabled.store(enabled, std::memory_order_relaxed); }
+		//Buffer of the calling thread, created when it records its first zone. Buffers are kept until the program
+		//exits, so only long-lived threads like the ones of the ThreadPool should be profiled.
+		static ThreadBuffer* getThreadBuffer()
+		{
+			ThreadBuffer* buffer = s_threadBuffer;
+			return buffer ? buffer : CreateThreadBuffer();
+		}
+		//Copy of a zone name built at runtime, kept until the program exits
+		static const char* Intern(const std::string& name);
+		//Names the calling thread in the exported traces
+		static void SetThreadName(const std::string& name);
+
+		//Adds events recorded since the last call to the statistics. Called once per frame by the main loop.
+		static void EndFrame();
+		//Events which were overwritten before EndFrame gathered them
+		static unsigned long long getLostEvents();
+		//Returns false if the zone hasn't been recorded yet
+		static bool GetStatistics(const std::string& name, ZoneStatistics& statistics);
+		//All the zones sorted by name
+		static std::vector<ZoneStatistics> GetStatistics();
+		//Table of the zone statistics
+		static void WriteStatistics(std::wostream& s);
+		static void WriteChromeTrace(std::ostream& s);
+
+	private:
+		static std::atomic<bool> s_enabled;
+		GK2_THREAD_LOCAL static ThreadBuffer* s_threadBuffer;
+
+		static ThreadBuffer* CreateThreadBuffer();
+		//Appends the events of the buffer from the given one on, skipping the ones overwritten before or during
+		//the copy. Returns the number of events written to the buffer so far.
+		static unsigned long long ReadEvents(const ThreadBuffer& buffer, unsigned long long first,
+											 std::vector<Event>& events, unsigned long long& lost);
+	};
+
+	//Records the time from its construction to its destruction
+	class ProfileZone
+	{
+	public:
+		explicit ProfileZone(const char* name)
+			: m_name(name), m_buffer(Profiler::isEnabled() ? Profiler::getThreadBuffer() : nullptr), m_start(0)
+		{
+			if (m_buffer)
+				m_start = Profiler::Now();
+		}
+
+		~ProfileZone()
+		{
+			if (m_buffer)
+				m_buffer->Push(m_name, m_start, Profiler::Now());
+		}
+
+	private:
+		const char* m_name;
+		Profiler::ThreadBuffer* m_buffer;
+		long long m_start;
+
+		ProfileZone(const ProfileZone&);
+		ProfileZone& operator =(const ProfileZone&);
+	};
+}
+
+#define PROFILE_CONCAT2(a, b) a ## b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+//Profiles the rest of the enclosing scope
+#define PROFILE_ZONE(name) gk2::ProfileZone PROFILE_CONCAT(__profileZone, __LINE__)(name)
+
+#endif __GK2_PROFILER_H_
@@ -1,5 +1,6 @@
 #include "gk2_room.h"
 #include "gk2_window.h"
+#include "gk2_vertices.h"
 
 using namespace std;
 using namespace gk2;
@@ -21,16 +22,6 @@ Room::~Room()
 
 }
 
-void* Room::operator new(size_t size)
-{
-	return Utils::New16Aligned(size);
-}
-
-void Room::operator delete(void* ptr)
-{
-	Utils::Delete16Aligned(ptr);
-}
-
 void Room::InitializeConstantBuffers()
 {
 	m_projCB.reset(new CBMatrix(m_device));
@@ -51,6 +42,25 @@ void Room::InitializeCamera()
 	UpdateCamera();
 }
 
+void Room::LoadMeshAsync(const wstring& fileName, Mesh& mesh)
+{
+	//Mesh file is parsed on a loader thread, the buffers are created in Update once it's done
+	typedef pair<vector<VertexPosNormal>, vector<unsigned short>> MeshFileData;
+	shared_ptr<AssetCache> cache = m_device.getAssetCache();
+	shared_future<MeshFileData> data = m_assetLoader.Load<MeshFileData>([fileName, cache]()
+	{
+		MeshFileData result;
+		MeshLoader::ParseMeshFile(fileName, result.first, result.second, cache.get());
+		return result;
+	});
+	m_assetLoader.WhenReady<MeshFileData>(data, [this, &mesh](const MeshFileData& meshData)
+	{
+		XMMATRIX world = mesh.getWorldMatrix();
+		mesh = m_meshLoader.CreateMesh(meshData.first, meshData.second);
+		mesh.setWorldMatrix(world);
+	});
+}
+
 void Room::CreateScene()
 {
 	m_walls[0] = m_meshLoader.GetQuad(5.0f);
@@ -62,7 +72,7 @@ void Room::CreateScene()
 		m_walls[i].setWorldMatrix(wall * XMMatrixRotationY(a));
 	m_walls[4].setWorldMatrix(wall * XMMatrixRotationX(XM_PIDIV2));
 	m_walls[5].setWorldMatrix(wall * XMMatrixRotationX(-XM_PIDIV2));
-	m_teapot = m_meshLoader.LoadMesh(L"resources/meshes/teapot.mesh");
+	LoadMeshAsync(L"resources/meshes/teapot.mesh", m_teapot);
 	XMMATRIX teapotMtx = XMMatrixTranslation(0.0f, -2.3f, 0.f) * XMMatrixScaling(0.1f, 0.1f, 0.1f) *
 						 XMMatrixRotationY(-XM_PIDIV2) * XMMatrixTranslation(-1.0f, -1.24f, 0.0f);
 	m_teapot.setWorldMatrix(teapotMtx);
@@ -71,14 +81,14 @@ void Room::CreateScene()
 						 XMMatrixRotationY(-XM_PIDIV2) * XMMatrixTranslation(-1.0f, -1.24f, 0.0f));
 	m_box = m_meshLoader.GetBox();
 	m_box.setWorldMatrix(XMMatrixTranslation(-1.1f, -1.96f, 0.0f));
-	m_lamp = m_meshLoader.LoadMesh(L"resources/meshes/lamp.mesh");
-	m_chairSeat = m_meshLoader.LoadMesh(L"resources/meshes/chair_seat.mesh");
-	m_chairBack = m_meshLoader.LoadMesh(L"resources/meshes/chair_back.mesh");
+	LoadMeshAsync(L"resources/meshes/lamp.mesh", m_lamp);
+	LoadMeshAsync(L"resources/meshes/chair_seat.mesh", m_chairSeat);
+	LoadMeshAsync(L"resources/meshes/chair_back.mesh", m_chairBack);
 	XMMATRIX chair = XMMatrixRotationY(XM_PI + XM_PI/9 /*20 deg*/) * XMMatrixTranslation(-0.1f, -1.56f, -1.3f);
 	m_chairSeat.setWorldMatrix(chair);
 	m_chairBack.setWorldMatrix(chair);
-	m_monitor = m_meshLoader.LoadMesh(L"resources/meshes/monitor.mesh");
-	m_screen = m_meshLoader.LoadMesh(L"resources/meshes/screen.mesh");
+	LoadMeshAsync(L"resources/meshes/monitor.mesh", m_monitor);
+	LoadMeshAsync(L"resources/meshes/screen.mesh", m_screen);
 	XMMATRIX monitor = XMMatrixRotationY(XM_PIDIV4) *
 					   XMMatrixTranslation(TABLE_POS.x, TABLE_POS.y + 0.42f, TABLE_POS.z);
 	m_monitor.setWorldMatrix(monitor);
@@ -96,9 +106,19 @@ void Room::CreateScene()
 	m_tableTop = m_meshLoader.GetDisc(16, TABLE_R);
 	m_tableTop.setWorldMatrix(XMMatrixRotationY(XM_PIDIV4/4) *
 							  XMMatrixTranslation(TABLE_POS.x, TABLE_POS.y, TABLE_POS.z));
+	m_wallInstances = CreateInstanceBuffer(m_walls, 6);
+	m_tableLegInstances = CreateInstanceBuffer(m_tableLegs, 4);
 	m_surfaceColorCB->Update(m_context, XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f));
 }
 
+shared_ptr<ID3D11Buffer> Room::CreateInstanceBuffer(const Mesh* meshes, unsigned int count)
+{
+	vector<InstanceWorld> instances(count);
+	for (unsigned int i = 0; i < count; ++i)
+		XMStoreFloat4x4(&instances[i].World, meshes[i].getWorldMatrix());
+	return m_device.CreateVertexBuffer(instances);
+}
+
 void Room::InitializeRenderStates()
 {
 	D3D11_RASTERIZER_DESC rsDesc = m_device.DefaultRasterizerDesc();
@@ -162,6 +182,7 @@ void Room::UpdateCamera()
 
 void Room::Update(float dt)
 {
+	m_assetLoader.Finalize();
 	m_lamp.setWorldMatrix(m_lightShadowEffect->UpdateLight(dt, m_context));
 	static MouseState prevState;
 	MouseState currentState;
@@ -187,14 +208,12 @@ void Room::Update(float dt)
 	m_particles->Update(m_context, dt, m_camera.GetPosition());
 }
 
-void Room::DrawScene()
+void Room::DrawScene(EffectBase& effect)
 {
 	//Draw walls
-	for (int i = 0; i < 6; ++i)
-	{
-		m_worldCB->Update(m_context, m_walls[i].getWorldMatrix());
-		m_walls[i].Render(m_context);
-	}
+	effect.SetInstancing(true);
+	m_walls[0].RenderInstanced(m_context, m_wallInstances.get(), 6);
+	effect.SetInstancing(false);
 	//Draw teapot
 	m_worldCB->Update(m_context, m_teapot.getWorldMatrix());
 	m_teapot.Render(m_context);
@@ -226,11 +245,9 @@ void Room::DrawScene()
 	m_worldCB->Update(m_context, m_tableSide.getWorldMatrix());
 	m_tableSide.Render(m_context);
 	//Table legs
-	for (int i = 0; i < 4; ++i)
-	{
-		m_worldCB->Update(m_context, m_tableLegs[i].getWorldMatrix());
-		m_tableLegs[i].Render(m_context);
-	}
+	effect.SetInstancing(true);
+	m_tableLegs[0].RenderInstanced(m_context, m_tableLegInstances.get(), 4);
+	effect.SetInstancing(false);
 	m_context->RSSetState(nullptr);
 }
 
@@ -241,7 +258,7 @@ void Room::Render()
 
 	m_lightShadowEffect->SetupShadow(m_context);
 	m_phongEffect->Begin(m_context);
-	DrawScene();
+	DrawScene(*m_phongEffect);
 	m_phongEffect->End();
 	m_particles->Render(m_context);
 	m_lightShadowEffect->EndShadow();
@@ -255,7 +272,7 @@ void Room::Render()
 	m_context->ClearDepthStencilView(m_depthStencilView.get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
 
 	m_lightShadowEffect->Begin(m_context);
-	DrawScene();
+	DrawScene(*m_lightShadowEffect);
 	m_lightShadowEffect->End();
 	
 	m_context->OMSetBlendState(m_bsAlpha.get(), nullptr, BS_MASK);
@@ -8,18 +8,17 @@
 #include "gk2_lightShadowEffect.h"
 #include "gk2_constantBuffer.h"
 #include "gk2_particles.h"
+#include "gk2_assetLoader.h"
+#include "gk2_aligned.h"
 
 namespace gk2
 {
-	class Room : public gk2::ApplicationBase
+	class Room : public gk2::ApplicationBase, public gk2::AlignedNew
 	{
 	public:
 		Room(HINSTANCE hInstance);
 		virtual ~Room();
 
-		static void* operator new(size_t size);
-		static void operator delete(void* ptr);
-
 	protected:
 		virtual bool LoadContent();
 		virtual void UnloadContent();
@@ -46,11 +45,15 @@ namespace gk2
 		gk2::Mesh m_tableTop;
 		gk2::Mesh m_monitor;
 		gk2::Mesh m_screen;
+		//World matrices of the walls and the legs, each drawn with one instanced call
+		std::shared_ptr<ID3D11Buffer> m_wallInstances;
+		std::shared_ptr<ID3D11Buffer> m_tableLegInstances;
 
 		XMMATRIX m_projMtx;
 
 		gk2::Camera m_camera;
 		gk2::MeshLoader m_meshLoader;
+		gk2::AssetLoader m_assetLoader;
 
 		std::shared_ptr<gk2::CBMatrix> m_worldCB;
 		std::shared_ptr<gk2::CBMatrix> m_viewCB;
@@ -72,9 +75,12 @@ namespace gk2
 		void InitializeCamera();
 		void InitializeRenderStates();
 		void CreateScene();
+		void LoadMeshAsync(const std::wstring& fileName, gk2::Mesh& mesh);
 		void UpdateCamera();
+		//Buffer with the world matrices of the meshes for gk2::Mesh::RenderInstanced
+		std::shared_ptr<ID3D11Buffer> CreateInstanceBuffer(const gk2::Mesh* meshes, unsigned int count);
 
-		void DrawScene();
+		void DrawScene(gk2::EffectBase& effect);
 	};
 }
 
@@ -0,0 +1,175 @@
+#include "gk2_shaderCache.h"
+#include <ios>
+#include <sstream>
+#include <cstring>
+
+using namespace std;
+using namespace gk2;
+
+namespace
+{
+	void Append(vector<BYTE>& data, const void* bytes, size_t size)
+	{
+		const BYTE* b = reinterpret_cast<const BYTE*>(bytes);
+		data.insert(data.end(), b, b + size);
+	}
+
+	bool Extract(const vector<BYTE>& data, size_t& offset, void* bytes, size_t size)
+	{
+		if (data.size() < offset + size)
+			return false;
+		if (size)
+			memcpy(bytes, &data[offset], size);
+		offset += size;
+		return true;
+	}
+
+	unsigned long long HashString(const string& s, unsigned long long seed)
+	{
+		//Terminating zero is hashed as well, so that e.g. "AB","C" and "A","BC" give different keys
+		return AssetCache::Hash(s.c_str(), s.size() + 1, seed);
+	}
+}
+
+ShaderCache::ShaderCache(const shared_ptr<AssetCache>& cache, const ShaderCompiler& compiler,
+						 unsigned int compilerFlags /* = 0 */)
+	: m_cache(cache), m_fileSystem(cache ? cache->getFileSystem() : make_shared<NativeFileSystem>()),
+	  m_compiler(compiler), m_compilerFlags(compilerFlags), m_hits(0), m_misses(0)
+{
+
+}
+
+unsigned long long ShaderCache::Key(const ShaderDesc& desc, const vector<BYTE>& source) const
+{
+	unsigned long long hash = AssetCache::Hash(source.data(), source.size());
+	hash = HashString(desc.Entry, hash);
+	hash = HashString(desc.Model, hash);
+	for (auto it = desc.Defines.begin(); it != desc.Defines.end(); ++it)
+	{
+		hash = HashString(it->first, hash);
+		hash = HashString(it->second, hash);
+	}
+	return AssetCache::Hash(&m_compilerFlags, sizeof(m_compilerFlags), hash);
+}
+
+void ShaderCache::WriteArtifact(const vector<wstring>& includes, const vector<BYTE>& byteCode,
+							   vector<BYTE>& artifact) const
+{
+	//Included files with hashes of their contents, followed by the byte code
+	unsigned int count = static_cast<unsigned int>(includes.size());
+	Append(artifact, &count, sizeof(count));
+	for (auto it = includes.begin(); it != includes.end(); ++it)
+	{
+		vector<BYTE> data;
+		m_fileSystem->ReadFile(*it, data);
+		unsigned long long hash = AssetCache::Hash(data.data(), data.size());
+		unsigned int length = static_cast<unsigned int>(it->size());
+		Append(artifact, &length, sizeof(length));
+		Append(artifact, it->c_str(), length * sizeof(wchar_t));
+		Append(artifact, &hash, sizeof(hash));
+	}
+	count = static_cast<unsigned int>(byteCode.size());
+	Append(artifact, &count, sizeof(count));
+	Append(artifact, byteCode.data(), byteCode.size());
+}
+
+bool ShaderCache::ReadArtifact(const vector<BYTE>& artifact, vector<BYTE>& byteCode) const
+{
+	size_t offset = 0;
+	unsigned int count;
+	if (!Extract(artifact, offset, &count, sizeof(count)))
+		return false;
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		unsigned int length;
+		if (!Extract(artifact, offset, &length, sizeof(length)) ||
+			artifact.size() < offset + static_cast<size_t>(length) * sizeof(wchar_t))
+			return false;
+		wstring include(length, L'\0');
+		Extract(artifact, offset, &include[0], length * sizeof(wchar_t));
+		unsigned long long hash;
+		if (!Extract(artifact, offset, &hash, sizeof(hash)))
+			return false;
+		//Modified or deleted include invalidates the entry
+		vector<BYTE> data;
+		if (!m_fileSystem->ReadFile(include, data) || AssetCache::Hash(data.data(), data.size()) != hash)
+			return false;
+	}
+	if (!Extract(artifact, offset, &count, sizeof(count)) || artifact.size() != offset + count)
+		return false;
+	byteCode.assign(artifact.begin() + offset, artifact.end());
+	return true;
+}
+
+vector<BYTE> ShaderCache::Get(const ShaderDesc& desc)
+{
+	vector<BYTE> source;
+	if (!m_fileSystem->ReadFile(desc.File, source))
+		throw ios_base::failure("Unable to read shader source file");
+	unsigned long long key = Key(desc, source);
+	vector<BYTE> artifact, byteCode;
+	if (m_cache && m_cache->Load("shader", COOKER_VERSION, key, artifact) && ReadArtifact(artifact, byteCode))
+	{
+		++m_hits;
+		return byteCode;
+	}
+	++m_misses;
+	vector<wstring> includes;
+	m_compiler(desc, source, byteCode, includes);
+	if (m_cache)
+	{
+		artifact.clear();
+		WriteArtifact(includes, byteCode, artifact);
+		m_cache->Store("shader", COOKER_VERSION, key, artifact);
+	}
+	return byteCode;
+}
+
+vector<ShaderDesc> ShaderCache::Precompile(const vector<ShaderDesc>& shaders)
+{
+	vector<ShaderDesc> failed;
+	for (auto it = shaders.begin(); it != shaders.end(); ++it)
+	{
+		try
+		{
+			Get(*it);
+		}
+		catch (...)
+		{
+			failed.push_back(*it);
+		}
+	}
+	return failed;
+}
+
+vector<ShaderDesc> ShaderCache::ReadManifest(const wstring& fileName) const
+{
+	vector<BYTE> data;
+	if (!m_fileSystem->ReadFile(fileName, data))
+		throw ios_base::failure("Unable to read shader manifest");
+	istringstream input(string(data.begin(), data.end()));
+	vector<ShaderDesc> shaders;
+	string line;
+	while (getline(input, line))
+	{
+		istringstream fields(line);
+		string file;
+		if (!(fields >> file) || file[0] == '#')
+			continue;
+		ShaderDesc desc;
+		desc.File = wstring(file.begin(), file.end());
+		if (!(fields >> desc.Entry >> desc.Model))
+			throw ios_base::failure("Invalid shader manifest entry");
+		string define;
+		while (fields >> define)
+		{
+			size_t separator = define.find('=');
+			if (separator == string::npos)
+				desc.Defines.push_back(make_pair(define, string()));
+			else
+				desc.Defines.push_back(make_pair(define.substr(0, separator), define.substr(separator + 1)));
+		}
+		shaders.push_back(desc);
+	}
+	return shaders;
+}
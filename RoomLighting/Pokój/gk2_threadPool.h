@@ -0,0 +1,55 @@
+#ifndef __GK2_THREAD_POOL_H_
+#define __GK2_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gk2
+{
+	//Runs data parallel loops on a fixed set of worker threads. The thread calling ParallelFor takes part in
+	//the work and returns when all the items are done, so the pool never has to be waited for separately.
+	class ThreadPool
+	{
+	public:
+		//Zero workers means one less than the number of hardware threads, no workers runs loops serially
+		ThreadPool(unsigned int workersCount = 0);
+		~ThreadPool();
+
+		//Calls body for every index in [0, count) in an unspecified order. Items are handed out one at a time,
+		//so uneven items are balanced between the threads. The first exception thrown by body is rethrown
+		//after the remaining items are skipped. Loops can't be nested or started from several threads at once.
+		void ParallelFor(unsigned int count, const std::function<void(unsigned int)>& body);
+
+		//Including the calling thread
+		unsigned int getThreadsCount() const { return static_cast<unsigned int>(m_workers.size()) + 1; }
+
+	private:
+		std::vector<std::thread> m_workers;
+		std::mutex m_mutex;
+		std::condition_variable m_workAvailable;
+		std::condition_variable m_workDone;
+		bool m_stopping;
+		//Incremented when a loop starts, workers compare it with the last loop they took part in
+		unsigned int m_generation;
+		//Workers which haven't finished the current loop yet
+		unsigned int m_busy;
+
+		const std::function<void(unsigned int)>* m_body;
+		unsigned int m_count;
+		std::atomic<unsigned int> m_next;
+		std::exception_ptr m_error;
+
+		void WorkerLoop();
+		void RunItems();
+
+		ThreadPool(const ThreadPool&);
+		ThreadPool& operator =(const ThreadPool&);
+	};
+}
+
+#endif __GK2_THREAD_POOL_H_
@@ -20,6 +20,15 @@ namespace gk2
 		static const unsigned int LayoutElements = 2;
 		static const D3D11_INPUT_ELEMENT_DESC Layout[LayoutElements];
 	};
+
+	//World matrix of one instance, read from input slot 1 by the VS_Instanced entry points
+	struct InstanceWorld
+	{
+		XMFLOAT4X4 World;
+		static const unsigned int InputSlot = 1;
+		static const unsigned int LayoutElements = 4;
+		static const D3D11_INPUT_ELEMENT_DESC Layout[LayoutElements];
+	};
 }
 
 #endif __GK2_VERTICES_H_
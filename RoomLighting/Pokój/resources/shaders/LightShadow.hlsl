@@ -43,6 +43,17 @@ struct VSInput
 	float3 norm : NORMAL0;
 };
 
+struct VSInstanceInput
+{
+	float3 pos : POSITION;
+	float3 norm : NORMAL0;
+	//Rows of the instance's world matrix
+	float4 world0 : WORLD0;
+	float4 world1 : WORLD1;
+	float4 world2 : WORLD2;
+	float4 world3 : WORLD3;
+};
+
 struct PSInput
 {
 	float4 pos : SV_POSITION;
@@ -52,12 +63,12 @@ struct PSInput
 	float3 lightVec : TEXCOORD1;
 };
 
-PSInput VS_Main(VSInput i)
+PSInput Transform(VSInput i, matrix world)
 {
 	PSInput o = (PSInput)0;
-	matrix worldView = mul(viewMatrix, worldMatrix);
+	matrix worldView = mul(viewMatrix, world);
 	o.worldPos = float4(i.pos, 1.0f);
-	o.worldPos = mul(worldMatrix, o.worldPos);
+	o.worldPos = mul(world, o.worldPos);
 	
 
 	float4 viewPos = mul(viewMatrix, o.worldPos);
@@ -71,6 +82,20 @@ PSInput VS_Main(VSInput i)
 	return o;
 }
 
+PSInput VS_Main(VSInput i)
+{
+	return Transform(i, worldMatrix);
+}
+
+//Instances of one mesh drawn with one call, the world matrix is laid out as if it was read from cbWorld
+PSInput VS_Instanced(VSInstanceInput i)
+{
+	VSInput v;
+	v.pos = i.pos;
+	v.norm = i.norm;
+	return Transform(v, transpose(float4x4(i.world0, i.world1, i.world2, i.world3)));
+}
+
 static const float3 ambientColor = float3(0.3f, 0.3f, 0.3f);
 static const float3 kd = 0.7, m = 100.0f;
 static const float4 defLightColor = float4(0.3f, 0.3f, 0.3f, 0.0f);
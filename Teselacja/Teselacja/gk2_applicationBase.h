@@ -6,6 +6,7 @@
 #include <dinput.h>
 #include "gk2_input.h"
 #include "gk2_deviceHelper.h"
+#include "gk2_stateFilteringContext.h"
 
 namespace gk2
 {
@@ -22,6 +23,10 @@ namespace gk2
 		inline HINSTANCE getHandle() const { return m_hInstance; }
 		inline gk2::Window* getMainWindow() const { return m_mainWindow; }
 
+		//Offline shader build stage: compiles all shaders listed in the manifest into the shader cache.
+		//Returns number of shaders which failed to compile.
+		static int PrecompileShaders(const std::wstring& manifestFile);
+
 	protected:
 		bool Initialize();
 		int MainLoop();
@@ -38,7 +43,9 @@ namespace gk2
 		D3D_FEATURE_LEVEL m_featureLevel;
 
 		gk2::DeviceHelper m_device;
-		std::shared_ptr<ID3D11DeviceContext> m_context;
+		//Immediate context behind the state filter
+		std::shared_ptr<gk2::RenderContext> m_context;
+		std::shared_ptr<gk2::StateFilteringContext> m_stateFilter;
 		std::shared_ptr<IDXGISwapChain> m_swapChain;
 		std::shared_ptr<ID3D11Texture2D> m_backBufferTexture;
 		std::shared_ptr<ID3D11RenderTargetView> m_backBuffer;
@@ -57,6 +64,7 @@ namespace gk2
 		void CreateBackBuffers(SIZE windowSize);
 		void InitializeDirectInput();
 		void SetViewPort(SIZE windowSize);
+		void ReportStateStatistics();
 	};
 }
 
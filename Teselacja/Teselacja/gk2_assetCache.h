@@ -0,0 +1,48 @@
+#ifndef __GK2_ASSET_CACHE_H_
+#define __GK2_ASSET_CACHE_H_
+
+#include "gk2_fileSystem.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace gk2
+{
+	//Cache of cooked (binary, ready to use) assets shared by all the applications. Artifacts are stored in
+	//files named after the hash of source file contents and the name and version of the cooker which
+	//produced them, so a modified source or a changed cooker simply misses the cache.
+	class AssetCache
+	{
+	public:
+		static const unsigned long long HASH_SEED = 14695981039346656037ULL;
+
+		AssetCache(const std::wstring& directory = DefaultDirectory(),
+				   const std::shared_ptr<gk2::FileSystem>& fileSystem = std::make_shared<gk2::NativeFileSystem>());
+
+		//gk2AssetCache in the directory of temporary files
+		static std::wstring DefaultDirectory();
+		//64-bit FNV-1a, seed allows combining several buffers into one hash
+		static unsigned long long Hash(const void* data, size_t size, unsigned long long seed = HASH_SEED);
+		//Reads a file from the disk
+		static bool ReadFile(const std::wstring& fileName, std::vector<BYTE>& data);
+
+		bool Load(const std::string& cooker, unsigned int cookerVersion, unsigned long long sourceHash,
+				  std::vector<BYTE>& artifact) const;
+		//Failing to store an artifact is not an error, the asset will be cooked again next time
+		bool Store(const std::string& cooker, unsigned int cookerVersion, unsigned long long sourceHash,
+				   const std::vector<BYTE>& artifact) const;
+
+		const std::wstring& getDirectory() const { return m_directory; }
+		//Holds the artifacts and the sources of the assets
+		const std::shared_ptr<gk2::FileSystem>& getFileSystem() const { return m_fileSystem; }
+
+	private:
+		std::wstring m_directory;
+		std::shared_ptr<gk2::FileSystem> m_fileSystem;
+
+		std::wstring ArtifactPath(const std::string& cooker, unsigned int cookerVersion,
+								  unsigned long long sourceHash) const;
+	};
+}
+
+#endif __GK2_ASSET_CACHE_H_
@@ -0,0 +1,54 @@
+#include "gk2_bakedSurfaceEffect.h"
+#include "gk2_vertices.h"
+
+using namespace std;
+using namespace gk2;
+
+const wstring BakedSurfaceEffect::ShaderFile = L"resources/shaders/BakedSurfaceShader.hlsl";
+
+BakedSurfaceEffect::BakedSurfaceEffect(DeviceHelper& device, shared_ptr<RenderContext> context /* = nullptr */)
+	: EffectBase(context)
+{
+	Initialize(device, ShaderFile, VertexPosNormalTangentTex::Layout, VertexPosNormalTangentTex::LayoutElements, "4_0");
+}
+
+void BakedSurfaceEffect::SetSurfaceColorBuffer(const shared_ptr<ConstantBuffer<XMFLOAT4>>& surfaceColor)
+{
+	if (surfaceColor != nullptr)
+		m_surfaceColorCB = surfaceColor;
+}
+
+void BakedSurfaceEffect::SetSamplerState(const shared_ptr<ID3D11SamplerState>& samplerState)
+{
+	if (samplerState != nullptr)
+		m_samplerState = samplerState;
+}
+
+void BakedSurfaceEffect::SetColorTexture(const shared_ptr<ID3D11ShaderResourceView>& texture)
+{
+	if (texture != nullptr)
+		m_colorTexture = texture;
+}
+
+void BakedSurfaceEffect::SetNormalTexture(const shared_ptr<ID3D11ShaderResourceView>& texture)
+{
+	if (texture != nullptr)
+		m_normalTexture = texture;
+}
+
+void BakedSurfaceEffect::SetVertexShaderData()
+{
+	ID3D11Buffer* vsb[3] = { m_worldCB->getBufferObject().get(), m_viewCB->getBufferObject().get(),
+							 m_projCB->getBufferObject().get() };
+	m_context->VSSetConstantBuffers(0, 3, vsb);
+}
+
+void BakedSurfaceEffect::SetPixelShaderData()
+{
+	ID3D11SamplerState* ss[1] = { m_samplerState.get() };
+	m_context->PSSetSamplers(1, 1, ss);
+	ID3D11ShaderResourceView* srv[2] = { m_colorTexture.get(), m_normalTexture.get() };
+	m_context->PSSetShaderResources(1, 2, srv);
+	ID3D11Buffer* psb[1] = { m_surfaceColorCB->getBufferObject().get() };
+	m_context->PSSetConstantBuffers(0, 1, psb);
+}
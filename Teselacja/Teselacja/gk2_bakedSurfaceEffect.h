@@ -0,0 +1,36 @@
+#ifndef __GK2_BAKED_SURFACE_EFFECT_H_
+#define __GK2_BAKED_SURFACE_EFFECT_H_
+
+#include "gk2_effectBase.h"
+
+namespace gk2
+{
+	//Lighting of Part IV/V applied to a mesh with baked displacement, doesn't need tessellation hardware
+	class BakedSurfaceEffect : public gk2::EffectBase
+	{
+	public:
+		BakedSurfaceEffect(gk2::DeviceHelper& device, std::shared_ptr<gk2::RenderContext> context = nullptr);
+
+		void SetSurfaceColorBuffer(const std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4>>& surfaceColor);
+		void SetSamplerState(const std::shared_ptr<ID3D11SamplerState>& samplerState);
+		void SetColorTexture(const std::shared_ptr<ID3D11ShaderResourceView>& texture);
+		void SetNormalTexture(const std::shared_ptr<ID3D11ShaderResourceView>& texture);
+
+	protected:
+		virtual void SetVertexShaderData();
+		virtual void SetPixelShaderData();
+
+		virtual void SetHullShaderData() {}
+		virtual void SetDomainShaderData() {}
+
+	private:
+		static const std::wstring ShaderFile;
+
+		std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4>> m_surfaceColorCB;
+		std::shared_ptr<ID3D11SamplerState> m_samplerState;
+		std::shared_ptr<ID3D11ShaderResourceView> m_colorTexture;
+		std::shared_ptr<ID3D11ShaderResourceView> m_normalTexture;
+	};
+}
+
+#endif __GK2_BAKED_SURFACE_EFFECT_H_
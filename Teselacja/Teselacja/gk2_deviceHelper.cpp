@@ -1,10 +1,75 @@
 #include "gk2_deviceHelper.h"
 #include "gk2_utils.h"
 #include "gk2_exceptions.h"
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <cwctype>
+#include <list>
+#include <map>
 using namespace std;
 using namespace gk2;
 
+namespace
+{
+	//Lower case extension without the dot
+	wstring Extension(const wstring& file)
+	{
+		size_t dot = file.find_last_of(L'.');
+		if (dot == wstring::npos || file.find_first_of(L"/\\", dot) != wstring::npos)
+			return wstring();
+		wstring extension = file.substr(dot + 1);
+		transform(extension.begin(), extension.end(), extension.begin(), towlower);
+		return extension;
+	}
+
+	wstring Directory(const wstring& file)
+	{
+		size_t separator = file.find_last_of(L"/\\");
+		return separator == wstring::npos ? wstring() : file.substr(0, separator + 1);
+	}
+
+	//Opens included files relative to the including file and records their paths
+	class ShaderIncludeHandler : public ID3DInclude
+	{
+	public:
+		ShaderIncludeHandler(const wstring& file) : m_directory(Directory(file)) { }
+
+		STDMETHOD(Open)(D3D_INCLUDE_TYPE includeType, LPCSTR fileName, LPCVOID parentData, LPCVOID* data, UINT* bytes)
+		{
+			UNREFERENCED_PARAMETER(includeType);
+			auto parent = m_paths.find(parentData);
+			wstring path = (parent != m_paths.end() ? Directory(parent->second) : m_directory) +
+						   wstring(fileName, fileName + strlen(fileName));
+			m_contents.push_back(vector<BYTE>());
+			vector<BYTE>& contents = m_contents.back();
+			if (!AssetCache::ReadFile(path, contents))
+			{
+				m_contents.pop_back();
+				return E_FAIL;
+			}
+			//Terminating zero keeps buffers of empty files distinct from the null pointer of the main file
+			contents.push_back(0);
+			m_paths[contents.data()] = path;
+			m_includes.push_back(path);
+			*data = contents.data();
+			*bytes = static_cast<UINT>(contents.size() - 1);
+			return S_OK;
+		}
+
+		//Buffers are released together with the handler
+		STDMETHOD(Close)(LPCVOID data) { UNREFERENCED_PARAMETER(data); return S_OK; }
+
+		const vector<wstring>& getIncludes() const { return m_includes; }
+
+	private:
+		wstring m_directory;
+		list<vector<BYTE>> m_contents;
+		map<LPCVOID, wstring> m_paths;
+		vector<wstring> m_includes;
+	};
+}
+
 
 DeviceHelper::DeviceHelper(const shared_ptr<ID3D11Device>& deviceObject)
 	: m_deviceObject(deviceObject)
@@ -13,7 +78,7 @@ DeviceHelper::DeviceHelper(const shared_ptr<ID3D11Device>& deviceObject)
 }
 
 DeviceHelper::DeviceHelper(const DeviceHelper& right)
-	: m_deviceObject(right.m_deviceObject)
+	: m_deviceObject(right.m_deviceObject), m_shaderCache(right.m_shaderCache)
 {
 
 }
@@ -21,6 +86,7 @@ DeviceHelper::DeviceHelper(const DeviceHelper& right)
 DeviceHelper& DeviceHelper::operator = (const DeviceHelper& right)
 {
 	m_deviceObject = right.m_deviceObject;
+	m_shaderCache = right.m_shaderCache;
 	return *this;
 }
 
@@ -28,13 +94,66 @@ shared_ptr<ID3DBlob> DeviceHelper::CompileD3DShader(const wstring& filePath, con
 													const string& shaderModel, const D3D10_SHADER_MACRO* defines)
 {
 	assert(m_deviceObject);
+	if (m_shaderCache)
+	{
+		ShaderDesc desc;
+		desc.File = filePath;
+		desc.Entry = entry;
+		desc.Model = shaderModel;
+		for (const D3D10_SHADER_MACRO* define = defines; define && define->Name; ++define)
+			desc.Defines.push_back(make_pair(string(define->Name), string(define->Definition ? define->Definition : "")));
+		vector<BYTE> byteCode = m_shaderCache->Get(desc);
+		ID3DBlob* b;
+		HRESULT result = D3DCreateBlob(byteCode.size(), &b);
+		shared_ptr<ID3DBlob> buffer(b, Utils::COMRelease);
+		if (FAILED(result))
+			THROW_DX11(result);
+		memcpy(buffer->GetBufferPointer(), byteCode.data(), byteCode.size());
+		return buffer;
+	}
+	DWORD shaderFlags = ShaderCompileFlags();
+	ID3DBlob* eb = nullptr, *b = nullptr;
+	HRESULT result = D3DX11CompileFromFileW(filePath.c_str(), defines, 0, entry.c_str(), shaderModel.c_str(), shaderFlags,
+		0, 0, &b, &eb, 0);
+	shared_ptr<ID3DBlob> errorBuffer(eb, Utils::COMRelease);
+	shared_ptr<ID3DBlob> buffer(b, Utils::COMRelease);
+	if (FAILED(result))
+	{
+		if (errorBuffer)
+		{
+			char* msg = reinterpret_cast<char*>(errorBuffer->GetBufferPointer());
+			OutputDebugStringA(msg);
+		}
+		THROW_DX11(result);
+	}
+	return buffer;
+}
+
+unsigned int DeviceHelper::ShaderCompileFlags()
+{
 	DWORD shaderFlags = D3DCOMPILE_ENABLE_STRICTNESS;
 #if defined( DEBUG ) || defined( _DEBUG )
 	shaderFlags |= D3DCOMPILE_DEBUG;
 #endif
+	return shaderFlags;
+}
+
+void DeviceHelper::CompileShader(const ShaderDesc& desc, const vector<BYTE>& source, vector<BYTE>& byteCode,
+								 vector<wstring>& includes)
+{
+	vector<D3D_SHADER_MACRO> defines;
+	for (auto it = desc.Defines.begin(); it != desc.Defines.end(); ++it)
+	{
+		D3D_SHADER_MACRO define = { it->first.c_str(), it->second.c_str() };
+		defines.push_back(define);
+	}
+	D3D_SHADER_MACRO end = { nullptr, nullptr };
+	defines.push_back(end);
+	ShaderIncludeHandler includeHandler(desc.File);
+	string sourceName(desc.File.begin(), desc.File.end());
 	ID3DBlob* eb = nullptr, *b = nullptr;
-	HRESULT result = D3DX11CompileFromFileW(filePath.c_str(), defines, 0, entry.c_str(), shaderModel.c_str(), shaderFlags,
-		0, 0, &b, &eb, 0);
+	HRESULT result = D3DCompile(source.data(), source.size(), sourceName.c_str(), defines.data(), &includeHandler,
+								desc.Entry.c_str(), desc.Model.c_str(), ShaderCompileFlags(), 0, &b, &eb);
 	shared_ptr<ID3DBlob> errorBuffer(eb, Utils::COMRelease);
 	shared_ptr<ID3DBlob> buffer(b, Utils::COMRelease);
 	if (FAILED(result))
@@ -46,7 +165,9 @@ shared_ptr<ID3DBlob> DeviceHelper::CompileD3DShader(const wstring& filePath, con
 		}
 		THROW_DX11(result);
 	}
-	return buffer;
+	const BYTE* data = reinterpret_cast<const BYTE*>(buffer->GetBufferPointer());
+	byteCode.assign(data, data + buffer->GetBufferSize());
+	includes = includeHandler.getIncludes();
 }
 
 shared_ptr<ID3D11VertexShader> DeviceHelper::CreateVertexShader(shared_ptr<ID3DBlob> byteCode)
@@ -168,11 +289,12 @@ D3D11_TEXTURE2D_DESC DeviceHelper::DefaultTexture2DDesc()
 	return desc;
 }
 
-shared_ptr<ID3D11Texture2D> DeviceHelper::CreateTexture2D(const D3D11_TEXTURE2D_DESC& desc)
+shared_ptr<ID3D11Texture2D> DeviceHelper::CreateTexture2D(const D3D11_TEXTURE2D_DESC& desc,
+														   const D3D11_SUBRESOURCE_DATA* initialData)
 {
 	assert(m_deviceObject);
 	ID3D11Texture2D* t;
-	HRESULT result = m_deviceObject->CreateTexture2D(&desc, nullptr, &t);
+	HRESULT result = m_deviceObject->CreateTexture2D(&desc, initialData, &t);
 	shared_ptr<ID3D11Texture2D> texture(t, Utils::COMRelease);
 	if (FAILED(result))
 		THROW_DX11(result);
@@ -214,6 +336,14 @@ shared_ptr<ID3D11ShaderResourceView> DeviceHelper::CreateShaderResourceView(cons
 shared_ptr<ID3D11ShaderResourceView> DeviceHelper::CreateShaderResourceView(const wstring& fileName)
 {
 	assert(m_deviceObject);
+	wstring extension = Extension(fileName);
+	if (extension == L"dds")
+		return CreateShaderResourceView(DdsFile(fileName));
+	if (extension == L"tga" || extension == L"bmp")
+	{
+		ImageRowReader image(fileName);
+		return CreateShaderResourceView(image);
+	}
 	ID3D11ShaderResourceView* rv;
 	HRESULT result = D3DX11CreateShaderResourceViewFromFileW(m_deviceObject.get(), fileName.c_str(), 0, 0, &rv, 0);
 	shared_ptr<ID3D11ShaderResourceView> resourceView(rv, Utils::COMRelease);
@@ -222,6 +352,111 @@ shared_ptr<ID3D11ShaderResourceView> DeviceHelper::CreateShaderResourceView(cons
 	return resourceView;
 }
 
+shared_ptr<ID3D11ShaderResourceView> DeviceHelper::CreateShaderResourceView(const DdsFile& dds)
+{
+	D3D11_TEXTURE2D_DESC desc = DefaultTexture2DDesc();
+	desc.Width = dds.getWidth();
+	desc.Height = dds.getHeight();
+	desc.MipLevels = dds.getMipLevels();
+	desc.ArraySize = dds.getArraySize();
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.MiscFlags = dds.isCubeMap() ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0;
+	//Pixels point into the mapped file, only 24 bit images have to be expanded to 32 bits
+	vector<D3D11_SUBRESOURCE_DATA> data(dds.getSubresourcesCount());
+	vector<vector<BYTE>> expanded;
+	if (dds.getFormat() == DdsFile::FORMAT_B8G8R8)
+	{
+		desc.Format = DXGI_FORMAT_B8G8R8X8_UNORM;
+		expanded.resize(data.size());
+	}
+	else
+		desc.Format = static_cast<DXGI_FORMAT>(DdsFile::getFormatInfo(dds.getFormat()).DXGIFormat);
+	for (unsigned int i = 0; i < data.size(); ++i)
+	{
+		const DdsFile::Subresource& s = dds.getSubresource(i);
+		data[i].pSysMem = s.Data;
+		data[i].SysMemPitch = static_cast<UINT>(s.RowPitch);
+		data[i].SysMemSlicePitch = static_cast<UINT>(s.Size);
+		if (expanded.empty())
+			continue;
+		vector<BYTE>& pixels = expanded[i];
+		pixels.resize(s.Width * s.Height * 4);
+		for (unsigned int p = 0; p < s.Width * s.Height; ++p)
+		{
+			unsigned int y = p / s.Width, x = p % s.Width;
+			memcpy(&pixels[p * 4], s.Data + y * s.RowPitch + x * 3, 3);
+			pixels[p * 4 + 3] = 255;
+		}
+		data[i].pSysMem = pixels.data();
+		data[i].SysMemPitch = s.Width * 4;
+		data[i].SysMemSlicePitch = static_cast<UINT>(pixels.size());
+	}
+	shared_ptr<ID3D11Texture2D> texture = CreateTexture2D(desc, data.data());
+	D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc = DefaultShaderResourceDesc();
+	viewDesc.Format = desc.Format;
+	if (dds.isCubeMap() && desc.ArraySize == 6)
+	{
+		viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+		viewDesc.TextureCube.MostDetailedMip = 0;
+		viewDesc.TextureCube.MipLevels = -1;
+	}
+	else if (dds.isCubeMap())
+	{
+		viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBEARRAY;
+		viewDesc.TextureCubeArray.MostDetailedMip = 0;
+		viewDesc.TextureCubeArray.MipLevels = -1;
+		viewDesc.TextureCubeArray.First2DArrayFace = 0;
+		viewDesc.TextureCubeArray.NumCubes = desc.ArraySize / 6;
+	}
+	else if (desc.ArraySize > 1)
+	{
+		viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+		viewDesc.Texture2DArray.MostDetailedMip = 0;
+		viewDesc.Texture2DArray.MipLevels = -1;
+		viewDesc.Texture2DArray.FirstArraySlice = 0;
+		viewDesc.Texture2DArray.ArraySize = desc.ArraySize;
+	}
+	return CreateShaderResourceView(texture, &viewDesc);
+}
+
+shared_ptr<ID3D11ShaderResourceView> DeviceHelper::CreateShaderResourceView(ImageRowReader& image)
+{
+	D3D11_TEXTURE2D_DESC desc = DefaultTexture2DDesc();
+	desc.Width = image.getWidth();
+	desc.Height = image.getHeight();
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	vector<vector<BYTE>> mips(1, vector<BYTE>(desc.Width * desc.Height * 4));
+	vector<BYTE> row(desc.Width * 4);
+	unsigned int y;
+	while (image.ReadRow(row.data(), y))
+		memcpy(&mips[0][y * row.size()], row.data(), row.size());
+	//Each level averages 2x2 pixels of the previous one, the last pixel of odd dimensions is repeated
+	for (unsigned int w = desc.Width, h = desc.Height; w > 1 || h > 1; w = max(1u, w / 2), h = max(1u, h / 2))
+	{
+		const vector<BYTE>& src = mips.back();
+		unsigned int dw = max(1u, w / 2), dh = max(1u, h / 2);
+		vector<BYTE> dst(dw * dh * 4);
+		for (unsigned int dy = 0; dy < dh; ++dy)
+			for (unsigned int dx = 0; dx < dw; ++dx)
+			{
+				unsigned int x0 = dx * 2, x1 = min(x0 + 1, w - 1), y0 = dy * 2, y1 = min(y0 + 1, h - 1);
+				for (unsigned int c = 0; c < 4; ++c)
+					dst[(dy * dw + dx) * 4 + c] = static_cast<BYTE>((src[(y0 * w + x0) * 4 + c] +
+						src[(y0 * w + x1) * 4 + c] + src[(y1 * w + x0) * 4 + c] + src[(y1 * w + x1) * 4 + c] + 2) / 4);
+			}
+		mips.push_back(move(dst));
+	}
+	desc.MipLevels = static_cast<UINT>(mips.size());
+	vector<D3D11_SUBRESOURCE_DATA> data(mips.size());
+	for (unsigned int i = 0, w = desc.Width; i < mips.size(); ++i, w = max(1u, w / 2))
+	{
+		data[i].pSysMem = mips[i].data();
+		data[i].SysMemPitch = w * 4;
+		data[i].SysMemSlicePitch = static_cast<UINT>(mips[i].size());
+	}
+	return CreateShaderResourceView(CreateTexture2D(desc, data.data()), nullptr);
+}
+
 D3D11_SAMPLER_DESC DeviceHelper::DefaultSamplerDesc()
 {
 	D3D11_SAMPLER_DESC desc;
@@ -7,6 +7,8 @@
 #include <string>
 #include <vector>
 #include <D3Dcompiler.h>
+#include "gk2_shaderCache.h"
+#include "gk2_imageFile.h"
 
 namespace gk2
 {
@@ -20,10 +22,18 @@ namespace gk2
 
 		const std::shared_ptr<ID3D11Device>& getDeviceObject() const { return m_deviceObject; }
 		void setDeviceObject(const std::shared_ptr<ID3D11Device>& deviceObject) { m_deviceObject = deviceObject; }
+		//When set, compiled shaders are looked up in and stored to the cache
+		const std::shared_ptr<gk2::ShaderCache>& getShaderCache() const { return m_shaderCache; }
+		void setShaderCache(const std::shared_ptr<gk2::ShaderCache>& cache) { m_shaderCache = cache; }
 
 		std::shared_ptr<ID3DBlob> CompileD3DShader(const std::wstring& filePath, const std::string&  entry,
 												   const std::string&  shaderModel,
 												   const D3D10_SHADER_MACRO* defines = nullptr);
+		//Flags used to compile shaders in the current configuration
+		static unsigned int ShaderCompileFlags();
+		//gk2::ShaderCompiler based on D3DCompile, doesn't need a device
+		static void CompileShader(const gk2::ShaderDesc& desc, const std::vector<BYTE>& source,
+								  std::vector<BYTE>& byteCode, std::vector<std::wstring>& includes);
 		std::shared_ptr<ID3D11VertexShader> CreateVertexShader(std::shared_ptr<ID3DBlob> byteCode);
 		std::shared_ptr<ID3D11HullShader> CreateHullShader(std::shared_ptr<ID3DBlob> byteCode);
 		std::shared_ptr<ID3D11DomainShader> CreateDomainShader(std::shared_ptr<ID3DBlob> byteCode);
@@ -80,14 +90,21 @@ namespace gk2
 
 		std::shared_ptr<ID3D11Buffer> CreateBuffer(const D3D11_BUFFER_DESC& desc, const void* pData = nullptr);
 		D3D11_TEXTURE2D_DESC DefaultTexture2DDesc();
-		std::shared_ptr<ID3D11Texture2D> CreateTexture2D(const D3D11_TEXTURE2D_DESC& desc);
+		std::shared_ptr<ID3D11Texture2D> CreateTexture2D(const D3D11_TEXTURE2D_DESC& desc,
+														 const D3D11_SUBRESOURCE_DATA* initialData = nullptr);
 		D3D11_SHADER_RESOURCE_VIEW_DESC DefaultShaderResourceDesc();
 		std::shared_ptr<ID3D11ShaderResourceView> CreateShaderResourceView(
 																	const std::shared_ptr<ID3D11Texture2D>& texture);
 		std::shared_ptr<ID3D11ShaderResourceView> CreateShaderResourceView(
 																	const std::shared_ptr<ID3D11Texture2D>& texture,
 																	const D3D11_SHADER_RESOURCE_VIEW_DESC& desc);
+		//DDS files are mapped and uploaded directly, TGA and BMP files are decoded row by row, other formats are
+		//loaded by D3DX
 		std::shared_ptr<ID3D11ShaderResourceView> CreateShaderResourceView(const std::wstring& fileName);
+		//Immutable texture initialized straight from the subresources of the file
+		std::shared_ptr<ID3D11ShaderResourceView> CreateShaderResourceView(const gk2::DdsFile& dds);
+		//RGBA8 texture with mipmaps averaged from the decoded image
+		std::shared_ptr<ID3D11ShaderResourceView> CreateShaderResourceView(gk2::ImageRowReader& image);
 		D3D11_SAMPLER_DESC DefaultSamplerDesc();
 		std::shared_ptr<ID3D11SamplerState> CreateSamplerState(const D3D11_SAMPLER_DESC& desc);
 		std::shared_ptr<ID3D11Texture2D> CreateDepthStencilTexture(SIZE size);
@@ -108,6 +125,7 @@ namespace gk2
 
 	private:
 		std::shared_ptr<ID3D11Device> m_deviceObject;
+		std::shared_ptr<gk2::ShaderCache> m_shaderCache;
 
 		std::shared_ptr<ID3D11Buffer> _CreateBufferInternal(const void* pData, unsigned int byteWidth,
 			D3D11_BIND_FLAG bindFlags, D3D11_USAGE usage);
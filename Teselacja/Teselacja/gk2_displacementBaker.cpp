@@ -0,0 +1,262 @@
+#include "gk2_displacementBaker.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ios>
+
+using namespace std;
+using namespace gk2;
+
+namespace
+{
+	XMFLOAT3 Add(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.x + b.x, a.y + b.y, a.z + b.z);
+	}
+
+	XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+
+	XMFLOAT3 Scale(const XMFLOAT3& a, float s)
+	{
+		return XMFLOAT3(a.x * s, a.y * s, a.z * s);
+	}
+
+	XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	//Degenerate vectors are replaced by the fallback
+	XMFLOAT3 Normalize(const XMFLOAT3& a, const XMFLOAT3& fallback)
+	{
+		float length = sqrt(a.x * a.x + a.y * a.y + a.z * a.z);
+		return length > 1e-12f ? Scale(a, 1.0f / length) : fallback;
+	}
+
+	void Bernstein(float t, float b[4], float d[4])
+	{
+		float s = 1.0f - t;
+		b[0] = s * s * s;
+		b[1] = 3.0f * s * s * t;
+		b[2] = 3.0f * s * t * t;
+		b[3] = t * t * t;
+		d[0] = -3.0f * s * s;
+		d[1] = 3.0f * s * s - 6.0f * s * t;
+		d[2] = 6.0f * s * t - 3.0f * t * t;
+		d[3] = 3.0f * t * t;
+	}
+
+	template<typename T>
+	void Append(vector<BYTE>& data, const T* items, size_t count)
+	{
+		const BYTE* bytes = reinterpret_cast<const BYTE*>(items);
+		data.insert(data.end(), bytes, bytes + count * sizeof(T));
+	}
+
+	template<typename T>
+	bool Extract(const vector<BYTE>& data, size_t& offset, T* items, size_t count)
+	{
+		size_t size = count * sizeof(T);
+		if (data.size() - offset < size)
+			return false;
+		if (size)
+			memcpy(items, &data[offset], size);
+		offset += size;
+		return true;
+	}
+}
+
+float DisplacementBaker::HeightMap::Sample(float u, float v) const
+{
+	float x = u * Width - 0.5f, y = v * Height - 0.5f;
+	float x0 = floor(x), y0 = floor(y);
+	float fx = x - x0, fy = y - y0;
+	int w = static_cast<int>(Width), h = static_cast<int>(Height);
+	int ix0 = (static_cast<int>(x0) % w + w) % w, iy0 = (static_cast<int>(y0) % h + h) % h;
+	int ix1 = (ix0 + 1) % w, iy1 = (iy0 + 1) % h;
+	float top = Values[iy0 * w + ix0] * (1.0f - fx) + Values[iy0 * w + ix1] * fx;
+	float bottom = Values[iy1 * w + ix0] * (1.0f - fx) + Values[iy1 * w + ix1] * fx;
+	return top * (1.0f - fy) + bottom * fy;
+}
+
+vector<DisplacementBaker::HeightMap> DisplacementBaker::ReadHeightMaps(const DdsFile& dds)
+{
+	size_t channel, pixelSize;
+	switch (dds.getFormat())
+	{
+	case DdsFile::FORMAT_B8G8R8:
+		channel = 2;
+		pixelSize = 3;
+		break;
+	case DdsFile::FORMAT_B8G8R8A8:
+	case DdsFile::FORMAT_B8G8R8X8:
+		channel = 2;
+		pixelSize = 4;
+		break;
+	case DdsFile::FORMAT_R8G8B8A8:
+		channel = 0;
+		pixelSize = 4;
+		break;
+	case DdsFile::FORMAT_R8:
+		channel = 0;
+		pixelSize = 1;
+		break;
+	default:
+		throw ios_base::failure("Unsupported height map format");
+	}
+	vector<HeightMap> maps(dds.getMipLevels());
+	for (unsigned int level = 0; level < maps.size(); ++level)
+	{
+		const DdsFile::Subresource& s = dds.getSubresource(0, level);
+		HeightMap& map = maps[level];
+		map.Width = s.Width;
+		map.Height = s.Height;
+		map.Values.resize(s.Width * s.Height);
+		for (unsigned int y = 0; y < s.Height; ++y)
+			for (unsigned int x = 0; x < s.Width; ++x)
+				map.Values[y * s.Width + x] = s.Data[y * s.RowPitch + x * pixelSize + channel] / 255.0f;
+	}
+	return maps;
+}
+
+void DisplacementBaker::EvaluatePatch(const Patch& patch, float u, float v, XMFLOAT3& position, XMFLOAT3& du,
+									  XMFLOAT3& dv)
+{
+	float bu[4], du4[4], bv[4], dv4[4];
+	Bernstein(u, bu, du4);
+	Bernstein(v, bv, dv4);
+	position = du = dv = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	//Control points are stored row by row, rows follow the v direction
+	for (int j = 0; j < 4; ++j)
+		for (int i = 0; i < 4; ++i)
+		{
+			const XMFLOAT3& p = patch.ControlPoints[j * 4 + i];
+			position = Add(position, Scale(p, bu[i] * bv[j]));
+			du = Add(du, Scale(p, du4[i] * bv[j]));
+			dv = Add(dv, Scale(p, bu[i] * dv4[j]));
+		}
+}
+
+DisplacementBaker::Mesh DisplacementBaker::Bake(const vector<Patch>& patches, const vector<HeightMap>& heightMaps,
+												const vector<unsigned int>& resolutions, float scale)
+{
+	Mesh mesh;
+	mesh.PatchCount = static_cast<unsigned int>(patches.size());
+	for (auto r = resolutions.begin(); r != resolutions.end(); ++r)
+	{
+		unsigned int resolution = *r;
+		if (resolution == 0 || (resolution + 1) * (resolution + 1) > 0x10000)
+			throw ios_base::failure("Invalid displacement mesh resolution");
+		Lod lod;
+		lod.Resolution = resolution;
+		lod.VertexOffset = static_cast<unsigned int>(mesh.Vertices.size());
+		lod.VerticesPerPatch = (resolution + 1) * (resolution + 1);
+		lod.IndexOffset = static_cast<unsigned int>(mesh.Indices.size());
+		lod.IndexCount = resolution * resolution * 6;
+		for (unsigned int y = 0; y < resolution; ++y)
+			for (unsigned int x = 0; x < resolution; ++x)
+			{
+				unsigned short a = static_cast<unsigned short>(y * (resolution + 1) + x);
+				unsigned short c = static_cast<unsigned short>(a + resolution + 1);
+				unsigned short quad[6] = { a, static_cast<unsigned short>(a + 1), c,
+										   static_cast<unsigned short>(a + 1), static_cast<unsigned short>(c + 1), c };
+				mesh.Indices.insert(mesh.Indices.end(), quad, quad + 6);
+			}
+		//Finer mipmaps would alias when sampled less than once per texel
+		const HeightMap* map = &heightMaps[0];
+		for (float texelsPerQuad = static_cast<float>(map->Width) / TILES / resolution;
+			 texelsPerQuad >= 2.0f && map + 1 != heightMaps.data() + heightMaps.size(); texelsPerQuad /= 2.0f)
+			++map;
+		float step = 1.0f / resolution;
+		for (auto p = patches.begin(); p != patches.end(); ++p)
+		{
+			const Patch& patch = *p;
+			auto displaced = [&](float u, float v, XMFLOAT3& du, XMFLOAT3& dv, XMFLOAT2& tex) -> XMFLOAT3
+			{
+				XMFLOAT3 position;
+				EvaluatePatch(patch, u, v, position, du, dv);
+				XMFLOAT3 normal = Normalize(Cross(du, dv), XMFLOAT3(0.0f, 0.0f, 1.0f));
+				tex = XMFLOAT2((u + patch.TileX) / TILES, (1.0f - v + patch.TileY) / TILES);
+				return Add(position, Scale(normal, scale * map->Sample(tex.x, tex.y)));
+			};
+			for (unsigned int y = 0; y <= resolution; ++y)
+				for (unsigned int x = 0; x <= resolution; ++x)
+				{
+					float u = x * step, v = y * step, e = 0.5f * step;
+					VertexPosNormalTangentTex vertex;
+					vertex.Pos = displaced(u, v, vertex.Tangent, vertex.Binormal, vertex.Tex);
+					//Central differences of the displaced surface, patch polynomials are extended past the borders
+					XMFLOAT3 du, dv;
+					XMFLOAT2 tex;
+					XMFLOAT3 tu = Subtract(displaced(u + e, v, du, dv, tex), displaced(u - e, v, du, dv, tex));
+					XMFLOAT3 tv = Subtract(displaced(u, v + e, du, dv, tex), displaced(u, v - e, du, dv, tex));
+					vertex.Normal = Normalize(Cross(tu, tv), Normalize(Cross(vertex.Tangent, vertex.Binormal),
+																	   XMFLOAT3(0.0f, 0.0f, 1.0f)));
+					mesh.Vertices.push_back(vertex);
+				}
+		}
+		mesh.Lods.push_back(lod);
+	}
+	return mesh;
+}
+
+vector<BYTE> DisplacementBaker::Serialize(const Mesh& mesh)
+{
+	unsigned int header[4] = { mesh.PatchCount, static_cast<unsigned int>(mesh.Lods.size()),
+							   static_cast<unsigned int>(mesh.Vertices.size()),
+							   static_cast<unsigned int>(mesh.Indices.size()) };
+	vector<BYTE> data;
+	data.reserve(sizeof(header) + mesh.Lods.size() * sizeof(Lod) +
+				 mesh.Vertices.size() * sizeof(VertexPosNormalTangentTex) + mesh.Indices.size() * sizeof(unsigned short));
+	Append(data, header, 4);
+	Append(data, mesh.Lods.data(), mesh.Lods.size());
+	Append(data, mesh.Vertices.data(), mesh.Vertices.size());
+	Append(data, mesh.Indices.data(), mesh.Indices.size());
+	return data;
+}
+
+bool DisplacementBaker::Deserialize(const vector<BYTE>& data, Mesh& mesh)
+{
+	unsigned int header[4];
+	size_t offset = 0;
+	if (!Extract(data, offset, header, 4))
+		return false;
+	mesh.PatchCount = header[0];
+	mesh.Lods.resize(header[1]);
+	mesh.Vertices.resize(header[2]);
+	mesh.Indices.resize(header[3]);
+	return Extract(data, offset, mesh.Lods.data(), mesh.Lods.size()) &&
+		   Extract(data, offset, mesh.Vertices.data(), mesh.Vertices.size()) &&
+		   Extract(data, offset, mesh.Indices.data(), mesh.Indices.size()) && offset == data.size();
+}
+
+DisplacementBaker::Mesh DisplacementBaker::Load(const AssetCache& cache, const wstring& heightMapFile,
+												const vector<Patch>& patches, const vector<unsigned int>& resolutions,
+												float scale)
+{
+	vector<BYTE> source;
+	if (!AssetCache::ReadFile(heightMapFile, source))
+		throw ios_base::failure("Unable to read the height map");
+	unsigned long long hash = AssetCache::Hash(source.data(), source.size());
+	hash = AssetCache::Hash(patches.data(), patches.size() * sizeof(Patch), hash);
+	hash = AssetCache::Hash(resolutions.data(), resolutions.size() * sizeof(unsigned int), hash);
+	hash = AssetCache::Hash(&scale, sizeof(scale), hash);
+	Mesh mesh;
+	vector<BYTE> artifact;
+	if (cache.Load("DisplacementBaker", VERSION, hash, artifact) && Deserialize(artifact, mesh))
+		return mesh;
+	mesh = Bake(patches, ReadHeightMaps(DdsFile(source.data(), source.size())), resolutions, scale);
+	cache.Store("DisplacementBaker", VERSION, hash, Serialize(mesh));
+	return mesh;
+}
+
+unsigned int DisplacementBaker::SelectLod(const vector<Lod>& lods, float tessellationFactor)
+{
+	for (unsigned int i = static_cast<unsigned int>(lods.size()); i > 0; --i)
+		if (lods[i - 1].Resolution >= tessellationFactor)
+			return i - 1;
+	return 0;
+}
@@ -0,0 +1,80 @@
+#ifndef __GK2_DISPLACEMENT_BAKER_H_
+#define __GK2_DISPLACEMENT_BAKER_H_
+
+#include "gk2_vertices.h"
+#include "gk2_imageFile.h"
+#include "gk2_assetCache.h"
+#include <string>
+#include <vector>
+
+namespace gk2
+{
+	//Evaluates bicubic Bezier patches displaced by a height map on the CPU and stores the result as a static
+	//mesh with several levels of detail. The surface matches the one produced by the tessellation of Part IV/V,
+	//but can be drawn without hull and domain shaders.
+	class DisplacementBaker
+	{
+	public:
+		static const unsigned int VERSION = 1;
+		//Textures are divided into TILES x TILES parts, one per patch
+		static const unsigned int TILES = 4;
+
+		//One level of a single channel texture, values in [0, 1]
+		struct HeightMap
+		{
+			unsigned int Width;
+			unsigned int Height;
+			std::vector<float> Values;
+
+			//Bilinear filtering with wrap addressing, like the sampler of the domain shader
+			float Sample(float u, float v) const;
+		};
+
+		struct Patch
+		{
+			XMFLOAT3 ControlPoints[16];
+			unsigned int TileX;
+			unsigned int TileY;
+		};
+
+		struct Lod
+		{
+			//Number of quads along each side of a patch
+			unsigned int Resolution;
+			//Vertices of consecutive patches follow each other starting with VertexOffset
+			unsigned int VertexOffset;
+			unsigned int VerticesPerPatch;
+			//Indices are shared by all the patches and relative to the first vertex of a patch
+			unsigned int IndexOffset;
+			unsigned int IndexCount;
+		};
+
+		struct Mesh
+		{
+			unsigned int PatchCount;
+			std::vector<gk2::VertexPosNormalTangentTex> Vertices;
+			std::vector<unsigned short> Indices;
+			//Ordered from the finest
+			std::vector<Lod> Lods;
+		};
+
+		//Red channel of all the mipmaps of the texture
+		static std::vector<HeightMap> ReadHeightMaps(const gk2::DdsFile& dds);
+		//Position and partial derivatives of the patch
+		static void EvaluatePatch(const Patch& patch, float u, float v, XMFLOAT3& position, XMFLOAT3& du,
+								  XMFLOAT3& dv);
+		//Surface moved along the normal of the patch by scale * height. Each level of detail samples the mipmap
+		//closest to its vertex spacing, normals are computed from the displaced surface.
+		static Mesh Bake(const std::vector<Patch>& patches, const std::vector<HeightMap>& heightMaps,
+						 const std::vector<unsigned int>& resolutions, float scale);
+		static std::vector<BYTE> Serialize(const Mesh& mesh);
+		static bool Deserialize(const std::vector<BYTE>& data, Mesh& mesh);
+		//Takes the mesh from the cache, or bakes and stores it if the height map or any parameter changed
+		static Mesh Load(const gk2::AssetCache& cache, const std::wstring& heightMapFile,
+						 const std::vector<Patch>& patches, const std::vector<unsigned int>& resolutions, float scale);
+		//Coarsest level with at least as many quads per patch side as the tessellation factor
+		static unsigned int SelectLod(const std::vector<Lod>& lods, float tessellationFactor);
+	};
+}
+
+#endif __GK2_DISPLACEMENT_BAKER_H_
@@ -4,7 +4,7 @@
 using namespace std;
 using namespace gk2;
 
-EffectBase::EffectBase(shared_ptr<ID3D11DeviceContext> context /* = nullptr */)
+EffectBase::EffectBase(shared_ptr<RenderContext> context /* = nullptr */)
 	: m_context(context)
 {
 }
@@ -40,7 +40,7 @@ void EffectBase::SetInteriorTessellationFactorBuffer(const std::shared_ptr<gk2::
 }
 
 
-void EffectBase::Begin(std::shared_ptr<ID3D11DeviceContext> context /* = nullptr */)
+void EffectBase::Begin(std::shared_ptr<RenderContext> context /* = nullptr */)
 {
 	if (context != nullptr && context != m_context)
 		m_context = context;
@@ -84,4 +84,14 @@ void EffectBase::Initialize(DeviceHelper& device, shared_ptr<ID3D11InputLayout>&
 	}
 	else
 		m_layout = layout;
+}
+
+void EffectBase::Initialize(DeviceHelper& device, const wstring& shaderFile, const D3D11_INPUT_ELEMENT_DESC* layout,
+							unsigned int layoutElements, const string& shaderModel)
+{
+	shared_ptr<ID3DBlob> vsByteCode = device.CompileD3DShader(shaderFile, "VS_Main", "vs_" + shaderModel);
+	shared_ptr<ID3DBlob> psByteCode = device.CompileD3DShader(shaderFile, "PS_Main", "ps_" + shaderModel);
+	m_vs = device.CreateVertexShader(vsByteCode);
+	m_ps = device.CreatePixelShader(psByteCode);
+	m_layout = device.CreateInputLayout(layout, layoutElements, vsByteCode);
 }
\ No newline at end of file
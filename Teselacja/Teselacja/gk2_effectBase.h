@@ -18,11 +18,11 @@ namespace gk2
 		void SetEedgeTessellationFactorBuffer(const std::shared_ptr<gk2::ConstantBuffer<FLOAT>>& e);
 		void SetInteriorTessellationFactorBuffer(const std::shared_ptr<gk2::ConstantBuffer<FLOAT>>& i);
 
-		void Begin(std::shared_ptr<ID3D11DeviceContext> context = nullptr);
+		void Begin(std::shared_ptr<gk2::RenderContext> context = nullptr);
 		void End();
 
 	protected:
-		EffectBase(std::shared_ptr<ID3D11DeviceContext> context = nullptr);
+		EffectBase(std::shared_ptr<gk2::RenderContext> context = nullptr);
 
 		virtual void SetVertexShaderData() = 0;
 		virtual void SetHullShaderData() = 0;
@@ -35,10 +35,14 @@ namespace gk2
 		std::shared_ptr<gk2::CBMatrix> m_worldCB;
 		std::shared_ptr<gk2::CBMatrix> m_viewCB;
 		std::shared_ptr<gk2::CBMatrix> m_projCB;
-		std::shared_ptr<ID3D11DeviceContext> m_context;
+		std::shared_ptr<gk2::RenderContext> m_context;
 
 		void Initialize(gk2::DeviceHelper& device, std::shared_ptr<ID3D11InputLayout>& layout,
 			const std::wstring& shaderFile, bool phong = false);
+		//Vertex and pixel shader only, with its own vertex layout. Shader model "4_0" runs on devices without
+		//tessellation support.
+		void Initialize(gk2::DeviceHelper& device, const std::wstring& shaderFile,
+			const D3D11_INPUT_ELEMENT_DESC* layout, unsigned int layoutElements, const std::string& shaderModel);
 
 	private:
 		std::shared_ptr<ID3D11VertexShader> m_vs;
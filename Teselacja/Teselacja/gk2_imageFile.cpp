@@ -0,0 +1,561 @@
+#include "gk2_imageFile.h"
+#ifdef _WIN32
+#include "gk2_exceptions.h"
+#else
+#include "gk2_fileSystem.h"
+#include <ios>
+#include <sstream>
+#endif
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+using namespace gk2;
+
+namespace
+{
+	const unsigned int DDS_MAGIC = 0x20534444;
+	const unsigned int DDSD_MIPMAPCOUNT = 0x20000;
+	const unsigned int DDPF_ALPHAPIXELS = 0x1, DDPF_FOURCC = 0x4, DDPF_RGB = 0x40, DDPF_LUMINANCE = 0x20000;
+	const unsigned int DDSCAPS2_CUBEMAP = 0x200, DDSCAPS2_CUBEMAP_ALLFACES = 0xfc00, DDSCAPS2_VOLUME = 0x200000;
+	//D3D11_RESOURCE_DIMENSION_TEXTURE2D and D3D11_RESOURCE_MISC_TEXTURECUBE
+	const unsigned int DIMENSION_TEXTURE2D = 3, MISC_TEXTURECUBE = 0x4;
+	//D3DFMT_A16B16G16R16F and D3DFMT_A32B32G32R32F legacy format codes
+	const unsigned int D3DFMT_A16B16G16R16F = 113, D3DFMT_A32B32G32R32F = 116;
+	//D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION, images are decoded into textures
+	const unsigned int MAX_IMAGE_DIMENSION = 16384;
+
+	struct DDSPixelFormat
+	{
+		unsigned int Size;
+		unsigned int Flags;
+		unsigned int FourCC;
+		unsigned int RGBBitCount;
+		unsigned int RBitMask;
+		unsigned int GBitMask;
+		unsigned int BBitMask;
+		unsigned int ABitMask;
+	};
+
+	struct DDSHeader
+	{
+		unsigned int Size;
+		unsigned int Flags;
+		unsigned int Height;
+		unsigned int Width;
+		unsigned int PitchOrLinearSize;
+		unsigned int Depth;
+		unsigned int MipMapCount;
+		unsigned int Reserved1[11];
+		DDSPixelFormat PixelFormat;
+		unsigned int Caps;
+		unsigned int Caps2;
+		unsigned int Caps3;
+		unsigned int Caps4;
+		unsigned int Reserved2;
+	};
+
+	struct DDSHeaderDX10
+	{
+		unsigned int DXGIFormat;
+		unsigned int ResourceDimension;
+		unsigned int MiscFlag;
+		unsigned int ArraySize;
+		unsigned int MiscFlags2;
+	};
+
+	//Indexed by DdsFile::Format
+	const DdsFile::FormatInfo FORMATS[] =
+	{
+		{ 28, 32, false },		//DXGI_FORMAT_R8G8B8A8_UNORM
+		{ 87, 32, false },		//DXGI_FORMAT_B8G8R8A8_UNORM
+		{ 88, 32, false },		//DXGI_FORMAT_B8G8R8X8_UNORM
+		{ 0, 24, false },
+		{ 61, 8, false },		//DXGI_FORMAT_R8_UNORM
+		{ 10, 64, false },		//DXGI_FORMAT_R16G16B16A16_FLOAT
+		{ 2, 128, false },		//DXGI_FORMAT_R32G32B32A32_FLOAT
+		{ 71, 8, true },		//DXGI_FORMAT_BC1_UNORM
+		{ 74, 16, true },		//DXGI_FORMAT_BC2_UNORM
+		{ 77, 16, true },		//DXGI_FORMAT_BC3_UNORM
+		{ 80, 8, true },		//DXGI_FORMAT_BC4_UNORM
+		{ 83, 16, true }		//DXGI_FORMAT_BC5_UNORM
+	};
+
+	unsigned int FourCC(char a, char b, char c, char d)
+	{
+		return static_cast<unsigned int>(a) | (static_cast<unsigned int>(b) << 8) |
+			   (static_cast<unsigned int>(c) << 16) | (static_cast<unsigned int>(d) << 24);
+	}
+
+	DdsFile::Format FormatFromDXGI(unsigned int dxgiFormat)
+	{
+		//Typeless and sRGB variants share the layout of the UNORM format
+		switch (dxgiFormat)
+		{
+		case 27: case 29: dxgiFormat = 28; break;
+		case 90: case 91: dxgiFormat = 87; break;
+		case 92: case 93: dxgiFormat = 88; break;
+		case 60: dxgiFormat = 61; break;
+		case 70: case 72: dxgiFormat = 71; break;
+		case 73: case 75: dxgiFormat = 74; break;
+		case 76: case 78: dxgiFormat = 77; break;
+		case 79: dxgiFormat = 80; break;
+		case 82: dxgiFormat = 83; break;
+		default: break;
+		}
+		for (unsigned int i = 0; i < sizeof(FORMATS) / sizeof(FORMATS[0]); ++i)
+			if (FORMATS[i].DXGIFormat != 0 && FORMATS[i].DXGIFormat == dxgiFormat)
+				return static_cast<DdsFile::Format>(i);
+		throw ios_base::failure("Unsupported DDS format");
+	}
+
+	DdsFile::Format FormatFromPixelFormat(const DDSPixelFormat& pf)
+	{
+		if (pf.Flags & DDPF_FOURCC)
+		{
+			if (pf.FourCC == FourCC('D', 'X', 'T', '1'))
+				return DdsFile::FORMAT_BC1;
+			if (pf.FourCC == FourCC('D', 'X', 'T', '2') || pf.FourCC == FourCC('D', 'X', 'T', '3'))
+				return DdsFile::FORMAT_BC2;
+			if (pf.FourCC == FourCC('D', 'X', 'T', '4') || pf.FourCC == FourCC('D', 'X', 'T', '5'))
+				return DdsFile::FORMAT_BC3;
+			if (pf.FourCC == FourCC('A', 'T', 'I', '1') || pf.FourCC == FourCC('B', 'C', '4', 'U'))
+				return DdsFile::FORMAT_BC4;
+			if (pf.FourCC == FourCC('A', 'T', 'I', '2') || pf.FourCC == FourCC('B', 'C', '5', 'U'))
+				return DdsFile::FORMAT_BC5;
+			if (pf.FourCC == D3DFMT_A16B16G16R16F)
+				return DdsFile::FORMAT_R16G16B16A16_FLOAT;
+			if (pf.FourCC == D3DFMT_A32B32G32R32F)
+				return DdsFile::FORMAT_R32G32B32A32_FLOAT;
+		}
+		else if ((pf.Flags & DDPF_RGB) && pf.RGBBitCount == 32)
+		{
+			bool alpha = (pf.Flags & DDPF_ALPHAPIXELS) && pf.ABitMask == 0xff000000;
+			if (pf.RBitMask == 0xff && pf.GBitMask == 0xff00 && pf.BBitMask == 0xff0000)
+				return DdsFile::FORMAT_R8G8B8A8;
+			if (pf.RBitMask == 0xff0000 && pf.GBitMask == 0xff00 && pf.BBitMask == 0xff)
+				return alpha ? DdsFile::FORMAT_B8G8R8A8 : DdsFile::FORMAT_B8G8R8X8;
+		}
+		else if ((pf.Flags & DDPF_RGB) && pf.RGBBitCount == 24)
+		{
+			if (pf.RBitMask == 0xff0000 && pf.GBitMask == 0xff00 && pf.BBitMask == 0xff)
+				return DdsFile::FORMAT_B8G8R8;
+		}
+		else if ((pf.Flags & DDPF_LUMINANCE) && pf.RGBBitCount == 8)
+			return DdsFile::FORMAT_R8;
+		throw ios_base::failure("Unsupported DDS pixel format");
+	}
+
+	unsigned int ReadLE(const BYTE* data, unsigned int bytes)
+	{
+		unsigned int value = 0;
+		for (unsigned int i = 0; i < bytes; ++i)
+			value |= static_cast<unsigned int>(data[i]) << (8 * i);
+		return value;
+	}
+
+	unsigned int LowestBit(unsigned int mask)
+	{
+		unsigned int shift = 0;
+		while (shift < 32 && !(mask & (1u << shift)))
+			++shift;
+		return shift;
+	}
+
+	//Channel value selected by the mask scaled to 8 bits
+	BYTE MaskedChannel(unsigned int pixel, unsigned int mask, BYTE missing)
+	{
+		if (mask == 0)
+			return missing;
+		unsigned int shift = LowestBit(mask);
+		unsigned int max = mask >> shift;
+		return static_cast<BYTE>(((pixel & mask) >> shift) * 255 / max);
+	}
+}
+
+#ifdef _WIN32
+MappedFile::MappedFile(const wstring& fileName)
+	: m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr), m_data(nullptr), m_size(0)
+{
+	m_file = CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+						 FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE)
+		THROW_WINAPI;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size))
+	{
+		CloseHandle(m_file);
+		THROW_WINAPI;
+	}
+	m_size = static_cast<size_t>(size.QuadPart);
+	//Empty files can't be mapped
+	if (m_size == 0)
+		return;
+	m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mapping)
+		m_data = reinterpret_cast<const BYTE*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!m_data)
+	{
+		DWORD error = GetLastError();
+		if (m_mapping)
+			CloseHandle(m_mapping);
+		CloseHandle(m_file);
+		throw WinAPIException(__AT__, error);
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_data)
+		UnmapViewOfFile(m_data);
+	if (m_mapping)
+		CloseHandle(m_mapping);
+	CloseHandle(m_file);
+}
+#else
+//Other platforms only run the headless build, the file is read into memory
+MappedFile::MappedFile(const wstring& fileName)
+	: m_file(nullptr), m_mapping(nullptr), m_data(nullptr), m_size(0)
+{
+	vector<BYTE> contents;
+	if (!NativeFileSystem().ReadFile(fileName, contents))
+		throw ios_base::failure("Cannot read the file");
+	m_size = contents.size();
+	if (m_size == 0)
+		return;
+	BYTE* data = new BYTE[m_size];
+	memcpy(data, contents.data(), m_size);
+	m_data = data;
+}
+
+MappedFile::~MappedFile()
+{
+	delete[] m_data;
+}
+#endif
+
+DdsFile::DdsFile(const wstring& fileName)
+	: m_file(new MappedFile(fileName))
+{
+	Parse(m_file->getData(), m_file->getSize());
+}
+
+DdsFile::DdsFile(const BYTE* data, size_t size)
+{
+	Parse(data, size);
+}
+
+const DdsFile::FormatInfo& DdsFile::getFormatInfo(Format format)
+{
+	return FORMATS[format];
+}
+
+void DdsFile::Parse(const BYTE* data, size_t size)
+{
+	DDSHeader header;
+	if (size < 4 + sizeof(header) || ReadLE(data, 4) != DDS_MAGIC)
+		throw ios_base::failure("Invalid DDS file");
+	memcpy(&header, data + 4, sizeof(header));
+	if (header.Size != sizeof(header) || header.PixelFormat.Size != sizeof(DDSPixelFormat))
+		throw ios_base::failure("Invalid DDS file");
+	size_t offset = 4 + sizeof(header);
+	m_width = header.Width;
+	m_height = header.Height;
+	if (m_width == 0 || m_height == 0)
+		throw ios_base::failure("Invalid DDS dimensions");
+	m_mipLevels = (header.Flags & DDSD_MIPMAPCOUNT) && header.MipMapCount > 0 ? header.MipMapCount : 1;
+	m_arraySize = 1;
+	m_cubeMap = false;
+	if ((header.PixelFormat.Flags & DDPF_FOURCC) && header.PixelFormat.FourCC == FourCC('D', 'X', '1', '0'))
+	{
+		DDSHeaderDX10 dx10;
+		if (size < offset + sizeof(dx10))
+			throw ios_base::failure("Invalid DDS file");
+		memcpy(&dx10, data + offset, sizeof(dx10));
+		offset += sizeof(dx10);
+		if (dx10.ResourceDimension != DIMENSION_TEXTURE2D)
+			throw ios_base::failure("Only 2D DDS textures are supported");
+		m_format = FormatFromDXGI(dx10.DXGIFormat);
+		m_cubeMap = (dx10.MiscFlag & MISC_TEXTURECUBE) != 0;
+		//Every subresource takes at least a byte, so a larger count can't be valid and could overflow
+		if (max(1u, dx10.ArraySize) > (size - offset) / m_mipLevels / (m_cubeMap ? 6 : 1))
+			throw ios_base::failure("DDS file is truncated");
+		m_arraySize = max(1u, dx10.ArraySize) * (m_cubeMap ? 6 : 1);
+	}
+	else
+	{
+		if (header.Caps2 & DDSCAPS2_VOLUME)
+			throw ios_base::failure("Only 2D DDS textures are supported");
+		m_format = FormatFromPixelFormat(header.PixelFormat);
+		if (header.Caps2 & DDSCAPS2_CUBEMAP)
+		{
+			//Partial cube maps can't be created in D3D11
+			if ((header.Caps2 & DDSCAPS2_CUBEMAP_ALLFACES) != DDSCAPS2_CUBEMAP_ALLFACES)
+				throw ios_base::failure("Partial DDS cube maps are not supported");
+			m_cubeMap = true;
+			m_arraySize = 6;
+		}
+	}
+	if (m_arraySize > (size - offset) / m_mipLevels)
+		throw ios_base::failure("DDS file is truncated");
+	const FormatInfo& info = getFormatInfo(m_format);
+	m_subresources.clear();
+	m_subresources.reserve(m_arraySize * m_mipLevels);
+	for (unsigned int item = 0; item < m_arraySize; ++item)
+	{
+		unsigned int width = m_width, height = m_height;
+		for (unsigned int mip = 0; mip < m_mipLevels; ++mip)
+		{
+			Subresource s;
+			s.Width = width;
+			s.Height = height;
+			size_t rows;
+			if (info.BlockCompressed)
+			{
+				s.RowPitch = max(1u, (width + 3) / 4) * info.Size;
+				rows = max(1u, (height + 3) / 4);
+			}
+			else
+			{
+				s.RowPitch = (static_cast<size_t>(width) * info.Size + 7) / 8;
+				rows = height;
+			}
+			s.Size = s.RowPitch * rows;
+			if (size - offset < s.Size)
+				throw ios_base::failure("DDS file is truncated");
+			s.Data = data + offset;
+			offset += s.Size;
+			m_subresources.push_back(s);
+			width = max(1u, width / 2);
+			height = max(1u, height / 2);
+		}
+	}
+}
+
+ImageRowReader::ImageRowReader(const wstring& fileName)
+#ifdef _WIN32
+	: m_stream(new ifstream(fileName, ios::binary))
+{
+	if (!*m_stream)
+		throw ios_base::failure("Unable to open image file");
+#else
+{
+	vector<BYTE> contents;
+	if (!NativeFileSystem().ReadFile(fileName, contents))
+		throw ios_base::failure("Unable to open image file");
+	m_stream.reset(new istringstream(string(contents.begin(), contents.end()), ios::binary));
+#endif
+	ReadHeader();
+}
+
+ImageRowReader::ImageRowReader(const shared_ptr<istream>& stream)
+	: m_stream(stream)
+{
+	ReadHeader();
+}
+
+void ImageRowReader::Read(void* data, size_t size)
+{
+	m_stream->read(reinterpret_cast<char*>(data), size);
+	if (!*m_stream)
+		throw ios_base::failure("Unexpected end of image file");
+}
+
+void ImageRowReader::ReadHeader()
+{
+	m_rowsRead = 0;
+	m_rle = false;
+	m_packetLeft = 0;
+	m_packetRun = false;
+	memset(m_masks, 0, sizeof(m_masks));
+	char signature[2] = { 0, 0 };
+	m_stream->read(signature, 2);
+	m_stream->clear();
+	m_stream->seekg(0, ios::beg);
+	m_bmp = signature[0] == 'B' && signature[1] == 'M';
+	if (m_bmp)
+		ReadBmpHeader();
+	else
+		ReadTgaHeader();
+	if (m_width > MAX_IMAGE_DIMENSION || m_height > MAX_IMAGE_DIMENSION)
+		throw ios_base::failure("Image is larger than a texture");
+	m_row.resize(m_bmp ? (m_width * m_bitsPerPixel + 31) / 32 * 4 : m_width * m_bitsPerPixel / 8);
+}
+
+void ImageRowReader::ReadBmpHeader()
+{
+	BYTE fileHeader[14], info[124];
+	Read(fileHeader, sizeof(fileHeader));
+	unsigned int dataOffset = ReadLE(fileHeader + 10, 4);
+	Read(info, 4);
+	unsigned int infoSize = ReadLE(info, 4);
+	if (infoSize < 40 || infoSize > sizeof(info))
+		throw ios_base::failure("Unsupported BMP header");
+	Read(info + 4, infoSize - 4);
+	int width = static_cast<int>(ReadLE(info + 4, 4)), height = static_cast<int>(ReadLE(info + 8, 4));
+	m_bitsPerPixel = ReadLE(info + 14, 2);
+	unsigned int compression = ReadLE(info + 16, 4), colorsUsed = ReadLE(info + 32, 4);
+	//Negative height marks rows stored from the top, negated as unsigned so that INT_MIN doesn't overflow
+	m_bottomUp = height > 0;
+	m_width = static_cast<unsigned int>(width);
+	m_height = height > 0 ? static_cast<unsigned int>(height) : 0u - static_cast<unsigned int>(height);
+	if (width <= 0 || height == 0)
+		throw ios_base::failure("Invalid BMP dimensions");
+	//BI_RGB and BI_BITFIELDS
+	if (compression == 0)
+	{
+		if (m_bitsPerPixel == 24 || m_bitsPerPixel == 32)
+		{
+			m_masks[0] = 0xff0000;
+			m_masks[1] = 0xff00;
+			m_masks[2] = 0xff;
+		}
+		else if (m_bitsPerPixel == 8)
+		{
+			if (colorsUsed > 256)
+				throw ios_base::failure("Invalid BMP palette");
+			unsigned int count = colorsUsed ? colorsUsed : 256;
+			vector<BYTE> palette(count * 4);
+			Read(palette.data(), palette.size());
+			m_palette.resize(256 * 4, 0);
+			for (unsigned int i = 0; i < count; ++i)
+			{
+				m_palette[i * 4] = palette[i * 4 + 2];
+				m_palette[i * 4 + 1] = palette[i * 4 + 1];
+				m_palette[i * 4 + 2] = palette[i * 4];
+				m_palette[i * 4 + 3] = 255;
+			}
+		}
+		else
+			throw ios_base::failure("Unsupported BMP pixel format");
+	}
+	else if (compression == 3 && m_bitsPerPixel == 32)
+	{
+		//Masks follow the basic header or are part of the extended ones
+		if (infoSize == 40)
+			Read(info + 40, 12);
+		for (int i = 0; i < 3; ++i)
+			m_masks[i] = ReadLE(info + 40 + 4 * i, 4);
+		m_masks[3] = infoSize >= 56 ? ReadLE(info + 52, 4) : 0;
+	}
+	else
+		throw ios_base::failure("Unsupported BMP compression");
+	m_stream->seekg(dataOffset, ios::beg);
+	if (!*m_stream)
+		throw ios_base::failure("Unexpected end of image file");
+}
+
+void ImageRowReader::ReadTgaHeader()
+{
+	BYTE header[18];
+	Read(header, sizeof(header));
+	unsigned int idLength = header[0], colorMapType = header[1], imageType = header[2];
+	unsigned int colorMapLength = ReadLE(header + 5, 2), colorMapEntrySize = header[7];
+	m_width = ReadLE(header + 12, 2);
+	m_height = ReadLE(header + 14, 2);
+	m_bitsPerPixel = header[16];
+	m_bottomUp = (header[17] & 0x20) == 0;
+	//Color mapped (1, 9), true color (2, 10) and grayscale (3, 11) images, the second ones RLE compressed
+	m_rle = imageType >= 9;
+	unsigned int baseType = m_rle ? imageType - 8 : imageType;
+	if (baseType < 1 || baseType > 3 || m_width == 0 || m_height == 0)
+		throw ios_base::failure("Unsupported TGA image type");
+	if (header[17] & 0x10)
+		throw ios_base::failure("Right to left TGA images are not supported");
+	if ((baseType == 1 && m_bitsPerPixel != 8) || (baseType == 2 && m_bitsPerPixel != 24 && m_bitsPerPixel != 32) ||
+		(baseType == 3 && m_bitsPerPixel != 8))
+		throw ios_base::failure("Unsupported TGA pixel format");
+	m_stream->seekg(idLength, ios::cur);
+	if (colorMapType == 1)
+	{
+		unsigned int entryBytes = (colorMapEntrySize + 7) / 8;
+		vector<BYTE> colorMap(colorMapLength * entryBytes);
+		Read(colorMap.data(), colorMap.size());
+		if (baseType == 1)
+		{
+			if (entryBytes != 3 && entryBytes != 4)
+				throw ios_base::failure("Unsupported TGA color map");
+			unsigned int first = ReadLE(header + 3, 2);
+			m_palette.resize(256 * 4, 0);
+			for (unsigned int i = 0; i < colorMapLength && first + i < 256; ++i)
+			{
+				const BYTE* entry = &colorMap[i * entryBytes];
+				BYTE* color = &m_palette[(first + i) * 4];
+				color[0] = entry[2];
+				color[1] = entry[1];
+				color[2] = entry[0];
+				color[3] = entryBytes == 4 ? entry[3] : 255;
+			}
+		}
+	}
+	else if (baseType == 1)
+		throw ios_base::failure("TGA color map is missing");
+	if (baseType == 2)
+	{
+		m_masks[0] = 0xff0000;
+		m_masks[1] = 0xff00;
+		m_masks[2] = 0xff;
+		m_masks[3] = m_bitsPerPixel == 32 ? 0xff000000 : 0;
+	}
+	else if (baseType == 3)
+	{
+		//Grayscale value is expanded into all the color channels
+		m_palette.resize(256 * 4);
+		for (unsigned int i = 0; i < 256; ++i)
+		{
+			fill(m_palette.begin() + i * 4, m_palette.begin() + i * 4 + 3, static_cast<BYTE>(i));
+			m_palette[i * 4 + 3] = 255;
+		}
+	}
+}
+
+void ImageRowReader::DecodePixel(const BYTE* pixel, BYTE* rgba) const
+{
+	if (m_bitsPerPixel == 8)
+	{
+		memcpy(rgba, &m_palette[*pixel * 4], 4);
+		return;
+	}
+	unsigned int value = ReadLE(pixel, m_bitsPerPixel / 8);
+	rgba[0] = MaskedChannel(value, m_masks[0], 0);
+	rgba[1] = MaskedChannel(value, m_masks[1], 0);
+	rgba[2] = MaskedChannel(value, m_masks[2], 0);
+	rgba[3] = MaskedChannel(value, m_masks[3], 255);
+}
+
+bool ImageRowReader::ReadRow(BYTE* rgba, unsigned int& y)
+{
+	if (m_rowsRead == m_height)
+		return false;
+	unsigned int pixelSize = m_bitsPerPixel / 8;
+	if (!m_rle)
+	{
+		Read(m_row.data(), m_row.size());
+		for (unsigned int x = 0; x < m_width; ++x)
+			DecodePixel(&m_row[x * pixelSize], rgba + x * 4);
+	}
+	else
+	{
+		BYTE pixel[4];
+		for (unsigned int x = 0; x < m_width; ++x)
+		{
+			if (m_packetLeft == 0)
+			{
+				BYTE packet;
+				Read(&packet, 1);
+				m_packetRun = (packet & 0x80) != 0;
+				m_packetLeft = (packet & 0x7f) + 1;
+				if (m_packetRun)
+					Read(m_runPixel, pixelSize);
+			}
+			if (!m_packetRun)
+				Read(pixel, pixelSize);
+			DecodePixel(m_packetRun ? m_runPixel : pixel, rgba + x * 4);
+			--m_packetLeft;
+		}
+	}
+	y = m_bottomUp ? m_height - 1 - m_rowsRead : m_rowsRead;
+	++m_rowsRead;
+	return true;
+}
@@ -0,0 +1,150 @@
+#ifndef __GK2_IMAGE_FILE_H_
+#define __GK2_IMAGE_FILE_H_
+
+#include <Windows.h>
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace gk2
+{
+	//Read only contents of a file mapped into memory
+	class MappedFile
+	{
+	public:
+		explicit MappedFile(const std::wstring& fileName);
+		~MappedFile();
+
+		const BYTE* getData() const { return m_data; }
+		size_t getSize() const { return m_size; }
+
+	private:
+		HANDLE m_file;
+		HANDLE m_mapping;
+		const BYTE* m_data;
+		size_t m_size;
+
+		MappedFile(const MappedFile& right);
+		MappedFile& operator =(const MappedFile& right);
+	};
+
+	//DDS texture (2D, cube or array, with all its mipmaps) parsed in place. Subresources point into the file
+	//data, nothing is copied.
+	class DdsFile
+	{
+	public:
+		enum Format
+		{
+			FORMAT_R8G8B8A8,
+			FORMAT_B8G8R8A8,
+			FORMAT_B8G8R8X8,
+			FORMAT_B8G8R8,			//24 bits per pixel, has no DXGI equivalent and must be expanded
+			FORMAT_R8,
+			FORMAT_R16G16B16A16_FLOAT,
+			FORMAT_R32G32B32A32_FLOAT,
+			FORMAT_BC1,
+			FORMAT_BC2,
+			FORMAT_BC3,
+			FORMAT_BC4,
+			FORMAT_BC5
+		};
+
+		struct FormatInfo
+		{
+			//DXGI_FORMAT value, 0 if there is none
+			unsigned int DXGIFormat;
+			//Bits per pixel, or bytes per 4x4 block of compressed formats
+			unsigned int Size;
+			bool BlockCompressed;
+		};
+
+		struct Subresource
+		{
+			const BYTE* Data;
+			size_t Size;
+			unsigned int Width;
+			unsigned int Height;
+			//Bytes per row of pixels, or per row of blocks of compressed formats
+			size_t RowPitch;
+		};
+
+		//Maps the file, the mapping is shared by copies of the object
+		explicit DdsFile(const std::wstring& fileName);
+		//Parses data owned by the caller, it must outlive the object
+		DdsFile(const BYTE* data, size_t size);
+
+		static const FormatInfo& getFormatInfo(Format format);
+
+		Format getFormat() const { return m_format; }
+		unsigned int getWidth() const { return m_width; }
+		unsigned int getHeight() const { return m_height; }
+		unsigned int getMipLevels() const { return m_mipLevels; }
+		//Number of 2D images, 6 per cube
+		unsigned int getArraySize() const { return m_arraySize; }
+		bool isCubeMap() const { return m_cubeMap; }
+		//Subresources are ordered like D3D11CalcSubresource: all mipmaps of the first image, then of the next one
+		unsigned int getSubresourcesCount() const { return static_cast<unsigned int>(m_subresources.size()); }
+		const Subresource& getSubresource(unsigned int index) const { return m_subresources[index]; }
+		const Subresource& getSubresource(unsigned int arrayIndex, unsigned int mipLevel) const
+		{
+			return m_subresources[arrayIndex * m_mipLevels + mipLevel];
+		}
+
+	private:
+		std::shared_ptr<gk2::MappedFile> m_file;
+		Format m_format;
+		unsigned int m_width;
+		unsigned int m_height;
+		unsigned int m_mipLevels;
+		unsigned int m_arraySize;
+		bool m_cubeMap;
+		std::vector<Subresource> m_subresources;
+
+		void Parse(const BYTE* data, size_t size);
+	};
+
+	//Decodes TGA (uncompressed and RLE, 8, 24 and 32 bits per pixel) and BMP (8, 24 and 32 bits per pixel) images
+	//into RGBA8 rows while reading the file, without keeping the whole image in memory. Images with sides larger
+	//than a texture can have are rejected.
+	class ImageRowReader
+	{
+	public:
+		//Format is recognized by the contents, files starting with "BM" are read as BMP and the rest as TGA
+		explicit ImageRowReader(const std::wstring& fileName);
+		explicit ImageRowReader(const std::shared_ptr<std::istream>& stream);
+
+		unsigned int getWidth() const { return m_width; }
+		unsigned int getHeight() const { return m_height; }
+
+		//Decodes the next row in the order of the file into width * 4 bytes. y receives the index of the row
+		//counted from the top of the image. Returns false when all the rows were read.
+		bool ReadRow(BYTE* rgba, unsigned int& y);
+
+	private:
+		std::shared_ptr<std::istream> m_stream;
+		unsigned int m_width;
+		unsigned int m_height;
+		bool m_bottomUp;
+		bool m_bmp;
+		bool m_rle;
+		unsigned int m_bitsPerPixel;
+		unsigned int m_rowsRead;
+		//BMP rows are padded to 4 bytes, BMP and TGA palettes are stored as RGBA
+		std::vector<BYTE> m_row;
+		std::vector<BYTE> m_palette;
+		unsigned int m_masks[4];
+		//State of the RLE packet, which may continue in the next row
+		unsigned int m_packetLeft;
+		bool m_packetRun;
+		BYTE m_runPixel[4];
+
+		void ReadHeader();
+		void ReadBmpHeader();
+		void ReadTgaHeader();
+		void Read(void* data, size_t size);
+		void DecodePixel(const BYTE* pixel, BYTE* rgba) const;
+	};
+}
+
+#endif __GK2_IMAGE_FILE_H_
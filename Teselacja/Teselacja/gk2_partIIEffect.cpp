@@ -7,7 +7,7 @@ using namespace gk2;
 const wstring PartIIEffect::ShaderFile = L"resources/shaders/PartIIShader.hlsl";
 
 PartIIEffect::PartIIEffect(gk2::DeviceHelper& device, std::shared_ptr<ID3D11InputLayout>& layout,
-					   std::shared_ptr<ID3D11DeviceContext> context /* = nullptr */)
+					   std::shared_ptr<RenderContext> context /* = nullptr */)
 	: EffectBase(context)
 {
 	Initialize(device, layout, ShaderFile);
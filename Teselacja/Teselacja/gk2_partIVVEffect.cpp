@@ -7,7 +7,7 @@ using namespace gk2;
 const wstring PartIVVEffect::ShaderFile = L"resources/shaders/PartIVVShader.hlsl";
 
 PartIVVEffect::PartIVVEffect(gk2::DeviceHelper& device, std::shared_ptr<ID3D11InputLayout>& layout,
-					   std::shared_ptr<ID3D11DeviceContext> context /* = nullptr */)
+					   std::shared_ptr<RenderContext> context /* = nullptr */)
 	: EffectBase(context)
 {
 	Initialize(device, layout, ShaderFile);
@@ -45,12 +45,6 @@ void PartIVVEffect::SetColorTexture(const shared_ptr<ID3D11ShaderResourceView>&
 		m_colorTexture = texture;
 }
 
-void PartIVVEffect::SetIndexBuffer(const std::shared_ptr<gk2::ConstantBuffer<INT>>& index)
-{
-	if (index != nullptr)
-		m_patchIndexCB = index;
-}
-
 void PartIVVEffect::SetNormalTexture(const shared_ptr<ID3D11ShaderResourceView>& texture)
 {
 	if (texture != nullptr)
@@ -72,8 +66,8 @@ void PartIVVEffect::SetHullShaderData()
 
 void PartIVVEffect::SetDomainShaderData()
 {
-	ID3D11Buffer* dsb[2] = { m_projCB->getBufferObject().get(), m_patchIndexCB->getBufferObject().get() };
-	m_context->DSSetConstantBuffers(0, 2, dsb);
+	ID3D11Buffer* dsb[1] = { m_projCB->getBufferObject().get() };
+	m_context->DSSetConstantBuffers(0, 1, dsb);
 	ID3D11ShaderResourceView* srv[1] = { m_dispTexture.get() };
 	m_context->DSSetShaderResources(0, 1, srv);
 	ID3D11SamplerState* ss[1] = { m_samplerState2.get() };
@@ -9,9 +9,8 @@ namespace gk2
 	{
 	public:
 		PartIVVEffect(gk2::DeviceHelper& device, std::shared_ptr<ID3D11InputLayout>& layout,
-			std::shared_ptr<ID3D11DeviceContext> context = nullptr);
+			std::shared_ptr<gk2::RenderContext> context = nullptr);
 		void SetSurfaceColorBuffer(const std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4>>& surfaceColor);
-		void SetIndexBuffer(const std::shared_ptr<gk2::ConstantBuffer<INT>>& index);
 		void SetCameraPosBuffer(const std::shared_ptr<ConstantBuffer<XMFLOAT4>>& cameraPos);
 		void SetSamplerState(const std::shared_ptr<ID3D11SamplerState>& samplerState, const std::shared_ptr<ID3D11SamplerState>& samplerState2);
 		void SetDisplacementTexture(const std::shared_ptr<ID3D11ShaderResourceView>& texture);
@@ -29,7 +28,6 @@ namespace gk2
 		static const std::wstring ShaderFile;
 
 		std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4>> m_surfaceColorCB;
-		std::shared_ptr<gk2::ConstantBuffer<INT>> m_patchIndexCB;
 		std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4>> m_cameraPosCB;
 		std::shared_ptr<ID3D11SamplerState> m_samplerState;
 		std::shared_ptr<ID3D11SamplerState> m_samplerState2;
@@ -1,12 +1,14 @@
 #include "gk2_tessellation.h"
 #include "gk2_window.h"
 #include "gk2_vertices.h"
+#include <algorithm>
+#include <cmath>
 
 using namespace gk2;
 using namespace std;
 
 Tessellation::Tessellation(HINSTANCE hInstance)
-	: ApplicationBase(hInstance), m_camera(0.01f, 100.0f)
+	: ApplicationBase(hInstance), m_camera(0.01f, 100.0f), m_bakedSurfacePatchCount(0), m_tessellationSupported(true)
 {
 
 }
@@ -16,16 +18,6 @@ Tessellation::~Tessellation()
 
 }
 
-void * Tessellation::operator new(size_t size)
-{
-	return Utils::New16Aligned(size);
-}
-
-void Tessellation::operator delete(void * ptr)
-{
-	Utils::Delete16Aligned(ptr);
-}
-
 void Tessellation::InitializeConstantBuffers()
 {
 	m_projCB.reset(new CBMatrix(m_device));
@@ -33,7 +25,6 @@ void Tessellation::InitializeConstantBuffers()
 	m_worldCB.reset(new CBMatrix(m_device));
 	m_surfaceColorCB.reset(new ConstantBuffer<XMFLOAT4>(m_device));
 	m_cameraPosCB.reset(new ConstantBuffer<XMFLOAT4>(m_device));
-	m_patchIndexCB.reset(new ConstantBuffer<INT>(m_device));
 	m_edgeTessellationFactorCB.reset(new ConstantBuffer<FLOAT>(m_device));
 	m_interiorTessellationFactorCB.reset(new ConstantBuffer<FLOAT>(m_device));
 }
@@ -83,6 +74,27 @@ bool Tessellation::LoadContent()
 	m_edgeTessellationFactorCB->Update(m_context, ETF);
 	m_interiorTessellationFactorCB->Update(m_context, ITF);
 
+	m_bakedSurfaceEffect.reset(new BakedSurfaceEffect(m_device));
+	m_bakedSurfaceEffect->SetProjMtxBuffer(m_projCB);
+	m_bakedSurfaceEffect->SetViewMtxBuffer(m_viewCB);
+	m_bakedSurfaceEffect->SetWorldMtxBuffer(m_worldCB);
+	m_bakedSurfaceEffect->SetSurfaceColorBuffer(m_surfaceColorCB);
+	m_bakedSurfaceEffect->SetSamplerState(m_pixelSamplerWrap);
+	m_bakedSurfaceEffect->SetColorTexture(m_colorTexture);
+	m_bakedSurfaceEffect->SetNormalTexture(m_normalTexture);
+
+	m_tessellationSupported = m_featureLevel >= D3D_FEATURE_LEVEL_11_0;
+	if (!m_tessellationSupported)
+	{
+		//Only the baked surface of Part IV/V can be shown
+		part = parts::IVV;
+		bakedSurfaceEnabled = true;
+		m_camera.Zoom(32.0f);
+		UpdateCamera();
+		InitializeBezierControlNetVertexBuffers();
+		return true;
+	}
+
 	m_colorEffect.reset(new ColorEffect(m_device, m_layout));
 	m_colorEffect->SetProjMtxBuffer(m_projCB);
 	m_colorEffect->SetViewMtxBuffer(m_viewCB);
@@ -118,7 +130,6 @@ bool Tessellation::LoadContent()
 	m_partIVVEffect->SetViewMtxBuffer(m_viewCB);
 	m_partIVVEffect->SetWorldMtxBuffer(m_worldCB);
 	m_partIVVEffect->SetSurfaceColorBuffer(m_surfaceColorCB);
-	m_partIVVEffect->SetIndexBuffer(m_patchIndexCB);
 	m_partIVVEffect->SetEedgeTessellationFactorBuffer(m_edgeTessellationFactorCB);
 	m_partIVVEffect->SetInteriorTessellationFactorBuffer(m_interiorTessellationFactorCB);
 	m_partIVVEffect->SetCameraPosBuffer(m_cameraPosCB);
@@ -246,8 +257,29 @@ void Tessellation::InitializeBezierControlNetVertexBuffers()
 		multipleBezierPatchVertexBuffers[15][i].Pos = XMFLOAT3(drainBezierPatch[i].Pos.x + H, drainBezierPatch[i].Pos.y + H, -drainBezierPatch[i].Pos.z);
 	}
 
-	for (size_t i = 0; i < 16; i++)
-		m_multipleBezierPatchVertexBuffers[i] = (m_device.CreateVertexBuffer(multipleBezierPatchVertexBuffers[i], m_bezierPatchVertexCount));
+	m_multipleBezierPatchVertexBuffer = m_device.CreateVertexBuffer(&multipleBezierPatchVertexBuffers[0][0],
+		16 * m_bezierPatchVertexCount);
+	InitializeBakedSurface(multipleBezierPatchVertexBuffers);
+}
+
+void Tessellation::InitializeBakedSurface(const VertexPos (&patches)[16][16])
+{
+	vector<DisplacementBaker::Patch> bakerPatches(16);
+	for (unsigned int i = 0; i < 16; i++)
+	{
+		for (unsigned int j = 0; j < 16; j++)
+			bakerPatches[i].ControlPoints[j] = patches[i][j].Pos;
+		bakerPatches[i].TileX = i % DisplacementBaker::TILES;
+		bakerPatches[i].TileY = i / DisplacementBaker::TILES;
+	}
+	//Displacement scale of the domain shader, finest level has one vertex per texel of the height map
+	unsigned int resolutions[] = { 64, 32, 16, 8 };
+	DisplacementBaker::Mesh mesh = DisplacementBaker::Load(AssetCache(), L"resources/textures/height.dds", bakerPatches,
+		vector<unsigned int>(resolutions, resolutions + ARRAYSIZE(resolutions)), 0.4f);
+	m_bakedSurfaceVertexBuffer = m_device.CreateVertexBuffer(mesh.Vertices);
+	m_bakedSurfaceIndexBuffer = m_device.CreateIndexBuffer(mesh.Indices);
+	m_bakedSurfaceLods = mesh.Lods;
+	m_bakedSurfacePatchCount = mesh.PatchCount;
 }
 
 void Tessellation::InitializeBezierControlNetIndicesBuffer()
@@ -349,7 +381,12 @@ void Tessellation::Update(float dt)
 		{
 			firstPatchEnabled = !firstPatchEnabled;
 		}
-		else if (prevKeyState.isKeyDown(DIK_F1) && currentKeyState.isKeyUp(DIK_F1))
+		else if (prevKeyState.isKeyDown(DIK_4) && currentKeyState.isKeyUp(DIK_4))
+		{
+			if (m_tessellationSupported)
+				bakedSurfaceEnabled = !bakedSurfaceEnabled;
+		}
+		else if (m_tessellationSupported && prevKeyState.isKeyDown(DIK_F1) && currentKeyState.isKeyUp(DIK_F1))
 		{
 			if (part == parts::IVV)
 			{
@@ -358,7 +395,7 @@ void Tessellation::Update(float dt)
 			}
 			part = parts::I;
 		}
-		else if (prevKeyState.isKeyDown(DIK_F2) && currentKeyState.isKeyUp(DIK_F2))
+		else if (m_tessellationSupported && prevKeyState.isKeyDown(DIK_F2) && currentKeyState.isKeyUp(DIK_F2))
 		{
 			if (part == parts::IVV)
 			{
@@ -367,7 +404,7 @@ void Tessellation::Update(float dt)
 			}
 			part = parts::II;
 		}
-		else if (prevKeyState.isKeyDown(DIK_F3) && currentKeyState.isKeyUp(DIK_F3))
+		else if (m_tessellationSupported && prevKeyState.isKeyDown(DIK_F3) && currentKeyState.isKeyUp(DIK_F3))
 		{
 			if (part == parts::IVV)
 			{
@@ -376,7 +413,7 @@ void Tessellation::Update(float dt)
 			}
 			part = parts::III;
 		}
-		else if (prevKeyState.isKeyDown(DIK_F4) && currentKeyState.isKeyUp(DIK_F4))
+		else if (m_tessellationSupported && prevKeyState.isKeyDown(DIK_F4) && currentKeyState.isKeyUp(DIK_F4))
 		{
 			if (part != parts::IVV)
 			{
@@ -458,8 +495,36 @@ void Tessellation::DrawPartIII()
 		DrawBezierControlNet();
 }
 
+void Tessellation::DrawBakedSurface()
+{
+	m_worldCB->Update(m_context, XMMatrixIdentity());
+	m_bakedSurfaceEffect->Begin(m_context);
+	if (wireframeEnabled)
+		m_context->RSSetState(m_rsWireframe.get());
+	else
+		m_context->RSSetState(m_rsSolid.get());
+
+	//Level of detail follows the edge tessellation factor of the hull shader
+	XMFLOAT4 cameraPos = m_camera.GetPosition();
+	float factor = -16.0f * log10(max(abs(cameraPos.z), 0.001f) * 0.01f) + ETF;
+	const DisplacementBaker::Lod& lod = m_bakedSurfaceLods[DisplacementBaker::SelectLod(m_bakedSurfaceLods, factor)];
+	unsigned int stride = sizeof(VertexPosNormalTangentTex), offset = 0;
+	ID3D11Buffer* b = m_bakedSurfaceVertexBuffer.get();
+	m_context->IASetVertexBuffers(0, 1, &b, &stride, &offset);
+	m_context->IASetIndexBuffer(m_bakedSurfaceIndexBuffer.get(), DXGI_FORMAT_R16_UINT, 0);
+	m_context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	for (unsigned int i = 0; i < m_bakedSurfacePatchCount; i++)
+		m_context->DrawIndexed(lod.IndexCount, lod.IndexOffset, lod.VertexOffset + i * lod.VerticesPerPatch);
+	m_bakedSurfaceEffect->End();
+}
+
 void Tessellation::DrawPartIVV()
 {
+	if (bakedSurfaceEnabled)
+	{
+		DrawBakedSurface();
+		return;
+	}
 	m_worldCB->Update(m_context, XMMatrixIdentity());
 	unsigned int offset = 0;
 	m_partIVVEffect->Begin(m_context);
@@ -468,14 +533,11 @@ void Tessellation::DrawPartIVV()
 	else
 		m_context->RSSetState(m_rsSolid.get());
 
-	for (int i = 0; i < 16; i++)
-	{
-		m_patchIndexCB->Update(m_context, i);
-		ID3D11Buffer* b = m_multipleBezierPatchVertexBuffers[i].get();
-		m_context->IASetVertexBuffers(0, 1, &b, &m_vertexStride, &offset);
-		m_context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_16_CONTROL_POINT_PATCHLIST);
-		m_context->Draw(m_bezierPatchVertexCount, 0);
-	}
+	//Patches find their part of the textures by their primitive id
+	ID3D11Buffer* b = m_multipleBezierPatchVertexBuffer.get();
+	m_context->IASetVertexBuffers(0, 1, &b, &m_vertexStride, &offset);
+	m_context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_16_CONTROL_POINT_PATCHLIST);
+	m_context->Draw(16 * m_bezierPatchVertexCount, 0);
 	m_partIVVEffect->End();
 }
 
@@ -9,17 +9,19 @@
 #include "gk2_partIIIEffect.h"
 #include "gk2_partIVVEffect.h"
 #include "gk2_colorEffect.h"
+#include "gk2_bakedSurfaceEffect.h"
+#include "gk2_displacementBaker.h"
+#include "gk2_vertices.h"
 #include <vector>
+#include "gk2_aligned.h"
 
 namespace gk2
 {
-	class Tessellation : public gk2::ApplicationBase
+	class Tessellation : public gk2::ApplicationBase, public gk2::AlignedNew
 	{
 	public:
 		Tessellation(HINSTANCE hInstance);
 		virtual ~Tessellation();
-		static void* operator new(size_t size);
-		static void operator delete(void* ptr);
 
 	protected:
 		virtual bool LoadContent();
@@ -33,8 +35,13 @@ namespace gk2
 		std::shared_ptr<ID3D11Buffer> m_quadVertexBuffer;
 		std::shared_ptr<ID3D11Buffer> m_bezierPatchVertexBuffers[2];
 		std::shared_ptr<ID3D11Buffer> m_bezierControlNetVertexBuffers[2];
-		std::shared_ptr<ID3D11Buffer> m_multipleBezierPatchVertexBuffers[16];
+		//Control points of the 16 patches one after another, drawn with one call
+		std::shared_ptr<ID3D11Buffer> m_multipleBezierPatchVertexBuffer;
 		std::shared_ptr<ID3D11Buffer> m_bezierControlNetIndexBuffer;
+		std::shared_ptr<ID3D11Buffer> m_bakedSurfaceVertexBuffer;
+		std::shared_ptr<ID3D11Buffer> m_bakedSurfaceIndexBuffer;
+		std::vector<gk2::DisplacementBaker::Lod> m_bakedSurfaceLods;
+		unsigned int m_bakedSurfacePatchCount;
 
 		unsigned int m_vertexStride;
 		const unsigned int m_quadVertexCount = 4;
@@ -46,6 +53,9 @@ namespace gk2
 		bool firstPatchEnabled = true;
 		bool bezierControlNetEnabled = true;
 		bool wireframeEnabled = false;
+		//Part IV/V drawn from the mesh with baked displacement, the only option without tessellation support
+		bool bakedSurfaceEnabled = false;
+		bool m_tessellationSupported;
 		enum parts part;
 
 		XMMATRIX m_projMtx;
@@ -56,7 +66,6 @@ namespace gk2
 		std::shared_ptr<gk2::CBMatrix> m_projCB;
 		std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4>> m_surfaceColorCB;
 		std::shared_ptr<gk2::ConstantBuffer<XMFLOAT4>> m_cameraPosCB;
-		std::shared_ptr<gk2::ConstantBuffer<INT>> m_patchIndexCB;
 		std::shared_ptr<gk2::ConstantBuffer<FLOAT>> m_edgeTessellationFactorCB;
 		std::shared_ptr<gk2::ConstantBuffer<FLOAT>> m_interiorTessellationFactorCB;
 
@@ -65,6 +74,7 @@ namespace gk2
 		std::shared_ptr<gk2::PartIIIEffect> m_partIIIEffect;
 		std::shared_ptr<gk2::PartIVVEffect> m_partIVVEffect;
 		std::shared_ptr<gk2::ColorEffect> m_colorEffect;
+		std::shared_ptr<gk2::BakedSurfaceEffect> m_bakedSurfaceEffect;
 		std::shared_ptr<ID3D11InputLayout> m_layout;
 
 		std::shared_ptr<ID3D11RasterizerState> m_rsWireframe;
@@ -83,6 +93,7 @@ namespace gk2
 		void InitializeQuadVertexBuffer();
 		void InitializeBezierControlNetVertexBuffers();
 		void InitializeBezierControlNetIndicesBuffer();
+		void InitializeBakedSurface(const gk2::VertexPos (&patches)[16][16]);
 		void UpdateCamera();
 		void DrawScene();
 		void DrawPartI();
@@ -90,6 +101,7 @@ namespace gk2
 		void DrawPartIII();
 		void DrawPartIVV();
 		void DrawBezierControlNet();
+		void DrawBakedSurface();
 	};
 
 	enum parts
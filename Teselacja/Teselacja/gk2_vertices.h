@@ -20,6 +20,18 @@ namespace gk2
 		static const unsigned int LayoutElements = 2;
 		static const D3D11_INPUT_ELEMENT_DESC Layout[LayoutElements];
 	};
+
+	//Vertex of a surface with a tangent frame for normal mapping, tangent and binormal aren't normalized
+	struct VertexPosNormalTangentTex
+	{
+		XMFLOAT3 Pos;
+		XMFLOAT3 Normal;
+		XMFLOAT3 Tangent;
+		XMFLOAT3 Binormal;
+		XMFLOAT2 Tex;
+		static const unsigned int LayoutElements = 5;
+		static const D3D11_INPUT_ELEMENT_DESC Layout[LayoutElements];
+	};
 }
 
 #endif __GK2_VERTICES_H_
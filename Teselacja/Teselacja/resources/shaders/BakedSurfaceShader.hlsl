@@ -0,0 +1,81 @@
+//Surface of Part IV/V with the displacement baked into the mesh, draws the same image without tessellation
+Texture2D colorMap : register(t1);
+Texture2D normalMap : register(t2);
+SamplerState pixelTextureSampler : register(s1);
+
+cbuffer cbWorld : register(b0) //Vertex Shader constant buffer slot 0
+{
+	matrix worldMatrix;
+};
+
+cbuffer cbView : register(b1) //Vertex Shader constant buffer slot 1
+{
+	matrix viewMatrix;
+};
+
+cbuffer cbProj : register(b2) //Vertex Shader constant buffer slot 2
+{
+	matrix projMatrix;
+};
+
+cbuffer cbSurfaceColor : register(b0) //Pixel Shader constant buffer slot 0
+{
+	float4 surfaceColor;
+};
+
+struct VSInput
+{
+	float3 pos : POSITION;
+	float3 norm : NORMAL;
+	float3 tangent : TANGENT;
+	float3 binormal : BINORMAL;
+	float2 texcoord : TEXCOORD0;
+};
+
+struct PSInput
+{
+	float4 pos : SV_POSITION;
+	float3 norm : NORMAL;
+	float3 viewVec : TEXCOORD0;
+	float3 lightVec : TEXCOORD1;
+	float2 texcoord : TEXCOORD2;
+	float3 tangent : TEXCOORD3;
+	float3 binormal : TEXCOORD4;
+	float3 patchPos : TEXCOORD5;
+};
+
+static const float3 lightPosition = float3(0, 5, 0);
+
+PSInput VS_Main(VSInput i)
+{
+	PSInput o;
+	matrix worldView = mul(viewMatrix, worldMatrix);
+	float4 viewPos = mul(worldView, float4(i.pos, 1.0f));
+	o.pos = mul(projMatrix, viewPos);
+	o.patchPos = viewPos.xyz;
+	o.viewVec = normalize(-viewPos.xyz);
+	o.lightVec = mul((float3x3)viewMatrix, lightPosition);
+	o.norm = normalize(mul(worldView, float4(i.norm, 0.0f)).xyz);
+	o.tangent = mul(worldView, float4(i.tangent, 0.0f)).xyz;
+	o.binormal = mul(worldView, float4(i.binormal, 0.0f)).xyz;
+	o.texcoord = i.texcoord;
+	return o;
+}
+
+static const float3 ambientColor = float3(0.3f, 0.3f, 0.3f);
+static const float3 lightColor = float3(1.0f, 1.0f, 1.0f);
+static const float3 kd = 0.7, ks = 1.0f, m = 100.0f;
+
+float4 PS_Main(PSInput i) : SV_TARGET
+{
+	float3 viewVec = normalize(i.viewVec);
+	float3 lightVec = normalize(i.lightVec - i.patchPos);
+	float3 texNorm = normalize(normalMap.Sample(pixelTextureSampler, i.texcoord).xyz);
+	float3 normal = normalize(texNorm.x * i.tangent + texNorm.y * i.binormal + texNorm.z * i.norm);
+	float3 halfVec = normalize(viewVec + lightVec);
+
+	float3 texColor = colorMap.Sample(pixelTextureSampler, i.texcoord).rgb;
+	float3 color = texColor * ambientColor;
+	color += lightColor * texColor * kd * saturate(dot(normal, lightVec)) + lightColor * ks * pow(saturate(dot(normal, halfVec)), m);
+	return float4(saturate(color), surfaceColor.a);
+}
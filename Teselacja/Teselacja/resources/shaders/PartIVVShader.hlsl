@@ -36,11 +36,6 @@ cbuffer cbProj : register(b0) //Domain Shader constant buffer slot 0
 	matrix projMatrix;
 };
 
-cbuffer cbPatchIndex : register(b1) //Domain Shader constant buffer slot 1
-{
-	int index;
-};
-
 cbuffer cbSurfaceColor : register(b0) //Pixel Shader constant buffer slot 0
 {
 	float4 surfaceColor;
@@ -107,15 +102,16 @@ float CalculateLogarithmicFactor(float z)
 HSPatchOutput HS_PatchConstantFunc(InputPatch<HSInput, INPUT_PATCH_SIZE> i, uint patchId : SV_PrimitiveID)
 {
 	HSPatchOutput o;
-	int edgeFactor = (int)(CalculateLogarithmicFactor(abs(i[patchId].cameraPos.z)));
-	float diff = abs(-abs(i[patchId].cameraPos.z) - (i[patchId].pos.z));
+	//Factors come from the first control point of every patch
+	int edgeFactor = (int)(CalculateLogarithmicFactor(abs(i[0].cameraPos.z)));
+	float diff = abs(-abs(i[0].cameraPos.z) - (i[0].pos.z));
 	int interiorFactor = (int)(CalculateLogarithmicFactor(diff));
 
 	o.edges[0] = o.edges[1] = o.edges[2] = o.edges[3] = edgeFactor + ETF;
 	o.inside[0] = o.inside[1] = interiorFactor + ITF;
-	o.viewVec = i[patchId].viewVec;
-	o.lightVec = i[patchId].lightVec;
-	o.cameraPos = i[patchId].cameraPos;
+	o.viewVec = i[0].viewVec;
+	o.lightVec = i[0].lightVec;
+	o.cameraPos = i[0].cameraPos;
 	return o;
 }
 
@@ -159,7 +155,8 @@ float CalculateMipLevel(float z)
 }
 
 [domain("quad")]
-PSInput DS_Main(HSPatchOutput i, float2 UV : SV_DomainLocation, const OutputPatch<DSControlPoint, OUTPUT_PATCH_SIZE> input)
+PSInput DS_Main(HSPatchOutput i, float2 UV : SV_DomainLocation, const OutputPatch<DSControlPoint, OUTPUT_PATCH_SIZE> input,
+				uint index : SV_PrimitiveID)
 {
 	PSInput o;
 	float4 U = CalculateBernsteinFactor(UV.x);